@@ -2467,14 +2467,22 @@ static void PacketReceived(PacketCommandNG *packet) {
             uint32_t startidx = packet->oldarg[0];
             uint32_t numofbytes = packet->oldarg[1];
 
+            bool with_crc = (packet->oldarg[2] & DL_FLAG_CHUNK_CRC);
+
             // arg0 = startindex
             // arg1 = length bytes to transfer
-            // arg2 = BigBuf tracelen
+            // arg2 = flags, DL_FLAG_CHUNK_CRC
+            // replies: arg2 = BigBuf tracelen
             //Dbprintf("transfer to client parameters: %" PRIu32 " | %" PRIu32 " | %" PRIu32, startidx, numofbytes, packet->oldarg[2]);
 
-            for (size_t offset = 0; offset < numofbytes; offset += PM3_CMD_DATA_SIZE) {
-                size_t len = MIN((numofbytes - offset), PM3_CMD_DATA_SIZE);
-                int result = reply_old(CMD_DOWNLOADED_BIGBUF, offset, len, BigBuf_get_traceLen(), &mem[startidx + offset], len);
+            size_t chunk = (with_crc) ? DL_CHUNK_DATA_SIZE : PM3_CMD_DATA_SIZE;
+            for (size_t offset = 0; offset < numofbytes; offset += chunk) {
+                size_t len = MIN((numofbytes - offset), chunk);
+                int result;
+                if (with_crc)
+                    result = reply_dl_chunk(CMD_DOWNLOADED_BIGBUF, startidx + offset, &mem[startidx + offset], len);
+                else
+                    result = reply_old(CMD_DOWNLOADED_BIGBUF, offset, len, BigBuf_get_traceLen(), &mem[startidx + offset], len);
                 if (result != PM3_SUCCESS)
                     Dbprintf("transfer to client failed ::  | bytes between %d - %d (%d) | result: %d", offset, offset + len, len, result);
             }
@@ -2526,13 +2534,20 @@ static void PacketReceived(PacketCommandNG *packet) {
             uint32_t startidx = packet->oldarg[0];
             uint32_t numofbytes = packet->oldarg[1];
 
+            bool with_crc = (packet->oldarg[2] & DL_FLAG_CHUNK_CRC);
+
             // arg0 = startindex
             // arg1 = length bytes to transfer
-            // arg2 = RFU
-
-            for (size_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
-                size_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
-                int result = reply_old(CMD_DOWNLOADED_EML_BIGBUF, i, len, 0, mem + startidx + i, len);
+            // arg2 = flags, DL_FLAG_CHUNK_CRC
+
+            size_t chunk = (with_crc) ? DL_CHUNK_DATA_SIZE : PM3_CMD_DATA_SIZE;
+            for (size_t i = 0; i < numofbytes; i += chunk) {
+                size_t len = MIN((numofbytes - i), chunk);
+                int result;
+                if (with_crc)
+                    result = reply_dl_chunk(CMD_DOWNLOADED_EML_BIGBUF, startidx + i, mem + startidx + i, len);
+                else
+                    result = reply_old(CMD_DOWNLOADED_EML_BIGBUF, i, len, 0, mem + startidx + i, len);
                 if (result != PM3_SUCCESS)
                     Dbprintf("transfer to client failed ::  | bytes between %d - %d (%d) | result: %d", i, i + len, len, result);
             }
@@ -2837,22 +2852,27 @@ static void PacketReceived(PacketCommandNG *packet) {
             uint8_t *mem = BigBuf_malloc(PM3_CMD_DATA_SIZE);
             uint32_t startidx = packet->oldarg[0];
             uint32_t numofbytes = packet->oldarg[1];
+            bool with_crc = (packet->oldarg[2] & DL_FLAG_CHUNK_CRC);
             // arg0 = startindex
             // arg1 = length bytes to transfer
-            // arg2 = RFU
+            // arg2 = flags, DL_FLAG_CHUNK_CRC
 
             if (FlashInit() == false) {
                 break;
             }
 
-            for (size_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
-                size_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
+            size_t chunk = (with_crc) ? DL_CHUNK_DATA_SIZE : PM3_CMD_DATA_SIZE;
+            for (size_t i = 0; i < numofbytes; i += chunk) {
+                size_t len = MIN((numofbytes - i), chunk);
                 Flash_CheckBusy(BUSY_TIMEOUT);
                 bool isok = Flash_ReadDataCont(startidx + i, mem, len);
                 if (isok == false)
                     Dbprintf("reading flash memory failed ::  | bytes between %d - %d", i, len);
 
-                isok = reply_old(CMD_FLASHMEM_DOWNLOADED, i, len, 0, mem, len);
+                if (with_crc)
+                    isok = reply_dl_chunk(CMD_FLASHMEM_DOWNLOADED, startidx + i, mem, len);
+                else
+                    isok = reply_old(CMD_FLASHMEM_DOWNLOADED, i, len, 0, mem, len);
                 if (isok != 0)
                     Dbprintf("transfer to client failed ::  | bytes between %d - %d", i, len);
             }
@@ -161,6 +161,17 @@ int reply_reason(uint16_t cmd, int8_t status, int8_t reason, const uint8_t *data
     return reply_ng_internal(cmd, status, reason, data, len, true);
 }
 
+// one chunk of a device memory download, see DL_FLAG_CHUNK_CRC
+int reply_dl_chunk(uint16_t cmd, uint32_t offset, const uint8_t *data, size_t len) {
+    dl_chunk_t chunk;
+    len = MIN(len, DL_CHUNK_DATA_SIZE);
+    chunk.offset = offset;
+    chunk.len = len;
+    chunk.crc = crc16_xmodem(data, len);
+    memcpy(chunk.data, data, len);
+    return reply_ng_internal(cmd, PM3_SUCCESS, PM3_REASON_UNKNOWN, (uint8_t *)&chunk, sizeof(chunk) - DL_CHUNK_DATA_SIZE + len, true);
+}
+
 static int receive_ng_internal(PacketCommandNG *rx, uint32_t read_ng(uint8_t *data, size_t len), bool usb, bool fpc) {
 
     PacketCommandNGRaw rx_raw;
@@ -31,6 +31,7 @@ int reply_old(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const v
 int reply_ng(uint16_t cmd, int8_t status, const uint8_t *data, size_t len);
 int reply_mix(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len);
 int reply_reason(uint16_t cmd, int8_t status, int8_t reason, const uint8_t *data, size_t len);
+int reply_dl_chunk(uint16_t cmd, uint32_t offset, const uint8_t *data, size_t len);
 int receive_ng(PacketCommandNG *rx);
 
 #endif // _PROXMARK_CMD_H_
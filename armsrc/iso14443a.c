@@ -258,52 +258,16 @@ void GetParity(const uint8_t *pbtCmd, uint16_t len, uint8_t *par) {
 
 
 //=============================================================================
-// ISO 14443 Type A - Miller decoder
+// ISO 14443 Type A - Miller decoder, see iso14443a_decode.h
 //=============================================================================
-// Basics:
-// This decoder is used when the PM3 acts as a tag.
-// The reader will generate "pauses" by temporarily switching of the field.
-// At the PM3 antenna we will therefore measure a modulated antenna voltage.
-// The FPGA does a comparison with a threshold and would deliver e.g.:
-// ........  1 1 1 1 1 1 0 0 1 1 1 1 1 1 1 1 1 1 0 0 1 1 1 1 1 1 1 1 1 1  .......
-// The Miller decoder needs to identify the following sequences:
-// 2 (or 3) ticks pause followed by 6 (or 5) ticks unmodulated: pause at beginning - Sequence Z ("start of communication" or a "0")
-// 8 ticks without a modulation:                                no pause - Sequence Y (a "0" or "end of communication" or "no information")
-// 4 ticks unmodulated followed by 2 (or 3) ticks pause:        pause in second half - Sequence X (a "1")
-// Note 1: the bitstream may start at any time. We therefore need to sync.
-// Note 2: the interpretation of Sequence Y and Z depends on the preceding sequence.
-//-----------------------------------------------------------------------------
 static tUart14a Uart;
 
-// Lookup-Table to decide if 4 raw bits are a modulation.
-// We accept the following:
-// 0001  -   a 3 tick wide pause
-// 0011  -   a 2 tick wide pause, or a three tick wide pause shifted left
-// 0111  -   a 2 tick wide pause shifted left
-// 1001  -   a 2 tick wide pause shifted right
-static const bool Mod_Miller_LUT[] = {
-    false,  true, false, true,  false, false, false, true,
-    false,  true, false, false, false, false, false, false
-};
-#define IsMillerModulationNibble1(b) (Mod_Miller_LUT[(b & 0x000000F0) >> 4])
-#define IsMillerModulationNibble2(b) (Mod_Miller_LUT[(b & 0x0000000F)])
-
 tUart14a *GetUart14a(void) {
     return &Uart;
 }
 
 void Uart14aReset(void) {
-    Uart.state = STATE_14A_UNSYNCD;
-    Uart.bitCount = 0;
-    Uart.len = 0;                       // number of decoded data bytes
-    Uart.parityLen = 0;                 // number of decoded parity bytes
-    Uart.shiftReg = 0;                  // shiftreg to hold decoded data bits
-    Uart.parityBits = 0;                // holds 8 parity bits
-    Uart.startTime = 0;
-    Uart.endTime = 0;
-    Uart.fourBits = 0x00000000;         // clear the buffer for 4 Bits
-    Uart.posCnt = 0;
-    Uart.syncBit = 9999;
+    Uart14aResetEx(&Uart);
 }
 
 void Uart14aInit(uint8_t *d, uint16_t n, uint8_t *par) {
@@ -315,198 +279,19 @@ void Uart14aInit(uint8_t *d, uint16_t n, uint8_t *par) {
 
 // use parameter non_real_time to provide a timestamp. Set to 0 if the decoder should measure real time
 RAMFUNC bool MillerDecoding(uint8_t bit, uint32_t non_real_time) {
-
-    if (Uart.len == Uart.output_len) {
-        return true;
-    }
-
-    Uart.fourBits = (Uart.fourBits << 8) | bit;
-
-    if (Uart.state == STATE_14A_UNSYNCD) {                                           // not yet synced
-        Uart.syncBit = 9999;                                                 // not set
-
-        // 00x11111 2|3 ticks pause followed by 6|5 ticks unmodulated         Sequence Z (a "0" or "start of communication")
-        // 11111111 8 ticks unmodulation                                      Sequence Y (a "0" or "end of communication" or "no information")
-        // 111100x1 4 ticks unmodulated followed by 2|3 ticks pause           Sequence X (a "1")
-
-        // The start bit is one ore more Sequence Y followed by a Sequence Z (... 11111111 00x11111). We need to distinguish from
-        // Sequence X followed by Sequence Y followed by Sequence Z     (111100x1 11111111 00x11111)
-        // we therefore look for a ...xx1111 11111111 00x11111xxxxxx... pattern
-        // (12 '1's followed by 2 '0's, eventually followed by another '0', followed by 5 '1's)
-#define ISO14443A_STARTBIT_MASK       0x07FFEF80                            // mask is    00000111 11111111 11101111 10000000
-#define ISO14443A_STARTBIT_PATTERN    0x07FF8F80                            // pattern is 00000111 11111111 10001111 10000000
-        if ((Uart.fourBits & (ISO14443A_STARTBIT_MASK >> 0)) == ISO14443A_STARTBIT_PATTERN >> 0) Uart.syncBit = 7;
-        else if ((Uart.fourBits & (ISO14443A_STARTBIT_MASK >> 1)) == ISO14443A_STARTBIT_PATTERN >> 1) Uart.syncBit = 6;
-        else if ((Uart.fourBits & (ISO14443A_STARTBIT_MASK >> 2)) == ISO14443A_STARTBIT_PATTERN >> 2) Uart.syncBit = 5;
-        else if ((Uart.fourBits & (ISO14443A_STARTBIT_MASK >> 3)) == ISO14443A_STARTBIT_PATTERN >> 3) Uart.syncBit = 4;
-        else if ((Uart.fourBits & (ISO14443A_STARTBIT_MASK >> 4)) == ISO14443A_STARTBIT_PATTERN >> 4) Uart.syncBit = 3;
-        else if ((Uart.fourBits & (ISO14443A_STARTBIT_MASK >> 5)) == ISO14443A_STARTBIT_PATTERN >> 5) Uart.syncBit = 2;
-        else if ((Uart.fourBits & (ISO14443A_STARTBIT_MASK >> 6)) == ISO14443A_STARTBIT_PATTERN >> 6) Uart.syncBit = 1;
-        else if ((Uart.fourBits & (ISO14443A_STARTBIT_MASK >> 7)) == ISO14443A_STARTBIT_PATTERN >> 7) Uart.syncBit = 0;
-
-        if (Uart.syncBit != 9999) {                                              // found a sync bit
-            Uart.startTime = (non_real_time) ? non_real_time : (GetCountSspClk() & 0xfffffff8);
-            Uart.startTime -= Uart.syncBit;
-            Uart.endTime = Uart.startTime;
-            Uart.state = STATE_14A_START_OF_COMMUNICATION;
-        }
-
-    } else {
-
-        if (IsMillerModulationNibble1(Uart.fourBits >> Uart.syncBit)) {
-
-            if (IsMillerModulationNibble2(Uart.fourBits >> Uart.syncBit)) {      // Modulation in both halves - error
-                Uart14aReset();
-            } else {                                                             // Modulation in first half = Sequence Z = logic "0"
-
-                if (Uart.state == STATE_14A_MILLER_X) {                              // error - must not follow after X
-                    Uart14aReset();
-                } else {
-                    Uart.bitCount++;
-                    Uart.shiftReg = (Uart.shiftReg >> 1);                        // add a 0 to the shiftreg
-                    Uart.state = STATE_14A_MILLER_Z;
-                    Uart.endTime = Uart.startTime + 8 * (9 * Uart.len + Uart.bitCount + 1) - 6;
-
-                    if (Uart.bitCount >= 9) {                                    // if we decoded a full byte (including parity)
-                        Uart.output[Uart.len++] = (Uart.shiftReg & 0xff);
-                        Uart.parityBits <<= 1;                                   // make room for the parity bit
-                        Uart.parityBits |= ((Uart.shiftReg >> 8) & 0x01);        // store parity bit
-                        Uart.bitCount = 0;
-                        Uart.shiftReg = 0;
-                        if ((Uart.len & 0x0007) == 0) {                          // every 8 data bytes
-                            Uart.parity[Uart.parityLen++] = Uart.parityBits;     // store 8 parity bits
-                            Uart.parityBits = 0;
-                        }
-                    }
-                }
-            }
-        } else {
-
-            if (IsMillerModulationNibble2(Uart.fourBits >> Uart.syncBit)) {      // Modulation second half = Sequence X = logic "1"
-
-                Uart.bitCount++;
-                Uart.shiftReg = (Uart.shiftReg >> 1) | 0x100;                    // add a 1 to the shiftreg
-                Uart.state = STATE_14A_MILLER_X;
-                Uart.endTime = Uart.startTime + 8 * (9 * Uart.len + Uart.bitCount + 1) - 2;
-
-                if (Uart.bitCount >= 9) {                                        // if we decoded a full byte (including parity)
-
-                    Uart.output[Uart.len++] = (Uart.shiftReg & 0xff);
-                    Uart.parityBits <<= 1;                                       // make room for the new parity bit
-                    Uart.parityBits |= ((Uart.shiftReg >> 8) & 0x01);            // store parity bit
-                    Uart.bitCount = 0;
-                    Uart.shiftReg = 0;
-
-                    if ((Uart.len & 0x0007) == 0) {                              // every 8 data bytes
-                        Uart.parity[Uart.parityLen++] = Uart.parityBits;         // store 8 parity bits
-                        Uart.parityBits = 0;
-                    }
-                }
-
-            } else {                                                             // no modulation in both halves - Sequence Y
-
-                if (Uart.state == STATE_14A_MILLER_Z || Uart.state == STATE_14A_MILLER_Y) {    // Y after logic "0" - End of Communication
-
-                    Uart.state = STATE_14A_UNSYNCD;
-                    Uart.bitCount--;                                             // last "0" was part of EOC sequence
-                    Uart.shiftReg <<= 1;                                         // drop it
-
-                    if (Uart.bitCount > 0) {                                     // if we decoded some bits
-                        Uart.shiftReg >>= (9 - Uart.bitCount);                   // right align them
-                        Uart.output[Uart.len++] = (Uart.shiftReg & 0xff);        // add last byte to the output
-                        Uart.parityBits <<= 1;                                   // add a (void) parity bit
-                        Uart.parityBits <<= (8 - (Uart.len & 0x0007));           // left align parity bits
-                        Uart.parity[Uart.parityLen++] = Uart.parityBits;         // and store it
-                        return true;
-                    }
-
-                    if (Uart.len & 0x0007) {                                     // there are some parity bits to store
-                        Uart.parityBits <<= (8 - (Uart.len & 0x0007));           // left align remaining parity bits
-                        Uart.parity[Uart.parityLen++] = Uart.parityBits;         // and store them
-                    }
-
-                    if (Uart.len) {
-                        return true;                                             // we are finished with decoding the raw data sequence
-                    } else {
-                        Uart14aReset();                                             // Nothing received - start over
-                        return false;
-                    }
-                }
-
-                if (Uart.state == STATE_14A_START_OF_COMMUNICATION) {                // error - must not follow directly after SOC
-                    Uart14aReset();
-                } else {                                                         // a logic "0"
-
-                    Uart.bitCount++;
-                    Uart.shiftReg >>= 1;                                         // add a 0 to the shiftreg
-                    Uart.state = STATE_14A_MILLER_Y;
-
-                    if (Uart.bitCount >= 9) {                                    // if we decoded a full byte (including parity)
-
-                        Uart.output[Uart.len++] = (Uart.shiftReg & 0xff);
-                        Uart.parityBits <<= 1;                                   // make room for the parity bit
-                        Uart.parityBits |= ((Uart.shiftReg >> 8) & 0x01);        // store parity bit
-                        Uart.bitCount = 0;
-                        Uart.shiftReg = 0;
-
-                        // Every 8 data bytes, store 8 parity bits into a parity byte
-                        if ((Uart.len & 0x0007) == 0) {                          // every 8 data bytes
-                            Uart.parity[Uart.parityLen++] = Uart.parityBits;     // store 8 parity bits
-                            Uart.parityBits = 0;
-                        }
-                    }
-                }
-            }
-        }
-    }
-    return false;    // not finished yet, need more data
+    return MillerDecodingEx(&Uart, bit, non_real_time);
 }
 
 //=============================================================================
-// ISO 14443 Type A - Manchester decoder
+// ISO 14443 Type A - Manchester decoder, see iso14443a_decode.h
 //=============================================================================
-// Basics:
-// This decoder is used when the PM3 acts as a reader.
-// The tag will modulate the reader field by asserting different loads to it. As a consequence, the voltage
-// at the reader antenna will be modulated as well. The FPGA detects the modulation for us and would deliver e.g. the following:
-// ........ 0 0 1 1 1 1 0 0 0 0 0 0 0 0 1 1 1 1 1 1 1 1 0 0 0 0 0 0 0 0 0 0 0 0 0 0 .......
-// The Manchester decoder needs to identify the following sequences:
-// 4 ticks modulated followed by 4 ticks unmodulated:     Sequence D = 1 (also used as "start of communication")
-// 4 ticks unmodulated followed by 4 ticks modulated:     Sequence E = 0
-// 8 ticks unmodulated:                                   Sequence F = end of communication
-// 8 ticks modulated:                                     A collision. Save the collision position and treat as Sequence D
-// Note 1: the bitstream may start at any time. We therefore need to sync.
-// Note 2: parameter offset is used to determine the position of the parity bits (required for the anticollision command only)
 static tDemod14a Demod;
 
-// Lookup-Table to decide if 4 raw bits are a modulation.
-// We accept three or four "1" in any position
-static const bool Mod_Manchester_LUT[] = {
-    false, false, false, false, false, false, false, true,
-    false, false, false, true,  false, true,  true,  true
-};
-
-#define IsManchesterModulationNibble1(b) (Mod_Manchester_LUT[(b & 0x00F0) >> 4])
-#define IsManchesterModulationNibble2(b) (Mod_Manchester_LUT[(b & 0x000F)])
-
 tDemod14a *GetDemod14a(void) {
     return &Demod;
 }
 void Demod14aReset(void) {
-    Demod.state = DEMOD_14A_UNSYNCD;
-    Demod.twoBits = 0xFFFF;              // buffer for 2 Bits
-    Demod.highCnt = 0;
-    Demod.bitCount = 0;
-    Demod.collisionPos = 0;              // Position of collision bit
-    Demod.syncBit = 0xFFFF;
-    Demod.parityBits = 0;
-    Demod.parityLen = 0;
-    Demod.shiftReg = 0;                  // shiftreg to hold decoded data bits
-    Demod.samples = 0;
-    Demod.len = 0;                       // number of decoded data bytes
-    Demod.startTime = 0;
-    Demod.endTime = 0;
-    Demod.samples = 0;
+    Demod14aResetEx(&Demod);
 }
 
 void Demod14aInit(uint8_t *d, uint16_t n, uint8_t *par) {
@@ -518,102 +303,9 @@ void Demod14aInit(uint8_t *d, uint16_t n, uint8_t *par) {
 
 // use parameter non_real_time to provide a timestamp. Set to 0 if the decoder should measure real time
 RAMFUNC int ManchesterDecoding(uint8_t bit, uint16_t offset, uint32_t non_real_time) {
-
-    if (Demod.len == Demod.output_len) {
-        return true;
-    }
-
-    Demod.twoBits = (Demod.twoBits << 8) | bit;
-
-    if (Demod.state == DEMOD_14A_UNSYNCD) {
-
-        if (Demod.highCnt < 2) {                                            // wait for a stable unmodulated signal
-            if (Demod.twoBits == 0x0000) {
-                Demod.highCnt++;
-            } else {
-                Demod.highCnt = 0;
-            }
-        } else {
-            Demod.syncBit = 0xFFFF;            // not set
-            if ((Demod.twoBits & 0x7700) == 0x7000) Demod.syncBit = 7;
-            else if ((Demod.twoBits & 0x3B80) == 0x3800) Demod.syncBit = 6;
-            else if ((Demod.twoBits & 0x1DC0) == 0x1C00) Demod.syncBit = 5;
-            else if ((Demod.twoBits & 0x0EE0) == 0x0E00) Demod.syncBit = 4;
-            else if ((Demod.twoBits & 0x0770) == 0x0700) Demod.syncBit = 3;
-            else if ((Demod.twoBits & 0x03B8) == 0x0380) Demod.syncBit = 2;
-            else if ((Demod.twoBits & 0x01DC) == 0x01C0) Demod.syncBit = 1;
-            else if ((Demod.twoBits & 0x00EE) == 0x00E0) Demod.syncBit = 0;
-            if (Demod.syncBit != 0xFFFF) {
-                Demod.startTime = non_real_time ? non_real_time : (GetCountSspClk() & 0xfffffff8);
-                Demod.startTime -= Demod.syncBit;
-                Demod.bitCount = offset;            // number of decoded data bits
-                Demod.state = DEMOD_14A_MANCHESTER_DATA;
-            }
-        }
-    } else {
-
-        if (IsManchesterModulationNibble1(Demod.twoBits >> Demod.syncBit)) {      // modulation in first half
-            if (IsManchesterModulationNibble2(Demod.twoBits >> Demod.syncBit)) {  // ... and in second half = collision
-                if (Demod.collisionPos == 0) {
-                    Demod.collisionPos = (Demod.len << 3) + Demod.bitCount;
-                }
-            }                                                           // modulation in first half only - Sequence D = 1
-            Demod.bitCount++;
-            Demod.shiftReg = (Demod.shiftReg >> 1) | 0x100;             // in both cases, add a 1 to the shiftreg
-            if (Demod.bitCount == 9) {                                  // if we decoded a full byte (including parity)
-                Demod.output[Demod.len++] = (Demod.shiftReg & 0xff);
-                Demod.parityBits <<= 1;                                 // make room for the parity bit
-                Demod.parityBits |= ((Demod.shiftReg >> 8) & 0x01);     // store parity bit
-                Demod.bitCount = 0;
-                Demod.shiftReg = 0;
-                if ((Demod.len & 0x0007) == 0) {                        // every 8 data bytes
-                    Demod.parity[Demod.parityLen++] = Demod.parityBits; // store 8 parity bits
-                    Demod.parityBits = 0;
-                }
-            }
-            Demod.endTime = Demod.startTime + 8 * (9 * Demod.len + Demod.bitCount + 1) - 4;
-        } else {                                                        // no modulation in first half
-            if (IsManchesterModulationNibble2(Demod.twoBits >> Demod.syncBit)) {    // and modulation in second half = Sequence E = 0
-                Demod.bitCount++;
-                Demod.shiftReg = (Demod.shiftReg >> 1);                 // add a 0 to the shiftreg
-                if (Demod.bitCount >= 9) {                              // if we decoded a full byte (including parity)
-                    Demod.output[Demod.len++] = (Demod.shiftReg & 0xff);
-                    Demod.parityBits <<= 1;                             // make room for the new parity bit
-                    Demod.parityBits |= ((Demod.shiftReg >> 8) & 0x01); // store parity bit
-                    Demod.bitCount = 0;
-                    Demod.shiftReg = 0;
-                    if ((Demod.len & 0x0007) == 0) {                    // every 8 data bytes
-                        Demod.parity[Demod.parityLen++] = Demod.parityBits;    // store 8 parity bits1
-                        Demod.parityBits = 0;
-                    }
-                }
-                Demod.endTime = Demod.startTime + 8 * (9 * Demod.len + Demod.bitCount + 1);
-            } else {                                                    // no modulation in both halves - End of communication
-
-                if (Demod.bitCount > 0) {                               // there are some remaining data bits
-                    Demod.shiftReg >>= (9 - Demod.bitCount);            // right align the decoded bits
-                    Demod.output[Demod.len++] = Demod.shiftReg & 0xff;  // and add them to the output
-                    Demod.parityBits <<= 1;                             // add a (void) parity bit
-                    Demod.parityBits <<= (8 - (Demod.len & 0x0007));    // left align remaining parity bits
-                    Demod.parity[Demod.parityLen++] = Demod.parityBits; // and store them
-                    return true;
-                } else if (Demod.len & 0x0007) {                        // there are some parity bits to store
-                    Demod.parityBits <<= (8 - (Demod.len & 0x0007));    // left align remaining parity bits
-                    Demod.parity[Demod.parityLen++] = Demod.parityBits; // and store them
-                }
-
-                if (Demod.len) {
-                    return true;                                        // we are finished with decoding the raw data sequence
-                } else {                                                // nothing received. Start over
-                    Demod14aReset();
-                }
-            }
-        }
-    }
-    return false;    // not finished yet, need more data
+    return ManchesterDecodingEx(&Demod, bit, offset, non_real_time);
 }
 
-
 // Thinfilm, Kovio mangles ISO14443A in the way that they don't use start bit nor parity bits.
 static RAMFUNC int ManchesterDecoding_Thinfilm(uint8_t bit) {
 
@@ -73,6 +73,7 @@
 #include "ticks.h"
 #include "BigBuf.h"
 #include "crc16.h"
+#include "iso15693_decode.h"
 
 // Delays in SSP_CLK ticks.
 // SSP_CLK runs at 13,56MHz / 32 = 423.75kHz when simulating a tag
@@ -394,581 +395,6 @@ void TransmitTo15693Reader(const uint8_t *cmd, size_t len, uint32_t *start_time,
     LED_C_OFF();
 }
 
-//=============================================================================
-// An ISO 15693 decoder for tag responses (one subcarrier only).
-// Uses cross correlation to identify each bit and EOF.
-// This function is called 8 times per bit (every 2 subcarrier cycles).
-// Subcarrier frequency fs is 424kHz, 1/fs = 2,36us,
-// i.e. function is called every 4,72us
-// LED handling:
-//    LED C -> ON once we have received the SOF and are expecting the rest.
-//    LED C -> OFF once we have received EOF or are unsynced
-//
-// Returns: true if we received a EOF
-//          false if we are still waiting for some more
-//=============================================================================
-
-#define NOISE_THRESHOLD          80                   // don't try to correlate noise
-#define MAX_PREVIOUS_AMPLITUDE   (-1 - NOISE_THRESHOLD)
-
-typedef struct {
-    enum {
-        STATE_TAG_SOF_LOW,
-        STATE_TAG_SOF_RISING_EDGE,
-        STATE_TAG_SOF_HIGH,
-        STATE_TAG_SOF_HIGH_END,
-        STATE_TAG_RECEIVING_DATA,
-        STATE_TAG_EOF,
-        STATE_TAG_EOF_TAIL
-    } state;
-    int bitCount;
-    int posCount;
-    enum {
-        LOGIC0,
-        LOGIC1,
-        SOF_PART1,
-        SOF_PART2
-    } lastBit;
-    uint16_t shiftReg;
-    uint16_t max_len;
-    uint16_t len;
-    int sum1;
-    int sum2;
-    int threshold_sof;
-    int threshold_half;
-    uint16_t previous_amplitude;
-    uint8_t *output;
-} DecodeTag_t;
-
-//-----------------------------------------------------------------------------
-// DEMODULATE tag answer
-//-----------------------------------------------------------------------------
-static RAMFUNC int Handle15693SamplesFromTag(uint16_t amplitude, DecodeTag_t *tag, bool recv_speed) {
-
-    switch (tag->state) {
-
-        case STATE_TAG_SOF_LOW: {
-            // waiting for a rising edge
-            if (amplitude > NOISE_THRESHOLD + tag->previous_amplitude) {
-                if (tag->posCount > 10) {
-                    tag->threshold_sof = amplitude - tag->previous_amplitude; // to be divided by 2
-                    tag->threshold_half = 0;
-                    tag->state = STATE_TAG_SOF_RISING_EDGE;
-                } else {
-                    tag->posCount = 0;
-                }
-            } else {
-                tag->posCount++;
-                tag->previous_amplitude = amplitude;
-            }
-            break;
-        }
-
-        case STATE_TAG_SOF_RISING_EDGE: {
-            if (amplitude > tag->threshold_sof + tag->previous_amplitude) { // edge still rising
-                if (amplitude > tag->threshold_sof + tag->threshold_sof) { // steeper edge, take this as time reference
-                    tag->posCount = 1;
-                } else {
-                    tag->posCount = 2;
-                }
-                tag->threshold_sof = (amplitude - tag->previous_amplitude) / 2;
-            } else {
-                tag->posCount = 2;
-                tag->threshold_sof = tag->threshold_sof / 2;
-            }
-            tag->state = STATE_TAG_SOF_HIGH;
-            break;
-        }
-
-        case STATE_TAG_SOF_HIGH: {
-            // waiting for 10 times high. Take average over the last 8
-            if (amplitude > tag->threshold_sof) {
-                tag->posCount++;
-                if (tag->posCount > 2) {
-                    tag->threshold_half += amplitude; // keep track of average high value
-                }
-                if (tag->posCount == (recv_speed ? 10 : 40)) {
-                    tag->threshold_half >>= 2; // (4 times 1/2 average)
-                    tag->state = STATE_TAG_SOF_HIGH_END;
-                }
-            } else { // high phase was too short
-                tag->posCount = 1;
-                tag->previous_amplitude = amplitude;
-                tag->state = STATE_TAG_SOF_LOW;
-            }
-            break;
-        }
-
-        case STATE_TAG_SOF_HIGH_END: {
-            // check for falling edge
-            if (tag->posCount == (recv_speed ? 13 : 52) && amplitude < tag->threshold_sof) {
-                tag->lastBit = SOF_PART1;  // detected 1st part of SOF (12 samples low and 12 samples high)
-                tag->shiftReg = 0;
-                tag->bitCount = 0;
-                tag->len = 0;
-                tag->sum1 = amplitude;
-                tag->sum2 = 0;
-                tag->posCount = 2;
-                tag->state = STATE_TAG_RECEIVING_DATA;
-                LED_C_ON();
-            } else {
-                tag->posCount++;
-                if (tag->posCount > (recv_speed ? 13 : 52)) { // high phase too long
-                    tag->posCount = 0;
-                    tag->previous_amplitude = amplitude;
-                    tag->state = STATE_TAG_SOF_LOW;
-                    LED_C_OFF();
-                }
-            }
-            break;
-        }
-
-        case STATE_TAG_RECEIVING_DATA: {
-            if (tag->posCount == 1) {
-                tag->sum1 = 0;
-                tag->sum2 = 0;
-            }
-
-            if (tag->posCount <= (recv_speed ? 4 : 16)) {
-                tag->sum1 += amplitude;
-            } else {
-                tag->sum2 += amplitude;
-            }
-
-            if (tag->posCount == (recv_speed ? 8 : 32)) {
-                if (tag->sum1 > tag->threshold_half && tag->sum2 > tag->threshold_half) { // modulation in both halves
-                    if (tag->lastBit == LOGIC0) {  // this was already part of EOF
-                        tag->state = STATE_TAG_EOF;
-                    } else {
-                        tag->posCount = 0;
-                        tag->previous_amplitude = amplitude;
-                        tag->state = STATE_TAG_SOF_LOW;
-                        LED_C_OFF();
-                    }
-                } else if (tag->sum1 < tag->threshold_half && tag->sum2 > tag->threshold_half) { // modulation in second half
-                    // logic 1
-                    if (tag->lastBit == SOF_PART1) { // still part of SOF
-                        tag->lastBit = SOF_PART2;    // SOF completed
-                    } else {
-                        tag->lastBit = LOGIC1;
-                        tag->shiftReg >>= 1;
-                        tag->shiftReg |= 0x80;
-                        tag->bitCount++;
-                        if (tag->bitCount == 8) {
-                            tag->output[tag->len] = tag->shiftReg & 0xFF;
-                            tag->len++;
-
-                            if (tag->len > tag->max_len) {
-                                // buffer overflow, give up
-                                LED_C_OFF();
-                                return true;
-                            }
-                            tag->bitCount = 0;
-                            tag->shiftReg = 0;
-                        }
-                    }
-                } else if (tag->sum1 > tag->threshold_half && tag->sum2 < tag->threshold_half) { // modulation in first half
-                    // logic 0
-                    if (tag->lastBit == SOF_PART1) { // incomplete SOF
-                        tag->posCount = 0;
-                        tag->previous_amplitude = amplitude;
-                        tag->state = STATE_TAG_SOF_LOW;
-                        LED_C_OFF();
-                    } else {
-                        tag->lastBit = LOGIC0;
-                        tag->shiftReg >>= 1;
-                        tag->bitCount++;
-
-                        if (tag->bitCount == 8) {
-                            tag->output[tag->len] = (tag->shiftReg & 0xFF);
-                            tag->len++;
-
-                            if (tag->len > tag->max_len) {
-                                // buffer overflow, give up
-                                tag->posCount = 0;
-                                tag->previous_amplitude = amplitude;
-                                tag->state = STATE_TAG_SOF_LOW;
-                                LED_C_OFF();
-                            }
-                            tag->bitCount = 0;
-                            tag->shiftReg = 0;
-                        }
-                    }
-                } else { // no modulation
-                    if (tag->lastBit == SOF_PART2) { // only SOF (this is OK for iClass)
-                        LED_C_OFF();
-                        return true;
-                    } else {
-                        tag->posCount = 0;
-                        tag->state = STATE_TAG_SOF_LOW;
-                        LED_C_OFF();
-                    }
-                }
-                tag->posCount = 0;
-            }
-            tag->posCount++;
-            break;
-        }
-
-        case STATE_TAG_EOF: {
-            if (tag->posCount == 1) {
-                tag->sum1 = 0;
-                tag->sum2 = 0;
-            }
-
-            if (tag->posCount <= (recv_speed ? 4 : 16)) {
-                tag->sum1 += amplitude;
-            } else {
-                tag->sum2 += amplitude;
-            }
-
-            if (tag->posCount == (recv_speed ? 8 : 32)) {
-                if (tag->sum1 > tag->threshold_half && tag->sum2 < tag->threshold_half) { // modulation in first half
-                    tag->posCount = 0;
-                    tag->state = STATE_TAG_EOF_TAIL;
-                } else {
-                    tag->posCount = 0;
-                    tag->previous_amplitude = amplitude;
-                    tag->state = STATE_TAG_SOF_LOW;
-                    LED_C_OFF();
-                }
-            }
-            tag->posCount++;
-            break;
-        }
-
-        case STATE_TAG_EOF_TAIL: {
-            if (tag->posCount == 1) {
-                tag->sum1 = 0;
-                tag->sum2 = 0;
-            }
-
-            if (tag->posCount <= (recv_speed ? 4 : 16)) {
-                tag->sum1 += amplitude;
-            } else {
-                tag->sum2 += amplitude;
-            }
-
-            if (tag->posCount == (recv_speed ? 8 : 32)) {
-                if (tag->sum1 < tag->threshold_half && tag->sum2 < tag->threshold_half) { // no modulation in both halves
-                    LED_C_OFF();
-                    return true;
-                } else {
-                    tag->posCount = 0;
-                    tag->previous_amplitude = amplitude;
-                    tag->state = STATE_TAG_SOF_LOW;
-                    LED_C_OFF();
-                }
-            }
-            tag->posCount++;
-            break;
-        }
-    }
-
-    return false;
-}
-
-static void DecodeTagReset(DecodeTag_t *tag) {
-    tag->posCount = 0;
-    tag->state = STATE_TAG_SOF_LOW;
-    tag->previous_amplitude = MAX_PREVIOUS_AMPLITUDE;
-}
-
-static void DecodeTagInit(DecodeTag_t *tag, uint8_t *data, uint16_t max_len) {
-    tag->output = data;
-    tag->max_len = max_len;
-    DecodeTagReset(tag);
-}
-
-//=============================================================================
-// An ISO 15693 decoder for tag responses in FSK (two subcarriers) mode.
-// Subcarriers frequencies are 424kHz and 484kHz (fc/32 and fc/28),
-// LED handling:
-//    LED C -> ON once we have received the SOF and are expecting the rest.
-//    LED C -> OFF once we have received EOF or are unsynced
-//
-// Returns: true if we received a EOF
-//          false if we are still waiting for some more
-//=============================================================================
-//#define DEBUG 1
-#define FREQ_IS_484(f)    ((f & 1) == 1)   //(f >= 26 && f <= 30)
-#define FREQ_IS_424(f)    ((f & 2) == 2)   //(f >= 30 && f <= 34)
-#define FREQ_IS_0(f)      ((f & 3) == 0)   // (f <= 24 || f >= 36)
-#define SEOF_COUNT(c, s)  ((s) ? (c >= 11 && c <= 13) : (c >= 45 && c <= 51))
-#define LOGIC_COUNT(c, s) ((s) ? (c >= 3 && c <= 6) : (c >= 14 && c <= 20))
-#define MAX_COUNT(c, s)   ((s) ? (c >= 13) : (c >= 52))
-
-typedef struct DecodeTagFSK {
-    enum {
-        STATE_FSK_ERROR,
-        STATE_FSK_BEFORE_SOF,
-        STATE_FSK_SOF_484,
-        STATE_FSK_SOF_424,
-        STATE_FSK_SOF_END_484,
-        STATE_FSK_SOF_END_424,
-        STATE_FSK_RECEIVING_DATA_484,
-        STATE_FSK_RECEIVING_DATA_424,
-        STATE_FSK_EOF
-    }        state;
-    enum {
-        LOGIC0_PART1,
-        LOGIC1_PART1,
-        LOGIC0_PART2,
-        LOGIC1_PART2,
-        SOF
-    }        lastBit;
-    uint8_t  count;
-    uint8_t  bitCount;
-    uint8_t  shiftReg;
-    uint16_t len;
-    uint16_t max_len;
-    uint8_t  *output;
-} DecodeTagFSK_t;
-
-static void DecodeTagFSKReset(DecodeTagFSK_t *DecodeTag) {
-    DecodeTag->state = STATE_FSK_BEFORE_SOF;
-    DecodeTag->bitCount = 0;
-    DecodeTag->len = 0;
-    DecodeTag->shiftReg = 0;
-}
-
-static void DecodeTagFSKInit(DecodeTagFSK_t *DecodeTag, uint8_t *data, uint16_t max_len) {
-    DecodeTag->output = data;
-    DecodeTag->max_len = max_len;
-    DecodeTagFSKReset(DecodeTag);
-}
-
-// Performances of this function are crutial for stability
-// as it is called in real time for every samples
-static int RAMFUNC Handle15693FSKSamplesFromTag(uint8_t freq, DecodeTagFSK_t *DecodeTag, bool recv_speed) {
-    switch (DecodeTag->state) {
-        case STATE_FSK_BEFORE_SOF:
-            if (FREQ_IS_484(freq)) {
-                // possible SOF starting
-                DecodeTag->state = STATE_FSK_SOF_484;
-                DecodeTag->lastBit = LOGIC0_PART1;
-                DecodeTag->count = 1;
-            }
-            break;
-
-        case STATE_FSK_SOF_484:
-            //DbpString("STATE_FSK_SOF_484");
-            if (FREQ_IS_424(freq) && SEOF_COUNT(DecodeTag->count, recv_speed)) {
-                // SOF part1 continue at 424
-                DecodeTag->state = STATE_FSK_SOF_424;
-                DecodeTag->count = 1;
-            } else if (FREQ_IS_484(freq) && !MAX_COUNT(DecodeTag->count, recv_speed)) { // still in SOF at 484
-                DecodeTag->count++;
-            } else { // SOF failed, roll back
-                DecodeTag->state = STATE_FSK_BEFORE_SOF;
-            }
-            break;
-
-        case STATE_FSK_SOF_424:
-            //DbpString("STATE_FSK_SOF_424");
-            if (FREQ_IS_484(freq) && SEOF_COUNT(DecodeTag->count, recv_speed)) {
-                // SOF part 1 finished
-                DecodeTag->state = STATE_FSK_SOF_END_484;
-                DecodeTag->count = 1;
-            } else if (FREQ_IS_424(freq) && !MAX_COUNT(DecodeTag->count, recv_speed)) // still in SOF at 424
-                DecodeTag->count++;
-            else { // SOF failed, roll back
-#ifdef DEBUG
-                if (DEBUG)
-                    Dbprintf("SOF_424 failed: freq=%d, count=%d, recv_speed=%d", freq, DecodeTag->count, recv_speed);
-#endif
-                DecodeTag->state = STATE_FSK_BEFORE_SOF;
-            }
-            break;
-
-        case STATE_FSK_SOF_END_484:
-            if (FREQ_IS_424(freq) && LOGIC_COUNT(DecodeTag->count, recv_speed)) {
-                DecodeTag->state = STATE_FSK_SOF_END_424;
-                DecodeTag->count = 1;
-            } else if (FREQ_IS_484(freq) && !MAX_COUNT(DecodeTag->count, recv_speed)) // still in SOF_END_484
-                DecodeTag->count++;
-            else { // SOF failed, roll back
-#ifdef DEBUG
-                if (DEBUG)
-                    Dbprintf("SOF_END_484 failed: freq=%d, count=%d, recv_speed=%d", freq, DecodeTag->count, recv_speed);
-#endif
-                DecodeTag->state = STATE_FSK_BEFORE_SOF;
-            }
-            break;
-        case STATE_FSK_SOF_END_424:
-            if (FREQ_IS_484(freq) && LOGIC_COUNT(DecodeTag->count, recv_speed)) {
-                // SOF finished at 484
-                DecodeTag->count = 1;
-                DecodeTag->lastBit = SOF;
-                DecodeTag->state = STATE_FSK_RECEIVING_DATA_484;
-                LED_C_ON();
-            } else if (FREQ_IS_424(freq) && LOGIC_COUNT(DecodeTag->count - 2, recv_speed)) {
-                // SOF finished at 424 (wait count+2 to be sure that next freq is 424)
-                DecodeTag->count = 2;
-                DecodeTag->lastBit = SOF;
-                DecodeTag->state = STATE_FSK_RECEIVING_DATA_424;
-                LED_C_ON();
-            } else if (FREQ_IS_424(freq) && !MAX_COUNT(DecodeTag->count, recv_speed)) // still in SOF_END_424
-                DecodeTag->count++;
-            else { // SOF failed, roll back
-#ifdef DEBUG
-                if (DEBUG)
-                    Dbprintf("SOF_END_424 failed: freq=%d, count=%d, recv_speed=%d", freq, DecodeTag->count, recv_speed);
-#endif
-                DecodeTag->state = STATE_FSK_BEFORE_SOF;
-            }
-            break;
-
-
-        case STATE_FSK_RECEIVING_DATA_424:
-            if (FREQ_IS_484(freq) && LOGIC_COUNT(DecodeTag->count, recv_speed)) {
-                if (DecodeTag->lastBit == LOGIC1_PART1) {
-                    // logic 1 finished, goto 484
-                    DecodeTag->lastBit = LOGIC1_PART2;
-
-                    DecodeTag->shiftReg >>= 1;
-                    DecodeTag->shiftReg |= 0x80;
-                    DecodeTag->bitCount++;
-                    if (DecodeTag->bitCount == 8) {
-                        DecodeTag->output[DecodeTag->len++] = DecodeTag->shiftReg;
-                        if (DecodeTag->len > DecodeTag->max_len) {
-                            // buffer overflow, give up
-                            LED_C_OFF();
-                            return true;
-                        }
-                        DecodeTag->bitCount = 0;
-                        DecodeTag->shiftReg = 0;
-                    }
-                } else {
-                    // end of LOGIC0_PART1
-                    DecodeTag->lastBit = LOGIC0_PART1;
-                }
-                DecodeTag->count = 1;
-                DecodeTag->state = STATE_FSK_RECEIVING_DATA_484;
-            } else if (FREQ_IS_424(freq) && LOGIC_COUNT(DecodeTag->count - 2, recv_speed) &&
-                       DecodeTag->lastBit == LOGIC1_PART1) {
-                // logic 1 finished, stay in 484
-                DecodeTag->lastBit = LOGIC1_PART2;
-
-                DecodeTag->shiftReg >>= 1;
-                DecodeTag->shiftReg |= 0x80;
-                DecodeTag->bitCount++;
-                if (DecodeTag->bitCount == 8) {
-                    DecodeTag->output[DecodeTag->len++] = DecodeTag->shiftReg;
-                    if (DecodeTag->len > DecodeTag->max_len) {
-                        // buffer overflow, give up
-                        LED_C_OFF();
-                        return true;
-                    }
-                    DecodeTag->bitCount = 0;
-                    DecodeTag->shiftReg = 0;
-                }
-                DecodeTag->count = 2;
-            } else if (FREQ_IS_424(freq) && !MAX_COUNT(DecodeTag->count, recv_speed)) // still at 424
-                DecodeTag->count++;
-
-            else if (FREQ_IS_484(freq) && DecodeTag->lastBit == LOGIC0_PART2 &&
-                     SEOF_COUNT(DecodeTag->count, recv_speed)) {
-                // EOF has started
-#ifdef DEBUG
-                if (DEBUG)
-                    Dbprintf("RECEIVING_DATA_424->EOF: freq=%d, count=%d, recv_speed=%d, lastbit=%d, state=%d", freq, DecodeTag->count, recv_speed, DecodeTag->lastBit, DecodeTag->state);
-#endif
-                DecodeTag->count = 1;
-                DecodeTag->state = STATE_FSK_EOF;
-                LED_C_OFF();
-            } else { // error
-#ifdef DEBUG
-                if (DEBUG)
-                    Dbprintf("RECEIVING_DATA_424 error: freq=%d, count=%d, recv_speed=%d, lastbit=%d, state=%d", freq, DecodeTag->count, recv_speed, DecodeTag->lastBit, DecodeTag->state);
-#endif
-                DecodeTag->state = STATE_FSK_ERROR;
-                LED_C_OFF();
-                return true;
-            }
-            break;
-
-        case STATE_FSK_RECEIVING_DATA_484:
-            if (FREQ_IS_424(freq) && LOGIC_COUNT(DecodeTag->count, recv_speed)) {
-                if (DecodeTag->lastBit == LOGIC0_PART1) {
-                    // logic 0 finished, goto 424
-                    DecodeTag->lastBit = LOGIC0_PART2;
-
-                    DecodeTag->shiftReg >>= 1;
-                    DecodeTag->bitCount++;
-                    if (DecodeTag->bitCount == 8) {
-                        DecodeTag->output[DecodeTag->len++] = DecodeTag->shiftReg;
-                        if (DecodeTag->len > DecodeTag->max_len) {
-                            // buffer overflow, give up
-                            LED_C_OFF();
-                            return true;
-                        }
-                        DecodeTag->bitCount = 0;
-                        DecodeTag->shiftReg = 0;
-                    }
-                } else {
-                    // end of LOGIC1_PART1
-                    DecodeTag->lastBit = LOGIC1_PART1;
-                }
-                DecodeTag->count = 1;
-                DecodeTag->state = STATE_FSK_RECEIVING_DATA_424;
-            } else if (FREQ_IS_484(freq) && LOGIC_COUNT(DecodeTag->count - 2, recv_speed) &&
-                       DecodeTag->lastBit == LOGIC0_PART1) {
-                // logic 0 finished, stay in 424
-                DecodeTag->lastBit = LOGIC0_PART2;
-
-                DecodeTag->shiftReg >>= 1;
-                DecodeTag->bitCount++;
-                if (DecodeTag->bitCount == 8) {
-                    DecodeTag->output[DecodeTag->len++] = DecodeTag->shiftReg;
-                    if (DecodeTag->len > DecodeTag->max_len) {
-                        // buffer overflow, give up
-                        LED_C_OFF();
-                        return true;
-                    }
-                    DecodeTag->bitCount = 0;
-                    DecodeTag->shiftReg = 0;
-                }
-                DecodeTag->count = 2;
-            } else if (FREQ_IS_484(freq) && !MAX_COUNT(DecodeTag->count, recv_speed)) // still at 484
-                DecodeTag->count++;
-            else { // error
-#ifdef DEBUG
-                if (DEBUG)
-                    Dbprintf("RECEIVING_DATA_484 error: freq=%d, count=%d, recv_speed=%d, lastbit=%d, state=%d", freq, DecodeTag->count, recv_speed, DecodeTag->lastBit, DecodeTag->state);
-#endif
-                LED_C_OFF();
-                DecodeTag->state = STATE_FSK_ERROR;
-                return true;
-            }
-            break;
-
-        case STATE_FSK_EOF:
-            if (FREQ_IS_484(freq) && !MAX_COUNT(DecodeTag->count, recv_speed)) { // still at 484
-                DecodeTag->count++;
-                if (SEOF_COUNT(DecodeTag->count, recv_speed))
-                    return true; // end of the transmission
-            } else { // error
-#ifdef DEBUG
-                if (DEBUG)
-                    Dbprintf("EOF error: freq=%d, count=%d, recv_speed=%d", freq, DecodeTag->count, recv_speed);
-#endif
-                DecodeTag->state = STATE_FSK_ERROR;
-                return true;
-            }
-            break;
-        case STATE_FSK_ERROR:
-            LED_C_OFF();
-#ifdef DEBUG
-            if (DEBUG)
-                Dbprintf("FSK error: freq=%d, count=%d, recv_speed=%d", freq, DecodeTag->count, recv_speed);
-#endif
-            return true; // error
-            break;
-    }
-    return false;
-}
-
 /*
  *  Receive and decode the tag response, also log to tracebuffer
  */
@@ -1126,347 +552,6 @@ int GetIso15693AnswerFromTag(uint8_t *response, uint16_t max_len, uint16_t timeo
 }
 
 
-//=============================================================================
-// An ISO15693 decoder for reader commands.
-//
-// This function is called 4 times per bit (every 2 subcarrier cycles).
-// Subcarrier frequency fs is 848kHz, 1/fs = 1,18us, i.e. function is called every 2,36us
-// LED handling:
-//    LED B -> ON once we have received the SOF and are expecting the rest.
-//    LED B -> OFF once we have received EOF or are in error state or unsynced
-//
-// Returns: true  if we received a EOF
-//          false if we are still waiting for some more
-//=============================================================================
-
-typedef struct {
-    enum {
-        STATE_READER_UNSYNCD,
-        STATE_READER_AWAIT_1ST_FALLING_EDGE_OF_SOF,
-        STATE_READER_AWAIT_1ST_RISING_EDGE_OF_SOF,
-        STATE_READER_AWAIT_2ND_FALLING_EDGE_OF_SOF,
-        STATE_READER_AWAIT_2ND_RISING_EDGE_OF_SOF,
-        STATE_READER_AWAIT_END_OF_SOF_1_OUT_OF_4,
-        STATE_READER_RECEIVE_DATA_1_OUT_OF_4,
-        STATE_READER_RECEIVE_DATA_1_OUT_OF_256,
-        STATE_READER_RECEIVE_JAMMING
-    }           state;
-    enum {
-        CODING_1_OUT_OF_4,
-        CODING_1_OUT_OF_256
-    }           Coding;
-    uint8_t     shiftReg;
-    uint8_t     bitCount;
-    int         byteCount;
-    int         byteCountMax;
-    int         posCount;
-    int         sum1, sum2;
-    uint8_t     *output;
-    uint8_t     jam_search_len;
-    uint8_t     *jam_search_string;
-} DecodeReader_t;
-
-static void DecodeReaderInit(DecodeReader_t *reader, uint8_t *data, uint16_t max_len, uint8_t jam_search_len, uint8_t *jam_search_string) {
-    reader->output = data;
-    reader->byteCountMax = max_len;
-    reader->state = STATE_READER_UNSYNCD;
-    reader->byteCount = 0;
-    reader->bitCount = 0;
-    reader->posCount = 1;
-    reader->shiftReg = 0;
-    reader->jam_search_len = jam_search_len;
-    reader->jam_search_string = jam_search_string;
-}
-
-static void DecodeReaderReset(DecodeReader_t *reader) {
-    reader->state = STATE_READER_UNSYNCD;
-}
-
-//static inline __attribute__((always_inline))
-static int RAMFUNC Handle15693SampleFromReader(bool bit, DecodeReader_t *reader) {
-    switch (reader->state) {
-        case STATE_READER_UNSYNCD:
-            // wait for unmodulated carrier
-            if (bit) {
-                reader->state = STATE_READER_AWAIT_1ST_FALLING_EDGE_OF_SOF;
-            }
-            break;
-
-        case STATE_READER_AWAIT_1ST_FALLING_EDGE_OF_SOF:
-            if (!bit) {
-                // we went low, so this could be the beginning of a SOF
-                reader->posCount = 1;
-                reader->state = STATE_READER_AWAIT_1ST_RISING_EDGE_OF_SOF;
-            }
-            break;
-
-        case STATE_READER_AWAIT_1ST_RISING_EDGE_OF_SOF:
-            if (bit) { // detected rising edge
-                if (reader->posCount < 2) { // rising edge too early (nominally expected at 4)
-                    reader->state = STATE_READER_AWAIT_1ST_FALLING_EDGE_OF_SOF;
-                } else { // SOF
-                    reader->state = STATE_READER_AWAIT_2ND_FALLING_EDGE_OF_SOF;
-                    reader->posCount = 1;
-                }
-            } else {
-                reader->posCount++;
-                if (reader->posCount > 6) { // stayed low for too long
-                    DecodeReaderReset(reader);
-                }
-            }
-            break;
-
-        case STATE_READER_AWAIT_2ND_FALLING_EDGE_OF_SOF:
-            if (!bit) { // detected a falling edge
-                if (reader->posCount < 14) {         // falling edge too early (nominally expected at 16 earliest)
-                    DecodeReaderReset(reader);
-                } else if (reader->posCount <= 18) {  // SOF for 1 out of 4 coding
-                    reader->Coding = CODING_1_OUT_OF_4;
-                    reader->state = STATE_READER_AWAIT_2ND_RISING_EDGE_OF_SOF;
-                    reader->posCount = 1;
-                } else if (reader->posCount < 22) {  // falling edge too early (nominally expected at 24 latest)
-                    DecodeReaderReset(reader);
-                } else {                             // SOF for 1 out of 256 coding
-                    reader->Coding = CODING_1_OUT_OF_256;
-                    reader->state = STATE_READER_AWAIT_2ND_RISING_EDGE_OF_SOF;
-                    reader->posCount = 1;
-                }
-            } else {
-                reader->posCount++;
-                if (reader->posCount > 26) { // stayed high for too long
-                    reader->state = STATE_READER_AWAIT_1ST_FALLING_EDGE_OF_SOF;
-                } else {
-                    // do nothing, keep waiting
-                }
-            }
-            break;
-
-        case STATE_READER_AWAIT_2ND_RISING_EDGE_OF_SOF:
-            if (bit) { // detected rising edge
-                if (reader->posCount < 2) { // rising edge too early (nominally expected at 8)
-                    reader->state = STATE_READER_AWAIT_1ST_FALLING_EDGE_OF_SOF;
-                } else {
-                    reader->posCount = 1;
-                    if (reader->Coding == CODING_1_OUT_OF_256) {
-                        reader->bitCount = 1;
-                        reader->byteCount = 0;
-                        reader->sum1 = 1;
-                        LED_B_ON();
-                        reader->state = STATE_READER_RECEIVE_DATA_1_OUT_OF_256;
-                    } else { // CODING_1_OUT_OF_4
-                        reader->state = STATE_READER_AWAIT_END_OF_SOF_1_OUT_OF_4;
-                    }
-                }
-            } else {
-                reader->posCount++;
-                if (reader->posCount > 6) { // signal stayed low for too long
-                    DecodeReaderReset(reader);
-                } else {
-                    // do nothing, keep waiting
-                }
-            }
-            break;
-
-        case STATE_READER_AWAIT_END_OF_SOF_1_OUT_OF_4:
-            if (bit) {
-                reader->posCount++;
-
-                if (reader->posCount == 8) {
-                    reader->posCount = 0;
-                    reader->bitCount = 0;
-                    reader->byteCount = 0;
-                    reader->sum1 = 0;
-                    reader->state = STATE_READER_RECEIVE_DATA_1_OUT_OF_4;
-                    LED_B_ON();
-                }
-            } else { // unexpected falling edge
-                DecodeReaderReset(reader);
-            }
-            break;
-
-        case STATE_READER_RECEIVE_DATA_1_OUT_OF_4:
-            if (!bit) {
-                reader->sum1++;
-                if (reader->sum1 == 1) { // first low bit
-                    if (reader->posCount <= 6) { // bits : 00
-                        reader->shiftReg >>= 2;
-                        //reader->shiftReg |= (0 << 6);
-                        reader->bitCount += 2;
-                        reader->posCount = -28;
-                    } else if (reader->posCount <= 9) { // EOF
-                        LED_B_OFF(); // Finished receiving
-                        DecodeReaderReset(reader);
-                        if (reader->byteCount > 0) {
-                            return true;
-                        }
-                    } else if (reader->posCount <= 14) { // bits : 01
-                        reader->shiftReg >>= 2;
-                        reader->shiftReg |= (1 << 6);
-                        reader->bitCount += 2;
-                        reader->posCount = -20;
-                    } else if (reader->posCount < 18) { // unexpected falling edge
-                        DecodeReaderReset(reader);
-                        if (reader->byteCount >= 0) {
-                            reader->output[reader->byteCount++] = reader->posCount;
-                            reader->output[reader->byteCount++] = reader->bitCount;
-                            reader->output[reader->byteCount++] = 0x42;
-                            return true;
-                        }
-                    } else if (reader->posCount <= 22) { // bits : 10
-                        reader->shiftReg >>= 2;
-                        reader->shiftReg |= (2 << 6);
-                        reader->bitCount += 2;
-                        reader->posCount = -12;
-                    } else if (reader->posCount < 26) { // unexpected falling edge
-                        DecodeReaderReset(reader);
-                        if (reader->byteCount >= 0) {
-                            reader->output[reader->byteCount++] = reader->posCount;
-                            reader->output[reader->byteCount++] = reader->bitCount;
-                            reader->output[reader->byteCount++] = 0x43;
-                            return true;
-                        }
-                    } else { // bits : 11
-                        reader->shiftReg >>= 2;
-                        reader->shiftReg |= (3 << 6);
-                        reader->bitCount += 2;
-                        reader->posCount = -4;
-                    }
-
-                    if (reader->bitCount == 8) {
-                        reader->output[reader->byteCount++] = reader->shiftReg;
-                        if (reader->byteCount > reader->byteCountMax) {
-                            // buffer overflow, give up
-                            LED_B_OFF();
-                            DecodeReaderReset(reader);
-                        }
-
-                        reader->bitCount = 0;
-                        reader->shiftReg = 0;
-                        if (reader->byteCount == reader->jam_search_len) {
-                            if (!memcmp(reader->output, reader->jam_search_string, reader->jam_search_len)) {
-                                LED_D_ON();
-                                FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_READER | FPGA_HF_READER_MODE_SEND_JAM);
-                                reader->state = STATE_READER_RECEIVE_JAMMING;
-                            }
-                        }
-                    }
-                } else if (reader->sum1 > 6) { // too long low bit
-                    DecodeReaderReset(reader);
-                    if (reader->byteCount >= 0) {
-                        reader->output[reader->byteCount++] = reader->posCount;
-                        reader->output[reader->byteCount++] = reader->bitCount;
-                        reader->output[reader->byteCount++] = 0x44;
-                        return true;
-                    }
-                }
-            } else {
-                reader->posCount++;
-                if (reader->posCount > 30) {
-                    reader->state = STATE_READER_AWAIT_1ST_FALLING_EDGE_OF_SOF;
-                    if (reader->byteCount >= 0) {
-                        reader->output[reader->byteCount++] = reader->posCount;
-                        reader->output[reader->byteCount++] = reader->bitCount;
-                        reader->output[reader->byteCount++] = 0x45;
-                        return true;
-                    }
-                }
-                if (reader->sum1 == 1) {
-                    reader->state = STATE_READER_AWAIT_1ST_FALLING_EDGE_OF_SOF;
-                    if (reader->byteCount >= 0) {
-                        reader->output[reader->byteCount++] = reader->posCount;
-                        reader->output[reader->byteCount++] = reader->bitCount;
-                        reader->output[reader->byteCount++] = 0x46;
-                        return true;
-                    }
-                } else if (reader->sum1 > 1) {
-                    reader->posCount += reader->sum1;
-                    reader->sum1 = 0;
-                }
-            }
-            break;
-
-        case STATE_READER_RECEIVE_DATA_1_OUT_OF_256:
-
-            reader->posCount++;
-
-            if (reader->posCount == 1) {
-                reader->sum1 = bit ? 1 : 0;
-            } else if (reader->posCount <= 4) {
-                if (bit) reader->sum1++;
-            } else if (reader->posCount == 5) {
-                reader->sum2 = bit ? 1 : 0;
-            } else if (bit) {
-                reader->sum2++;
-            }
-
-            if (reader->posCount == 8) {
-                reader->posCount = 0;
-                if (reader->sum1 <= 1 && reader->sum2 >= 3) { // EOF
-                    LED_B_OFF(); // Finished receiving
-                    DecodeReaderReset(reader);
-                    if (reader->byteCount != 0) {
-                        return true;
-                    }
-
-                } else if (reader->sum1 >= 3 && reader->sum2 <= 1) { // detected the bit position
-                    reader->shiftReg = reader->bitCount;
-                }
-
-                if (reader->bitCount == 255) { // we have a full byte
-                    reader->output[reader->byteCount++] = reader->shiftReg;
-                    if (reader->byteCount > reader->byteCountMax) {
-                        // buffer overflow, give up
-                        LED_B_OFF();
-                        DecodeReaderReset(reader);
-                    }
-
-                    if (reader->byteCount == reader->jam_search_len) {
-                        if (!memcmp(reader->output, reader->jam_search_string, reader->jam_search_len)) {
-                            LED_D_ON();
-                            FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_READER | FPGA_HF_READER_MODE_SEND_JAM);
-                            reader->state = STATE_READER_RECEIVE_JAMMING;
-                        }
-                    }
-                }
-                reader->bitCount++;
-            }
-            break;
-
-        case STATE_READER_RECEIVE_JAMMING:
-
-            reader->posCount++;
-
-            if (reader->Coding == CODING_1_OUT_OF_4) {
-                if (reader->posCount == 7 * 16) { // 7 bits jammed
-                    FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_READER | FPGA_HF_READER_MODE_SNIFF_AMPLITUDE); // stop jamming
-                    // FpgaDisableTracing();
-                    LED_D_OFF();
-                } else if (reader->posCount == 8 * 16) {
-                    reader->posCount = 0;
-                    reader->output[reader->byteCount++] = 0x00;
-                    reader->state = STATE_READER_RECEIVE_DATA_1_OUT_OF_4;
-                }
-            } else {
-                if (reader->posCount == 7 * 256) { // 7 bits jammend
-                    FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_READER | FPGA_HF_READER_MODE_SNIFF_AMPLITUDE); // stop jamming
-                    LED_D_OFF();
-                } else if (reader->posCount == 8 * 256) {
-                    reader->posCount = 0;
-                    reader->output[reader->byteCount++] = 0x00;
-                    reader->state = STATE_READER_RECEIVE_DATA_1_OUT_OF_256;
-                }
-            }
-            break;
-
-        default:
-            LED_B_OFF();
-            DecodeReaderReset(reader);
-            break;
-    }
-
-    return false;
-}
-
 //-----------------------------------------------------------------------------
 // Receive a command (from the reader to us, where we are the simulated tag),
 // and store it in the given buffer, up to the given maximum length. Keeps
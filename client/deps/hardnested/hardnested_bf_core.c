@@ -88,6 +88,26 @@ typedef union {
     uint8_t bytes[MAX_BITSLICES / 8];
 } bitslice_t;
 
+// test if all slices of a bitsliced vector are cleared, using a single vector test where available.
+// Comparing the 64 bit words one by one spills wide vectors to memory.
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define bitslice_is_zero(x) (_mm512_test_epi64_mask((__m512i)(x).value, (__m512i)(x).value) == 0)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define bitslice_is_zero(x) (_mm256_testz_si256((__m256i)(x).value, (__m256i)(x).value))
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define bitslice_is_zero(x) (_mm_testz_si128((__m128i)(x).value, (__m128i)(x).value))
+#elif defined(__aarch64__) && defined(__ARM_NEON) && !defined(NOSIMD_BUILD)
+#include <arm_neon.h>
+#define bitslice_is_zero(x) (vmaxvq_u32((uint32x4_t)(x).value) == 0)
+#elif MAX_BITSLICES > 64
+#define bitslice_is_zero(x) (((x).bytes64[0] | (x).bytes64[1]) == 0)
+#else
+#define bitslice_is_zero(x) ((x).bytes64[0] == 0)
+#endif
+
 // filter function (f20)
 // sourced from ``Wirelessly Pickpocketing a Mifare Classic Card'' by Flavio Garcia, Peter van Rossum, Roel Verdult and Ronny Wichers Schreur
 #define f20a(a,b,c,d) (((a|b)^(a&d))^(c&((a^b)|d)))
@@ -437,22 +457,8 @@ uint64_t CRACK_STATES_BITSLICED(uint32_t cuid, uint8_t *best_first_bytes, statel
                         // if(memcmp(&results, &bs_zeroes, sizeof(bitslice_t)) == 0){
 
                         // this is much faster on my gcc, because somehow a memcmp needlessly spills/fills all the xmm registers to/from the stack - ???
-                        // the short-circuiting also helps
-                        if (results.bytes64[0] == 0
-#if MAX_BITSLICES > 64
-                                && results.bytes64[1] == 0
-#endif
-#if MAX_BITSLICES > 128
-                                && results.bytes64[2] == 0
-                                && results.bytes64[3] == 0
-#endif
-#if MAX_BITSLICES > 256
-                                && results.bytes64[4] == 0
-                                && results.bytes64[5] == 0
-                                && results.bytes64[6] == 0
-                                && results.bytes64[7] == 0
-#endif
-                           ) {
+                        // a single vector test keeps the results in a register
+                        if (bitslice_is_zero(results)) {
 #if defined (DEBUG_BRUTE_FORCE)
                             if (elimination_step < MAX_ELIMINATION_STEP) {
                                 keys_eliminated[elimination_step] += MAX_BITSLICES;
@@ -55,6 +55,12 @@ THE SOFTWARE.
 #include <pthread.h>
 #include <string.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#if !defined(_WIN32)
+#include <signal.h>
+#endif
 
 #include "common.h"
 #include "proxmark3.h"
@@ -64,6 +70,7 @@ THE SOFTWARE.
 #include "util.h"
 #include "util_posix.h"
 #include "crapto1/crapto1.h"
+#include "crapto1/crypto1_bs.h"
 #include "parity.h"
 #include "fileutils.h"
 #include "pm3_cmd.h"
@@ -71,7 +78,6 @@ THE SOFTWARE.
 #define NUM_BRUTE_FORCE_THREADS         (num_CPUs())
 #define DEFAULT_BRUTE_FORCE_RATE        (120000000.0) // if benchmark doesn't succeed
 #define TEST_BENCH_SIZE                 (6000)        // number of odd and even states for brute force benchmark
-#define TEST_BENCH_FILENAME             "hardnested_bf_bench_data.bin"
 //#define WRITE_BENCH_FILE
 
 // debugging options
@@ -80,6 +86,13 @@ THE SOFTWARE.
 
 #define MIN_BUCKETS_SIZE                128
 
+// work units for resumable / shared brute forcing (see set_bf_work_dir())
+#define MAX_WORK_UNITS                  256     // buckets are packed into at most this many (plus one) units
+#define WORK_UNIT_POLL_INTERVAL         2000    // ms to wait for work units claimed by other processes
+#define WORK_FILE_TEMPLATE              "%s" PATHSEP "hardnested_%016" PRIx64 "%s"
+#define WORK_FILE_PATH_SIZE             (FILE_PATH_SIZE + 48)
+#define WORK_UNIT_FILE_TEMPLATE         "%s" PATHSEP "hardnested_%016" PRIx64 "_%03" PRIu32 "%s"
+
 typedef enum {
     EVEN_STATE = 0,
     ODD_STATE = 1
@@ -96,6 +109,20 @@ static uint32_t keys_found = 0;
 static uint64_t num_keys_tested;
 static uint64_t found_bs_key = 0;
 
+typedef struct {
+    uint32_t first_bucket;
+    uint32_t num_buckets;
+    uint64_t num_states;
+} bf_work_unit_t;
+
+static char bf_work_dir[FILE_PATH_SIZE] = {0};
+static uint64_t bf_run_id = 0;
+static bf_work_unit_t *work_units = NULL;
+static uint32_t work_unit_count = 0;
+static uint32_t next_work_unit = 0;
+static uint32_t work_units_busy = 0;
+static uint32_t work_units_done = 0;
+
 uint8_t trailing_zeros(uint8_t byte) {
     static const uint8_t trailing_zeros_LUT[256] = {
         8, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
@@ -120,29 +147,311 @@ uint8_t trailing_zeros(uint8_t byte) {
 }
 
 
+// All nonces are checked at once with the bitsliced Crypto1, one nonce per lane.
+// The parity bits stored with the nonces are checked against the even parity of the decrypted bytes,
+// crypto1_bs_check_nonces() expects odd parity, hence the inverted parity bits.
 bool verify_key(uint32_t cuid, noncelist_t *nonces, const uint8_t *best_first_bytes, uint32_t odd, uint32_t even) {
-    struct Crypto1State pcs;
+    uint32_t cnt = 0;
     for (uint16_t test_first_byte = 1; test_first_byte < 256; test_first_byte++) {
-        noncelistentry_t *test_nonce = nonces[best_first_bytes[test_first_byte]].first;
-        while (test_nonce != NULL) {
-            pcs.odd = odd;
-            pcs.even = even;
-            lfsr_rollback_byte(&pcs, (cuid >> 24) ^ best_first_bytes[0], true);
-            for (int8_t byte_pos = 3; byte_pos >= 0; byte_pos--) {
-                uint8_t test_par_enc_bit = (test_nonce->par_enc >> byte_pos) & 0x01;     // the encoded parity bit
-                uint8_t test_byte_enc = (test_nonce->nonce_enc >> (8 * byte_pos)) & 0xff; // the encoded nonce byte
-                uint8_t test_byte_dec = crypto1_byte(&pcs, test_byte_enc /* ^ (cuid >> (8*byte_pos)) */, true) ^ test_byte_enc; // decode the nonce byte
-                uint8_t ks_par = filter(pcs.odd);                                        // the keystream bit to encode/decode the parity bit
-                uint8_t test_par_enc2 = ks_par ^ evenparity8(test_byte_dec);             // determine the decoded byte's parity and encode it
-                if (test_par_enc_bit != test_par_enc2) {
-                    return false;
-                }
+        for (noncelistentry_t *test_nonce = nonces[best_first_bytes[test_first_byte]].first; test_nonce != NULL; test_nonce = test_nonce->next) {
+            cnt++;
+        }
+    }
+
+    uint32_t *nonce_enc = calloc(cnt, sizeof(uint32_t));
+    uint8_t *par_enc = calloc(cnt, sizeof(uint8_t));
+    if (nonce_enc == NULL || par_enc == NULL) {
+        free(nonce_enc);
+        free(par_enc);
+        return false;
+    }
+
+    uint32_t n = 0;
+    for (uint16_t test_first_byte = 1; test_first_byte < 256; test_first_byte++) {
+        for (noncelistentry_t *test_nonce = nonces[best_first_bytes[test_first_byte]].first; test_nonce != NULL; test_nonce = test_nonce->next) {
+            nonce_enc[n] = test_nonce->nonce_enc;
+            par_enc[n] = test_nonce->par_enc ^ 0x0f;
+            n++;
+        }
+    }
+
+    struct Crypto1State pcs;
+    pcs.odd = odd;
+    pcs.even = even;
+    lfsr_rollback_byte(&pcs, (cuid >> 24) ^ best_first_bytes[0], true);
+
+    bool res = crypto1_bs_check_nonces(&pcs, 0, nonce_enc, par_enc, n);
+    free(nonce_enc);
+    free(par_enc);
+    return res;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// resumable / distributed brute force
+//
+// With a work directory set, the candidate buckets are packed into work units. A unit is claimed by creating
+// its .lock file and marked finished by a .done file. A killed session therefore resumes where it stopped, and
+// several processes (on one or more hosts sharing the directory) can work on the same brute force at once.
+// All of them must use the same nonces, i.e. run `hf mf hardnested -r -f <nonces.bin> --wdir <dir>`.
+
+void set_bf_work_dir(const char *dirname) {
+    if (dirname == NULL) {
+        bf_work_dir[0] = '\0';
+        return;
+    }
+    strncpy(bf_work_dir, dirname, sizeof(bf_work_dir) - 1);
+    bf_work_dir[sizeof(bf_work_dir) - 1] = '\0';
+}
+
+static uint64_t fnv1a_64(uint64_t hash, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// candidates are generated by several threads and their order differs from run to run.
+// Sort them, so that all processes agree on the content of each work unit.
+static int compare_buckets(const void *b1, const void *b2) {
+    const statelist_t *s1 = *(statelist_t * const *)b1;
+    const statelist_t *s2 = *(statelist_t * const *)b2;
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        if (s1->len[odd_even] != s2->len[odd_even]) {
+            return (s1->len[odd_even] > s2->len[odd_even]) - (s1->len[odd_even] < s2->len[odd_even]);
+        }
+        if (s1->len[odd_even] > 0 && s1->states[odd_even][0] != s2->states[odd_even][0]) {
+            return (s1->states[odd_even][0] > s2->states[odd_even][0]) - (s1->states[odd_even][0] < s2->states[odd_even][0]);
+        }
+    }
+    return 0;
+}
+
+static uint64_t get_bf_run_id(uint32_t cuid) {
+    uint64_t id = 0xCBF29CE484222325ULL;
+    id = fnv1a_64(id, &cuid, sizeof(cuid));
+    id = fnv1a_64(id, &nonces_to_bruteforce, sizeof(nonces_to_bruteforce));
+    id = fnv1a_64(id, bf_test_nonce, nonces_to_bruteforce * sizeof(bf_test_nonce[0]));
+    id = fnv1a_64(id, bf_test_nonce_par, nonces_to_bruteforce * sizeof(bf_test_nonce_par[0]));
+    id = fnv1a_64(id, &bucket_count, sizeof(bucket_count));
+    for (uint32_t i = 0; i < bucket_count; i++) {
+        for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+            id = fnv1a_64(id, &buckets[i]->len[odd_even], sizeof(uint32_t));
+            if (buckets[i]->len[odd_even] > 0) {
+                id = fnv1a_64(id, buckets[i]->states[odd_even], sizeof(uint32_t));
             }
-            test_nonce = test_nonce->next;
         }
     }
+    return id;
+}
+
+static void get_work_filename(char *fn, size_t fnlen, const char *ext) {
+    snprintf(fn, fnlen, WORK_FILE_TEMPLATE, bf_work_dir, bf_run_id, ext);
+}
+
+static void get_work_unit_filename(char *fn, size_t fnlen, uint32_t unit, const char *ext) {
+    snprintf(fn, fnlen, WORK_UNIT_FILE_TEMPLATE, bf_work_dir, bf_run_id, unit, ext);
+}
+
+// write the work unit table. If it already exists (resumed session, or another process started first), it must match.
+static bool write_work_units(uint32_t cuid) {
+    char fn[WORK_FILE_PATH_SIZE];
+    get_work_filename(fn, sizeof(fn), ".units");
+
+    char *units = calloc(work_unit_count + 2, 80);
+    if (units == NULL) {
+        return false;
+    }
+
+    size_t len = snprintf(units, 80, "hardnested work units v1, cuid %08" PRIx32 ", %" PRIu32 " buckets, %" PRIu32 " units\n", cuid, bucket_count, work_unit_count);
+    for (uint32_t i = 0; i < work_unit_count; i++) {
+        len += snprintf(units + len, 80, "%03" PRIu32 " %6" PRIu32 " %6" PRIu32 " %16" PRIu64 "\n", i, work_units[i].first_bucket, work_units[i].num_buckets, work_units[i].num_states);
+    }
+
+    bool res = false;
+    int fd = open(fn, O_CREAT | O_EXCL | O_WRONLY, 0644);
+    if (fd >= 0) {
+        res = (write(fd, units, len) == (ssize_t)len);
+        close(fd);
+    } else if (errno == EEXIST) {
+        FILE *f = fopen(fn, "rb");
+        if (f != NULL) {
+            char *existing = calloc(len + 1, sizeof(char));
+            if (existing != NULL) {
+                res = (fread(existing, 1, len + 1, f) == len) && (memcmp(existing, units, len) == 0);
+                free(existing);
+            }
+            fclose(f);
+        }
+        if (res == false) {
+            PrintAndLogEx(ERR, "Work unit table %s doesn't match the current candidates", fn);
+        }
+    }
+
+    if (res == false) {
+        PrintAndLogEx(ERR, "Can't use work directory " _YELLOW_("%s"), bf_work_dir);
+    }
+    free(units);
+    return res;
+}
+
+static bool init_work_units(uint32_t cuid) {
+
+    qsort(buckets, bucket_count, sizeof(statelist_t *), compare_buckets);
+    bf_run_id = get_bf_run_id(cuid);
+
+    uint64_t total_states = 0;
+    for (uint32_t i = 0; i < bucket_count; i++) {
+        total_states += (uint64_t)buckets[i]->len[ODD_STATE] * buckets[i]->len[EVEN_STATE];
+    }
+
+    // greedily pack consecutive buckets into units of about equal size
+    work_units = calloc(MAX_WORK_UNITS + 1, sizeof(bf_work_unit_t));
+    if (work_units == NULL) {
+        return false;
+    }
+
+    uint64_t unit_size = total_states / MAX_WORK_UNITS + 1;
+    work_unit_count = 0;
+    for (uint32_t i = 0; i < bucket_count; i++) {
+        bf_work_unit_t *unit = &work_units[work_unit_count];
+        if (unit->num_buckets == 0) {
+            unit->first_bucket = i;
+        }
+        unit->num_buckets++;
+        unit->num_states += (uint64_t)buckets[i]->len[ODD_STATE] * buckets[i]->len[EVEN_STATE];
+        if (unit->num_states >= unit_size) {
+            work_unit_count++;
+        }
+    }
+    if (work_unit_count <= MAX_WORK_UNITS && work_units[work_unit_count].num_buckets > 0) {
+        work_unit_count++;
+    }
+    next_work_unit = 0;
+
+    if (write_work_units(cuid) == false) {
+        free(work_units);
+        work_units = NULL;
+        return false;
+    }
+
+    PrintAndLogEx(INFO, "Brute force split into " _YELLOW_("%" PRIu32) " work units, run id " _YELLOW_("%016" PRIx64), work_unit_count, bf_run_id);
+    return true;
+}
+
+static void free_work_units(void) {
+    free(work_units);
+    work_units = NULL;
+    work_unit_count = 0;
+}
+
+static bool work_unit_done(uint32_t unit) {
+    char fn[WORK_FILE_PATH_SIZE];
+    get_work_unit_filename(fn, sizeof(fn), unit, ".done");
+    return fileExists(fn);
+}
+
+// a lock left behind by a killed process on this host can be taken over
+static bool work_unit_lock_is_stale(const char *fn) {
+#if defined(_WIN32)
+    (void)fn;
+    return false;
+#else
+    char host[64] = {0};
+    char owner_host[64] = {0};
+    int owner_pid = 0;
+
+    FILE *f = fopen(fn, "r");
+    if (f == NULL) {
+        return false;
+    }
+    int n = fscanf(f, "%63s %d", owner_host, &owner_pid);
+    fclose(f);
+
+    if (n != 2 || gethostname(host, sizeof(host) - 1) != 0) {
+        return false;
+    }
+    return (strcmp(host, owner_host) == 0) && (owner_pid != getpid()) && (kill(owner_pid, 0) != 0) && (errno == ESRCH);
+#endif
+}
+
+static bool claim_work_unit(uint32_t unit) {
+    char fn[WORK_FILE_PATH_SIZE];
+    get_work_unit_filename(fn, sizeof(fn), unit, ".lock");
+
+    int fd = open(fn, O_CREAT | O_EXCL | O_WRONLY, 0644);
+    if (fd < 0 && errno == EEXIST && work_unit_lock_is_stale(fn)) {
+        unlink(fn);
+        fd = open(fn, O_CREAT | O_EXCL | O_WRONLY, 0644);
+    }
+    if (fd < 0) {
+        return false;
+    }
+
+    char owner[96] = "localhost";
+#if !defined(_WIN32)
+    gethostname(owner, 64);
+    owner[63] = '\0';
+#endif
+    size_t len = strlen(owner);
+    snprintf(owner + len, sizeof(owner) - len, " %d\n", (int)getpid());
+    if (write(fd, owner, strlen(owner)) < 0) {
+        PrintAndLogEx(WARNING, "Can't write %s", fn);
+    }
+    close(fd);
     return true;
 }
+
+static void release_work_unit(uint32_t unit, bool done) {
+    char fn[WORK_FILE_PATH_SIZE];
+    if (done) {
+        get_work_unit_filename(fn, sizeof(fn), unit, ".done");
+        FILE *f = fopen(fn, "w");
+        if (f != NULL) {
+            fprintf(f, "%" PRIu64 "\n", work_units[unit].num_states);
+            fclose(f);
+        }
+    }
+    get_work_unit_filename(fn, sizeof(fn), unit, ".lock");
+    unlink(fn);
+}
+
+static void write_found_key(uint64_t key) {
+    char fn[WORK_FILE_PATH_SIZE];
+    get_work_filename(fn, sizeof(fn), ".key");
+    FILE *f = fopen(fn, "w");
+    if (f != NULL) {
+        fprintf(f, "%012" PRIx64 "\n", key);
+        fclose(f);
+    }
+}
+
+// another process may already have found the key
+static bool read_found_key(uint64_t *key) {
+    char fn[WORK_FILE_PATH_SIZE];
+    get_work_filename(fn, sizeof(fn), ".key");
+    FILE *f = fopen(fn, "r");
+    if (f == NULL) {
+        return false;
+    }
+    bool res = (fscanf(f, "%" SCNx64, key) == 1);
+    fclose(f);
+    return res;
+}
+
+static void found_key(uint64_t key, uint32_t num_acquired_nonces) {
+    if (__atomic_fetch_add(&keys_found, 1, __ATOMIC_SEQ_CST) == 0) {
+        __atomic_fetch_add(&found_bs_key, key, __ATOMIC_SEQ_CST);
+    }
+
+    char progress_text[80];
+    char keystr[19];
+    snprintf(keystr, sizeof(keystr), "%012" PRIX64 "  ", key);
+    snprintf(progress_text, sizeof(progress_text), "Brute force phase completed.  Key found: " _GREEN_("%s"), keystr);
+    hardnested_print_progress(num_acquired_nonces, progress_text, 0.0, 0);
+}
+
 static void *
 #ifdef __has_attribute
 #if __has_attribute(force_align_arg_pointer)
@@ -163,6 +472,52 @@ crack_states_thread(void *x) {
     const int num_brute_force_threads = NUM_BRUTE_FORCE_THREADS;
     thread_arg = (struct arg *)x;
     const int thread_id = thread_arg->thread_ID;
+
+    if (work_units != NULL) {
+        // resumable mode: threads share the work units, skipping those which are done or claimed by another process
+        uint32_t current_unit;
+        while ((current_unit = __atomic_fetch_add(&next_work_unit, 1, __ATOMIC_SEQ_CST)) < work_unit_count) {
+            uint64_t peer_key = 0;
+            if (keys_found) {
+                break;
+            }
+            if (read_found_key(&peer_key)) {
+                found_key(peer_key, thread_arg->num_acquired_nonces);
+                break;
+            }
+            if (work_unit_done(current_unit)) {
+                __atomic_fetch_add(&work_units_done, 1, __ATOMIC_SEQ_CST);
+                continue;
+            }
+            if (claim_work_unit(current_unit) == false) {
+                __atomic_fetch_add(&work_units_busy, 1, __ATOMIC_SEQ_CST);
+                continue;
+            }
+#if defined (DEBUG_BRUTE_FORCE)
+            PrintAndLogEx(INFO, "Thread " _YELLOW_("%u") " starts working on unit " _YELLOW_("%u") "\n", thread_id, current_unit);
+#endif
+            bf_work_unit_t *unit = &work_units[current_unit];
+            for (uint32_t i = unit->first_bucket; i < unit->first_bucket + unit->num_buckets && !keys_found; i++) {
+                const uint64_t key = crack_states_bitsliced(thread_arg->cuid, thread_arg->best_first_bytes, buckets[i], &keys_found, &num_keys_tested, nonces_to_bruteforce, bf_test_nonce_2nd_byte, thread_arg->nonces);
+                if (key != -1) {
+                    write_found_key(key);
+                    found_key(key, thread_arg->num_acquired_nonces);
+                }
+            }
+            // a unit interrupted by a found key is not complete
+            release_work_unit(current_unit, keys_found == 0);
+
+            if (!keys_found && !thread_arg->silent) {
+                uint32_t done = __atomic_add_fetch(&work_units_done, 1, __ATOMIC_SEQ_CST);
+                char progress_text[80];
+                snprintf(progress_text, sizeof(progress_text), "Brute force phase: %3" PRIu32 " of %3" PRIu32 " work units done", done, work_unit_count);
+                float remaining_bruteforce = thread_arg->nonces[thread_arg->best_first_bytes[0]].expected_num_brute_force - (float)num_keys_tested / 2;
+                hardnested_print_progress(thread_arg->num_acquired_nonces, progress_text, remaining_bruteforce, 5000);
+            }
+        }
+        return NULL;
+    }
+
     uint32_t current_bucket = thread_id;
     while (current_bucket < bucket_count) {
         statelist_t *bucket = buckets[current_bucket];
@@ -172,14 +527,7 @@ crack_states_thread(void *x) {
 #endif
             const uint64_t key = crack_states_bitsliced(thread_arg->cuid, thread_arg->best_first_bytes, bucket, &keys_found, &num_keys_tested, nonces_to_bruteforce, bf_test_nonce_2nd_byte, thread_arg->nonces);
             if (key != -1) {
-                __atomic_fetch_add(&keys_found, 1, __ATOMIC_SEQ_CST);
-                __atomic_fetch_add(&found_bs_key, key, __ATOMIC_SEQ_CST);
-
-                char progress_text[80];
-                char keystr[19];
-                snprintf(keystr, sizeof(keystr), "%012" PRIX64 "  ", key);
-                snprintf(progress_text, sizeof(progress_text), "Brute force phase completed.  Key found: " _GREEN_("%s"), keystr);
-                hardnested_print_progress(thread_arg->num_acquired_nonces, progress_text, 0.0, 0);
+                found_key(key, thread_arg->num_acquired_nonces);
                 break;
             } else if (keys_found) {
                 break;
@@ -354,6 +702,14 @@ bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint
         return false;
 #endif
 
+    bool use_work_units = (silent == false) && (bf_work_dir[0] != '\0');
+    if (use_work_units && (init_work_units(cuid) == false)) {
+        free(buckets);
+        buckets = NULL;
+        buckets_allocated = 0;
+        return false;
+    }
+
     pthread_t threads[num_brute_force_threads];
     struct args {
         bool silent;
@@ -373,10 +729,28 @@ bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint
         thread_args[i].maximum_states = maximum_states;
         thread_args[i].nonces = nonces;
         thread_args[i].best_first_bytes = best_first_bytes;
-        pthread_create(&threads[i], NULL, crack_states_thread, (void *)&thread_args[i]);
     }
-    for (uint32_t i = 0; i < num_brute_force_threads; i++) {
-        pthread_join(threads[i], 0);
+
+    do {
+        work_units_busy = 0;
+        work_units_done = 0;
+        for (uint32_t i = 0; i < num_brute_force_threads; i++) {
+            pthread_create(&threads[i], NULL, crack_states_thread, (void *)&thread_args[i]);
+        }
+        for (uint32_t i = 0; i < num_brute_force_threads; i++) {
+            pthread_join(threads[i], 0);
+        }
+
+        // units claimed by other processes must be finished before this Sum(a8) guess can be given up
+        if (use_work_units && keys_found == 0 && work_units_busy > 0) {
+            PrintAndLogEx(INFO, "Waiting for " _YELLOW_("%" PRIu32) " work units claimed by other processes (remove stale .lock files in " _YELLOW_("%s") " to reclaim them)", work_units_busy, bf_work_dir);
+            msleep(WORK_UNIT_POLL_INTERVAL);
+            next_work_unit = 0;
+        }
+    } while (use_work_units && keys_found == 0 && work_units_busy > 0);
+
+    if (use_work_units) {
+        free_work_units();
     }
 
     free(buckets);
@@ -21,6 +21,7 @@
 #include <stdbool.h>
 
 #define NUM_SUMS 19 // number of possible sum property values
+#define TEST_BENCH_FILENAME "hardnested_bf_bench_data.bin"
 
 typedef struct guess_sum_a8 {
     float prob;
@@ -58,5 +59,6 @@ bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint
 float brute_force_benchmark(void);
 uint8_t trailing_zeros(uint8_t byte);
 bool verify_key(uint32_t cuid, noncelist_t *nonces, const uint8_t *best_first_bytes, uint32_t odd, uint32_t even);
+void set_bf_work_dir(const char *dirname);
 
 #endif
@@ -642,12 +642,17 @@ usage(void) {
             "\t-c calculate CRCs\t\t-d dump algorithm parameters\n"
             "\t-D list preset algorithms\t-e echo (and reformat) input\n"
             "\t-s search for algorithm\t\t-v calculate reversed CRCs\n"
-            "\t-g search for alg given hex+crc\n"
+            "\t-g search for alg given hex+crc, one or more frames\n"
+            "\t-g -f <file> search for alg over the frames of a trace file\n"
             "\t-h | -u | -? show this help\n"
             "Common Use Examples:\n"
             "\t   reveng -g 01020304e3\n"
             "\t      Searches for a known/common crc preset that computes the crc\n"
             "\t      on the end of the given hex string\n"
+            "\t   reveng -g 0102e3 0304a1 0506b2\n"
+            "\t      Counts for every preset how many of the frames carry its crc\n"
+            "\t   reveng -g -f hf_14a_mfu.trace\n"
+            "\t      Same, for every frame in a trace file saved with `trace save`\n"
             "\t   reveng -w 8 -s 01020304e3 010204039d\n"
             "\t      Searches for any possible 8 bit width crc calc that computes\n"
             "\t      the crc on the end of the given hex string(s)\n"
@@ -22,7 +22,8 @@
  * along with CRC RevEng.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-/* 2013-09-16: calini(), calout() work on shortest argument
+/* 2026-10-18: polynomial search runs on several threads, see setthreads()
+ * 2013-09-16: calini(), calout() work on shortest argument
  * 2013-06-11: added sequence number to uprog() calls
  * 2013-02-08: added polynomial range search
  * 2013-01-18: refactored model checking to pshres(); renamed chkres()
@@ -49,10 +50,32 @@
  */
 
 #include <stdlib.h>
+#include <pthread.h>
 
 #define FILE void
 #include "reveng.h"
 
+/* One polynomial search thread. Candidate polys are dealt round robin,
+ * thread t tests every threads'th one and keeps its own result list.
+ */
+typedef struct {
+    const model_t *guess;
+    poly_t qpoly;
+    int rflags;
+    int args;
+    const poly_t *argpolys;
+    const poly_t *pworks;
+    int thread;
+    int threads;
+    int resc;
+    model_t *result;
+    pthread_t tid;
+    int started;
+} rjob_t;
+
+static void *rsearch(void *arg);
+static model_t *rmerge(rjob_t *jobs, int threads, int *resc);
+
 static poly_t *modpol(const poly_t init, int rflags, int args, const poly_t *argpolys);
 static void engini(int *resc, model_t **result, const poly_t divisor, int flags, int args, const poly_t *argpolys);
 static void calout(int *resc, model_t **result, const poly_t divisor, const poly_t init, int flags, int args, const poly_t *argpolys);
@@ -61,13 +84,24 @@ static void chkres(int *resc, model_t **result, const poly_t divisor, const poly
 
 static const poly_t pzero = PZERO;
 
+static int rthreads = 1;
+static pthread_mutex_t rlock = PTHREAD_MUTEX_INITIALIZER;
+/* set while the search threads run, chkres() leaves ufound() to reveng() */
+static int rdefer = 0;
+
+void
+setthreads(int threads) {
+    /* Number of threads reveng() uses to search for the poly. */
+    rthreads = (threads < 1) ? 1 : threads;
+}
+
 model_t *
 reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys) {
     /* Complete the parameters of a model by calculation or brute search. */
-    poly_t *pworks, *wptr, rem, gpoly;
+    poly_t *pworks, *wptr;
     model_t *result = NULL, *rptr;
-    int resc = 0;
-    unsigned long spin = 0, seq = 0;
+    rjob_t *jobs;
+    int resc = 0, t;
 
     if (~rflags & R_HAVEP) {
         /* The poly is not known.
@@ -78,52 +112,42 @@ reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const pol
             free(pworks);
             goto requit;
         }
-        /* Initialise the guessed poly to the starting value. */
-        gpoly = pclone(guess->spoly);
-        /* Clear the least significant term, to be set in the
-         * loop. qpoly does not need fixing as it is only
-         * compared with odd polys.
-         */
-        if (plen(gpoly))
-            pshift(&gpoly, gpoly, 0UL, 0UL, plen(gpoly) - 1UL, 1UL);
 
-        while (piter(&gpoly) && (~rflags & R_HAVEQ || pcmp(&gpoly, &qpoly) < 0)) {
-            /* For each possible poly of this size, try
-             * dividing all the differences in the list.
-             */
-            if (!(spin++ & R_SPMASK)) {
-                uprog(gpoly, guess->flags, seq++);
-            }
-            for (wptr = pworks; plen(*wptr); ++wptr) {
-                /* straight divide message by poly, don't multiply by x^n */
-                rem = pcrc(*wptr, gpoly, pzero, pzero, 0);
-                if (ptst(rem)) {
-                    pfree(&rem);
-                    break;
-                } else
-                    pfree(&rem);
-            }
-            /* If gpoly divides all the differences, it is a
-             * candidate.  Search for an Init value for this
-             * poly or if Init is known, log the result.
-             */
-            if (!plen(*wptr)) {
-                /* gpoly is a candidate poly */
-                if (rflags & R_HAVEI && rflags & R_HAVEX)
-                    chkres(&resc, &result, gpoly, guess->init, guess->flags, guess->xorout, args, argpolys);
-                else if (rflags & R_HAVEI)
-                    calout(&resc, &result, gpoly, guess->init, guess->flags, args, argpolys);
-                else if (rflags & R_HAVEX)
-                    calini(&resc, &result, gpoly, guess->flags, guess->xorout, args, argpolys);
-                else
-                    engini(&resc, &result, gpoly, guess->flags, args, argpolys);
-            }
-            if (!piter(&gpoly))
-                break;
+        if (!(jobs = calloc(rthreads, sizeof(rjob_t)))) {
+            uerror("cannot allocate memory for search threads");
+            goto rfree;
         }
-        /* Finished with gpoly and the differences list, free them.
+        for (t = 0; t < rthreads; ++t) {
+            jobs[t].guess = guess;
+            jobs[t].qpoly = qpoly;
+            jobs[t].rflags = rflags;
+            jobs[t].args = args;
+            jobs[t].argpolys = argpolys;
+            jobs[t].pworks = pworks;
+            jobs[t].thread = t;
+            jobs[t].threads = rthreads;
+        }
+        /* thread 0 runs on the caller, so does any thread that fails to start */
+        rdefer = 1;
+        for (t = 1; t < rthreads; ++t)
+            jobs[t].started = !pthread_create(&jobs[t].tid, NULL, rsearch, &jobs[t]);
+        rsearch(&jobs[0]);
+        for (t = 1; t < rthreads; ++t) {
+            if (jobs[t].started)
+                pthread_join(jobs[t].tid, NULL);
+            else
+                rsearch(&jobs[t]);
+        }
+        rdefer = 0;
+        result = rmerge(jobs, rthreads, &resc);
+        free(jobs);
+        /* report in poly order, whatever thread found them first */
+        for (t = 0; t < resc; ++t)
+            ufound(result + t);
+
+rfree:
+        /* Finished with the differences list, free it.
          */
-        pfree(&gpoly);
         for (wptr = pworks; plen(*wptr); ++wptr)
             pfree(wptr);
         free(pworks);
@@ -157,6 +181,106 @@ requit:
     return (result);
 }
 
+static void *
+rsearch(void *arg) {
+    /* For each possible poly of this size dealt to this thread, try
+     * dividing all the differences in the list.
+     */
+    rjob_t *job = (rjob_t *) arg;
+    const model_t *guess = job->guess;
+    const poly_t *wptr;
+    poly_t rem, gpoly;
+    unsigned long spin = 0, seq = 0, cand = 0;
+
+    /* Initialise the guessed poly to the starting value. */
+    gpoly = pclone(guess->spoly);
+    /* Clear the least significant term, to be set in the
+     * loop. qpoly does not need fixing as it is only
+     * compared with odd polys.
+     */
+    if (plen(gpoly))
+        pshift(&gpoly, gpoly, 0UL, 0UL, plen(gpoly) - 1UL, 1UL);
+
+    while (piter(&gpoly) && (~job->rflags & R_HAVEQ || pcmp(&gpoly, &job->qpoly) < 0)) {
+        /* thread 0 steps through every poly, so progress is
+         * reported as often as with a single thread.
+         */
+        if (!job->thread && !(spin++ & R_SPMASK)) {
+            pthread_mutex_lock(&rlock);
+            uprog(gpoly, guess->flags, seq++);
+            pthread_mutex_unlock(&rlock);
+        }
+        if (cand++ % job->threads == (unsigned long) job->thread) {
+            for (wptr = job->pworks; plen(*wptr); ++wptr) {
+                /* straight divide message by poly, don't multiply by x^n */
+                rem = pcrc(*wptr, gpoly, pzero, pzero, 0);
+                if (ptst(rem)) {
+                    pfree(&rem);
+                    break;
+                } else
+                    pfree(&rem);
+            }
+            /* If gpoly divides all the differences, it is a
+             * candidate.  Search for an Init value for this
+             * poly or if Init is known, log the result.
+             */
+            if (!plen(*wptr)) {
+                /* gpoly is a candidate poly */
+                if (job->rflags & R_HAVEI && job->rflags & R_HAVEX)
+                    chkres(&job->resc, &job->result, gpoly, guess->init, guess->flags, guess->xorout, job->args, job->argpolys);
+                else if (job->rflags & R_HAVEI)
+                    calout(&job->resc, &job->result, gpoly, guess->init, guess->flags, job->args, job->argpolys);
+                else if (job->rflags & R_HAVEX)
+                    calini(&job->resc, &job->result, gpoly, guess->flags, guess->xorout, job->args, job->argpolys);
+                else
+                    engini(&job->resc, &job->result, gpoly, guess->flags, job->args, job->argpolys);
+            }
+        }
+        if (!piter(&gpoly))
+            break;
+    }
+    pfree(&gpoly);
+    return NULL;
+}
+
+static model_t *
+rmerge(rjob_t *jobs, int threads, int *resc) {
+    /* Join the per thread result lists, each ascending by poly,
+     * into one list in the order a single thread finds them.
+     */
+    model_t *result = NULL;
+    int total = 0, t, best;
+    int *next = NULL;
+
+    for (t = 0; t < threads; ++t)
+        total += jobs[t].resc;
+    if (!total)
+        return NULL;
+    if (!(result = malloc(total * sizeof(model_t))) || !(next = calloc(threads, sizeof(int)))) {
+        free(result);
+        uerror("cannot reallocate result array");
+        return NULL;
+    }
+
+    while (*resc < total) {
+        best = -1;
+        for (t = 0; t < threads; ++t) {
+            if (next[t] == jobs[t].resc)
+                continue;
+            if (best < 0 || pcmp(&jobs[t].result[next[t]].spoly, &jobs[best].result[next[best]].spoly) < 0)
+                best = t;
+        }
+        /* every model of one poly comes from the same thread */
+        do {
+            result[(*resc)++] = jobs[best].result[next[best]++];
+        } while (next[best] < jobs[best].resc && !pcmp(&jobs[best].result[next[best]].spoly, &result[*resc - 1].spoly));
+    }
+    for (t = 0; t < threads; ++t)
+        free(jobs[t].result);
+    free(next);
+    return result;
+}
+
 static poly_t *
 modpol(const poly_t init, int rflags, int args, const poly_t *argpolys) {
     /* Produce, in ascending length order, a list of differences
@@ -498,6 +622,7 @@ chkres(int *resc, model_t **result, const poly_t divisor, const poly_t init, int
     /* compute check value for this model */
     mcheck(rptr);
 
-    /* callback to notify new model */
-    ufound(rptr);
+    /* callback to notify new model, reveng() does it after a threaded search */
+    if (!rdefer)
+        ufound(rptr);
 }
@@ -219,6 +219,7 @@ void mmatch(model_t *model, int flags);
 #define R_SPMASK 0x7FFFFFFUL
 
 model_t *reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys);
+void setthreads(int threads);
 
 /* cli.c */
 #define C_INFILE  1
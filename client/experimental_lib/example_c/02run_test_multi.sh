@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# without hardware, against simulated devices:
+#   python3 ../../../tools/pm3_simdev.py --port 18888 & python3 ../../../tools/pm3_simdev.py --port 18889 &
+#   LD_LIBRARY_PATH=../build ./test_multi tcp:localhost:18888 tcp:localhost:18889
+
+LD_LIBRARY_PATH=../build ./test_multi /dev/ttyACM0 /dev/ttyACM1
@@ -0,0 +1,119 @@
+#include "pm3.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// One thread per Proxmark3, each grabs the output of its own device.
+// Every device is pinged PINGS times with its own payload length,
+// a reply lost, timed out or with the wrong content counts as a failure.
+// Then every thread loads its own EM410x trace and demods it DEMODS times,
+// the samples are kept per device so each thread must always see its own ID.
+
+#define PINGS 300
+#define DEMODS 50
+#define TRACES_PATH "../../../traces/"
+
+static const struct {
+    const char *file;
+    const char *id;
+} traces[] = {
+    { "lf_EM4102-1.pm3", "010872E77C" },
+    { "lf_EM4102-2.pm3", "010872BEEC" },
+    { "lf_EM4102-3.pm3", "010872E14F" },
+};
+
+typedef struct {
+    pm3 *p;
+    const char *port;
+    int len;
+    int ok;
+    int demod_ok;
+    int res;
+} worker_t;
+
+static void *worker(void *arg) {
+    worker_t *w = (worker_t *)arg;
+
+    char cmd[32];
+    snprintf(cmd, sizeof(cmd), "hw ping -l %d", w->len);
+
+    for (int i = 0; i < PINGS; i++) {
+        w->res = pm3_console(w->p, cmd, true, true);
+        if (w->res != 0) {
+            printf("%s: ping %d returned %d\n", w->port, i, w->res);
+            return NULL;
+        }
+
+        const char *buf = pm3_grabbed_output_get(w->p);
+        if (strstr(buf, "received") != NULL && strstr(buf, "fail") == NULL) {
+            w->ok++;
+        } else {
+            printf("%s: ping %d\n%s", w->port, i, buf);
+        }
+    }
+
+    int t = (w->len - 32) % (sizeof(traces) / sizeof(traces[0]));
+    char load[256];
+    snprintf(load, sizeof(load), "data load -f " TRACES_PATH "%s", traces[t].file);
+
+    for (int i = 0; i < DEMODS; i++) {
+        pm3_console(w->p, load, true, true);
+        w->res = pm3_console(w->p, "lf em 410x demod", true, true);
+        const char *buf = pm3_grabbed_output_get(w->p);
+        if (w->res == 0 && strstr(buf, traces[t].id) != NULL) {
+            w->demod_ok++;
+        } else {
+            printf("%s: demod %d returned %d\n%s", w->port, i, w->res, buf);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 3) {
+        printf("Usage: %s <port> <port> [<port>...]\n", argv[0]);
+        exit(-1);
+    }
+
+    int n = argc - 1;
+    worker_t *w = calloc(n, sizeof(worker_t));
+    pthread_t *t = calloc(n, sizeof(pthread_t));
+    if (w == NULL || t == NULL) {
+        exit(-1);
+    }
+
+    for (int i = 0; i < n; i++) {
+        w[i].port = argv[i + 1];
+        w[i].len = 32 + i;
+        w[i].p = pm3_open(w[i].port);
+        if (w[i].p == NULL) {
+            printf("%s: cannot open\n", w[i].port);
+            exit(-1);
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        pthread_create(&t[i], NULL, worker, &w[i]);
+    }
+    for (int i = 0; i < n; i++) {
+        pthread_join(t[i], NULL);
+    }
+
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        printf("%s: %d / %d pings ok, %d / %d demods ok\n", w[i].port, w[i].ok, PINGS, w[i].demod_ok, DEMODS);
+        if (w[i].ok != PINGS || w[i].demod_ok != DEMODS) {
+            failed++;
+        }
+    }
+
+    // the first device goes last
+    for (int i = n - 1; i >= 0; i--) {
+        pm3_close(w[i].p);
+    }
+    free(t);
+    free(w);
+    return (failed) ? -1 : 0;
+}
@@ -23,6 +23,11 @@ typedef struct pm3_device pm3;
 pm3 *pm3_open(const char *port);
 int pm3_console(pm3 *dev, const char *cmd, bool capture, bool quiet);
 const char *pm3_grabbed_output_get(pm3 *dev);
+// captured output as json records, one per output line: {"level":..,"text":..[,"key":..,"value":..]}
+// only filled while capture_records is enabled, off by default
+const char *pm3_grabbed_records_get(pm3 *dev);
+bool pm3_capture_records_get(pm3 *dev);
+void pm3_capture_records_set(pm3 *dev, bool enable);
 const char *pm3_name_get(pm3 *dev);
 void pm3_close(pm3 *dev);
 pm3 *pm3_get_current_dev(void);
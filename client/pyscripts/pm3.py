@@ -70,6 +70,8 @@ class pm3(object):
         return _pm3.pm3_console(self, cmd, capture, quiet)
     name = property(_pm3.pm3_name_get)
     grabbed_output = property(_pm3.pm3_grabbed_output_get)
+    grabbed_records = property(_pm3.pm3_grabbed_records_get)
+    capture_records = property(_pm3.pm3_capture_records_get, _pm3.pm3_capture_records_set)
 
 # Register pm3 in _pm3:
 _pm3.pm3_swigregister(pm3)
@@ -58,28 +58,6 @@ static int closeAIDFile(json_t *root) {
     return PM3_SUCCESS;
 }
 
-json_t *AIDSearchInit(bool verbose) {
-    json_t *root = NULL;
-    int res = openAIDFile(&root, verbose);
-    if (res != PM3_SUCCESS)
-        return NULL;
-
-    return root;
-}
-
-json_t *AIDSearchGetElm(json_t *root, size_t elmindx) {
-    json_t *data = json_array_get(root, elmindx);
-    if (!json_is_object(data)) {
-        PrintAndLogEx(ERR, "data [%zu] is not an object\n", elmindx);
-        return NULL;
-    }
-    return data;
-}
-
-int AIDSearchFree(json_t *root) {
-    return closeAIDFile(root);
-}
-
 static const char *jsonStrGet(json_t *data, const char *name) {
     json_t *jstr;
 
@@ -97,6 +75,137 @@ static const char *jsonStrGet(json_t *data, const char *name) {
     return cstr;
 }
 
+// aidlist.json is parsed once and kept for the lifetime of the client.
+// A nibble trie over the AIDs gives the longest prefix match in O(len).
+typedef struct {
+    int32_t child[16];
+    int32_t elmindx;    // first element whose AID ends here, -1 if none
+} aid_trie_node_t;
+
+static json_t *aid_root = NULL;
+static aid_trie_node_t *aid_trie = NULL;
+static size_t aid_trie_len = 0;
+static size_t aid_trie_size = 0;
+
+static int aidNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int32_t aidTrieNewNode(void) {
+    if (aid_trie_len == aid_trie_size) {
+        size_t newsize = (aid_trie_size) ? aid_trie_size * 2 : 1024;
+        aid_trie_node_t *tmp = realloc(aid_trie, newsize * sizeof(aid_trie_node_t));
+        if (tmp == NULL) {
+            return -1;
+        }
+        aid_trie = tmp;
+        aid_trie_size = newsize;
+    }
+    aid_trie_node_t *node = &aid_trie[aid_trie_len];
+    memset(node->child, 0xff, sizeof(node->child));
+    node->elmindx = -1;
+    return aid_trie_len++;
+}
+
+static void aidTrieFree(void) {
+    free(aid_trie);
+    aid_trie = NULL;
+    aid_trie_len = 0;
+    aid_trie_size = 0;
+}
+
+static bool aidTrieBuild(json_t *root) {
+    aidTrieFree();
+    if (aidTrieNewNode() < 0) {
+        return false;
+    }
+
+    for (size_t elmindx = 0; elmindx < json_array_size(root); elmindx++) {
+        json_t *data = json_array_get(root, elmindx);
+        if (!json_is_object(data))
+            continue;
+        const char *dictaid = jsonStrGet(data, "AID");
+        if (dictaid == NULL)
+            continue;
+
+        int32_t n = 0;
+        for (const char *c = dictaid; *c && n >= 0; c++) {
+            int nib = aidNibble(*c);
+            if (nib < 0) {
+                n = -1;
+                break;
+            }
+            if (aid_trie[n].child[nib] < 0) {
+                int32_t child = aidTrieNewNode();
+                if (child < 0) {
+                    aidTrieFree();
+                    return false;
+                }
+                aid_trie[n].child[nib] = child;
+            }
+            n = aid_trie[n].child[nib];
+        }
+
+        // keep the first one on duplicates, like the linear search did
+        if (n > 0 && aid_trie[n].elmindx < 0) {
+            aid_trie[n].elmindx = elmindx;
+        }
+    }
+
+    PrintAndLogEx(DEBUG, "AID index " _GREEN_("%zu") " nodes", aid_trie_len);
+    return true;
+}
+
+// longest AID from the list which is a prefix of (or equal to) aid
+static json_t *aidTrieLookup(const char *aid) {
+    json_t *elm = NULL;
+    int32_t n = 0;
+    for (const char *c = aid; *c; c++) {
+        int nib = aidNibble(*c);
+        if (nib < 0)
+            break;
+        n = aid_trie[n].child[nib];
+        if (n < 0)
+            break;
+        if (aid_trie[n].elmindx >= 0)
+            elm = json_array_get(aid_root, aid_trie[n].elmindx);
+    }
+    return elm;
+}
+
+json_t *AIDSearchInit(bool verbose) {
+    if (aid_root == NULL) {
+        json_t *root = NULL;
+        int res = openAIDFile(&root, verbose);
+        if (res != PM3_SUCCESS)
+            return NULL;
+
+        aid_root = root;
+        if (aidTrieBuild(aid_root) == false) {
+            PrintAndLogEx(DEBUG, "AID index failed, using linear search");
+        }
+    }
+
+    // callers release their reference with AIDSearchFree, the cache keeps its own
+    return json_incref(aid_root);
+}
+
+json_t *AIDSearchGetElm(json_t *root, size_t elmindx) {
+    json_t *data = json_array_get(root, elmindx);
+    if (!json_is_object(data)) {
+        PrintAndLogEx(ERR, "data [%zu] is not an object\n", elmindx);
+        return NULL;
+    }
+    return data;
+}
+
+int AIDSearchFree(json_t *root) {
+    return closeAIDFile(root);
+}
+
 static bool aidCompare(const char *aidlarge, const char *aidsmall) {
     if (strcmp(aidlarge, aidsmall) == 0)
         return true;
@@ -132,15 +241,19 @@ int PrintAIDDescription(json_t *xroot, char *aid, bool verbose) {
 
     json_t *elm = NULL;
     size_t maxaidlen = 0;
-    for (size_t elmindx = 0; elmindx < json_array_size(root); elmindx++) {
-        json_t *data = AIDSearchGetElm(root, elmindx);
-        if (data == NULL)
-            continue;
-        const char *dictaid = jsonStrGet(data, "AID");
-        if (aidCompare(aid, dictaid)) {  // dictaid may be less length than requested aid
-            if (maxaidlen < strlen(dictaid) && strlen(dictaid) <= strlen(aid)) {
-                maxaidlen = strlen(dictaid);
-                elm = data;
+    if (root == aid_root && aid_trie != NULL) {
+        elm = aidTrieLookup(aid);
+    } else {
+        for (size_t elmindx = 0; elmindx < json_array_size(root); elmindx++) {
+            json_t *data = AIDSearchGetElm(root, elmindx);
+            if (data == NULL)
+                continue;
+            const char *dictaid = jsonStrGet(data, "AID");
+            if (aidCompare(aid, dictaid)) {  // dictaid may be less length than requested aid
+                if (maxaidlen < strlen(dictaid) && strlen(dictaid) <= strlen(aid)) {
+                    maxaidlen = strlen(dictaid);
+                    elm = data;
+                }
             }
         }
     }
@@ -18,52 +18,144 @@
 #include "atrs.h"
 #include <string.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
 #include "commonutil.h" // ARRAYLEN
-#include "ui.h"         // PrintAndLogEx
 
-// get a ATR description based on the atr bytes
-// returns description of the best match
-const char *getAtrInfo(const char *atr_str) {
+// number of real entries, the last element of AtrTable is the default
+#define ATR_ENTRIES (ARRAYLEN(AtrTable) - 1)
 
-    size_t slen = strlen(atr_str);
-    int match = -1;
+// Lookup index over AtrTable, built once on first use.
+// Entries without wildcard are sorted by length and bytes for a binary search,
+// entries with wildcard ('.') are grouped by length and keep their table order.
+static uint16_t atr_len[ATR_ENTRIES];
+static uint16_t atr_exact[ATR_ENTRIES];
+static uint16_t atr_wild[ATR_ENTRIES];
+static size_t atr_exact_cnt = 0;
+static size_t atr_wild_cnt = 0;
+static pthread_once_t atr_index_once = PTHREAD_ONCE_INIT;
+
+static int atr_exact_cmp(const void *a, const void *b) {
+    uint16_t ia = *(const uint16_t *)a;
+    uint16_t ib = *(const uint16_t *)b;
+    if (atr_len[ia] != atr_len[ib]) {
+        return (atr_len[ia] < atr_len[ib]) ? -1 : 1;
+    }
+    int res = memcmp(AtrTable[ia].bytes, AtrTable[ib].bytes, atr_len[ia]);
+    if (res) {
+        return res;
+    }
+    // duplicates, first one in the table wins
+    return (ia < ib) ? -1 : (ia > ib);
+}
 
-    // skip last element of AtrTable
-    for (size_t i = 0; i < ARRAYLEN(AtrTable) - 1; ++i) {
+static int atr_wild_cmp(const void *a, const void *b) {
+    uint16_t ia = *(const uint16_t *)a;
+    uint16_t ib = *(const uint16_t *)b;
+    if (atr_len[ia] != atr_len[ib]) {
+        return (atr_len[ia] < atr_len[ib]) ? -1 : 1;
+    }
+    return (ia < ib) ? -1 : (ia > ib);
+}
 
-        if (strlen(AtrTable[i].bytes) != slen) {
-            continue;
+static void atr_build_index(void) {
+    for (uint16_t i = 0; i < ATR_ENTRIES; i++) {
+        atr_len[i] = strlen(AtrTable[i].bytes);
+        if (strchr(AtrTable[i].bytes, '.') != NULL) {
+            atr_wild[atr_wild_cnt++] = i;
+        } else {
+            atr_exact[atr_exact_cnt++] = i;
         }
+    }
+    qsort(atr_exact, atr_exact_cnt, sizeof(uint16_t), atr_exact_cmp);
+    qsort(atr_wild, atr_wild_cnt, sizeof(uint16_t), atr_wild_cmp);
+}
 
-        if (strstr(AtrTable[i].bytes, ".") != NULL) {
+static int atr_key_cmp(uint16_t idx, const char *atr_str, size_t slen) {
+    if (atr_len[idx] != slen) {
+        return (atr_len[idx] < slen) ? -1 : 1;
+    }
+    return memcmp(AtrTable[idx].bytes, atr_str, slen);
+}
 
-            char *tmp_atr = calloc(slen, sizeof(uint8_t));
-            if (tmp_atr == NULL) {
-                PrintAndLogEx(FAILED, "failed to allocate memory");
-                return NULL;
-            }
+static bool atr_wild_match(const char *pattern, const char *atr_str, size_t slen) {
+    for (size_t j = 0; j < slen; j++) {
+        if (pattern[j] != '.' && pattern[j] != atr_str[j]) {
+            return false;
+        }
+    }
+    return true;
+}
 
-            for (size_t j = 0; j < slen; j++) {
-                tmp_atr[j] = (AtrTable[i].bytes[j] == '.') ? '.' : atr_str[j];
-            }
+// returns the AtrTable index of the best match, or -1
+static int atr_lookup(const char *atr_str) {
 
-            if (strncmp(tmp_atr, AtrTable[i].bytes, slen) == 0) {
-                // record partial match but continue looking for full match
-                match = i;
-            }
-            free(tmp_atr);
+    size_t slen = strlen(atr_str);
 
+    // full match, lower bound in the sorted exact entries
+    size_t lo = 0, hi = atr_exact_cnt;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (atr_key_cmp(atr_exact[mid], atr_str, slen) < 0) {
+            lo = mid + 1;
         } else {
-            if (strncmp(atr_str, AtrTable[i].bytes, slen) == 0) {
-                return AtrTable[i].desc;
-            }
+            hi = mid;
         }
     }
+    if (lo < atr_exact_cnt && atr_key_cmp(atr_exact[lo], atr_str, slen) == 0) {
+        return atr_exact[lo];
+    }
 
+    // partial match, the last matching wildcard entry in table order wins
+    lo = 0;
+    hi = atr_wild_cnt;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (atr_len[atr_wild[mid]] <= slen) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (size_t i = lo; i > 0 && atr_len[atr_wild[i - 1]] == slen; i--) {
+        uint16_t idx = atr_wild[i - 1];
+        if (atr_wild_match(AtrTable[idx].bytes, atr_str, slen)) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+// get a ATR description based on the atr bytes
+// returns description of the best match
+const char *getAtrInfo(const char *atr_str) {
+
+    pthread_once(&atr_index_once, atr_build_index);
+
+    int match = atr_lookup(atr_str);
     if (match >= 0) {
         return AtrTable[match].desc;
     } else {
         //No match, return default = last element of AtrTable
-        return AtrTable[ARRAYLEN(AtrTable) - 1].desc;
+        return AtrTable[ATR_ENTRIES].desc;
+    }
+}
+
+// look up many ATRs at once, descs[i] gets the description of atr_strs[i]
+// returns the number of ATRs found in the table
+size_t getAtrInfoBatch(const char **atr_strs, const char **descs, size_t count) {
+
+    pthread_once(&atr_index_once, atr_build_index);
+
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++) {
+        int match = atr_lookup(atr_strs[i]);
+        if (match >= 0) {
+            descs[i] = AtrTable[match].desc;
+            found++;
+        } else {
+            descs[i] = AtrTable[ATR_ENTRIES].desc;
+        }
     }
+    return found;
 }
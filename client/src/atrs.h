@@ -30,6 +30,7 @@ typedef struct atr_s {
 } atr_t;
 
 const char *getAtrInfo(const char *atr_str);
+size_t getAtrInfoBatch(const char **atr_strs, const char **descs, size_t count);
 
 // atr_t array is expected to be NULL terminated
 const static atr_t AtrTable[] = {
@@ -29,6 +29,8 @@
 #include "crc.h"
 #include "crc16.h"        // crc16 ccitt
 #include "crc32.h"        // crc32_ex
+#include "crc64.h"
+#include "util_posix.h"     // msclock
 #include "legic_prng.h"
 #include "cmddata.h"      // g_DemodBuffer
 #include "graph.h"
@@ -272,26 +274,150 @@ static int CmdAnalyseLRC(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+#define CRC_BENCH_SIZE   (1024 * 1024)
+#define CRC_BENCH_FRAME  16
+
+static int crc_bench(uint32_t iter) {
+
+    if (iter == 0) {
+        iter = 1;
+    }
+
+    uint8_t *buf = calloc(CRC_BENCH_SIZE, sizeof(uint8_t));
+    if (buf == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    uint32_t lfsr = 0x2545F491;
+    for (size_t i = 0; i < CRC_BENCH_SIZE; i++) {
+        lfsr ^= lfsr << 13;
+        lfsr ^= lfsr >> 17;
+        lfsr ^= lfsr << 5;
+        buf[i] = lfsr & 0xFF;
+    }
+
+    // catalogue check values, then the table kernels against the bit loop over the whole buffer
+    const uint8_t check[] = "123456789";
+    uint8_t c32[4] = {0};
+    crc32_ex(check, 9, c32);
+    uint64_t c64 = 0, c64_whole = 0, c64_parts = 0;
+    crc64(check, 9, &c64);
+    crc64(buf, CRC_BENCH_SIZE, &c64_whole);
+    for (size_t i = 0; i < CRC_BENCH_SIZE; i += 7) {
+        crc64(buf + i, MIN(7, CRC_BENCH_SIZE - i), &c64_parts);
+    }
+
+    bool ok = (crc16_a(check, 9) == 0xBF05)
+              && (crc16_x25(check, 9) == 0x906E)
+              && (crc16_xmodem(check, 9) == 0x31C3)
+              && (crc16_kermit(check, 9) == 0x2189)
+              && (crc16_ccitt(check, 9) == 0x29B1)
+              && (MemLeToUint4byte(c32) == 0x340BC6D9)  // CRC-32/JAMCRC, desfire has no xorout
+              && (c64 == 0x6C40DF5F0B497347)
+              && (c64_whole == c64_parts)
+              && (crc16_a(buf, CRC_BENCH_SIZE) == Crc16(buf, CRC_BENCH_SIZE, 0xC6C6, CRC16_POLY_CCITT, true, true))
+              && (crc16_xmodem(buf, CRC_BENCH_SIZE) == Crc16(buf, CRC_BENCH_SIZE, 0x0000, CRC16_POLY_CCITT, false, false))
+              && (crc16_kermit(buf, CRC_BENCH_SIZE - 3) == Crc16(buf, CRC_BENCH_SIZE - 3, 0x0000, CRC16_POLY_CCITT, true, true))
+              && (crc16_philips(buf, CRC_BENCH_SIZE - 5) == Crc16(buf, CRC_BENCH_SIZE - 5, 0x49A3, CRC16_POLY_CCITT, false, false))
+              && (crc16_legic(buf, CRC_BENCH_SIZE - 1, 0x55) == Crc16(buf, CRC_BENCH_SIZE - 1, 0x5555, CRC16_POLY_LEGIC_16, true, false))
+              && (crc16_fast(CRC_LEGIC, buf, CRC_BENCH_SIZE, 0x1234, true) == Crc16(buf, CRC_BENCH_SIZE, 0x1234, CRC16_POLY_LEGIC, true, true));
+
+    PrintAndLogEx(INFO, "CRC benchmark, " _YELLOW_("%u") " x " _YELLOW_("%u") " kB", iter, CRC_BENCH_SIZE / 1024);
+
+    uint64_t sink = 0;
+    uint64_t t1 = msclock();
+    for (uint32_t i = 0; i < iter; i++) {
+        sink += Crc16(buf, CRC_BENCH_SIZE, 0xC6C6, CRC16_POLY_CCITT, true, true);
+    }
+    uint64_t ms_bit = msclock() - t1;
+
+    t1 = msclock();
+    for (uint32_t i = 0; i < iter; i++) {
+        sink += crc16_a(buf, CRC_BENCH_SIZE);
+    }
+    uint64_t ms_a = msclock() - t1;
+
+    t1 = msclock();
+    for (uint32_t i = 0; i < iter; i++) {
+        sink += crc16_xmodem(buf, CRC_BENCH_SIZE);
+    }
+    uint64_t ms_xmodem = msclock() - t1;
+
+    t1 = msclock();
+    for (uint32_t i = 0; i < iter; i++) {
+        crc32_ex(buf, CRC_BENCH_SIZE, c32);
+        sink += c32[0];
+    }
+    uint64_t ms_32 = msclock() - t1;
+
+    t1 = msclock();
+    for (uint32_t i = 0; i < iter; i++) {
+        uint64_t c = 0;
+        crc64(buf, CRC_BENCH_SIZE, &c);
+        sink += c;
+    }
+    uint64_t ms_64 = msclock() - t1;
+
+    // short frames with interleaved crc types, like annotating a mixed trace
+    const CrcType_t mixed[] = { CRC_14443_A, CRC_15693, CRC_FELICA, CRC_LEGIC_16, CRC_ICLASS, CRC_14443_B };
+    size_t frames = CRC_BENCH_SIZE / CRC_BENCH_FRAME;
+    t1 = msclock();
+    for (uint32_t i = 0; i < iter; i++) {
+        for (size_t f = 0; f < frames; f++) {
+            CrcType_t ct = mixed[f % ARRAYLEN(mixed)];
+            sink += (ct == CRC_LEGIC_16) ? crc16_legic(buf + f * CRC_BENCH_FRAME, CRC_BENCH_FRAME, 0x55) : check_crc(ct, buf + f * CRC_BENCH_FRAME, CRC_BENCH_FRAME);
+        }
+    }
+    uint64_t ms_mixed = msclock() - t1;
+    free(buf);
+
+    double mb = (double)iter * CRC_BENCH_SIZE / (1024 * 1024);
+    PrintAndLogEx(SUCCESS, "CRC-16 bit loop....... %8.1f MB/s", mb * 1000 / MAX(ms_bit, 1));
+    PrintAndLogEx(SUCCESS, "CRC-16/A.............. %8.1f MB/s", mb * 1000 / MAX(ms_a, 1));
+    PrintAndLogEx(SUCCESS, "CRC-16/XMODEM......... %8.1f MB/s", mb * 1000 / MAX(ms_xmodem, 1));
+    PrintAndLogEx(SUCCESS, "CRC-32................ %8.1f MB/s", mb * 1000 / MAX(ms_32, 1));
+    PrintAndLogEx(SUCCESS, "CRC-64/ECMA........... %8.1f MB/s", mb * 1000 / MAX(ms_64, 1));
+    PrintAndLogEx(SUCCESS, "mixed %2u byte frames.. %8.2f M frames/s", CRC_BENCH_FRAME, (double)iter * frames / 1000 / MAX(ms_mixed, 1));
+    PrintAndLogEx(DEBUG, "sink %" PRIx64, sink);
+
+    if (ok) {
+        PrintAndLogEx(SUCCESS, "self test.............. " _GREEN_("ok"));
+        return PM3_SUCCESS;
+    }
+    PrintAndLogEx(FAILED, "self test.............. " _RED_("fail"));
+    return PM3_ESOFT;
+}
+
 static int CmdAnalyseCRC(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "analyse crc",
                   "A stub method to test different crc implementations inside the PM3 sourcecode.\n"
                   "Just because you figured out the poly, doesn't mean you get the desired output",
-                  "analyse crc -d 137AF00A0A0D"
+                  "analyse crc -d 137AF00A0A0D\n"
+                  "analyse crc --bench       --> CRC-16/32/64 throughput and self test"
                  );
 
     void *argtable[] = {
         arg_param_begin,
-        arg_str1("d", "data", "<hex>", "bytes to calc crc"),
+        arg_str0("d", "data", "<hex>", "bytes to calc crc"),
+        arg_lit0(NULL, "bench", "benchmark the crc kernels"),
+        arg_u64_0(NULL, "iter", "<dec>", "benchmark iterations over 1 MB (def 16)"),
         arg_param_end
     };
-    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
     int dlen = 0;
     uint8_t data[1024] = {0x00};
     int res = CLIParamHexToBuf(arg_get_str(ctx, 1), data, sizeof(data), &dlen);
+    bool bench = arg_get_lit(ctx, 2);
+    uint32_t iter = arg_get_u32_def(ctx, 3, 16);
     CLIParserFree(ctx);
 
-    if (res) {
+    if (bench) {
+        return crc_bench(iter);
+    }
+
+    if (res || dlen == 0) {
         PrintAndLogEx(FAILED, "Error parsing bytes");
         return PM3_EINVARG;
     }
@@ -300,10 +426,8 @@ static int CmdAnalyseCRC(const char *Cmd) {
 
     // 51  f5  7a  d6
     uint8_t uid[] = {0x51, 0xf5, 0x7a, 0xd6}; //12 34 56
-    init_table(CRC_LEGIC);
     uint8_t legic8 = CRC8Legic(uid, sizeof(uid)) & 0xFF;
     PrintAndLogEx(INFO, "Legic 16 | %X (EF6F expected) [legic8 = %02x]", crc16_legic(data, (size_t)dlen, legic8), legic8);
-    init_table(CRC_FELICA);
     PrintAndLogEx(INFO, "FeliCa | %X ", crc16_xmodem(data, (size_t)dlen));
 
     PrintAndLogEx(INFO, "\nTests of reflection. Current methods in source code");
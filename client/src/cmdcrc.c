@@ -23,6 +23,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <math.h>
+#include <inttypes.h>
+#include <pthread.h>
 
 #ifdef _WIN32
 #  include <io.h>
@@ -36,8 +39,11 @@
 #include "ui.h"
 #include "util.h"
 #include "pm3_cmd.h"
+#include "commonutil.h"   // reflect
+#include "fileutils.h"
+#include "util_posix.h"   // msclock
 
-#define MAX_ARGS 20
+#define MAX_ARGS 64
 
 static int split(char *str, char *arr[MAX_ARGS]) {
     int beginIndex = 0;
@@ -50,6 +56,13 @@ static int split(char *str, char *arr[MAX_ARGS]) {
         if (str[beginIndex] == '\0') {
             break;
         }
+        // more words than we can hold, don't silently drop the rest
+        if (wordCnt == MAX_ARGS) {
+            for (int i = 0; i < wordCnt; i++) {
+                free(arr[i]);
+            }
+            return -1;
+        }
         int endIndex = beginIndex;
         while (str[endIndex] && !isspace(str[endIndex])) {
             ++endIndex;
@@ -59,8 +72,6 @@ static int split(char *str, char *arr[MAX_ARGS]) {
         memcpy(tmp, &str[beginIndex], len);
         arr[wordCnt++] = tmp;
         beginIndex = endIndex;
-        if (wordCnt == MAX_ARGS)
-            break;
     }
     return wordCnt;
 }
@@ -398,138 +409,376 @@ static int CmdrevengTestC(const char *Cmd) {
     return 1;
 }
 */
-//returns a calloced string (needs to be freed)
-static char *SwapEndianStr(const char *inStr, const size_t len, const uint8_t blockSize) {
-    char *tmp = calloc(len + 1, sizeof(char));
-    for (uint8_t block = 0; block < (uint8_t)(len / blockSize); block++) {
-        for (size_t i = 0; i < blockSize; i += 2) {
-            tmp[i + (blockSize * block)] = inStr[(blockSize - 1 - i - 1) + (blockSize * block)];
-            tmp[i + (blockSize * block) + 1] = inStr[(blockSize - 1 - i) + (blockSize * block)];
+// Compiled catalogue of the reveng presets.
+// Every model up to 64 bits wide gets a table driven engine for the forward and the
+// reversed (reveng -v) calculation, matching what RunModel() prints bit for bit.
+// Wider models (CRC-82/DARC) are left to RunModel().
+typedef struct {
+    bool reflected;     // register runs lsb first on reflected input bytes
+    bool backwards;     // message is fed from its last byte to its first
+    bool mirror;        // remainder is mirrored before printing
+    uint64_t init;      // start value, in the register's own bit order
+    uint64_t xorout;    // xored into the remainder
+    uint64_t table[256];
+} crc_engine_t;
+
+typedef struct {
+    char *name;
+    uint8_t width;      // 0 if wider than 64 bits
+    uint8_t nbytes;     // crc bytes at the end of a frame
+    bool rtjust;
+    bool refout;
+    crc_engine_t engine[2];
+} crc_model_t;
+
+// widest preset, CRC-82/DARC
+#define CRC_MAX_BYTES   ((82 + 7) / 8)
+
+static crc_model_t *gs_crc_models = NULL;
+static int gs_crc_models_cnt = 0;
+
+static uint64_t crc_reflect(uint64_t v, uint8_t width) {
+    return reflect64(v) >> (64 - width);
+}
+
+static uint64_t poly_to_u64(const poly_t p) {
+    uint64_t v = 0;
+    for (unsigned long i = 0; i < plen(p); i++) {
+        v = (v << 1) | ((p.bitmap[i / BMP_BIT] >> (BMP_BIT - 1 - (i % BMP_BIT))) & 1);
+    }
+    return v;
+}
+
+static void crc_engine_init(crc_engine_t *e, uint8_t width, uint64_t poly, uint64_t init, uint64_t xorout, bool reflected, bool backwards, bool mirror) {
+    e->reflected = reflected;
+    e->backwards = backwards;
+    e->mirror = mirror;
+    e->xorout = xorout;
+    if (reflected) {
+        uint64_t rpoly = crc_reflect(poly, width);
+        for (int i = 0; i < 256; i++) {
+            uint64_t c = i;
+            for (int j = 0; j < 8; j++) {
+                c = (c & 1) ? (c >> 1) ^ rpoly : (c >> 1);
+            }
+            e->table[i] = c;
+        }
+        e->init = crc_reflect(init, width);
+    } else {
+        // msb aligned to bit 63, so widths under 8 work the same
+        uint64_t tpoly = poly << (64 - width);
+        for (int i = 0; i < 256; i++) {
+            uint64_t c = (uint64_t)i << 56;
+            for (int j = 0; j < 8; j++) {
+                c = (c >> 63) ? (c << 1) ^ tpoly : (c << 1);
+            }
+            e->table[i] = c;
         }
+        e->init = init << (64 - width);
     }
-    return tmp;
 }
 
-// takes hex string in and searches for a matching result (hex string must include checksum)
-static int CmdrevengSearch(const char *Cmd) {
+static uint64_t crc_engine_run(const crc_engine_t *e, uint8_t width, const uint8_t *d, size_t n) {
+    uint64_t reg = e->init, rem;
+    if (e->reflected) {
+        for (size_t i = 0; i < n; i++) {
+            uint8_t b = e->backwards ? d[n - 1 - i] : d[i];
+            reg = (reg >> 8) ^ e->table[(reg ^ b) & 0xFF];
+        }
+        rem = crc_reflect(reg, width);
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            uint8_t b = e->backwards ? d[n - 1 - i] : d[i];
+            reg = (reg << 8) ^ e->table[(reg >> 56) ^ b];
+        }
+        rem = reg >> (64 - width);
+    }
+    rem ^= e->xorout;
+    return e->mirror ? crc_reflect(rem, width) : rem;
+}
 
-#define NMODELS 106
+// remainder to the bytes reveng prints, see pxsubs()
+static void crc_model_bytes(const crc_model_t *m, uint64_t rem, uint8_t *out) {
+    uint64_t v = m->rtjust ? rem : rem << (m->nbytes * 8 - m->width);
+    for (int i = 0; i < m->nbytes; i++) {
+        out[i] = (v >> (8 * (m->nbytes - 1 - i))) & 0xFF;
+        if (m->refout) {
+            out[i] = reflect8(out[i]);
+        }
+    }
+}
 
-    char inHexStr[256] = {0x00};
-    int dataLen = param_getstr(Cmd, 0, inHexStr, sizeof(inHexStr));
-    if (dataLen < 4) return 0;
+static int crc_models_load(void) {
 
-    // these two arrays, must match preset size.
-    char *Models[NMODELS];
-    uint8_t width[NMODELS] = {0};
-    int count = 0;
+    if (gs_crc_models) {
+        return gs_crc_models_cnt;
+    }
 
-    char result[50 + 1] = {0};
-    char revResult[50 + 1] = {0};
-    int ans = GetModels(Models, &count, width);
-    bool found = false;
-    if (!ans) {
-        for (int i = 0; i < count; i++) {
-            free(Models[i]);
-        }
+    SETBMP();
+    int cnt = mcount();
+    if (cnt == 0) {
         return 0;
     }
 
-    str_lower(inHexStr);
+    gs_crc_models = calloc(cnt, sizeof(crc_model_t));
+    if (gs_crc_models == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return 0;
+    }
 
-    // try each model and get result
-    for (int i = 0; i < count; i++) {
-        /*if (found) {
-            free(Models[i]);
+    model_t model = MZERO;
+    for (int i = 0; i < cnt; i++) {
+        mbynum(&model, i);
+        mcanon(&model);
+
+        crc_model_t *m = &gs_crc_models[gs_crc_models_cnt];
+        unsigned long width = plen(model.spoly);
+        if (model.name == NULL || width == 0) {
+            continue;
+        }
+        if (width > CRC_MAX_BYTES * 8) {
             continue;
-        }*/
-        // round up to # of characters in this model's crc
-        uint8_t crcChars = ((width[i] + 7) / 8) * 2;
-        // can't test a model that has more crc digits than our data
-        if (crcChars >= dataLen) {
-            free(Models[i]);
+        }
+        m->name = strdup(model.name);
+        m->nbytes = (width + 7) / 8;
+        gs_crc_models_cnt++;
+        if (width > 64) {
             continue;
         }
 
-        PrintAndLogEx(DEBUG
-                      , "DEBUG: dataLen %d, crcChars %u,  width[i] %u"
-                      , dataLen
-                      , crcChars
-                      , width[i]
-                     );
+        m->width = width;
+        m->rtjust = (model.flags & P_RTJUST);
+        m->refout = (model.flags & P_REFOUT);
+        bool refin = (model.flags & P_REFIN);
+        uint64_t poly = poly_to_u64(model.spoly);
+        uint64_t init = poly_to_u64(model.init);
+        uint64_t xorout = poly_to_u64(model.xorout);
+
+        // Williams model, xorout comes after the refout stage
+        crc_engine_init(&m->engine[0], m->width, poly, init, m->refout ? crc_reflect(xorout, m->width) : xorout, refin, false, false);
+
+        // RunModel(reverse): reciprocal poly, init and xorout swapped, the message bit string reversed
+        uint64_t mask = (m->width == 64) ? UINT64_MAX : ((1ULL << m->width) - 1);
+        uint64_t rpoly = ((crc_reflect(poly, m->width) << 1) & mask) | 1;
+        uint64_t rinit = m->refout ? xorout : crc_reflect(xorout, m->width);
+        uint64_t rxor = m->refout ? init : crc_reflect(init, m->width);
+        crc_engine_init(&m->engine[1], m->width, rpoly, rinit, m->refout ? crc_reflect(rxor, m->width) : rxor, !refin, true, true);
+    }
+    mfree(&model);
+    return gs_crc_models_cnt;
+}
 
-        if (crcChars == 0) {
-            free(Models[i]);
+#define CRC_SEARCH_MAX_FRAMES 100000
+
+typedef struct {
+    const uint8_t *data;
+    uint16_t len;
+} crc_frame_t;
+
+// hits per catalogue entry, [forward, reversed][as is, bytes swapped]
+typedef struct {
+    uint32_t tested;
+    uint32_t hits[2][2];
+    uint8_t value[2][CRC_MAX_BYTES];   // crc of the first frame, as printed
+} crc_search_res_t;
+
+typedef struct {
+    const crc_frame_t *frames;
+    int frames_cnt;
+    crc_search_res_t *res;
+    int next;
+} crc_search_t;
+
+static void crc_search_model(const crc_model_t *m, const crc_frame_t *frames, int frames_cnt, crc_search_res_t *r) {
+    uint8_t calc[CRC_MAX_BYTES];
+    bool first = true;
+    for (int f = 0; f < frames_cnt; f++) {
+        // need at least one byte of data before the crc
+        if (frames[f].len <= m->nbytes) {
             continue;
         }
-
-        memset(result, 0, sizeof(result));
-        char *inCRC = calloc(crcChars + 1, sizeof(char));
-        if (inCRC == NULL) {
-            return 0;
+        const uint8_t *crc = frames[f].data + frames[f].len - m->nbytes;
+        r->tested++;
+        for (int v = 0; v < 2; v++) {
+            crc_model_bytes(m, crc_engine_run(&m->engine[v], m->width, frames[f].data, frames[f].len - m->nbytes), calc);
+            if (first) {
+                memcpy(r->value[v], calc, m->nbytes);
+            }
+            if (memcmp(calc, crc, m->nbytes) == 0) {
+                r->hits[v][0]++;
+            } else if (m->nbytes > 1) {
+                reverse_array(calc, m->nbytes);
+                if (memcmp(calc, crc, m->nbytes) == 0) {
+                    r->hits[v][1]++;
+                }
+            }
         }
+        first = false;
+    }
+}
 
-        memcpy(inCRC, inHexStr + (dataLen - crcChars), crcChars);
+static void *crc_search_thread(void *arg) {
+    crc_search_t *s = (crc_search_t *)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&s->next, 1, __ATOMIC_RELAXED);
+        if (i >= gs_crc_models_cnt) {
+            break;
+        }
+        if (gs_crc_models[i].width) {
+            crc_search_model(&gs_crc_models[i], s->frames, s->frames_cnt, &s->res[i]);
+        }
+    }
+    return NULL;
+}
 
-        char *outHex = calloc(dataLen - crcChars + 1, sizeof(char));
-        if (outHex == NULL) {
-            free(inCRC);
-            return 0;
+// models wider than 64 bits, through the reveng poly engine. Not thread safe.
+static void crc_search_model_slow(const crc_model_t *m, const crc_frame_t *frames, int frames_cnt, crc_search_res_t *r) {
+    char *hex = calloc(UINT16_MAX * 2 + 1, sizeof(char));
+    if (hex == NULL) {
+        return;
+    }
+    uint8_t calc[CRC_MAX_BYTES];
+    bool first = true;
+    for (int f = 0; f < frames_cnt; f++) {
+        if (frames[f].len <= m->nbytes) {
+            continue;
+        }
+        const uint8_t *crc = frames[f].data + frames[f].len - m->nbytes;
+        r->tested++;
+        hex_to_buffer((uint8_t *)hex, frames[f].data, frames[f].len - m->nbytes, UINT16_MAX * 2, 0, 0, false);
+        for (int v = 0; v < 2; v++) {
+            char result[50 + 1] = {0};
+            int len = 0;
+            if (RunModel(m->name, hex, v, 0, result) == 0 || param_gethex_to_eol(result, 0, calc, sizeof(calc), &len) || len != m->nbytes) {
+                continue;
+            }
+            if (first) {
+                memcpy(r->value[v], calc, m->nbytes);
+            }
+            if (memcmp(calc, crc, m->nbytes) == 0) {
+                r->hits[v][0]++;
+            } else {
+                reverse_array(calc, m->nbytes);
+                if (memcmp(calc, crc, m->nbytes) == 0) {
+                    r->hits[v][1]++;
+                }
+            }
         }
+        first = false;
+    }
+    free(hex);
+}
 
-        memcpy(outHex, inHexStr, dataLen - crcChars);
+// lower case, as reveng prints it
+static const char *crc_value_str(const uint8_t *v, uint8_t n) {
+    static char buf[CRC_MAX_BYTES * 2 + 1];
+    memset(buf, 0, sizeof(buf));
+    hex_to_buffer((uint8_t *)buf, v, n, CRC_MAX_BYTES, 0, 0, false);
+    return buf;
+}
 
-        ans = RunModel(Models[i], outHex, false, 0, result);
-        if (ans) {
+static int crc_search(const crc_frame_t *frames, int frames_cnt) {
 
-            str_lower(result);
+    if (crc_models_load() == 0) {
+        PrintAndLogEx(WARNING, "no preset models available");
+        return PM3_ESOFT;
+    }
 
-            // test for match
-            if (memcmp(result, inCRC, crcChars) == 0) {
-                PrintAndLogEx(SUCCESS, "model... " _YELLOW_("%s"), Models[i]);
-                PrintAndLogEx(SUCCESS, "value... %s\n", result);
-                //optional - stop searching if found...
-                found = true;
-            } else {
-                if (crcChars > 2) {
-                    char *swapEndian = SwapEndianStr(result, crcChars, crcChars);
-                    if (memcmp(swapEndian, inCRC, crcChars) == 0) {
-                        PrintAndLogEx(SUCCESS, "model... " _YELLOW_("%s"), Models[i]);
-                        PrintAndLogEx(SUCCESS, "value endian swapped... %s\n", swapEndian);
-                        // optional - stop searching if found...
-                        found = true;
-                    }
-                    free(swapEndian);
-                }
+    crc_search_t s = {
+        .frames = frames,
+        .frames_cnt = frames_cnt,
+        .res = calloc(gs_crc_models_cnt, sizeof(crc_search_res_t)),
+        .next = 0,
+    };
+    if (s.res == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    uint64_t t1 = msclock();
+    int thread_count = MIN(num_CPUs(), gs_crc_models_cnt);
+    pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+    int started = 0;
+    if (threads) {
+        for (; started < thread_count; started++) {
+            if (pthread_create(&threads[started], NULL, crc_search_thread, &s)) {
+                break;
             }
         }
-        ans = RunModel(Models[i], outHex, true, 0, revResult);
-        if (ans) {
-            str_lower(revResult);
+    }
+    // whatever is left runs here
+    crc_search_thread(&s);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
 
-            // test for match
-            if (memcmp(revResult, inCRC, crcChars) == 0) {
-                PrintAndLogEx(SUCCESS, "model reversed... " _YELLOW_("%s"), Models[i]);
-                PrintAndLogEx(SUCCESS, "value... %s\n", revResult);
-                // optional - stop searching if found...
-                found = true;
-            } else {
-                if (crcChars > 2) {
-                    char *swapEndian = SwapEndianStr(revResult, crcChars, crcChars);
-                    if (memcmp(swapEndian, inCRC, crcChars) == 0) {
-                        PrintAndLogEx(SUCCESS, "model reversed... " _YELLOW_("%s"), Models[i]);
-                        PrintAndLogEx(SUCCESS, "value endian swapped... %s\n", swapEndian);
-                        // optional - stop searching if found...
+    for (int i = 0; i < gs_crc_models_cnt; i++) {
+        if (gs_crc_models[i].width == 0) {
+            crc_search_model_slow(&gs_crc_models[i], frames, frames_cnt, &s.res[i]);
+        }
+    }
+    t1 = msclock() - t1;
+
+    bool found = false;
+    const char *dir[] = { "model...", "model reversed..." };
+    if (frames_cnt == 1) {
+        // single frame, same report as always
+        for (int i = 0; i < gs_crc_models_cnt; i++) {
+            const crc_model_t *m = &gs_crc_models[i];
+            for (int v = 0; v < 2; v++) {
+                uint8_t *val = s.res[i].value[v];
+                if (s.res[i].hits[v][0]) {
+                    PrintAndLogEx(SUCCESS, "%s " _YELLOW_("%s"), dir[v], m->name);
+                    PrintAndLogEx(SUCCESS, "value... %s\n", crc_value_str(val, m->nbytes));
+                    found = true;
+                } else if (s.res[i].hits[v][1]) {
+                    reverse_array(val, m->nbytes);
+                    PrintAndLogEx(SUCCESS, "%s " _YELLOW_("%s"), dir[v], m->name);
+                    PrintAndLogEx(SUCCESS, "value endian swapped... %s\n", crc_value_str(val, m->nbytes));
+                    found = true;
+                }
+            }
+        }
+    } else {
+        // many frames, not all of them need to carry a crc. Report what matches well above chance
+        PrintAndLogEx(INFO, "Searched " _YELLOW_("%d") " models against " _YELLOW_("%d") " frames in %" PRIu64 " ms", gs_crc_models_cnt, frames_cnt, t1);
+        for (int i = 0; i < gs_crc_models_cnt; i++) {
+            const crc_model_t *m = &gs_crc_models[i];
+            uint32_t tested = s.res[i].tested;
+            double chance = (double)tested / pow(2, m->width ? m->width : m->nbytes * 8);
+            for (int v = 0; v < 2; v++) {
+                for (int o = 0; o < 2; o++) {
+                    uint32_t hits = s.res[i].hits[v][o];
+                    if (hits < 3 || hits <= 8 * chance) {
+                        continue;
+                    }
+                    if (found == false) {
+                        PrintAndLogEx(SUCCESS, "%-34s %-9s %-8s %s", "model", "variant", "order", "frames");
                         found = true;
                     }
-                    free(swapEndian);
+                    if (hits == tested) {
+                        PrintAndLogEx(SUCCESS, _GREEN_("%-34s") " %-9s %-8s " _GREEN_("%u") " / %u"
+                                      , m->name
+                                      , v ? "reversed" : ""
+                                      , o ? "swapped" : ""
+                                      , hits
+                                      , tested
+                                     );
+                    } else {
+                        PrintAndLogEx(SUCCESS, _YELLOW_("%-34s") " %-9s %-8s %u / %u"
+                                      , m->name
+                                      , v ? "reversed" : ""
+                                      , o ? "swapped" : ""
+                                      , hits
+                                      , tested
+                                     );
+                    }
                 }
             }
         }
-        free(inCRC);
-        free(outHex);
-        free(Models[i]);
     }
+    free(s.res);
 
     if (found == false) {
         PrintAndLogEx(FAILED, "\nno matches found\n");
@@ -537,16 +786,138 @@ static int CmdrevengSearch(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// takes hex string in and searches for a matching result (hex string must include checksum)
+static int CmdrevengSearch(char *argv[], int argc) {
+
+    crc_frame_t *frames = calloc(argc, sizeof(crc_frame_t));
+    if (frames == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    int frames_cnt = 0;
+    for (int i = 0; i < argc; i++) {
+        size_t n = strlen(argv[i]) / 2;
+        uint8_t *d = calloc(n + 1, sizeof(uint8_t));
+        int res = (d == NULL) ? -1 : hex_to_bytes(argv[i], d, n);
+        if (res < 2) {
+            free(d);
+            continue;
+        }
+        frames[frames_cnt].data = d;
+        frames[frames_cnt++].len = res;
+    }
+
+    int res = PM3_EINVARG;
+    if (frames_cnt) {
+        res = crc_search(frames, frames_cnt);
+    } else {
+        PrintAndLogEx(ERR, "no valid frame, expected hex strings of at least 2 bytes each");
+    }
+    for (int i = 0; i < frames_cnt; i++) {
+        free((void *)frames[i].data);
+    }
+    free(frames);
+    return res;
+}
+
+static int crc_frame_cmp(const void *a, const void *b) {
+    const crc_frame_t *fa = a, *fb = b;
+    if (fa->len != fb->len) {
+        return (fa->len < fb->len) ? -1 : 1;
+    }
+    return memcmp(fa->data, fb->data, fa->len);
+}
+
+// every frame of a trace file, both directions
+static int CmdrevengSearchTrace(const char *filename) {
+
+    uint8_t *trace = NULL;
+    size_t trace_len = 0;
+    if (loadFile_safe(filename, ".trace", (void **)&trace, &trace_len) != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "Could not open file " _YELLOW_("%s"), filename);
+        return PM3_EIO;
+    }
+
+    crc_frame_t *frames = calloc(trace_len / TRACELOG_HDR_LEN + 1, sizeof(crc_frame_t));
+    if (frames == NULL) {
+        free(trace);
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    int frames_cnt = 0;
+    size_t pos = 0;
+    while (pos + TRACELOG_HDR_LEN <= trace_len) {
+        if (frames_cnt == CRC_SEARCH_MAX_FRAMES) {
+            PrintAndLogEx(WARNING, "trace has more than %d frames, searching the first %d only", CRC_SEARCH_MAX_FRAMES, CRC_SEARCH_MAX_FRAMES);
+            break;
+        }
+        tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + pos);
+        if (hdr->data_len == 0) {
+            pos += TRACELOG_HDR_LEN;
+            continue;
+        }
+        size_t next = pos + TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr);
+        if (next > trace_len) {
+            break;
+        }
+        if (hdr->data_len >= 2) {
+            frames[frames_cnt].data = hdr->frame;
+            frames[frames_cnt++].len = hdr->data_len;
+        }
+        pos = next;
+    }
+
+    // a repeated frame (polling, ACK) would match the same models each time and
+    // look like a real hit, so every distinct frame counts once
+    if (frames_cnt > 1) {
+        qsort(frames, frames_cnt, sizeof(crc_frame_t), crc_frame_cmp);
+        int uniq = 1;
+        for (int i = 1; i < frames_cnt; i++) {
+            if (crc_frame_cmp(&frames[uniq - 1], &frames[i]) != 0) {
+                frames[uniq++] = frames[i];
+            }
+        }
+        if (uniq < frames_cnt) {
+            PrintAndLogEx(INFO, "%d repeated frames skipped", frames_cnt - uniq);
+        }
+        frames_cnt = uniq;
+    }
+
+    int res = PM3_ENODATA;
+    if (frames_cnt) {
+        res = crc_search(frames, frames_cnt);
+    } else {
+        PrintAndLogEx(WARNING, "no frames in trace");
+    }
+    free(frames);
+    free(trace);
+    return res;
+}
+
 int CmdCrc(const char *Cmd) {
-    char c[100 + 7];
-    snprintf(c, sizeof(c), "reveng ");
-    snprintf(c + strlen(c), sizeof(c) - strlen(c), Cmd, strlen(Cmd));
+    size_t clen = strlen(Cmd) + 8;
+    char *c = calloc(clen, sizeof(char));
+    if (c == NULL) {
+        return PM3_EMALLOC;
+    }
+    snprintf(c, clen, "reveng %s", Cmd);
 
     char *argv[MAX_ARGS];
     int argc = split(c, argv);
+    free(c);
+    if (argc < 0) {
+        PrintAndLogEx(WARNING, "too many arguments, max %d", MAX_ARGS - 1);
+        return PM3_EINVARG;
+    }
+
+    setthreads(num_CPUs());
 
-    if (argc == 3 && memcmp(argv[1], "-g", 2) == 0) {
-        CmdrevengSearch(argv[2]);
+    if (argc == 4 && strcmp(argv[1], "-g") == 0 && strcmp(argv[2], "-f") == 0) {
+        CmdrevengSearchTrace(argv[3]);
+    } else if (argc >= 3 && strcmp(argv[1], "-g") == 0) {
+        CmdrevengSearch(argv + 2, argc - 2);
     } else {
         reveng_main(argc, argv);
     }
@@ -556,4 +927,3 @@ int CmdCrc(const char *Cmd) {
     }
     return PM3_SUCCESS;
 }
-
@@ -18,6 +18,7 @@
 #include "cmddata.h"
 #include <stdio.h>
 #include <string.h>
+#include <dirent.h>
 #include <limits.h>              // for CmdNorm INT_MIN && INT_MAX
 #include <math.h>                // pow
 #include <ctype.h>               // tolower
@@ -42,13 +43,9 @@
 #include "mbedtls/ctr_drbg.h"    // random generator
 #include "atrs.h"                // ATR lookup
 #include "crypto/libpcrypto.h"   // Cryptography
+#include "util_posix.h"          // msclock
 
 
-uint8_t g_DemodBuffer[MAX_DEMOD_BUF_LEN] = { 0x00 };
-size_t g_DemodBufferLen = 0;
-int32_t g_DemodStartIdx = 0;
-int g_DemodClock = 0;
-
 static int CmdHelp(const char *Cmd);
 
 
@@ -418,7 +415,7 @@ int ASKDemod_ext(int clk, int invert, int maxErr, size_t maxlen, bool amplify, b
     if (maxlen == 0)
         maxlen = g_pm3_capabilities.bigbuf_size;
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(INFO, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -429,7 +426,7 @@ int ASKDemod_ext(int clk, int invert, int maxErr, size_t maxlen, bool amplify, b
     PrintAndLogEx(DEBUG, "DEBUG: (ASKDemod_ext) #samples from graphbuff: %zu", bitlen);
 
     if (bitlen < 255) {
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -476,7 +473,7 @@ int ASKDemod_ext(int clk, int invert, int maxErr, size_t maxlen, bool amplify, b
                       , bitlen
                       , clk
                      );
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -486,7 +483,7 @@ int ASKDemod_ext(int clk, int invert, int maxErr, size_t maxlen, bool amplify, b
                       , bitlen
                       , clk
                      );
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -522,7 +519,7 @@ int ASKDemod_ext(int clk, int invert, int maxErr, size_t maxlen, bool amplify, b
     if (emSearch)
         AskEm410xDecode(true, &hi, &lo);
 
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 
@@ -860,7 +857,11 @@ int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveG
     // Computed variance
     double variance = compute_variance(in, len);
 
-    int *correl_buf = calloc(MAX_GRAPH_TRACE_LEN, sizeof(int));
+    int *correl_buf = graph_scratch_alloc(len * sizeof(int));
+    if (correl_buf == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return -1;
+    }
 
     uint8_t peak_cnt = 0;
     size_t peaks[10] = {0};
@@ -915,6 +916,7 @@ int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveG
         }
     } else {
         PrintAndLogEx(HINT, "No repeating pattern found, try increasing window size");
+        graph_scratch_free(correl_buf);
         // return value -1, indication to increase window size
         return -1;
     }
@@ -926,7 +928,7 @@ int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveG
         g_DemodBufferLen = 0;
         RepaintGraphWindow();
     }
-    free(correl_buf);
+    graph_scratch_free(correl_buf);
     return distance;
 }
 
@@ -988,6 +990,10 @@ static int CmdBitsamples(const char *Cmd) {
         return PM3_ETIMEOUT;
     }
 
+    if (graph_reserve(ARRAYLEN(got) * 8) == false) {
+        return PM3_EMALLOC;
+    }
+
     for (size_t j = 0; j < ARRAYLEN(got); j++) {
         for (uint8_t k = 0; k < 8; k++) {
             if (got[j] & (1 << (7 - k)))
@@ -1071,16 +1077,20 @@ static int CmdUndecimate(const char *Cmd) {
     int factor = arg_get_int_def(ctx, 1, 2);
     CLIParserFree(ctx);
 
-    //We have memory, don't we?
-    int *swap = calloc(MAX_GRAPH_TRACE_LEN, sizeof(int));
+    size_t swap_len = MIN(g_GraphTraceLen * factor, MAX_GRAPH_TRACE_LEN);
+    if (graph_reserve(swap_len) == false) {
+        return PM3_EMALLOC;
+    }
+
+    int *swap = graph_scratch_alloc(swap_len * sizeof(int));
     if (swap == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
     }
     uint32_t g_index = 0, s_index = 0;
-    while (g_index < g_GraphTraceLen && s_index + factor < MAX_GRAPH_TRACE_LEN) {
+    while (g_index < g_GraphTraceLen && s_index < swap_len) {
         int count = 0;
-        for (count = 0; count < factor && s_index + count < MAX_GRAPH_TRACE_LEN; count++) {
+        for (count = 0; count < factor && s_index + count < swap_len; count++) {
             swap[s_index + count] = (
                                         (double)(factor - count) / (factor - 1)) * g_GraphBuffer[g_index] +
                                     ((double)count / factor) * g_GraphBuffer[g_index + 1]
@@ -1093,7 +1103,7 @@ static int CmdUndecimate(const char *Cmd) {
     memcpy(g_GraphBuffer, swap, s_index * sizeof(int));
     g_GraphTraceLen = s_index;
     RepaintGraphWindow();
-    free(swap);
+    graph_scratch_free(swap);
     return PM3_SUCCESS;
 }
 
@@ -1166,6 +1176,134 @@ static int CmdAskEdgeDetect(const char *Cmd) {
     return res;
 }
 
+typedef struct {
+    const char *name;
+    int (*detect)(const char *str, bool verbose);
+    int clock;
+    uint64_t us;
+} detectclock_bench_t;
+
+// time the clock detectors on the current GraphBuffer, same calls as a plain `data detectclock`
+static void detectclock_bench_run(detectclock_bench_t *list, size_t n, uint32_t iter) {
+    for (uint32_t i = 0; i < iter; i++) {
+        for (size_t m = 0; m < n; m++) {
+            uint64_t t1 = usclock();
+            list[m].clock = list[m].detect("", false);
+            list[m].us += usclock() - t1;
+        }
+    }
+}
+
+static int cmp_bench_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// GraphBuffer, or every .pm3 capture in dirname when given
+static int detectclock_bench(uint32_t iter, const char *dirname) {
+
+    if (iter == 0) {
+        iter = 1;
+    }
+
+    detectclock_bench_t list[] = {
+        {"FSK", GetFskClock, 0, 0},
+        {"ASK", GetAskClock, 0, 0},
+        {"NRZ", GetNrzClock, 0, 0},
+        {"PSK", GetPskClock, 0, 0},
+    };
+
+    if (dirname == NULL) {
+        if (g_GraphTraceLen == 0) {
+            PrintAndLogEx(WARNING, "GraphBuffer is empty, load a trace first");
+            return PM3_ENODATA;
+        }
+
+        detectclock_bench_run(list, ARRAYLEN(list), iter);
+
+        PrintAndLogEx(INFO, "Clock detection benchmark, " _YELLOW_("%zu") " samples, " _YELLOW_("%u") " iterations", g_GraphTraceLen, iter);
+        uint64_t total = 0;
+        for (size_t m = 0; m < ARRAYLEN(list); m++) {
+            PrintAndLogEx(SUCCESS, "%s Clock... %4d  %10.1f us / run", list[m].name, list[m].clock, (double)list[m].us / iter);
+            total += list[m].us;
+        }
+        PrintAndLogEx(SUCCESS, "total....... " _GREEN_("%.1f") " us / run", (double)total / iter);
+        return PM3_SUCCESS;
+    }
+
+    DIR *dir = opendir(dirname);
+    if (dir == NULL) {
+        PrintAndLogEx(ERR, "can't open directory `" _YELLOW_("%s") "`", dirname);
+        return PM3_EFILE;
+    }
+
+    // sorted, so runs on the same directory can be compared
+    char **names = NULL;
+    size_t cnt = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (str_endswith(de->d_name, ".pm3") == false) {
+            continue;
+        }
+
+        char **tmp = realloc(names, (cnt + 1) * sizeof(char *));
+        if (tmp == NULL) {
+            break;
+        }
+        names = tmp;
+        names[cnt] = strdup(de->d_name);
+        if (names[cnt] != NULL) {
+            cnt++;
+        }
+    }
+    closedir(dir);
+
+    if (cnt == 0) {
+        PrintAndLogEx(WARNING, "no .pm3 files found in `" _YELLOW_("%s") "`", dirname);
+        free(names);
+        return PM3_EFILE;
+    }
+
+    qsort(names, cnt, sizeof(char *), cmp_bench_names);
+
+    PrintAndLogEx(INFO, "Clock detection benchmark, " _YELLOW_("%zu") " files, " _YELLOW_("%u") " iterations", cnt, iter);
+    PrintAndLogEx(INFO, "  FSK      ASK      NRZ      PSK       us / run  samples  file");
+
+    uint64_t total[ARRAYLEN(list)] = {0};
+    size_t samples = 0;
+    for (size_t i = 0; i < cnt; i++) {
+
+        char path[FILE_PATH_SIZE + 256];
+        snprintf(path, sizeof(path), "%s%s%s", dirname, str_endswith(dirname, "/") ? "" : "/", names[i]);
+
+        if (getSamplesFromFile(path, false, false, false) == PM3_SUCCESS) {
+            uint64_t us = 0;
+            for (size_t m = 0; m < ARRAYLEN(list); m++) {
+                list[m].us = 0;
+            }
+            detectclock_bench_run(list, ARRAYLEN(list), iter);
+            for (size_t m = 0; m < ARRAYLEN(list); m++) {
+                total[m] += list[m].us;
+                us += list[m].us;
+            }
+            samples += g_GraphTraceLen;
+            PrintAndLogEx(INFO, "%4d     %4d     %4d     %4d    %10.1f  %7zu  %s"
+                          , list[0].clock, list[1].clock, list[2].clock, list[3].clock
+                          , (double)us / iter, g_GraphTraceLen, names[i]
+                         );
+        }
+        free(names[i]);
+    }
+    free(names);
+
+    uint64_t sum = 0;
+    for (size_t m = 0; m < ARRAYLEN(list); m++) {
+        PrintAndLogEx(SUCCESS, "%s Clock...  %10.1f us / run", list[m].name, (double)total[m] / iter);
+        sum += total[m];
+    }
+    PrintAndLogEx(SUCCESS, "total.......  " _GREEN_("%.1f") " us / run, %zu samples", (double)sum / iter, samples);
+    return PM3_SUCCESS;
+}
+
 // Print our clock rate
 // uses data from graphbuffer
 // adjusted to take char parameter for type of modulation to find the clock - by marshmellow.
@@ -1175,6 +1313,8 @@ static int CmdDetectClockRate(const char *Cmd) {
                   "Detect ASK, FSK, NRZ, PSK clock rate of wave in GraphBuffer",
                   "data detectclock --ask\n"
                   "data detectclock --nzr   --> detect clock of an nrz/direct wave in GraphBuffer\n"
+                  "data detectclock --bench --iter 50   --> time the clock detectors on GraphBuffer\n"
+                  "data detectclock --bench --dir traces   --> time them on every .pm3 capture in a folder\n"
                  );
     void *argtable[] = {
         arg_param_begin,
@@ -1182,6 +1322,9 @@ static int CmdDetectClockRate(const char *Cmd) {
         arg_lit0(NULL, "fsk", "specify FSK modulation clock detection"),
         arg_lit0(NULL, "nzr", "specify NZR/DIRECT modulation clock detection"),
         arg_lit0(NULL, "psk", "specify PSK modulation clock detection"),
+        arg_lit0(NULL, "bench", "benchmark clock detection of all modulations"),
+        arg_u64_0(NULL, "iter", "<dec>", "benchmark iterations (def 20)"),
+        arg_str0(NULL, "dir", "<path>", "benchmark every .pm3 capture in this folder"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1189,8 +1332,22 @@ static int CmdDetectClockRate(const char *Cmd) {
     bool f = arg_get_lit(ctx, 2);
     bool n = arg_get_lit(ctx, 3);
     bool p = arg_get_lit(ctx, 4);
+    bool bench = arg_get_lit(ctx, 5);
+    uint32_t iter = arg_get_u32_def(ctx, 6, 20);
+    int dlen = 0;
+    char dirname[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 7), (uint8_t *)dirname, FILE_PATH_SIZE, &dlen);
     CLIParserFree(ctx);
 
+    if (dlen && bench == false) {
+        PrintAndLogEx(WARNING, "--dir goes with --bench");
+        return PM3_EINVARG;
+    }
+
+    if (bench) {
+        return detectclock_bench(iter, (dlen) ? dirname : NULL);
+    }
+
     int tmp = (a + f + n + p);
     if (tmp > 1) {
         PrintAndLogEx(WARNING, "Only specify one modulation");
@@ -1233,7 +1390,7 @@ static int CmdDetectClockRate(const char *Cmd) {
 }
 
 static char *GetFSKType(uint8_t fchigh, uint8_t fclow, uint8_t invert) {
-    static char fType[8];
+    static __thread char fType[8];
     memset(fType, 0x00, 8);
     char *fskType = fType;
 
@@ -1269,7 +1426,7 @@ int FSKrawDemod(uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, bo
         return PM3_ESOFT;
     }
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -1278,7 +1435,7 @@ int FSKrawDemod(uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, bo
     size_t bitlen = getFromGraphBuffer(bits);
     if (bitlen == 0) {
         PrintAndLogEx(DEBUG, "DEBUG: no data in graphbuf");
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -1325,7 +1482,7 @@ int FSKrawDemod(uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, bo
     }
 
 out:
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 
@@ -1372,14 +1529,14 @@ int PSKDemod(int clk, int invert, int maxErr, bool verbose) {
         return PM3_ESOFT;
     }
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
     }
     size_t bitlen = getFromGraphBuffer(bits);
     if (bitlen == 0) {
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -1387,12 +1544,12 @@ int PSKDemod(int clk, int invert, int maxErr, bool verbose) {
     int errCnt = pskRawDemod_ext(bits, &bitlen, &clk, &invert, &startIdx);
     if (errCnt > maxErr) {
         if (g_debugMode || verbose) PrintAndLogEx(DEBUG, "DEBUG: (PSKdemod) Too many errors found, clk: %d, invert: %d, numbits: %zu, errCnt: %d", clk, invert, bitlen, errCnt);
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
     if (errCnt < 0 || bitlen < 16) { //throw away static - allow 1 and -1 (in case of threshold command first)
         if (g_debugMode || verbose) PrintAndLogEx(DEBUG, "DEBUG: (PSKdemod) no data found, clk: %d, invert: %d, numbits: %zu, errCnt: %d", clk, invert, bitlen, errCnt);
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
     if (verbose || g_debugMode) {
@@ -1404,7 +1561,7 @@ int PSKDemod(int clk, int invert, int maxErr, bool verbose) {
     //prime g_DemodBuffer for output
     setDemodBuff(bits, bitlen, 0);
     setClockGrid(clk, startIdx);
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 
@@ -1422,7 +1579,7 @@ int NRZrawDemod(int clk, int invert, int maxErr, bool verbose) {
         return PM3_ESOFT;
     }
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -1431,19 +1588,19 @@ int NRZrawDemod(int clk, int invert, int maxErr, bool verbose) {
     size_t bitlen = getFromGraphBuffer(bits);
 
     if (bitlen == 0) {
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
     errCnt = nrzRawDemod(bits, &bitlen, &clk, &invert, &clkStartIdx);
     if (errCnt > maxErr) {
         PrintAndLogEx(DEBUG, "DEBUG: (NRZrawDemod) Too many errors found, clk: %d, invert: %d, numbits: %zu, errCnt: %d", clk, invert, bitlen, errCnt);
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
     if (errCnt < 0 || bitlen < 16) { //throw away static - allow 1 and -1 (in case of threshold command first)
         PrintAndLogEx(DEBUG, "DEBUG: (NRZrawDemod) no data found, clk: %d, invert: %d, numbits: %zu, errCnt: %d", clk, invert, bitlen, errCnt);
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -1461,7 +1618,7 @@ int NRZrawDemod(int clk, int invert, int maxErr, bool verbose) {
         printDemodBuff(0, false, invert, false);
     }
 
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 
@@ -1655,6 +1812,10 @@ void setClockGrid(uint32_t clk, int offset) {
     if (offset < 0) offset += clk;
 
     if (offset > g_GraphTraceLen || offset < 0) return;
+
+    // threads searching a copy of the capture leave the plot alone
+    if (graph_plotted() == false) return;
+
     if (clk < 8 || clk > g_GraphTraceLen) {
         g_GridLocked = false;
         g_GridOffset = 0;
@@ -1805,7 +1966,7 @@ int CmdHpf(const char *Cmd) {
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     CLIParserFree(ctx);
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -1818,7 +1979,7 @@ int CmdHpf(const char *Cmd) {
     computeSignalProperties(bits, size);
 
     RepaintGraphWindow();
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 
@@ -1891,6 +2052,9 @@ int getSamplesEx(uint32_t start, uint32_t end, bool verbose, bool ignore_lf_conf
 int getSamplesFromBufEx(uint8_t *data, size_t sample_num, uint8_t bits_per_sample, bool verbose) {
 
     size_t max_num = MIN(sample_num, MAX_GRAPH_TRACE_LEN);
+    if (graph_reserve(max_num) == false) {
+        return PM3_EMALLOC;
+    }
 
     if (bits_per_sample < 8) {
 
@@ -1913,7 +2077,7 @@ int getSamplesFromBufEx(uint8_t *data, size_t sample_num, uint8_t bits_per_sampl
         g_GraphTraceLen = max_num;
     }
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -1921,7 +2085,7 @@ int getSamplesFromBufEx(uint8_t *data, size_t sample_num, uint8_t bits_per_sampl
     size_t size = getFromGraphBuffer(bits);
     // set signal properties low/high/mean/amplitude and is_noise detection
     computeSignalProperties(bits, size);
-    free(bits);
+    graph_scratch_free(bits);
 
     setClockGrid(0, 0);
     g_DemodBufferLen = 0;
@@ -1953,36 +2117,8 @@ static int CmdSamples(const char *Cmd) {
 }
 
 
-static int CmdLoad(const char *Cmd) {
-
-    CLIParserContext *ctx;
-    CLIParserInit(&ctx, "data load",
-                  "This command loads the contents of a pm3 file into graph window\n",
-                  "data load -f myfilename"
-                 );
-
-    void *argtable[] = {
-        arg_param_begin,
-        arg_str1("f", "file", "<fn>", "file to load"),
-        arg_lit0("b", "bin", "binary file"),
-        arg_lit0("n",  "no-fix",  "Load data from file without any transformations"),
-        arg_param_end
-    };
-    CLIExecWithReturn(ctx, Cmd, argtable, false);
-
-    int fnlen = 0;
-    char filename[FILE_PATH_SIZE] = {0};
-    CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
-    bool is_bin = arg_get_lit(ctx, 2);
-    bool nofix = arg_get_lit(ctx, 3);
-    CLIParserFree(ctx);
-
-    char *path = NULL;
-    if (searchFile(&path, TRACES_SUBDIR, filename, ".pm3", true) != PM3_SUCCESS) {
-        if (searchFile(&path, TRACES_SUBDIR, filename, "", false) != PM3_SUCCESS) {
-            return PM3_EFILE;
-        }
-    }
+// load a pm3 sample file (one sample per line) or a binary sample file into the graph buffer
+int getSamplesFromFile(const char *path, bool is_bin, bool nofix, bool verbose) {
 
     FILE *f;
     if (is_bin)
@@ -1992,38 +2128,40 @@ static int CmdLoad(const char *Cmd) {
 
     if (f == NULL) {
         PrintAndLogEx(WARNING, "couldn't open '%s'", path);
-        free(path);
         return PM3_EFILE;
     }
-    free(path);
 
     g_GraphTraceLen = 0;
 
     if (is_bin) {
-        uint8_t val[2];
-        while (fread(val, 1, 1, f)) {
-            g_GraphBuffer[g_GraphTraceLen] = val[0] - 127;
-            g_GraphTraceLen++;
-
-            if (g_GraphTraceLen >= MAX_GRAPH_TRACE_LEN)
+        uint8_t val[4096];
+        size_t n;
+        while ((n = fread(val, 1, sizeof(val), f)) > 0) {
+            if (graph_reserve(g_GraphTraceLen + n) == false)
                 break;
+
+            for (size_t i = 0; i < n; i++) {
+                g_GraphBuffer[g_GraphTraceLen++] = val[i] - 127;
+            }
         }
     } else {
         char line[80];
         while (fgets(line, sizeof(line), f)) {
+            if (graph_reserve(g_GraphTraceLen + 1) == false)
+                break;
+
             g_GraphBuffer[g_GraphTraceLen] = atoi(line);
             g_GraphTraceLen++;
-
-            if (g_GraphTraceLen >= MAX_GRAPH_TRACE_LEN)
-                break;
         }
     }
     fclose(f);
 
-    PrintAndLogEx(SUCCESS, "loaded " _YELLOW_("%s") " samples", commaprint(g_GraphTraceLen));
+    if (verbose) {
+        PrintAndLogEx(SUCCESS, "loaded " _YELLOW_("%s") " samples", commaprint(g_GraphTraceLen));
+    }
 
     if (nofix == false) {
-        uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
+        uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
         if (bits == NULL) {
             PrintAndLogEx(FAILED, "failed to allocate memory");
             return PM3_EMALLOC;
@@ -2033,7 +2171,7 @@ static int CmdLoad(const char *Cmd) {
         removeSignalOffset(bits, size);
         setGraphBuffer(bits, size);
         computeSignalProperties(bits, size);
-        free(bits);
+        graph_scratch_free(bits);
     }
 
     setClockGrid(0, 0);
@@ -2042,6 +2180,42 @@ static int CmdLoad(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static int CmdLoad(const char *Cmd) {
+
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "data load",
+                  "This command loads the contents of a pm3 file into graph window\n",
+                  "data load -f myfilename"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_str1("f", "file", "<fn>", "file to load"),
+        arg_lit0("b", "bin", "binary file"),
+        arg_lit0("n",  "no-fix",  "Load data from file without any transformations"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    bool is_bin = arg_get_lit(ctx, 2);
+    bool nofix = arg_get_lit(ctx, 3);
+    CLIParserFree(ctx);
+
+    char *path = NULL;
+    if (searchFile(&path, TRACES_SUBDIR, filename, ".pm3", true) != PM3_SUCCESS) {
+        if (searchFile(&path, TRACES_SUBDIR, filename, "", false) != PM3_SUCCESS) {
+            return PM3_EFILE;
+        }
+    }
+
+    int res = getSamplesFromFile(path, is_bin, nofix, true);
+    free(path);
+    return res;
+}
+
 // trim graph from the end
 int CmdLtrim(const char *Cmd) {
     CLIParserContext *ctx;
@@ -2170,7 +2344,7 @@ int CmdNorm(const char *Cmd) {
         }
     }
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -2180,7 +2354,7 @@ int CmdNorm(const char *Cmd) {
     computeSignalProperties(bits, size);
 
     RepaintGraphWindow();
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 
@@ -2321,7 +2495,7 @@ static int CmdDirectionalThreshold(const char *Cmd) {
     directionalThreshold(g_GraphBuffer, g_GraphBuffer, g_GraphTraceLen, up, down);
 
     // set signal properties low/high/mean/amplitude and isnoice detection
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -2331,7 +2505,7 @@ static int CmdDirectionalThreshold(const char *Cmd) {
     computeSignalProperties(bits, size);
 
     RepaintGraphWindow();
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 
@@ -2369,7 +2543,7 @@ static int CmdZerocrossings(const char *Cmd) {
         }
     }
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -2378,7 +2552,7 @@ static int CmdZerocrossings(const char *Cmd) {
     // set signal properties low/high/mean/amplitude and is_noise detection
     computeSignalProperties(bits, size);
     RepaintGraphWindow();
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 
@@ -2584,7 +2758,7 @@ static int CmdDataIIR(const char *Cmd) {
 
     iceSimple_Filter(g_GraphBuffer, g_GraphTraceLen, k);
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -2593,7 +2767,7 @@ static int CmdDataIIR(const char *Cmd) {
     // set signal properties low/high/mean/amplitude and is_noise detection
     computeSignalProperties(bits, size);
     RepaintGraphWindow();
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 
@@ -3347,7 +3521,7 @@ static int CmdCenterThreshold(const char *Cmd) {
     centerThreshold(g_GraphBuffer, g_GraphBuffer, g_GraphTraceLen, up, down);
 
     // set signal properties low/high/mean/amplitude and isnoice detection
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -3356,7 +3530,7 @@ static int CmdCenterThreshold(const char *Cmd) {
     // set signal properties low/high/mean/amplitude and is_noice detection
     computeSignalProperties(bits, size);
     RepaintGraphWindow();
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 
@@ -3397,7 +3571,7 @@ static int CmdEnvelope(const char *Cmd) {
 
     envelope_square(g_GraphBuffer, g_GraphBuffer, g_GraphTraceLen);
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -3406,7 +3580,69 @@ static int CmdEnvelope(const char *Cmd) {
     // set signal properties low/high/mean/amplitude and is_noice detection
     computeSignalProperties(bits, size);
     RepaintGraphWindow();
-    free(bits);
+    graph_scratch_free(bits);
+    return PM3_SUCCESS;
+}
+
+// batch lookup, ATRs are collected in fixed size chunks so the lookup itself never allocates
+#define ATR_BATCH_SIZE  256
+
+static int AtrLookupFile(const char *filename) {
+
+    char *path = NULL;
+    if (searchFile(&path, RESOURCES_SUBDIR, filename, "", false) != PM3_SUCCESS) {
+        return PM3_EFILE;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "couldn't open '%s'", path);
+        free(path);
+        return PM3_EFILE;
+    }
+    free(path);
+
+    static char atrs[ATR_BATCH_SIZE][129];
+    const char *atr_ptrs[ATR_BATCH_SIZE];
+    const char *descs[ATR_BATCH_SIZE];
+    size_t total = 0, found = 0, n = 0;
+    char line[256];
+    bool done = false;
+
+    while (done == false) {
+
+        done = (fgets(line, sizeof(line), f) == NULL);
+
+        if (done == false) {
+            // keep hex digits and wildcards only, drops spaces and line endings
+            size_t len = 0;
+            for (size_t i = 0; line[i] && len < sizeof(atrs[0]) - 1; i++) {
+                if (isxdigit((unsigned char)line[i]) || line[i] == '.') {
+                    atrs[n][len++] = toupper((unsigned char)line[i]);
+                }
+            }
+            atrs[n][len] = '\0';
+            if (len == 0) {
+                continue;
+            }
+            atr_ptrs[n] = atrs[n];
+            n++;
+        }
+
+        if (n == ATR_BATCH_SIZE || (done && n)) {
+            found += getAtrInfoBatch(atr_ptrs, descs, n);
+            for (size_t i = 0; i < n; i++) {
+                // first line of the description only
+                int dl = strcspn(descs[i], "\n");
+                PrintAndLogEx(INFO, "%s " _YELLOW_("%.*s"), atr_ptrs[i], dl, descs[i]);
+            }
+            total += n;
+            n = 0;
+        }
+    }
+    fclose(f);
+
+    PrintAndLogEx(SUCCESS, "Found " _YELLOW_("%zu") " of " _YELLOW_("%zu") " ATRs", found, total);
     return PM3_SUCCESS;
 }
 
@@ -3416,24 +3652,34 @@ static int CmdAtrLookup(const char *Cmd) {
                   "look up ATR record from bytearray\n"
                   "",
                   "data atr -d 3B6B00000031C064BE1B0100079000\n"
+                  "data atr -f atrs.txt      -> look up every ATR in file, one per line\n"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_str0("d", NULL, "<hex>", "ASN1 encoded byte array"),
+        arg_str0("f", "file", "<fn>", "text file with one ATR per line"),
 //        arg_lit0("t", "test", "perform self test"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
-    uint8_t data[129];
+    uint8_t data[129] = {0};
     int dlen = sizeof(data) - 1; // CLIGetStrWithReturn does not guarantee string to be null-terminated
     CLIGetStrWithReturn(ctx, 1, data, &dlen);
 
-//    bool selftest = arg_get_lit(ctx, 2);
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+
+//    bool selftest = arg_get_lit(ctx, 3);
     CLIParserFree(ctx);
 //    if (selftest) {
 //        return atr_selftest();
 //    }
+
+    if (fnlen) {
+        return AtrLookupFile(filename);
+    }
     PrintAndLogEx(INFO, "ISO7816-3 ATR... " _YELLOW_("%s"), data);
     PrintAndLogEx(INFO, "Fingerprint...");
 
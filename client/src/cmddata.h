@@ -20,6 +20,7 @@
 #define CMDDATA_H__
 
 #include "common.h"
+#include "graph.h"        // g_DemodBuffer
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -86,19 +87,13 @@ int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveG
 int getSamples(uint32_t n, bool verbose);
 int getSamplesEx(uint32_t start, uint32_t end, bool verbose, bool ignore_lf_config);
 int getSamplesFromBufEx(uint8_t *data, size_t sample_num, uint8_t bits_per_sample, bool verbose);
+int getSamplesFromFile(const char *path, bool is_bin, bool nofix, bool verbose);
 
 void setClockGrid(uint32_t clk, int offset);
 int directionalThreshold(const int *in, int *out, size_t len, int8_t up, int8_t down);
 int centerThreshold(const int *in, int *out, size_t len, int8_t up, int8_t down);
 int AskEdgeDetect(const int *in, int *out, int len, int threshold);
 
-#define MAX_DEMOD_BUF_LEN (1024*128)
-extern uint8_t g_DemodBuffer[MAX_DEMOD_BUF_LEN];
-extern size_t g_DemodBufferLen;
-
-extern int g_DemodClock;
-extern int32_t g_DemodStartIdx;
-
 #ifdef __cplusplus
 }
 #endif
@@ -330,7 +330,7 @@ static int CmdFlashMemLoad(const char *Cmd) {
         SendCommandNG(CMD_SPIFFS_MOUNT, NULL, 0);
     } else {
         // fast push mode
-        g_conn.block_after_ACK = true;
+        GetCommunicationConn()->block_after_ACK = true;
 
         while (bytes_remaining > 0) {
             uint32_t bytes_in_packet = MIN(FLASH_MEM_BLOCK_SIZE, bytes_remaining);
@@ -350,20 +350,20 @@ static int CmdFlashMemLoad(const char *Cmd) {
             PacketResponseNG resp;
             if (WaitForResponseTimeout(CMD_FLASHMEM_WRITE, &resp, 2000) == false) {
                 PrintAndLogEx(WARNING, "timeout while waiting for reply.");
-                g_conn.block_after_ACK = false;
+                GetCommunicationConn()->block_after_ACK = false;
                 free(data);
                 return PM3_ETIMEOUT;
             }
 
             if (resp.status != PM3_SUCCESS) {
-                g_conn.block_after_ACK = false;
+                GetCommunicationConn()->block_after_ACK = false;
                 PrintAndLogEx(FAILED, "Flash write fail [offset %u]", bytes_sent);
                 free(data);
                 return PM3_EFLASH;
             }
         }
 
-        g_conn.block_after_ACK = false;
+        GetCommunicationConn()->block_after_ACK = false;
         PrintAndLogEx(SUCCESS, "Wrote "_GREEN_("%zu")" bytes to offset "_GREEN_("%u"), datalen, offset);
     }
 
@@ -39,7 +39,7 @@ int flashmem_spiffs_load(const char *destfn, const uint8_t *data, size_t datalen
     uint32_t bytes_remaining = datalen;
 
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
 
     while (bytes_remaining > 0) {
 
@@ -82,7 +82,7 @@ out:
     clearCommandBuffer();
 
     // turn off fast push mode
-    g_conn.block_after_ACK = false;
+    GetCommunicationConn()->block_after_ACK = false;
 
     // We want to unmount after these to set things back to normal but more than this
     // unmouting ensure that SPIFFS CACHES are all flushed so our file is actually written on memory
@@ -59,6 +59,10 @@
 #include "cmddata.h"
 #include "graph.h"
 #include "fpga.h"
+#include "hfdecode.h"       // offline sniff decoding
+#include "fileutils.h"      // searchFile
+#include "util_posix.h"     // msclock
+#include "util.h"           // num_CPUs
 
 static int CmdHelp(const char *Cmd);
 
@@ -520,6 +524,199 @@ int CmdHFSniff(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static const CLIParserOption HFDecodeProtocolOpts[] = {
+    {HFDECODE_14A,    "14a"},
+    {HFDECODE_14B,    "14b"},
+    {HFDECODE_15,     "15"},
+    {HFDECODE_ICLASS, "iclass"},
+    {0,    NULL},
+};
+
+static const char *HFDecodeTraceList[] = {
+    [HFDECODE_14A] = "14a",
+    [HFDECODE_14B] = "14b",
+    [HFDECODE_15] = "15",
+    [HFDECODE_ICLASS] = "iclass",
+};
+
+// samples as getSamplesFromFile() reads them, without any offset removal
+static int hf_decode_load(const char *fn, bool is_bin, int32_t **samples, size_t *len) {
+
+    *samples = NULL;
+    *len = 0;
+
+    char *path = NULL;
+    if (searchFile(&path, TRACES_SUBDIR, fn, ".pm3", true) != PM3_SUCCESS) {
+        if (searchFile(&path, TRACES_SUBDIR, fn, "", false) != PM3_SUCCESS) {
+            return PM3_EFILE;
+        }
+    }
+
+    FILE *f = fopen(path, is_bin ? "rb" : "r");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "couldn't open '%s'", path);
+        free(path);
+        return PM3_EFILE;
+    }
+    free(path);
+
+    size_t max = 0;
+    int32_t *buf = NULL;
+    int res = PM3_SUCCESS;
+
+    if (is_bin) {
+        uint8_t val[4096];
+        size_t n;
+        while ((n = fread(val, 1, sizeof(val), f)) > 0) {
+            if (*len + n > max) {
+                max = MAX(max * 2, *len + n);
+                int32_t *tmp = realloc(buf, max * sizeof(int32_t));
+                if (tmp == NULL) {
+                    res = PM3_EMALLOC;
+                    break;
+                }
+                buf = tmp;
+            }
+            for (size_t i = 0; i < n; i++) {
+                buf[(*len)++] = val[i] - 127;
+            }
+        }
+    } else {
+        char line[80];
+        while (fgets(line, sizeof(line), f)) {
+            if (*len == max) {
+                max = MAX(max * 2, 4096);
+                int32_t *tmp = realloc(buf, max * sizeof(int32_t));
+                if (tmp == NULL) {
+                    res = PM3_EMALLOC;
+                    break;
+                }
+                buf = tmp;
+            }
+            buf[(*len)++] = atoi(line);
+        }
+    }
+    fclose(f);
+
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "failed to allocate memory");
+        free(buf);
+        *len = 0;
+        return res;
+    }
+
+    *samples = buf;
+    return PM3_SUCCESS;
+}
+
+static int CmdHFDecode(const char *Cmd) {
+
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hf decode",
+                  "Decode raw samples from `hf sniff` with the device protocol sniffers into the trace buffer.\n"
+                  "Samples are taken from the graph buffer, or from one or more files.\n"
+                  "Several files are decoded as consecutive captures, in the given order.\n"
+                  "Long captures are split and decoded in parallel.\n"
+                  "ISO15693 answers on two subcarriers (FSK) are not decoded.",
+                  "hf decode -t 14a                                  -> decode graph buffer\n"
+                  "hf decode -t 14b -f hf_sniff_14b_scl3711          -> decode file\n"
+                  "hf decode -t 15 -f sniff1.bin -f sniff2.bin -b    -> decode two binary captures\n"
+                  "hf decode -t iclass --threads 2"
+                 );
+    void *argtable[] = {
+        arg_param_begin,
+        arg_str1("t", "type",  "[14a|14b|15|iclass]", "protocol to decode"),
+        arg_strx0("f", "file", "<fn>", "file(s) with samples, default is graph buffer"),
+        arg_lit0("b", "bin",   "binary file(s)"),
+        arg_int0(NULL, "threads", "<dec>", "number of threads (def: number of CPUs)"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+
+    int proto = 0;
+    if (CLIGetOptionList(arg_get_str(ctx, 1), HFDecodeProtocolOpts, &proto)) {
+        CLIParserFree(ctx);
+        return PM3_EINVARG;
+    }
+
+    struct arg_str *files = arg_get_str(ctx, 2);
+    int filecnt = files->count;
+    bool is_bin = arg_get_lit(ctx, 3);
+    int threads = arg_get_int_def(ctx, 4, num_CPUs());
+
+    int segcnt = MAX(filecnt, 1);
+    hfdecode_segment_t *segs = calloc(segcnt, sizeof(hfdecode_segment_t));
+    if (segs == NULL) {
+        CLIParserFree(ctx);
+        PrintAndLogEx(FAILED, "failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    int res = PM3_SUCCESS;
+    if (filecnt == 0) {
+        if (g_GraphTraceLen == 0) {
+            PrintAndLogEx(WARNING, "no samples in graph buffer, use `" _YELLOW_("hf sniff") "` or `" _YELLOW_("data load") "` first");
+            res = PM3_ENODATA;
+        }
+        segs[0].samples = g_GraphBuffer;
+        segs[0].len = g_GraphTraceLen;
+    } else {
+        for (int i = 0; i < filecnt && res == PM3_SUCCESS; i++) {
+            int32_t *samples = NULL;
+            res = hf_decode_load(files->sval[i], is_bin, &samples, &segs[i].len);
+            segs[i].samples = samples;
+        }
+    }
+    CLIParserFree(ctx);
+
+    size_t total = 0;
+    for (int i = 0; i < segcnt; i++) {
+        total += segs[i].len;
+    }
+
+    uint8_t *trace = NULL;
+    uint32_t trace_len = 0, frames = 0;
+    uint64_t t1 = msclock();
+    if (res == PM3_SUCCESS) {
+        res = hfdecode_run(proto, segs, segcnt, threads, &trace, &trace_len, &frames);
+    }
+    t1 = msclock() - t1;
+
+    if (filecnt) {
+        for (int i = 0; i < segcnt; i++) {
+            free((void *)segs[i].samples);
+        }
+    }
+    free(segs);
+
+    if (res != PM3_SUCCESS) {
+        free(trace);
+        return res;
+    }
+
+    if (frames == 0) {
+        free(trace);
+        PrintAndLogEx(WARNING, "no frames decoded from %zu samples", total);
+        return PM3_ENODATA;
+    }
+
+    if (ImportTraceBuffer(trace, trace_len) == false) {
+        free(trace);
+        return PM3_EMALLOC;
+    }
+    free(trace);
+
+    // a sample is 8/fc
+    PrintAndLogEx(SUCCESS, "decoded " _YELLOW_("%u") " frames from %zu samples ( %.1f ms of air time ) in %" PRIu64 " ms"
+                  , frames
+                  , total
+                  , (double)total * 8 / 13560
+                  , t1
+                 );
+    PrintAndLogEx(HINT, "Use `" _YELLOW_("trace list -1 -t %s") "` to view", HFDecodeTraceList[proto]);
+    return PM3_SUCCESS;
+}
+
 int handle_hf_plot(bool show_plot) {
 
     uint8_t buf[FPGA_TRACE_SIZE] = {0};
@@ -608,6 +805,7 @@ static command_t CommandTable[] = {
     {"-----------", CmdHelp,          AlwaysAvailable, "--------------------- " _CYAN_("General") " ---------------------"},
     {"help",        CmdHelp,          AlwaysAvailable, "This help"},
     {"list",        CmdHFList,        AlwaysAvailable, "List protocol data in trace buffer"},
+    {"decode",      CmdHFDecode,      AlwaysAvailable, "Decode raw HF sniff samples into trace buffer"},
     {"plot",        CmdHFPlot,        IfPm3Hfplot,     "Plot signal"},
     {"tune",        CmdHFTune,        IfPm3Present,    "Continuously measure HF antenna tuning"},
     {"search",      CmdHFSearch,      AlwaysAvailable, "Search for known HF tags"},
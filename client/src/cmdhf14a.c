@@ -2628,6 +2628,7 @@ int infoHF14A(bool verbose, bool do_nack_test, bool do_aid_search) {
 
                 }
                 DropField();
+                AIDSearchFree(root);
                 if (verbose == false && found)
                     PrintAndLogEx(INFO, "----------------------------------------------------");
             }
@@ -129,6 +129,7 @@ static void hf14b_aid_search(bool verbose) {
 
         if (APDUEncodeS(&apdu, false, 0x00, apdu_data, &apdu_len)) {
             PrintAndLogEx(ERR, "APDU encoding error");
+            AIDSearchFree(root);
             return;
         }
 
@@ -199,6 +200,7 @@ static void hf14b_aid_search(bool verbose) {
         }
     }
     switch_off_field_14b();
+    AIDSearchFree(root);
     if (verbose == false && found) {
         PrintAndLogEx(INFO, "----------------------------------------------------");
     }
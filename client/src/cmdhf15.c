@@ -1263,7 +1263,7 @@ static int CmdHF15ELoad(const char *Cmd) {
     PrintAndLogEx(INFO, "." NOLF);
 
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
 
     size_t chuncksize = 256;
     size_t offset = 0;
@@ -1271,7 +1271,7 @@ static int CmdHF15ELoad(const char *Cmd) {
     while (bytes_read > 0) {
         if (bytes_read <= chuncksize) {
             // Disable fast mode on last packet
-            g_conn.block_after_ACK = false;
+            GetCommunicationConn()->block_after_ACK = false;
         }
 
         uint16_t bytestosend = MIN(chuncksize, bytes_read);
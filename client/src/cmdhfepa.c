@@ -150,7 +150,7 @@ static int CmdHFEPAPACEReplay(const char *Cmd) {
     // transfer the APDUs to the Proxmark3
     uint8_t data[PM3_CMD_DATA_SIZE];
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
     for (int i = 0; i < ARRAYLEN(apdu_lengths); i++) {
 
         // transfer the APDU in several parts if necessary
@@ -162,7 +162,7 @@ static int CmdHFEPAPACEReplay(const char *Cmd) {
             }
             if ((i == ARRAYLEN(apdu_lengths) - 1) && (j * sizeof(data) >= apdu_lengths[i] - 1)) {
                 // Disable fast mode on last packet
-                g_conn.block_after_ACK = false;
+                GetCommunicationConn()->block_after_ACK = false;
             }
             memcpy(data, // + (j * sizeof(data)),
                    apdus[i] + (j * sizeof(data)),
@@ -1872,7 +1872,7 @@ static void printSep(void) {
     PrintAndLogEx(INFO, "------------------------------------------------------------------------------------");
 }
 
-static uint16_t PrintFliteBlock(uint16_t tracepos, uint8_t *trace, uint16_t tracelen) {
+static uint32_t PrintFliteBlock(uint32_t tracepos, uint8_t *trace, uint32_t tracelen) {
     if (tracepos + 19 >= tracelen)
         return tracelen;
 
@@ -2081,7 +2081,7 @@ static int CmdHFFelicaDumpLite(const char *Cmd) {
         return PM3_EOPABORTED;
     }
 
-    uint16_t tracelen = resp.oldarg[1];
+    uint32_t tracelen = resp.oldarg[1];
     if (tracelen == 0) {
         PrintAndLogEx(WARNING, "No trace data! Maybe not a FeliCa Lite card?");
         return PM3_ESOFT;
@@ -2104,7 +2104,7 @@ static int CmdHFFelicaDumpLite(const char *Cmd) {
     print_hex_break(trace, tracelen, 32);
     printSep();
 
-    uint16_t tracepos = 0;
+    uint32_t tracepos = 0;
     while (tracepos < tracelen)
         tracepos = PrintFliteBlock(tracepos, trace, tracelen);
 
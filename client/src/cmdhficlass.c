@@ -18,6 +18,8 @@
 
 #include "cmdhficlass.h"
 #include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include "cliparser.h"
 #include "cmdparser.h"              // command_t
 #include "commonutil.h"             // ARRAYLEN
@@ -42,6 +44,7 @@
 #include "generator.h"
 #include "cmdhf14b.h"
 #include "cmdhw.h"
+#include "crc32.h"                // crc32_ex
 
 
 #define NUM_CSNS               9
@@ -209,7 +212,7 @@ static void iclass_upload_emul(uint8_t *d, uint16_t n, uint16_t offset, uint16_t
     } PACKED;
 
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
 
     //Send to device
     *bytes_sent = 0;
@@ -222,7 +225,7 @@ static void iclass_upload_emul(uint8_t *d, uint16_t n, uint16_t offset, uint16_t
         uint32_t bytes_in_packet = MIN(PM3_CMD_DATA_SIZE - 4, bytes_remaining);
         if (bytes_in_packet == bytes_remaining) {
             // Disable fast mode on last packet
-            g_conn.block_after_ACK = false;
+            GetCommunicationConn()->block_after_ACK = false;
         }
 
         struct p *payload = calloc(4 + bytes_in_packet, sizeof(uint8_t));
@@ -3984,7 +3987,19 @@ static int CmdHFiClassCheckKeys(const char *Cmd) {
     if (use_raw)
         PrintAndLogEx(NORMAL, "using " _YELLOW_("raw mode"));
 
-    GenerateMacFrom(CSN, CCNR, use_raw, use_elite, keyBlock, keycount, pre);
+    iclass_prekey_t *prekey = calloc(keycount, sizeof(iclass_prekey_t));
+    if (prekey == NULL) {
+        PrintAndLogEx(WARNING, "failed to allocate memory");
+        free(pre);
+        free(keyBlock);
+        return PM3_EMALLOC;
+    }
+
+    GenerateMacKeyFromCached(CSN, CCNR, use_raw, use_elite, keyBlock, keycount, prekey);
+    for (uint32_t i = 0; i < keycount; i++) {
+        memcpy(pre[i].mac, prekey[i].mac, sizeof(pre[i].mac));
+    }
+    free(prekey);
 
     PrintAndLogEx(SUCCESS, "Searching for " _YELLOW_("%s") " key...", (use_credit_key) ? "CREDIT" : "DEBIT");
 
@@ -3996,7 +4011,7 @@ static int CmdHFiClassCheckKeys(const char *Cmd) {
         max_chunk_size = keycount;
 
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
 
     // keep track of position of found key
     uint32_t chunk_offset = 0;
@@ -4025,7 +4040,7 @@ static int CmdHFiClassCheckKeys(const char *Cmd) {
         // last chunk?
         if (curr_chunk_cnt == keycount - chunk_offset) {
             // Disable fast mode on last command
-            g_conn.block_after_ACK = false;
+            GetCommunicationConn()->block_after_ACK = false;
         }
 
         uint32_t tmp_plen = sizeof(iclass_chk_t) + (4 * curr_chunk_cnt);
@@ -4701,7 +4716,7 @@ static int CmdHFiClassLookUp(const char *Cmd) {
     }
 
     PrintAndLogEx(INFO, "Generating diversified keys...");
-    GenerateMacKeyFrom(csn, CCNR, use_raw, use_elite, keyBlock, keycount, prekey);
+    GenerateMacKeyFromCached(csn, CCNR, use_raw, use_elite, keyBlock, keycount, prekey);
 
     if (use_elite) {
         PrintAndLogEx(INFO, "Using " _YELLOW_("elite algo"));
@@ -4754,7 +4769,6 @@ typedef struct {
 
 static size_t iclass_tc = 1;
 
-static pthread_mutex_t generator_mutex = PTHREAD_MUTEX_INITIALIZER;
 static void *bf_generate_mac(void *thread_arg) {
 
     iclass_thread_arg_t *targ = (iclass_thread_arg_t *)thread_arg;
@@ -4778,14 +4792,12 @@ static void *bf_generate_mac(void *thread_arg) {
 
         memcpy(key, keys + 8 * i, 8);
 
-        pthread_mutex_lock(&generator_mutex);
         if (use_raw)
             memcpy(div_key, key, 8);
         else
             HFiClassCalcDivKey(csn, key, div_key, use_elite);
 
         doMAC(cc_nr, div_key, list[i].mac);
-        pthread_mutex_unlock(&generator_mutex);
     }
     return NULL;
 }
@@ -4793,8 +4805,6 @@ static void *bf_generate_mac(void *thread_arg) {
 // precalc diversified keys and their MAC
 void GenerateMacFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_premac_t *list) {
 
-    pthread_mutex_init(&generator_mutex, NULL);
-
     iclass_tc = num_CPUs();
     pthread_t threads[iclass_tc];
     iclass_thread_arg_t args[iclass_tc];
@@ -4846,21 +4856,18 @@ static void *bf_generate_mackey(void *thread_arg) {
 
         memcpy(list[i].key, keys + 8 * i, 8);
 
-        pthread_mutex_lock(&generator_mutex);
         if (use_raw)
             memcpy(div_key, list[i].key, 8);
         else
             HFiClassCalcDivKey(csn, list[i].key, div_key, use_elite);
 
         doMAC(cc_nr, div_key, list[i].mac);
-        pthread_mutex_unlock(&generator_mutex);
     }
     return NULL;
 }
 
 void GenerateMacKeyFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_prekey_t *list) {
 
-    pthread_mutex_init(&generator_mutex, NULL);
     iclass_tc = num_CPUs();
     pthread_t threads[iclass_tc];
     iclass_thread_arg_t args[iclass_tc];
@@ -4891,6 +4898,188 @@ void GenerateMacKeyFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elit
 
 }
 
+// Precalculated MAC tables are cached in the user directory, keyed by CSN, CC, mode
+// and a crc of the dictionary. Repeated chk / lookup runs against the same card or
+// sniffed data skip the key diversification. The oldest files are evicted once the
+// cache holds too many files or bytes, and incognito sessions don't touch it at all.
+#define ICLASS_PRECALC_MAGIC    0x4B504349 // "ICPK"
+#define ICLASS_PRECALC_VERSION  1
+#define ICLASS_PRECALC_MAX_FILES  32
+#define ICLASS_PRECALC_MAX_BYTES  (64 * 1024 * 1024)
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t mode;
+    uint8_t csn[8];
+    uint8_t cc_nr[12];
+    uint8_t dict_crc[4];
+    uint32_t keycnt;
+} PACKED iclass_precalc_hdr_t;
+
+static char *iclass_precalc_path(const iclass_precalc_hdr_t *hdr) {
+    uint8_t crc[4] = {0};
+    crc32_ex((const uint8_t *)hdr, sizeof(iclass_precalc_hdr_t), crc);
+
+    char fn[64] = {0};
+    snprintf(fn, sizeof(fn), "iclass_%s_%02x%02x%02x%02x.bin", sprint_hex_inrow(hdr->csn, sizeof(hdr->csn)), crc[0], crc[1], crc[2], crc[3]);
+
+    char *path = NULL;
+    if (searchHomeFilePath(&path, CACHE_SUBDIR, fn, true) != PM3_SUCCESS) {
+        return NULL;
+    }
+    return path;
+}
+
+static bool iclass_precalc_load(const char *path, const iclass_precalc_hdr_t *hdr, const uint8_t *keys, iclass_prekey_t *list) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+
+    iclass_precalc_hdr_t fhdr;
+    bool ok = (fread(&fhdr, sizeof(fhdr), 1, f) == 1) && (memcmp(&fhdr, hdr, sizeof(fhdr)) == 0);
+    if (ok) {
+        ok = (fread(list, sizeof(iclass_prekey_t), hdr->keycnt, f) == hdr->keycnt);
+    }
+    fclose(f);
+
+    // the dictionary crc selects the file, the keys themselves have to match as well
+    for (uint32_t i = 0; ok && i < hdr->keycnt; i++) {
+        ok = (memcmp(list[i].key, keys + 8 * i, 8) == 0);
+    }
+    return ok;
+}
+
+typedef struct {
+    char *path;
+    time_t mtime;
+    size_t size;
+} iclass_precalc_file_t;
+
+static int iclass_precalc_file_cmp(const void *a, const void *b) {
+    const iclass_precalc_file_t *fa = a;
+    const iclass_precalc_file_t *fb = b;
+    return (fa->mtime > fb->mtime) - (fa->mtime < fb->mtime);
+}
+
+// remove the oldest cache files until one more file of `need` bytes fits
+static void iclass_precalc_evict(const char *path, size_t need) {
+
+    // cache directory, path minus the file name
+    const char *sep = path + strlen(path);
+    while (sep > path && sep[-1] != '/' && sep[-1] != '\\') {
+        sep--;
+    }
+    char dirname[FILE_PATH_SIZE] = {0};
+    snprintf(dirname, sizeof(dirname), "%.*s", (int)(sep - path), path);
+
+    DIR *dir = opendir(dirname);
+    if (dir == NULL) {
+        return;
+    }
+
+    iclass_precalc_file_t *files = NULL;
+    size_t cnt = 0, total = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (str_startswith(de->d_name, "iclass_") == false || str_endswith(de->d_name, ".bin") == false) {
+            continue;
+        }
+
+        char fn[FILE_PATH_SIZE] = {0};
+        snprintf(fn, sizeof(fn), "%s%s", dirname, de->d_name);
+        struct stat st;
+        if (strcmp(fn, path) == 0 || stat(fn, &st) != 0) {
+            continue;
+        }
+
+        iclass_precalc_file_t *tmp = realloc(files, (cnt + 1) * sizeof(iclass_precalc_file_t));
+        if (tmp == NULL) {
+            break;
+        }
+        files = tmp;
+        files[cnt].path = strdup(fn);
+        if (files[cnt].path == NULL) {
+            break;
+        }
+        files[cnt].mtime = st.st_mtime;
+        files[cnt].size = st.st_size;
+        total += st.st_size;
+        cnt++;
+    }
+    closedir(dir);
+
+    qsort(files, cnt, sizeof(iclass_precalc_file_t), iclass_precalc_file_cmp);
+
+    for (size_t i = 0; i < cnt; i++) {
+        if (cnt - i >= ICLASS_PRECALC_MAX_FILES || total + need > ICLASS_PRECALC_MAX_BYTES) {
+            PrintAndLogEx(DEBUG, "evicting precalc cache " _YELLOW_("%s"), files[i].path);
+            remove(files[i].path);
+            total -= files[i].size;
+        }
+        free(files[i].path);
+    }
+    free(files);
+}
+
+static void iclass_precalc_save(const char *path, const iclass_precalc_hdr_t *hdr, const iclass_prekey_t *list) {
+
+    size_t need = sizeof(iclass_precalc_hdr_t) + (size_t)hdr->keycnt * sizeof(iclass_prekey_t);
+    if (need > ICLASS_PRECALC_MAX_BYTES) {
+        return;
+    }
+    iclass_precalc_evict(path, need);
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        PrintAndLogEx(DEBUG, "failed to create precalc cache " _YELLOW_("%s"), path);
+        return;
+    }
+
+    bool ok = (fwrite(hdr, sizeof(iclass_precalc_hdr_t), 1, f) == 1);
+    ok &= (fwrite(list, sizeof(iclass_prekey_t), hdr->keycnt, f) == hdr->keycnt);
+    fclose(f);
+
+    if (ok == false) {
+        PrintAndLogEx(DEBUG, "failed to write precalc cache " _YELLOW_("%s"), path);
+        remove(path);
+    }
+}
+
+// same as GenerateMacKeyFrom, but served from / stored to the precalc cache
+void GenerateMacKeyFromCached(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_prekey_t *list) {
+
+    if (g_session.incognito) {
+        GenerateMacKeyFrom(CSN, CCNR, use_raw, use_elite, keys, keycnt, list);
+        return;
+    }
+
+    iclass_precalc_hdr_t hdr = {
+        .magic = ICLASS_PRECALC_MAGIC,
+        .version = ICLASS_PRECALC_VERSION,
+        .mode = (use_raw) ? 2 : (use_elite) ? 1 : 0,
+        .keycnt = keycnt,
+    };
+    memcpy(hdr.csn, CSN, sizeof(hdr.csn));
+    memcpy(hdr.cc_nr, CCNR, sizeof(hdr.cc_nr));
+    crc32_ex(keys, keycnt * 8, hdr.dict_crc);
+
+    char *path = iclass_precalc_path(&hdr);
+    if (path && iclass_precalc_load(path, &hdr, keys, list)) {
+        PrintAndLogEx(INFO, "Using cached diversified keys");
+        free(path);
+        return;
+    }
+
+    GenerateMacKeyFrom(CSN, CCNR, use_raw, use_elite, keys, keycnt, list);
+
+    if (path) {
+        iclass_precalc_save(path, &hdr, list);
+        free(path);
+    }
+}
+
 // print diversified keys
 void PrintPreCalcMac(uint8_t *keys, uint32_t keycnt, iclass_premac_t *pre_list) {
 
@@ -528,7 +528,7 @@ static int CmdHF14AJookiSim(const char *Cmd) {
     PrintAndLogEx(INFO, "." NOLF);
 
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
     uint8_t blockwidth = 4, counter = 0, blockno = 0;
 
     // 12 is the size of the struct the fct mf_eml_set_mem_xt uses to transfer to device
@@ -537,7 +537,7 @@ static int CmdHF14AJookiSim(const char *Cmd) {
     while (datalen) {
         if (datalen == blockwidth) {
             // Disable fast mode on last packet
-            g_conn.block_after_ACK = false;
+            GetCommunicationConn()->block_after_ACK = false;
         }
         uint16_t chunk_size = MIN(max_avail_blocks, datalen);
         uint16_t blocks_to_send = chunk_size / blockwidth;
@@ -703,7 +703,6 @@ static int CmdLegicCalcCrc(const char *Cmd) {
 
     switch (type) {
         case 16:
-            init_table(CRC_LEGIC_16);
             PrintAndLogEx(SUCCESS, "Legic crc16: %X", crc16_legic(data, data_len, mcc[0]));
             break;
         default:
@@ -807,13 +806,13 @@ void legic_seteml(uint8_t *src, uint32_t offset, uint32_t numofbytes) {
     PrintAndLogEx(INFO, "." NOLF);
 
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
     for (size_t i = offset; i < numofbytes; i += LEGIC_PACKET_SIZE) {
 
         size_t len = MIN((numofbytes - i), LEGIC_PACKET_SIZE);
         if (len == numofbytes - i) {
             // Disable fast mode on last packet
-            g_conn.block_after_ACK = false;
+            GetCommunicationConn()->block_after_ACK = false;
         }
 
         legic_packet_t *payload = calloc(1, sizeof(legic_packet_t) + len);
@@ -1013,7 +1012,7 @@ static int CmdLegicRestore(const char *Cmd) {
     PrintAndLogEx(SUCCESS, "Restoring to card");
 
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
 
     // transfer to device
     PacketResponseNG resp;
@@ -1023,7 +1022,7 @@ static int CmdLegicRestore(const char *Cmd) {
         size_t len = MIN((bytes_read - i), LEGIC_PACKET_SIZE);
         if (len == bytes_read - i) {
             // Disable fast mode on last packet
-            g_conn.block_after_ACK = false;
+            GetCommunicationConn()->block_after_ACK = false;
         }
 
         legic_packet_t *payload = calloc(1, sizeof(legic_packet_t) + len);
@@ -1345,7 +1344,7 @@ static int CmdLegicWipe(const char *Cmd) {
 
     PrintAndLogEx(SUCCESS, "Erasing");
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
 
     // transfer to device
     PacketResponseNG resp;
@@ -1356,7 +1355,7 @@ static int CmdLegicWipe(const char *Cmd) {
         size_t len = MIN((card.cardsize - i), LEGIC_PACKET_SIZE);
         if (len == card.cardsize - i) {
             // Disable fast mode on last packet
-            g_conn.block_after_ACK = false;
+            GetCommunicationConn()->block_after_ACK = false;
         }
 
         legic_packet_t *payload = calloc(1, sizeof(legic_packet_t) + len);
@@ -21,6 +21,7 @@
 #include <inttypes.h>
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #include "commonutil.h"  // ARRAYLEN
 #include "mifare/mifarehost.h"
@@ -28,9 +29,11 @@
 #include "ui.h"
 #include "crc16.h"
 #include "crapto1/crapto1.h"
+#include "crapto1/crypto1_bs.h"
 #include "protocols.h"
 #include "cmdhficlass.h"
 #include "mifare/mifaredefault.h"  // mifare consts
+#include "util.h"           // num_CPUs
 
 enum MifareAuthSeq {
     masNone,
@@ -53,6 +56,47 @@ void ClearAuthData(void) {
     AuthData.ks3 = 0;
 }
 
+// keys found while decoding a trace, per UID and authenticated block.
+// Later authentications try these before going through the dictionary.
+#define MF_KEY_CACHE_SIZE   256
+
+typedef struct {
+    uint32_t uid;
+    uint8_t auth_cmd;
+    uint8_t auth_block;
+    uint64_t key;
+} mf_cached_key_t;
+
+static mf_cached_key_t gs_mf_key_cache[MF_KEY_CACHE_SIZE];
+static size_t gs_mf_key_cache_cnt = 0;
+
+void ClearAuthKeyCache(void) {
+    gs_mf_key_cache_cnt = 0;
+}
+
+static void mf_key_cache_add(const AuthData_t *ad, uint64_t key) {
+    for (size_t i = 0; i < gs_mf_key_cache_cnt; i++) {
+        mf_cached_key_t *c = &gs_mf_key_cache[i];
+        if (c->uid == ad->uid && c->auth_cmd == ad->auth_cmd && c->auth_block == ad->auth_block) {
+            c->key = key;
+            return;
+        }
+    }
+
+    // full, drop the oldest entry
+    if (gs_mf_key_cache_cnt == MF_KEY_CACHE_SIZE) {
+        memmove(gs_mf_key_cache, gs_mf_key_cache + 1, (MF_KEY_CACHE_SIZE - 1) * sizeof(mf_cached_key_t));
+        gs_mf_key_cache_cnt--;
+    }
+
+    mf_cached_key_t *c = &gs_mf_key_cache[gs_mf_key_cache_cnt++];
+    c->uid = ad->uid;
+    c->auth_cmd = ad->auth_cmd;
+    c->auth_block = ad->auth_block;
+    c->key = key;
+}
+
+static uint32_t mf_dict_check(const uint64_t *keys, uint32_t count, const AuthData_t *ad, const uint8_t *cmd, uint8_t cmdsize, const uint8_t *parity);
 
 static int gs_ntag_i2c_state = 0;
 static int gs_mfuc_state = 0;
@@ -313,6 +357,8 @@ int applyIso14443a(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize, bool i
                 if (cmdsize > 3) {
                     snprintf(exp, size, "AUTH-A(" _MAGENTA_("%d") ")", cmd[1]);
                     MifareAuthState = masNt;
+                    AuthData.auth_cmd = cmd[0];
+                    AuthData.auth_block = cmd[1];
                 } else {
                     // case MIFARE_ULEV1_VERSION :  both 0x60.
                     snprintf(exp, size, "EV1 VERSION");
@@ -321,6 +367,8 @@ int applyIso14443a(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize, bool i
             }
             case MIFARE_AUTH_KEYB: {
                 MifareAuthState = masNt;
+                AuthData.auth_cmd = cmd[0];
+                AuthData.auth_block = cmd[1];
                 snprintf(exp, size, "AUTH-B(" _MAGENTA_("%d") ")", cmd[1]);
                 break;
             }
@@ -328,6 +376,8 @@ int applyIso14443a(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize, bool i
                 if (cmdsize > 3) {
                     snprintf(exp, size, "MAGIC AUTH (" _MAGENTA_("%d") ")", cmd[1]);
                     MifareAuthState = masNt;
+                    AuthData.auth_cmd = cmd[0];
+                    AuthData.auth_block = cmd[1];
                 }
                 break;
             }
@@ -433,6 +483,8 @@ int applyIso14443a(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize, bool i
                     snprintf(exp, size, "PPS - CID=%x", cmd[0] & 0x0F) ;
                 } else if ((cmd[0] & 0xF0) == 0x60  && (cmdsize == 4)) {
                     MifareAuthState = masNt;
+                    AuthData.auth_cmd = cmd[0];
+                    AuthData.auth_block = cmd[1];
                     snprintf(exp, size, "AUTH-%02X(" _MAGENTA_("%d") ")", cmd[0], cmd[1]);
                 } else {
                     return PM3_ESOFT;
@@ -2157,6 +2209,7 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
             AuthData.ks3 = AuthData.at_enc ^ prng_successor(AuthData.nt, 96);
 
             mfLastKey = GetCrypto1ProbableKey(&AuthData);
+            mf_key_cache_add(&AuthData, mfLastKey);
             PrintAndLogEx(NORMAL, "            |            |  *  |%49s " _GREEN_("%012" PRIX64) " prng %s |     |",
                           "key",
                           mfLastKey,
@@ -2179,19 +2232,40 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
                 };
             }
 
+            // check keys found earlier in this trace, same block first
+            if (!traceCrypto1) {
+                for (int pass = 0; pass < 2 && !traceCrypto1; pass++) {
+                    for (size_t i = gs_mf_key_cache_cnt; i > 0; i--) {
+                        const mf_cached_key_t *c = &gs_mf_key_cache[i - 1];
+                        bool same_block = (c->auth_cmd == AuthData.auth_cmd && c->auth_block == AuthData.auth_block);
+                        if (c->uid != AuthData.uid || same_block != (pass == 0) || c->key == mfLastKey)
+                            continue;
+
+                        if (NestedCheckKey(c->key, &AuthData, cmd, cmdsize, parity)) {
+                            PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "cached key", c->key);
+                            mfLastKey = c->key;
+                            traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
+                            break;
+                        }
+                    }
+                }
+            }
+
             // check default keys
             if (!traceCrypto1 && dicKeys != NULL && dicKeysCount > 0) {
-                for (int i = 0; i < dicKeysCount; i++) {
-                    if (NestedCheckKey(dicKeys[i], &AuthData, cmd, cmdsize, parity)) {
-                        PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "key", dicKeys[i]);
+                uint32_t i = mf_dict_check(dicKeys, dicKeysCount, &AuthData, cmd, cmdsize, parity);
+                if (i < dicKeysCount && NestedCheckKey(dicKeys[i], &AuthData, cmd, cmdsize, parity)) {
+                    PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "key", dicKeys[i]);
 
-                        mfLastKey = dicKeys[i];
-                        traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
-                        break;
-                    };
+                    mfLastKey = dicKeys[i];
+                    traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
                 }
             }
 
+            if (traceCrypto1) {
+                mf_key_cache_add(&AuthData, mfLastKey);
+            }
+
             // nested
             if (!traceCrypto1 && validate_prng_nonce(AuthData.nt)) {
                 uint32_t ntx = prng_successor(AuthData.nt, 90);
@@ -2216,6 +2290,7 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
                                           AuthData.ks2,
                                           AuthData.ks3);
 
+                            mf_key_cache_add(&AuthData, mfLastKey);
                             traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
                             break;
                         }
@@ -2286,7 +2361,7 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
     return *mfDataLen > 0;
 }
 
-bool NTParityChk(AuthData_t *ad, uint32_t ntx) {
+bool NTParityChk(const AuthData_t *ad, uint32_t ntx) {
     if (
         (oddparity8(ntx >> 8 & 0xff) ^ (ntx & 0x01) ^ ((ad->nt_enc_par >> 5) & 0x01) ^ (ad->nt_enc & 0x01)) ||
         (oddparity8(ntx >> 16 & 0xff) ^ (ntx >> 8 & 0x01) ^ ((ad->nt_enc_par >> 6) & 0x01) ^ (ad->nt_enc >> 8 & 0x01)) ||
@@ -2314,31 +2389,29 @@ bool NTParityChk(AuthData_t *ad, uint32_t ntx) {
     return true;
 }
 
-bool NestedCheckKey(uint64_t key, AuthData_t *ad, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity) {
+// test one key against a nested authentication and the first encrypted command.
+// Only reads the authentication data, safe to run from several threads.
+static bool mf_check_key(uint64_t key, const AuthData_t *ad, const uint8_t *cmd, uint8_t cmdsize, const uint8_t *parity, uint32_t *nt) {
     uint8_t buf[32] = {0};
-    struct Crypto1State *pcs;
+    struct Crypto1State pcs;
 
-    AuthData.ks2 = 0;
-    AuthData.ks3 = 0;
+    crypto1_init(&pcs, key);
+    uint32_t nt1 = crypto1_word(&pcs, ad->nt_enc ^ ad->uid, 1) ^ ad->nt_enc;
 
-    pcs = crypto1_create(key);
-    uint32_t nt1 = crypto1_word(pcs, ad->nt_enc ^ ad->uid, 1) ^ ad->nt_enc;
-    uint32_t ar = prng_successor(nt1, 64);
-    uint32_t at = prng_successor(nt1, 96);
+    crypto1_word(&pcs, ad->nr_enc, 1);
+//   uint32_t nr1 = crypto1_word(&pcs, ad->nr_enc, 1) ^ ad->nr_enc;  // if needs deciphered nr
+    // most keys already fail on the reader response
+    if ((crypto1_word(&pcs, 0, 0) ^ ad->ar_enc) != prng_successor(nt1, 64))
+        return false;
 
-    crypto1_word(pcs, ad->nr_enc, 1);
-//   uint32_t nr1 = crypto1_word(pcs, ad->nr_enc, 1) ^ ad->nr_enc;  // if needs deciphered nr
-    uint32_t ar1 = crypto1_word(pcs, 0, 0) ^ ad->ar_enc;
-    uint32_t at1 = crypto1_word(pcs, 0, 0) ^ ad->at_enc;
+    if ((crypto1_word(&pcs, 0, 0) ^ ad->at_enc) != prng_successor(nt1, 96))
+        return false;
 
-    if (!(ar == ar1 && at == at1 && NTParityChk(ad, nt1))) {
-        crypto1_destroy(pcs);
+    if (NTParityChk(ad, nt1) == false)
         return false;
-    }
 
     memcpy(buf, cmd, cmdsize);
-    mf_crypto1_decrypt(pcs, buf, cmdsize, 0);
-    crypto1_destroy(pcs);
+    mf_crypto1_decrypt(&pcs, buf, cmdsize, 0);
 
     if (!CheckCrypto1Parity(cmd, cmdsize, buf, parity))
         return false;
@@ -2346,12 +2419,106 @@ bool NestedCheckKey(uint64_t key, AuthData_t *ad, uint8_t *cmd, uint8_t cmdsize,
     if (!check_crc(CRC_14443_A, buf, cmdsize))
         return false;
 
+    *nt = nt1;
+    return true;
+}
+
+bool NestedCheckKey(uint64_t key, AuthData_t *ad, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity) {
+
+    AuthData.ks2 = 0;
+    AuthData.ks3 = 0;
+
+    uint32_t nt1 = 0;
+    if (mf_check_key(key, ad, cmd, cmdsize, parity, &nt1) == false)
+        return false;
+
     AuthData.nt = nt1;
-    AuthData.ks2 = AuthData.ar_enc ^ ar;
-    AuthData.ks3 = AuthData.at_enc ^ at;
+    AuthData.ks2 = AuthData.ar_enc ^ prng_successor(nt1, 64);
+    AuthData.ks3 = AuthData.at_enc ^ prng_successor(nt1, 96);
     return true;
 }
 
+// dictionary check, the keys are handed out in chunks to all cores.
+// Chunks are claimed in dictionary order and the lowest matching index wins,
+// so the result is the same key a sequential search would find.
+// A chunk is first run through the bitsliced Crypto1 up to the reader answer,
+// only keys passing that get the full scalar check.
+#define MF_DICT_CHUNK   (4 * CRYPTO1_BS_LANES)
+
+typedef struct {
+    const uint64_t *keys;
+    uint32_t count;
+    const AuthData_t *ad;
+    const uint8_t *cmd;
+    uint8_t cmdsize;
+    const uint8_t *parity;
+    uint32_t next;
+    uint32_t found;
+} mf_dict_check_t;
+
+static void *mf_dict_check_thread(void *arg) {
+    mf_dict_check_t *dc = (mf_dict_check_t *)arg;
+    const AuthData_t *ad = dc->ad;
+
+    // same words mf_check_key() shifts in: the nested nonce, the reader nonce, the reader answer
+    const crypto1_bs_word_t words[] = {
+        { ad->nt_enc ^ ad->uid, true },
+        { ad->nr_enc, true },
+        { 0, false },
+    };
+    uint32_t ks[MF_DICT_CHUNK * ARRAYLEN(words)];
+
+    for (;;) {
+        uint32_t start = __atomic_fetch_add(&dc->next, MF_DICT_CHUNK, __ATOMIC_SEQ_CST);
+        if (start >= dc->count || start >= __atomic_load_n(&dc->found, __ATOMIC_SEQ_CST))
+            break;
+
+        uint32_t end = MIN(start + MF_DICT_CHUNK, dc->count);
+        crypto1_bs_keystream(dc->keys + start, end - start, words, ARRAYLEN(words), ks);
+
+        for (uint32_t i = start; i < end; i++) {
+            const uint32_t *k = ks + (i - start) * ARRAYLEN(words);
+            uint32_t nt1 = k[0] ^ ad->nt_enc;
+            if ((k[2] ^ ad->ar_enc) != prng_successor(nt1, 64))
+                continue;
+
+            if (mf_check_key(dc->keys[i], dc->ad, dc->cmd, dc->cmdsize, dc->parity, &nt1)) {
+                uint32_t found = __atomic_load_n(&dc->found, __ATOMIC_SEQ_CST);
+                while (i < found && __atomic_compare_exchange_n(&dc->found, &found, i, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) == false);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+// returns the index of the first key which decrypts the command, or count
+static uint32_t mf_dict_check(const uint64_t *keys, uint32_t count, const AuthData_t *ad, const uint8_t *cmd, uint8_t cmdsize, const uint8_t *parity) {
+    mf_dict_check_t dc = {
+        .keys = keys,
+        .count = count,
+        .ad = ad,
+        .cmd = cmd,
+        .cmdsize = cmdsize,
+        .parity = parity,
+        .next = 0,
+        .found = count,
+    };
+
+    uint32_t threads = MIN((uint32_t)num_CPUs(), (count + MF_DICT_CHUNK - 1) / MF_DICT_CHUNK);
+    pthread_t thread_id[threads ? threads : 1];
+    uint32_t started = 0;
+    for (; started + 1 < threads; started++) {
+        if (pthread_create(&thread_id[started], NULL, mf_dict_check_thread, &dc))
+            break;
+    }
+    mf_dict_check_thread(&dc);
+    for (uint32_t i = 0; i < started; i++)
+        pthread_join(thread_id[i], NULL);
+
+    return dc.found;
+}
+
 bool CheckCrypto1Parity(const uint8_t *cmd_enc, uint8_t cmdsize, uint8_t *cmd, const uint8_t *parity_enc) {
     for (int i = 0; i < cmdsize - 1; i++) {
         if (oddparity8(cmd[i]) ^ (cmd[i + 1] & 0x01) ^ ((parity_enc[i / 8] >> (7 - i % 8)) & 0x01) ^ (cmd_enc[i + 1] & 0x01))
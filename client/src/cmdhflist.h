@@ -32,6 +32,8 @@ typedef struct {
     uint8_t ar_enc_par; // encrypted reader response parity
     uint32_t at_enc;    // encrypted tag response
     uint8_t at_enc_par; // encrypted tag response parity
+    uint8_t auth_cmd;   // authentication command (key type)
+    uint8_t auth_block; // authenticated block
     bool first_auth;    // is first authentication
     uint32_t ks2;       // ar ^ ar_enc
     uint32_t ks3;       // at ^ at_enc
@@ -39,6 +41,7 @@ typedef struct {
 } AuthData_t;
 
 void ClearAuthData(void);
+void ClearAuthKeyCache(void);
 
 uint8_t iso14443A_CRC_check(bool isResponse, uint8_t *d, uint8_t n);
 uint8_t iso14443B_CRC_check(uint8_t *d, uint8_t n);
@@ -71,7 +74,7 @@ void annotateCryptoRF(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize);
 void annotateSeos(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize);
 
 bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isResponse, uint8_t *mfData, size_t *mfDataLen, const uint64_t *dicKeys, uint32_t dicKeysCount);
-bool NTParityChk(AuthData_t *ad, uint32_t ntx);
+bool NTParityChk(const AuthData_t *ad, uint32_t ntx);
 bool NestedCheckKey(uint64_t key, AuthData_t *ad, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity);
 bool CheckCrypto1Parity(const uint8_t *cmd_enc, uint8_t cmdsize, uint8_t *cmd, const uint8_t *parity_enc);
 uint64_t GetCrypto1ProbableKey(AuthData_t *ad);
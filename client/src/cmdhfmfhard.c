@@ -88,8 +88,8 @@ static uint64_t known_target_key;
 static uint32_t test_state[2] = {0, 0};
 static float brute_force_per_second;
 
-static void get_SIMD_instruction_set(char *instruction_set) {
-    switch (GetSIMDInstrAuto()) {
+static void get_SIMD_instruction_set(SIMDExecInstr instr, char *instruction_set) {
+    switch (instr) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
         case SIMD_AVX512:
             strcpy(instruction_set, "AVX512F");
@@ -124,7 +124,7 @@ static void get_SIMD_instruction_set(char *instruction_set) {
 static void print_progress_header(void) {
     char progress_text[80];
     char instr_set[12] = "";
-    get_SIMD_instruction_set(instr_set);
+    get_SIMD_instruction_set(GetSIMDInstrAuto(), instr_set);
     snprintf(progress_text, sizeof(progress_text), "Start using " _YELLOW_("%d") " threads and " _YELLOW_("%s") " SIMD core", num_CPUs(), instr_set);
 
     PrintAndLogEx(INFO, "Hardnested attack starting...");
@@ -1464,43 +1464,128 @@ static void simulate_MFplus_RNG(uint32_t test_cuid, uint64_t test_key, uint32_t
     }
 }
 
-static int simulate_acquire_nonces(void) {
-    time_t time1 = time(NULL);
-    last_sample_clock = 0;
-    sample_period = 1000; // for simulation
-    hardnested_stage = CHECK_1ST_BYTES;
-    bool acquisition_completed = false;
-    uint32_t total_num_nonces = 0;
-    float brute_force_depth;
-    bool reported_suma8 = false;
+// Nonces are handed from the acquisition loop to the analysis thread through a ring buffer,
+// so the reader keeps sampling while the state space is reduced.
+// Single producer (acquire_nonces, simulate_acquire_nonces) / single consumer (analyze_nonces_thread):
+// only the producer moves head and only the consumer moves tail, both under nonce_queue_mutex.
+// The entries between tail and head belong to the consumer until it moves tail.
+#define NONCE_QUEUE_SIZE        4096    // power of 2, a reply holds up to 112 nonces
+#define NONCE_QUEUE_BATCH       113     // simulated nonces per batch
 
-    cuid = (rand() & 0xff) << 24 | (rand() & 0xff) << 16 | (rand() & 0xff) << 8 | (rand() & 0xff);
-    if (known_target_key == -1) {
-        known_target_key = ((uint64_t)rand() & 0xfff) << 36 | ((uint64_t)rand() & 0xfff) << 24 | ((uint64_t)rand() & 0xfff) << 12 | ((uint64_t)rand() & 0xfff);
+typedef struct {
+    uint32_t nonce_enc;
+    uint8_t par_enc;
+} queued_nonce_t;
+
+static struct {
+    queued_nonce_t entry[NONCE_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    bool producer_done;     // no more nonces will come
+    bool completed;         // set by the analysis thread when enough nonces are acquired, or on error
+    bool fixed_period;      // simulated nonces, the sample period isn't measured
+    int result;
+    // output routing of the acquiring thread, the analysis thread prints the same way
+    uint8_t print_flags;
+    grabbed_output *print_grab;
+    grabbed_output *print_records;
+} nonce_queue;
+
+static pthread_mutex_t nonce_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t nonce_queue_not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t nonce_queue_not_full = PTHREAD_COND_INITIALIZER;
+
+// Queues a whole batch, waits while the analysis is behind.
+// Returns false once the analysis is done and doesn't read any more.
+static bool nonce_queue_push(const queued_nonce_t *n, uint16_t num) {
+    pthread_mutex_lock(&nonce_queue_mutex);
+    while (nonce_queue.head - nonce_queue.tail > NONCE_QUEUE_SIZE - num && nonce_queue.completed == false) {
+        pthread_cond_wait(&nonce_queue_not_full, &nonce_queue_mutex);
     }
+    bool completed = nonce_queue.completed;
+    if (completed == false) {
+        for (uint16_t i = 0; i < num; i++) {
+            nonce_queue.entry[(nonce_queue.head + i) & (NONCE_QUEUE_SIZE - 1)] = n[i];
+        }
+        nonce_queue.head += num;
+        pthread_cond_signal(&nonce_queue_not_empty);
+    }
+    pthread_mutex_unlock(&nonce_queue_mutex);
+    return (completed == false);
+}
 
-    char progress_text[80];
-    snprintf(progress_text, sizeof(progress_text), "Simulating key %012" PRIx64 ", cuid %08" PRIx32 " ...", known_target_key, cuid);
-    hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
-    fprintf(fstats, "%012" PRIx64 ";%" PRIx32 ";", known_target_key, cuid);
+// Waits until the analysis took everything queued, or is done.
+static bool nonce_queue_wait_drained(void) {
+    pthread_mutex_lock(&nonce_queue_mutex);
+    while (nonce_queue.tail != nonce_queue.head && nonce_queue.completed == false) {
+        pthread_cond_wait(&nonce_queue_not_full, &nonce_queue_mutex);
+    }
+    bool completed = nonce_queue.completed;
+    pthread_mutex_unlock(&nonce_queue_mutex);
+    return (completed == false);
+}
 
-    num_acquired_nonces = 0;
+static bool nonce_queue_completed(void) {
+    pthread_mutex_lock(&nonce_queue_mutex);
+    bool completed = nonce_queue.completed;
+    pthread_mutex_unlock(&nonce_queue_mutex);
+    return completed;
+}
 
-    do {
-        uint32_t nt_enc = 0;
-        uint8_t par_enc = 0;
+static void analyze_nonces_done(int result) {
+    pthread_mutex_lock(&nonce_queue_mutex);
+    nonce_queue.result = result;
+    nonce_queue.completed = true;
+    pthread_cond_signal(&nonce_queue_not_full);
+    pthread_mutex_unlock(&nonce_queue_mutex);
+}
+
+static void
+#ifdef __has_attribute
+#if __has_attribute(force_align_arg_pointer)
+__attribute__((force_align_arg_pointer))
+#endif
+#endif
+*analyze_nonces_thread(void *args) {
+    (void)args;
+    bool reported_suma8 = false;
+    float brute_force_depth;
+
+    PrintAndLogRedirect(nonce_queue.print_flags, nonce_queue.print_grab, nonce_queue.print_records);
+
+    while (true) {
 
-        for (uint16_t i = 0; i < 113; i++) {
-            simulate_MFplus_RNG(cuid, known_target_key, &nt_enc, &par_enc);
-            num_acquired_nonces += add_nonce(nt_enc, par_enc);
-            total_num_nonces++;
+        pthread_mutex_lock(&nonce_queue_mutex);
+        while (nonce_queue.head == nonce_queue.tail && nonce_queue.producer_done == false) {
+            pthread_cond_wait(&nonce_queue_not_empty, &nonce_queue_mutex);
         }
+        uint32_t tail = nonce_queue.tail;
+        uint32_t head = nonce_queue.head;
+        pthread_mutex_unlock(&nonce_queue_mutex);
 
+        if (head == tail) {
+            return NULL;
+        }
+
+        // a pass takes everything acquired meanwhile, the time between passes is the sample period
+        if (nonce_queue.fixed_period == false && msclock() - last_sample_clock < sample_period) {
+            sample_period = msclock() - last_sample_clock;
+        }
         last_sample_clock = msclock();
 
+        for (; tail != head; tail++) {
+            const queued_nonce_t *n = &nonce_queue.entry[tail & (NONCE_QUEUE_SIZE - 1)];
+            num_acquired_nonces += add_nonce(n->nonce_enc, n->par_enc);
+        }
+
+        pthread_mutex_lock(&nonce_queue_mutex);
+        nonce_queue.tail = tail;
+        pthread_cond_signal(&nonce_queue_not_full);
+        pthread_mutex_unlock(&nonce_queue_mutex);
+
+        bool acquisition_completed;
         if (first_byte_num == 256) {
             if (hardnested_stage == CHECK_1ST_BYTES) {
-
                 bool got_match = false;
                 for (uint8_t i = 0; i < NUM_SUMS; i++) {
                     if (first_byte_Sum == sums[i]) {
@@ -1512,7 +1597,8 @@ static int simulate_acquire_nonces(void) {
 
                 if (got_match == false) {
                     PrintAndLogEx(FAILED, "No match for the First_Byte_Sum (%u), is the card a genuine MFC Ev1? ", first_byte_Sum);
-                    return PM3_ESOFT;
+                    analyze_nonces_done(PM3_EWRONGANSWER);
+                    return NULL;
                 }
 
                 hardnested_stage |= CHECK_2ND_BYTES;
@@ -1533,7 +1619,75 @@ static int simulate_acquire_nonces(void) {
             acquisition_completed = shrink_key_space(&brute_force_depth);
             hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
         }
-    } while (!acquisition_completed);
+
+        if (acquisition_completed) {
+            analyze_nonces_done(PM3_SUCCESS);
+            return NULL;
+        }
+    }
+}
+
+static int analyze_nonces_start(pthread_t *analyzer, bool fixed_period) {
+    memset(&nonce_queue, 0, sizeof(nonce_queue));
+    nonce_queue.fixed_period = fixed_period;
+    PrintAndLogRedirectGet(&nonce_queue.print_flags, &nonce_queue.print_grab, &nonce_queue.print_records);
+    if (pthread_create(analyzer, NULL, analyze_nonces_thread, NULL) != 0) {
+        return PM3_EMALLOC;
+    }
+    return PM3_SUCCESS;
+}
+
+static int analyze_nonces_finish(pthread_t analyzer) {
+    pthread_mutex_lock(&nonce_queue_mutex);
+    nonce_queue.producer_done = true;
+    pthread_cond_signal(&nonce_queue_not_empty);
+    pthread_mutex_unlock(&nonce_queue_mutex);
+    pthread_join(analyzer, NULL);
+    return nonce_queue.result;
+}
+
+// Like acquire_nonces(), batches of simulated nonces go through the queue to the analysis thread.
+// A batch is simulated while the previous one is analyzed, like a device reply would arrive.
+static int simulate_acquire_nonces(void) {
+    time_t time1 = time(NULL);
+    last_sample_clock = 0;
+    sample_period = 1000; // for simulation
+    hardnested_stage = CHECK_1ST_BYTES;
+    uint32_t total_num_nonces = 0;
+
+    cuid = (rand() & 0xff) << 24 | (rand() & 0xff) << 16 | (rand() & 0xff) << 8 | (rand() & 0xff);
+    if (known_target_key == -1) {
+        known_target_key = ((uint64_t)rand() & 0xfff) << 36 | ((uint64_t)rand() & 0xfff) << 24 | ((uint64_t)rand() & 0xfff) << 12 | ((uint64_t)rand() & 0xfff);
+    }
+
+    char progress_text[80];
+    snprintf(progress_text, sizeof(progress_text), "Simulating key %012" PRIx64 ", cuid %08" PRIx32 " ...", known_target_key, cuid);
+    hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+    fprintf(fstats, "%012" PRIx64 ";%" PRIx32 ";", known_target_key, cuid);
+
+    num_acquired_nonces = 0;
+
+    pthread_t analyzer;
+    int res = analyze_nonces_start(&analyzer, true);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    queued_nonce_t batch[NONCE_QUEUE_BATCH];
+    do {
+        for (uint16_t i = 0; i < NONCE_QUEUE_BATCH; i++) {
+            simulate_MFplus_RNG(cuid, known_target_key, &batch[i].nonce_enc, &batch[i].par_enc);
+        }
+        if (nonce_queue_wait_drained() == false || nonce_queue_push(batch, NONCE_QUEUE_BATCH) == false) {
+            break;
+        }
+        total_num_nonces += NONCE_QUEUE_BATCH;
+    } while (true);
+
+    res = analyze_nonces_finish(analyzer);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
 
     time_t end_time = time(NULL);
     // PrintAndLogEx(INFO, "Acquired a total of %" PRId32" nonces in %1.0f seconds (%1.0f nonces/minute)",
@@ -1546,6 +1700,8 @@ static int simulate_acquire_nonces(void) {
     return PM3_SUCCESS;
 }
 
+// Talks to the device and feeds the analysis thread until it has enough nonces.
+// The device stays with the calling thread, so does the nonce file.
 static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool nonce_file_write, bool slow, char *filename) {
 
     last_sample_clock = msclock();
@@ -1555,12 +1711,11 @@ static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_
     // initial rough estimate. Will be refined.
     sample_period = 2000;
 
-    bool initialize = true;
-    bool field_off = false;
-    bool acquisition_completed = false;
-    bool reported_suma8 = false;
+    pthread_t analyzer;
+    bool analyzing = false;
 
-    float brute_force_depth;
+    bool initialize = true;
+    int res = PM3_SUCCESS;
 
     FILE *fnonces = NULL;
 
@@ -1570,41 +1725,36 @@ static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_
 
     uint8_t write_buf[9];
     char progress_text[80];
+    queued_nonce_t batch[PM3_CMD_DATA_SIZE / 9 * 2];
 
-    do {
-
-        if (field_off) {
-            DropField();
-            break;
-        }
+    while (analyzing == false || nonce_queue_completed() == false) {
 
         uint32_t flags = 0;
         flags |= initialize ? 0x0001 : 0;
         flags |= slow ? 0x0002 : 0;
-        flags |= field_off ? 0x0004 : 0;
         clearCommandBuffer();
         SendCommandMIX(CMD_HF_MIFARE_ACQ_ENCRYPTED_NONCES, blockNo + keyType * 0x100, trgBlockNo + trgKeyType * 0x100, flags, key, 6);
 
-        if (initialize) {
+        if (WaitForResponseTimeout(CMD_ACK, &resp, 3000) == false) {
+            res = PM3_ETIMEOUT;
+            break;
+        }
 
-            if (WaitForResponseTimeout(CMD_ACK, &resp, 3000) == false) {
-                DropField();
-                return PM3_ETIMEOUT;
-            }
+        // error during nested_hard
+        if (resp.oldarg[0]) {
+            res = resp.oldarg[0];
+            break;
+        }
 
-            // error during nested_hard
-            if (resp.oldarg[0]) {
-                DropField();
-                return resp.oldarg[0];
-            }
+        if (initialize) {
 
             cuid = resp.oldarg[1];
             if (nonce_file_write && fnonces == NULL) {
 
                 if ((fnonces = fopen(filename, "wb")) == NULL) {
                     PrintAndLogEx(WARNING, "Could not create file " _YELLOW_("%s"), filename);
-                    DropField();
-                    return PM3_EFILE;
+                    res = PM3_EFILE;
+                    break;
                 }
 
                 snprintf(progress_text, 80, "Writing acquired nonces to binary file " _YELLOW_("%s"), filename);
@@ -1615,109 +1765,56 @@ static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_
                 fwrite(&trgKeyType, 1, 1, fnonces);
                 fflush(fnonces);
             }
-        }
-
-        if (initialize == false) {
-
-            uint16_t num_sampled_nonces = resp.oldarg[2];
-            uint8_t *bufp = resp.data.asBytes;
 
-            for (uint16_t i = 0; i < num_sampled_nonces; i += 2) {
-                uint32_t nt_enc1 = bytes_to_num(bufp, 4);
-                uint32_t nt_enc2 = bytes_to_num(bufp + 4, 4);
-                uint8_t par_enc = bytes_to_num(bufp + 8, 1);
-
-                //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc1, par_enc >> 4);
-                num_acquired_nonces += add_nonce(nt_enc1, par_enc >> 4);
-                //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc2, par_enc & 0x0f);
-                num_acquired_nonces += add_nonce(nt_enc2, par_enc & 0x0f);
-
-                if (nonce_file_write) {
-                    fwrite(bufp, 1, 9, fnonces);
-                    fflush(fnonces);
-                }
-                bufp += 9;
-            }
-            //total_num_nonces += num_sampled_nonces;
-
-            if (first_byte_num == 256) {
-                if (hardnested_stage == CHECK_1ST_BYTES) {
-                    bool got_match = false;
-                    for (uint8_t i = 0; i < NUM_SUMS; i++) {
-                        if (first_byte_Sum == sums[i]) {
-                            first_byte_Sum = i;
-                            got_match = true;
-                            break;
-                        }
-                    }
-
-                    if (got_match == false) {
-                        PrintAndLogEx(FAILED, "No match for the First_Byte_Sum (%u), is the card a genuine MFC Ev1? ", first_byte_Sum);
-                        if (nonce_file_write) {
-                            fclose(fnonces);
-                        }
-                        return PM3_EWRONGANSWER;
-                    }
-
-                    hardnested_stage |= CHECK_2ND_BYTES;
-                    apply_sum_a0();
-                }
-                update_nonce_data(true);
-                acquisition_completed = shrink_key_space(&brute_force_depth);
-                if (!reported_suma8) {
-                    char progress_string[80];
-                    snprintf(progress_string, sizeof(progress_string), "Apply Sum property. Sum(a0) = %d", sums[first_byte_Sum]);
-                    hardnested_print_progress(num_acquired_nonces, progress_string, brute_force_depth, 0);
-                    reported_suma8 = true;
-                } else {
-                    hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
-                }
-            } else {
-                update_nonce_data(true);
-                acquisition_completed = shrink_key_space(&brute_force_depth);
-                hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+            res = analyze_nonces_start(&analyzer, false);
+            if (res != PM3_SUCCESS) {
+                break;
             }
+            analyzing = true;
+            initialize = false;
         }
 
-        if (acquisition_completed) {
-            field_off = true; // switch off field with next SendCommandMIX and then finish
-        }
+        uint16_t num_sampled_nonces = MIN(resp.oldarg[2], ARRAYLEN(batch));
+        uint8_t *bufp = resp.data.asBytes;
 
-        if (initialize == false) {
+        // the whole reply goes to the file, even if the analysis stops taking nonces
+        if (nonce_file_write) {
+            fwrite(bufp, 1, ((num_sampled_nonces + 1) / 2) * 9, fnonces);
+            fflush(fnonces);
+        }
 
-            if (WaitForResponseTimeout(CMD_ACK, &resp, 3000) == false) {
-                if (nonce_file_write) {
-                    fclose(fnonces);
-                }
-                DropField();
-                return PM3_ETIMEOUT;
-            }
+        uint16_t num = 0;
+        for (uint16_t i = 0; i < num_sampled_nonces; i += 2) {
+            uint32_t nt_enc1 = bytes_to_num(bufp, 4);
+            uint32_t nt_enc2 = bytes_to_num(bufp + 4, 4);
+            uint8_t par_enc = bytes_to_num(bufp + 8, 1);
 
-            // error during nested_hard
-            if (resp.oldarg[0]) {
-                if (nonce_file_write) {
-                    fclose(fnonces);
-                }
-                DropField();
-                return resp.oldarg[0];
-            }
+            //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc1, par_enc >> 4);
+            batch[num++] = (queued_nonce_t) { nt_enc1, par_enc >> 4 };
+            //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc2, par_enc & 0x0f);
+            batch[num++] = (queued_nonce_t) { nt_enc2, par_enc & 0x0f };
+            bufp += 9;
         }
 
-        initialize = false;
-
-        if (msclock() - last_sample_clock < sample_period) {
-            sample_period = msclock() - last_sample_clock;
+        if (nonce_queue_push(batch, num) == false) {
+            break;
         }
+    }
 
-        last_sample_clock = msclock();
+    DropField();
 
-    } while (field_off || acquisition_completed == false);
+    if (analyzing) {
+        int analyzed = analyze_nonces_finish(analyzer);
+        if (res == PM3_SUCCESS) {
+            res = analyzed;
+        }
+    }
 
-    if (nonce_file_write) {
+    if (fnonces != NULL) {
         fclose(fnonces);
     }
 
-    return PM3_SUCCESS;
+    return res;
 }
 
 static inline bool invariant_holds(uint_fast8_t byte_diff, uint_fast32_t state1, uint_fast32_t state2, uint_fast8_t bit, uint_fast8_t state_bit) {
@@ -2382,11 +2479,50 @@ static void init_it_all(void) {
     memset(sum_a0_bitarrays, 0, sizeof(sum_a0_bitarrays));
 }
 
+int mfnestedhard_bench(void) {
+
+    char *path;
+    if (searchFile(&path, RESOURCES_SUBDIR, TEST_BENCH_FILENAME, "", true) != PM3_SUCCESS) {
+        return PM3_EFILE;
+    }
+    free(path);
+
+    // all instruction sets below the best supported one are available as well
+    SetSIMDInstr(SIMD_AUTO);
+    SIMDExecInstr best = GetSIMDInstrAuto();
+
+    PrintAndLogEx(INFO, "Brute force benchmark using " _YELLOW_("%d") " threads", num_CPUs());
+    PrintAndLogEx(INFO, "---------+-----------------+-----------------+--------");
+    PrintAndLogEx(INFO, " SIMD    | states/s        | per thread      | log2");
+    PrintAndLogEx(INFO, "---------+-----------------+-----------------+--------");
+
+    float best_rate = 0;
+    char best_instr_set[12] = "no";
+    for (SIMDExecInstr instr = best; instr <= SIMD_NONE; instr++) {
+        char instr_set[12] = {0};
+        get_SIMD_instruction_set(instr, instr_set);
+
+        SetSIMDInstr(instr);
+        float rate = brute_force_benchmark();
+
+        PrintAndLogEx(INFO, " %-7s | %15.0f | %15.0f | %6.1f", instr_set, rate, rate / num_CPUs(), log(rate) / log(2.0));
+        if (rate > best_rate) {
+            best_rate = rate;
+            strcpy(best_instr_set, instr_set);
+        }
+    }
+    PrintAndLogEx(INFO, "---------+-----------------+-----------------+--------");
+    PrintAndLogEx(SUCCESS, "Fastest SIMD core: " _GREEN_("%s") " ( %1.0f million keys/s )", best_instr_set, best_rate / 1000000);
+
+    SetSIMDInstr(SIMD_AUTO);
+    return PM3_SUCCESS;
+}
+
 int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey, bool nonce_file_read, bool nonce_file_write, bool slow, int tests, uint64_t *foundkey, char *filename) {
     char progress_text[80];
     char instr_set[12] = {0};
 
-    get_SIMD_instruction_set(instr_set);
+    get_SIMD_instruction_set(GetSIMDInstrAuto(), instr_set);
 
     // initialize static arrays
     memset(part_sum_count, 0, sizeof(part_sum_count));
@@ -1272,7 +1272,7 @@ static int CmdTimeout(const char *Cmd) {
     int32_t arg = arg_get_int_def(ctx, 1, -1);
     CLIParserFree(ctx);
 
-    uint32_t oldTimeout = uart_get_timeouts();
+    uint32_t oldTimeout = GetCommunicationTimeout();
 
     // timeout is not given/invalid, just show the current timeout then return
     if (arg < 0) {
@@ -1287,7 +1287,10 @@ static int CmdTimeout(const char *Cmd) {
     } else if (newTimeout > 5000) {
         PrintAndLogEx(WARNING, "Timeout greater than 5000 ms makes the client unresponsive.");
     }
-    uart_reconfigure_timeouts(newTimeout);
+    if (SetCommunicationTimeout(newTimeout) != PM3_SUCCESS) {
+        PrintAndLogEx(WARNING, "No device connected, timeout unchanged");
+        return PM3_EINVARG;
+    }
     PrintAndLogEx(INFO, "Old communication timeout... %u ms", oldTimeout);
     PrintAndLogEx(INFO, "New communication timeout... " _GREEN_("%u") " ms", newTimeout);
     return PM3_SUCCESS;
@@ -1377,11 +1380,11 @@ static int CmdConnect(const char *Cmd) {
 
     // default back to previous used serial port
     if (strlen(port) == 0) {
-        if (strlen(g_conn.serial_port_name) == 0) {
+        if (strlen(GetCommunicationConn()->serial_port_name) == 0) {
             PrintAndLogEx(WARNING, "Must specify a serial port");
             return PM3_EINVARG;
         }
-        memcpy(port, g_conn.serial_port_name, sizeof(port));
+        memcpy(port, GetCommunicationConn()->serial_port_name, sizeof(port));
     }
 
     if (g_session.pm3_present) {
@@ -1433,7 +1436,7 @@ static int CmdBootloader(const char *Cmd) {
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     CLIParserFree(ctx);
     clearCommandBuffer();
-    flash_reboot_bootloader(g_conn.serial_port_name, false);
+    flash_reboot_bootloader(GetCommunicationConn()->serial_port_name, false);
     return PM3_SUCCESS;
 }
 
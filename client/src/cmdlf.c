@@ -22,6 +22,8 @@
 #include <limits.h>
 #include <ctype.h>
 #include <math.h>
+#include <dirent.h>
+#include <pthread.h>
 #include "cmdparser.h"      // command_t
 #include "comms.h"
 #include "commonutil.h"     // ARRAYLEN
@@ -69,9 +71,15 @@
 #include "crc.h"
 #include "pm3_cmd.h"        // for LF_CMDREAD_MAX_EXTRA_SYMBOLS
 #include "fpga.h"           // for set_fpga_mode
+#include "fileutils.h"      // saveFileJSONrootEx
+#include "wiegand_formats.h" // for streamed HID Prox
+#include "util_posix.h"     // msclock
+#include "parity.h"         // for streamed EM410x
 
 static int CmdHelp(const char *Cmd);
 
+#define LF_SEARCH_MIN_SAMPLES   2000
+
 // Informative user function.
 // loop and wait for either keyboard press or pm3 button to exit
 // if key event, send break loop cmd to Pm3
@@ -471,7 +479,7 @@ int CmdFlexdemod(const char *Cmd) {
 #endif
     int i, j, start, bit, sum;
 
-    int *data = calloc(g_GraphTraceLen, sizeof(int));
+    int *data = graph_scratch_alloc(g_GraphTraceLen * sizeof(int));
     if (data == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -496,7 +504,7 @@ int CmdFlexdemod(const char *Cmd) {
 
     if (start == size - LONG_WAIT) {
         PrintAndLogEx(WARNING, "nothing to wait for");
-        free(data);
+        graph_scratch_free(data);
         return PM3_ENODATA;
     }
 
@@ -540,7 +548,7 @@ int CmdFlexdemod(const char *Cmd) {
         }
     }
     RepaintGraphWindow();
-    free(data);
+    graph_scratch_free(data);
     return PM3_SUCCESS;
 }
 
@@ -739,6 +747,463 @@ int CmdLFConfig(const char *Cmd) {
     return lf_setconfig(&config);
 }
 
+// Streaming acquisition, see lf_stream()
+#define LF_STREAM_RING_SIZE     (1024 * 1024)   // raw bytes between the communication thread and the decoders
+#define LF_STREAM_CHUNK_SIZE    4096
+#define LF_STREAM_WINDOW        (16 * 1024)     // last samples kept for the graph
+#define LF_STREAM_REPEAT_MS     3000            // a credential is reported again when it was gone this long
+#define LF_STREAM_MIN_SWING     16              // signals swinging less are noise, no edges
+#define LF_STREAM_CONFIRM       8               // a frame counts when it is seen again within this many frame lengths
+
+typedef struct {
+    uint32_t hi2;
+    uint32_t hi;
+    uint64_t lo;
+    int type;
+} lf_stream_id_t;
+
+// The streaming decoders look at every sample once, as it arrives, and keep their
+// state from one chunk to the next. They work on the signal edges, crossings of
+// the middle of the signal envelope with some hysteresis.
+// The AC coupled ADC output decays towards the middle between edges, and tags
+// sending spikes rather than levels ring around it, the hysteresis keeps both from
+// making edges.
+typedef struct {
+    int32_t hi;         // envelope in 1/256, each side decays towards the other
+    int32_t lo;
+    uint8_t level;
+    uint8_t prev[4];    // the last samples, newest first
+} lf_stream_edges_t;
+
+// EM410x, ASK / Manchester, RF/16, 32, 40 or 64
+typedef struct {
+    lf_stream_edges_t edges;
+    uint64_t last_edge;
+    uint32_t score[4];      // how well the recent runs fit each clock
+    uint64_t bits[2];       // decoded bits, for both pairings of the half bits
+    uint8_t valid[2];       // consecutive Manchester bits in bits[]
+    uint8_t half;           // previous half bit
+    uint8_t pairing;
+    uint64_t halfs;         // half bits seen
+    uint64_t cand;          // a frame is reported when it repeats within a few frames of this one
+    uint64_t cand_at;
+} lf_stream_em410x_t;
+
+// HID Prox, FSK2a RF/50 fc/8 fc/10, 96 bit frames
+typedef struct {
+    lf_stream_edges_t edges;
+    uint64_t last_rise;
+    uint64_t run_start;     // first rising edge of the current frequency
+    uint8_t fc;             // frequency of the current run, 8 or 10, 0 when lost
+    uint32_t bits_hi;       // last 96 FSK bits
+    uint64_t bits_lo;
+    uint8_t valid;
+    uint64_t nbits;         // FSK bits seen
+    lf_stream_id_t cand;    // a frame is reported when it repeats within a few frames of this one
+    uint64_t cand_at;
+} lf_stream_hid_t;
+
+typedef struct lf_stream_decoder_s lf_stream_decoder_t;
+struct lf_stream_decoder_s {
+    void (*demod)(lf_stream_decoder_t *d, const uint8_t *samples, size_t n);
+    void (*print)(const lf_stream_id_t *id);
+    union {
+        lf_stream_em410x_t em410x;
+        lf_stream_hid_t hid;
+    } state;
+    uint64_t pos;           // samples seen
+    uint64_t start;         // msclock() at the start of the stream
+    lf_stream_id_t last;
+    uint64_t last_seen;
+};
+
+// 1 rising edge, -1 falling edge, 0 none. The hysteresis is the swing >> shift, it
+// delays the detection of slow edges, *lag is how many samples ago the steepest step was.
+static int lf_stream_edge(lf_stream_edges_t *e, uint8_t x, uint8_t shift, uint8_t *lag) {
+    int32_t v = x << 8;
+    if (e->hi == 0 && e->lo == 0) {
+        e->hi = v;
+        e->lo = v;
+    }
+    if (v > e->hi) {
+        e->hi = v;
+    } else {
+        e->hi -= (e->hi - e->lo) >> 12;
+    }
+    if (v < e->lo) {
+        e->lo = v;
+    } else {
+        e->lo += (e->hi - e->lo) >> 12;
+    }
+
+    int32_t swing = (e->hi - e->lo) >> 8;
+    int32_t mid = (e->hi + e->lo) >> 9;
+    int edge = 0;
+    if (swing >= LF_STREAM_MIN_SWING) {
+        if (e->level == 0 && x > mid + (swing >> shift)) {
+            edge = 1;
+        } else if (e->level == 1 && x < mid - (swing >> shift)) {
+            edge = -1;
+        }
+    }
+
+    if (edge) {
+        e->level = (edge > 0);
+        int32_t steepest = (x - e->prev[0]) * edge;
+        *lag = 0;
+        for (uint8_t k = 1; k < ARRAYLEN(e->prev); k++) {
+            int32_t step = (e->prev[k - 1] - e->prev[k]) * edge;
+            if (step > steepest) {
+                steepest = step;
+                *lag = k;
+            }
+        }
+    }
+    memmove(e->prev + 1, e->prev, ARRAYLEN(e->prev) - 1);
+    e->prev[0] = x;
+    return edge;
+}
+
+static bool lf_stream_same_id(const lf_stream_id_t *a, const lf_stream_id_t *b) {
+    return (a->hi2 == b->hi2) && (a->hi == b->hi) && (a->lo == b->lo) && (a->type == b->type);
+}
+
+static void lf_stream_found(lf_stream_decoder_t *d, const lf_stream_id_t *id) {
+    uint64_t now = msclock();
+    if (lf_stream_same_id(id, &d->last) == false || now - d->last_seen > LF_STREAM_REPEAT_MS) {
+        PrintAndLogEx(INFO, "--- " _CYAN_("%.1f s"), (float)(now - d->start) / 1000.0);
+        d->print(id);
+    }
+    d->last = *id;
+    d->last_seen = now;
+}
+
+// 9 header ones, 10 rows of 4 data bits and even parity, 4 column parity bits, a stop 0
+static bool lf_stream_em410x_frame(uint64_t f, uint64_t *id) {
+    if ((f >> 55) != 0x1FF || (f & 1)) {
+        return false;
+    }
+    uint8_t col = 0;
+    *id = 0;
+    for (int r = 0; r < 10; r++) {
+        uint8_t row = (f >> (50 - 5 * r)) & 0x1F;
+        if (evenparity8(row)) {
+            return false;
+        }
+        *id = (*id << 4) | (row >> 1);
+        col ^= row >> 1;
+    }
+    return ((f >> 1) & 0xF) == col;
+}
+
+static void lf_stream_em410x_half(lf_stream_decoder_t *d, uint8_t v) {
+    lf_stream_em410x_t *s = &d->state.em410x;
+
+    // every half bit completes a pair, of one or the other pairing
+    uint8_t p = s->pairing;
+    s->pairing ^= 1;
+    s->halfs++;
+    if (v == s->half) {
+        s->valid[p] = 0;
+        return;
+    }
+    s->half = v;
+    s->bits[p] = (s->bits[p] << 1) | (v ^ 1);
+    if (s->valid[p] < 64) {
+        s->valid[p]++;
+    }
+    if (s->valid[p] < 64) {
+        return;
+    }
+
+    lf_stream_id_t id = { .type = 1 };
+    if (lf_stream_em410x_frame(s->bits[p], &id.lo) || lf_stream_em410x_frame(~s->bits[p], &id.lo)) {
+        bool recent = (s->halfs - s->cand_at <= LF_STREAM_CONFIRM * 128);
+        if (id.lo == s->cand && recent) {
+            lf_stream_found(d, &id);
+        }
+        if (id.lo == s->cand || recent == false) {
+            s->cand = id.lo;
+            s->cand_at = s->halfs;
+        }
+    }
+}
+
+static void lf_stream_demod_em410x(lf_stream_decoder_t *d, const uint8_t *samples, size_t n) {
+    // half bit periods of RF/16, 32, 40, 64
+    static const uint8_t halfs[] = { 8, 16, 20, 32 };
+    lf_stream_em410x_t *s = &d->state.em410x;
+
+    for (size_t i = 0; i < n; i++, d->pos++) {
+        uint8_t lag = 0;
+        // some tags send spikes rather than levels, their ringing needs a wide hysteresis
+        int edge = lf_stream_edge(&s->edges, samples[i], 2, &lag);
+        if (edge == 0) {
+            continue;
+        }
+        uint32_t run = d->pos - lag - s->last_edge;
+        s->last_edge = d->pos - lag;
+
+        // runs are one or two half bits, the clock fitting most of the recent ones wins
+        uint8_t m[ARRAYLEN(halfs)];
+        size_t best = 0;
+        for (size_t k = 0; k < ARRAYLEN(halfs); k++) {
+            m[k] = (run + halfs[k] / 2) / halfs[k];
+            bool fit = (m[k] == 1 || m[k] == 2) && ABS((int)run - m[k] * halfs[k]) <= halfs[k] / 4;
+            if (fit == false) {
+                m[k] = 0;
+            }
+            s->score[k] = s->score[k] - (s->score[k] >> 4) + (fit ? 16 : 0);
+            if (s->score[k] > s->score[best]) {
+                best = k;
+            }
+        }
+
+        if (m[best] == 0) {
+            s->valid[0] = 0;
+            s->valid[1] = 0;
+            continue;
+        }
+        // the run had the level before the edge
+        for (uint8_t j = 0; j < m[best]; j++) {
+            lf_stream_em410x_half(d, edge < 0);
+        }
+    }
+}
+
+static void lf_stream_print_em410x(const lf_stream_id_t *id) {
+    printEM410x(id->hi, id->lo, false, id->type);
+}
+
+// preamble 00011101, then 44 Manchester coded bits, 10 is a 1
+static bool lf_stream_hid_frame(uint32_t f_hi, uint64_t f_lo, lf_stream_id_t *id) {
+    if ((f_hi >> 24) != 0x1D) {
+        return false;
+    }
+    uint32_t lo = 0;
+    for (int k = 43; k >= 0; k--) {
+        int i = 2 * k;
+        uint8_t a = (i + 1 >= 64) ? (f_hi >> (i + 1 - 64)) & 1 : (f_lo >> (i + 1)) & 1;
+        uint8_t b = (i >= 64) ? (f_hi >> (i - 64)) & 1 : (f_lo >> i) & 1;
+        if (a == b) {
+            return false;
+        }
+        id->hi2 = (id->hi2 << 1) | (id->hi >> 31);
+        id->hi = (id->hi << 1) | (lo >> 31);
+        lo = (lo << 1) | a;
+    }
+    id->lo = lo;
+    return true;
+}
+
+static void lf_stream_hid_bits(lf_stream_decoder_t *d, uint8_t bit, uint32_t cnt) {
+    lf_stream_hid_t *s = &d->state.hid;
+    for (uint32_t j = 0; j < cnt; j++) {
+        s->bits_hi = (s->bits_hi << 1) | (uint32_t)(s->bits_lo >> 63);
+        s->bits_lo = (s->bits_lo << 1) | bit;
+        if (s->valid < 96) {
+            s->valid++;
+        }
+        s->nbits++;
+        lf_stream_id_t id = {0};
+        if (s->valid == 96 && lf_stream_hid_frame(s->bits_hi, s->bits_lo, &id)) {
+            bool same = lf_stream_same_id(&id, &s->cand);
+            bool recent = (s->nbits - s->cand_at <= LF_STREAM_CONFIRM * 96);
+            if (same && recent) {
+                lf_stream_found(d, &id);
+            }
+            if (same || recent == false) {
+                s->cand = id;
+                s->cand_at = s->nbits;
+            }
+        }
+    }
+}
+
+static void lf_stream_demod_hid(lf_stream_decoder_t *d, const uint8_t *samples, size_t n) {
+    lf_stream_hid_t *s = &d->state.hid;
+
+    for (size_t i = 0; i < n; i++, d->pos++) {
+        // the subcarrier edges are all alike, the threshold crossings are evenly spaced
+        uint8_t lag = 0;
+        if (lf_stream_edge(&s->edges, samples[i], 3, &lag) <= 0) {
+            continue;
+        }
+        uint64_t period = d->pos - s->last_rise;
+        uint64_t boundary = s->last_rise;
+        s->last_rise = d->pos;
+
+        uint8_t fc = (period >= 6 && period <= 8) ? 8 : (period >= 9 && period <= 12) ? 10 : 0;
+        if (fc == s->fc) {
+            continue;
+        }
+
+        // a frequency run is over, 50 samples per bit, fc/10 is a 1
+        uint32_t nbits = (boundary - s->run_start + 25) / 50;
+        if (s->fc == 0 || nbits == 0 || nbits > 4) {
+            s->valid = 0;
+        } else {
+            lf_stream_hid_bits(d, (s->fc == 10), nbits);
+        }
+        s->fc = fc;
+        s->run_start = boundary;
+    }
+}
+
+static void lf_stream_print_hid(const lf_stream_id_t *id) {
+    wiegand_message_t packed = initialize_message_object(id->hi2, id->hi, (uint32_t)id->lo, 0);
+    HIDTryUnpack(&packed);
+    PrintAndLogEx(SUCCESS, "HID Prox raw: " _GREEN_("%08x%08x%08x"), id->hi2, id->hi, (uint32_t)id->lo);
+}
+
+// Streams samples until <Enter>, or `samples` if not 0, with bounded memory.
+// Samples go through a ring to the EM410x / HID Prox decoders and optionally into a file,
+// one byte per sample like `data load -b` expects. The graph keeps the last window.
+static int lf_stream(uint16_t cmd, bool verbose, uint64_t samples, const char *filename) {
+    if (!g_session.pm3_present) return PM3_ENOTTY;
+
+    sample_config current_config;
+    int res = lf_getconfig(&current_config);
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(ERR, "failed to get current device config");
+        return res;
+    }
+    const uint8_t bits_per_sample = current_config.bits_per_sample;
+
+    lf_stream_decoder_t decoders[] = {
+        { .demod = lf_stream_demod_em410x, .print = lf_stream_print_em410x },
+        { .demod = lf_stream_demod_hid, .print = lf_stream_print_hid },
+    };
+
+    FILE *f = NULL;
+    if (filename != NULL && filename[0] != '\0') {
+        f = fopen(filename, "wb");
+        if (f == NULL) {
+            PrintAndLogEx(ERR, "Could not create file " _YELLOW_("%s"), filename);
+            return PM3_EFILE;
+        }
+    }
+
+    uint8_t *ring = calloc(LF_STREAM_RING_SIZE, sizeof(uint8_t));
+    uint8_t *chunk = calloc(LF_STREAM_CHUNK_SIZE, sizeof(uint8_t));
+    uint8_t *unpacked = calloc(LF_STREAM_CHUNK_SIZE * 8, sizeof(uint8_t));
+    uint8_t *window = calloc(LF_STREAM_WINDOW, sizeof(uint8_t));
+    if (ring == NULL || chunk == NULL || unpacked == NULL || window == NULL) {
+        PrintAndLogEx(FAILED, "failed to allocate memory");
+        res = PM3_EMALLOC;
+        goto out;
+    }
+
+    clearCommandBuffer();
+
+    // In real-time mode, the LF bitstream should be loaded before receiving raw data.
+    res = set_fpga_mode(FPGA_BITSTREAM_LF);
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "failed to load LF bitstream to FPGA");
+        goto out;
+    }
+
+    SetCommunicationRawReceiveRing(ring, LF_STREAM_RING_SIZE);
+    SetCommunicationReceiveMode(true);
+
+    lf_sample_payload_t payload = {0};
+    payload.realtime = true;
+    payload.verbose = verbose;
+    SendCommandNG(cmd, (uint8_t *)&payload, sizeof(payload));
+
+    PrintAndLogEx(INFO, "Streaming... Press " _GREEN_("<Enter>") " to stop");
+
+    uint64_t start = msclock();
+    for (size_t i = 0; i < ARRAYLEN(decoders); i++) {
+        decoders[i].start = start;
+    }
+    uint64_t total = 0;
+    size_t fill = 0;
+    size_t dropped = 0;
+    uint32_t acc = 0;
+    uint8_t acc_bits = 0;
+    const uint8_t sample_mask = (1 << bits_per_sample) - 1;
+
+    while (kbd_enter_pressed() == false && (samples == 0 || total < samples)) {
+
+        size_t n = ReadRawDataRing(chunk, LF_STREAM_CHUNK_SIZE, 100, &dropped);
+        if (n == 0) {
+            if (IsCommunicationThreadDead()) {
+                res = PM3_EIO;
+                break;
+            }
+            continue;
+        }
+
+        // samples are packed MSB first across bytes
+        size_t cnt = 0;
+        for (size_t i = 0; i < n; i++) {
+            acc = (acc << 8) | chunk[i];
+            acc_bits += 8;
+            while (acc_bits >= bits_per_sample) {
+                acc_bits -= bits_per_sample;
+                unpacked[cnt++] = ((acc >> acc_bits) & sample_mask) << (8 - bits_per_sample);
+            }
+        }
+        if (samples && (total + cnt > samples)) {
+            cnt = samples - total;
+        }
+        total += cnt;
+
+        if (f != NULL) {
+            fwrite(unpacked, 1, cnt, f);
+        }
+
+        for (size_t i = 0; i < ARRAYLEN(decoders); i++) {
+            decoders[i].demod(&decoders[i], unpacked, cnt);
+        }
+
+        for (size_t i = 0; i < cnt;) {
+            if (fill == LF_STREAM_WINDOW) {
+                memmove(window, window + (LF_STREAM_WINDOW / 2), LF_STREAM_WINDOW / 2);
+                fill = LF_STREAM_WINDOW / 2;
+            }
+            size_t take = MIN(cnt - i, LF_STREAM_WINDOW - fill);
+            memcpy(window + fill, unpacked + i, take);
+            fill += take;
+            i += take;
+        }
+    }
+
+    SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+
+    // drain until the device stopped sending, before the communication thread expects packets again
+    uint64_t stop = msclock();
+    size_t n;
+    do {
+        n = ReadRawDataRing(chunk, LF_STREAM_CHUNK_SIZE, 200, &dropped);
+    } while (n > 0 && msclock() - stop < 2000);
+    SetCommunicationReceiveMode(false);
+
+    uint64_t ms = msclock() - start;
+    PrintAndLogEx(INFO, "Done: %" PRIu64 " samples in %.1f s", total, (float)ms / 1000.0);
+    if (dropped) {
+        PrintAndLogEx(WARNING, "Client fell behind, " _RED_("%zu") " bytes of samples dropped", dropped);
+    }
+    if (f != NULL) {
+        PrintAndLogEx(SUCCESS, "Saved samples to " _YELLOW_("%s"), filename);
+    }
+
+    if (fill != 0) {
+        getSamplesFromBufEx(window, fill, 8, verbose);
+    }
+
+out:
+    if (f != NULL) {
+        fclose(f);
+    }
+    free(window);
+    free(unpacked);
+    free(chunk);
+    free(ring);
+    return res;
+}
+
 static int lf_read_internal(bool realtime, bool verbose, uint64_t samples) {
     if (!g_session.pm3_present) return PM3_ENOTTY;
 
@@ -826,6 +1291,7 @@ int CmdLFRead(const char *Cmd) {
                   _CYAN_("it will try to use the real-time sampling mode."),
                   "lf read -v -s 12000   --> collect 12000 samples\n"
                   "lf read -s 3000 -@    --> oscilloscope style \n"
+                  "lf read --stream -f lf_samples.bin   --> stream until <Enter>, decode on the fly and save samples\n"
                  );
 
     void *argtable[] = {
@@ -833,21 +1299,40 @@ int CmdLFRead(const char *Cmd) {
         arg_u64_0("s", "samples", "<dec>", "number of samples to collect"),
         arg_lit0("v", "verbose", "verbose output"),
         arg_lit0("@", NULL, "continuous reading mode"),
+        arg_lit0(NULL, "stream", "stream samples until <Enter>, EM410x / HID Prox are decoded as they appear"),
+        arg_str0("f", "file", "<fn>", "save streamed samples, see `data load -b`"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     uint64_t samples = arg_get_u64_def(ctx, 1, 0);
     bool verbose = arg_get_lit(ctx, 2);
     bool cm = arg_get_lit(ctx, 3);
+    bool stream = arg_get_lit(ctx, 4);
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 5), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
     CLIParserFree(ctx);
 
+    if (g_session.pm3_present == false)
+        return PM3_ENOTTY;
+
+    if (stream) {
+        if (cm) {
+            PrintAndLogEx(WARNING, "continuous mode and streaming can't be combined");
+            return PM3_EINVARG;
+        }
+        return lf_stream(CMD_LF_ACQ_RAW_ADC, verbose, samples, filename);
+    }
+
+    if (fnlen) {
+        PrintAndLogEx(WARNING, "saving samples needs " _YELLOW_("--stream") ", use " _YELLOW_("`data save`") " otherwise");
+        return PM3_EINVARG;
+    }
+
     // the 40000 there should be the result of BigBuf_max_traceLen(),
     // but IDK how to get it.
     bool realtime = samples > 40000;
 
-    if (g_session.pm3_present == false)
-        return PM3_ENOTTY;
-
     if (cm || realtime) {
         PrintAndLogEx(INFO, "Press " _GREEN_("<Enter>") " to exit");
     }
@@ -952,6 +1437,7 @@ int CmdLFSniff(const char *Cmd) {
                   _CYAN_("it will try to use the real-time sampling mode."),
                   "lf sniff -v\n"
                   "lf sniff -s 3000 -@    --> oscilloscope style \n"
+                  "lf sniff --stream -f lf_sniff.bin   --> monitor a reader until <Enter>, decode on the fly and save samples\n"
                  );
 
     void *argtable[] = {
@@ -959,21 +1445,40 @@ int CmdLFSniff(const char *Cmd) {
         arg_u64_0("s", "samples", "<dec>", "number of samples to collect"),
         arg_lit0("v", "verbose", "verbose output"),
         arg_lit0("@", NULL, "continuous sniffing mode"),
+        arg_lit0(NULL, "stream", "stream samples until <Enter>, EM410x / HID Prox are decoded as they appear"),
+        arg_str0("f", "file", "<fn>", "save streamed samples, see `data load -b`"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     uint64_t samples = arg_get_u64_def(ctx, 1, 0);
     bool verbose = arg_get_lit(ctx, 2);
     bool cm = arg_get_lit(ctx, 3);
+    bool stream = arg_get_lit(ctx, 4);
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 5), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
     CLIParserFree(ctx);
 
+    if (g_session.pm3_present == false)
+        return PM3_ENOTTY;
+
+    if (stream) {
+        if (cm) {
+            PrintAndLogEx(WARNING, "continuous mode and streaming can't be combined");
+            return PM3_EINVARG;
+        }
+        return lf_stream(CMD_LF_SNIFF_RAW_ADC, verbose, samples, filename);
+    }
+
+    if (fnlen) {
+        PrintAndLogEx(WARNING, "saving samples needs " _YELLOW_("--stream") ", use " _YELLOW_("`data save`") " otherwise");
+        return PM3_EINVARG;
+    }
+
     // the 40000 there should be the result of BigBuf_max_traceLen(),
     // but IDK how to get it.
     bool realtime = samples > 40000;
 
-    if (g_session.pm3_present == false)
-        return PM3_ENOTTY;
-
     if (cm || realtime) {
         PrintAndLogEx(INFO, "Press " _GREEN_("<Enter>") " to exit");
     }
@@ -1011,7 +1516,7 @@ int lfsim_upload_gb(void) {
     payload_up.flag = 0x1;
 
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
 
     PacketResponseNG resp;
 
@@ -1039,7 +1544,7 @@ int lfsim_upload_gb(void) {
     PrintAndLogEx(NORMAL, "");
 
     // Disable fast mode before last command
-    g_conn.block_after_ACK = false;
+    GetCommunicationConn()->block_after_ACK = false;
     return PM3_SUCCESS;
 }
 
@@ -1539,6 +2044,9 @@ int CmdVchDemod(const char *Cmd) {
 
     // clone
     if (strcmp(Cmd, "clone") == 0) {
+        if (graph_reserve(strlen(bits) * 16) == false) {
+            return PM3_EMALLOC;
+        }
         g_GraphTraceLen = 0;
         char *s;
         for (s = bits; *s; s++) {
@@ -1674,6 +2182,375 @@ static int check_autocorrelate(const char *prefix, int clock) {
     return PM3_EFAILED;
 }
 
+typedef struct {
+    const char *name;
+    int (*demod)(bool verbose);
+} lf_search_t;
+
+static int demodIdteck_search(bool verbose) {
+    return demodIdteck(NULL, verbose);
+}
+
+static int demodParadox_search(bool verbose) {
+    return demodParadox(verbose, false);
+}
+
+// known tags tried by `lf search`, in this order
+static const lf_search_t lf_search_list[] = {
+    // ask / man
+    {"EM410x ID", demodEM410x},
+    {"FDX-A FECAVA Destron ID", demodDestron},
+    {"GALLAGHER ID", demodGallagher},
+    {"Noralsy ID", demodNoralsy},
+    {"Presco ID", demodPresco},
+    {"Securakey ID", demodSecurakey},
+    {"Viking ID", demodViking},
+    {"Visa2000 ID", demodVisa2k},
+
+    // ask / bi
+    {"FDX-B ID", demodFDXB},
+    {"Jablotron ID", demodJablotron},
+    {"Guardall G-Prox II ID", demodGuard},
+    {"NEDAP ID", demodNedap},
+
+    // nrz
+    {"PAC/Stanley ID", demodPac},
+
+    // fsk
+    {"HID Prox ID", demodHID},
+    {"AWID ID", demodAWID},
+    {"IO Prox ID", demodIOProx},
+    {"Pyramid ID", demodPyramid},
+    {"Paradox ID", demodParadox_search},
+
+    // psk
+    {"Idteck ID", demodIdteck_search},
+    {"KERI ID", demodKeri},
+    {"NexWatch ID", demodNexWatch},
+    {"Indala ID", demodIndala},
+};
+
+// run the known tag demodulators against the graph buffer, returns number of tags found.
+// Names of found tags are appended to found_list if given.
+static int lf_search_known(bool search_cont, json_t *found_list) {
+    int found = 0;
+    for (size_t i = 0; i < ARRAYLEN(lf_search_list); i++) {
+        if (lf_search_list[i].demod(true) != PM3_SUCCESS) {
+            continue;
+        }
+
+        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("%s") " found!", lf_search_list[i].name);
+        if (found_list) {
+            json_array_append_new(found_list, json_string(lf_search_list[i].name));
+        }
+
+        found++;
+        if (search_cont == false) {
+            break;
+        }
+    }
+    return found;
+}
+
+static int cmp_search_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// One capture searched by several threads. The clock detections the demodulators
+// have in common are run once up front, on the samples as loaded, and shared through
+// the clock cache. Every demodulator then runs on its own copy of the capture, with the
+// signal properties of the capture, and its output is kept apart so the report reads
+// like the one of a single thread.
+typedef struct {
+    graph_buffers_t *capture;
+    signal_t signal;
+    clock_cache_t *clocks;
+    size_t next;        // next demodulator to run
+    size_t stop;        // first demodulator that found a tag, when not searching on
+    bool search_cont;
+    int res[ARRAYLEN(lf_search_list)];
+    grabbed_output out[ARRAYLEN(lf_search_list)];
+} lf_search_job_t;
+
+typedef struct {
+    lf_search_job_t *job;
+    graph_buffers_t *gb;
+} lf_search_worker_t;
+
+static void *lf_search_thread(void *arg) {
+    lf_search_worker_t *w = (lf_search_worker_t *)arg;
+    lf_search_job_t *job = w->job;
+
+    graph_bind(w->gb);
+    clockCacheBind(job->clocks);
+
+    for (;;) {
+        size_t i = __atomic_fetch_add(&job->next, 1, __ATOMIC_SEQ_CST);
+        if (i >= ARRAYLEN(lf_search_list)) {
+            break;
+        }
+
+        // a tag was found earlier in the list, the rest would not have run
+        if (i > __atomic_load_n(&job->stop, __ATOMIC_SEQ_CST)) {
+            job->res[i] = PM3_ESOFT;
+            continue;
+        }
+
+        job->res[i] = PM3_EMALLOC;
+        if (graph_buffers_copy(w->gb, job->capture) == false) {
+            continue;
+        }
+        *getSignalProperties() = job->signal;
+
+        PrintAndLogRedirect(PRINTANDLOG_GRAB, &job->out[i], NULL);
+        job->res[i] = lf_search_list[i].demod(true);
+        if (job->res[i] == PM3_SUCCESS) {
+            PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("%s") " found!", lf_search_list[i].name);
+            if (job->search_cont == false) {
+                size_t stop = __atomic_load_n(&job->stop, __ATOMIC_SEQ_CST);
+                while (i < stop && __atomic_compare_exchange_n(&job->stop, &stop, i, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) == false) {
+                }
+            }
+        }
+        PrintAndLogRedirect(0, NULL, NULL);
+    }
+
+    clockCacheBind(NULL);
+    graph_bind(NULL);
+    graph_scratch_release();
+    return NULL;
+}
+
+// lf_search_known() for the capture in the graph buffer, with nthreads threads.
+// Output goes to out, in the order of lf_search_list.
+static int lf_search_known_mt(bool search_cont, json_t *found_list, grabbed_output *out, graph_buffers_t **gbs, size_t nthreads) {
+
+    size_t size = g_GraphTraceLen;
+    uint8_t *bits = calloc(size, sizeof(uint8_t));
+    if (bits == NULL) {
+        return 0;
+    }
+    size = getFromGraphBuffer(bits);
+
+    lf_search_job_t *job = calloc(1, sizeof(lf_search_job_t));
+    if (job == NULL) {
+        free(bits);
+        return 0;
+    }
+    job->capture = g_graph;
+    job->signal = *getSignalProperties();
+    job->stop = ARRAYLEN(lf_search_list);
+    job->search_cont = search_cont;
+    job->clocks = clockCacheNew(bits, size);
+
+    // candidate pass, clocks wanted by several demodulators of the list
+    if (job->clocks) {
+        clockCacheBind(job->clocks);
+        int clk = 0;
+        DetectASKClock(bits, size, &clk, 0);
+        clk = 64;
+        DetectASKClock(bits, size, &clk, 0);
+        clk = 32;
+        DetectASKClock(bits, size, &clk, 100);
+        clk = 32;
+        DetectASKClock(bits, size, &clk, 0);
+        clk = 40;
+        DetectASKClock(bits, size, &clk, 0);
+        size_t start = 0;
+        uint8_t phase = 0, fc = 0;
+        DetectPSKClock(bits, size, 0, &start, &phase, &fc);
+        start = 0;
+        DetectNRZClock(bits, size, 0, &start);
+        clockCacheBind(NULL);
+    }
+    free(bits);
+
+    pthread_t threads[ARRAYLEN(lf_search_list)];
+    lf_search_worker_t workers[ARRAYLEN(lf_search_list)];
+    size_t started = 0;
+    for (size_t i = 0; i < nthreads; i++) {
+        workers[i].job = job;
+        workers[i].gb = gbs[i];
+        if (pthread_create(&threads[started], NULL, lf_search_thread, &workers[i]) == 0) {
+            started++;
+        }
+    }
+    // no thread could be started, search here
+    if (started == 0) {
+        lf_search_worker_t w = { job, gbs[0] };
+        lf_search_thread(&w);
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    int found = 0;
+    for (size_t i = 0; i < ARRAYLEN(lf_search_list) && i <= job->stop; i++) {
+        if (job->out[i].ptr && job->out[i].idx) {
+            char *tmp = realloc(out->ptr, out->idx + job->out[i].idx + 1);
+            if (tmp) {
+                out->ptr = tmp;
+                memcpy(out->ptr + out->idx, job->out[i].ptr, job->out[i].idx);
+                out->idx += job->out[i].idx;
+                out->ptr[out->idx] = '\0';
+                out->size = out->idx + 1;
+            }
+        }
+        if (job->res[i] == PM3_SUCCESS) {
+            json_array_append_new(found_list, json_string(lf_search_list[i].name));
+            found++;
+        }
+    }
+
+    for (size_t i = 0; i < ARRAYLEN(lf_search_list); i++) {
+        free(job->out[i].ptr);
+    }
+    clockCacheFree(job->clocks);
+    free(job);
+    return found;
+}
+
+// offline `lf search` over every .pm3 capture in a directory, results as JSON.
+// Each capture gets the same search as `lf search -1`, with the demodulators spread
+// over the CPUs, see lf_search_known_mt().
+static int lf_search_dir(const char *dirname, const char *jsonfn, bool search_cont) {
+
+    DIR *dir = opendir(dirname);
+    if (dir == NULL) {
+        PrintAndLogEx(ERR, "can't open directory `" _YELLOW_("%s") "`", dirname);
+        return PM3_EFILE;
+    }
+
+    // sorted, so reports of the same directory can be compared
+    char **names = NULL;
+    size_t cnt = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (str_endswith(de->d_name, ".pm3") == false) {
+            continue;
+        }
+
+        char **tmp = realloc(names, (cnt + 1) * sizeof(char *));
+        if (tmp == NULL) {
+            break;
+        }
+        names = tmp;
+        names[cnt] = strdup(de->d_name);
+        if (names[cnt] != NULL) {
+            cnt++;
+        }
+    }
+    closedir(dir);
+
+    if (cnt == 0) {
+        PrintAndLogEx(WARNING, "no .pm3 files found in `" _YELLOW_("%s") "`", dirname);
+        free(names);
+        return PM3_EFILE;
+    }
+
+    qsort(names, cnt, sizeof(char *), cmp_search_names);
+
+    json_t *root = json_object();
+    json_t *files = json_array();
+    json_object_set_new(root, "Created", json_string("proxmark3"));
+    json_object_set_new(root, "FileType", json_string("lfsearch"));
+    json_object_set_new(root, "files", files);
+
+    // demodulator output goes into the report instead of the console, also when
+    // this command itself runs from pm3_console() with its own output routing
+    uint8_t old_flags;
+    grabbed_output *old_grab, *old_records;
+    PrintAndLogRedirectGet(&old_flags, &old_grab, &old_records);
+    grabbed_output output = {NULL, 0, 0};
+
+    // sample buffers of the search threads
+    size_t nthreads = MAX(1, MIN(num_CPUs(), (int)ARRAYLEN(lf_search_list)));
+    graph_buffers_t *gbs[ARRAYLEN(lf_search_list)] = {NULL};
+    for (size_t i = 0; i < nthreads; i++) {
+        gbs[i] = graph_buffers_new();
+        if (gbs[i] == NULL) {
+            nthreads = i;
+            break;
+        }
+    }
+    if (nthreads == 0) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        json_decref(root);
+        for (size_t i = 0; i < cnt; i++) {
+            free(names[i]);
+        }
+        free(names);
+        return PM3_EMALLOC;
+    }
+
+    size_t tags = 0;
+    for (size_t i = 0; i < cnt; i++) {
+
+        char path[FILE_PATH_SIZE + 256];
+        snprintf(path, sizeof(path), "%s%s%s", dirname, str_endswith(dirname, "/") ? "" : "/", names[i]);
+
+        PrintAndLogEx(INPLACE, "%zu / %zu  %s", i + 1, cnt, names[i]);
+
+        output.idx = 0;
+        PrintAndLogRedirect(PRINTANDLOG_GRAB, &output, NULL);
+
+        json_t *found_list = json_array();
+        int found = 0;
+        int res = getSamplesFromFile(path, false, false, false);
+        if (res == PM3_SUCCESS && g_GraphTraceLen >= LF_SEARCH_MIN_SAMPLES) {
+            found = lf_search_known_mt(search_cont, found_list, &output, gbs, nthreads);
+        }
+
+        PrintAndLogRedirect(old_flags, old_grab, old_records);
+
+        json_t *entry = json_object();
+        json_object_set_new(entry, "file", json_string(names[i]));
+        json_object_set_new(entry, "samples", json_integer(g_GraphTraceLen));
+        json_object_set_new(entry, "noise", json_boolean(getSignalProperties()->isnoise));
+        json_object_set_new(entry, "found", found_list);
+        json_object_set_new(entry, "output", json_string((output.ptr && output.idx) ? output.ptr : ""));
+        json_array_append_new(files, entry);
+
+        if (found) {
+            tags++;
+        }
+        free(names[i]);
+    }
+    free(names);
+    free(output.ptr);
+    for (size_t i = 0; i < nthreads; i++) {
+        graph_buffers_free(gbs[i]);
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(SUCCESS, "Searched " _YELLOW_("%zu") " files, tags found in " _GREEN_("%zu"), cnt, tags);
+
+    int res = PM3_SUCCESS;
+    if (jsonfn != NULL) {
+        res = saveFileJSONrootEx(jsonfn, root, JSON_INDENT(2), true, true, spDefault);
+    } else {
+        char *js = json_dumps(root, JSON_INDENT(2));
+        if (js) {
+            // the report is longer than one print, it goes out line by line
+            const char *line = js;
+            while (*line) {
+                const char *nl = strchr(line, '\n');
+                size_t n = (nl) ? (size_t)(nl - line) : strlen(line);
+                while (n > MAX_PRINT_BUFFER / 2) {
+                    PrintAndLogEx(NORMAL, "%.*s" NOLF, MAX_PRINT_BUFFER / 2, line);
+                    line += MAX_PRINT_BUFFER / 2;
+                    n -= MAX_PRINT_BUFFER / 2;
+                }
+                PrintAndLogEx(NORMAL, "%.*s", (int)n, line);
+                line += n + ((nl) ? 1 : 0);
+            }
+            free(js);
+        }
+    }
+    json_decref(root);
+    return res;
+}
+
 int CmdLFfind(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -1683,6 +2560,8 @@ int CmdLFfind(const char *Cmd) {
                   "lf search -u    -> try reading data from tag & search for known and unknown tag\n"
                   "lf search -1    -> use data from the GraphBuffer & search for known tag\n"
                   "lf search -1uc  -> use data from the GraphBuffer & search for known and unknown tag\n"
+                  "lf search --dir traces                        -> search all .pm3 captures in a folder\n"
+                  "lf search -c --dir traces --json report.json  -> same, report all matches to a json file\n"
                  );
 
     void *argtable[] = {
@@ -1690,21 +2569,35 @@ int CmdLFfind(const char *Cmd) {
         arg_lit0("1", NULL, "Use data from Graphbuffer to search (offline mode)"),
         arg_lit0("c", NULL, "Continue searching after successful match"),
         arg_lit0("u", NULL, "Search for unknown tags"),
+        arg_str0(NULL, "dir", "<path>", "Search every .pm3 file in this folder (offline mode)"),
+        arg_str0(NULL, "json", "<fn>", "Save the folder search results to this json file"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     bool use_gb = arg_get_lit(ctx, 1);
     bool search_cont = arg_get_lit(ctx, 2);
     bool search_unk = arg_get_lit(ctx, 3);
+
+    int dirlen = 0;
+    char dirname[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 4), (uint8_t *)dirname, FILE_PATH_SIZE, &dirlen);
+
+    int jsonlen = 0;
+    char jsonfn[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 5), (uint8_t *)jsonfn, FILE_PATH_SIZE, &jsonlen);
     CLIParserFree(ctx);
+
+    if (dirlen) {
+        return lf_search_dir(dirname, (jsonlen) ? jsonfn : NULL, search_cont);
+    }
+
     int found = 0;
     bool is_online = (g_session.pm3_present && (use_gb == false));
     if (is_online) {
         lf_read(false, 30000);
     }
 
-    size_t min_length = 2000;
-    if (g_GraphTraceLen < min_length) {
+    if (g_GraphTraceLen < LF_SEARCH_MIN_SAMPLES) {
         PrintAndLogEx(FAILED, "Data in Graphbuffer was too small.");
         return PM3_ESOFT;
     }
@@ -1782,191 +2675,12 @@ int CmdLFfind(const char *Cmd) {
         }
     }
 
-    // ask / man
-    if (demodEM410x(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("EM410x ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodDestron(true) == PM3_SUCCESS) { // to do before HID
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("FDX-A FECAVA Destron ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodGallagher(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("GALLAGHER ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNoralsy(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Noralsy ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodPresco(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Presco ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodSecurakey(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Securakey ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodViking(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Viking ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodVisa2k(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Visa2000 ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-
-    // ask / bi
-    if (demodFDXB(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("FDX-B ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodJablotron(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Jablotron ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodGuard(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Guardall G-Prox II ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNedap(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("NEDAP ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-
-    // nrz
-    if (demodPac(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("PAC/Stanley ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-
-    // fsk
-    if (demodHID(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("HID Prox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodAWID(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("AWID ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodIOProx(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("IO Prox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodPyramid(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Pyramid ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodParadox(true, false) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Paradox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
+    int n = lf_search_known(search_cont, NULL);
+    found += n;
+    if (n && search_cont == false) {
+        goto out;
     }
 
-    // psk
-    if (demodIdteck(NULL, true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Idteck ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodKeri(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("KERI ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNexWatch(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("NexWatch ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodIndala(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Indala ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
     /*
     if (demodTI() == PM3_SUCCESS) {
         PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Texas Instrument ID") " found!");
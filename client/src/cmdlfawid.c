@@ -145,7 +145,7 @@ static int CmdAWIDWatch(const char *Cmd) {
 //print full AWID Prox ID and some bit format details if found
 int demodAWID(bool verbose) {
     (void) verbose; // unused so far
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(DEBUG, "DEBUG: Error - AWID failed to allocate memory");
         return PM3_EMALLOC;
@@ -154,7 +154,7 @@ int demodAWID(bool verbose) {
     size_t size = getFromGraphBuffer(bits);
     if (size == 0) {
         PrintAndLogEx(DEBUG, "DEBUG: Error - AWID not enough samples");
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ENODATA;
     }
     //get binary from fsk wave
@@ -175,7 +175,7 @@ int demodAWID(bool verbose) {
         else
             PrintAndLogEx(DEBUG, "DEBUG: Error - AWID error demoding fsk %d", idx);
 
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -204,7 +204,7 @@ int demodAWID(bool verbose) {
     size = removeParity(bits, idx + 8, 4, 1, 88);
     if (size != 66) {
         PrintAndLogEx(DEBUG, "DEBUG: Error - AWID at parity check-tag size does not match AWID format");
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -291,7 +291,7 @@ int demodAWID(bool verbose) {
             }
             break;
     }
-    free(bits);
+    graph_scratch_free(bits);
 
     PrintAndLogEx(DEBUG, "DEBUG: AWID idx: %d, Len: %zu", idx, size);
     PrintAndLogEx(DEBUG, "DEBUG: Printing DemodBuffer:");
@@ -170,13 +170,13 @@ static void em4x50_seteml(uint8_t *src, uint32_t offset, uint32_t numofbytes) {
     PrintAndLogEx(INFO, "uploading to emulator memory");
     PrintAndLogEx(INFO, "." NOLF);
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
     for (size_t i = offset; i < numofbytes; i += PM3_CMD_DATA_SIZE_MIX) {
 
         size_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE_MIX);
         if (len == numofbytes - i) {
             // Disable fast mode on last packet
-            g_conn.block_after_ACK = false;
+            GetCommunicationConn()->block_after_ACK = false;
         }
         clearCommandBuffer();
         SendCommandMIX(CMD_LF_EM4X50_ESET, i, len, 0, src + i, len);
@@ -118,7 +118,7 @@ int demodHID(bool verbose) {
     //raw fsk demod no manchester decoding no start bit finding just get binary from wave
     uint32_t hi2 = 0, hi = 0, lo = 0;
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -126,7 +126,7 @@ int demodHID(bool verbose) {
     size_t size = getFromGraphBuffer(bits);
     if (size == 0) {
         PrintAndLogEx(DEBUG, "DEBUG: Error - " _RED_("HID not enough samples"));
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
     //get binary from fsk wave
@@ -147,13 +147,13 @@ int demodHID(bool verbose) {
         else
             PrintAndLogEx(DEBUG, "DEBUG: Error - " _RED_("HID error demoding fsk %d"), idx);
 
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
     setDemodBuff(bits, size, idx);
     setClockGrid(50, waveIdx + (idx * 50));
-    free(bits);
+    graph_scratch_free(bits);
 
     if (hi2 == 0 && hi == 0 && lo == 0) {
         PrintAndLogEx(DEBUG, "DEBUG: Error - " _RED_("HID no values found"));
@@ -95,7 +95,7 @@ static int CmdLFHitagList(const char *Cmd) {
         return PM3_ETIMEOUT;
     }
 
-    uint16_t traceLen = resp.arg[2];
+    uint32_t traceLen = resp.arg[2];
     if (traceLen > PM3_CMD_DATA_SIZE) {
         uint8_t *p = realloc(got, traceLen);
         if (p == NULL) {
@@ -111,7 +111,7 @@ static int CmdLFHitagList(const char *Cmd) {
         }
     }
 
-    PrintAndLogEx(NORMAL, "recorded activity (TraceLen = %d bytes):");
+    PrintAndLogEx(NORMAL, "recorded activity (TraceLen = %"PRIu32" bytes):", traceLen);
     PrintAndLogEx(NORMAL, " ETU     :nbits: who bytes");
     PrintAndLogEx(NORMAL, "---------+-----+----+-----------");
 
@@ -1838,7 +1838,7 @@ static int CmdLFHitag2PWMDemod(const char *Cmd) {
     uint8_t fchigh = (uint8_t)arg_get_int_def(ctx, 3, 29);
     CLIParserFree(ctx);
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(INFO, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -1850,7 +1850,7 @@ static int CmdLFHitag2PWMDemod(const char *Cmd) {
 
     if (size < 255) {
         PrintAndLogEx(INFO, "too few samples in buffer");
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -1858,7 +1858,7 @@ static int CmdLFHitag2PWMDemod(const char *Cmd) {
     size = HitagPWMDemod(bits, size, &fchigh, &fclow, &start_idx, g_DemodBitRangeBuffer);
     if (size == 0) {
         PrintAndLogEx(FAILED, "No wave detected");
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -1878,7 +1878,7 @@ static int CmdLFHitag2PWMDemod(const char *Cmd) {
     PrintAndLogEx(INFO, "--- " _CYAN_("HITAG/PWM") " ---------------------------");
     printDemodBuff(0, false, false, false);
     printDemodBuff(0, false, false, true);
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 */
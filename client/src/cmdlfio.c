@@ -66,7 +66,7 @@ static int CmdIOProxWatch(const char *Cmd) {
 int demodIOProx(bool verbose) {
     (void) verbose; // unused so far
     int idx = 0, retval = PM3_SUCCESS;
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -74,7 +74,7 @@ int demodIOProx(bool verbose) {
     size_t size = getFromGraphBuffer(bits);
     if (size < 65) {
         PrintAndLogEx(DEBUG, "DEBUG: Error - IO prox not enough samples in GraphBuffer");
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
     //get binary from fsk wave
@@ -98,7 +98,7 @@ int demodIOProx(bool verbose) {
                 PrintAndLogEx(DEBUG, "DEBUG: Error - IO prox error demoding fsk %d", idx);
             }
         }
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
     setDemodBuff(bits, size, idx);
@@ -109,7 +109,7 @@ int demodIOProx(bool verbose) {
             PrintAndLogEx(DEBUG, "DEBUG: Error - IO prox data not found - FSK Bits: %zu", size);
             if (size > 92) PrintAndLogEx(DEBUG, "%s", sprint_bytebits_bin_break(bits, 92, 16));
         }
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -163,7 +163,7 @@ int demodIOProx(bool verbose) {
         printDemodBuff(0, false, false, true);
         printDemodBuff(0, false, false, false);
     }
-    free(bits);
+    graph_scratch_free(bits);
     return retval;
 }
 
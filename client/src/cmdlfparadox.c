@@ -103,7 +103,7 @@ static uint8_t GetParadoxBits(const uint32_t fc, const uint32_t cn, unsigned int
 int demodParadox(bool verbose, bool oldChksum) {
     (void) verbose; // unused so far
     //raw fsk demod no manchester decoding no start bit finding just get binary from wave
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(FAILED, "failed to allocate memory");
         return PM3_EMALLOC;
@@ -111,7 +111,7 @@ int demodParadox(bool verbose, bool oldChksum) {
     size_t size = getFromGraphBuffer(bits);
     if (size == 0) {
         PrintAndLogEx(DEBUG, "DEBUG: Error - Paradox not enough samples");
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -130,7 +130,7 @@ int demodParadox(bool verbose, bool oldChksum) {
         else
             PrintAndLogEx(DEBUG, "DEBUG: Error - Paradox error demoding fsk %d", idx);
 
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -181,7 +181,7 @@ int demodParadox(bool verbose, bool oldChksum) {
 
     if (hi2 == 0 && hi == 0 && lo == 0) {
         PrintAndLogEx(DEBUG, "DEBUG: Error - Paradox no value found");
-        free(bits);
+        graph_scratch_free(bits);
         return PM3_ESOFT;
     }
 
@@ -237,7 +237,7 @@ int demodParadox(bool verbose, bool oldChksum) {
         printDemodBuff(0, false, false, false);
     }
 
-    free(bits);
+    graph_scratch_free(bits);
     return PM3_SUCCESS;
 }
 
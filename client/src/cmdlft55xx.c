@@ -432,13 +432,13 @@ int clone_t55xx_tag(uint32_t *blockdata, uint8_t numblocks) {
     PacketResponseNG resp;
 
     // fast push mode
-    g_conn.block_after_ACK = true;
+    GetCommunicationConn()->block_after_ACK = true;
 
     for (int8_t i = 0; i < numblocks; i++) {
 
         // Disable fast mode on last packet
         if (i == numblocks - 1) {
-            g_conn.block_after_ACK = false;
+            GetCommunicationConn()->block_after_ACK = false;
         }
 
         clearCommandBuffer();
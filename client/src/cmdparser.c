@@ -82,7 +82,7 @@ bool IfPm3FpcUsartHostFromUsb(void) {
         return false;
     if (g_pm3_capabilities.compiled_with_fpc_usart_host == false)
         return false;
-    return !g_conn.send_via_fpc_usart;
+    return !GetCommunicationConn()->send_via_fpc_usart;
 }
 
 bool IfPm3FpcUsartDevFromUsb(void) {
@@ -92,7 +92,7 @@ bool IfPm3FpcUsartDevFromUsb(void) {
     if (g_pm3_capabilities.compiled_with_fpc_usart_dev == false)
         return false;
 
-    return !g_conn.send_via_fpc_usart;
+    return !GetCommunicationConn()->send_via_fpc_usart;
 }
 
 bool IfPm3FpcUsartFromUsb(void) {
@@ -35,18 +35,18 @@ static int CmdHelp(const char *Cmd);
 
 // trace pointer
 static uint8_t *gs_trace;
-static uint16_t gs_traceLen = 0;
+static uint32_t gs_traceLen = 0;
 
-static bool is_last_record(uint16_t tracepos, uint16_t traceLen) {
+static bool is_last_record(uint32_t tracepos, uint32_t traceLen) {
     return ((tracepos + TRACELOG_HDR_LEN) >= traceLen);
 }
 
-static bool next_record_is_response(uint16_t tracepos, uint8_t *trace) {
+static bool next_record_is_response(uint32_t tracepos, uint8_t *trace) {
     const tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
     return (hdr->isResponse);
 }
 
-static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint16_t *tracepos, uint16_t traceLen,
+static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint32_t *tracepos, uint32_t traceLen,
                                       uint8_t *trace, const uint8_t *frame, uint8_t *topaz_reader_command, uint16_t *data_len) {
 
 #define MAX_TOPAZ_READER_CMD_LEN 16
@@ -93,7 +93,7 @@ static uint8_t calc_pos(const uint8_t *d) {
 
 // Copy an existing buffer into client trace buffer
 // I think this is cleaner than further globalizing gs_trace, and may lend itself to more modularity later?
-bool ImportTraceBuffer(const uint8_t *trace_src, uint16_t trace_len) {
+bool ImportTraceBuffer(const uint8_t *trace_src, uint32_t trace_len) {
     if (trace_len == 0 || trace_src == NULL) return (false);
     if (gs_trace) {
         free(gs_trace);
@@ -114,7 +114,7 @@ static uint8_t extract_epurse[8] = {0};
 
 #define SKIP_TO_NEXT(a)  (TRACELOG_HDR_LEN + (a)->data_len + TRACELOG_PARITY_LEN((a)))
 
-static uint16_t extractChall_ev2(uint16_t tracepos, uint8_t *trace, uint8_t cmdpos, uint8_t long_jmp) {
+static uint32_t extractChall_ev2(uint32_t tracepos, uint8_t *trace, uint8_t cmdpos, uint8_t long_jmp) {
     tracelog_hdr_t *next_hdr = (tracelog_hdr_t *)(trace + tracepos);
     if (next_hdr->data_len != 21) {
         return 0;
@@ -135,7 +135,7 @@ static uint16_t extractChall_ev2(uint16_t tracepos, uint8_t *trace, uint8_t cmdp
     return tracepos;
 }
 
-static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t *trace) {
+static uint32_t extractChallenges(uint32_t tracepos, uint32_t traceLen, uint8_t *trace) {
 
     // sanity check
     if (is_last_record(tracepos, traceLen)) {
@@ -404,7 +404,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
             }
             case MFDES_AUTHENTICATE_EV2F: {
                 PrintAndLogEx(INFO, "AUTH EV2 First");
-                uint16_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
+                uint32_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
                 if (tmp == 0)
                     break;
                 else
@@ -413,7 +413,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
             }
             case MFDES_AUTHENTICATE_EV2NF: {
                 PrintAndLogEx(INFO, "AUTH EV2 Non First");
-                uint16_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
+                uint32_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
                 if (tmp == 0)
                     break;
                 else
@@ -425,7 +425,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
     return tracepos;
 }
 
-static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol) {
+static uint32_t printHexLine(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint8_t protocol) {
     // sanity check
     if (is_last_record(tracepos, traceLen)) return traceLen;
 
@@ -443,7 +443,7 @@ static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trac
         return tracepos;
     }
 
-    uint16_t ret;
+    uint32_t ret;
 
     switch (protocol) {
         case ISO_14443A: {
@@ -491,7 +491,7 @@ static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trac
     return ret;
 }
 
-static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
+static uint32_t printTraceLine(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint32_t first_timestamp, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
                                const uint64_t *mfDicKeys, uint32_t mfDicKeysCount) {
     // sanity check
     if (is_last_record(tracepos, traceLen)) {
@@ -502,7 +502,6 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
     uint32_t end_of_transmission_timestamp = 0;
     uint8_t topaz_reader_command[9];
     char explanation[60] = {0};
-    tracelog_hdr_t *first_hdr = (tracelog_hdr_t *)(trace);
     tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
 
     uint32_t duration = hdr->duration;
@@ -856,8 +855,8 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
         if (j == 0) {
 
 
-            uint32_t time1 = hdr->timestamp - first_hdr->timestamp;
-            uint32_t time2 = end_of_transmission_timestamp - first_hdr->timestamp;
+            uint32_t time1 = hdr->timestamp - first_timestamp;
+            uint32_t time2 = end_of_transmission_timestamp - first_timestamp;
             if (prev_eot) {
                 time1 = hdr->timestamp - previous_end_of_transmission_timestamp;
                 time2 = duration;
@@ -1045,8 +1044,8 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
 
         const tracelog_hdr_t *next_hdr = (tracelog_hdr_t *)(trace + tracepos);
 
-        uint32_t time1 = end_of_transmission_timestamp - first_hdr->timestamp;
-        uint32_t time2 = next_hdr->timestamp - first_hdr->timestamp;
+        uint32_t time1 = end_of_transmission_timestamp - first_timestamp;
+        uint32_t time2 = next_hdr->timestamp - first_timestamp;
         if (prev_eot) {
             time1 = 0;
             time2 = next_hdr->timestamp - end_of_transmission_timestamp;
@@ -1070,6 +1069,93 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
     return tracepos;
 }
 
+// Trace files are a sequence of self delimiting records (tracelog_hdr_t + frame + parity).
+// Instead of loading a whole file, trace list can walk it through a sliding window.
+// The window keeps enough look ahead for a record plus the records the decoders peek at
+// (topaz frame merging, frame delay time of the next record).
+#define TRACE_STREAM_BUF_SIZE     (512 * 1024)
+#define TRACE_STREAM_LOOKAHEAD    (128 * 1024)
+
+typedef struct {
+    FILE *f;
+    uint8_t *buf;
+    uint32_t len;
+    uint64_t offset;   // file offset of buf[0]
+    uint64_t size;     // file size
+    bool eof;
+} trace_stream_t;
+
+// buffer mode, walks an already loaded trace
+static void trace_stream_buffer(trace_stream_t *ts, uint8_t *trace, uint32_t traceLen) {
+    memset(ts, 0, sizeof(trace_stream_t));
+    ts->buf = trace;
+    ts->len = traceLen;
+    ts->size = traceLen;
+    ts->eof = true;
+}
+
+static void trace_stream_close(trace_stream_t *ts) {
+    if (ts->f) {
+        fclose(ts->f);
+        free(ts->buf);
+    }
+    memset(ts, 0, sizeof(trace_stream_t));
+}
+
+// move the unread part to the front of the window and top it up from file
+static void trace_stream_fill(trace_stream_t *ts, uint32_t *tracepos) {
+    if (ts->eof || (ts->len - MIN(*tracepos, ts->len)) >= TRACE_STREAM_LOOKAHEAD) {
+        return;
+    }
+
+    uint32_t keep = ts->len - MIN(*tracepos, ts->len);
+    memmove(ts->buf, ts->buf + ts->len - keep, keep);
+    ts->offset += ts->len - keep;
+    ts->len = keep;
+    *tracepos = 0;
+
+    size_t want = TRACE_STREAM_BUF_SIZE - ts->len;
+    size_t got = fread(ts->buf + ts->len, 1, want, ts->f);
+    ts->len += got;
+    if (got < want) {
+        ts->eof = true;
+    }
+}
+
+static int trace_stream_open(trace_stream_t *ts, const char *filename) {
+    memset(ts, 0, sizeof(trace_stream_t));
+
+    char *path = NULL;
+    if (searchFile(&path, TRACES_SUBDIR, filename, ".trace", true) != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "Could not open file " _YELLOW_("%s"), filename);
+        return PM3_EFILE;
+    }
+
+    ts->f = fopen(path, "rb");
+    free(path);
+    if (ts->f == NULL) {
+        PrintAndLogEx(FAILED, "Could not open file " _YELLOW_("%s"), filename);
+        return PM3_EFILE;
+    }
+
+    ts->buf = calloc(TRACE_STREAM_BUF_SIZE, sizeof(uint8_t));
+    if (ts->buf == NULL) {
+        PrintAndLogEx(FAILED, "Cannot allocate memory for trace");
+        fclose(ts->f);
+        ts->f = NULL;
+        return PM3_EMALLOC;
+    }
+
+    fseek(ts->f, 0, SEEK_END);
+    long fsize = ftell(ts->f);
+    fseek(ts->f, 0, SEEK_SET);
+    ts->size = (fsize > 0) ? fsize : 0;
+
+    uint32_t tracepos = 0;
+    trace_stream_fill(ts, &tracepos);
+    return PM3_SUCCESS;
+}
+
 static int download_trace(void) {
 
     if (IfPm3Present() == false) {
@@ -1166,7 +1252,7 @@ static int CmdTraceExtract(const char *Cmd) {
         return PM3_SUCCESS;
     }
 
-    uint16_t tracepos = 0;
+    uint32_t tracepos = 0;
 
     while (tracepos < gs_traceLen) {
         tracepos = extractChallenges(tracepos, gs_traceLen, gs_trace);
@@ -1262,8 +1348,9 @@ int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol)
     char example[200] = {0};
     snprintf(example, sizeof(example) - 1,
              "%s list --frame      -> show frame delay times\n"
-             "%s list -1           -> use trace buffer ",
-             alias, alias);
+             "%s list -1           -> use trace buffer\n"
+             "%s list --tf mytrace -> stream trace file, no size limit",
+             alias, alias, alias);
     char fullalias[100] = {0};
     snprintf(fullalias, sizeof(fullalias) - 1, "%s list", alias);
     CLIParserInit(&ctx, fullalias, desc, example);
@@ -1278,12 +1365,13 @@ int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol)
         arg_lit0("x", NULL, "show hexdump to convert to pcap(ng)\n"
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_str0(NULL, "tf", "<fn>", "stream trace from file instead of trace buffer"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     CLIParserFree(ctx);
 
-    char args[128] = {0};
+    char args[128 + FILE_PATH_SIZE] = {0};
     snprintf(args, sizeof(args), "-t %s ", protocol);
     strncat(args, Cmd, sizeof(args) - strlen(args) - 1);
     return CmdTraceList(args);
@@ -1318,7 +1406,8 @@ int CmdTraceList(const char *Cmd) {
                   "\n"
                   "trace list -t mf -f mfc_default_keys.dic     -> use default dictionary file\n"
                   "trace list -t 14a --frame                    -> show frame delay times\n"
-                  "trace list -t 14a -1                         -> use trace buffer "
+                  "trace list -t 14a -1                         -> use trace buffer\n"
+                  "trace list -t 14a --tf hf_14a_mfu            -> stream trace file, no size limit"
                  );
 
     void *argtable[] = {
@@ -1332,6 +1421,7 @@ int CmdTraceList(const char *Cmd) {
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0("t", "type", NULL, "protocol to annotate the trace"),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_str0(NULL, "tf", "<fn>", "stream trace from file instead of trace buffer"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1355,6 +1445,14 @@ int CmdTraceList(const char *Cmd) {
         diclen = 0;
     }
 
+    int tflen = 0;
+    char tracefile[FILE_PATH_SIZE] = {0};
+    if (CLIParamStrToBuf(arg_get_str(ctx, 9), (uint8_t *)tracefile, FILE_PATH_SIZE, &tflen)) {
+        PrintAndLogEx(FAILED, "Trace file name too long or invalid.");
+        CLIParserFree(ctx);
+        return PM3_EINVARG;
+    }
+
     CLIParserFree(ctx);
 
     clearCommandBuffer();
@@ -1389,26 +1487,37 @@ int CmdTraceList(const char *Cmd) {
         return PM3_EINVARG;
     }
 
-    if (use_buffer == false) {
-        download_trace();
-    } else if (gs_traceLen == 0 || gs_trace == NULL) {
-
-        if (IfPm3Present() == false) {
-            PrintAndLogEx(FAILED, "You requested a trace list in offline mode but there is no trace.");
-        } else {
-            PrintAndLogEx(FAILED, "You requested a trace list but there is no trace.");
+    trace_stream_t ts;
+    if (tflen) {
+        int res = trace_stream_open(&ts, tracefile);
+        if (res != PM3_SUCCESS) {
+            return res;
         }
+    } else {
+        if (use_buffer == false) {
+            download_trace();
+        } else if (gs_traceLen == 0 || gs_trace == NULL) {
 
-        PrintAndLogEx(FAILED, "Consider using `" _YELLOW_("trace load") "` or removing parameter `" _YELLOW_("-1") "`");
-        return PM3_EINVARG;
+            if (IfPm3Present() == false) {
+                PrintAndLogEx(FAILED, "You requested a trace list in offline mode but there is no trace.");
+            } else {
+                PrintAndLogEx(FAILED, "You requested a trace list but there is no trace.");
+            }
+
+            PrintAndLogEx(FAILED, "Consider using `" _YELLOW_("trace load") "` or removing parameter `" _YELLOW_("-1") "`");
+            return PM3_EINVARG;
+        }
+        trace_stream_buffer(&ts, gs_trace, gs_traceLen);
     }
 
-    PrintAndLogEx(SUCCESS,  "Recorded activity ( " _YELLOW_("%u") " bytes )", gs_traceLen);
-    if (gs_traceLen == 0) {
+    PrintAndLogEx(SUCCESS,  "Recorded activity ( " _YELLOW_("%" PRIu64) " bytes )", ts.size);
+    if (ts.len < TRACELOG_HDR_LEN) {
+        trace_stream_close(&ts);
         return PM3_SUCCESS;
     }
 
-    uint16_t tracepos = 0;
+    uint32_t tracepos = 0;
+    uint32_t first_timestamp = ((tracelog_hdr_t *)ts.buf)->timestamp;
 
     /*
     if (protocol == FELICA) {
@@ -1416,8 +1525,8 @@ int CmdTraceList(const char *Cmd) {
     } */
 
     if (show_hex) {
-        while (tracepos < gs_traceLen) {
-            tracepos = printHexLine(tracepos, gs_traceLen, gs_trace, protocol);
+        for (trace_stream_fill(&ts, &tracepos); tracepos < ts.len; trace_stream_fill(&ts, &tracepos)) {
+            tracepos = printHexLine(tracepos, ts.len, ts.buf, protocol);
         }
     } else {
 
@@ -1541,6 +1650,7 @@ int CmdTraceList(const char *Cmd) {
         // clean authentication data used with the mifare classic decrypt fct
         if (protocol == ISO_14443A || protocol == PROTO_MIFARE || protocol == PROTO_MFPLUS) {
             ClearAuthData();
+            ClearAuthKeyCache();
         }
 
         // reset hitag state  machine
@@ -1554,8 +1664,8 @@ int CmdTraceList(const char *Cmd) {
             prev_EOT = &previous_EOT;
         }
 
-        while (tracepos < gs_traceLen) {
-            tracepos = printTraceLine(tracepos, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+        for (trace_stream_fill(&ts, &tracepos); tracepos < ts.len; trace_stream_fill(&ts, &tracepos)) {
+            tracepos = printTraceLine(tracepos, ts.len, ts.buf, first_timestamp, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
 
             if (kbd_enter_pressed()) {
                 PrintAndLogEx(INFO, "User interrupted detected. Aborting");
@@ -1568,6 +1678,8 @@ int CmdTraceList(const char *Cmd) {
         }
     }
 
+    trace_stream_close(&ts);
+
     if (show_hex) {
         PrintAndLogEx(HINT, "syntax to use: " _YELLOW_("`text2pcap -t \"%%S.\" -l 264 -n <input-text-file> <output-pcapng-file>`"));
     }
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "uart/uart.h"
 #include "ui.h"
@@ -30,55 +31,110 @@
 #include "util_posix.h" // msclock
 #include "util_darwin.h" // en/dis-ableNapp();
 #include "usart_defs.h"
+#include "graph.h"     // graph_bind
 
 // #define COMMS_DEBUG
 // #define COMMS_DEBUG_RAW
 
-// Serial port that we are communicating with the PM3 on.
-static serial_port sp = NULL;
-
 communication_arg_t g_conn;
 capabilities_t g_pm3_capabilities;
 
-static pthread_t communication_thread;
 static pthread_t reconnect_thread;
 
 static bool reconnect_ok = false;
 
-static bool comm_thread_dead = false;
-static bool comm_raw_mode = false;
-static uint8_t *comm_raw_data = NULL;
-static size_t comm_raw_len = 0;
-static size_t comm_raw_pos = 0;
-
-// Transmit buffer.
-static PacketCommandOLD txBuffer;
-static PacketCommandNGRaw txBufferNG;
-static size_t txBufferNGLen;
-static bool txBuffer_pending = false;
-static pthread_mutex_t txBufferMutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t txBufferSig = PTHREAD_COND_INITIALIZER;
-
-// Used by PacketResponseReceived as a ring buffer for messages that are yet to be
-// processed by a command handler (WaitForResponse{,Timeout})
-static PacketResponseNG rxBuffer[CMD_BUFFER_SIZE];
-
-// Points to the next empty position to write to
-static int cmd_head = 0;
-
-// Points to the position of the last unread command
-static int cmd_tail = 0;
+// Everything needed to talk to one Proxmark3.
+// The client only ever uses comm_primary, libpm3 users can open more devices (see pm3_open)
+struct comm_ctx {
+    // Serial port that we are communicating with the PM3 on.
+    serial_port sp;
+    communication_arg_t *conn;
+    // conn of an additional device, the primary one uses g_conn
+    communication_arg_t own_conn;
+
+    pthread_t communication_thread;
+
+    bool comm_thread_dead;
+    bool comm_raw_mode;
+    uint8_t *comm_raw_data;
+    size_t comm_raw_len;
+    size_t comm_raw_pos;
+    // ring mode, see SetCommunicationRawReceiveRing(). comm_raw_pos only grows then,
+    // the reader moves comm_raw_tail and bytes arriving while the ring is full are counted in comm_raw_dropped
+    bool comm_raw_ring;
+    size_t comm_raw_tail;
+    size_t comm_raw_dropped;
+
+    // Transmit buffer.
+    PacketCommandOLD txBuffer;
+    PacketCommandNGRaw txBufferNG;
+    size_t txBufferNGLen;
+    bool txBuffer_pending;
+    pthread_mutex_t txBufferMutex;
+    pthread_cond_t txBufferSig;
+
+    // Used by PacketResponseReceived as a ring buffer for messages that are yet to be
+    // processed by a command handler (WaitForResponse{,Timeout})
+    // Single producer (communication thread) / single consumer (command thread), lock free:
+    // only the producer moves cmd_head and only the consumer moves cmd_tail.
+    PacketResponseNG rxBuffer[CMD_BUFFER_SIZE];
+
+    // Points to the next empty position to write to
+    uint32_t cmd_head;
+
+    // Points to the position of the last unread command
+    uint32_t cmd_tail;
+
+    // only used to sleep on, a waiting side sets its flag before it checks the ring once more,
+    // the other side only takes the mutex when it sees the flag.
+    pthread_mutex_t rxBufferMutex;
+    pthread_cond_t rxBufferSig;
+    bool rx_reply_waiting;
+    bool rx_space_waiting;
+    // set while nobody reads the buffer, so a flood doesn't hold up the communication thread
+    bool rx_dropping;
+
+    // Start time for WaitForResponseTimeout & dl_it, so we can reset timeout when we get packets
+    // as sending lot of these packets can slow down things wuite a lot on slow links (e.g. hw status or lf read at 9600)
+    uint64_t timeout_start_time;
+
+    uint64_t last_packet_time;
+};
+
+static comm_ctx_t comm_primary = {
+    .conn = &g_conn,
+    .txBufferMutex = PTHREAD_MUTEX_INITIALIZER,
+    .txBufferSig = PTHREAD_COND_INITIALIZER,
+    .rxBufferMutex = PTHREAD_MUTEX_INITIALIZER,
+    .rxBufferSig = PTHREAD_COND_INITIALIZER,
+};
+
+// device the calling thread talks to, NULL means comm_primary.
+// Set by SetCommunicationDevice() and for its own communication thread
+static __thread comm_ctx_t *comm_bound = NULL;
+
+static comm_ctx_t *comm_get(void) {
+    return (comm_bound != NULL) ? comm_bound : &comm_primary;
+}
 
-// to lock rxBuffer operations from different threads
-static pthread_mutex_t rxBufferMutex = PTHREAD_MUTEX_INITIALIZER;
+// the primary device keeps following g_session, the others are present while open
+static bool comm_present(const comm_ctx_t *ctx) {
+    return (ctx == &comm_primary) ? g_session.pm3_present : ctx->conn->run;
+}
 
-// Global start time for WaitForResponseTimeout & dl_it, so we can reset timeout when we get packets
-// as sending lot of these packets can slow down things wuite a lot on slow links (e.g. hw status or lf read at 9600)
-static uint64_t timeout_start_time;
+// how long the communication thread waits for the command thread to make room
+#define RX_FULL_WAIT_MS  200
 
-static uint64_t last_packet_time;
+// downloads from device memory, see dl_it() and dl_window()
+#define DL_MAX_RETRIES         3
+#define DL_PROGRESS_MIN_BYTES  (64 * 1024)
+// one request of a windowed download, 64 crc chunks or 63 OLD frames, so windows never split a frame
+#define DL_WINDOW_BYTES        (64 * DL_CHUNK_DATA_SIZE)
+// requests queued on the device at once, the next window is asked for while the current one streams in
+#define DL_WINDOWS_IN_FLIGHT   2
 
 static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd);
+static bool dl_window(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd, uint32_t req_cmd, uint32_t start_index);
 
 // Simple alias to track usages linked to the Bootloader, these commands must not be migrated.
 // - commands sent to enter bootloader mode as we might have to talk to old firmwares
@@ -106,28 +162,32 @@ void SendCommandOLD(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, c
     print_hex_break((uint8_t *)&c.d, sizeof(c.d), 32);
 #endif
 
-    if (g_session.pm3_present == false) {
+    comm_ctx_t *ctx = comm_get();
+    if (comm_present(ctx) == false) {
         PrintAndLogEx(WARNING, "Sending bytes to Proxmark3 failed ( " _RED_("offline") " )");
         return;
     }
 
-    pthread_mutex_lock(&txBufferMutex);
+    pthread_mutex_lock(&ctx->txBufferMutex);
     /**
     This causes hangups at times, when the pm3 unit is unresponsive or disconnected. The main console thread is alive,
     but comm thread just spins here. Not good.../holiman
     **/
-    while (txBuffer_pending) {
+    while (ctx->txBuffer_pending) {
         // wait for communication thread to complete sending a previous command
-        pthread_cond_wait(&txBufferSig, &txBufferMutex);
+        pthread_cond_wait(&ctx->txBufferSig, &ctx->txBufferMutex);
     }
 
-    txBuffer = c;
-    txBuffer_pending = true;
+    ctx->txBuffer = c;
+    ctx->txBuffer_pending = true;
 
     // tell communication thread that a new command can be send
-    pthread_cond_signal(&txBufferSig);
+    pthread_cond_signal(&ctx->txBufferSig);
+    if (ctx->sp != NULL) {
+        uart_wakeup(ctx->sp);
+    }
 
-    pthread_mutex_unlock(&txBufferMutex);
+    pthread_mutex_unlock(&ctx->txBufferMutex);
 
 //__atomic_test_and_set(&txcmd_pending, __ATOMIC_SEQ_CST);
 }
@@ -137,7 +197,8 @@ static void SendCommandNG_internal(uint16_t cmd, uint8_t *data, size_t len, bool
     PrintAndLogEx(INFO, "Sending %s", ng ? "NG" : "MIX");
 #endif
 
-    if (!g_session.pm3_present) {
+    comm_ctx_t *ctx = comm_get();
+    if (comm_present(ctx) == false) {
         PrintAndLogEx(INFO, "Sending bytes to proxmark failed - offline");
         return;
     }
@@ -146,52 +207,55 @@ static void SendCommandNG_internal(uint16_t cmd, uint8_t *data, size_t len, bool
         return;
     }
 
-    PacketCommandNGPostamble *tx_post = (PacketCommandNGPostamble *)((uint8_t *)&txBufferNG + sizeof(PacketCommandNGPreamble) + len);
+    PacketCommandNGPostamble *tx_post = (PacketCommandNGPostamble *)((uint8_t *)&ctx->txBufferNG + sizeof(PacketCommandNGPreamble) + len);
 
-    pthread_mutex_lock(&txBufferMutex);
+    pthread_mutex_lock(&ctx->txBufferMutex);
     /**
     This causes hangups at times, when the pm3 unit is unresponsive or disconnected. The main console thread is alive,
     but comm thread just spins here. Not good.../holiman
     **/
-    while (txBuffer_pending) {
+    while (ctx->txBuffer_pending) {
         // wait for communication thread to complete sending a previous command
-        pthread_cond_wait(&txBufferSig, &txBufferMutex);
+        pthread_cond_wait(&ctx->txBufferSig, &ctx->txBufferMutex);
     }
 
-    txBufferNG.pre.magic = COMMANDNG_PREAMBLE_MAGIC;
-    txBufferNG.pre.ng = ng;
-    txBufferNG.pre.length = len;
-    txBufferNG.pre.cmd = cmd;
+    ctx->txBufferNG.pre.magic = COMMANDNG_PREAMBLE_MAGIC;
+    ctx->txBufferNG.pre.ng = ng;
+    ctx->txBufferNG.pre.length = len;
+    ctx->txBufferNG.pre.cmd = cmd;
     if (len > 0 && data) {
-        memcpy(&txBufferNG.data, data, len);
+        memcpy(&ctx->txBufferNG.data, data, len);
     }
 
-    if ((g_conn.send_via_fpc_usart && g_conn.send_with_crc_on_fpc) || ((!g_conn.send_via_fpc_usart) && g_conn.send_with_crc_on_usb)) {
+    if ((ctx->conn->send_via_fpc_usart && ctx->conn->send_with_crc_on_fpc) || ((!ctx->conn->send_via_fpc_usart) && ctx->conn->send_with_crc_on_usb)) {
         uint8_t first = 0, second = 0;
-        compute_crc(CRC_14443_A, (uint8_t *)&txBufferNG, sizeof(PacketCommandNGPreamble) + len, &first, &second);
+        compute_crc(CRC_14443_A, (uint8_t *)&ctx->txBufferNG, sizeof(PacketCommandNGPreamble) + len, &first, &second);
         tx_post->crc = (first << 8) + second;
     } else {
         tx_post->crc = COMMANDNG_POSTAMBLE_MAGIC;
     }
 
-    txBufferNGLen = sizeof(PacketCommandNGPreamble) + len + sizeof(PacketCommandNGPostamble);
+    ctx->txBufferNGLen = sizeof(PacketCommandNGPreamble) + len + sizeof(PacketCommandNGPostamble);
 
 #ifdef COMMS_DEBUG_RAW
-    print_hex_break((uint8_t *)&txBufferNG.pre, sizeof(PacketCommandNGPreamble), 32);
+    print_hex_break((uint8_t *)&ctx->txBufferNG.pre, sizeof(PacketCommandNGPreamble), 32);
     if (ng) {
-        print_hex_break((uint8_t *)&txBufferNG.data, len, 32);
+        print_hex_break((uint8_t *)&ctx->txBufferNG.data, len, 32);
     } else {
-        print_hex_break((uint8_t *)&txBufferNG.data, 3 * sizeof(uint64_t), 32);
-        print_hex_break((uint8_t *)&txBufferNG.data + 3 * sizeof(uint64_t), len - 3 * sizeof(uint64_t), 32);
+        print_hex_break((uint8_t *)&ctx->txBufferNG.data, 3 * sizeof(uint64_t), 32);
+        print_hex_break((uint8_t *)&ctx->txBufferNG.data + 3 * sizeof(uint64_t), len - 3 * sizeof(uint64_t), 32);
     }
     print_hex_break((uint8_t *)tx_post, sizeof(PacketCommandNGPostamble), 32);
 #endif
-    txBuffer_pending = true;
+    ctx->txBuffer_pending = true;
 
     // tell communication thread that a new command can be send
-    pthread_cond_signal(&txBufferSig);
+    pthread_cond_signal(&ctx->txBufferSig);
+    if (ctx->sp != NULL) {
+        uart_wakeup(ctx->sp);
+    }
 
-    pthread_mutex_unlock(&txBufferMutex);
+    pthread_mutex_unlock(&ctx->txBufferMutex);
 
 //__atomic_test_and_set(&txcmd_pending, __ATOMIC_SEQ_CST);
 }
@@ -213,6 +277,50 @@ void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, c
     SendCommandNG_internal(cmd, cmddata, len + sizeof(arg), false);
 }
 
+// absolute time ms from now, for pthread_cond_timedwait
+static void rx_deadline(struct timespec *ts, uint32_t ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+// sleep on rxBufferSig until `ready` says so or ms passed.
+// `flag` is the waiting side's flag, see rxBufferMutex
+static void rx_wait(comm_ctx_t *ctx, bool *flag, bool (*ready)(const comm_ctx_t *), uint32_t ms) {
+    struct timespec ts;
+    rx_deadline(&ts, ms);
+
+    pthread_mutex_lock(&ctx->rxBufferMutex);
+    __atomic_store_n(flag, true, __ATOMIC_SEQ_CST);
+    while (ready(ctx) == false) {
+        if (pthread_cond_timedwait(&ctx->rxBufferSig, &ctx->rxBufferMutex, &ts) != 0) {
+            break;
+        }
+    }
+    __atomic_store_n(flag, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&ctx->rxBufferMutex);
+}
+
+static void rx_wake(comm_ctx_t *ctx, const bool *flag) {
+    if (__atomic_load_n(flag, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&ctx->rxBufferMutex);
+        pthread_cond_broadcast(&ctx->rxBufferSig);
+        pthread_mutex_unlock(&ctx->rxBufferMutex);
+    }
+}
+
+static bool rx_has_reply(const comm_ctx_t *ctx) {
+    return __atomic_load_n(&ctx->cmd_head, __ATOMIC_SEQ_CST) != __atomic_load_n(&ctx->cmd_tail, __ATOMIC_SEQ_CST);
+}
+
+static bool rx_has_space(const comm_ctx_t *ctx) {
+    uint32_t head = __atomic_load_n(&ctx->cmd_head, __ATOMIC_SEQ_CST);
+    return (head + 1) % CMD_BUFFER_SIZE != __atomic_load_n(&ctx->cmd_tail, __ATOMIC_SEQ_CST);
+}
 
 /**
  * @brief This method should be called when sending a new command to the pm3. In case any old
@@ -221,30 +329,42 @@ void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, c
  *  operation. Right now we'll just have to live with this.
  */
 void clearCommandBuffer(void) {
+    comm_ctx_t *ctx = comm_get();
     //This is a very simple operation
-    pthread_mutex_lock(&rxBufferMutex);
-    cmd_tail = cmd_head;
-    pthread_mutex_unlock(&rxBufferMutex);
+    __atomic_store_n(&ctx->cmd_tail, __atomic_load_n(&ctx->cmd_head, __ATOMIC_ACQUIRE), __ATOMIC_SEQ_CST);
+    rx_wake(ctx, &ctx->rx_space_waiting);
 }
+
 /**
  * @brief storeCommand stores a USB command in a circular buffer
  * @param UC
  */
 static void storeReply(const PacketResponseNG *packet) {
-    pthread_mutex_lock(&rxBufferMutex);
-    if ((cmd_head + 1) % CMD_BUFFER_SIZE == cmd_tail) {
-        //If these two are equal, we're about to overwrite in the
-        // circular buffer.
-        PrintAndLogEx(FAILED, "WARNING: Command buffer about to overwrite command! This needs to be fixed!");
-        fflush(stdout);
+    comm_ctx_t *ctx = comm_get();
+
+    if (rx_has_space(ctx) == false) {
+        // give the command thread a moment to catch up with a burst
+        if (ctx->rx_dropping == false) {
+            rx_wait(ctx, &ctx->rx_space_waiting, rx_has_space, RX_FULL_WAIT_MS);
+        }
+
+        if (rx_has_space(ctx) == false) {
+            PrintAndLogEx(FAILED, "WARNING: Command buffer full, dropping reply " _YELLOW_("0x%04x"), packet->cmd);
+            fflush(stdout);
+            ctx->rx_dropping = true;
+            return;
+        }
     }
+    ctx->rx_dropping = false;
+
     //Store the command at the 'head' location
-    PacketResponseNG *destination = &rxBuffer[cmd_head];
-    memcpy(destination, packet, sizeof(PacketResponseNG));
+    uint32_t head = __atomic_load_n(&ctx->cmd_head, __ATOMIC_RELAXED);
+    memcpy(&ctx->rxBuffer[head], packet, sizeof(PacketResponseNG));
 
-    //increment head and wrap
-    cmd_head = (cmd_head + 1) % CMD_BUFFER_SIZE;
-    pthread_mutex_unlock(&rxBufferMutex);
+    //increment head and wrap, publishes the stored command
+    __atomic_store_n(&ctx->cmd_head, (head + 1) % CMD_BUFFER_SIZE, __ATOMIC_SEQ_CST);
+
+    rx_wake(ctx, &ctx->rx_reply_waiting);
 }
 /**
  * @brief getCommand gets a command from an internal circular buffer.
@@ -252,34 +372,44 @@ static void storeReply(const PacketResponseNG *packet) {
  * @return 1 if response was returned, 0 if nothing has been received
  */
 static int getReply(PacketResponseNG *packet) {
-    pthread_mutex_lock(&rxBufferMutex);
+    comm_ctx_t *ctx = comm_get();
+
     //If head == tail, there's nothing to read, or if we just got initialized
-    if (cmd_head == cmd_tail)  {
-        pthread_mutex_unlock(&rxBufferMutex);
+    uint32_t tail = __atomic_load_n(&ctx->cmd_tail, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&ctx->cmd_head, __ATOMIC_ACQUIRE) == tail)  {
         return 0;
     }
 
     //Pick out the next unread command
-    memcpy(packet, &rxBuffer[cmd_tail], sizeof(PacketResponseNG));
+    memcpy(packet, &ctx->rxBuffer[tail], sizeof(PacketResponseNG));
 
     //Increment tail - this is a circular buffer, so modulo buffer size
-    cmd_tail = (cmd_tail + 1) % CMD_BUFFER_SIZE;
+    __atomic_store_n(&ctx->cmd_tail, (tail + 1) % CMD_BUFFER_SIZE, __ATOMIC_SEQ_CST);
 
-    pthread_mutex_unlock(&rxBufferMutex);
+    rx_wake(ctx, &ctx->rx_space_waiting);
     return 1;
 }
 
+// Wait for the next reply, at most ms.  Woken by storeReply as soon as a reply arrives
+static void waitReply(uint32_t ms) {
+    comm_ctx_t *ctx = comm_get();
+    if (rx_has_reply(ctx) == false) {
+        rx_wait(ctx, &ctx->rx_reply_waiting, rx_has_reply, ms);
+    }
+}
+
 //-----------------------------------------------------------------------------
 // Entry point into our code: called whenever we received a packet over USB
 // that we weren't necessarily expecting, for example a debug print.
 //-----------------------------------------------------------------------------
 static void PacketResponseReceived(PacketResponseNG *packet) {
+    comm_ctx_t *ctx = comm_get();
 
     // we got a packet, reset WaitForResponseTimeout timeout
-    uint64_t prev_clk = __atomic_load_n(&last_packet_time, __ATOMIC_SEQ_CST);
+    uint64_t prev_clk = __atomic_load_n(&ctx->last_packet_time, __ATOMIC_SEQ_CST);
     uint64_t clk = msclock();
-    __atomic_store_n(&timeout_start_time,  clk, __ATOMIC_SEQ_CST);
-    __atomic_store_n(&last_packet_time, clk, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->timeout_start_time,  clk, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->last_packet_time, clk, __ATOMIC_SEQ_CST);
     (void) prev_clk;
 //    PrintAndLogEx(NORMAL, "[%07"PRIu64"] RECV %s magic %08x length %04x status %04x crc %04x cmd %04x",
 //                clk - prev_clk, packet->ng ? "NG" : "OLD", packet->magic, packet->length, packet->status, packet->crc, packet->cmd);
@@ -407,7 +537,10 @@ __attribute__((force_align_arg_pointer))
 #endif
 #endif
 *uart_communication(void *targ) {
-    const communication_arg_t *connection = (communication_arg_t *)targ;
+    comm_ctx_t *ctx = (comm_ctx_t *)targ;
+    const communication_arg_t *connection = ctx->conn;
+    // replies stored from this thread go to our device
+    comm_bound = ctx;
     uint32_t rxlen;
     bool commfailed = false;
     PacketResponseNG rx;
@@ -429,30 +562,40 @@ __attribute__((force_align_arg_pointer))
         // Signal to main thread that communications seems off.
         // main thread will kill and restart this thread.
         if (commfailed) {
-            if (g_conn.last_command != CMD_HARDWARE_RESET &&
-                    g_conn.last_command != CMD_START_FLASH) {
+            if (ctx->conn->last_command != CMD_HARDWARE_RESET &&
+                    ctx->conn->last_command != CMD_START_FLASH) {
                 PrintAndLogEx(WARNING, "\nCommunicating with Proxmark3 device " _RED_("failed"));
             }
-            __atomic_test_and_set(&comm_thread_dead, __ATOMIC_SEQ_CST);
+            __atomic_test_and_set(&ctx->comm_thread_dead, __ATOMIC_SEQ_CST);
+            // don't let a waiting command sleep out its timeout
+            rx_wake(ctx, &ctx->rx_reply_waiting);
             break;
         }
 
-        bool is_receiving_raw = __atomic_load_n(&comm_raw_mode, __ATOMIC_SEQ_CST);
+        bool is_receiving_raw = __atomic_load_n(&ctx->comm_raw_mode, __ATOMIC_SEQ_CST);
 
         if (is_receiving_raw) {
-            uint8_t *bufferData = __atomic_load_n(&comm_raw_data, __ATOMIC_SEQ_CST); // read only
-            size_t bufferLen = __atomic_load_n(&comm_raw_len, __ATOMIC_SEQ_CST); // read only
-            size_t bufferPos = __atomic_load_n(&comm_raw_pos, __ATOMIC_SEQ_CST); // read and write
-            if (bufferPos < bufferLen) {
-                size_t rxMaxLen = bufferLen - bufferPos;
+            uint8_t *bufferData = __atomic_load_n(&ctx->comm_raw_data, __ATOMIC_SEQ_CST); // read only
+            size_t bufferLen = __atomic_load_n(&ctx->comm_raw_len, __ATOMIC_SEQ_CST); // read only
+            size_t bufferPos = __atomic_load_n(&ctx->comm_raw_pos, __ATOMIC_SEQ_CST); // read and write
+            size_t bufferOff = bufferPos;
+            size_t rxMaxLen = (bufferPos < bufferLen) ? bufferLen - bufferPos : 0;
+            bool is_ring = __atomic_load_n(&ctx->comm_raw_ring, __ATOMIC_SEQ_CST);
+            if (is_ring) {
+                // free space up to the reader, but not across the end of the buffer
+                bufferOff = bufferPos % bufferLen;
+                rxMaxLen = bufferLen - (bufferPos - __atomic_load_n(&ctx->comm_raw_tail, __ATOMIC_SEQ_CST));
+                rxMaxLen = MIN(rxMaxLen, bufferLen - bufferOff);
+            }
+            if (rxMaxLen > 0) {
 
                 rxMaxLen = MIN(COMM_RAW_RECEIVE_LEN, rxMaxLen);
 
-                res = uart_receive(sp, bufferData + bufferPos, rxMaxLen, &rxlen);
+                res = uart_receive(ctx->sp, bufferData + bufferOff, rxMaxLen, &rxlen);
                 if (res == PM3_SUCCESS) {
                     uint64_t clk = msclock();
-                    __atomic_store_n(&timeout_start_time,  clk, __ATOMIC_SEQ_CST);
-                    __atomic_store_n(&comm_raw_pos, bufferPos + rxlen, __ATOMIC_SEQ_CST);
+                    __atomic_store_n(&ctx->timeout_start_time,  clk, __ATOMIC_SEQ_CST);
+                    __atomic_store_n(&ctx->comm_raw_pos, bufferPos + rxlen, __ATOMIC_SEQ_CST);
                 } else if (res != PM3_ENODATA) {
                     PrintAndLogEx(WARNING, "Error when reading raw data: %zu/%zu, %d", bufferPos, bufferLen, res);
                     error = true;
@@ -463,8 +606,11 @@ __attribute__((force_align_arg_pointer))
             } else {
                 // Ignore data when bufferPos >= bufferLen and is_receiving_raw has not been set to false
                 uint8_t dummyData[64];
-                uint32_t dummyLen;
-                uart_receive(sp, dummyData, sizeof(dummyData), &dummyLen);
+                uint32_t dummyLen = 0;
+                uart_receive(ctx->sp, dummyData, sizeof(dummyData), &dummyLen);
+                if (is_ring) {
+                    __atomic_add_fetch(&ctx->comm_raw_dropped, dummyLen, __ATOMIC_SEQ_CST);
+                }
             }
         } else {
             if (is_receiving_raw_last) {
@@ -472,9 +618,14 @@ __attribute__((force_align_arg_pointer))
 
                 // Set the buffer as undefined
                 // comm_raw_data == NULL is used in SetCommunicationReceiveMode()
-                __atomic_store_n(&comm_raw_data, NULL, __ATOMIC_SEQ_CST);
+                __atomic_store_n(&ctx->comm_raw_data, NULL, __ATOMIC_SEQ_CST);
+            }
+            // sleep until the device sends something, or a command is waiting to be sent
+            rxlen = 0;
+            res = uart_wait(ctx->sp);
+            if (res == PM3_SUCCESS) {
+                res = uart_receive(ctx->sp, (uint8_t *)&rx_raw.pre, sizeof(PacketResponseNGPreamble), &rxlen);
             }
-            res = uart_receive(sp, (uint8_t *)&rx_raw.pre, sizeof(PacketResponseNGPreamble), &rxlen);
 
             if ((res == PM3_SUCCESS) && (rxlen == sizeof(PacketResponseNGPreamble))) {
 
@@ -494,7 +645,7 @@ __attribute__((force_align_arg_pointer))
 
                     if ((!error) && (length > 0)) { // Get the variable length payload
 
-                        res = uart_receive(sp, (uint8_t *)&rx_raw.data, length, &rxlen);
+                        res = uart_receive(ctx->sp, (uint8_t *)&rx_raw.data, length, &rxlen);
 
                         if ((res != PM3_SUCCESS) || (rxlen != length)) {
 
@@ -507,7 +658,7 @@ __attribute__((force_align_arg_pointer))
 
                                 memcpy(&rx.data, &rx_raw.data, length);
                                 rx.length = length;
-                                if ((rx.cmd == g_conn.last_command) && (rx.status == PM3_SUCCESS)) {
+                                if ((rx.cmd == ctx->conn->last_command) && (rx.status == PM3_SUCCESS)) {
                                     ACK_received = true;
                                 }
 
@@ -545,7 +696,7 @@ __attribute__((force_align_arg_pointer))
                     }
 
                     if (!error) {                        // Get the postamble
-                        res = uart_receive(sp, (uint8_t *)&rx_raw.foopost, sizeof(PacketResponseNGPostamble), &rxlen);
+                        res = uart_receive(ctx->sp, (uint8_t *)&rx_raw.foopost, sizeof(PacketResponseNGPostamble), &rxlen);
                         if ((res != PM3_SUCCESS) || (rxlen != sizeof(PacketResponseNGPostamble))) {
                             PrintAndLogEx(WARNING, "Received packet frame without postamble");
                             error = true;
@@ -581,7 +732,7 @@ __attribute__((force_align_arg_pointer))
                     PacketResponseOLD rx_old;
                     memcpy(&rx_old, &rx_raw.pre, sizeof(PacketResponseNGPreamble));
 
-                    res = uart_receive(sp, ((uint8_t *)&rx_old) + sizeof(PacketResponseNGPreamble), sizeof(PacketResponseOLD) - sizeof(PacketResponseNGPreamble), &rxlen);
+                    res = uart_receive(ctx->sp, ((uint8_t *)&rx_old) + sizeof(PacketResponseNGPreamble), sizeof(PacketResponseOLD) - sizeof(PacketResponseNGPreamble), &rxlen);
                     if ((res != PM3_SUCCESS) || (rxlen != sizeof(PacketResponseOLD) - sizeof(PacketResponseNGPreamble))) {
                         PrintAndLogEx(WARNING, "Received packet OLD frame with payload too short? %d/%zu", rxlen, sizeof(PacketResponseOLD) - sizeof(PacketResponseNGPreamble));
                         error = true;
@@ -625,7 +776,7 @@ __attribute__((force_align_arg_pointer))
         is_receiving_raw_last = is_receiving_raw;
         // TODO if error, shall we resync ?
 
-        pthread_mutex_lock(&txBufferMutex);
+        pthread_mutex_lock(&ctx->txBufferMutex);
 
         if (connection->block_after_ACK) {
             // if we just received an ACK, wait here until a new command is to be transmitted
@@ -634,43 +785,46 @@ __attribute__((force_align_arg_pointer))
 #ifdef COMMS_DEBUG
                 PrintAndLogEx(NORMAL, "Received ACK, fast TX mode: ignoring other RX till TX");
 #endif
-                while (!txBuffer_pending) {
-                    pthread_cond_wait(&txBufferSig, &txBufferMutex);
+                while (!ctx->txBuffer_pending) {
+                    pthread_cond_wait(&ctx->txBufferSig, &ctx->txBufferMutex);
                 }
             }
         }
 
-        if (txBuffer_pending) {
+        if (ctx->txBuffer_pending) {
 
-            if (txBufferNGLen) { // NG packet
-                res = uart_send(sp, (uint8_t *) &txBufferNG, txBufferNGLen);
+            if (ctx->txBufferNGLen) { // NG packet
+                res = uart_send(ctx->sp, (uint8_t *) &ctx->txBufferNG, ctx->txBufferNGLen);
                 if (res == PM3_EIO) {
                     commfailed = true;
                 }
-                g_conn.last_command = txBufferNG.pre.cmd;
-                txBufferNGLen = 0;
+                ctx->conn->last_command = ctx->txBufferNG.pre.cmd;
+                ctx->txBufferNGLen = 0;
             } else {
-                res = uart_send(sp, (uint8_t *) &txBuffer, sizeof(PacketCommandOLD));
+                res = uart_send(ctx->sp, (uint8_t *) &ctx->txBuffer, sizeof(PacketCommandOLD));
                 if (res == PM3_EIO) {
                     commfailed = true;
                 }
-                g_conn.last_command = txBuffer.cmd;
+                ctx->conn->last_command = ctx->txBuffer.cmd;
             }
 
-            txBuffer_pending = false;
+            ctx->txBuffer_pending = false;
 
             // main thread doesn't know send failed...
 
             // tell main thread that txBuffer is empty
-            pthread_cond_signal(&txBufferSig);
+            pthread_cond_signal(&ctx->txBufferSig);
         }
 
-        pthread_mutex_unlock(&txBufferMutex);
+        pthread_mutex_unlock(&ctx->txBufferMutex);
     }
 
     // when thread dies, we close the serial port.
-    uart_close(sp);
-    sp = NULL;
+    // under txBufferMutex, senders wake us up through sp
+    pthread_mutex_lock(&ctx->txBufferMutex);
+    uart_close(ctx->sp);
+    ctx->sp = NULL;
+    pthread_mutex_unlock(&ctx->txBufferMutex);
 
 #if defined(__MACH__) && defined(__APPLE__)
     enableAppNap();
@@ -681,7 +835,8 @@ __attribute__((force_align_arg_pointer))
 }
 
 bool IsCommunicationThreadDead(void) {
-    bool ret = __atomic_load_n(&comm_thread_dead, __ATOMIC_SEQ_CST);
+    const comm_ctx_t *ctx = comm_get();
+    bool ret = __atomic_load_n(&ctx->comm_thread_dead, __ATOMIC_SEQ_CST);
     return ret;
 }
 
@@ -703,130 +858,156 @@ bool IsCommunicationThreadDead(void) {
 // 3. Normally you only need WaitForRawDataTimeout() rather than the
 // low level functions like SetCommunicationReceiveMode(),
 // SetCommunicationRawReceiveBuffer() and GetCommunicationRawReceiveNum()
+// 4. For a stream of unknown length use SetCommunicationRawReceiveRing()
+// instead of SetCommunicationRawReceiveBuffer() and read it with ReadRawDataRing()
 
 bool SetCommunicationReceiveMode(bool isRawMode) {
+    comm_ctx_t *ctx = comm_get();
     if (isRawMode) {
-        const uint8_t *buffer = __atomic_load_n(&comm_raw_data, __ATOMIC_SEQ_CST);
+        const uint8_t *buffer = __atomic_load_n(&ctx->comm_raw_data, __ATOMIC_SEQ_CST);
         if (buffer == NULL) {
             PrintAndLogEx(ERR, "Buffer for raw data is not set");
             return false;
         }
     }
-    __atomic_store_n(&comm_raw_mode, isRawMode, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->comm_raw_mode, isRawMode, __ATOMIC_SEQ_CST);
     return true;
 }
 
 void SetCommunicationRawReceiveBuffer(uint8_t *buffer, size_t len) {
-    __atomic_store_n(&comm_raw_data,  buffer, __ATOMIC_SEQ_CST);
-    __atomic_store_n(&comm_raw_len,  len, __ATOMIC_SEQ_CST);
-    __atomic_store_n(&comm_raw_pos,  0, __ATOMIC_SEQ_CST);
+    comm_ctx_t *ctx = comm_get();
+    __atomic_store_n(&ctx->comm_raw_ring, false, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->comm_raw_data,  buffer, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->comm_raw_len,  len, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->comm_raw_pos,  0, __ATOMIC_SEQ_CST);
+}
+
+// Same as SetCommunicationRawReceiveBuffer() but the buffer is used as a ring,
+// single producer (communication thread) / single consumer (ReadRawDataRing()), lock free.
+// Memory stays bounded however long the stream runs, data arriving while the ring is full is dropped.
+void SetCommunicationRawReceiveRing(uint8_t *buffer, size_t len) {
+    comm_ctx_t *ctx = comm_get();
+    __atomic_store_n(&ctx->comm_raw_tail, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->comm_raw_dropped, 0, __ATOMIC_SEQ_CST);
+    SetCommunicationRawReceiveBuffer(buffer, len);
+    __atomic_store_n(&ctx->comm_raw_ring, true, __ATOMIC_SEQ_CST);
 }
 
 size_t GetCommunicationRawReceiveNum(void) {
-    return __atomic_load_n(&comm_raw_pos, __ATOMIC_SEQ_CST);
+    const comm_ctx_t *ctx = comm_get();
+    return __atomic_load_n(&ctx->comm_raw_pos, __ATOMIC_SEQ_CST);
 }
 
 bool OpenProxmarkSilent(pm3_device_t **dev, const char *port, uint32_t speed) {
 
-    sp = uart_open(port, speed, true);
+    comm_ctx_t *ctx = comm_get();
+    ctx->sp = uart_open(port, speed, true);
 
     // check result of uart opening
-    if (sp == INVALID_SERIAL_PORT) {
-        sp = NULL;
+    if (ctx->sp == INVALID_SERIAL_PORT) {
+        ctx->sp = NULL;
         return false;
-    } else if (sp == CLAIMED_SERIAL_PORT) {
-        sp = NULL;
+    } else if (ctx->sp == CLAIMED_SERIAL_PORT) {
+        ctx->sp = NULL;
         return false;
     } else {
         // start the communication thread
-        if (port != g_conn.serial_port_name) {
+        if (port != ctx->conn->serial_port_name) {
             uint16_t len = MIN(strlen(port), FILE_PATH_SIZE - 1);
-            memset(g_conn.serial_port_name, 0, FILE_PATH_SIZE);
-            memcpy(g_conn.serial_port_name, port, len);
+            memset(ctx->conn->serial_port_name, 0, FILE_PATH_SIZE);
+            memcpy(ctx->conn->serial_port_name, port, len);
         }
-        g_conn.run = true;
-        g_conn.block_after_ACK = false;
+        ctx->conn->run = true;
+        ctx->conn->block_after_ACK = false;
         // Flags to tell where to add CRC on sent replies
-        g_conn.send_with_crc_on_usb = false;
-        g_conn.send_with_crc_on_fpc = true;
+        ctx->conn->send_with_crc_on_usb = false;
+        ctx->conn->send_with_crc_on_fpc = true;
         // "Session" flag, to tell via which interface next msgs should be sent: USB or FPC USART
-        g_conn.send_via_fpc_usart = false;
+        ctx->conn->send_via_fpc_usart = false;
 
-        pthread_create(&communication_thread, NULL, &uart_communication, &g_conn);
-        __atomic_clear(&comm_thread_dead, __ATOMIC_SEQ_CST);
+        pthread_create(&ctx->communication_thread, NULL, &uart_communication, ctx);
+        __atomic_clear(&ctx->comm_thread_dead, __ATOMIC_SEQ_CST);
         __atomic_clear(&reconnect_ok, __ATOMIC_SEQ_CST);
 
-        g_session.pm3_present = true; // TODO support for multiple devices
+        if (ctx == &comm_primary) {
+            g_session.pm3_present = true;
+        }
 
         fflush(stdout);
         if (*dev == NULL) {
             *dev = calloc(sizeof(pm3_device_t), sizeof(uint8_t));
         }
-        (*dev)->g_conn = &g_conn; // TODO g_conn shouldn't be global
+        (*dev)->ctx = ctx;
+        (*dev)->g_conn = ctx->conn;
         return true;
     }
 }
 
+// Opens the port for the device the calling thread is bound to, see SetCommunicationDevice()
 bool OpenProxmark(pm3_device_t **dev, const char *port, bool wait_for_port, int timeout, bool flash_mode, uint32_t speed) {
 
+    comm_ctx_t *ctx = comm_get();
     if (wait_for_port == false) {
         PrintAndLogEx(SUCCESS, "Using UART port " _GREEN_("%s"), port);
-        sp = uart_open(port, speed, false);
+        ctx->sp = uart_open(port, speed, false);
     } else {
         PrintAndLogEx(SUCCESS, "Waiting for Proxmark3 to appear on " _YELLOW_("%s"), port);
         fflush(stdout);
         int openCount = 0;
         PrintAndLogEx(INPLACE, "% 3i", timeout);
         do {
-            sp = uart_open(port, speed, false);
+            ctx->sp = uart_open(port, speed, false);
             msleep(500);
             PrintAndLogEx(INPLACE, "% 3i", timeout - openCount - 1);
 
-        } while (++openCount < timeout && (sp == INVALID_SERIAL_PORT || sp == CLAIMED_SERIAL_PORT));
+        } while (++openCount < timeout && (ctx->sp == INVALID_SERIAL_PORT || ctx->sp == CLAIMED_SERIAL_PORT));
     }
 
     // check result of uart opening
-    if (sp == INVALID_SERIAL_PORT) {
+    if (ctx->sp == INVALID_SERIAL_PORT) {
         PrintAndLogEx(WARNING, "\n" _RED_("ERROR:") " invalid serial port " _YELLOW_("%s"), port);
         PrintAndLogEx(HINT, "Try the shell script " _YELLOW_("`./pm3 --list`") " to get a list of possible serial ports");
-        sp = NULL;
+        ctx->sp = NULL;
         return false;
-    } else if (sp == CLAIMED_SERIAL_PORT) {
+    } else if (ctx->sp == CLAIMED_SERIAL_PORT) {
         PrintAndLogEx(WARNING, "\n" _RED_("ERROR:") " serial port " _YELLOW_("%s") " is claimed by another process", port);
         PrintAndLogEx(HINT, "Try the shell script " _YELLOW_("`./pm3 --list`") " to get a list of possible serial ports");
 
-        sp = NULL;
+        ctx->sp = NULL;
         return false;
     } else {
         // start the communication thread
-        if (port != g_conn.serial_port_name) {
+        if (port != ctx->conn->serial_port_name) {
             uint16_t len = MIN(strlen(port), FILE_PATH_SIZE - 1);
-            memset(g_conn.serial_port_name, 0, FILE_PATH_SIZE);
-            memcpy(g_conn.serial_port_name, port, len);
+            memset(ctx->conn->serial_port_name, 0, FILE_PATH_SIZE);
+            memcpy(ctx->conn->serial_port_name, port, len);
         }
-        g_conn.run = true;
-        g_conn.block_after_ACK = flash_mode;
+        ctx->conn->run = true;
+        ctx->conn->block_after_ACK = flash_mode;
         // Flags to tell where to add CRC on sent replies
-        g_conn.send_with_crc_on_usb = false;
-        g_conn.send_with_crc_on_fpc = true;
+        ctx->conn->send_with_crc_on_usb = false;
+        ctx->conn->send_with_crc_on_fpc = true;
         // "Session" flag, to tell via which interface next msgs should be sent: USB or FPC USART
-        g_conn.send_via_fpc_usart = false;
+        ctx->conn->send_via_fpc_usart = false;
 
-        pthread_create(&communication_thread, NULL, &uart_communication, &g_conn);
-        __atomic_clear(&comm_thread_dead, __ATOMIC_SEQ_CST);
-        g_session.pm3_present = true; // TODO support for multiple devices
+        pthread_create(&ctx->communication_thread, NULL, &uart_communication, ctx);
+        __atomic_clear(&ctx->comm_thread_dead, __ATOMIC_SEQ_CST);
+        if (ctx == &comm_primary) {
+            g_session.pm3_present = true;
+        }
 
         fflush(stdout);
         if (*dev == NULL) {
             *dev = calloc(sizeof(pm3_device_t), sizeof(uint8_t));
         }
-        (*dev)->g_conn = &g_conn; // TODO g_conn shouldn't be global
+        (*dev)->ctx = ctx;
+        (*dev)->g_conn = ctx->conn;
         return true;
     }
 }
 
 // check if we can communicate with Pm3
-int TestProxmark(pm3_device_t *dev) {
+static int test_proxmark(comm_ctx_t *ctx) {
 
     uint16_t len = 32;
     uint8_t data[len];
@@ -834,7 +1015,7 @@ int TestProxmark(pm3_device_t *dev) {
         data[i] = i & 0xFF;
     }
 
-    __atomic_store_n(&last_packet_time,  msclock(), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->last_packet_time,  msclock(), __ATOMIC_SEQ_CST);
     clearCommandBuffer();
     SendCommandNG(CMD_PING, data, len);
 
@@ -870,31 +1051,36 @@ int TestProxmark(pm3_device_t *dev) {
         return PM3_EDEVNOTSUPP;
     }
 
-    memcpy(&g_pm3_capabilities, resp.data.asBytes, sizeof(capabilities_t));
-    g_conn.send_via_fpc_usart = g_pm3_capabilities.via_fpc;
-    g_conn.uart_speed = g_pm3_capabilities.baudrate;
+    capabilities_t caps;
+    memcpy(&caps, resp.data.asBytes, sizeof(capabilities_t));
+    // additional devices must run the same firmware, commands only look at the primary ones capabilities
+    if (ctx == &comm_primary) {
+        memcpy(&g_pm3_capabilities, &caps, sizeof(capabilities_t));
+    }
+    ctx->conn->send_via_fpc_usart = caps.via_fpc;
+    ctx->conn->uart_speed = caps.baudrate;
 
-    bool is_tcp_conn = (g_conn.send_via_ip == PM3_TCPv4 || g_conn.send_via_ip == PM3_TCPv6);
-    bool is_bt_conn = (memcmp(g_conn.serial_port_name, "bt:", 3) == 0);
-    bool is_udp_conn = (g_conn.send_via_ip == PM3_UDPv4 || g_conn.send_via_ip == PM3_UDPv6);
+    bool is_tcp_conn = (ctx->conn->send_via_ip == PM3_TCPv4 || ctx->conn->send_via_ip == PM3_TCPv6);
+    bool is_bt_conn = (memcmp(ctx->conn->serial_port_name, "bt:", 3) == 0);
+    bool is_udp_conn = (ctx->conn->send_via_ip == PM3_UDPv4 || ctx->conn->send_via_ip == PM3_UDPv6);
 
     PrintAndLogEx(SUCCESS, "Communicating with PM3 over %s%s%s%s",
-                  (g_conn.send_via_fpc_usart) ? _GREEN_("FPC UART") : _GREEN_("USB-CDC"),
+                  (ctx->conn->send_via_fpc_usart) ? _GREEN_("FPC UART") : _GREEN_("USB-CDC"),
                   (is_tcp_conn) ? " over " _GREEN_("TCP") : "",
                   (is_bt_conn) ? " over " _GREEN_("BT") : "",
                   (is_udp_conn) ? " over " _GREEN_("UDP") : ""
                  );
-    if (g_conn.send_via_fpc_usart) {
-        PrintAndLogEx(SUCCESS, "PM3 UART serial baudrate: " _GREEN_("%u") "\n", g_conn.uart_speed);
+    if (ctx->conn->send_via_fpc_usart) {
+        PrintAndLogEx(SUCCESS, "PM3 UART serial baudrate: " _GREEN_("%u") "\n", ctx->conn->uart_speed);
     } else {
         int res;
-        if (g_conn.send_via_local_ip) {
-            // (g_conn.send_via_local_ip == true) -> ((is_tcp_conn || is_udp_conn) == true)
-            res = uart_reconfigure_timeouts(is_tcp_conn ? UART_TCP_LOCAL_CLIENT_RX_TIMEOUT_MS : UART_UDP_LOCAL_CLIENT_RX_TIMEOUT_MS);
+        if (ctx->conn->send_via_local_ip) {
+            // (ctx->conn->send_via_local_ip == true) -> ((is_tcp_conn || is_udp_conn) == true)
+            res = uart_reconfigure_timeouts(ctx->sp, is_tcp_conn ? UART_TCP_LOCAL_CLIENT_RX_TIMEOUT_MS : UART_UDP_LOCAL_CLIENT_RX_TIMEOUT_MS);
         } else if (is_tcp_conn || is_udp_conn) {
-            res = uart_reconfigure_timeouts(UART_NET_CLIENT_RX_TIMEOUT_MS);
+            res = uart_reconfigure_timeouts(ctx->sp, UART_NET_CLIENT_RX_TIMEOUT_MS);
         } else {
-            res = uart_reconfigure_timeouts(UART_USB_CLIENT_RX_TIMEOUT_MS);
+            res = uart_reconfigure_timeouts(ctx->sp, UART_USB_CLIENT_RX_TIMEOUT_MS);
         }
         if (res != PM3_SUCCESS) {
             return res;
@@ -903,32 +1089,106 @@ int TestProxmark(pm3_device_t *dev) {
     return PM3_SUCCESS;
 }
 
+int TestProxmark(pm3_device_t *dev) {
+    comm_ctx_t *prev = comm_bound;
+    comm_bound = dev->ctx;
+    int res = test_proxmark(dev->ctx);
+    comm_bound = prev;
+    return res;
+}
+
 void CloseProxmark(pm3_device_t *dev) {
-    dev->g_conn->run = false;
+    comm_ctx_t *ctx = dev->ctx;
+    ctx->conn->run = false;
 
 #ifdef __BIONIC__
-    if (communication_thread != 0) {
-        pthread_join(communication_thread, NULL);
+    if (ctx->communication_thread != 0) {
+        pthread_join(ctx->communication_thread, NULL);
     }
 #else
-    pthread_join(communication_thread, NULL);
+    pthread_join(ctx->communication_thread, NULL);
 #endif
 
-    if (sp) {
-        uart_close(sp);
+    if (ctx->sp) {
+        uart_close(ctx->sp);
     }
 
     // Clean up our state
-    sp = NULL;
+    ctx->sp = NULL;
 #ifdef __BIONIC__
-    if (communication_thread != 0) {
-        memset(&communication_thread, 0, sizeof(pthread_t));
+    if (ctx->communication_thread != 0) {
+        memset(&ctx->communication_thread, 0, sizeof(pthread_t));
     }
 #else
-    memset(&communication_thread, 0, sizeof(pthread_t));
+    memset(&ctx->communication_thread, 0, sizeof(pthread_t));
 #endif
 
-    g_session.pm3_present = false;
+    if (ctx == &comm_primary) {
+        g_session.pm3_present = false;
+    }
+}
+
+// An additional device with its own connection, for libpm3 users driving several Proxmark3 at once.
+// Bind a thread to it with SetCommunicationDevice() before opening it or sending commands.
+pm3_device_t *NewProxmarkDevice(void) {
+    pm3_device_t *dev = calloc(1, sizeof(pm3_device_t));
+    comm_ctx_t *ctx = calloc(1, sizeof(comm_ctx_t));
+    graph_buffers_t *graph = graph_buffers_new();
+    if (dev == NULL || ctx == NULL || graph == NULL) {
+        free(dev);
+        free(ctx);
+        graph_buffers_free(graph);
+        return NULL;
+    }
+    ctx->conn = &ctx->own_conn;
+    pthread_mutex_init(&ctx->txBufferMutex, NULL);
+    pthread_cond_init(&ctx->txBufferSig, NULL);
+    pthread_mutex_init(&ctx->rxBufferMutex, NULL);
+    pthread_cond_init(&ctx->rxBufferSig, NULL);
+    dev->ctx = ctx;
+    dev->g_conn = ctx->conn;
+    dev->graph = graph;
+    return dev;
+}
+
+// device must be closed
+void FreeProxmarkDevice(pm3_device_t *dev) {
+    if (dev == NULL) {
+        return;
+    }
+    comm_ctx_t *ctx = dev->ctx;
+    if (ctx != NULL && ctx != &comm_primary) {
+        pthread_mutex_destroy(&ctx->txBufferMutex);
+        pthread_cond_destroy(&ctx->txBufferSig);
+        pthread_mutex_destroy(&ctx->rxBufferMutex);
+        pthread_cond_destroy(&ctx->rxBufferSig);
+        free(ctx);
+    }
+    graph_buffers_free(dev->graph);
+    free(dev->grabbed_output.ptr);
+    free(dev->grabbed_records.ptr);
+    free(dev);
+}
+
+// Commands sent from the calling thread go to dev and work on its sample buffers,
+// NULL goes back to the primary device
+void SetCommunicationDevice(pm3_device_t *dev) {
+    comm_bound = (dev != NULL && dev->ctx != &comm_primary) ? dev->ctx : NULL;
+    graph_bind((dev != NULL) ? dev->graph : NULL);
+}
+
+// connection of the device the calling thread is bound to
+communication_arg_t *GetCommunicationConn(void) {
+    return comm_get()->conn;
+}
+
+// client side timeout (ms) of the port the calling thread is bound to
+int SetCommunicationTimeout(uint32_t ms) {
+    return uart_reconfigure_timeouts(comm_get()->sp, ms);
+}
+
+uint32_t GetCommunicationTimeout(void) {
+    return uart_get_timeouts(comm_get()->sp);
 }
 
 // Gives a rough estimate of the communication delay based on channel & baudrate
@@ -941,9 +1201,10 @@ void CloseProxmark(pm3_device_t *dev) {
 //           ~ = 12000000 / USART_BAUD_RATE
 // Let's take 2x (maybe we need more for BT link?)
 static size_t communication_delay(void) {
+    const comm_ctx_t *ctx = comm_get();
     // needed also for Windows USB USART??
-    if (g_conn.send_via_fpc_usart) {
-        return 2 * (12000000 / g_conn.uart_speed);
+    if (ctx->conn->send_via_fpc_usart) {
+        return 2 * (12000000 / ctx->conn->uart_speed);
     }
     return 0;
 }
@@ -959,6 +1220,7 @@ static size_t communication_delay(void) {
  * @return the number of received bytes
  */
 size_t WaitForRawDataTimeout(uint8_t *buffer, size_t len, size_t ms_timeout, bool show_process) {
+    comm_ctx_t *ctx = comm_get();
     uint8_t print_counter = 0;
     size_t last_pos = 0;
 
@@ -966,7 +1228,7 @@ size_t WaitForRawDataTimeout(uint8_t *buffer, size_t len, size_t ms_timeout, boo
     if (ms_timeout != (size_t) - 1) {
         ms_timeout += communication_delay();
     }
-    __atomic_store_n(&timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
 
     SetCommunicationRawReceiveBuffer(buffer, len);
     SetCommunicationReceiveMode(true);
@@ -986,11 +1248,11 @@ size_t WaitForRawDataTimeout(uint8_t *buffer, size_t len, size_t ms_timeout, boo
             }
         }
 
-        pos = __atomic_load_n(&comm_raw_pos, __ATOMIC_SEQ_CST);
+        pos = __atomic_load_n(&ctx->comm_raw_pos, __ATOMIC_SEQ_CST);
 
         // Check the timeout if pos is not updated
         if (last_pos == pos) {
-            uint64_t tmp_clk = __atomic_load_n(&timeout_start_time, __ATOMIC_SEQ_CST);
+            uint64_t tmp_clk = __atomic_load_n(&ctx->timeout_start_time, __ATOMIC_SEQ_CST);
             // If ms_timeout == -1, the loop can only be breaked by pressing Enter or receiving enough data
             if ((ms_timeout != (size_t) - 1) && (msclock() - tmp_clk > ms_timeout)) {
                 break;
@@ -1016,10 +1278,58 @@ size_t WaitForRawDataTimeout(uint8_t *buffer, size_t len, size_t ms_timeout, boo
         msleep(ms_timeout);
     }
     SetCommunicationReceiveMode(false);
-    pos = __atomic_load_n(&comm_raw_pos, __ATOMIC_SEQ_CST);
+    pos = __atomic_load_n(&ctx->comm_raw_pos, __ATOMIC_SEQ_CST);
     return pos;
 }
 
+/**
+ * @brief Takes data out of the ring set by SetCommunicationRawReceiveRing()
+ *
+ * @param dest where to copy the data to
+ * @param len the maximum number of bytes to take
+ * @param ms_timeout how long to wait for the first byte
+ * @param dropped if not NULL, receives the number of bytes lost so far because the ring was full
+ * @return the number of bytes copied, 0 on timeout
+ */
+size_t ReadRawDataRing(uint8_t *dest, size_t len, size_t ms_timeout, size_t *dropped) {
+    comm_ctx_t *ctx = comm_get();
+    const uint8_t *ring = __atomic_load_n(&ctx->comm_raw_data, __ATOMIC_SEQ_CST);
+    size_t ring_len = __atomic_load_n(&ctx->comm_raw_len, __ATOMIC_SEQ_CST);
+    size_t tail = __atomic_load_n(&ctx->comm_raw_tail, __ATOMIC_SEQ_CST);
+
+    uint64_t start = msclock();
+    size_t pos = __atomic_load_n(&ctx->comm_raw_pos, __ATOMIC_SEQ_CST);
+    while ((pos == tail) && (msclock() - start < ms_timeout) && (IsCommunicationThreadDead() == false)) {
+        msleep(10);
+        pos = __atomic_load_n(&ctx->comm_raw_pos, __ATOMIC_SEQ_CST);
+    }
+
+    size_t n = MIN(len, pos - tail);
+    for (size_t done = 0; done < n;) {
+        size_t off = (tail + done) % ring_len;
+        size_t chunk = MIN(n - done, ring_len - off);
+        memcpy(dest + done, ring + off, chunk);
+        done += chunk;
+    }
+    __atomic_store_n(&ctx->comm_raw_tail, tail + n, __ATOMIC_SEQ_CST);
+
+    if (dropped != NULL) {
+        *dropped = __atomic_load_n(&ctx->comm_raw_dropped, __ATOMIC_SEQ_CST);
+    }
+    return n;
+}
+
+// how long to sleep for the next reply before the timeout, the 3 s warning or
+// a dead communication thread needs to be looked at again
+static uint32_t reply_wait_ms(uint64_t start, size_t ms_timeout) {
+    uint64_t elapsed = msclock() - start;
+    uint64_t wait = 100;
+    if (ms_timeout != (size_t) - 1 && elapsed < ms_timeout) {
+        wait = MIN(wait, ms_timeout - elapsed);
+    }
+    return MAX(wait, 1);
+}
+
 /**
  * @brief Waits for a certain response type. This method waits for a maximum of
  * ms_timeout milliseconds for a specified response command.
@@ -1031,6 +1341,7 @@ size_t WaitForRawDataTimeout(uint8_t *buffer, size_t len, size_t ms_timeout, boo
  * @return true if command was returned, otherwise false
  */
 bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms_timeout, bool show_warning) {
+    comm_ctx_t *ctx = comm_get();
 
     // init to ZERO
     PacketResponseNG resp;
@@ -1044,7 +1355,7 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
     if (ms_timeout != (size_t) - 1)
         ms_timeout += communication_delay();
 
-    __atomic_store_n(&timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
 
     // Wait until the command is received
     while (true) {
@@ -1068,7 +1379,7 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
             }
         }
 
-        uint64_t tmp_clk = __atomic_load_n(&timeout_start_time, __ATOMIC_SEQ_CST);
+        uint64_t tmp_clk = __atomic_load_n(&ctx->timeout_start_time, __ATOMIC_SEQ_CST);
         if ((ms_timeout != (size_t) - 1) && (msclock() - tmp_clk > ms_timeout)) {
             break;
         }
@@ -1078,8 +1389,9 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
             PrintAndLogEx(INFO, "You can cancel this operation by pressing the pm3 button");
             show_warning = false;
         }
-        // just to avoid CPU busy loop:
-        msleep(1);
+
+        // sleep until the next reply arrives
+        waitReply(reply_wait_ms(tmp_clk, ms_timeout));
     }
     return false;
 }
@@ -1127,20 +1439,17 @@ bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint3
 
     switch (memtype) {
         case BIG_BUF: {
-            SendCommandMIX(CMD_DOWNLOAD_BIGBUF, start_index, bytes, 0, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_BIGBUF);
+            return dl_window(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_BIGBUF, CMD_DOWNLOAD_BIGBUF, start_index);
         }
         case BIG_BUF_EML: {
-            SendCommandMIX(CMD_DOWNLOAD_EML_BIGBUF, start_index, bytes, 0, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_EML_BIGBUF);
+            return dl_window(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_EML_BIGBUF, CMD_DOWNLOAD_EML_BIGBUF, start_index);
         }
         case SPIFFS: {
             SendCommandMIX(CMD_SPIFFS_DOWNLOAD, start_index, bytes, 0, data, datalen);
             return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_SPIFFS_DOWNLOADED);
         }
         case FLASH_MEM: {
-            SendCommandMIX(CMD_FLASHMEM_DOWNLOAD, start_index, bytes, 0, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_FLASHMEM_DOWNLOADED);
+            return dl_window(dest, bytes, response, ms_timeout, show_warning, CMD_FLASHMEM_DOWNLOADED, CMD_FLASHMEM_DOWNLOAD, start_index);
         }
         case SIM_MEM: {
             //SendCommandMIX(CMD_DOWNLOAD_SIM_MEM, start_index, bytes, 0, NULL, 0);
@@ -1161,10 +1470,39 @@ bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint3
     return false;
 }
 
+// common wait of the download loops, false when the device stopped answering
+static bool dl_wait(comm_ctx_t *ctx, size_t ms_timeout, bool *show_warning) {
+    uint64_t tmp_clk = __atomic_load_n(&ctx->timeout_start_time, __ATOMIC_SEQ_CST);
+    if (msclock() - tmp_clk > ms_timeout) {
+        PrintAndLogEx(FAILED, "Timed out while trying to download data from device");
+        return false;
+    }
+
+    if (msclock() - tmp_clk > 3000 && *show_warning) {
+        // 3 seconds elapsed (but this doesn't mean the timeout was exceeded)
+        PrintAndLogEx(INFO, "Waiting for a response from the Proxmark3...");
+        PrintAndLogEx(INFO, "You can cancel this operation by pressing the pm3 button");
+        *show_warning = false;
+    }
+
+    waitReply(reply_wait_ms(tmp_clk, ms_timeout));
+    return true;
+}
+
+static void dl_wtx(const PacketResponseNG *response, size_t *ms_timeout) {
+    uint16_t wtx = response->data.asDwords[0] & 0xFFFF;
+    PrintAndLogEx(DEBUG, "Got Waiting Time eXtension request %i ms", wtx);
+    if (*ms_timeout != (size_t) - 1)
+        *ms_timeout += wtx;
+}
+
+// Downloads the device streams in one go after the request sent by the caller, finished with an ACK.
+// These can't be restarted at an index, a lost frame stays lost.
 static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd) {
+    comm_ctx_t *ctx = comm_get();
 
     uint32_t bytes_completed = 0;
-    __atomic_store_n(&timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctx->timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
 
     // Add delay depending on the communication channel & speed
     if (ms_timeout != (size_t) - 1)
@@ -1205,25 +1543,182 @@ static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, siz
                 memcpy(dest + offset, response->data.asBytes, copy_bytes);
                 bytes_completed += copy_bytes;
             } else if (response->cmd == CMD_WTX && response->length == sizeof(uint16_t)) {
-                uint16_t wtx = response->data.asDwords[0] & 0xFFFF;
-                PrintAndLogEx(DEBUG, "Got Waiting Time eXtension request %i ms", wtx);
-                if (ms_timeout != (size_t) - 1)
-                    ms_timeout += wtx;
+                dl_wtx(response, &ms_timeout);
             }
+            continue;
         }
 
-        uint64_t tmp_clk = __atomic_load_n(&timeout_start_time, __ATOMIC_SEQ_CST);
-        if (msclock() - tmp_clk > ms_timeout) {
-            PrintAndLogEx(FAILED, "Timed out while trying to download data from device");
+        if (dl_wait(ctx, ms_timeout, &show_warning) == false) {
             break;
         }
+    }
+    return false;
+}
 
-        if (msclock() - tmp_clk > 3000 && show_warning) {
-            // 3 seconds elapsed (but this doesn't mean the timeout was exceeded)
-            PrintAndLogEx(INFO, "Waiting for a response from the Proxmark3...");
-            PrintAndLogEx(INFO, "You can cancel this operation by pressing the pm3 button");
-            show_warning = false;
+typedef struct {
+    uint32_t base;  // offset in dest
+    uint32_t len;
+    uint8_t attempt;
+} dl_request_t;
+
+// Downloads the device can start at any index, asked for in windows of DL_WINDOW_BYTES.
+// Up to DL_WINDOWS_IN_FLIGHT requests are queued on the device, it answers them in order and
+// closes each one with an ACK. Chunks carry their own CRC (DL_FLAG_CHUNK_CRC), a chunk lost or
+// broken on the way is asked for again as soon as the ACK of its window is in.
+// Older firmwares ignore the flag and answer OLD frames without CRC, those only show losses.
+static bool dl_window(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd, uint32_t req_cmd, uint32_t start_index) {
+    comm_ctx_t *ctx = comm_get();
+
+    if (bytes == 0) {
+        return true;
+    }
+
+    // one bit per chunk, the unit is known from the first frame: DL_CHUNK_DATA_SIZE or PM3_CMD_DATA_SIZE
+    uint32_t chunks = (bytes + DL_CHUNK_DATA_SIZE - 1) / DL_CHUNK_DATA_SIZE;
+    uint8_t *got = calloc((chunks + 7) / 8, sizeof(uint8_t));
+    if (got == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return false;
+    }
+    uint32_t unit = 0;
+
+    // requests sent and not acknowledged yet, oldest first
+    dl_request_t inflight[DL_WINDOWS_IN_FLIGHT];
+    uint8_t n_inflight = 0;
+    uint32_t next = 0;
+
+    bool res = false;
+    uint32_t bytes_completed = 0;
+    uint32_t bad_chunks = 0;
+
+    bool show_progress = (bytes >= DL_PROGRESS_MIN_BYTES);
+    uint32_t progress = 0;
+
+    __atomic_store_n(&ctx->timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
+
+    // Add delay depending on the communication channel & speed
+    if (ms_timeout != (size_t) - 1)
+        ms_timeout += communication_delay();
+
+    while (true) {
+
+        // keep the device busy with the next windows
+        while (n_inflight < DL_WINDOWS_IN_FLIGHT && next < bytes) {
+            dl_request_t *r = &inflight[n_inflight++];
+            r->base = next;
+            r->len = MIN(DL_WINDOW_BYTES, bytes - next);
+            r->attempt = 0;
+            next += r->len;
+            SendCommandMIX(req_cmd, start_index + r->base, r->len, DL_FLAG_CHUNK_CRC, NULL, 0);
+        }
+
+        if (n_inflight == 0) {
+            res = true;
+            break;
+        }
+
+        if (getReply(response) == false) {
+            if (dl_wait(ctx, ms_timeout, &show_warning) == false) {
+                break;
+            }
+            continue;
+        }
+
+        if (response->cmd == CMD_WTX && response->length == sizeof(uint16_t)) {
+            dl_wtx(response, &ms_timeout);
+            continue;
+        }
+
+        if (response->cmd == CMD_ACK) {
+
+            dl_request_t done = inflight[0];
+            memmove(&inflight[0], &inflight[1], (--n_inflight) * sizeof(dl_request_t));
+
+            // chunks of this window still missing, no unit yet means nothing arrived at all
+            uint32_t first = done.base, last = done.base + done.len;
+            if (unit) {
+                first = last;
+                last = done.base;
+                for (uint32_t off = done.base; off < done.base + done.len; off += unit) {
+                    uint32_t i = off / unit;
+                    if ((got[i >> 3] & (1 << (i & 7))) == 0) {
+                        first = MIN(first, off);
+                        last = MIN(off + unit, done.base + done.len);
+                    }
+                }
+            }
+            if (first >= last) {
+                continue;
+            }
+
+            if (done.attempt == DL_MAX_RETRIES) {
+                PrintAndLogEx(FAILED, "ERROR: Download incomplete, got %u of %u bytes", bytes_completed, bytes);
+                break;
+            }
+
+            PrintAndLogEx(DEBUG, "Missing %u bytes at offset %u, requesting them again", last - first, first);
+            dl_request_t *r = &inflight[n_inflight++];
+            r->base = first;
+            r->len = last - first;
+            r->attempt = done.attempt + 1;
+            SendCommandMIX(req_cmd, start_index + r->base, r->len, DL_FLAG_CHUNK_CRC, NULL, 0);
+            continue;
+        }
+
+        if (response->cmd != rec_cmd) {
+            continue;
+        }
+
+        uint32_t offset, copy_bytes;
+        const uint8_t *src;
+        if (response->ng) {
+            const dl_chunk_t *c = (const dl_chunk_t *)response->data.asBytes;
+            uint32_t hdr = sizeof(dl_chunk_t) - DL_CHUNK_DATA_SIZE;
+            if (response->length < hdr || c->len > DL_CHUNK_DATA_SIZE || response->length != hdr + c->len ||
+                    c->offset < start_index || crc16_xmodem(c->data, c->len) != c->crc) {
+                bad_chunks++;
+                continue;
+            }
+            unit = DL_CHUNK_DATA_SIZE;
+            offset = c->offset - start_index;
+            copy_bytes = c->len;
+            src = c->data;
+        } else {
+            // arg0 = offset in the running request
+            // arg1 = length bytes to transfer
+            // arg2 = bigbuff tracelength (?)
+            unit = PM3_CMD_DATA_SIZE;
+            offset = inflight[0].base + response->oldarg[0];
+            copy_bytes = MIN(response->oldarg[1], PM3_CMD_DATA_SIZE);
+            src = response->data.asBytes;
+        }
+
+        if (offset % unit || offset + copy_bytes > bytes) {
+            PrintAndLogEx(FAILED, "ERROR: Out of bounds when downloading from device,  offset %u | len %u | total len %u > buf_size %u", offset, copy_bytes,  offset + copy_bytes,  bytes);
+            break;
+        }
+
+        uint32_t i = offset / unit;
+        if (got[i >> 3] & (1 << (i & 7))) {
+            continue;
+        }
+        memcpy(dest + offset, src, copy_bytes);
+        got[i >> 3] |= (1 << (i & 7));
+        bytes_completed += copy_bytes;
+
+        if (show_progress && (bytes_completed * 10ULL / bytes) > progress) {
+            progress = bytes_completed * 10ULL / bytes;
+            PrintAndLogEx(INPLACE, "Downloading from device... " _YELLOW_("%3u") " %%", progress * 10);
         }
     }
-    return false;
+
+    if (progress) {
+        PrintAndLogEx(NORMAL, "");
+    }
+    if (bad_chunks) {
+        PrintAndLogEx(DEBUG, "%u chunks failed their CRC and were requested again", bad_chunks);
+    }
+
+    free(got);
+    return res;
 }
@@ -42,7 +42,7 @@ extern "C" {
 
 //For storing command that are received from the device
 #ifndef CMD_BUFFER_SIZE
-#define CMD_BUFFER_SIZE 100
+#define CMD_BUFFER_SIZE 512
 #endif
 
 #define COMM_RAW_RECEIVE_LEN (1024)
@@ -86,8 +86,18 @@ typedef struct {
 
 extern communication_arg_t g_conn;
 
+// per device communication state, private to comms.c
+typedef struct comm_ctx comm_ctx_t;
+
 typedef struct pm3_device {
     communication_arg_t *g_conn;
+    comm_ctx_t *ctx;
+    // sample and demod buffers, NULL for the client ones (see graph.h)
+    struct graph_buffers *graph;
+    // output grabbed by pm3_console() for this device, as text and, if capture_records is set, as json records
+    grabbed_output grabbed_output;
+    grabbed_output grabbed_records;
+    bool capture_records;
     int script_embedded;
 } pm3_device_t;
 
@@ -107,15 +117,24 @@ bool IsReconnectedOk(void);
 bool IsCommunicationThreadDead(void);
 bool SetCommunicationReceiveMode(bool isRawMode);
 void SetCommunicationRawReceiveBuffer(uint8_t *buffer, size_t len);
+void SetCommunicationRawReceiveRing(uint8_t *buffer, size_t len);
 size_t GetCommunicationRawReceiveNum(void);
 
 bool OpenProxmarkSilent(pm3_device_t **dev, const char *port, uint32_t speed);
 bool OpenProxmark(pm3_device_t **dev, const char *port, bool wait_for_port, int timeout, bool flash_mode, uint32_t speed);
 int TestProxmark(pm3_device_t *dev);
 void CloseProxmark(pm3_device_t *dev);
+
+pm3_device_t *NewProxmarkDevice(void);
+void FreeProxmarkDevice(pm3_device_t *dev);
+void SetCommunicationDevice(pm3_device_t *dev);
+communication_arg_t *GetCommunicationConn(void);
+int SetCommunicationTimeout(uint32_t ms);
+uint32_t GetCommunicationTimeout(void);
 void StartReconnectProxmark(void);
 
 size_t WaitForRawDataTimeout(uint8_t *buffer, size_t len, size_t ms_timeout, bool show_process);
+size_t ReadRawDataRing(uint8_t *dest, size_t len, size_t ms_timeout, size_t *dropped);
 bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
 bool WaitForResponseTimeout(uint32_t cmd, PacketResponseNG *response, size_t ms_timeout);
 bool WaitForResponse(uint32_t cmd, PacketResponseNG *response);
@@ -18,6 +18,8 @@
 #include "graph.h"
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <stdint.h>
 #include "ui.h"
 #include "proxgui.h"
 #include "util.h"           // param_get32ex
@@ -26,16 +28,265 @@
 #include "commonutil.h"     // Uint4bytetomemle
 
 
-int32_t g_GraphBuffer[MAX_GRAPH_TRACE_LEN];
-int32_t g_OperationBuffer[MAX_GRAPH_TRACE_LEN];
-int32_t g_OverlayBuffer[MAX_GRAPH_TRACE_LEN];
+// the first chunk is static, larger captures move the buffers to the heap
+static int32_t gs_graph_base[3][GRAPH_CHUNK_LEN];
+
+static graph_buffers_t gs_graph_primary = {
+    .graph = gs_graph_base[0],
+    .operation = gs_graph_base[1],
+    .overlay = gs_graph_base[2],
+    .capacity = GRAPH_CHUNK_LEN,
+};
+
+// buffers of the device the calling thread is bound to, see graph_bind()
+__thread graph_buffers_t *g_graph = &gs_graph_primary;
+
 bool    g_useOverlays = false;
-size_t  g_GraphTraceLen;
 buffer_savestate_t g_saveState_gb;
 marker_t g_MarkerA, g_MarkerB, g_MarkerC, g_MarkerD;
 marker_t *g_TempMarkers;
 uint8_t g_TempMarkerSize = 0;
 
+// the plot window reads the buffers from the GUI thread, so they only move under this lock
+static pthread_mutex_t gs_graph_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void graph_lock(void) {
+    pthread_mutex_lock(&gs_graph_lock);
+}
+
+void graph_unlock(void) {
+    pthread_mutex_unlock(&gs_graph_lock);
+}
+
+// buffers of an additional device, they start with one chunk on the heap
+graph_buffers_t *graph_buffers_new(void) {
+    graph_buffers_t *gb = calloc(1, sizeof(graph_buffers_t));
+    if (gb == NULL) {
+        return NULL;
+    }
+    gb->graph = calloc(GRAPH_CHUNK_LEN, sizeof(int32_t));
+    gb->operation = calloc(GRAPH_CHUNK_LEN, sizeof(int32_t));
+    gb->overlay = calloc(GRAPH_CHUNK_LEN, sizeof(int32_t));
+    gb->capacity = GRAPH_CHUNK_LEN;
+    if (gb->graph == NULL || gb->operation == NULL || gb->overlay == NULL) {
+        graph_buffers_free(gb);
+        return NULL;
+    }
+    return gb;
+}
+
+// no thread may be bound to gb anymore
+void graph_buffers_free(graph_buffers_t *gb) {
+    if (gb == NULL || gb == &gs_graph_primary) {
+        return;
+    }
+    free(gb->graph);
+    free(gb->operation);
+    free(gb->overlay);
+    free(gb);
+}
+
+// the calling thread works on gb from now on, NULL goes back to the client buffers
+void graph_bind(graph_buffers_t *gb) {
+    g_graph = (gb != NULL) ? gb : &gs_graph_primary;
+}
+
+// only the client buffers are shown in the plot window
+bool graph_plotted(void) {
+    return g_graph == &gs_graph_primary;
+}
+
+static bool graph_reserve_ex(graph_buffers_t *gb, size_t len) {
+    if (len <= gb->capacity) {
+        return true;
+    }
+
+    if (len > MAX_GRAPH_TRACE_LEN) {
+        PrintAndLogEx(WARNING, "Graph buffer limited to %d samples, requested %zu", MAX_GRAPH_TRACE_LEN, len);
+        return false;
+    }
+
+    // grow by half the current size at least, in whole chunks
+    size_t cap = MAX(len, gb->capacity + (gb->capacity / 2));
+    cap = ((cap + GRAPH_CHUNK_LEN - 1) / GRAPH_CHUNK_LEN) * GRAPH_CHUNK_LEN;
+    cap = MIN(cap, MAX_GRAPH_TRACE_LEN);
+
+    bool ok = true;
+    int32_t **bufs[] = { &gb->graph, &gb->operation, &gb->overlay };
+    graph_lock();
+    for (size_t i = 0; i < ARRAYLEN(bufs); i++) {
+        int32_t *p;
+        if (*bufs[i] == gs_graph_base[i]) {
+            p = malloc(cap * sizeof(int32_t));
+            if (p) {
+                memcpy(p, gs_graph_base[i], sizeof(gs_graph_base[i]));
+            }
+        } else {
+            p = realloc(*bufs[i], cap * sizeof(int32_t));
+        }
+
+        if (p == NULL) {
+            ok = false;
+            break;
+        }
+
+        memset(p + gb->capacity, 0x00, (cap - gb->capacity) * sizeof(int32_t));
+        *bufs[i] = p;
+    }
+    if (ok) {
+        gb->capacity = cap;
+    }
+    graph_unlock();
+
+    if (ok == false) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory for %zu graph samples", len);
+    }
+    return ok;
+}
+
+// make sure the graph, operation and overlay buffers hold at least len samples.
+// Capacity only grows, pointers into the buffers are invalidated when it does.
+bool graph_reserve(size_t len) {
+    return graph_reserve_ex(g_graph, len);
+}
+
+// dst gets the samples and demod buffer of src, e.g. for a thread demodulating the same capture
+bool graph_buffers_copy(graph_buffers_t *dst, const graph_buffers_t *src) {
+    if (graph_reserve_ex(dst, src->len) == false) {
+        return false;
+    }
+    memcpy(dst->graph, src->graph, src->len * sizeof(int32_t));
+    if (dst->len > src->len) {
+        memset(dst->graph + src->len, 0x00, (dst->len - src->len) * sizeof(int32_t));
+    }
+    dst->len = src->len;
+    memcpy(dst->demod, src->demod, src->demod_len);
+    dst->demod_len = src->demod_len;
+    dst->demod_start = src->demod_start;
+    dst->demod_clock = src->demod_clock;
+    return true;
+}
+
+// Scratch memory for demodulators, handed out stack wise.
+// Blocks are kept between commands so repeated demods don't allocate,
+// a block is never moved while an allocation lives in it.
+// Each thread has its own, the plot window runs demods from the GUI thread.
+#define GRAPH_SCRATCH_BLOCKS    8
+#define GRAPH_SCRATCH_DEPTH     32
+#define GRAPH_SCRATCH_ALIGN     16
+
+typedef struct {
+    uint8_t *mem;
+    size_t size;
+    size_t used;
+} graph_scratch_t;
+
+// live allocations, the last one on top
+typedef struct {
+    uint8_t *p;
+    size_t block;
+    bool released;
+} graph_scratch_entry_t;
+
+static __thread graph_scratch_t gs_scratch[GRAPH_SCRATCH_BLOCKS];
+static __thread size_t gs_scratch_top = 0;
+static __thread graph_scratch_entry_t gs_scratch_live[GRAPH_SCRATCH_DEPTH];
+static __thread size_t gs_scratch_depth = 0;
+
+// returns zeroed memory, release with graph_scratch_free in reverse order of allocation
+void *graph_scratch_alloc(size_t size) {
+
+    if (size > SIZE_MAX - GRAPH_SCRATCH_ALIGN) {
+        PrintAndLogEx(WARNING, "graph_scratch_alloc() - %zu bytes requested", size);
+        return NULL;
+    }
+
+    if (gs_scratch_depth == GRAPH_SCRATCH_DEPTH) {
+        PrintAndLogEx(WARNING, "graph_scratch_alloc() - more than %d live allocations", GRAPH_SCRATCH_DEPTH);
+        return NULL;
+    }
+
+    size = ((MAX(size, 1) + GRAPH_SCRATCH_ALIGN - 1) / GRAPH_SCRATCH_ALIGN) * GRAPH_SCRATCH_ALIGN;
+
+    for (size_t i = gs_scratch_top; i < GRAPH_SCRATCH_BLOCKS; i++) {
+        graph_scratch_t *b = &gs_scratch[i];
+
+        // blocks above the top are unused, resize them if needed
+        if (i > gs_scratch_top) {
+            b->used = 0;
+        }
+
+        if (b->used == 0 && b->size < size) {
+            size_t bsize = (b->size > SIZE_MAX / 2) ? size : MAX(size, b->size * 2);
+            uint8_t *mem = realloc(b->mem, bsize);
+            if (mem == NULL) {
+                return NULL;
+            }
+            b->mem = mem;
+            b->size = bsize;
+        }
+
+        if (b->size - b->used >= size) {
+            uint8_t *p = b->mem + b->used;
+            b->used += size;
+            gs_scratch_top = i;
+            gs_scratch_live[gs_scratch_depth].p = p;
+            gs_scratch_live[gs_scratch_depth].block = i;
+            gs_scratch_live[gs_scratch_depth].released = false;
+            gs_scratch_depth++;
+            memset(p, 0x00, size);
+            return p;
+        }
+    }
+    PrintAndLogEx(WARNING, "graph_scratch_alloc() - out of scratch blocks");
+    return NULL;
+}
+
+// releases p. Memory is only given back from the top, a release out of order
+// is reported and takes effect once everything allocated after p is released as well.
+void graph_scratch_free(void *p) {
+    if (p == NULL) {
+        return;
+    }
+
+    size_t n = gs_scratch_depth;
+    while (n && (gs_scratch_live[n - 1].p != p || gs_scratch_live[n - 1].released)) {
+        n--;
+    }
+
+    if (n == 0) {
+        PrintAndLogEx(WARNING, "graph_scratch_free() - pointer not allocated or already released");
+        return;
+    }
+
+    gs_scratch_live[n - 1].released = true;
+    if (n != gs_scratch_depth) {
+        PrintAndLogEx(WARNING, "graph_scratch_free() - released out of order, %zu later allocations still live", gs_scratch_depth - n);
+        return;
+    }
+
+    while (gs_scratch_depth && gs_scratch_live[gs_scratch_depth - 1].released) {
+        graph_scratch_entry_t *e = &gs_scratch_live[--gs_scratch_depth];
+        gs_scratch[e->block].used = e->p - gs_scratch[e->block].mem;
+    }
+    gs_scratch_top = (gs_scratch_depth) ? gs_scratch_live[gs_scratch_depth - 1].block : 0;
+}
+
+// gives the scratch blocks of the calling thread back, before it exits
+void graph_scratch_release(void) {
+    if (gs_scratch_depth) {
+        PrintAndLogEx(WARNING, "graph_scratch_release() - %zu allocations still live", gs_scratch_depth);
+        return;
+    }
+    for (size_t i = 0; i < GRAPH_SCRATCH_BLOCKS; i++) {
+        free(gs_scratch[i].mem);
+        gs_scratch[i].mem = NULL;
+        gs_scratch[i].size = 0;
+        gs_scratch[i].used = 0;
+    }
+    gs_scratch_top = 0;
+}
+
 /* write a manchester bit to the graph
 */
 void AppendGraph(bool redraw, uint16_t clock, int bit) {
@@ -43,18 +294,20 @@ void AppendGraph(bool redraw, uint16_t clock, int bit) {
     uint16_t end = clock;
     uint16_t i;
 
+    graph_reserve(g_GraphTraceLen + end);
+
     // overflow/underflow safe checks ... Assumptions:
     //     _Assert(g_GraphTraceLen >= 0);
-    //     _Assert(g_GraphTraceLen <= MAX_GRAPH_TRACE_LEN);
+    //     _Assert(g_GraphTraceLen <= g_graph->capacity);
     // If this occurs, allow partial rendering, up to the last sample...
-    if ((MAX_GRAPH_TRACE_LEN - g_GraphTraceLen) < half) {
+    if ((g_graph->capacity - g_GraphTraceLen) < half) {
         PrintAndLogEx(DEBUG, "WARNING: AppendGraph() - Request exceeds max graph length");
-        end = MAX_GRAPH_TRACE_LEN - g_GraphTraceLen;
+        end = g_graph->capacity - g_GraphTraceLen;
         half = end;
     }
-    if ((MAX_GRAPH_TRACE_LEN - g_GraphTraceLen) < end) {
+    if ((g_graph->capacity - g_GraphTraceLen) < end) {
         PrintAndLogEx(DEBUG, "WARNING: AppendGraph() - Request exceeds max graph length");
-        end = MAX_GRAPH_TRACE_LEN - g_GraphTraceLen;
+        end = g_graph->capacity - g_GraphTraceLen;
     }
 
     //set first half the clock bit (all 1's or 0's for a 0 or 1 bit)
@@ -106,8 +359,8 @@ void setGraphBuffer(const uint8_t *src, size_t size) {
 
     ClearGraph(false);
 
-    if (size > MAX_GRAPH_TRACE_LEN) {
-        size = MAX_GRAPH_TRACE_LEN;
+    if (graph_reserve(size) == false) {
+        size = g_graph->capacity;
     }
 
     for (size_t i = 0; i < size; ++i) {
@@ -219,7 +472,7 @@ void convertGraphFromBitstreamEx(int hi, int low) {
             g_GraphBuffer[i] = 0;
     }
 
-    uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(DEBUG, "ERR: convertGraphFromBitstreamEx, failed to allocate memory");
         return;
@@ -228,13 +481,13 @@ void convertGraphFromBitstreamEx(int hi, int low) {
     size_t size = getFromGraphBuffer(bits);
     if (size == 0) {
         PrintAndLogEx(WARNING, "Failed to copy from graphbuffer");
-        free(bits);
+        graph_scratch_free(bits);
         return;
     }
 
     // set signal properties low/high/mean/amplitude and is_noise detection
     computeSignalProperties(bits, size);
-    free(bits);
+    graph_scratch_free(bits);
     RepaintGraphWindow();
 }
 
@@ -251,7 +504,7 @@ int GetAskClock(const char *str, bool verbose) {
 
     // Auto-detect clock
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN,  sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
         return -1;
@@ -260,7 +513,7 @@ int GetAskClock(const char *str, bool verbose) {
     size_t size = getFromGraphBuffer(bits);
     if (size == 0) {
         PrintAndLogEx(WARNING, "Failed to copy from graphbuffer");
-        free(bits);
+        graph_scratch_free(bits);
         return -1;
     }
 
@@ -279,7 +532,7 @@ int GetAskClock(const char *str, bool verbose) {
         PrintAndLogEx(SUCCESS, "Auto-detected clock rate: %d, Best Starting Position: %d", clock1, idx);
     }
 
-    free(bits);
+    graph_scratch_free(bits);
     return clock1;
 }
 
@@ -288,7 +541,7 @@ int GetPskCarrier(bool verbose) {
         return -1;
     }
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN,  sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
         return -1;
@@ -297,12 +550,12 @@ int GetPskCarrier(bool verbose) {
     size_t size = getFromGraphBuffer(bits);
     if (size == 0) {
         PrintAndLogEx(WARNING, "Failed to copy from graphbuffer");
-        free(bits);
+        graph_scratch_free(bits);
         return -1;
     }
 
     uint16_t fc = countFC(bits, size, false);
-    free(bits);
+    graph_scratch_free(bits);
 
     uint8_t carrier = fc & 0xFF;
     if (carrier != 2 && carrier != 4 && carrier != 8) {
@@ -332,7 +585,7 @@ int GetPskClock(const char *str, bool verbose) {
     }
 
     // Auto-detect clock
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN,  sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
         return -1;
@@ -341,7 +594,7 @@ int GetPskClock(const char *str, bool verbose) {
     size_t size = getFromGraphBuffer(bits);
     if (size == 0) {
         PrintAndLogEx(WARNING, "Failed to copy from graphbuffer");
-        free(bits);
+        graph_scratch_free(bits);
         return -1;
     }
 
@@ -358,7 +611,7 @@ int GetPskClock(const char *str, bool verbose) {
         PrintAndLogEx(SUCCESS, "Auto-detected clock rate: %d", clock1);
     }
 
-    free(bits);
+    graph_scratch_free(bits);
     return clock1;
 }
 
@@ -374,7 +627,7 @@ int GetNrzClock(const char *str, bool verbose) {
     }
 
     // Auto-detect clock
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN,  sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
         return -1;
@@ -383,7 +636,7 @@ int GetNrzClock(const char *str, bool verbose) {
     size_t size = getFromGraphBuffer(bits);
     if (size == 0) {
         PrintAndLogEx(WARNING, "Failed to copy from graphbuffer");
-        free(bits);
+        graph_scratch_free(bits);
         return -1;
     }
 
@@ -395,7 +648,7 @@ int GetNrzClock(const char *str, bool verbose) {
         PrintAndLogEx(SUCCESS, "Auto-detected clock rate: %d", clock1);
     }
 
-    free(bits);
+    graph_scratch_free(bits);
     return clock1;
 }
 
@@ -435,7 +688,7 @@ bool fskClocks(uint8_t *fc1, uint8_t *fc2, uint8_t *rf1, int *firstClockEdge) {
         return false;
     }
 
-    uint8_t *bits = calloc(MAX_GRAPH_TRACE_LEN,  sizeof(uint8_t));
+    uint8_t *bits = graph_scratch_alloc(g_GraphTraceLen);
     if (bits == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
         return false;
@@ -444,14 +697,14 @@ bool fskClocks(uint8_t *fc1, uint8_t *fc2, uint8_t *rf1, int *firstClockEdge) {
     size_t size = getFromGraphBuffer(bits);
     if (size == 0) {
         PrintAndLogEx(WARNING, "Failed to copy from graphbuffer");
-        free(bits);
+        graph_scratch_free(bits);
         return false;
     }
 
     uint16_t ans = countFC(bits, size, true);
     if (ans == 0) {
         PrintAndLogEx(DEBUG, "DEBUG: No data found");
-        free(bits);
+        graph_scratch_free(bits);
         return false;
     }
 
@@ -459,7 +712,7 @@ bool fskClocks(uint8_t *fc1, uint8_t *fc2, uint8_t *rf1, int *firstClockEdge) {
     *fc2 = ans & 0xFF;
     *rf1 = detectFSKClk(bits, size, *fc1, *fc2, firstClockEdge);
 
-    free(bits);
+    graph_scratch_free(bits);
 
     if (*rf1 == 0) {
         PrintAndLogEx(DEBUG, "DEBUG: Clock detect error");
@@ -67,15 +67,54 @@ size_t restore_buffer32(buffer_savestate_t saveState, uint32_t *dest);
 size_t restore_bufferS32(buffer_savestate_t saveState, int32_t *dest);
 size_t restore_buffer8(buffer_savestate_t saveState, uint8_t *dest);
 
-#define MAX_GRAPH_TRACE_LEN (40000 * 32)
+bool graph_reserve(size_t len);
+void graph_lock(void);
+void graph_unlock(void);
+void *graph_scratch_alloc(size_t size);
+void graph_scratch_free(void *p);
+void graph_scratch_release(void);
+
+// graph buffers start with one chunk and grow on demand, up to MAX_GRAPH_TRACE_LEN samples
+#define GRAPH_CHUNK_LEN     (64 * 1024)
+#define MAX_GRAPH_TRACE_LEN (512 * 1024 * 1024)
 #define GRAPH_SAVE 1
 #define GRAPH_RESTORE 0
 
-extern int32_t g_GraphBuffer[MAX_GRAPH_TRACE_LEN];
-extern int32_t g_OperationBuffer[MAX_GRAPH_TRACE_LEN];
-extern int32_t g_OverlayBuffer[MAX_GRAPH_TRACE_LEN];
+#define MAX_DEMOD_BUF_LEN (1024*128)
+
+// Sample and demod buffers of one device. The client has a single set, libpm3 gives each
+// additional device its own (see NewProxmarkDevice) so commands run on several readers
+// at once don't share samples. The names below resolve to the set of the calling thread.
+typedef struct graph_buffers {
+    int32_t *graph;
+    int32_t *operation;
+    int32_t *overlay;
+    size_t len;
+    size_t capacity;
+    uint8_t demod[MAX_DEMOD_BUF_LEN];
+    size_t demod_len;
+    int32_t demod_start;
+    int demod_clock;
+} graph_buffers_t;
+
+extern __thread graph_buffers_t *g_graph;
+
+graph_buffers_t *graph_buffers_new(void);
+void graph_buffers_free(graph_buffers_t *gb);
+void graph_bind(graph_buffers_t *gb);
+bool graph_buffers_copy(graph_buffers_t *dst, const graph_buffers_t *src);
+bool graph_plotted(void);
+
+#define g_GraphBuffer       (g_graph->graph)
+#define g_OperationBuffer   (g_graph->operation)
+#define g_OverlayBuffer     (g_graph->overlay)
+#define g_GraphTraceLen     (g_graph->len)
+#define g_DemodBuffer       (g_graph->demod)
+#define g_DemodBufferLen    (g_graph->demod_len)
+#define g_DemodStartIdx     (g_graph->demod_start)
+#define g_DemodClock        (g_graph->demod_clock)
+
 extern bool    g_useOverlays;
-extern size_t  g_GraphTraceLen;
 
 extern marker_t g_MarkerA, g_MarkerB, g_MarkerC, g_MarkerD;
 extern marker_t *g_TempMarkers;
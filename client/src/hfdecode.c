@@ -0,0 +1,579 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Offline protocol decoding of raw `hf sniff` samples
+//
+// HfSniff() stores the HIPKD ADC output, one sample every 8/fc, without any
+// demodulation. The analogue front end is AC coupled: reader field steps show
+// up as saturated spikes, and the tag subcarrier rides on the envelope
+// (fc/16 toggles every sample, fc/32 takes four samples per period).
+//
+// The front ends below turn the samples into what the FPGA hands to the
+// protocol sniffers, one word per 64/fc, and feed them to the very same
+// decoders the firmware runs (common/iso14443a_decode.h, iso14443b_decode.h,
+// iso15693_decode.h), gated like SniffIso14443a/b() and SniffIso15693().
+//
+// Long inputs are cut into fixed size chunks decoded in parallel, the result
+// does not depend on the number of threads. Every chunk starts decoding a bit
+// early to settle, runs past its end to finish the frames started inside, and
+// keeps only the frames starting inside. Each capture starts with fresh
+// decoders.
+//-----------------------------------------------------------------------------
+#include "hfdecode.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "pm3_cmd.h"            // tracelog_hdr_t
+#include "util.h"               // num_CPUs
+#include "iso14443a_decode.h"
+#include "iso14443b_decode.h"
+#include "iso15693_decode.h"
+#include "iso15693tools.h"      // ISO15_REQ_*
+
+// raw samples per sniffer word (64/fc)
+#define HFDECODE_UNIT           8
+// samples decoded ahead of a chunk, for the front end and the decoders to settle
+#define HFDECODE_PREROLL        (16 * 1024)
+// samples decoded past a chunk, to complete frames starting inside it
+#define HFDECODE_POSTROLL       (256 * 1024)
+// samples per chunk, ~0.6s of air time
+#define HFDECODE_CHUNK          (1024 * 1024)
+#define HFDECODE_MAX_FRAME      256
+
+// a reader field step, deviation from the envelope baseline
+#define EDGE_THRESHOLD          32
+// samples after a field step the tag channel ignores, the spike is still decaying
+#define EDGE_HOLD               12
+// a deviation lasting longer than this is no spike but a new envelope level (field off / on)
+#define EDGE_SETTLE             64
+// 14a subcarrier detection, sum of two sample to sample differences
+#define TAG14A_THRESHOLD        40
+// 14b subcarrier onset, two consecutive sample to sample swings of opposite sign
+#define TAG14B_ONSET            24
+// 15693 amplitude scaling, a clean 20 count subcarrier ends up well above NOISE_THRESHOLD
+#define TAG15_GAIN              4
+
+typedef struct {
+    int edge_run;   // consecutive samples beyond EDGE_THRESHOLD making a field step
+    int max_low;    // longest reader modulation, in samples
+} hfdecode_fe_t;
+
+static const hfdecode_fe_t hfdecode_fe[] = {
+    // 14a pauses are ~2.5us, too short for the rising step to show reliably
+    [HFDECODE_14A] = { 2, 5 },
+    // 14b runs of zeros, SOF is up to 11 ETU. Three samples keep BPSK phase jumps from looking like steps
+    [HFDECODE_14B] = { 3, 200 },
+    // 9.44us pulses
+    [HFDECODE_15] = { 3, 20 },
+    [HFDECODE_ICLASS] = { 3, 20 },
+};
+
+typedef struct {
+    bool reader;
+    int64_t start;      // in samples, on the time line
+    int64_t end;
+    uint16_t len;
+    uint8_t data[HFDECODE_MAX_FRAME];
+    uint8_t par[HFDECODE_MAX_FRAME / 8];
+} hfdecode_frame_t;
+
+typedef struct {
+    hfdecode_protocol_t proto;
+    const int32_t *samples;     // the whole capture
+    size_t seglen;
+    int64_t timebase;           // capture start on the time line
+    size_t from;                // frames starting in [from, to) belong to this chunk
+    size_t to;
+    size_t offset;              // first sample decoded
+    hfdecode_frame_t *frames;
+    uint32_t cnt;
+    uint32_t max;
+    int res;
+} hfdecode_chunk_t;
+
+// start / end relative to chunk->offset
+static void frame_add(hfdecode_chunk_t *c, bool reader, int64_t start, int64_t end, const uint8_t *d, uint16_t len, const uint8_t *par) {
+    if (len == 0) {
+        return;
+    }
+
+    start += c->offset;
+    end += c->offset;
+    if (start < (int64_t)c->from || start >= (int64_t)c->to) {
+        return;
+    }
+
+    if (c->cnt == c->max) {
+        uint32_t nmax = (c->max == 0) ? 64 : c->max * 2;
+        hfdecode_frame_t *f = realloc(c->frames, nmax * sizeof(hfdecode_frame_t));
+        if (f == NULL) {
+            c->res = PM3_EMALLOC;
+            return;
+        }
+        c->frames = f;
+        c->max = nmax;
+    }
+
+    hfdecode_frame_t *f = &c->frames[c->cnt++];
+    f->reader = reader;
+    f->start = c->timebase + start;
+    f->end = c->timebase + end;
+    f->len = MIN(len, HFDECODE_MAX_FRAME);
+    memcpy(f->data, d, f->len);
+    if (par) {
+        memcpy(f->par, par, (f->len - 1) / 8 + 1);
+    } else {
+        memset(f->par, 0, sizeof(f->par));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Reader channel. Bit 0 of out[i] is the field (1 = unmodulated), bit 1 flags
+// samples disturbed by a field step, the tag channel must ignore those.
+//-----------------------------------------------------------------------------
+static void frontend_reader(const int32_t *x, size_t n, const hfdecode_fe_t *fe, uint8_t *out) {
+    if (n == 0) {
+        return;
+    }
+
+    // baseline, 1/16 IIR in 1/16 units, frozen during spikes and subcarrier
+    int32_t base = x[0] << 4;
+    int run = 0, low = 0, quiet = EDGE_HOLD;
+    uint8_t level = 1;
+
+    for (size_t i = 0; i < n; i++) {
+        int32_t d = x[i] - (base >> 4);
+        if (d > EDGE_THRESHOLD) {
+            run = (run > 0) ? run + 1 : 1;
+        } else if (d < -EDGE_THRESHOLD) {
+            run = (run < 0) ? run - 1 : -1;
+        } else {
+            run = 0;
+            base += d;
+        }
+
+        // resync on the new level, a frozen baseline would turn everything after into one long step
+        if (run > EDGE_SETTLE || run < -EDGE_SETTLE) {
+            base = x[i] << 4;
+            run = 0;
+        }
+
+        if (level == 0 && ++low > fe->max_low) {
+            level = 1;
+        }
+
+        if (run >= fe->edge_run || run <= -fe->edge_run) {
+            uint8_t step = (run > 0);
+            if (run == fe->edge_run || run == -fe->edge_run) {
+                if (step != level) {
+                    level = step;
+                    low = 0;
+                }
+                // the step started with the run
+                for (int k = 1; k < fe->edge_run; k++) {
+                    out[i - k] = level | 2;
+                }
+            }
+            quiet = 0;
+        } else if (quiet < EDGE_HOLD) {
+            quiet++;
+        }
+
+        out[i] = level | ((quiet < EDGE_HOLD) ? 2 : 0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// ISO14443A, 4 reader and 4 tag ticks (16/fc, two samples) per word, see SniffIso14443a()
+//-----------------------------------------------------------------------------
+static void decode_14a(hfdecode_chunk_t *c, const int32_t *x, const uint8_t *fe, size_t n) {
+    uint8_t cmd[HFDECODE_MAX_FRAME], cmd_par[HFDECODE_MAX_FRAME / 8];
+    uint8_t resp[HFDECODE_MAX_FRAME], resp_par[HFDECODE_MAX_FRAME / 8];
+
+    tUart14a uart = { .output = cmd, .output_len = sizeof(cmd), .parity = cmd_par };
+    tDemod14a demod = { .output = resp, .output_len = sizeof(resp), .parity = resp_par };
+    Uart14aResetEx(&uart);
+    Demod14aResetEx(&demod);
+
+    bool reader_active = false, tag_active = false;
+    uint8_t previous = 0;
+
+    size_t units = n / HFDECODE_UNIT;
+    for (size_t u = 0; u < units; u++) {
+        size_t base = u * HFDECODE_UNIT;
+
+        uint8_t sniffdata = 0;
+        for (int t = 0; t < 4; t++) {
+            size_t i = base + t * 2;
+            uint8_t field = fe[i] & fe[i + 1] & 1;
+            uint8_t mod = 0;
+            if (i > 0 && ((fe[i] | fe[i + 1]) & 2) == 0) {
+                int32_t alt = ABS(x[i] - x[i - 1]) + ABS(x[i + 1] - x[i]);
+                mod = (alt >= TAG14A_THRESHOLD);
+            }
+            sniffdata |= (field << (7 - t)) | (mod << (3 - t));
+        }
+
+        // Need two samples to feed Miller and Manchester-Decoder
+        if (u & 1) {
+            // decoder time is in ticks, 0 would make it measure real time
+            uint32_t ts = u * 4;
+
+            if (tag_active == false) {
+                uint8_t readerdata = (previous & 0xF0) | (sniffdata >> 4);
+                if (MillerDecodingEx(&uart, readerdata, ts)) {
+                    frame_add(c, true, (int64_t)uart.startTime * 2 - 8, (int64_t)uart.endTime * 2 - 8, uart.output, uart.len, uart.parity);
+                    Uart14aResetEx(&uart);
+                    Demod14aResetEx(&demod);
+                }
+                reader_active = (uart.state != STATE_14A_UNSYNCD);
+            }
+
+            if (reader_active == false) {
+                uint8_t tagdata = (previous << 4) | (sniffdata & 0x0F);
+                if (ManchesterDecodingEx(&demod, tagdata, 0, ts)) {
+                    frame_add(c, false, (int64_t)demod.startTime * 2 - 8, (int64_t)demod.endTime * 2 - 8, demod.output, demod.len, demod.parity);
+                    Demod14aResetEx(&demod);
+                    Uart14aResetEx(&uart);
+                }
+                tag_active = (demod.state != DEMOD_14A_UNSYNCD);
+            }
+        }
+        previous = sniffdata;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// ISO14443B, two reader bits and one I/Q pair per half ETU, see SniffIso14443b()
+// The fc/16 subcarrier toggles every sample, correlating against +-1 gives its
+// phase. There is no quadrature at this sample rate, Q stays 0. The correlation
+// window follows the tag's half ETU grid rather than the word grid.
+//-----------------------------------------------------------------------------
+static void decode_14b(hfdecode_chunk_t *c, const int32_t *x, const uint8_t *fe, size_t n) {
+    uint8_t cmd[HFDECODE_MAX_FRAME], resp[HFDECODE_MAX_FRAME];
+
+    tUart14b uart = { .output = cmd, .byteCntMax = sizeof(cmd) };
+    tDemod14b demod = { .output = resp, .max_len = sizeof(resp) };
+    Uart14bResetEx(&uart);
+    Demod14bResetEx(&demod);
+
+    bool reader_active = false, tag_active = false, expect_tag_answer = false;
+    // start of the tag half ETUs within a word, taken from the subcarrier onset
+    size_t toff = 0;
+
+    // the tag window may reach into the next word
+    size_t units = (n > HFDECODE_UNIT) ? (n - HFDECODE_UNIT) / HFDECODE_UNIT : 0;
+    for (size_t u = 0; u < units; u++) {
+        size_t base = u * HFDECODE_UNIT;
+
+        if (tag_active == false) {
+            for (int k = 0; k < 2; k++) {
+                if (Handle14443bSampleFromReaderEx(&uart, fe[base + k * 4 + 3] & 1)) {
+                    if (uart.byteCnt > 0) {
+                        int64_t eof = base + (k + 1) * 4;
+                        int64_t sof = eof - (uart.byteCnt * 10 + 12 + 10) * 16;
+                        frame_add(c, true, sof, eof, uart.output, uart.byteCnt, NULL);
+                    }
+                    Uart14bResetEx(&uart);
+                    Demod14bResetEx(&demod);
+                    expect_tag_answer = true;
+                }
+            }
+            reader_active = (uart.state > STATE_14B_GOT_FALLING_EDGE_OF_SOF);
+        }
+
+        if (reader_active == false && expect_tag_answer) {
+            // A word straddling a phase jump correlates to nothing and the demodulator
+            // drops out. Phase jumps are on ETU boundaries, which are where the subcarrier began.
+            if (demod.state == DEMOD_UNSYNCD) {
+                for (size_t j = MAX(base, 1); j < base + HFDECODE_UNIT; j++) {
+                    int32_t d0 = x[j] - x[j - 1];
+                    int32_t d1 = x[j + 1] - x[j];
+                    if ((fe[j] & 2) == 0 && ABS(d0) > TAG14B_ONSET && ABS(d1) > TAG14B_ONSET && (d0 ^ d1) < 0) {
+                        toff = j - base;
+                        break;
+                    }
+                }
+            }
+
+            int32_t corr = 0;
+            uint8_t disturbed = 0;
+            for (size_t j = base + toff; j < base + toff + HFDECODE_UNIT; j++) {
+                corr += (j & 1) ? -x[j] : x[j];
+                disturbed |= fe[j];
+            }
+            int ci = (disturbed & 2) ? 0 : corr / HFDECODE_UNIT;
+            ci = MAX(-63, MIN(63, ci));
+
+            if (Handle14443bSamplesFromTagEx(&demod, ci, 0)) {
+                int64_t eof = base + toff + HFDECODE_UNIT;
+                int64_t sof = eof - (demod.len * 10 + 12 + 10) * 16;
+                frame_add(c, false, sof, eof, demod.output, demod.len, NULL);
+                Uart14bResetEx(&uart);
+                Demod14bResetEx(&demod);
+                expect_tag_answer = false;
+                tag_active = false;
+            } else {
+                tag_active = (demod.state > WAIT_FOR_RISING_EDGE_OF_SOF);
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// ISO15693 / iCLASS, two reader bits and one tag amplitude per word, see SniffIso15693()
+// The fc/32 subcarrier takes four samples, I/Q over the word gives its amplitude.
+// Only single subcarrier answers, the raw samples carry no FSK detection.
+//-----------------------------------------------------------------------------
+static void decode_15(hfdecode_chunk_t *c, const int32_t *x, const uint8_t *fe, size_t n, bool iclass) {
+    uint8_t cmd[HFDECODE_MAX_FRAME], resp[HFDECODE_MAX_FRAME];
+
+    DecodeTag_t dtag = {0};
+    DecodeTagInit(&dtag, resp, sizeof(resp));
+    DecodeReader_t dreader = {0};
+    DecodeReaderInit(&dreader, cmd, sizeof(cmd), 0, NULL);
+
+    bool tag_active = false, reader_active = false, expect_tag_answer = false;
+    bool expect_fast_answer = true;
+
+    size_t units = n / HFDECODE_UNIT;
+    for (size_t u = 0; u < units; u++) {
+        size_t base = u * HFDECODE_UNIT;
+        int64_t ts = base + HFDECODE_UNIT;
+
+        if (tag_active == false) {
+            if (Handle15693SampleFromReader(fe[base + 3] & 1, &dreader) ||
+                    Handle15693SampleFromReader(fe[base + 7] & 1, &dreader)) {
+
+                if (dreader.byteCount > 0) {
+                    int64_t sof = ts - (dreader.byteCount * (dreader.Coding == CODING_1_OUT_OF_4 ? 4096 : 65536) + 1024 + 512) / 8;
+                    frame_add(c, true, sof, ts, dreader.output, dreader.byteCount, NULL);
+                    if (iclass == false) {
+                        expect_fast_answer = dreader.output[0] & ISO15_REQ_DATARATE_HIGH;
+                    }
+                }
+                DecodeTagReset(&dtag);
+                reader_active = false;
+                expect_tag_answer = true;
+            } else {
+                reader_active = (dreader.state >= STATE_READER_RECEIVE_DATA_1_OUT_OF_4);
+            }
+        }
+
+        if (reader_active == false && expect_tag_answer) {
+            const int32_t *s = x + base;
+            int32_t i = ABS(s[0] - s[2] + s[4] - s[6]);
+            int32_t q = ABS(s[1] - s[3] + s[5] - s[7]);
+            int32_t amplitude = (MAX(i, q) + MIN(i, q) / 2) * TAG15_GAIN;
+            uint8_t disturbed = 0;
+            for (int j = 0; j < HFDECODE_UNIT; j++) {
+                disturbed |= fe[base + j];
+            }
+            if (disturbed & 2) {
+                amplitude = 0;
+            }
+
+            if (Handle15693SamplesFromTag(MIN(amplitude, 0xFFFC), &dtag, expect_fast_answer)) {
+                int64_t eof = ts;
+                if (dtag.lastBit == SOF_PART2) {
+                    // needed 8 additional samples to confirm single SOF (iCLASS)
+                    eof -= 8 * HFDECODE_UNIT;
+                }
+                int64_t sof = eof - (dtag.len * 4096 + 2048 + (dtag.lastBit != SOF_PART2 ? 2048 : 0)) / 8;
+                frame_add(c, false, sof, eof, dtag.output, dtag.len, NULL);
+                DecodeTagReset(&dtag);
+                DecodeReaderReset(&dreader);
+                expect_tag_answer = false;
+                tag_active = false;
+            } else {
+                tag_active = (dtag.state >= STATE_TAG_RECEIVING_DATA);
+            }
+        }
+    }
+}
+
+static void decode_chunk(hfdecode_chunk_t *c) {
+    c->offset = (c->from > HFDECODE_PREROLL) ? c->from - HFDECODE_PREROLL : 0;
+    size_t end = MIN(c->seglen, c->to + HFDECODE_POSTROLL);
+    size_t n = end - c->offset;
+
+    uint8_t *fe = calloc(n, sizeof(uint8_t));
+    if (fe == NULL) {
+        c->res = PM3_EMALLOC;
+        return;
+    }
+
+    const int32_t *x = c->samples + c->offset;
+    frontend_reader(x, n, &hfdecode_fe[c->proto], fe);
+
+    switch (c->proto) {
+        case HFDECODE_14A:
+            decode_14a(c, x, fe, n);
+            break;
+        case HFDECODE_14B:
+            decode_14b(c, x, fe, n);
+            break;
+        case HFDECODE_15:
+        case HFDECODE_ICLASS:
+            decode_15(c, x, fe, n, c->proto == HFDECODE_ICLASS);
+            break;
+    }
+    free(fe);
+}
+
+typedef struct {
+    hfdecode_chunk_t *chunks;
+    size_t cnt;
+    size_t next;
+} hfdecode_work_t;
+
+static void *decode_thread(void *arg) {
+    hfdecode_work_t *w = (hfdecode_work_t *)arg;
+    for (;;) {
+        size_t i = __atomic_fetch_add(&w->next, 1, __ATOMIC_SEQ_CST);
+        if (i >= w->cnt) {
+            break;
+        }
+        decode_chunk(&w->chunks[i]);
+    }
+    return NULL;
+}
+
+// a frame straddling a chunk border is seen by both chunks, with slightly different start times
+static bool frame_is_duplicate(const hfdecode_frame_t *a, const hfdecode_frame_t *b) {
+    return a->reader == b->reader && a->len == b->len &&
+           a->start < b->end && b->start < a->end && memcmp(a->data, b->data, a->len) == 0;
+}
+
+int hfdecode_run(hfdecode_protocol_t proto, const hfdecode_segment_t *segs, size_t segcnt, int threads,
+                 uint8_t **trace, uint32_t *trace_len, uint32_t *frames) {
+
+    *trace = NULL;
+    *trace_len = 0;
+    *frames = 0;
+
+    if (threads < 1) {
+        threads = num_CPUs();
+    }
+
+    // whole words, every chunk samples on the same grid as a single pass would
+    size_t chunkcnt = 0;
+    for (size_t i = 0; i < segcnt; i++) {
+        chunkcnt += (segs[i].len + HFDECODE_CHUNK - 1) / HFDECODE_CHUNK;
+    }
+
+    hfdecode_work_t w = { .chunks = calloc(MAX(chunkcnt, 1), sizeof(hfdecode_chunk_t)), .cnt = chunkcnt, .next = 0 };
+    if (w.chunks == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    size_t k = 0;
+    int64_t timebase = 0;
+    for (size_t i = 0; i < segcnt; i++) {
+        for (size_t from = 0; from < segs[i].len; from += HFDECODE_CHUNK) {
+            hfdecode_chunk_t *c = &w.chunks[k++];
+            c->proto = proto;
+            c->samples = segs[i].samples;
+            c->seglen = segs[i].len;
+            c->timebase = timebase;
+            c->from = from;
+            c->to = MIN(from + HFDECODE_CHUNK, segs[i].len);
+            c->res = PM3_SUCCESS;
+        }
+        timebase += segs[i].len;
+    }
+
+    threads = MIN((size_t)threads, chunkcnt);
+    if (threads <= 1) {
+        decode_thread(&w);
+    } else {
+        pthread_t *tids = calloc(threads, sizeof(pthread_t));
+        int started = 0;
+        if (tids) {
+            for (; started < threads; started++) {
+                if (pthread_create(&tids[started], NULL, decode_thread, &w)) {
+                    break;
+                }
+            }
+        }
+        // whatever could not be handed out is done here
+        decode_thread(&w);
+        for (int i = 0; i < started; i++) {
+            pthread_join(tids[i], NULL);
+        }
+        free(tids);
+    }
+
+    // chunks are in time order, merge them into one trace
+    int res = PM3_SUCCESS;
+    size_t size = 0;
+    for (size_t i = 0; i < chunkcnt; i++) {
+        if (w.chunks[i].res != PM3_SUCCESS) {
+            res = w.chunks[i].res;
+        }
+        for (uint32_t j = 0; j < w.chunks[i].cnt; j++) {
+            const hfdecode_frame_t *f = &w.chunks[i].frames[j];
+            size += TRACELOG_HDR_LEN + f->len + (f->len - 1) / 8 + 1;
+        }
+    }
+
+    uint8_t *buf = (res == PM3_SUCCESS) ? calloc(MAX(size, 1), sizeof(uint8_t)) : NULL;
+    if (buf == NULL && res == PM3_SUCCESS) {
+        res = PM3_EMALLOC;
+    }
+
+    if (res == PM3_SUCCESS) {
+        uint32_t pos = 0;
+        const hfdecode_frame_t *last = NULL;
+        size_t last_chunk = 0;
+        for (size_t i = 0; i < chunkcnt; i++) {
+            for (uint32_t j = 0; j < w.chunks[i].cnt; j++) {
+                const hfdecode_frame_t *f = &w.chunks[i].frames[j];
+                // only across a border, identical frames within a chunk are retries
+                if (last && last_chunk + 1 == i && frame_is_duplicate(last, f)) {
+                    continue;
+                }
+                last = f;
+                last_chunk = i;
+
+                // timestamps in carrier cycles, 15693 durations are stored in units of 32 like LogTrace_ISO15693()
+                uint64_t duration = (f->end > f->start) ? (uint64_t)(f->end - f->start) * HFDECODE_UNIT : 0;
+                if (proto == HFDECODE_15 || proto == HFDECODE_ICLASS) {
+                    duration /= 32;
+                }
+
+                tracelog_hdr_t *hdr = (tracelog_hdr_t *)(buf + pos);
+                hdr->timestamp = (uint32_t)(MAX(f->start, 0) * HFDECODE_UNIT);
+                hdr->duration = MIN(duration, 0xFFFF);
+                hdr->data_len = f->len;
+                hdr->isResponse = (f->reader == false);
+                memcpy(hdr->frame, f->data, f->len);
+                memcpy(hdr->frame + f->len, f->par, TRACELOG_PARITY_LEN(hdr));
+                pos += TRACELOG_HDR_LEN + f->len + TRACELOG_PARITY_LEN(hdr);
+                (*frames)++;
+            }
+        }
+        *trace = buf;
+        *trace_len = pos;
+    }
+
+    for (size_t i = 0; i < chunkcnt; i++) {
+        free(w.chunks[i].frames);
+    }
+    free(w.chunks);
+    return res;
+}
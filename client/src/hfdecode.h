@@ -0,0 +1,42 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Offline protocol decoding of raw `hf sniff` samples
+//-----------------------------------------------------------------------------
+
+#ifndef HFDECODE_H__
+#define HFDECODE_H__
+
+#include "common.h"
+
+typedef enum {
+    HFDECODE_14A,
+    HFDECODE_14B,
+    HFDECODE_15,
+    HFDECODE_ICLASS,
+} hfdecode_protocol_t;
+
+// one capture, samples as `hf sniff` leaves them in the graph buffer
+typedef struct {
+    const int32_t *samples;
+    size_t len;
+} hfdecode_segment_t;
+
+// Runs the firmware sniffer decoders over the captures, laid out one after another on the time line,
+// using up to `threads` threads. On success *trace holds tracelog records, to be freed by the caller.
+int hfdecode_run(hfdecode_protocol_t proto, const hfdecode_segment_t *segs, size_t segcnt, int threads,
+                 uint8_t **trace, uint32_t *trace_len, uint32_t *frames);
+
+#endif
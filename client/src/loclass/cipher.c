@@ -35,6 +35,7 @@
 #include "cipher.h"
 #include "cipherutils.h"
 #include "commonutil.h"
+#include "parity.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
@@ -59,6 +60,7 @@ typedef struct {
     uint16_t t;
 } State_t;
 
+#ifndef ON_DEVICE
 /**
 *  Definition 2. The feedback function for the top register T : F 16/2 → F 2
 *  is defined as
@@ -241,15 +243,17 @@ static void MAC(uint8_t *k, BitstreamIn_t input, BitstreamOut_t out) {
     output(k, initState, &input_32_zeroes, &out);
 }
 
-void doMAC(uint8_t *cc_nr_p, uint8_t *div_key_p, uint8_t mac[4]) {
-    uint8_t cc_nr[13] = { 0 };
+// Bit by bit reference implementation, straight from the paper.
+// Only used by the selftest to cross-check the table driven engine below.
+static void doMAC_reference(const uint8_t *input, uint8_t input_size, const uint8_t *div_key_p, uint8_t mac[4]) {
+    uint8_t data[256] = { 0 };
     uint8_t div_key[8];
 
-    memcpy(cc_nr, cc_nr_p, 12);
+    memcpy(data, input, input_size);
     memcpy(div_key, div_key_p, 8);
 
-    reverse_arraybytes(cc_nr, 12);
-    BitstreamIn_t bitstream = {cc_nr, 12 * 8, 0};
+    reverse_arraybytes(data, input_size);
+    BitstreamIn_t bitstream = {data, input_size * 8, 0};
     uint8_t dest [] = {0, 0, 0, 0, 0, 0, 0, 0};
     BitstreamOut_t out = { dest, sizeof(dest) * 8, 0 };
     MAC(div_key, bitstream, out);
@@ -257,24 +261,95 @@ void doMAC(uint8_t *cc_nr_p, uint8_t *div_key_p, uint8_t mac[4]) {
     reverse_arraybytes(dest, sizeof(dest));
     memcpy(mac, dest, 4);
 }
+#endif
 
-void doMAC_N(uint8_t *address_data_p, uint8_t address_data_size, uint8_t *div_key_p, uint8_t mac[4]) {
-    uint8_t *address_data;
-    uint8_t div_key[8];
-    address_data = (uint8_t *) calloc(address_data_size, sizeof(uint8_t));
+/**
+* Table driven engine.
+*
+* Same cipher as the reference implementation above, but
+*  - the select function is a lookup on the right register,
+*  - T() is computed with a parity fold over the tapped bits,
+*  - the state is updated in place,
+*  - input and output bits are consumed / produced LSB first per byte,
+*    which removes the byte and bit reversing of the input and the MAC.
+* Ported from armsrc/optimized_cipher.c, roughly 30x faster than the
+* recursive bitstream version. The brute force loops in loclass and
+* 'hf iclass chk / lookup' spend most of their time in here.
+**/
+static const uint8_t select_LUT[256] = {
+    00, 03, 02, 01, 02, 03, 00, 01, 04, 07, 07, 04, 06, 07, 05, 04,
+    01, 02, 03, 00, 02, 03, 00, 01, 05, 06, 06, 05, 06, 07, 05, 04,
+    06, 05, 04, 07, 04, 05, 06, 07, 06, 05, 05, 06, 04, 05, 07, 06,
+    07, 04, 05, 06, 04, 05, 06, 07, 07, 04, 04, 07, 04, 05, 07, 06,
+    06, 05, 04, 07, 04, 05, 06, 07, 02, 01, 01, 02, 00, 01, 03, 02,
+    03, 00, 01, 02, 00, 01, 02, 03, 07, 04, 04, 07, 04, 05, 07, 06,
+    00, 03, 02, 01, 02, 03, 00, 01, 00, 03, 03, 00, 02, 03, 01, 00,
+    05, 06, 07, 04, 06, 07, 04, 05, 05, 06, 06, 05, 06, 07, 05, 04,
+    02, 01, 00, 03, 00, 01, 02, 03, 06, 05, 05, 06, 04, 05, 07, 06,
+    03, 00, 01, 02, 00, 01, 02, 03, 07, 04, 04, 07, 04, 05, 07, 06,
+    02, 01, 00, 03, 00, 01, 02, 03, 02, 01, 01, 02, 00, 01, 03, 02,
+    03, 00, 01, 02, 00, 01, 02, 03, 03, 00, 00, 03, 00, 01, 03, 02,
+    04, 07, 06, 05, 06, 07, 04, 05, 00, 03, 03, 00, 02, 03, 01, 00,
+    01, 02, 03, 00, 02, 03, 00, 01, 05, 06, 06, 05, 06, 07, 05, 04,
+    04, 07, 06, 05, 06, 07, 04, 05, 04, 07, 07, 04, 06, 07, 05, 04,
+    01, 02, 03, 00, 02, 03, 00, 01, 01, 02, 02, 01, 02, 03, 01, 00
+};
+
+// select_LUT[r] == _select(0, 0, r), the x and y inputs are folded in afterwards
+static inline void fast_successor(const uint8_t *k, State_t *s, uint8_t y) {
+    // T(t) = x0 ^ x1 ^ x5 ^ x7 ^ x10 ^ x11 ^ x14 ^ x15
+    uint8_t Tt = evenparity16(s->t & 0xc533);
+
+    s->t = (s->t >> 1) | (((Tt ^ (s->r >> 7) ^ (s->r >> 3)) & 1) << 15);
+
+    uint8_t fb = s->b ^ (s->b >> 6) ^ (s->b >> 5) ^ (s->b >> 4) ^ s->r;
+    s->b = (s->b >> 1) | (fb << 7);
+
+    uint8_t sel = select_LUT[s->r] ^ (((Tt ^ y) & 1) << 1) ^ Tt;
+
+    uint8_t r = s->r;
+    s->r = (k[sel] ^ s->b) + s->l;
+    s->l = s->r + r;
+}
 
-    memcpy(address_data, address_data_p, address_data_size);
-    memcpy(div_key, div_key_p, 8);
+static void fast_suc(const uint8_t *k, State_t *s, const uint8_t *in, uint8_t length) {
+    for (uint8_t i = 0; i < length; i++) {
+        uint8_t head = in[i];
+        for (uint8_t j = 0; j < 8; j++) {
+            fast_successor(k, s, head);
+            head >>= 1;
+        }
+    }
+}
 
-    reverse_arraybytes(address_data, address_data_size);
-    BitstreamIn_t bitstream = {address_data, address_data_size * 8, 0};
-    uint8_t dest [] = {0, 0, 0, 0, 0, 0, 0, 0};
-    BitstreamOut_t out = { dest, sizeof(dest) * 8, 0 };
-    MAC(div_key, bitstream, out);
-    //The output MAC must also be reversed
-    reverse_arraybytes(dest, sizeof(dest));
-    memcpy(mac, dest, 4);
-    free(address_data);
+static void fast_output(const uint8_t *k, State_t *s, uint8_t out[4]) {
+    for (uint8_t i = 0; i < 4; i++) {
+        uint8_t bout = 0;
+        for (uint8_t j = 0; j < 8; j++) {
+            bout |= ((s->r >> 2) & 1) << j;
+            fast_successor(k, s, 0);
+        }
+        out[i] = bout;
+    }
+}
+
+static void fast_MAC(const uint8_t *k, const uint8_t *input, uint8_t input_size, uint8_t mac[4]) {
+    State_t s = {
+        ((k[0] ^ 0x4c) + 0xEC) & 0xFF,// l
+        ((k[0] ^ 0x4c) + 0x21) & 0xFF,// r
+        0x4c, // b
+        0xE012 // t
+    };
+    fast_suc(k, &s, input, input_size);
+    fast_output(k, &s, mac);
+}
+
+void doMAC(uint8_t *cc_nr_p, uint8_t *div_key_p, uint8_t mac[4]) {
+    fast_MAC(div_key_p, cc_nr_p, 12, mac);
+}
+
+void doMAC_N(uint8_t *address_data_p, uint8_t address_data_size, uint8_t *div_key_p, uint8_t mac[4]) {
+    fast_MAC(div_key_p, address_data_p, address_data_size, mac);
 }
 
 #ifndef ON_DEVICE
@@ -298,6 +373,34 @@ int testMAC(void) {
         printarr("    Correct_MAC   ", correct_MAC, 4);
         return PM3_ESOFT;
     }
+
+    // cross-check the table driven engine against the bit by bit reference
+    uint32_t seed = 0x1d49c9da;
+    for (int i = 0; i < 1000; i++) {
+        uint8_t data[32];
+        uint8_t key[8];
+        for (uint8_t j = 0; j < sizeof(data); j++) {
+            seed = seed * 1103515245 + 12345;
+            data[j] = seed >> 16;
+        }
+        for (uint8_t j = 0; j < sizeof(key); j++) {
+            seed = seed * 1103515245 + 12345;
+            key[j] = seed >> 16;
+        }
+
+        uint8_t len = (i & 1) ? 12 : (i % sizeof(data)) + 1;
+        uint8_t ref_mac[4] = {0};
+        doMAC_reference(data, len, key, ref_mac);
+        doMAC_N(data, len, key, calculated_mac);
+
+        if (memcmp(calculated_mac, ref_mac, 4) != 0) {
+            PrintAndLogEx(FAILED, "    MAC engine vs reference ( %s )", _RED_("fail"));
+            printarr("    Calculated_MAC", calculated_mac, 4);
+            printarr("    Reference_MAC ", ref_mac, 4);
+            return PM3_ESOFT;
+        }
+    }
+    PrintAndLogEx(SUCCESS, "    MAC engine vs reference ( %s )", _GREEN_("ok"));
     return PM3_SUCCESS;
 }
 #endif
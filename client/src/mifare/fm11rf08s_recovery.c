@@ -0,0 +1,467 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// FM11RF08S backdoored static encrypted nonce key recovery
+//
+// Same strategy as staticnested_1nt, staticnested_2x1nt_rf08s and
+// staticnested_2x1nt_rf08s_1key (Doegox, 2024, cf https://eprint.iacr.org/2024/1275)
+// but all candidate lists are kept in memory and the sectors are processed in parallel.
+//-----------------------------------------------------------------------------
+#include "fm11rf08s_recovery.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "commonutil.h"
+#include "pm3_cmd.h"             // PM3_*
+#include "crapto1/crapto1.h"
+#include "parity.h"
+#include "mfkey.h"              // compare_uint64
+#include "util.h"               // num_CPUs
+
+#define RF08S_KEY_SPACE_SIZE    (1 << 18)
+
+uint8_t rf08s_real_sector(uint8_t sec) {
+    return (sec < MIFARE_1K_MAXSECTOR) ? sec : sec - MIFARE_1K_MAXSECTOR + RF08S_EXTRA_SECTOR;
+}
+
+uint32_t rf08s_nt(const iso14a_fm11rf08s_nonces_with_data_t *nonces, uint8_t sec, uint8_t keytype) {
+    return bytes_to_num(nonces->nt[sec][keytype], 4);
+}
+
+//-----------------------------------------------------------------------------
+// candidate generation, one key type of one sector
+//-----------------------------------------------------------------------------
+static int generate_keys(uint32_t uid, uint32_t nt, uint32_t nt_enc, uint8_t par_err, rf08s_keylist_t *out) {
+
+    out->keys = NULL;
+    out->cnt = 0;
+
+    uint64_t *keys = calloc(RF08S_KEY_SPACE_SIZE, sizeof(uint64_t));
+    if (keys == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    // one thread per sector already, don't split further
+    struct Crypto1State *revstate = lfsr_recovery32_mt(nt ^ nt_enc, nt ^ uid, 1);
+    if (revstate == NULL) {
+        free(keys);
+        return PM3_EMALLOC;
+    }
+
+    // only filtering possibility: last parity bit ks in ks2, the filter output of the recovered
+    // states as they are right after nt ^ uid
+    uint8_t kslastp = oddparity8(nt & 0xFF) ^ (par_err & 1) ^ oddparity8(nt_enc & 0xFF);
+
+    uint32_t cnt = 0;
+    for (struct Crypto1State *p = revstate; (p->odd != 0) || (p->even != 0); p++) {
+        if (filter(p->odd) != kslastp) {
+            continue;
+        }
+        uint64_t lfsr = 0;
+        lfsr_rollback_word(p, nt ^ uid, 0);
+        crypto1_get_lfsr(p, &lfsr);
+        keys[cnt++] = lfsr;
+        if (cnt == RF08S_KEY_SPACE_SIZE) {
+            break;
+        }
+    }
+    crypto1_destroy(revstate);
+
+    if (cnt == 0) {
+        free(keys);
+        return PM3_SUCCESS;
+    }
+
+    uint64_t *tmp = realloc(keys, cnt * sizeof(uint64_t));
+    out->keys = (tmp) ? tmp : keys;
+    out->cnt = cnt;
+    return PM3_SUCCESS;
+}
+
+// keyA and keyB of a sector share the same nonce seed, seeds are only 16 bits
+// so the join of both lists is a lookup in a 64k table
+static int join_keys(uint32_t nt_a, const rf08s_keylist_t *in_a, uint32_t nt_b, const rf08s_keylist_t *in_b,
+                     rf08s_keylist_t *out_a, rf08s_keylist_t *out_b) {
+
+    uint16_t *seed_a = calloc(in_a->cnt + 1, sizeof(uint16_t));
+    uint16_t *seed_b = calloc(in_b->cnt + 1, sizeof(uint16_t));
+    uint8_t *seen_a = calloc(1 << 16, sizeof(uint8_t));
+    uint8_t *seen_b = calloc(1 << 16, sizeof(uint8_t));
+    // an empty filtered list still means the join was done
+    out_a->keys = calloc(in_a->cnt + 1, sizeof(uint64_t));
+    out_b->keys = calloc(in_b->cnt + 1, sizeof(uint64_t));
+    out_a->cnt = 0;
+    out_b->cnt = 0;
+
+    if (seed_a == NULL || seed_b == NULL || seen_a == NULL || seen_b == NULL || out_a->keys == NULL || out_b->keys == NULL) {
+        free(seed_a);
+        free(seed_b);
+        free(seen_a);
+        free(seen_b);
+        free(out_a->keys);
+        free(out_b->keys);
+        out_a->keys = NULL;
+        out_b->keys = NULL;
+        return PM3_EMALLOC;
+    }
+
+    for (uint32_t i = 0; i < in_a->cnt; i++) {
+        seed_a[i] = compute_seednt16_nt32(nt_a, in_a->keys[i]);
+        seen_a[seed_a[i]] = 1;
+    }
+
+    for (uint32_t i = 0; i < in_b->cnt; i++) {
+        seed_b[i] = compute_seednt16_nt32(nt_b, in_b->keys[i]);
+        seen_b[seed_b[i]] = 1;
+    }
+
+    for (uint32_t i = 0; i < in_a->cnt; i++) {
+        if (seen_b[seed_a[i]]) {
+            out_a->keys[out_a->cnt++] = in_a->keys[i];
+        }
+    }
+
+    for (uint32_t i = 0; i < in_b->cnt; i++) {
+        if (seen_a[seed_b[i]]) {
+            out_b->keys[out_b->cnt++] = in_b->keys[i];
+        }
+    }
+
+    free(seed_a);
+    free(seed_b);
+    free(seen_a);
+    free(seen_b);
+    return PM3_SUCCESS;
+}
+
+int rf08s_filter_1key(uint32_t nt_known, uint64_t key_known, uint32_t nt_target,
+                      const rf08s_keylist_t *in, rf08s_keylist_t *out) {
+
+    init_lfsr16_table();
+
+    out->cnt = 0;
+    out->keys = calloc(in->cnt + 1, sizeof(uint64_t));
+    if (out->keys == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    uint16_t seed = compute_seednt16_nt32(nt_known, key_known);
+    for (uint32_t i = 0; i < in->cnt; i++) {
+        if (seed == compute_seednt16_nt32(nt_target, in->keys[i])) {
+            out->keys[out->cnt++] = in->keys[i];
+        }
+    }
+    return PM3_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// ordering, the most likely keys are checked first
+//-----------------------------------------------------------------------------
+static bool is_default_key(uint64_t key, const uint64_t *defkeys, uint32_t defcnt) {
+    if (defcnt == 0) {
+        return false;
+    }
+    return bsearch(&key, defkeys, defcnt, sizeof(uint64_t), compare_uint64) != NULL;
+}
+
+// stable partition: default keys, then (sector 32 only) keys starting with 0000, then the rest
+static int prioritize_keys(rf08s_keylist_t *list, const uint64_t *defkeys, uint32_t defcnt, bool zero_prefix) {
+    if (list->cnt < 2) {
+        return PM3_SUCCESS;
+    }
+
+    uint64_t *tmp = calloc(list->cnt, sizeof(uint64_t));
+    if (tmp == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    uint8_t *rank = calloc(list->cnt, sizeof(uint8_t));
+    if (rank == NULL) {
+        free(tmp);
+        return PM3_EMALLOC;
+    }
+
+    for (uint32_t i = 0; i < list->cnt; i++) {
+        if (is_default_key(list->keys[i], defkeys, defcnt)) {
+            rank[i] = 0;
+        } else if (zero_prefix && (list->keys[i] >> 32) == 0) {
+            rank[i] = 0;
+        } else {
+            rank[i] = 1;
+        }
+    }
+
+    uint32_t n = 0;
+    for (uint8_t r = 0; r < 2; r++) {
+        for (uint32_t i = 0; i < list->cnt; i++) {
+            if (rank[i] == r) {
+                tmp[n++] = list->keys[i];
+            }
+        }
+    }
+
+    memcpy(list->keys, tmp, list->cnt * sizeof(uint64_t));
+    free(rank);
+    free(tmp);
+    return PM3_SUCCESS;
+}
+
+// the list used for further work, the seed join result when available
+static rf08s_keylist_t *primary_list(rf08s_candidates_t *c) {
+    return (c->filtered.keys) ? &c->filtered : &c->all;
+}
+
+// keys present in more than one candidate list are probably reused, collect them per list
+static int find_duplicates(rf08s_candidates_t cands[RF08S_NUM_SECTORS][2], const uint64_t *defkeys, uint32_t defcnt) {
+
+    uint32_t total = 0;
+    for (uint8_t sec = 0; sec < RF08S_NUM_SECTORS; sec++) {
+        for (uint8_t kt = 0; kt < 2; kt++) {
+            total += primary_list(&cands[sec][kt])->cnt;
+        }
+    }
+
+    if (total == 0) {
+        return PM3_SUCCESS;
+    }
+
+    uint64_t *all = calloc(total, sizeof(uint64_t));
+    if (all == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    uint32_t n = 0;
+    for (uint8_t sec = 0; sec < RF08S_NUM_SECTORS; sec++) {
+        for (uint8_t kt = 0; kt < 2; kt++) {
+            rf08s_keylist_t *l = primary_list(&cands[sec][kt]);
+            if (l->cnt) {
+                memcpy(all + n, l->keys, l->cnt * sizeof(uint64_t));
+                n += l->cnt;
+            }
+        }
+    }
+
+    // candidates are unique within one list, so any repeat comes from another list
+    qsort(all, total, sizeof(uint64_t), compare_uint64);
+
+    uint64_t *dupset = calloc(total / 2 + 1, sizeof(uint64_t));
+    if (dupset == NULL) {
+        free(all);
+        return PM3_EMALLOC;
+    }
+
+    uint32_t dupcnt = 0;
+    for (uint32_t i = 1; i < total; i++) {
+        if (all[i] == all[i - 1] && (dupcnt == 0 || dupset[dupcnt - 1] != all[i])) {
+            dupset[dupcnt++] = all[i];
+        }
+    }
+
+    int res = PM3_SUCCESS;
+    for (uint8_t sec = 0; sec < RF08S_NUM_SECTORS && dupcnt; sec++) {
+        for (uint8_t kt = 0; kt < 2; kt++) {
+            rf08s_keylist_t *l = primary_list(&cands[sec][kt]);
+            rf08s_keylist_t *d = &cands[sec][kt].dups;
+            uint32_t cnt = 0;
+            for (uint32_t i = 0; i < l->cnt; i++) {
+                if (bsearch(&l->keys[i], dupset, dupcnt, sizeof(uint64_t), compare_uint64)) {
+                    cnt++;
+                }
+            }
+            if (cnt == 0) {
+                continue;
+            }
+
+            d->keys = calloc(cnt, sizeof(uint64_t));
+            if (d->keys == NULL) {
+                res = PM3_EMALLOC;
+                goto out;
+            }
+            for (uint32_t i = 0; i < l->cnt; i++) {
+                if (bsearch(&l->keys[i], dupset, dupcnt, sizeof(uint64_t), compare_uint64)) {
+                    d->keys[d->cnt++] = l->keys[i];
+                }
+            }
+            res = prioritize_keys(d, defkeys, defcnt, false);
+            if (res != PM3_SUCCESS) {
+                goto out;
+            }
+        }
+    }
+out:
+    free(dupset);
+    free(all);
+    return res;
+}
+
+//-----------------------------------------------------------------------------
+// sector thread pool
+//-----------------------------------------------------------------------------
+typedef struct {
+    uint32_t uid;
+    const iso14a_fm11rf08s_nonces_with_data_t *nonces;
+    const sector_t *known;
+    const uint64_t *defkeys;
+    uint32_t defcnt;
+    rf08s_candidates_t (*cands)[2];
+    uint32_t next_sector;
+    int res;
+} rf08s_pool_t;
+
+static int process_sector(rf08s_pool_t *pool, uint8_t sec) {
+
+    const iso14a_fm11rf08s_nonces_with_data_t *nonces = pool->nonces;
+    const sector_t *known = &pool->known[sec];
+    rf08s_candidates_t *c = pool->cands[sec];
+
+    if (known->foundKey[0] && known->foundKey[1]) {
+        return PM3_SUCCESS;
+    }
+
+    uint32_t nt_a = rf08s_nt(nonces, sec, 0);
+    uint32_t nt_b = rf08s_nt(nonces, sec, 1);
+    bool extra = (rf08s_real_sector(sec) == RF08S_EXTRA_SECTOR);
+    int res;
+
+    if (known->foundKey[0] == 0 && known->foundKey[1] == 0 && nt_a != nt_b) {
+        for (uint8_t kt = 0; kt < 2; kt++) {
+            res = generate_keys(pool->uid, rf08s_nt(nonces, sec, kt), bytes_to_num(nonces->nt_enc[sec][kt], 4), nonces->par_err[sec][kt], &c[kt].all);
+            if (res != PM3_SUCCESS) {
+                return res;
+            }
+        }
+
+        res = join_keys(nt_a, &c[0].all, nt_b, &c[1].all, &c[0].filtered, &c[1].filtered);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+
+        for (uint8_t kt = 0; kt < 2; kt++) {
+            res = prioritize_keys(&c[kt].filtered, pool->defkeys, pool->defcnt, extra);
+            if (res != PM3_SUCCESS) {
+                return res;
+            }
+        }
+        return PM3_SUCCESS;
+    }
+
+    // one key known or both keys identical
+    uint8_t kt = (known->foundKey[0]) ? 1 : 0;
+    res = generate_keys(pool->uid, rf08s_nt(nonces, sec, kt), bytes_to_num(nonces->nt_enc[sec][kt], 4), nonces->par_err[sec][kt], &c[kt].all);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+    return prioritize_keys(&c[kt].all, pool->defkeys, pool->defcnt, false);
+}
+
+static void *rf08s_worker(void *arg) {
+    rf08s_pool_t *pool = (rf08s_pool_t *)arg;
+
+    for (;;) {
+        uint32_t sec = __atomic_fetch_add(&pool->next_sector, 1, __ATOMIC_SEQ_CST);
+        if (sec >= RF08S_NUM_SECTORS) {
+            break;
+        }
+        int res = process_sector(pool, sec);
+        if (res != PM3_SUCCESS) {
+            __atomic_store_n(&pool->res, res, __ATOMIC_SEQ_CST);
+        }
+    }
+    return NULL;
+}
+
+// every worker runs its own lfsr_recovery32, keep to the memory cap of crapto1
+int rf08s_thread_count(void) {
+    int thread_count = num_CPUs();
+    if (thread_count > RECOVERY32_MAX_THREADS) {
+        thread_count = RECOVERY32_MAX_THREADS;
+    }
+    if (thread_count > RF08S_NUM_SECTORS) {
+        thread_count = RF08S_NUM_SECTORS;
+    }
+    return (thread_count < 1) ? 1 : thread_count;
+}
+
+int rf08s_generate_candidates(uint32_t uid, const iso14a_fm11rf08s_nonces_with_data_t *nonces,
+                              const sector_t *known, const uint64_t *defkeys, uint32_t defcnt,
+                              rf08s_candidates_t cands[RF08S_NUM_SECTORS][2]) {
+
+    memset(cands, 0, RF08S_NUM_SECTORS * 2 * sizeof(rf08s_candidates_t));
+    init_lfsr16_table();
+
+    // sorted copy for the default key lookups
+    uint64_t *sorted = calloc(defcnt + 1, sizeof(uint64_t));
+    if (sorted == NULL) {
+        return PM3_EMALLOC;
+    }
+    if (defcnt) {
+        memcpy(sorted, defkeys, defcnt * sizeof(uint64_t));
+        qsort(sorted, defcnt, sizeof(uint64_t), compare_uint64);
+    }
+
+    rf08s_pool_t pool = {
+        .uid = uid,
+        .nonces = nonces,
+        .known = known,
+        .defkeys = sorted,
+        .defcnt = defcnt,
+        .cands = cands,
+        .next_sector = 0,
+        .res = PM3_SUCCESS,
+    };
+
+    int thread_count = rf08s_thread_count();
+
+    pthread_t threads[thread_count];
+    int started = 0;
+    for (; started < thread_count; started++) {
+        if (pthread_create(&threads[started], NULL, rf08s_worker, (void *)&pool)) {
+            break;
+        }
+    }
+
+    // no thread at all, do the work here
+    if (started == 0) {
+        rf08s_worker(&pool);
+    }
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    int res = pool.res;
+    if (res == PM3_SUCCESS) {
+        res = find_duplicates(cands, sorted, defcnt);
+    }
+
+    free(sorted);
+    if (res != PM3_SUCCESS) {
+        rf08s_free_candidates(cands);
+    }
+    return res;
+}
+
+void rf08s_free_candidates(rf08s_candidates_t cands[RF08S_NUM_SECTORS][2]) {
+    for (uint8_t sec = 0; sec < RF08S_NUM_SECTORS; sec++) {
+        for (uint8_t kt = 0; kt < 2; kt++) {
+            free(cands[sec][kt].all.keys);
+            free(cands[sec][kt].filtered.keys);
+            free(cands[sec][kt].dups.keys);
+        }
+    }
+    memset(cands, 0, RF08S_NUM_SECTORS * 2 * sizeof(rf08s_candidates_t));
+}
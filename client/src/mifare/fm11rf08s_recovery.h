@@ -0,0 +1,57 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// FM11RF08S backdoored static encrypted nonce key recovery
+// (in-memory port of tools/mfc/card_only/staticnested_* tools)
+//-----------------------------------------------------------------------------
+
+#ifndef FM11RF08S_RECOVERY_H__
+#define FM11RF08S_RECOVERY_H__
+
+#include "common.h"
+#include "mifare.h"
+#include "mifare/mifarehost.h"
+
+// 16 user sectors + the backdoor only sector 32
+#define RF08S_NUM_SECTORS       (MIFARE_1K_MAXSECTOR + 1)
+#define RF08S_EXTRA_SECTOR      32
+
+typedef struct {
+    uint64_t *keys;
+    uint32_t cnt;
+} rf08s_keylist_t;
+
+typedef struct {
+    rf08s_keylist_t all;        // staticnested_1nt candidates
+    rf08s_keylist_t filtered;   // survivors of the keyA / keyB seed join
+    rf08s_keylist_t dups;       // candidates also found in another sector
+} rf08s_candidates_t;
+
+uint8_t rf08s_real_sector(uint8_t sec);
+uint32_t rf08s_nt(const iso14a_fm11rf08s_nonces_with_data_t *nonces, uint8_t sec, uint8_t keytype);
+
+// Generates the candidate lists of every sector / key type not yet in `known`, sectors
+// are spread over all CPUs. Default keys are moved to the front of the lists.
+int rf08s_thread_count(void);
+int rf08s_generate_candidates(uint32_t uid, const iso14a_fm11rf08s_nonces_with_data_t *nonces,
+                              const sector_t *known, const uint64_t *defkeys, uint32_t defcnt,
+                              rf08s_candidates_t cands[RF08S_NUM_SECTORS][2]);
+void rf08s_free_candidates(rf08s_candidates_t cands[RF08S_NUM_SECTORS][2]);
+
+// Keeps the candidates of `in` sharing the nonce seed of a known key of the other key type
+int rf08s_filter_1key(uint32_t nt_known, uint64_t key_known, uint32_t nt_target,
+                      const rf08s_keylist_t *in, rf08s_keylist_t *out);
+
+#endif
@@ -19,6 +19,9 @@
 #include "mfkey.h"
 
 #include "crapto1/crapto1.h"
+#include "crapto1/crypto1_bs.h"
+#include "commonutil.h"  // ARRAYLEN
+#include "util.h"
 
 // MIFARE
 int inline compare_uint64(const void *a, const void *b) {
@@ -96,29 +99,45 @@ uint32_t nonce2key(uint32_t uid, uint32_t nt, uint32_t nr, uint32_t ar, uint64_t
     return i;
 }
 
+// Candidate states of lfsr_recovery32() are rolled back to the key and checked against a second
+// authentication in batches of CRYPTO1_BS_LANES. ks[i * 3 + 2] is the keystream of the reader answer.
+static uint32_t mfkey32_next_batch(struct Crypto1State **t, uint32_t nr_enc, uint32_t uid_nt, uint64_t *keys) {
+    uint32_t n = 0;
+    for (; ((*t)->odd | (*t)->even) && n < CRYPTO1_BS_LANES; ++(*t)) {
+        lfsr_rollback_word(*t, 0, 0);
+        lfsr_rollback_word(*t, nr_enc, 1);
+        lfsr_rollback_word(*t, uid_nt, 0);
+        crypto1_get_lfsr(*t, &keys[n++]);
+    }
+    return n;
+}
+
 // recover key from 2 different reader responses on same tag challenge
 bool mfkey32(nonces_t *data, uint64_t *outputkey) {
     struct Crypto1State *s, *t;
     uint64_t outkey = 0;
-    uint64_t key = 0;     // recovered key
     bool isSuccess = false;
-    uint8_t counter = 0;
+    uint32_t counter = 0;
+    uint64_t keys[CRYPTO1_BS_LANES];
+    uint32_t ks[CRYPTO1_BS_LANES * 3];
 
     uint32_t p640 = prng_successor(data->nonce, 64);
-
-    s = lfsr_recovery32(data->ar ^ p640, 0);
-
-    for (t = s; t->odd | t->even; ++t) {
-        lfsr_rollback_word(t, 0, 0);
-        lfsr_rollback_word(t, data->nr, 1);
-        lfsr_rollback_word(t, data->cuid ^ data->nonce, 0);
-        crypto1_get_lfsr(t, &key);
-        crypto1_word(t, data->cuid ^ data->nonce, 0);
-        crypto1_word(t, data->nr2, 1);
-        if (data->ar2 == (crypto1_word(t, 0, 0) ^ p640)) {
-            outkey = key;
-            counter++;
-            if (counter == 20) break;
+    const crypto1_bs_word_t words[] = {
+        {data->cuid ^ data->nonce, false},
+        {data->nr2, true},
+        {0, false},
+    };
+
+    s = lfsr_recovery32_mt(data->ar ^ p640, 0, num_CPUs());
+
+    for (t = s; (t->odd | t->even) && (counter < 20);) {
+        uint32_t n = mfkey32_next_batch(&t, data->nr, data->cuid ^ data->nonce, keys);
+        crypto1_bs_keystream(keys, n, words, ARRAYLEN(words), ks);
+        for (uint32_t i = 0; i < n; i++) {
+            if (data->ar2 == (ks[i * 3 + 2] ^ p640)) {
+                outkey = keys[i];
+                counter++;
+            }
         }
     }
     isSuccess = (counter == 1);
@@ -132,26 +151,28 @@ bool mfkey32(nonces_t *data, uint64_t *outputkey) {
 bool mfkey32_moebius(nonces_t *data, uint64_t *outputkey) {
     struct Crypto1State *s, *t;
     uint64_t outkey  = 0;
-    uint64_t key     = 0; // recovered key
     bool isSuccess = false;
-    int counter = 0;
+    uint32_t counter = 0;
+    uint64_t keys[CRYPTO1_BS_LANES];
+    uint32_t ks[CRYPTO1_BS_LANES * 3];
     uint32_t p640 = prng_successor(data->nonce, 64);
     uint32_t p641 = prng_successor(data->nonce2, 64);
-
-    s = lfsr_recovery32(data->ar ^ p640, 0);
-
-    for (t = s; t->odd | t->even; ++t) {
-        lfsr_rollback_word(t, 0, 0);
-        lfsr_rollback_word(t, data->nr, 1);
-        lfsr_rollback_word(t, data->cuid ^ data->nonce, 0);
-        crypto1_get_lfsr(t, &key);
-
-        crypto1_word(t, data->cuid ^ data->nonce2, 0);
-        crypto1_word(t, data->nr2, 1);
-        if (data->ar2 == (crypto1_word(t, 0, 0) ^ p641)) {
-            outkey = key;
-            ++counter;
-            if (counter == 2) break;
+    const crypto1_bs_word_t words[] = {
+        {data->cuid ^ data->nonce2, false},
+        {data->nr2, true},
+        {0, false},
+    };
+
+    s = lfsr_recovery32_mt(data->ar ^ p640, 0, num_CPUs());
+
+    for (t = s; (t->odd | t->even) && (counter < 2);) {
+        uint32_t n = mfkey32_next_batch(&t, data->nr, data->cuid ^ data->nonce, keys);
+        crypto1_bs_keystream(keys, n, words, ARRAYLEN(words), ks);
+        for (uint32_t i = 0; i < n; i++) {
+            if (data->ar2 == (ks[i * 3 + 2] ^ p641)) {
+                outkey = keys[i];
+                ++counter;
+            }
         }
     }
     isSuccess  = (counter == 1);
@@ -166,6 +187,8 @@ bool mfkey32_nested(nonces_t *data, uint64_t *outputkey) {
     struct Crypto1State *s, *t;
     uint64_t key     = 0; // recovered key
     bool isSuccess = false;
+    uint64_t lfsrs[CRYPTO1_BS_LANES];
+    uint32_t ks[CRYPTO1_BS_LANES * 2];
 
     uint32_t uid = data->cuid;
     uint32_t nt = data->nonce;
@@ -175,16 +198,27 @@ bool mfkey32_nested(nonces_t *data, uint64_t *outputkey) {
     uint32_t ar_enc = data->ar;
     uint32_t ks0 = nt_enc ^ nt;
     uint32_t ks2 = ar_enc ^ ar;
-    s = lfsr_recovery32(ks0, uid ^ nt);
-    for (t = s; t->odd | t->even; ++t) {
-        crypto1_word(t, nr_enc, 1);
-        if (ks2 == crypto1_word(t, 0, 0)) {
-            lfsr_rollback_word(t, 0, 0);
-            lfsr_rollback_word(t, nr_enc, 1);
-            lfsr_rollback_word(t, uid ^ nt, 0);
-            crypto1_get_lfsr(t, &key);
-            isSuccess = true;
-            break;
+    const crypto1_bs_word_t words[] = {
+        {nr_enc, true},
+        {0, false},
+    };
+
+    s = lfsr_recovery32_mt(ks0, uid ^ nt, num_CPUs());
+    for (t = s; (t->odd | t->even) && (isSuccess == false);) {
+        // candidates are states after uid ^ nt, crypto1_get_lfsr() packs them the way crypto1_init() loads keys
+        struct Crypto1State *first = t;
+        uint32_t n = 0;
+        for (; (t->odd | t->even) && n < CRYPTO1_BS_LANES; ++t) {
+            crypto1_get_lfsr(t, &lfsrs[n++]);
+        }
+        crypto1_bs_keystream(lfsrs, n, words, ARRAYLEN(words), ks);
+        for (uint32_t i = 0; i < n; i++) {
+            if (ks2 == ks[i * 2 + 1]) {
+                lfsr_rollback_word(first + i, uid ^ nt, 0);
+                crypto1_get_lfsr(first + i, &key);
+                isSuccess = true;
+                break;
+            }
         }
     }
     *outputkey = (isSuccess) ? key : 0;
@@ -202,7 +236,7 @@ int mfkey64(nonces_t *data, uint64_t *outputkey) {
     // Extract the keystream from the messages
     ks2 = data->ar ^ prng_successor(data->nonce, 64);
     ks3 = data->at ^ prng_successor(data->nonce, 96);
-    revstate = lfsr_recovery64(ks2, ks3);
+    revstate = lfsr_recovery64_mt(ks2, ks3, num_CPUs());
     lfsr_rollback_word(revstate, 0, 0);
     lfsr_rollback_word(revstate, 0, 0);
     lfsr_rollback_word(revstate, data->nr, 1);
@@ -292,6 +292,11 @@ int mf_check_keys_fast_ex(uint8_t sectorsCnt, uint8_t firstChunk, uint8_t lastCh
     if ((singleSectorParams >> 15) & 1) {
         if (curr_keys) {
             uint64_t foo = bytes_to_num(resp.data.asBytes, 6);
+            uint8_t sec = mfSectorNum(singleSectorParams & 0xFF);
+            if (e_sector != NULL && sec < sectorsCnt) {
+                e_sector[sec].Key[(singleSectorParams >> 8) & 1] = foo;
+                e_sector[sec].foundKey[(singleSectorParams >> 8) & 1] = 1;
+            }
             PrintAndLogEx(NORMAL, "");
             PrintAndLogEx(SUCCESS, _GREEN_("Key %s for block %2i found: %012" PRIx64), (singleSectorParams >> 8) & 1 ? "B" : "A", singleSectorParams & 0xFF, foo);
             return PM3_SUCCESS;
@@ -19,6 +19,7 @@
 #include "pm3.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "proxmark3.h"
 #include "cmdmain.h"
@@ -28,7 +29,35 @@
 #include "comms.h"
 #include "preferences.h"
 
+// Any further device gets its own connection and sample buffers, so several threads can each drive one Proxmark3.
+// Preferences and the capabilities stay shared, and the first device must stay open the longest.
+static pm3_device_t *pm3_open_more(const char *port) {
+    pm3_device_t *dev = NewProxmarkDevice();
+    if (dev == NULL) {
+        return NULL;
+    }
+
+    SetCommunicationDevice(dev);
+    bool ok = OpenProxmark(&dev, port, false, 20, false, USART_BAUD_RATE);
+    if (ok && (TestProxmark(dev) != PM3_SUCCESS)) {
+        PrintAndLogEx(ERR, _RED_("ERROR:") " cannot communicate with the Proxmark3 on " _YELLOW_("%s"), port);
+        CloseProxmark(dev);
+        ok = false;
+    }
+    SetCommunicationDevice(NULL);
+
+    if (ok == false) {
+        FreeProxmarkDevice(dev);
+        return NULL;
+    }
+    return dev;
+}
+
 pm3_device_t *pm3_open(const char *port) {
+    if (g_session.pm3_present && (port != NULL)) {
+        return pm3_open_more(port);
+    }
+
     pm3_init();
     preferences_load();
     OpenProxmark(&g_session.current_device, port, false, 20, false, USART_BAUD_RATE);
@@ -37,17 +66,30 @@ pm3_device_t *pm3_open(const char *port) {
         CloseProxmark(g_session.current_device);
     }
 
-    if ((port != NULL) && (!g_session.pm3_present))
-        exit(EXIT_FAILURE);
+    if ((port != NULL) && (!g_session.pm3_present)) {
+        return NULL;
+    }
 
     if (!g_session.pm3_present) {
         PrintAndLogEx(INFO, _RED_("OFFLINE") " mode");
     }
-    // For now, there is no real device context:
     return g_session.current_device;
 }
 
 void pm3_close(pm3_device_t *dev) {
+    if ((dev != NULL) && (dev != g_session.current_device)) {
+        SetCommunicationDevice(dev);
+        if (dev->g_conn->run) {
+            clearCommandBuffer();
+            SendCommandNG(CMD_QUIT_SESSION, NULL, 0);
+            msleep(100); // Make sure command is sent before killing client
+            CloseProxmark(dev);
+        }
+        SetCommunicationDevice(NULL);
+        FreeProxmarkDevice(dev);
+        return;
+    }
+
     // Clean up the port
     if (g_session.pm3_present) {
         clearCommandBuffer();
@@ -55,21 +97,40 @@ void pm3_close(pm3_device_t *dev) {
         msleep(100); // Make sure command is sent before killing client
         CloseProxmark(dev);
     }
+    if (dev != NULL) {
+        free(dev->grabbed_output.ptr);
+        memset(&dev->grabbed_output, 0, sizeof(grabbed_output));
+        free(dev->grabbed_records.ptr);
+        memset(&dev->grabbed_records, 0, sizeof(grabbed_output));
+    }
     free_grabber();
 }
 
+// json records for the output grabbed without a device
+static bool g_capture_records = false;
+
+// Commands of the calling thread go to dev and the output is grabbed per device,
+// different devices can be used from different threads at the same time.
 int pm3_console(pm3_device_t *dev, const char *cmd, bool capture, bool quiet) {
-    // For now, there is no real device context:
-    (void) dev;
-    uint8_t prev_printAndLog = g_printAndLog;
+    uint8_t flags = g_printAndLog;
     if (capture) {
-        g_printAndLog |= PRINTANDLOG_GRAB;
+        flags |= PRINTANDLOG_GRAB;
+        if (pm3_capture_records_get(dev)) {
+            flags |= PRINTANDLOG_RECORDS;
+        }
     }
     if (quiet) {
-        g_printAndLog &= ~PRINTANDLOG_PRINT;
+        flags &= ~PRINTANDLOG_PRINT;
+    }
+    SetCommunicationDevice(dev);
+    if (dev != NULL) {
+        PrintAndLogRedirect(flags, &dev->grabbed_output, &dev->grabbed_records);
+    } else {
+        PrintAndLogRedirect(flags, &g_grabbed_output, &g_grabbed_records);
     }
     int ret = CommandReceived(cmd);
-    g_printAndLog = prev_printAndLog;
+    PrintAndLogRedirect(0, NULL, NULL);
+    SetCommunicationDevice(NULL);
     return ret;
 }
 
@@ -77,18 +138,40 @@ const char *pm3_name_get(pm3_device_t *dev) {
     return dev->g_conn->serial_port_name;
 }
 
-const char *pm3_grabbed_output_get(pm3_device_t *dev) {
-    if (g_grabbed_output.ptr != NULL) {
-        char *tmp = g_grabbed_output.ptr;
-        tmp[g_grabbed_output.size] = 0;
-        g_grabbed_output.idx = 0;
-        g_grabbed_output.size = 0;
+// Hands out the grab buffer itself, valid until the next pm3_console() on this device.
+// The buffer is kept, so the next capture doesn't start growing from scratch.
+static const char *grabbed_get(grabbed_output *out) {
+    if (out->ptr != NULL) {
+        char *tmp = out->ptr;
+        tmp[out->idx] = 0;
+        out->idx = 0;
         return tmp;
     } else {
         return "";
     }
 }
 
+const char *pm3_grabbed_output_get(pm3_device_t *dev) {
+    return grabbed_get((dev != NULL) ? &dev->grabbed_output : &g_grabbed_output);
+}
+
+const char *pm3_grabbed_records_get(pm3_device_t *dev) {
+    return grabbed_get((dev != NULL) ? &dev->grabbed_records : &g_grabbed_records);
+}
+
+bool pm3_capture_records_get(pm3_device_t *dev) {
+    return (dev != NULL) ? dev->capture_records : g_capture_records;
+}
+
+// records cost a json encoding per printed line, so captures only produce them on request
+void pm3_capture_records_set(pm3_device_t *dev, bool enable) {
+    if (dev != NULL) {
+        dev->capture_records = enable;
+    } else {
+        g_capture_records = enable;
+    }
+}
+
 pm3_device_t *pm3_get_current_dev(void) {
     return g_session.current_device;
 }
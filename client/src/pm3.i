@@ -1,4 +1,4 @@
-%module pm3
+%module(threads="1") pm3
 %{
 /* Include the header in the wrapper code */
 #include "pm3.h"
@@ -9,6 +9,12 @@
 %rename("%(strip:[pm3_])s") "";
 %feature("immutable","1") pm3_current_dev;
 
+#ifdef SWIGPYTHON
+    /* release the GIL in console() only, so threads can drive one device each */
+    %nothread;
+    %thread pm3::console;
+#endif
+
 #ifdef PYWRAP
     #include <Python.h>
     %typemap(default) bool capture {
@@ -29,7 +35,9 @@ typedef struct {
         pm3(char *port) {
 //            printf("SWIG pm3 constructor with port, open pm3\n");
             pm3_device_t * p = pm3_open(port);
-            p->script_embedded = 0;
+            if (p != NULL) {
+                p->script_embedded = 0;
+            }
             return p;
         }
         ~pm3() {
@@ -43,6 +51,8 @@ typedef struct {
         int console(char *cmd, bool capture = true, bool quiet = true);
         char const * const name;
         char const * const grabbed_output;
+        char const * const grabbed_records;
+        bool capture_records;
     }
 } pm3;
 //%nodefaultctor device;
@@ -2684,7 +2684,9 @@ SWIGINTERN int SWIG_lua_isnilstring(lua_State *L, int idx) {
 SWIGINTERN pm3 *new_pm3__SWIG_1(char *port) {
 //            printf("SWIG pm3 constructor with port, open pm3\n");
     pm3_device_t *p = pm3_open(port);
-    p->script_embedded = 0;
+    if (p != NULL) {
+        p->script_embedded = 0;
+    }
     return p;
 }
 SWIGINTERN void delete_pm3(pm3 *self) {
@@ -2849,6 +2851,79 @@ fail:
 }
 
 
+static int _wrap_pm3_grabbed_records_get(lua_State *L) {
+    int SWIG_arg = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    char *result = 0 ;
+
+    SWIG_check_num_args("pm3::grabbed_records", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3::grabbed_records", 1, "pm3 *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3, 0))) {
+        SWIG_fail_ptr("pm3_grabbed_records_get", 1, SWIGTYPE_p_pm3);
+    }
+
+    result = (char *)pm3_grabbed_records_get(arg1);
+    lua_pushstring(L, (const char *)result);
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
+static int _wrap_pm3_capture_records_set(lua_State *L) {
+    int SWIG_arg = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    bool arg2 ;
+
+    SWIG_check_num_args("pm3::capture_records", 2, 2)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3::capture_records", 1, "pm3 *");
+    if (!lua_isboolean(L, 2)) SWIG_fail_arg("pm3::capture_records", 2, "bool");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3, 0))) {
+        SWIG_fail_ptr("pm3_capture_records_set", 1, SWIGTYPE_p_pm3);
+    }
+
+    arg2 = (lua_toboolean(L, 2) != 0);
+    pm3_capture_records_set(arg1, arg2);
+
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
+static int _wrap_pm3_capture_records_get(lua_State *L) {
+    int SWIG_arg = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    bool result;
+
+    SWIG_check_num_args("pm3::capture_records", 1, 1)
+    if (!SWIG_isptrtype(L, 1)) SWIG_fail_arg("pm3::capture_records", 1, "pm3 *");
+
+    if (!SWIG_IsOK(SWIG_ConvertPtr(L, 1, (void **)&arg1, SWIGTYPE_p_pm3, 0))) {
+        SWIG_fail_ptr("pm3_capture_records_get", 1, SWIGTYPE_p_pm3);
+    }
+
+    result = (bool)pm3_capture_records_get(arg1);
+    lua_pushboolean(L, (int)(result != 0));
+    SWIG_arg++;
+    return SWIG_arg;
+
+fail:
+    SWIGUNUSED;
+    lua_error(L);
+    return 0;
+}
+
+
 static void swig_delete_pm3(void *obj) {
     pm3 *arg1 = (pm3 *) obj;
     delete_pm3(arg1);
@@ -2864,6 +2939,8 @@ static int _proxy__wrap_new_pm3(lua_State *L) {
 static swig_lua_attribute swig_pm3_attributes[] = {
     { "name", _wrap_pm3_name_get, SWIG_Lua_set_immutable },
     { "grabbed_output", _wrap_pm3_grabbed_output_get, SWIG_Lua_set_immutable },
+    { "grabbed_records", _wrap_pm3_grabbed_records_get, SWIG_Lua_set_immutable },
+    { "capture_records", _wrap_pm3_capture_records_get, _wrap_pm3_capture_records_set },
     {0, 0, 0}
 };
 static swig_lua_method swig_pm3_methods[] = {
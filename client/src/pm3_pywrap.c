@@ -9,6 +9,7 @@
 
 #define SWIG_VERSION 0x040201
 #define SWIGPYTHON
+#define SWIG_PYTHON_THREADS
 #define SWIG_PYTHON_DIRECTOR_NO_VTABLE
 
 /* -----------------------------------------------------------------------------
@@ -3258,7 +3259,9 @@ SWIG_AsCharPtrAndSize(PyObject *obj, char **cptr, size_t *psize, int *alloc) {
 SWIGINTERN pm3 *new_pm3__SWIG_1(char *port) {
 //            printf("SWIG pm3 constructor with port, open pm3\n");
     pm3_device_t *p = pm3_open(port);
-    p->script_embedded = 0;
+    if (p != NULL) {
+        p->script_embedded = 0;
+    }
     return p;
 }
 SWIGINTERN void delete_pm3(pm3 *self) {
@@ -3586,7 +3589,11 @@ SWIGINTERN PyObject *_wrap_pm3_console(PyObject *self, PyObject *args) {
         }
         arg4 = (bool)(val4);
     }
-    result = (int)pm3_console(arg1, arg2, arg3, arg4);
+    {
+        SWIG_PYTHON_THREAD_BEGIN_ALLOW;
+        result = (int)pm3_console(arg1, arg2, arg3, arg4);
+        SWIG_PYTHON_THREAD_END_ALLOW;
+    }
     resultobj = SWIG_From_int((int)(result));
     if (alloc2 == SWIG_NEWOBJ) free((char *)buf2);
     return resultobj;
@@ -3644,6 +3651,84 @@ fail:
 }
 
 
+SWIGINTERN PyObject *_wrap_pm3_grabbed_records_get(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    PyObject *swig_obj[1] ;
+    char *result = 0 ;
+
+    (void)self;
+    if (!args) SWIG_fail;
+    swig_obj[0] = args;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "pm3_grabbed_records_get" "', argument " "1"" of type '" "pm3 *""'");
+    }
+    arg1 = (pm3 *)(argp1);
+    result = (char *)pm3_grabbed_records_get(arg1);
+    resultobj = SWIG_FromCharPtr((const char *)result);
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_pm3_capture_records_set(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    bool arg2 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    bool val2 ;
+    int ecode2 = 0 ;
+    PyObject *swig_obj[2] ;
+
+    (void)self;
+    if (!SWIG_Python_UnpackTuple(args, "pm3_capture_records_set", 2, 2, swig_obj)) SWIG_fail;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "pm3_capture_records_set" "', argument " "1"" of type '" "pm3 *""'");
+    }
+    arg1 = (pm3 *)(argp1);
+    ecode2 = SWIG_AsVal_bool(swig_obj[1], &val2);
+    if (!SWIG_IsOK(ecode2)) {
+        SWIG_exception_fail(SWIG_ArgError(ecode2), "in method '" "pm3_capture_records_set" "', argument " "2"" of type '" "bool""'");
+    }
+    arg2 = (bool)(val2);
+    pm3_capture_records_set(arg1, arg2);
+    resultobj = SWIG_Py_Void();
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
+SWIGINTERN PyObject *_wrap_pm3_capture_records_get(PyObject *self, PyObject *args) {
+    PyObject *resultobj = 0;
+    pm3 *arg1 = (pm3 *) 0 ;
+    void *argp1 = 0 ;
+    int res1 = 0 ;
+    PyObject *swig_obj[1] ;
+    bool result;
+
+    (void)self;
+    if (!args) SWIG_fail;
+    swig_obj[0] = args;
+    res1 = SWIG_ConvertPtr(swig_obj[0], &argp1, SWIGTYPE_p_pm3, 0 |  0);
+    if (!SWIG_IsOK(res1)) {
+        SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "pm3_capture_records_get" "', argument " "1"" of type '" "pm3 *""'");
+    }
+    arg1 = (pm3 *)(argp1);
+    result = (bool)pm3_capture_records_get(arg1);
+    resultobj = PyBool_FromLong((long)(result));
+    return resultobj;
+fail:
+    return NULL;
+}
+
+
 SWIGINTERN PyObject *pm3_swigregister(PyObject *SWIGUNUSEDPARM(self), PyObject *args) {
     PyObject *obj;
     if (!SWIG_Python_UnpackTuple(args, "swigregister", 1, 1, &obj)) return NULL;
@@ -3661,6 +3746,9 @@ static PyMethodDef SwigMethods[] = {
     { "pm3_console", _wrap_pm3_console, METH_VARARGS, NULL},
     { "pm3_name_get", _wrap_pm3_name_get, METH_O, NULL},
     { "pm3_grabbed_output_get", _wrap_pm3_grabbed_output_get, METH_O, NULL},
+    { "pm3_grabbed_records_get", _wrap_pm3_grabbed_records_get, METH_O, NULL},
+    { "pm3_capture_records_set", _wrap_pm3_capture_records_set, METH_VARARGS, NULL},
+    { "pm3_capture_records_get", _wrap_pm3_capture_records_get, METH_O, NULL},
     { "pm3_swigregister", pm3_swigregister, METH_O, NULL},
     { "pm3_swiginit", pm3_swiginit, METH_VARARGS, NULL},
     { NULL, NULL, 0, NULL }
@@ -4150,6 +4238,9 @@ SWIG_init(void) {
 
     SWIG_InstallConstants(d, swig_const_table);
 
+
+    /* Initialize threading */
+    SWIG_PYTHON_INITIALIZE_THREADS;
 #if PY_VERSION_HEX >= 0x03000000
     return m;
 #else
@@ -34,7 +34,7 @@
 #include "emv/emvjson.h"
 #include "cmdparser.h"
 #include "cliparser.h"
-#include "uart/uart.h" // uart_reconfigure_timeouts
+#include "uart/uart.h" // UART_USB_CLIENT_RX_TIMEOUT_MS
 
 static int CmdHelp(const char *Cmd);
 static int setCmdHelp(const char *Cmd);
@@ -53,7 +53,7 @@ int preferences_load(void) {
     // Set all defaults
     g_session.client_debug_level = cdbOFF;
     //  g_session.device_debug_level = ddbOFF;
-    g_session.timeout = uart_get_timeouts();
+    g_session.timeout = GetCommunicationTimeout();
 
     g_session.window_changed = false;
     g_session.plot.x = 10;
@@ -962,7 +962,7 @@ static int setClientTimeout(const char *Cmd) {
     if (g_session.timeout != new_value) {
         showClientTimeoutState();
         g_session.timeout = new_value;
-        uart_reconfigure_timeouts(new_value);
+        SetCommunicationTimeout(new_value);
         showClientTimeoutState();
         preferences_save();
     } else {
@@ -338,7 +338,9 @@ void SliderWidget::moveEvent(QMoveEvent *event) {
 void ProxWidget::applyOperation() {
     //printf("ApplyOperation()");
     //g_saveState_gb = save_bufferS32(g_GraphBuffer, g_GraphTraceLen);
+    graph_lock();
     memcpy(g_GraphBuffer, g_OverlayBuffer, sizeof(int) * g_GraphTraceLen);
+    graph_unlock();
     RepaintGraphWindow();
 }
 void ProxWidget::stickOperation() {
@@ -346,21 +348,27 @@ void ProxWidget::stickOperation() {
     //printf("stickOperation()");
 }
 void ProxWidget::vchange_autocorr(int v) {
+    graph_lock();
     int ans = AutoCorrelate(g_GraphBuffer, g_OverlayBuffer, g_GraphTraceLen, v, true, false);
+    graph_unlock();
     if (g_debugMode) printf("vchange_autocorr(w:%d): %d\n", v, ans);
     g_useOverlays = true;
     RepaintGraphWindow();
 }
 void ProxWidget::vchange_askedge(int v) {
     //extern int AskEdgeDetect(const int *in, int *out, int len, int threshold);
+    graph_lock();
     int ans = AskEdgeDetect(g_GraphBuffer, g_OverlayBuffer, g_GraphTraceLen, v);
+    graph_unlock();
     if (g_debugMode) printf("vchange_askedge(w:%d)%d\n", v, ans);
     g_useOverlays = true;
     RepaintGraphWindow();
 }
 void ProxWidget::vchange_dthr_up(int v) {
     int down = opsController->horizontalSlider_dirthr_down->value();
+    graph_lock();
     directionalThreshold(g_GraphBuffer, g_OverlayBuffer, g_GraphTraceLen, v, down);
+    graph_unlock();
     //printf("vchange_dthr_up(%d)", v);
     g_useOverlays = true;
     RepaintGraphWindow();
@@ -368,7 +376,9 @@ void ProxWidget::vchange_dthr_up(int v) {
 void ProxWidget::vchange_dthr_down(int v) {
     //printf("vchange_dthr_down(%d)", v);
     int up = opsController->horizontalSlider_dirthr_up->value();
+    graph_lock();
     directionalThreshold(g_GraphBuffer, g_OverlayBuffer, g_GraphTraceLen, v, up);
+    graph_unlock();
     g_useOverlays = true;
     RepaintGraphWindow();
 }
@@ -434,7 +444,7 @@ ProxWidget::ProxWidget(QWidget *parent, ProxGuiQT *master) : QWidget(parent) {
     QObject::connect(plot, SIGNAL(graphStartChanged(uint32_t)), this, SLOT(updateNavSlider(void)));
 
     // plot window title
-    QString pt = QString("[*]Plot [ %1 ]").arg(g_conn.serial_port_name);
+    QString pt = QString("[*]Plot [ %1 ]").arg(GetCommunicationConn()->serial_port_name);
     setWindowTitle(pt);
 
     // shows plot window on the screen.
@@ -448,7 +458,7 @@ ProxWidget::ProxWidget(QWidget *parent, ProxGuiQT *master) : QWidget(parent) {
     }
 
     // Overlays / slider window title
-    QString ct = QString("[*]Slider [ %1 ]").arg(g_conn.serial_port_name);
+    QString ct = QString("[*]Slider [ %1 ]").arg(GetCommunicationConn()->serial_port_name);
     controlWidget->setWindowTitle(ct);
 
     // The hide/show event functions should take care of this.
@@ -1016,6 +1026,9 @@ void Plot::paintEvent(QPaintEvent *event) {
     //Black foreground
     painter.fillRect(plotRect, BLACK);
 
+    // the buffers may be moved by the client thread when a capture grows them
+    graph_lock();
+
     //init graph variables
     setMaxAndStart(g_GraphBuffer, g_GraphTraceLen, plotRect);
     //appendMax(g_OperationBuffer, g_GraphTraceLen, plotRect);
@@ -1059,6 +1072,8 @@ void Plot::paintEvent(QPaintEvent *event) {
     //Draw annotations
     drawAnnotations(infoRect, &painter);
 
+    graph_unlock();
+
     if (startMaxOld != startMax) {
         emit startMaxChanged(startMax);
     }
@@ -1225,9 +1240,11 @@ void Plot::Trim(void) {
     }
     g_DemodStartIdx -= lref;
 
+    graph_lock();
     for (uint32_t i = lref; i < rref; ++i) {
         g_GraphBuffer[i - lref] = g_GraphBuffer[i];
     }
+    graph_unlock();
 
     g_GraphTraceLen = rref - lref;
     g_GraphStart = 0;
@@ -1451,41 +1468,49 @@ void Plot::keyPressEvent(QKeyEvent *event) {
             break;
 
         case Qt::Key_Equal:
+            graph_lock();
             if (event->modifiers() & Qt::ControlModifier) {
                 g_OperationBuffer[g_MarkerA.pos] += 5;
             } else {
                 g_OperationBuffer[g_MarkerA.pos] += 1;
             }
+            graph_unlock();
 
             RepaintGraphWindow();
             break;
 
         case Qt::Key_Minus:
+            graph_lock();
             if (event->modifiers() & Qt::ControlModifier) {
                 g_OperationBuffer[g_MarkerA.pos] -= 5;
             } else {
                 g_OperationBuffer[g_MarkerA.pos] -= 1;
             }
+            graph_unlock();
 
             RepaintGraphWindow();
             break;
 
         case Qt::Key_Plus:
+            graph_lock();
             if (event->modifiers() & Qt::ControlModifier) {
                 g_GraphBuffer[g_MarkerA.pos] += 5;
             } else {
                 g_GraphBuffer[g_MarkerA.pos] += 1;
             }
+            graph_unlock();
 
             RepaintGraphWindow();
             break;
 
         case Qt::Key_Underscore:
+            graph_lock();
             if (event->modifiers() & Qt::ControlModifier) {
                 g_GraphBuffer[g_MarkerA.pos] -= 5;
             } else {
                 g_GraphBuffer[g_MarkerA.pos] -= 1;
             }
+            graph_unlock();
 
             RepaintGraphWindow();
             break;
@@ -243,7 +243,7 @@ static const char *prompt_net = "";
 static void prompt_set(void) {
     if (g_session.pm3_present) {
 
-        switch (g_conn.send_via_ip) {
+        switch (GetCommunicationConn()->send_via_ip) {
             case PM3_TCPv4:
                 prompt_net = PROXPROMPT_NET_TCPV4;
                 break;
@@ -263,7 +263,7 @@ static void prompt_set(void) {
                 break;
         }
 
-        if (g_conn.send_via_fpc_usart)
+        if (GetCommunicationConn()->send_via_fpc_usart)
             prompt_dev = PROXPROMPT_DEV_FPC;
         else
             prompt_dev = PROXPROMPT_DEV_USB;
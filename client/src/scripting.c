@@ -80,7 +80,7 @@ static int l_fast_push_mode(lua_State *L) {
 
     bool enable = lua_toboolean(L, 1);
 
-    g_conn.block_after_ACK = enable;
+    GetCommunicationConn()->block_after_ACK = enable;
 
     // Disable fast mode and send a dummy command to make it effective
     if (enable == false) {
@@ -661,7 +661,6 @@ static int l_crc16legic(lua_State *L) {
     const char *p_uid = luaL_checklstring(L, 2, &uidsize);
     uint16_t uidcrc = CRC8Legic((uint8_t *)p_uid, uidsize);
 
-    init_table(CRC_LEGIC_16);
     uint16_t retval = crc16_legic((uint8_t *)p_hexstr, hexsize, uidcrc);
     lua_pushinteger(L, retval);
     return 1;
@@ -62,6 +62,17 @@ void uart_close(const serial_port sp);
  */
 int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen);
 
+/* Waits up to the receive timeout for data from the given serial port.
+ * Returns early, with PM3_ENODATA, when uart_wakeup() is called.
+ *
+ * Returns PM3_SUCCESS if there is data to uart_receive().
+ */
+int uart_wait(const serial_port sp);
+
+/* Interrupts a uart_wait() on the given serial port, callable from any thread.
+ */
+void uart_wakeup(const serial_port sp);
+
 /* Sends a buffer to a given serial port.
  *   pbtTx: A pointer to a buffer containing the data to send.
  *   len: The amount of data to be sent.
@@ -76,13 +87,13 @@ bool uart_set_speed(serial_port sp, const uint32_t uiPortSpeed);
  */
 uint32_t uart_get_speed(const serial_port sp);
 
-/* Reconfigure timeouts (ms)
+/* Reconfigure timeouts (ms) of one port, applied on its next receive
  */
-int uart_reconfigure_timeouts(uint32_t value);
+int uart_reconfigure_timeouts(serial_port sp, uint32_t value);
 
-/* Get timeouts (ms)
+/* Get timeouts (ms) of one port, 0 when no port is open
  */
-uint32_t uart_get_timeouts(void);
+uint32_t uart_get_timeouts(const serial_port sp);
 
 /* Specify the outbound address and port for TCP/UDP connections
  */
@@ -60,29 +60,32 @@ typedef struct {
     term_info tiOld;  // Terminal info before using the port
     term_info tiNew;  // Terminal info during the transaction
     RingBuffer *udpBuffer;
+    int wake_fd[2];   // self pipe, lets uart_wakeup() interrupt uart_wait()
+    struct timeval timeout;       // see pm3_cmd.h
+    uint32_t newtimeout_value;
+    bool newtimeout_pending;      // applied by the next uart_wait() / uart_receive()
+    uint8_t rx_empty_counter;
 } serial_port_unix_t_t;
 
-// see pm3_cmd.h
-struct timeval timeout = {
-    .tv_sec  = 0, // 0 second
-    .tv_usec = UART_FPC_CLIENT_RX_TIMEOUT_MS * 1000
-};
-
-static uint32_t newtimeout_value = 0;
-static bool newtimeout_pending = false;
-static uint8_t rx_empty_counter = 0;
-
-int uart_reconfigure_timeouts(uint32_t value) {
-    newtimeout_value = value;
-    newtimeout_pending = true;
+int uart_reconfigure_timeouts(serial_port sp, uint32_t value) {
+    if (sp == NULL || sp == INVALID_SERIAL_PORT || sp == CLAIMED_SERIAL_PORT) {
+        return PM3_EINVARG;
+    }
+    serial_port_unix_t_t *spu = (serial_port_unix_t_t *)sp;
+    spu->newtimeout_value = value;
+    spu->newtimeout_pending = true;
     return PM3_SUCCESS;
 }
 
-uint32_t uart_get_timeouts(void) {
-    return newtimeout_value;
+uint32_t uart_get_timeouts(const serial_port sp) {
+    if (sp == NULL || sp == INVALID_SERIAL_PORT || sp == CLAIMED_SERIAL_PORT) {
+        return 0;
+    }
+    return ((const serial_port_unix_t_t *)sp)->newtimeout_value;
 }
 
 serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
+    communication_arg_t *conn = GetCommunicationConn();
     serial_port_unix_t_t *sp = calloc(sizeof(serial_port_unix_t_t), sizeof(uint8_t));
 
     if (sp == 0) {
@@ -91,11 +94,14 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
     }
 
     sp->udpBuffer = NULL;
-    rx_empty_counter = 0;
+    sp->wake_fd[0] = -1;
+    sp->wake_fd[1] = -1;
+    sp->rx_empty_counter = 0;
     // init timeouts
-    timeout.tv_usec = UART_FPC_CLIENT_RX_TIMEOUT_MS * 1000;
-    g_conn.send_via_local_ip = false;
-    g_conn.send_via_ip = PM3_NONE;
+    sp->timeout.tv_sec = 0;
+    sp->timeout.tv_usec = UART_FPC_CLIENT_RX_TIMEOUT_MS * 1000;
+    conn->send_via_local_ip = false;
+    conn->send_via_ip = PM3_NONE;
 
     char *prefix = str_dup(pcPortName);
     if (prefix == NULL) {
@@ -133,7 +139,7 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
             return INVALID_SERIAL_PORT;
         }
 
-        timeout.tv_usec = UART_NET_CLIENT_RX_TIMEOUT_MS * 1000;
+        sp->timeout.tv_usec = UART_NET_CLIENT_RX_TIMEOUT_MS * 1000;
 
         // find the "bind" option
         char *bindAddrPortStr = strstr(addrPortStr, ",bind=");
@@ -182,7 +188,7 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
             return INVALID_SERIAL_PORT;
         }
 
-        g_conn.send_via_ip = isIPv6 ? (isTCP ? PM3_TCPv6 : PM3_UDPv6) : (isTCP ? PM3_TCPv4 : PM3_UDPv4);
+        conn->send_via_ip = isIPv6 ? (isTCP ? PM3_TCPv6 : PM3_UDPv6) : (isTCP ? PM3_TCPv4 : PM3_UDPv4);
         portStr = (portStr == NULL) ? "18888" : portStr;
 
         struct addrinfo info;
@@ -195,7 +201,7 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
         if ((strstr(addrStr, "localhost") != NULL) ||
                 (strstr(addrStr, "127.0.0.1") != NULL) ||
                 (strstr(addrStr, "::1") != NULL)) {
-            g_conn.send_via_local_ip = true;
+            conn->send_via_local_ip = true;
         }
 
         int s = getaddrinfo(addrStr, portStr, &info, &addr);
@@ -305,7 +311,7 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
 
         sp->fd = sfd;
 
-        g_conn.send_via_ip = PM3_NONE;
+        conn->send_via_ip = PM3_NONE;
         return sp;
 #else // HAVE_BLUEZ
         PrintAndLogEx(ERR, "Sorry, this client doesn't support native Bluetooth addresses");
@@ -321,7 +327,7 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
         free(prefix);
 
         // we must use max timeout!
-        timeout.tv_usec = UART_NET_CLIENT_RX_TIMEOUT_MS * 1000;
+        sp->timeout.tv_usec = UART_NET_CLIENT_RX_TIMEOUT_MS * 1000;
 
         size_t servernameLen = (strlen(pcPortName) - 7) + 1;
         char serverNameBuf[servernameLen];
@@ -353,7 +359,7 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
 
         sp->fd = localsocket;
 
-        g_conn.send_via_ip = PM3_NONE;
+        conn->send_via_ip = PM3_NONE;
         return sp;
     }
 
@@ -443,8 +449,8 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
             return INVALID_SERIAL_PORT;
         }
     }
-    g_conn.uart_speed = uart_get_speed(sp);
-    g_conn.send_via_ip = PM3_NONE;
+    conn->uart_speed = uart_get_speed(sp);
+    conn->send_via_ip = PM3_NONE;
     return sp;
 }
 
@@ -466,19 +472,79 @@ void uart_close(const serial_port sp) {
         //PrintAndLogEx(ERR, "UART error while closing port");
     }
     RingBuf_destroy(spu->udpBuffer);
+    if (spu->wake_fd[0] >= 0) {
+        close(spu->wake_fd[0]);
+        close(spu->wake_fd[1]);
+    }
     close(spu->fd);
     free(sp);
 }
 
+int uart_wait(const serial_port sp) {
+    serial_port_unix_t_t *spu = (serial_port_unix_t_t *)sp;
+
+    if (spu->udpBuffer != NULL && RingBuf_isEmpty(spu->udpBuffer) == false) {
+        return PM3_SUCCESS;
+    }
+
+    // created on first use, only the communication thread waits
+    if (__atomic_load_n(&spu->wake_fd[1], __ATOMIC_ACQUIRE) < 0) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            // can't be woken up, let uart_receive() wait instead
+            return PM3_SUCCESS;
+        }
+        fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+        spu->wake_fd[0] = fds[0];
+        __atomic_store_n(&spu->wake_fd[1], fds[1], __ATOMIC_RELEASE);
+    }
+
+    if (spu->newtimeout_pending) {
+        spu->timeout.tv_usec = spu->newtimeout_value * 1000;
+        spu->newtimeout_pending = false;
+    }
+
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(spu->fd, &rfds);
+    FD_SET(spu->wake_fd[0], &rfds);
+    struct timeval tv = spu->timeout;
+    int res = select(MAX(spu->fd, spu->wake_fd[0]) + 1, &rfds, NULL, NULL, &tv);
+
+    // Read error
+    if (res < 0) {
+        return (errno == EINTR) ? PM3_ENODATA : PM3_EIO;
+    }
+
+    if (FD_ISSET(spu->wake_fd[0], &rfds)) {
+        uint8_t dummy[16];
+        while (read(spu->wake_fd[0], dummy, sizeof(dummy)) > 0) {}
+    }
+
+    return FD_ISSET(spu->fd, &rfds) ? PM3_SUCCESS : PM3_ENODATA;
+}
+
+void uart_wakeup(const serial_port sp) {
+    serial_port_unix_t_t *spu = (serial_port_unix_t_t *)sp;
+    int fd = __atomic_load_n(&spu->wake_fd[1], __ATOMIC_ACQUIRE);
+    if (fd >= 0) {
+        uint8_t b = 0;
+        // a full pipe is already a pending wake up
+        ssize_t res = write(fd, &b, sizeof(b));
+        (void) res;
+    }
+}
+
 int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen) {
     uint32_t byteCount;  // FIONREAD returns size on 32b
     fd_set rfds;
     struct timeval tv;
-    const serial_port_unix_t_t *spu = (serial_port_unix_t_t *)sp;
+    serial_port_unix_t_t *spu = (serial_port_unix_t_t *)sp;
 
-    if (newtimeout_pending) {
-        timeout.tv_usec = newtimeout_value * 1000;
-        newtimeout_pending = false;
+    if (spu->newtimeout_pending) {
+        spu->timeout.tv_usec = spu->newtimeout_value * 1000;
+        spu->newtimeout_pending = false;
     }
     // Reset the output count
     *pszRxLen = 0;
@@ -505,7 +571,7 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
         // Reset file descriptor
         FD_ZERO(&rfds);
         FD_SET(spu->fd, &rfds);
-        tv = timeout;
+        tv = spu->timeout;
         res = select(spu->fd + 1, &rfds, NULL, NULL, &tv);
 
         // Read error
@@ -535,12 +601,12 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
             // select() > 0 && byteCount > 0 ===> data available
             // select() > 0 && byteCount always equals to 0 ===> maybe disconnected
             // This happens when TCP connection is lost
-            rx_empty_counter++;
-            if (rx_empty_counter > 3) {
+            spu->rx_empty_counter++;
+            if (spu->rx_empty_counter > 3) {
                 return PM3_ENOTTY;
             }
         } else {
-            rx_empty_counter = 0;
+            spu->rx_empty_counter = 0;
         }
 
         // For UDP connection, put the incoming data into the buffer and handle them in the next round
@@ -599,7 +665,7 @@ int uart_send(const serial_port sp, const uint8_t *pbtTx, const uint32_t len) {
         // Reset file descriptor
         FD_ZERO(&rfds);
         FD_SET(spu->fd, &rfds);
-        tv = timeout;
+        tv = spu->timeout;
         int res = select(spu->fd + 1, NULL, &rfds, NULL, &tv);
 
         // Write error
@@ -723,7 +789,7 @@ bool uart_set_speed(serial_port sp, const uint32_t uiPortSpeed) {
 
     bool result = tcsetattr(spu->fd, TCSANOW, &ti) != -1;
     if (result) {
-        g_conn.uart_speed = uiPortSpeed;
+        GetCommunicationConn()->uart_speed = uiPortSpeed;
     }
     return result;
 }
@@ -39,39 +39,40 @@ typedef struct {
     COMMTIMEOUTS ct;       // Serial port time-out configuration
     SOCKET hSocket;        // Socket handle
     RingBuffer *udpBuffer; // Buffer for UDP
+    struct timeval timeout; // this is for TCP connection
+    uint32_t newtimeout_value;
+    bool newtimeout_pending;
+    uint8_t rx_empty_counter;
 } serial_port_windows_t;
 
-// this is for TCP connection
-struct timeval timeout = {
-    .tv_sec  = 0, // 0 second
-    .tv_usec = UART_NET_CLIENT_RX_TIMEOUT_MS * 1000
-};
-
-uint32_t newtimeout_value = 0;
-bool newtimeout_pending = false;
-uint8_t rx_empty_counter = 0;
-
-int uart_reconfigure_timeouts(uint32_t value) {
-    newtimeout_value = value;
-    newtimeout_pending = true;
+int uart_reconfigure_timeouts(serial_port sp, uint32_t value) {
+    if (sp == NULL || sp == INVALID_SERIAL_PORT || sp == CLAIMED_SERIAL_PORT) {
+        return PM3_EINVARG;
+    }
+    serial_port_windows_t *spw = (serial_port_windows_t *)sp;
+    spw->newtimeout_value = value;
+    spw->newtimeout_pending = true;
     return PM3_SUCCESS;
 }
 
-uint32_t uart_get_timeouts(void) {
-    return newtimeout_value;
+uint32_t uart_get_timeouts(const serial_port sp) {
+    if (sp == NULL || sp == INVALID_SERIAL_PORT || sp == CLAIMED_SERIAL_PORT) {
+        return 0;
+    }
+    return ((const serial_port_windows_t *)sp)->newtimeout_value;
 }
 
 static int uart_reconfigure_timeouts_polling(serial_port sp) {
-    if (newtimeout_pending == false) {
+    serial_port_windows_t *spw = (serial_port_windows_t *)sp;
+    if (spw->newtimeout_pending == false) {
         return PM3_SUCCESS;
     }
-    newtimeout_pending = false;
+    spw->newtimeout_pending = false;
 
-    serial_port_windows_t *spw = (serial_port_windows_t *)sp;
-    spw->ct.ReadIntervalTimeout         = newtimeout_value;
+    spw->ct.ReadIntervalTimeout         = spw->newtimeout_value;
     spw->ct.ReadTotalTimeoutMultiplier  = 0;
-    spw->ct.ReadTotalTimeoutConstant    = newtimeout_value;
-    spw->ct.WriteTotalTimeoutMultiplier = newtimeout_value;
+    spw->ct.ReadTotalTimeoutConstant    = spw->newtimeout_value;
+    spw->ct.WriteTotalTimeoutMultiplier = spw->newtimeout_value;
     spw->ct.WriteTotalTimeoutConstant   = 0;
 
     if (!SetCommTimeouts(spw->hPort, &spw->ct)) {
@@ -84,6 +85,7 @@ static int uart_reconfigure_timeouts_polling(serial_port sp) {
 }
 
 serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
+    communication_arg_t *conn = GetCommunicationConn();
     char acPortName[255] = {0};
     serial_port_windows_t *sp = calloc(sizeof(serial_port_windows_t), sizeof(uint8_t));
 
@@ -95,9 +97,11 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
     sp->hSocket = INVALID_SOCKET; // default: serial port
 
     sp->udpBuffer = NULL;
-    rx_empty_counter = 0;
-    g_conn.send_via_local_ip = false;
-    g_conn.send_via_ip = PM3_NONE;
+    sp->rx_empty_counter = 0;
+    sp->timeout.tv_sec = 0;
+    sp->timeout.tv_usec = UART_NET_CLIENT_RX_TIMEOUT_MS * 1000;
+    conn->send_via_local_ip = false;
+    conn->send_via_ip = PM3_NONE;
 
     char *prefix = str_dup(pcPortName);
     if (prefix == NULL) {
@@ -127,7 +131,7 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
             return INVALID_SERIAL_PORT;
         }
 
-        timeout.tv_usec = UART_NET_CLIENT_RX_TIMEOUT_MS * 1000;
+        sp->timeout.tv_usec = UART_NET_CLIENT_RX_TIMEOUT_MS * 1000;
 
         // find the "bind" option
         char *bindAddrPortStr = strstr(addrPortStr, ",bind=");
@@ -176,7 +180,7 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
             return INVALID_SERIAL_PORT;
         }
 
-        g_conn.send_via_ip = isIPv6 ? (isTCP ? PM3_TCPv6 : PM3_UDPv6) : (isTCP ? PM3_TCPv4 : PM3_UDPv4);
+        conn->send_via_ip = isIPv6 ? (isTCP ? PM3_TCPv6 : PM3_UDPv6) : (isTCP ? PM3_TCPv4 : PM3_UDPv4);
         portStr = (portStr == NULL) ? "18888" : portStr;
 
         WSADATA wsaData;
@@ -199,7 +203,7 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
         if ((strstr(addrStr, "localhost") != NULL) ||
                 (strstr(addrStr, "127.0.0.1") != NULL) ||
                 (strstr(addrStr, "::1") != NULL)) {
-            g_conn.send_via_local_ip = true;
+            conn->send_via_local_ip = true;
         }
 
         int s = getaddrinfo(addrStr, portStr, &info, &addr);
@@ -298,7 +302,7 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
         return INVALID_SERIAL_PORT;
     }
 
-    uart_reconfigure_timeouts(UART_FPC_CLIENT_RX_TIMEOUT_MS);
+    uart_reconfigure_timeouts(sp, UART_FPC_CLIENT_RX_TIMEOUT_MS);
     uart_reconfigure_timeouts_polling(sp);
 
     if (!uart_set_speed(sp, speed)) {
@@ -310,8 +314,8 @@ serial_port uart_open(const char *pcPortName, uint32_t speed, bool slient) {
             return INVALID_SERIAL_PORT;
         }
     }
-    g_conn.uart_speed = uart_get_speed(sp);
-    g_conn.send_via_ip = PM3_NONE;
+    conn->uart_speed = uart_get_speed(sp);
+    conn->send_via_ip = PM3_NONE;
     return sp;
 }
 
@@ -328,6 +332,16 @@ void uart_close(const serial_port sp) {
     free(sp);
 }
 
+// no wake up handle here, uart_receive() keeps waiting for its own timeout
+int uart_wait(const serial_port sp) {
+    (void) sp;
+    return PM3_SUCCESS;
+}
+
+void uart_wakeup(const serial_port sp) {
+    (void) sp;
+}
+
 bool uart_set_speed(serial_port sp, const uint32_t uiPortSpeed) {
     serial_port_windows_t *spw = (serial_port_windows_t *)sp;
 
@@ -351,7 +365,7 @@ bool uart_set_speed(serial_port sp, const uint32_t uiPortSpeed) {
     bool result = SetCommState(spw->hPort, &spw->dcb);
     PurgeComm(spw->hPort, PURGE_RXABORT | PURGE_RXCLEAR);
     if (result)
-        g_conn.uart_speed = uiPortSpeed;
+        GetCommunicationConn()->uart_speed = uiPortSpeed;
 
     return result;
 }
@@ -365,7 +379,7 @@ uint32_t uart_get_speed(const serial_port sp) {
 }
 
 int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen) {
-    const serial_port_windows_t *spw = (serial_port_windows_t *)sp;
+    serial_port_windows_t *spw = (serial_port_windows_t *)sp;
     if (spw->hSocket == INVALID_SOCKET) {
         // serial port
         uart_reconfigure_timeouts_polling(sp);
@@ -387,9 +401,9 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
         fd_set rfds;
         struct timeval tv;
 
-        if (newtimeout_pending) {
-            timeout.tv_usec = newtimeout_value * 1000;
-            newtimeout_pending = false;
+        if (spw->newtimeout_pending) {
+            spw->timeout.tv_usec = spw->newtimeout_value * 1000;
+            spw->newtimeout_pending = false;
         }
         // Reset the output count
         *pszRxLen = 0;
@@ -416,7 +430,7 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
             // Reset file descriptor
             FD_ZERO(&rfds);
             FD_SET(spw->hSocket, &rfds);
-            tv = timeout;
+            tv = spw->timeout;
             // the first argument nfds is ignored in Windows
             res = select(0, &rfds, NULL, NULL, &tv);
 
@@ -447,12 +461,12 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
                 // select() > 0 && byteCount > 0 ===> data available
                 // select() > 0 && byteCount always equals to 0 ===> maybe disconnected
                 // This happens when TCP connection is lost
-                rx_empty_counter++;
-                if (rx_empty_counter > 3) {
+                spw->rx_empty_counter++;
+                if (spw->rx_empty_counter > 3) {
                     return PM3_ENOTTY;
                 }
             } else {
-                rx_empty_counter = 0;
+                spw->rx_empty_counter = 0;
             }
 
             // For UDP connection, put the incoming data into the buffer and handle them in the next round
@@ -524,7 +538,7 @@ int uart_send(const serial_port sp, const uint8_t *p_tx, const uint32_t len) {
             // Reset file descriptor
             FD_ZERO(&wfds);
             FD_SET(spw->hSocket, &wfds);
-            tv = timeout;
+            tv = spw->timeout;
             // the first argument nfds is ignored in Windows
             int res = select(0, NULL, &wfds, NULL, &tv);
 
@@ -36,6 +36,7 @@
 #include "util.h"
 #include "proxmark3.h"  // PROXLOG
 #include "fileutils.h"
+#include "jansson.h"
 #include "pm3_cmd.h"
 
 #ifdef _WIN32
@@ -173,26 +174,127 @@ void free_grabber(void) {
     g_grabbed_output.ptr = NULL;
     g_grabbed_output.size = 0;
     g_grabbed_output.idx = 0;
+    free(g_grabbed_records.ptr);
+    g_grabbed_records.ptr = NULL;
+    g_grabbed_records.size = 0;
+    g_grabbed_records.idx = 0;
 }
 
-static void fill_grabber(const char *string) {
-    if (g_grabbed_output.ptr == NULL || g_grabbed_output.size - g_grabbed_output.idx < MAX_PRINT_BUFFER) {
-        char *tmp = realloc(g_grabbed_output.ptr, g_grabbed_output.size + MAX_PRINT_BUFFER);
+// Output routing of a thread running pm3_console(), so each device grabs its own output.
+// NULL means the thread follows g_printAndLog and grabs into g_grabbed_output / g_grabbed_records
+static __thread grabbed_output *redirect_output = NULL;
+static __thread grabbed_output *redirect_records = NULL;
+static __thread uint8_t redirect_flags = 0;
+
+void PrintAndLogRedirect(uint8_t flags, grabbed_output *grab, grabbed_output *records) {
+    redirect_flags = flags;
+    redirect_output = grab;
+    redirect_records = records;
+}
+
+// so worker threads of a command can print where the thread running pm3_console() does
+void PrintAndLogRedirectGet(uint8_t *flags, grabbed_output **grab, grabbed_output **records) {
+    *flags = redirect_flags;
+    *grab = redirect_output;
+    *records = redirect_records;
+}
+
+static uint8_t printandlog_flags(void) {
+    return (redirect_output != NULL) ? redirect_flags : g_printAndLog;
+}
+
+// Appends len bytes and keeps the buffer NUL terminated.
+// The buffer doubles when full, so grabbing a long output stays linear.
+static bool grabber_append(grabbed_output *out, const char *s, size_t len) {
+    if (out->ptr == NULL || out->size - out->idx <= len) {
+        size_t size = (out->size) ? out->size : MAX_PRINT_BUFFER;
+        while (size - out->idx <= len) {
+            size *= 2;
+        }
+        char *tmp = realloc(out->ptr, size);
         if (tmp == NULL) {
-            // We leave current g_grabbed_output untouched
-            PrintAndLogEx(ERR, "Out of memory error in fill_grabber()");
-            return;
+            return false;
+        }
+        out->ptr = tmp;
+        out->size = size;
+    }
+    memcpy(out->ptr + out->idx, s, len);
+    out->idx += len;
+    out->ptr[out->idx] = 0;
+    return true;
+}
+
+static void fill_grabber(const char *string) {
+    grabbed_output *out = (redirect_output != NULL) ? redirect_output : &g_grabbed_output;
+    if (grabber_append(out, string, strlen(string)) == false) {
+        // We leave current grabbed output untouched, called under g_print_lock so no PrintAndLogEx
+        fprintf(stderr, "Out of memory error in fill_grabber()\n");
+    }
+}
+
+// json record of one output line: level, text and for "label....... value" lines also key and value
+static void fill_record(logLevel_t level, const char *line, size_t len) {
+    static const char *level_names[] = {"normal", "success", "info", "failed", "warning", "error", "debug", "inplace", "hint"};
+
+    json_t *rec = json_object();
+    json_object_set_new(rec, "level", json_string(level_names[level]));
+    json_object_set_new(rec, "text", json_stringn(line, len));
+
+    const char *dots = strstr(line, "...");
+    if (dots != NULL && dots != line && (size_t)(dots - line) < len) {
+        const char *value = dots;
+        while (*value == '.') {
+            value++;
+        }
+        while (*value == ' ') {
+            value++;
+        }
+        size_t klen = dots - line;
+        while (klen && line[klen - 1] == ' ') {
+            klen--;
+        }
+        size_t vlen = len - (value - line);
+        if (klen && value < line + len) {
+            json_object_set_new(rec, "key", json_stringn(line, klen));
+            json_object_set_new(rec, "value", json_stringn(value, vlen));
         }
-        g_grabbed_output.ptr = tmp;
-        g_grabbed_output.size += MAX_PRINT_BUFFER;
     }
-    int len = snprintf(g_grabbed_output.ptr + g_grabbed_output.idx, MAX_PRINT_BUFFER, "%s", string);
-    if (len < 0 || len > MAX_PRINT_BUFFER) {
-        // We leave current g_grabbed_output_len untouched
-        PrintAndLogEx(ERR, "snprintf error in fill_grabber()");
+
+    char *js = json_dumps(rec, JSON_COMPACT | JSON_PRESERVE_ORDER);
+    json_decref(rec);
+    if (js == NULL) {
         return;
     }
-    g_grabbed_output.idx += len;
+
+    grabbed_output *out = (redirect_records != NULL) ? redirect_records : &g_grabbed_records;
+    if ((grabber_append(out, js, strlen(js)) == false) || (grabber_append(out, "\n", 1) == false)) {
+        fprintf(stderr, "Out of memory error in fill_records()\n");
+    }
+    free(js);
+}
+
+// one record per non empty line of a message
+static void fill_records(logLevel_t level, const char *text) {
+    char clean[MAX_PRINT_BUFFER] = {0};
+    char tmp[MAX_PRINT_BUFFER] = {0};
+    memcpy_filter_emoji(tmp, text, sizeof(tmp), EMO_ALTTEXT);
+    memcpy_filter_ansi(clean, tmp, sizeof(clean), true);
+
+    const char *line = clean;
+    while (*line) {
+        size_t n = strcspn(line, "\n");
+        size_t len = n;
+        if (len && line[len - 1] == NOLF[0]) {
+            len--;
+        }
+        if (len) {
+            fill_record(level, line, len);
+        }
+        line += n;
+        if (*line) {
+            line++;
+        }
+    }
 }
 
 void PrintAndLogOptions(const char *str[][2], size_t size, size_t space) {
@@ -295,6 +397,12 @@ void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
     vsnprintf(buffer, sizeof(buffer), fmt, args);
     va_end(args);
 
+    if ((level != INPLACE) && ((printandlog_flags() & (PRINTANDLOG_GRAB | PRINTANDLOG_RECORDS)) == (PRINTANDLOG_GRAB | PRINTANDLOG_RECORDS))) {
+        pthread_mutex_lock(&g_print_lock);
+        fill_records(level, buffer);
+        pthread_mutex_unlock(&g_print_lock);
+    }
+
     // no prefixes for normal & inplace
     if (level == NORMAL) {
         fPrintAndLog(stream, "%s", buffer);
@@ -327,7 +435,7 @@ void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
         snprintf(buffer2, sizeof(buffer2), "%s%s", prefix, buffer);
         if (level == INPLACE) {
             // ignore INPLACE if rest of output is grabbed
-            if (!(g_printAndLog & PRINTANDLOG_GRAB)) {
+            if (!(printandlog_flags() & PRINTANDLOG_GRAB)) {
                 char buffer3[sizeof(buffer2)] = {0};
                 char buffer4[sizeof(buffer2)] = {0};
                 memcpy_filter_ansi(buffer3, buffer2, sizeof(buffer2), !g_session.supports_colors);
@@ -350,11 +458,12 @@ static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
     char buffer3[MAX_PRINT_BUFFER] = {0};
 
     bool linefeed = true;
+    uint8_t flags = printandlog_flags();
 
     if (logging && g_session.incognito) {
         logging = 0;
     }
-    if ((g_printAndLog & PRINTANDLOG_LOG) && logging && !logfile) {
+    if ((flags & PRINTANDLOG_LOG) && logging && !logfile) {
         char *my_logfile_path = NULL;
         char filename[40];
         struct tm *timenow;
@@ -413,7 +522,7 @@ static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
     }
     bool filter_ansi = !g_session.supports_colors;
     memcpy_filter_ansi(buffer2, buffer, sizeof(buffer), filter_ansi);
-    if (g_printAndLog & PRINTANDLOG_PRINT) {
+    if (flags & PRINTANDLOG_PRINT) {
         memcpy_filter_emoji(buffer3, buffer2, sizeof(buffer2), g_session.emoji_mode);
         fprintf(stream, "%s", buffer3);
         if (linefeed)
@@ -431,14 +540,14 @@ static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
     }
 #endif
 
-    if (((g_printAndLog & PRINTANDLOG_LOG) && logging && logfile) ||
-            (g_printAndLog & PRINTANDLOG_GRAB)) {
+    if (((flags & PRINTANDLOG_LOG) && logging && logfile) ||
+            (flags & PRINTANDLOG_GRAB)) {
         memcpy_filter_emoji(buffer3, buffer2, sizeof(buffer2), EMO_ALTTEXT);
         if (filter_ansi == false) {
             memcpy_filter_ansi(buffer, buffer3, sizeof(buffer3), true);
         }
     }
-    if ((g_printAndLog & PRINTANDLOG_LOG) && logging && logfile) {
+    if ((flags & PRINTANDLOG_LOG) && logging && logfile) {
         if (filter_ansi) {
             fprintf(logfile, "%s", buffer3);
         } else {
@@ -448,7 +557,7 @@ static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
             fprintf(logfile, "\n");
         fflush(logfile);
     }
-    if (g_printAndLog & PRINTANDLOG_GRAB) {
+    if (flags & PRINTANDLOG_GRAB) {
         if (filter_ansi) {
             fill_grabber(buffer3);
         } else {
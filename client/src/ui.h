@@ -81,6 +81,8 @@ void memcpy_filter_ansi(void *dest, const void *src, size_t n, bool filter);
 void memcpy_filter_rlmarkers(void *dest, const void *src, size_t n);
 void memcpy_filter_emoji(void *dest, const void *src, size_t n, emojiMode_t mode);
 void free_grabber(void);
+void PrintAndLogRedirect(uint8_t flags, grabbed_output *grab, grabbed_output *records);
+void PrintAndLogRedirectGet(uint8_t *flags, grabbed_output **grab, grabbed_output **records);
 
 int searchHomeFilePath(char **foundpath, const char *subdir, const char *filename, bool create_home);
 
@@ -32,6 +32,7 @@
 #include <time.h> // Mingw
 
 #include "ui.h"     // PrintAndLog
+#include "util_posix.h" // detect_num_CPUs
 
 #define UTIL_BUFFER_SIZE_SPRINT 8196
 // global client debug variable
@@ -40,6 +41,8 @@ uint8_t g_debugMode = 0;
 uint8_t g_printAndLog = PRINTANDLOG_PRINT | PRINTANDLOG_LOG;
 // global pointer to grabbed output
 grabbed_output g_grabbed_output = {NULL, 0, 0};
+// global pointer to grabbed output records, one json object per line
+grabbed_output g_grabbed_records = {NULL, 0, 0};
 // global client tell if a pending prompt is present
 bool g_pendingPrompt = false;
 // global CPU core count override
@@ -400,15 +403,16 @@ void print_blocks(uint32_t *data, size_t len) {
     }
 }
 
+// the sprint_* buffers are per thread, demodulators print from several (lf search --dir)
 char *sprint_hex(const uint8_t *data, const size_t len) {
-    static char buf[UTIL_BUFFER_SIZE_SPRINT] = {0};
+    static __thread char buf[UTIL_BUFFER_SIZE_SPRINT] = {0};
     memset(buf, 0x00, sizeof(buf));
     hex_to_buffer((uint8_t *)buf, data, len, sizeof(buf) - 1, 0, 1, true);
     return buf;
 }
 
 char *sprint_hex_inrow_ex(const uint8_t *data, const size_t len, const size_t min_str_len) {
-    static char buf[UTIL_BUFFER_SIZE_SPRINT] = {0};
+    static __thread char buf[UTIL_BUFFER_SIZE_SPRINT] = {0};
     memset(buf, 0x00, sizeof(buf));
     hex_to_buffer((uint8_t *)buf, data, len, sizeof(buf) - 1, min_str_len, 0, true);
     return buf;
@@ -419,7 +423,7 @@ char *sprint_hex_inrow(const uint8_t *data, const size_t len) {
 }
 
 char *sprint_hex_inrow_spaces(const uint8_t *data, const size_t len, size_t spaces_between) {
-    static char buf[UTIL_BUFFER_SIZE_SPRINT] = {0};
+    static __thread char buf[UTIL_BUFFER_SIZE_SPRINT] = {0};
     memset(buf, 0x00, sizeof(buf));
     hex_to_buffer((uint8_t *)buf, data, len, sizeof(buf) - 1, 0, spaces_between, true);
     return buf;
@@ -431,7 +435,7 @@ char *sprint_bytebits_bin_break(const uint8_t *data, const size_t len, const uin
     size_t rowlen = (len > MAX_BIN_BREAK_LENGTH) ? MAX_BIN_BREAK_LENGTH : len;
 
     // 3072 + end of line characters if broken at 8 bits
-    static char buf[MAX_BIN_BREAK_LENGTH] = {0};
+    static __thread char buf[MAX_BIN_BREAK_LENGTH] = {0};
     memset(buf, 0, sizeof(buf));
 
     char *tmp = buf;
@@ -507,13 +511,13 @@ char *sprint_bytebits_bin(const uint8_t *data, const size_t len) {
 
 char *sprint_bin(const uint8_t *data, const size_t len) {
     size_t binlen = (len * 8 > MAX_BIN_BREAK_LENGTH) ? MAX_BIN_BREAK_LENGTH : len * 8;
-    static uint8_t buf[MAX_BIN_BREAK_LENGTH] = {0};
+    static __thread uint8_t buf[MAX_BIN_BREAK_LENGTH] = {0};
     bytes_to_bytebits(data, binlen / 8, buf);
     return sprint_bytebits_bin_break(buf, binlen, 0);
 }
 
 char *sprint_hex_ascii(const uint8_t *data, const size_t len) {
-    static char buf[UTIL_BUFFER_SIZE_SPRINT + 20] = {0};
+    static __thread char buf[UTIL_BUFFER_SIZE_SPRINT + 20] = {0};
     memset(buf, 0x00, sizeof(buf));
 
     char *tmp = buf;
@@ -537,7 +541,7 @@ out:
 }
 
 char *sprint_ascii_ex(const uint8_t *data, const size_t len, const size_t min_str_len) {
-    static char buf[UTIL_BUFFER_SIZE_SPRINT] = {0};
+    static __thread char buf[UTIL_BUFFER_SIZE_SPRINT] = {0};
     memset(buf, 0x00, sizeof(buf));
 
     char *tmp = buf;
@@ -568,7 +572,7 @@ char *sprint_breakdown_bin(color_t color, const char *bs, int width, int padn, i
 
     const char *prepad     = "................................";
     const char *postmarker = " ................................";
-    static char buf[32 + 120] = {0};
+    static __thread char buf[32 + 120] = {0};
     memset(buf, 0, sizeof(buf));
 
     int8_t end = (width - padn - bits);
@@ -700,7 +704,7 @@ void bytes_to_bytebits(const void *src, const size_t srclen, void *dest) {
 // hh,gg,ff,ee,dd,cc,bb,aa, pp,oo,nn,mm,ll,kk,jj,ii
 // up to 64 bytes or 512 bits
 uint8_t *SwapEndian64(const uint8_t *src, const size_t len, const uint8_t blockSize) {
-    static uint8_t buf[64] = {0};
+    static __thread uint8_t buf[64] = {0};
     memset(buf, 0x00, 64);
     uint8_t *tmp = buf;
     for (uint8_t block = 0; block < (uint8_t)(len / blockSize); block++) {
@@ -1217,21 +1221,6 @@ int num_CPUs(void) {
     return detect_num_CPUs();
 }
 
-// determine number of logical CPU cores (use for multithreaded functions)
-int detect_num_CPUs(void) {
-#if defined(_WIN32)
-#include <sysinfoapi.h>
-    SYSTEM_INFO sysinfo;
-    GetSystemInfo(&sysinfo);
-    return sysinfo.dwNumberOfProcessors;
-#else
-    int count = sysconf(_SC_NPROCESSORS_ONLN);
-    if (count <= 0)
-        count = 1;
-    return count;
-#endif
-}
-
 void str_lower(char *s) {
     for (size_t i = 0; i < strlen(s); i++)
         s[i] = tolower(s[i]);
@@ -40,10 +40,12 @@ typedef struct {
     size_t idx;
 } grabbed_output;
 extern grabbed_output g_grabbed_output;
+extern grabbed_output g_grabbed_records;
 
 #define PRINTANDLOG_PRINT 1
 #define PRINTANDLOG_LOG   2
 #define PRINTANDLOG_GRAB  4
+#define PRINTANDLOG_RECORDS 8
 
 // Return error
 #define PM3_RET_ERR(err, ...)  { \
@@ -154,7 +156,6 @@ uint32_t PackBits(uint8_t start, uint8_t len, const uint8_t *bits);
 uint64_t HornerScheme(uint64_t num, uint64_t divider, uint64_t factor);
 
 int num_CPUs(void);
-int detect_num_CPUs(void); // number of logical CPUs
 
 void str_lower(char *s); // converts string to lower case
 void str_upper(char *s); // converts string to UPPER case
@@ -21,6 +21,12 @@
 #include <stdlib.h>
 #include "parity.h"
 
+#if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks threads
+#include <string.h>
+#include <pthread.h>
+#include "util_posix.h"    // detect_num_CPUs
+#endif
+
 
 #if !defined LOWMEM
 #define CONSTRUCTOR
@@ -155,15 +161,118 @@ recover(uint32_t *o_head, uint32_t *o_tail, uint32_t oks,
 
 
 #if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
+
+#define RECOVERY32_TABLE_SIZE   (1 << 21)
+#define RECOVERY32_STATES       (1 << 18)
+#define RECOVERY32_BUCKET_SIZE  (1 << 14)
+#define RECOVERY64_STATES       (1 << 4)
+#define RECOVERY64_CHUNK_BITS   14
+#define RECOVERY64_CHUNKS       ((1 << 20) >> RECOVERY64_CHUNK_BITS)
+#define RECOVERY_MAX_THREADS    64
+
+// threads == 0 means one per logical CPU, capped at max_threads
+static uint32_t recovery_threads(uint32_t threads, uint32_t max_threads, uint32_t jobs) {
+    if (threads == 0)
+        threads = detect_num_CPUs();
+    if (threads > max_threads)
+        threads = max_threads;
+    if (threads > jobs)
+        threads = jobs;
+    return (threads) ? threads : 1;
+}
+
+/** bucket_alloc
+ * one contiguous block for all 2x256 buckets of an out of place bucket sort.
+ * Buckets are always written before they are read, no need to clear them.
+ */
+static uint32_t *bucket_alloc(bucket_array_t bucket) {
+    uint32_t *block = malloc(sizeof(uint32_t) * 2 * 0x100 * RECOVERY32_BUCKET_SIZE);
+    if (block == NULL)
+        return NULL;
+
+    for (uint32_t i = 0; i < 2; i++) {
+        for (uint32_t j = 0; j <= 0xff; j++) {
+            bucket[i][j].head = block + (i * 0x100 + j) * RECOVERY32_BUCKET_SIZE;
+        }
+    }
+    return block;
+}
+
+// work shared by the lfsr_recovery32 threads. Every top level bucket is an
+// independent subtree, its states are kept apart and concatenated afterwards
+// in the same order as the single threaded recursion would produce them.
+typedef struct {
+    bucket_info_t bucket_info;
+    uint32_t oks, eks, in;
+    int rem;
+    uint32_t next_bucket;
+    struct Crypto1State *states[0x100];
+    uint32_t count[0x100];
+} recovery32_work_t;
+
+static void *recovery32_thread(void *arg) {
+    recovery32_work_t *work = (recovery32_work_t *)arg;
+    bucket_array_t bucket;
+
+    uint32_t *bucket_block = bucket_alloc(bucket);
+    uint32_t *odd = malloc(sizeof(uint32_t) * RECOVERY32_TABLE_SIZE);
+    uint32_t *even = malloc(sizeof(uint32_t) * RECOVERY32_TABLE_SIZE);
+    struct Crypto1State *sl = malloc(sizeof(struct Crypto1State) * RECOVERY32_STATES);
+    if (bucket_block == NULL || odd == NULL || even == NULL || sl == NULL)
+        goto out;
+
+    uint32_t b;
+    while ((b = __atomic_fetch_add(&work->next_bucket, 1, __ATOMIC_RELAXED)) < work->bucket_info.numbuckets) {
+        // recover() extends a table beyond its tail, so every subtree works on its own copy
+        uint32_t *o_head = work->bucket_info.bucket_info[1][b].head;
+        uint32_t *e_head = work->bucket_info.bucket_info[0][b].head;
+        size_t o_len = work->bucket_info.bucket_info[1][b].tail - o_head + 1;
+        size_t e_len = work->bucket_info.bucket_info[0][b].tail - e_head + 1;
+        memcpy(odd, o_head, o_len * sizeof(uint32_t));
+        memcpy(even, e_head, e_len * sizeof(uint32_t));
+
+        sl->odd = sl->even = 0;
+        struct Crypto1State *end = recover(odd, odd + o_len - 1, work->oks,
+                                           even, even + e_len - 1, work->eks,
+                                           work->rem, sl, work->in, bucket);
+        uint32_t n = end - sl;
+        if (n) {
+            work->states[b] = malloc(sizeof(struct Crypto1State) * n);
+            if (work->states[b] == NULL)
+                continue;
+            memcpy(work->states[b], sl, sizeof(struct Crypto1State) * n);
+            work->count[b] = n;
+        }
+    }
+
+out:
+    free(sl);
+    free(even);
+    free(odd);
+    free(bucket_block);
+    return NULL;
+}
+
 /** lfsr_recovery
  * recover the state of the lfsr given 32 bits of the keystream
  * additionally you can use the in parameter to specify the value
  * that was fed into the lfsr at the time the keystream was generated
  */
 struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
+    return lfsr_recovery32_mt(ks2, in, 1);
+}
+
+/** lfsr_recovery32_mt
+ * same as lfsr_recovery32, the subtrees below the first bucket sort are
+ * distributed over threads (0 = one per logical CPU, at most 8 as every
+ * thread needs its own ~50 MB of tables). The statelist is identical to the
+ * single threaded one, including its order.
+ */
+struct Crypto1State *lfsr_recovery32_mt(uint32_t ks2, uint32_t in, uint32_t threads) {
     struct Crypto1State *statelist;
     uint32_t *odd_head = 0, *odd_tail = 0, oks = 0;
     uint32_t *even_head = 0, *even_tail = 0, eks = 0;
+    recovery32_work_t *work = NULL;
     register int i;
 
     // split the keystream into an odd and even part
@@ -172,10 +281,11 @@ struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
     for (i = 30; i >= 0; i -= 2)
         eks = eks << 1 | BEBIT(ks2, i);
 
-    odd_head = odd_tail = calloc(1, sizeof(uint32_t) << 21);
-    even_head = even_tail = calloc(1, sizeof(uint32_t) << 21);
-    statelist =  calloc(1, sizeof(struct Crypto1State) << 18);
-    if (!odd_tail-- || !even_tail-- || !statelist) {
+    odd_head = odd_tail = malloc(sizeof(uint32_t) * RECOVERY32_TABLE_SIZE);
+    even_head = even_tail = malloc(sizeof(uint32_t) * RECOVERY32_TABLE_SIZE);
+    statelist = malloc(sizeof(struct Crypto1State) * RECOVERY32_STATES);
+    work = calloc(1, sizeof(recovery32_work_t));
+    if (!odd_tail-- || !even_tail-- || !statelist || !work) {
         free(statelist);
         statelist = 0;
         goto out;
@@ -183,28 +293,16 @@ struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
 
     statelist->odd = statelist->even = 0;
 
-    // allocate memory for out of place bucket_sort
-    bucket_array_t bucket;
-
-    for (i = 0; i < 2; i++) {
-        for (uint32_t j = 0; j <= 0xff; j++) {
-            bucket[i][j].head = calloc(1, sizeof(uint32_t) << 14);
-            if (!bucket[i][j].head) {
-                goto out;
-            }
-        }
-    }
-
-    // initialize statelists: add all possible states which would result into the rightmost 2 bits of the keystream
+    // initialize statelists: add all possible states which would result into the rightmost 2 bits of the keystream.
+    // Branch free, every candidate is stored and the tail only advances when it matches.
     uint8_t oks_b1 = oks & 1;
     uint8_t eks_b1 = eks & 1;
-    register uint8_t tbl_filter;
     for (i = 1 << 20; i >= 0; --i) {
-        tbl_filter = filter(i);
-        if (tbl_filter == oks_b1)
-            *++odd_tail = i;
-        if (tbl_filter == eks_b1)
-            *++even_tail = i;
+        uint8_t tbl_filter = filter(i);
+        odd_tail[1] = i;
+        odd_tail += (tbl_filter == oks_b1);
+        even_tail[1] = i;
+        even_tail += (tbl_filter == eks_b1);
     }
 
     // extend the statelists. Look at the next 8 Bits of the keystream (4 Bit each odd and even):
@@ -217,12 +315,62 @@ struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
     // 22 bits to go to recover 32 bits in total. From now on, we need to take the "in"
     // parameter into account.
     in = (in >> 16 & 0xff) | (in << 16) | (in & 0xff00); // Byte swapping
-    recover(odd_head, odd_tail, oks, even_head, even_tail, eks, 11, statelist, in << 1, bucket);
+    in <<= 1;
+
+    // first level of recover(), done here so its buckets can be handed out to the threads
+    int rem = 11;
+    for (i = 0; i < 4 && rem--; i++) {
+        oks >>= 1;
+        eks >>= 1;
+        in >>= 2;
+        extend_table(odd_head, &odd_tail, oks & 1, LF_POLY_EVEN << 1 | 1, LF_POLY_ODD << 1, 0);
+        if (odd_head > odd_tail)
+            goto out;
+
+        extend_table(even_head, &even_tail, eks & 1, LF_POLY_ODD, LF_POLY_EVEN << 1 | 1, in & 3);
+        if (even_head > even_tail)
+            goto out;
+    }
+
+    bucket_array_t bucket;
+    uint32_t *bucket_block = bucket_alloc(bucket);
+    if (bucket_block == NULL)
+        goto out;
+    bucket_sort_intersect(even_head, even_tail, odd_head, odd_tail, &work->bucket_info, bucket);
+    free(bucket_block);
+
+    work->oks = oks;
+    work->eks = eks;
+    work->in = in;
+    work->rem = rem;
+
+    threads = recovery_threads(threads, RECOVERY32_MAX_THREADS, work->bucket_info.numbuckets);
+    pthread_t thread_id[RECOVERY32_MAX_THREADS];
+    uint32_t started = 0;
+    for (; started < threads - 1; started++) {
+        if (pthread_create(&thread_id[started], NULL, recovery32_thread, work))
+            break;
+    }
+    recovery32_thread(work);
+    for (uint32_t t = 0; t < started; t++)
+        pthread_join(thread_id[t], NULL);
+
+    // collect the subtrees in the order the single threaded recursion visits them
+    struct Crypto1State *sl = statelist;
+    uint32_t room = RECOVERY32_STATES - 1;
+    for (i = work->bucket_info.numbuckets - 1; i >= 0; i--) {
+        uint32_t n = MIN(work->count[i], room);
+        if (n) {
+            memcpy(sl, work->states[i], sizeof(struct Crypto1State) * n);
+            sl += n;
+            room -= n;
+        }
+        free(work->states[i]);
+    }
+    sl->odd = sl->even = 0;
 
 out:
-    for (i = 0; i < 2; i++)
-        for (uint32_t j = 0; j <= 0xff; j++)
-            free(bucket[i][j].head);
+    free(work);
     free(odd_head);
     free(even_head);
     return statelist;
@@ -252,73 +400,139 @@ static const uint32_t T2[] = {  0x3C88B810, 0x5E445C08, 0x2982A580, 0x14C152C0,
                              };
 static const uint32_t C1[] = { 0x846B5, 0x4235A, 0x211AD};
 static const uint32_t C2[] = { 0x1A822E0, 0x21A822E0, 0x21A822E0};
+// work shared by the lfsr_recovery64 threads, the 20 bit odd start values are
+// split into chunks which keep their own statelist until they are merged
+typedef struct {
+    uint8_t oks[32], eks[32];
+    uint32_t next_chunk;
+    struct Crypto1State states[RECOVERY64_CHUNKS][RECOVERY64_STATES];
+    uint32_t count[RECOVERY64_CHUNKS];
+} recovery64_work_t;
+
+static void *recovery64_thread(void *arg) {
+    recovery64_work_t *work = (recovery64_work_t *)arg;
+    const uint8_t *oks = work->oks, *eks = work->eks;
+    uint8_t hi[32];
+    uint32_t low = 0,  win = 0;
+    uint32_t *tail, *table = malloc(sizeof(uint32_t) << 16);
+    int i, j;
+
+    if (table == NULL)
+        return NULL;
+
+    uint32_t c;
+    while ((c = __atomic_fetch_add(&work->next_chunk, 1, __ATOMIC_RELAXED)) < RECOVERY64_CHUNKS) {
+        // chunks are numbered from the top so they run through i in the original descending order
+        int first = ((RECOVERY64_CHUNKS - c) << RECOVERY64_CHUNK_BITS) - 1;
+        int last = first - (1 << RECOVERY64_CHUNK_BITS) + 1;
+        struct Crypto1State *sl = work->states[c];
+
+        for (i = first; i >= last; --i) {
+            if (filter(i) != oks[0])
+                continue;
+
+            *(tail = table) = i;
+            for (j = 1; tail >= table && j < 29; ++j)
+                extend_table_simple(table, &tail, oks[j]);
+
+            if (tail < table)
+                continue;
+
+            for (j = 0; j < 19; ++j)
+                low = low << 1 | (evenparity32(i & S1[j]));
+            for (j = 0; j < 32; ++j)
+                hi[j] = evenparity32(i & T1[j]);
+
+            for (; tail >= table; --tail) {
+                for (j = 0; j < 3; ++j) {
+                    *tail = *tail << 1;
+                    *tail |= evenparity32((i & C1[j]) ^ (*tail & C2[j]));
+                    if (filter(*tail) != oks[29 + j])
+                        goto continue2;
+                }
+
+                for (j = 0; j < 19; ++j)
+                    win = win << 1 | (evenparity32(*tail & S2[j]));
+
+                win ^= low;
+                for (j = 0; j < 32; ++j) {
+                    win = win << 1 ^ hi[j] ^ (evenparity32(*tail & T2[j]));
+                    if (filter(win) != eks[j])
+                        goto continue2;
+                }
+
+                if (work->count[c] < RECOVERY64_STATES) {
+                    *tail = *tail << 1 | (evenparity32(LF_POLY_EVEN & *tail));
+                    sl->odd = *tail ^ (evenparity32(LF_POLY_ODD & win));
+                    sl->even = win;
+                    ++sl;
+                    work->count[c]++;
+                }
+continue2:
+                ;
+            }
+        }
+    }
+
+    free(table);
+    return NULL;
+}
+
 /** Reverse 64 bits of keystream into possible cipher states
  * Variation mentioned in the paper. Somewhat optimized version
  */
 struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3) {
+    return lfsr_recovery64_mt(ks2, ks3, 1);
+}
+
+/** lfsr_recovery64_mt
+ * same as lfsr_recovery64, the odd start values are distributed over
+ * threads (0 = one per logical CPU). Candidates come out in the same order.
+ */
+struct Crypto1State *lfsr_recovery64_mt(uint32_t ks2, uint32_t ks3, uint32_t threads) {
     struct Crypto1State *statelist, *sl;
-    uint8_t oks[32], eks[32], hi[32];
-    uint32_t low = 0,  win = 0;
-    uint32_t *tail, table[1 << 16];
-    int i, j;
+    int i;
 
     sl = statelist = calloc(1, sizeof(struct Crypto1State) << 4);
     if (!sl)
         return 0;
     sl->odd = sl->even = 0;
 
+    recovery64_work_t *work = calloc(1, sizeof(recovery64_work_t));
+    if (!work)
+        return statelist;
+
     for (i = 30; i >= 0; i -= 2) {
-        oks[i >> 1] = BEBIT(ks2, i);
-        oks[16 + (i >> 1)] = BEBIT(ks3, i);
+        work->oks[i >> 1] = BEBIT(ks2, i);
+        work->oks[16 + (i >> 1)] = BEBIT(ks3, i);
     }
     for (i = 31; i >= 0; i -= 2) {
-        eks[i >> 1] = BEBIT(ks2, i);
-        eks[16 + (i >> 1)] = BEBIT(ks3, i);
+        work->eks[i >> 1] = BEBIT(ks2, i);
+        work->eks[16 + (i >> 1)] = BEBIT(ks3, i);
     }
 
-    for (i = 0xfffff; i >= 0; --i) {
-        if (filter(i) != oks[0])
-            continue;
-
-        *(tail = table) = i;
-        for (j = 1; tail >= table && j < 29; ++j)
-            extend_table_simple(table, &tail, oks[j]);
-
-        if (tail < table)
-            continue;
-
-        for (j = 0; j < 19; ++j)
-            low = low << 1 | (evenparity32(i & S1[j]));
-        for (j = 0; j < 32; ++j)
-            hi[j] = evenparity32(i & T1[j]);
-
-        for (; tail >= table; --tail) {
-            for (j = 0; j < 3; ++j) {
-                *tail = *tail << 1;
-                *tail |= evenparity32((i & C1[j]) ^ (*tail & C2[j]));
-                if (filter(*tail) != oks[29 + j])
-                    goto continue2;
-            }
-
-            for (j = 0; j < 19; ++j)
-                win = win << 1 | (evenparity32(*tail & S2[j]));
-
-            win ^= low;
-            for (j = 0; j < 32; ++j) {
-                win = win << 1 ^ hi[j] ^ (evenparity32(*tail & T2[j]));
-                if (filter(win) != eks[j])
-                    goto continue2;
-            }
-
-            *tail = *tail << 1 | (evenparity32(LF_POLY_EVEN & *tail));
-            sl->odd = *tail ^ (evenparity32(LF_POLY_ODD & win));
-            sl->even = win;
-            ++sl;
-            sl->odd = sl->even = 0;
-continue2:
-            ;
-        }
+    threads = recovery_threads(threads, RECOVERY_MAX_THREADS, RECOVERY64_CHUNKS);
+    pthread_t thread_id[RECOVERY_MAX_THREADS];
+    uint32_t started = 0;
+    for (; started < threads - 1; started++) {
+        if (pthread_create(&thread_id[started], NULL, recovery64_thread, work))
+            break;
+    }
+    recovery64_thread(work);
+    for (uint32_t t = 0; t < started; t++)
+        pthread_join(thread_id[t], NULL);
+
+    // keep room for the terminating empty state
+    uint32_t room = RECOVERY64_STATES - 1;
+    for (uint32_t c = 0; c < RECOVERY64_CHUNKS && room; c++) {
+        uint32_t n = MIN(work->count[c], room);
+        memcpy(sl, work->states[c], sizeof(struct Crypto1State) * n);
+        sl += n;
+        room -= n;
     }
+    sl->odd = sl->even = 0;
+
+    free(work);
     return statelist;
 }
 #endif
@@ -439,6 +653,64 @@ bool validate_prng_nonce(uint32_t nonce) {
     return x == (nonce & 0xFFFF);
 }
 
+/** FM11RF08S static nested nonce seed
+ * position of each 16 bit LFSR state in its cycle and the state at each position,
+ * so stepping n times back is a lookup
+ */
+static uint16_t i_lfsr16[1 << 16];
+static uint16_t s_lfsr16[1 << 16];
+static pthread_once_t lfsr16_once = PTHREAD_ONCE_INIT;
+
+static void fill_lfsr16_table(void) {
+    uint16_t x = 1;
+    for (uint16_t i = 1; i; ++i) {
+        i_lfsr16[(x & 0xff) << 8 | x >> 8] = i;
+        s_lfsr16[i] = (x & 0xff) << 8 | x >> 8;
+        x = x >> 1 | (x ^ x >> 2 ^ x >> 3 ^ x >> 5) << 15;
+    }
+}
+
+void init_lfsr16_table(void) {
+    pthread_once(&lfsr16_once, fill_lfsr16_table);
+}
+
+// n steps back in one go, the LFSR cycle uses positions 1..65535
+static uint16_t prev_lfsr16_n(uint16_t nonce, uint8_t n) {
+    // all zero is a fixed point
+    if (nonce == 0) {
+        return 0;
+    }
+    int32_t pos = (int32_t)i_lfsr16[nonce] - n;
+    if (pos < 1) {
+        pos += 65535;
+    }
+    return s_lfsr16[pos];
+}
+
+/** compute_seednt16_nt32
+ * 16 bit seed of the static nested nonce nt32 sent with key, keyA and keyB of a
+ * FM11RF08S sector share it. Needs init_lfsr16_table()
+ */
+uint16_t compute_seednt16_nt32(uint32_t nt32, uint64_t key) {
+    static const uint8_t a[] = {0, 8, 9, 4, 6, 11, 1, 15, 12, 5, 2, 13, 10, 14, 3, 7};
+    static const uint8_t b[] = {0, 13, 1, 14, 4, 10, 15, 7, 5, 3, 8, 6, 9, 2, 12, 11};
+    uint16_t nt = prev_lfsr16_n(nt32 >> 16, 14);
+    bool odd = true;
+
+    for (uint8_t i = 0; i < 6 * 8; i += 8) {
+        if (odd) {
+            nt ^= (a[(key >> i) & 0xF]);
+            nt ^= (b[(key >> i >> 4) & 0xF]) << 4;
+        } else {
+            nt ^= (b[(key >> i) & 0xF]);
+            nt ^= (a[(key >> i >> 4) & 0xF]) << 4;
+        }
+        odd ^= 1;
+        nt = prev_lfsr16_n(nt, 8);
+    }
+    return nt;
+}
+
 static uint32_t fastfwd[2][8] = {
     { 0, 0x4BC53, 0xECB1, 0x450E2, 0x25E29, 0x6E27A, 0x2B298, 0x60ECB},
     { 0, 0x1D962, 0x4BC53, 0x56531, 0xECB1, 0x135D3, 0x450E2, 0x58980}
@@ -35,8 +35,13 @@ uint32_t crypto1_word(struct Crypto1State *, uint32_t, int);
 uint32_t prng_successor(uint32_t x, uint32_t n);
 
 #if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
+// every lfsr_recovery32 running at once owns ~50 MB of tables and buckets,
+// callers running several recoveries side by side stay under this count as well
+#define RECOVERY32_MAX_THREADS  8
 struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in);
 struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3);
+struct Crypto1State *lfsr_recovery32_mt(uint32_t ks2, uint32_t in, uint32_t threads);
+struct Crypto1State *lfsr_recovery64_mt(uint32_t ks2, uint32_t ks3, uint32_t threads);
 struct Crypto1State *
 lfsr_common_prefix(uint32_t pfx, uint32_t rr, uint8_t ks[8], uint8_t par[8][8], uint32_t no_par);
 #endif
@@ -48,6 +53,8 @@ uint8_t lfsr_rollback_byte(struct Crypto1State *s, uint32_t in, int fb);
 uint32_t lfsr_rollback_word(struct Crypto1State *s, uint32_t in, int fb);
 int nonce_distance(uint32_t from, uint32_t to);
 bool validate_prng_nonce(uint32_t nonce);
+void init_lfsr16_table(void);
+uint16_t compute_seednt16_nt32(uint32_t nt32, uint64_t key);
 #define FOREACH_VALID_NONCE(N, FILTER, FSIZE)\
     uint32_t __n = 0,__M = 0, N = 0;\
     int __i;\
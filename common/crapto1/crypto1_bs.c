@@ -0,0 +1,275 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Bitsliced Crypto1
+//
+// Vector element n holds bit n of every lane. The LFSR is kept as the stream of its bits,
+// at any time z[0..47] is the register with z[47 - 2j] = odd bit j and z[46 - 2j] = even bit j.
+// A clock appends the feedback bit z[48], so the register can be shifted by moving a pointer
+// and is only copied back once per word.
+//
+// The kernels are compiled for AVX2 and for the baseline instruction set, the AVX2 variant
+// is picked at runtime when the cpu supports it.
+//-----------------------------------------------------------------------------
+#include "crypto1_bs.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRYPTO1_BS_X86
+#endif
+
+#define BS_STATE_SIZE   48
+#define BS_WORD_SIZE    32
+#define BS_CHUNKS       (CRYPTO1_BS_LANES / 64)
+
+typedef uint64_t bitslice_t __attribute__((vector_size(CRYPTO1_BS_LANES / 8)));
+
+#define BS_ALWAYS_INLINE inline __attribute__((always_inline))
+
+// filter function (f20), see hardnested_bf_core.c
+#define f20a(a,b,c,d) (((a|b)^(a&d))^(c&((a^b)|d)))
+#define f20b(a,b,c,d) (((a&b)|c)^((a^b)&(c|d)))
+#define f20c(a,b,c,d,e) ((a|((b|e)&(d^e)))^((a^(b&d))&((c^d)|(b&e))))
+
+#define BS_FILTER(z) \
+    f20c(f20a((z)[9], (z)[11], (z)[13], (z)[15]), \
+         f20b((z)[17], (z)[19], (z)[21], (z)[23]), \
+         f20b((z)[25], (z)[27], (z)[29], (z)[31]), \
+         f20a((z)[33], (z)[35], (z)[37], (z)[39]), \
+         f20b((z)[41], (z)[43], (z)[45], (z)[47]))
+
+// LF_POLY_ODD / LF_POLY_EVEN taps in stream order
+#define BS_FEEDBACK(z) \
+    ((z)[0] ^ (z)[5] ^ (z)[9] ^ (z)[10] ^ (z)[12] ^ (z)[14] ^ (z)[15] ^ (z)[17] ^ (z)[19] ^ \
+     (z)[24] ^ (z)[25] ^ (z)[27] ^ (z)[29] ^ (z)[35] ^ (z)[39] ^ (z)[41] ^ (z)[42] ^ (z)[43])
+
+// bit i of a lane word is shifted in / out at clock i, see crypto1_word()
+#define BS_WORD_BIT(i) ((i) ^ 24)
+
+// Clocks one word. in[i] holds the input bits of clock i, ks[i] receives the keystream bits.
+// z needs room for BS_STATE_SIZE + BS_WORD_SIZE vectors.
+static BS_ALWAYS_INLINE void bs_word(bitslice_t *z, const bitslice_t *in, bool is_encrypted, bitslice_t *ks) {
+    for (int i = 0; i < BS_WORD_SIZE; i++) {
+        const bitslice_t *r = z + i;
+        bitslice_t k = BS_FILTER(r);
+        bitslice_t fb = BS_FEEDBACK(r) ^ in[i];
+        if (is_encrypted) {
+            fb ^= k;
+        }
+        ks[i] = k;
+        z[BS_STATE_SIZE + i] = fb;
+    }
+    memmove(z, z + BS_WORD_SIZE, BS_STATE_SIZE * sizeof(bitslice_t));
+}
+
+// number of used lanes of 64 lane chunk c
+#define BS_CHUNK_LANES(cnt, c) (((cnt) - ((c) << 6)) > 64 ? 64 : ((cnt) - ((c) << 6)))
+
+// 64x64 bit matrix transpose, afterwards bit c of a[r] is what bit r of a[c] was
+static BS_ALWAYS_INLINE void transpose64(uint64_t *a) {
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (int j = 32; j != 0; j >>= 1, m ^= m << j) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k] ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+static BS_ALWAYS_INLINE void bs_broadcast_word(uint32_t word, bitslice_t *in) {
+    const bitslice_t zeroes = {0};
+    for (int i = 0; i < BS_WORD_SIZE; i++) {
+        in[i] = BIT(word, BS_WORD_BIT(i)) ? ~zeroes : zeroes;
+    }
+}
+
+static BS_ALWAYS_INLINE void bs_keystream_block(const uint64_t *keys, uint32_t keycnt, const crypto1_bs_word_t *words, uint32_t wordcnt, uint32_t *ks) {
+
+    bitslice_t z[BS_STATE_SIZE + BS_WORD_SIZE];
+    memset(z, 0, sizeof(z));
+
+    // load keys, same bit order as crypto1_init()
+    for (uint32_t c = 0; c < BS_CHUNKS && (c << 6) < keycnt; c++) {
+        uint64_t bits[64] = {0};
+        memcpy(bits, keys + (c << 6), BS_CHUNK_LANES(keycnt, c) * sizeof(uint64_t));
+        transpose64(bits);
+        for (int i = 0; i < BS_STATE_SIZE; i++) {
+            z[i][c] = bits[(47 - i) ^ 7];
+        }
+    }
+
+    for (uint32_t w = 0; w < wordcnt; w++) {
+        bitslice_t in[BS_WORD_SIZE];
+        bitslice_t ksb[BS_WORD_SIZE];
+        bs_broadcast_word(words[w].in, in);
+        bs_word(z, in, words[w].is_encrypted, ksb);
+
+        // transpose the keystream back to one word per lane
+        for (uint32_t c = 0; c < BS_CHUNKS && (c << 6) < keycnt; c++) {
+            uint64_t bits[64] = {0};
+            for (int i = 0; i < BS_WORD_SIZE; i++) {
+                bits[BS_WORD_BIT(i)] = ksb[i][c];
+            }
+            transpose64(bits);
+            for (uint32_t l = 0; l < BS_CHUNK_LANES(keycnt, c); l++) {
+                ks[((c << 6) + l) * wordcnt + w] = (uint32_t)bits[l];
+            }
+        }
+    }
+}
+
+static BS_ALWAYS_INLINE bool bs_check_nonces_block(const struct Crypto1State *s, uint32_t uid, const uint32_t *nt_enc, const uint8_t *par_enc, uint32_t cnt) {
+
+    const bitslice_t zeroes = {0};
+    const bitslice_t ones = ~zeroes;
+
+    bitslice_t z[BS_STATE_SIZE + BS_WORD_SIZE];
+    for (int j = 0; j < BS_STATE_SIZE / 2; j++) {
+        z[47 - 2 * j] = BIT(s->odd, j) ? ones : zeroes;
+        z[46 - 2 * j] = BIT(s->even, j) ? ones : zeroes;
+    }
+
+    bitslice_t in[BS_WORD_SIZE], enc[BS_WORD_SIZE], par[4];
+    memset(enc, 0, sizeof(enc));
+    memset(par, 0, sizeof(par));
+    bitslice_t valid = zeroes;
+
+    for (uint32_t c = 0; c < BS_CHUNKS && (c << 6) < cnt; c++) {
+        uint64_t bits[64] = {0};
+        for (uint32_t l = 0; l < BS_CHUNK_LANES(cnt, c); l++) {
+            const uint32_t lane = (c << 6) + l;
+            bits[l] = nt_enc[lane];
+            for (int b = 0; b < 4; b++) {
+                par[b][c] |= (uint64_t)BIT(par_enc[lane], 3 - b) << l;
+            }
+            valid[c] |= 1ULL << l;
+        }
+        transpose64(bits);
+        for (int i = 0; i < BS_WORD_SIZE; i++) {
+            enc[i][c] = bits[BS_WORD_BIT(i)];
+        }
+    }
+
+    bs_broadcast_word(uid, in);
+    for (int i = 0; i < BS_WORD_SIZE; i++) {
+        in[i] ^= enc[i];
+    }
+
+    bitslice_t ks[BS_WORD_SIZE];
+    bs_word(z, in, true, ks);
+
+    bitslice_t fail = zeroes;
+    for (int b = 0; b < 4; b++) {
+        bitslice_t p = ones;
+        for (int i = 8 * b; i < 8 * b + 8; i++) {
+            p ^= ks[i] ^ enc[i];
+        }
+        // parity bit keystream is the first bit after the byte
+        bitslice_t ks_par = (b < 3) ? ks[8 * b + 8] : BS_FILTER(z);
+        fail |= par[b] ^ ks_par ^ p;
+    }
+    fail &= valid;
+
+    for (int c = 0; c < BS_CHUNKS; c++) {
+        if (fail[c]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef void keystream_block_fn(const uint64_t *, uint32_t, const crypto1_bs_word_t *, uint32_t, uint32_t *);
+typedef bool check_nonces_block_fn(const struct Crypto1State *, uint32_t, const uint32_t *, const uint8_t *, uint32_t);
+
+static void keystream_block_generic(const uint64_t *keys, uint32_t keycnt, const crypto1_bs_word_t *words, uint32_t wordcnt, uint32_t *ks) {
+    bs_keystream_block(keys, keycnt, words, wordcnt, ks);
+}
+
+static bool check_nonces_block_generic(const struct Crypto1State *s, uint32_t uid, const uint32_t *nt_enc, const uint8_t *par_enc, uint32_t cnt) {
+    return bs_check_nonces_block(s, uid, nt_enc, par_enc, cnt);
+}
+
+#ifdef CRYPTO1_BS_X86
+__attribute__((target("avx2")))
+static void keystream_block_avx2(const uint64_t *keys, uint32_t keycnt, const crypto1_bs_word_t *words, uint32_t wordcnt, uint32_t *ks) {
+    bs_keystream_block(keys, keycnt, words, wordcnt, ks);
+}
+
+__attribute__((target("avx2")))
+static bool check_nonces_block_avx2(const struct Crypto1State *s, uint32_t uid, const uint32_t *nt_enc, const uint8_t *par_enc, uint32_t cnt) {
+    return bs_check_nonces_block(s, uid, nt_enc, par_enc, cnt);
+}
+#endif
+
+typedef struct {
+    const char *name;
+    keystream_block_fn *keystream_block;
+    check_nonces_block_fn *check_nonces_block;
+} crypto1_bs_impl_t;
+
+static const crypto1_bs_impl_t impl_generic = {"generic", keystream_block_generic, check_nonces_block_generic};
+#ifdef CRYPTO1_BS_X86
+static const crypto1_bs_impl_t impl_avx2 = {"AVX2", keystream_block_avx2, check_nonces_block_avx2};
+#endif
+
+static const crypto1_bs_impl_t *crypto1_bs_impl(void) {
+    static const crypto1_bs_impl_t *impl = NULL;
+
+    const crypto1_bs_impl_t *p = __atomic_load_n(&impl, __ATOMIC_ACQUIRE);
+    if (p != NULL) {
+        return p;
+    }
+
+    p = &impl_generic;
+#ifdef CRYPTO1_BS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        p = &impl_avx2;
+    }
+#endif
+    __atomic_store_n(&impl, p, __ATOMIC_RELEASE);
+    return p;
+}
+
+const char *crypto1_bs_simd(void) {
+    return crypto1_bs_impl()->name;
+}
+
+void crypto1_bs_keystream(const uint64_t *keys, uint32_t keycnt, const crypto1_bs_word_t *words, uint32_t wordcnt, uint32_t *ks) {
+    const crypto1_bs_impl_t *impl = crypto1_bs_impl();
+    for (uint32_t i = 0; i < keycnt; i += CRYPTO1_BS_LANES) {
+        uint32_t n = keycnt - i;
+        if (n > CRYPTO1_BS_LANES) {
+            n = CRYPTO1_BS_LANES;
+        }
+        impl->keystream_block(keys + i, n, words, wordcnt, ks + (size_t)i * wordcnt);
+    }
+}
+
+bool crypto1_bs_check_nonces(const struct Crypto1State *s, uint32_t uid, const uint32_t *nt_enc, const uint8_t *par_enc, uint32_t cnt) {
+    const crypto1_bs_impl_t *impl = crypto1_bs_impl();
+    for (uint32_t i = 0; i < cnt; i += CRYPTO1_BS_LANES) {
+        uint32_t n = cnt - i;
+        if (n > CRYPTO1_BS_LANES) {
+            n = CRYPTO1_BS_LANES;
+        }
+        if (impl->check_nonces_block(s, uid, nt_enc + i, par_enc + i, n) == false) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Bitsliced Crypto1, runs CRYPTO1_BS_LANES ciphers side by side.
+// Host only, used to batch candidate key verification.
+//-----------------------------------------------------------------------------
+#ifndef CRYPTO1_BS_INCLUDED
+#define CRYPTO1_BS_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "crapto1.h"
+
+// number of ciphers clocked at once, callers get the best throughput when batching a multiple of it
+#define CRYPTO1_BS_LANES 256
+
+// one word shifted in, same meaning as crypto1_word(s, in, is_encrypted)
+typedef struct {
+    uint32_t in;
+    bool is_encrypted;
+} crypto1_bs_word_t;
+
+// Many keys against one input sequence.
+// Every key is loaded like crypto1_init() and clocked through `words`, ks[i * wordcnt + w] receives
+// the keystream crypto1_word() returns for words[w] under keys[i].
+void crypto1_bs_keystream(const uint64_t *keys, uint32_t keycnt, const crypto1_bs_word_t *words, uint32_t wordcnt, uint32_t *ks);
+
+// One state against many nested nonces.
+// Every nonce is shifted in from `s` like crypto1_word(s, nt_enc[i] ^ uid, 1) and the encrypted parity
+// bits are checked, bit 3 of par_enc[i] belongs to the first byte. Returns true if all nonces pass.
+bool crypto1_bs_check_nonces(const struct Crypto1State *s, uint32_t uid, const uint32_t *nt_enc, const uint8_t *par_enc, uint32_t cnt);
+
+// name of the instruction set in use
+const char *crypto1_bs_simd(void);
+
+#endif
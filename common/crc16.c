@@ -20,100 +20,277 @@
 #include <string.h>
 #include "commonutil.h"
 
-static uint16_t crc_table[256];
-static bool crc_table_init = false;
-static CrcType_t current_crc_type = CRC_NONE;
-
-void init_table(CrcType_t crctype) {
-
-    // same crc algo, and initialised already
-    if (crctype == current_crc_type && crc_table_init)
-        return;
-
-    // not the same crc algo. reset table.
-    if (crctype != current_crc_type)
-        reset_table();
-
-    current_crc_type = crctype;
+#ifndef ON_DEVICE
+#include <pthread.h>
+#endif
+
+enum {
+    CRC16_TABLE_CCITT,
+    CRC16_TABLE_CCITT_REFL,
+#ifndef ON_DEVICE
+    CRC16_TABLE_LEGIC_REFL,
+    CRC16_TABLE_LEGIC_16_REFL,
+#endif
+    CRC16_TABLE_COUNT
+};
+
+// precomputed lookup tables, one per polynomial and input reflection.
+// reflected tables are generated from the reflected input and reflected back, like the Crc16() bit loop.
+// the firmware only computes CCITT based crcs often enough to pay for a table, LEGIC stays client side.
+static const uint16_t crc16_tables[CRC16_TABLE_COUNT][256] = {
+    // CCITT
+    {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+        0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+        0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+        0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+        0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+        0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+        0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+        0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+        0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+        0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+        0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+        0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+        0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+        0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+        0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+        0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+        0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+        0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+        0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+        0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+        0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+        0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+        0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+        0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+        0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+        0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+        0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+        0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+        0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+        0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+        0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+    },
+    // CCITT reflected
+    {
+        0x0000, 0x1189, 0x2312, 0x329B, 0x4624, 0x57AD, 0x6536, 0x74BF,
+        0x8C48, 0x9DC1, 0xAF5A, 0xBED3, 0xCA6C, 0xDBE5, 0xE97E, 0xF8F7,
+        0x1081, 0x0108, 0x3393, 0x221A, 0x56A5, 0x472C, 0x75B7, 0x643E,
+        0x9CC9, 0x8D40, 0xBFDB, 0xAE52, 0xDAED, 0xCB64, 0xF9FF, 0xE876,
+        0x2102, 0x308B, 0x0210, 0x1399, 0x6726, 0x76AF, 0x4434, 0x55BD,
+        0xAD4A, 0xBCC3, 0x8E58, 0x9FD1, 0xEB6E, 0xFAE7, 0xC87C, 0xD9F5,
+        0x3183, 0x200A, 0x1291, 0x0318, 0x77A7, 0x662E, 0x54B5, 0x453C,
+        0xBDCB, 0xAC42, 0x9ED9, 0x8F50, 0xFBEF, 0xEA66, 0xD8FD, 0xC974,
+        0x4204, 0x538D, 0x6116, 0x709F, 0x0420, 0x15A9, 0x2732, 0x36BB,
+        0xCE4C, 0xDFC5, 0xED5E, 0xFCD7, 0x8868, 0x99E1, 0xAB7A, 0xBAF3,
+        0x5285, 0x430C, 0x7197, 0x601E, 0x14A1, 0x0528, 0x37B3, 0x263A,
+        0xDECD, 0xCF44, 0xFDDF, 0xEC56, 0x98E9, 0x8960, 0xBBFB, 0xAA72,
+        0x6306, 0x728F, 0x4014, 0x519D, 0x2522, 0x34AB, 0x0630, 0x17B9,
+        0xEF4E, 0xFEC7, 0xCC5C, 0xDDD5, 0xA96A, 0xB8E3, 0x8A78, 0x9BF1,
+        0x7387, 0x620E, 0x5095, 0x411C, 0x35A3, 0x242A, 0x16B1, 0x0738,
+        0xFFCF, 0xEE46, 0xDCDD, 0xCD54, 0xB9EB, 0xA862, 0x9AF9, 0x8B70,
+        0x8408, 0x9581, 0xA71A, 0xB693, 0xC22C, 0xD3A5, 0xE13E, 0xF0B7,
+        0x0840, 0x19C9, 0x2B52, 0x3ADB, 0x4E64, 0x5FED, 0x6D76, 0x7CFF,
+        0x9489, 0x8500, 0xB79B, 0xA612, 0xD2AD, 0xC324, 0xF1BF, 0xE036,
+        0x18C1, 0x0948, 0x3BD3, 0x2A5A, 0x5EE5, 0x4F6C, 0x7DF7, 0x6C7E,
+        0xA50A, 0xB483, 0x8618, 0x9791, 0xE32E, 0xF2A7, 0xC03C, 0xD1B5,
+        0x2942, 0x38CB, 0x0A50, 0x1BD9, 0x6F66, 0x7EEF, 0x4C74, 0x5DFD,
+        0xB58B, 0xA402, 0x9699, 0x8710, 0xF3AF, 0xE226, 0xD0BD, 0xC134,
+        0x39C3, 0x284A, 0x1AD1, 0x0B58, 0x7FE7, 0x6E6E, 0x5CF5, 0x4D7C,
+        0xC60C, 0xD785, 0xE51E, 0xF497, 0x8028, 0x91A1, 0xA33A, 0xB2B3,
+        0x4A44, 0x5BCD, 0x6956, 0x78DF, 0x0C60, 0x1DE9, 0x2F72, 0x3EFB,
+        0xD68D, 0xC704, 0xF59F, 0xE416, 0x90A9, 0x8120, 0xB3BB, 0xA232,
+        0x5AC5, 0x4B4C, 0x79D7, 0x685E, 0x1CE1, 0x0D68, 0x3FF3, 0x2E7A,
+        0xE70E, 0xF687, 0xC41C, 0xD595, 0xA12A, 0xB0A3, 0x8238, 0x93B1,
+        0x6B46, 0x7ACF, 0x4854, 0x59DD, 0x2D62, 0x3CEB, 0x0E70, 0x1FF9,
+        0xF78F, 0xE606, 0xD49D, 0xC514, 0xB1AB, 0xA022, 0x92B9, 0x8330,
+        0x7BC7, 0x6A4E, 0x58D5, 0x495C, 0x3DE3, 0x2C6A, 0x1EF1, 0x0F78
+    },
+#ifndef ON_DEVICE
+    // LEGIC reflected
+    {
+        0x0000, 0x0B11, 0x1622, 0x1D33, 0x2C44, 0x2755, 0x3A66, 0x3177,
+        0x5888, 0x5399, 0x4EAA, 0x45BB, 0x74CC, 0x7FDD, 0x62EE, 0x69FF,
+        0x77D7, 0x7CC6, 0x61F5, 0x6AE4, 0x5B93, 0x5082, 0x4DB1, 0x46A0,
+        0x2F5F, 0x244E, 0x397D, 0x326C, 0x031B, 0x080A, 0x1539, 0x1E28,
+        0x2969, 0x2278, 0x3F4B, 0x345A, 0x052D, 0x0E3C, 0x130F, 0x181E,
+        0x71E1, 0x7AF0, 0x67C3, 0x6CD2, 0x5DA5, 0x56B4, 0x4B87, 0x4096,
+        0x5EBE, 0x55AF, 0x489C, 0x438D, 0x72FA, 0x79EB, 0x64D8, 0x6FC9,
+        0x0636, 0x0D27, 0x1014, 0x1B05, 0x2A72, 0x2163, 0x3C50, 0x3741,
+        0x52D2, 0x59C3, 0x44F0, 0x4FE1, 0x7E96, 0x7587, 0x68B4, 0x63A5,
+        0x0A5A, 0x014B, 0x1C78, 0x1769, 0x261E, 0x2D0F, 0x303C, 0x3B2D,
+        0x2505, 0x2E14, 0x3327, 0x3836, 0x0941, 0x0250, 0x1F63, 0x1472,
+        0x7D8D, 0x769C, 0x6BAF, 0x60BE, 0x51C9, 0x5AD8, 0x47EB, 0x4CFA,
+        0x7BBB, 0x70AA, 0x6D99, 0x6688, 0x57FF, 0x5CEE, 0x41DD, 0x4ACC,
+        0x2333, 0x2822, 0x3511, 0x3E00, 0x0F77, 0x0466, 0x1955, 0x1244,
+        0x0C6C, 0x077D, 0x1A4E, 0x115F, 0x2028, 0x2B39, 0x360A, 0x3D1B,
+        0x54E4, 0x5FF5, 0x42C6, 0x49D7, 0x78A0, 0x73B1, 0x6E82, 0x6593,
+        0x6363, 0x6872, 0x7541, 0x7E50, 0x4F27, 0x4436, 0x5905, 0x5214,
+        0x3BEB, 0x30FA, 0x2DC9, 0x26D8, 0x17AF, 0x1CBE, 0x018D, 0x0A9C,
+        0x14B4, 0x1FA5, 0x0296, 0x0987, 0x38F0, 0x33E1, 0x2ED2, 0x25C3,
+        0x4C3C, 0x472D, 0x5A1E, 0x510F, 0x6078, 0x6B69, 0x765A, 0x7D4B,
+        0x4A0A, 0x411B, 0x5C28, 0x5739, 0x664E, 0x6D5F, 0x706C, 0x7B7D,
+        0x1282, 0x1993, 0x04A0, 0x0FB1, 0x3EC6, 0x35D7, 0x28E4, 0x23F5,
+        0x3DDD, 0x36CC, 0x2BFF, 0x20EE, 0x1199, 0x1A88, 0x07BB, 0x0CAA,
+        0x6555, 0x6E44, 0x7377, 0x7866, 0x4911, 0x4200, 0x5F33, 0x5422,
+        0x31B1, 0x3AA0, 0x2793, 0x2C82, 0x1DF5, 0x16E4, 0x0BD7, 0x00C6,
+        0x6939, 0x6228, 0x7F1B, 0x740A, 0x457D, 0x4E6C, 0x535F, 0x584E,
+        0x4666, 0x4D77, 0x5044, 0x5B55, 0x6A22, 0x6133, 0x7C00, 0x7711,
+        0x1EEE, 0x15FF, 0x08CC, 0x03DD, 0x32AA, 0x39BB, 0x2488, 0x2F99,
+        0x18D8, 0x13C9, 0x0EFA, 0x05EB, 0x349C, 0x3F8D, 0x22BE, 0x29AF,
+        0x4050, 0x4B41, 0x5672, 0x5D63, 0x6C14, 0x6705, 0x7A36, 0x7127,
+        0x6F0F, 0x641E, 0x792D, 0x723C, 0x434B, 0x485A, 0x5569, 0x5E78,
+        0x3787, 0x3C96, 0x21A5, 0x2AB4, 0x1BC3, 0x10D2, 0x0DE1, 0x06F0
+    },
+    // LEGIC_16 reflected
+    {
+        0x0000, 0x0168, 0x02D0, 0x03B8, 0x05A0, 0x04C8, 0x0770, 0x0618,
+        0x0B40, 0x0A28, 0x0990, 0x08F8, 0x0EE0, 0x0F88, 0x0C30, 0x0D58,
+        0x1680, 0x17E8, 0x1450, 0x1538, 0x1320, 0x1248, 0x11F0, 0x1098,
+        0x1DC0, 0x1CA8, 0x1F10, 0x1E78, 0x1860, 0x1908, 0x1AB0, 0x1BD8,
+        0x2D00, 0x2C68, 0x2FD0, 0x2EB8, 0x28A0, 0x29C8, 0x2A70, 0x2B18,
+        0x2640, 0x2728, 0x2490, 0x25F8, 0x23E0, 0x2288, 0x2130, 0x2058,
+        0x3B80, 0x3AE8, 0x3950, 0x3838, 0x3E20, 0x3F48, 0x3CF0, 0x3D98,
+        0x30C0, 0x31A8, 0x3210, 0x3378, 0x3560, 0x3408, 0x37B0, 0x36D8,
+        0x5A00, 0x5B68, 0x58D0, 0x59B8, 0x5FA0, 0x5EC8, 0x5D70, 0x5C18,
+        0x5140, 0x5028, 0x5390, 0x52F8, 0x54E0, 0x5588, 0x5630, 0x5758,
+        0x4C80, 0x4DE8, 0x4E50, 0x4F38, 0x4920, 0x4848, 0x4BF0, 0x4A98,
+        0x47C0, 0x46A8, 0x4510, 0x4478, 0x4260, 0x4308, 0x40B0, 0x41D8,
+        0x7700, 0x7668, 0x75D0, 0x74B8, 0x72A0, 0x73C8, 0x7070, 0x7118,
+        0x7C40, 0x7D28, 0x7E90, 0x7FF8, 0x79E0, 0x7888, 0x7B30, 0x7A58,
+        0x6180, 0x60E8, 0x6350, 0x6238, 0x6420, 0x6548, 0x66F0, 0x6798,
+        0x6AC0, 0x6BA8, 0x6810, 0x6978, 0x6F60, 0x6E08, 0x6DB0, 0x6CD8,
+        0xB400, 0xB568, 0xB6D0, 0xB7B8, 0xB1A0, 0xB0C8, 0xB370, 0xB218,
+        0xBF40, 0xBE28, 0xBD90, 0xBCF8, 0xBAE0, 0xBB88, 0xB830, 0xB958,
+        0xA280, 0xA3E8, 0xA050, 0xA138, 0xA720, 0xA648, 0xA5F0, 0xA498,
+        0xA9C0, 0xA8A8, 0xAB10, 0xAA78, 0xAC60, 0xAD08, 0xAEB0, 0xAFD8,
+        0x9900, 0x9868, 0x9BD0, 0x9AB8, 0x9CA0, 0x9DC8, 0x9E70, 0x9F18,
+        0x9240, 0x9328, 0x9090, 0x91F8, 0x97E0, 0x9688, 0x9530, 0x9458,
+        0x8F80, 0x8EE8, 0x8D50, 0x8C38, 0x8A20, 0x8B48, 0x88F0, 0x8998,
+        0x84C0, 0x85A8, 0x8610, 0x8778, 0x8160, 0x8008, 0x83B0, 0x82D8,
+        0xEE00, 0xEF68, 0xECD0, 0xEDB8, 0xEBA0, 0xEAC8, 0xE970, 0xE818,
+        0xE540, 0xE428, 0xE790, 0xE6F8, 0xE0E0, 0xE188, 0xE230, 0xE358,
+        0xF880, 0xF9E8, 0xFA50, 0xFB38, 0xFD20, 0xFC48, 0xFFF0, 0xFE98,
+        0xF3C0, 0xF2A8, 0xF110, 0xF078, 0xF660, 0xF708, 0xF4B0, 0xF5D8,
+        0xC300, 0xC268, 0xC1D0, 0xC0B8, 0xC6A0, 0xC7C8, 0xC470, 0xC518,
+        0xC840, 0xC928, 0xCA90, 0xCBF8, 0xCDE0, 0xCC88, 0xCF30, 0xCE58,
+        0xD580, 0xD4E8, 0xD750, 0xD638, 0xD020, 0xD148, 0xD2F0, 0xD398,
+        0xDEC0, 0xDFA8, 0xDC10, 0xDD78, 0xDB60, 0xDA08, 0xD9B0, 0xD8D8
+    }
+#endif
+};
+
+#ifndef ON_DEVICE
+// slice-by-8, row k holds the crc of a byte followed by k zero bytes. Row 0 is the table above.
+static uint16_t crc16_slice[CRC16_TABLE_COUNT][8][256];
+static pthread_once_t crc16_slice_once = PTHREAD_ONCE_INIT;
+
+static void crc16_slice_init(void) {
+    for (int t = 0; t < CRC16_TABLE_COUNT; t++) {
+        bool refl = (t != CRC16_TABLE_CCITT);
+        memcpy(crc16_slice[t][0], crc16_tables[t], sizeof(crc16_tables[t]));
+        for (int k = 1; k < 8; k++) {
+            for (int i = 0; i < 256; i++) {
+                uint16_t c = crc16_slice[t][k - 1][i];
+                if (refl)
+                    crc16_slice[t][k][i] = (c >> 8) ^ crc16_tables[t][c & 0xFF];
+                else
+                    crc16_slice[t][k][i] = (uint16_t)(c << 8) ^ crc16_tables[t][c >> 8];
+            }
+        }
+    }
+}
+#endif
 
-    switch (crctype) {
+// which table a crc type uses, and if its input is reflected. -1 for CRC_NONE
+static int crc16_table_id(CrcType_t ct, bool *refin) {
+    switch (ct) {
         case CRC_14443_A:
         case CRC_14443_B:
         case CRC_15693:
         case CRC_ICLASS:
         case CRC_CRYPTORF:
         case CRC_KERMIT:
-            generate_table(CRC16_POLY_CCITT, true);
-            break;
+            *refin = true;
+            return CRC16_TABLE_CCITT_REFL;
         case CRC_FELICA:
         case CRC_XMODEM:
         case CRC_CCITT:
         case CRC_11784:
         case CRC_PHILIPS:
-            generate_table(CRC16_POLY_CCITT, false);
-            break;
+            *refin = false;
+            return CRC16_TABLE_CCITT;
+#ifndef ON_DEVICE
         case CRC_LEGIC:
-            generate_table(CRC16_POLY_LEGIC, true);
-            break;
+            *refin = true;
+            return CRC16_TABLE_LEGIC_REFL;
         case CRC_LEGIC_16:
-            generate_table(CRC16_POLY_LEGIC_16, true);
-            break;
+            *refin = true;
+            return CRC16_TABLE_LEGIC_16_REFL;
+#endif
         case CRC_NONE:
-            crc_table_init = false;
-            current_crc_type = CRC_NONE;
+        default:
             break;
     }
-}
-
-void generate_table(uint16_t polynomial, bool refin) {
-
-    for (uint16_t i = 0; i < 256; i++) {
-        uint16_t c, crc = 0;
-        if (refin)
-            c = reflect8(i) << 8;
-        else
-            c = i << 8;
-
-        for (uint16_t j = 0; j < 8; j++) {
-
-            if ((crc ^ c) & 0x8000)
-                crc = (crc << 1) ^ polynomial;
-            else
-                crc =   crc << 1;
-
-            c = c << 1;
-        }
-        if (refin)
-            crc = reflect16(crc);
-
-        crc_table[i] = crc;
-    }
-    crc_table_init = true;
-}
-
-void reset_table(void) {
-    memset(crc_table, 0, sizeof(crc_table));
-    crc_table_init = false;
-    current_crc_type = CRC_NONE;
+    *refin = false;
+    return -1;
 }
 
 // table lookup LUT solution
-uint16_t crc16_fast(uint8_t const *d, size_t n, uint16_t initval, bool refin, bool refout) {
+uint16_t crc16_fast(CrcType_t ct, uint8_t const *d, size_t n, uint16_t initval, bool refout) {
 
     // fast lookup table algorithm without augmented zero bytes, e.g. used in pkzip.
     // only usable with polynom orders of 8, 16, 24 or 32.
     if (n == 0)
         return (~initval);
 
+#ifdef ON_DEVICE
+    // no LEGIC tables on device, use the bit loop
+    if (ct == CRC_LEGIC)
+        return Crc16(d, n, initval, CRC16_POLY_LEGIC, true, refout);
+    if (ct == CRC_LEGIC_16)
+        return Crc16(d, n, initval, CRC16_POLY_LEGIC_16, true, refout);
+#endif
+
+    bool refin;
+    int id = crc16_table_id(ct, &refin);
+    if (id < 0)
+        return 0;
+
+    const uint16_t *table = crc16_tables[id];
     uint16_t crc = initval;
 
     if (refin)
         crc = reflect16(crc);
 
+#ifndef ON_DEVICE
+    if (n >= 8) {
+        pthread_once(&crc16_slice_once, crc16_slice_init);
+        const uint16_t (*s)[256] = crc16_slice[id];
+
+        // the first two bytes are folded into the crc, the other six only index their row
+        if (refin) {
+            for (; n >= 8; n -= 8, d += 8) {
+                crc ^= d[0] | (d[1] << 8);
+                crc = s[7][crc & 0xFF] ^ s[6][crc >> 8] ^ s[5][d[2]] ^ s[4][d[3]] ^
+                      s[3][d[4]] ^ s[2][d[5]] ^ s[1][d[6]] ^ s[0][d[7]];
+            }
+        } else {
+            for (; n >= 8; n -= 8, d += 8) {
+                crc ^= (d[0] << 8) | d[1];
+                crc = s[7][crc >> 8] ^ s[6][crc & 0xFF] ^ s[5][d[2]] ^ s[4][d[3]] ^
+                      s[3][d[4]] ^ s[2][d[5]] ^ s[1][d[6]] ^ s[0][d[7]];
+            }
+        }
+    }
+#endif
+
     if (!refin)
-        while (n--) crc = (crc << 8) ^ crc_table[((crc >> 8) ^ *d++) & 0xFF ];
+        while (n--) crc = (crc << 8) ^ table[((crc >> 8) ^ *d++) & 0xFF ];
     else
-        while (n--) crc = (crc >> 8) ^ crc_table[(crc & 0xFF) ^ *d++];
+        while (n--) crc = (crc >> 8) ^ table[(crc & 0xFF) ^ *d++];
 
     if (refout ^ refin)
         crc = reflect16(crc);
@@ -173,8 +350,6 @@ void compute_crc(CrcType_t ct, const uint8_t *d, size_t n, uint8_t *first, uint8
     // can't calc a crc on less than 1 byte
     if (n == 0) return;
 
-    init_table(ct);
-
     uint16_t crc = 0;
     switch (ct) {
         case CRC_14443_A:
@@ -219,7 +394,6 @@ uint16_t Crc16ex(CrcType_t ct, const uint8_t *d, size_t n) {
     // can't calc a crc on less than 3 byte. (1byte + 2 crc bytes)
     if (n < 3) return 0;
 
-    init_table(ct);
     switch (ct) {
         case CRC_14443_A:
             return crc16_a(d, n);
@@ -265,8 +439,6 @@ bool check_crc(CrcType_t ct, const uint8_t *d, size_t n) {
     // can't calc a crc on less than 3 byte. (1byte + 2 crc bytes)
     if (n < 3) return false;
 
-    init_table(ct);
-
     switch (ct) {
         case CRC_14443_A:
             return (crc16_a(d, n) == 0);
@@ -301,24 +473,24 @@ bool check_crc(CrcType_t ct, const uint8_t *d, size_t n) {
 
 // poly=0x1021  init=0xffff  refin=false  refout=false  xorout=0x0000  check=0x29b1  residue=0x0000  name="CRC-16/CCITT-FALSE"
 uint16_t crc16_ccitt(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0xffff, false, false);
+    return crc16_fast(CRC_CCITT, d, n, 0xffff, false);
 }
 
 // FDX-B ISO11784/85) uses KERMIT/CCITT
 // poly 0x xx  init=0x000  refin=false  refout=true  xorout=0x0000 ...
 uint16_t crc16_fdxb(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, false, true);
+    return crc16_fast(CRC_11784, d, n, 0x0000, true);
 }
 
 // poly=0x1021  init=0x0000  refin=true  refout=true  xorout=0x0000 name="KERMIT"
 uint16_t crc16_kermit(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, true, true);
+    return crc16_fast(CRC_KERMIT, d, n, 0x0000, true);
 }
 
 // FeliCa uses XMODEM
 // poly=0x1021  init=0x0000  refin=false  refout=false  xorout=0x0000 name="XMODEM"
 uint16_t crc16_xmodem(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, false, false);
+    return crc16_fast(CRC_XMODEM, d, n, 0x0000, false);
 }
 
 // Following standards uses X-25
@@ -327,14 +499,14 @@ uint16_t crc16_xmodem(uint8_t const *d, size_t n) {
 //   ISO/IEC 13239 (formerly ISO/IEC 3309)
 // poly=0x1021  init=0xffff  refin=true  refout=true  xorout=0xffff name="X-25"
 uint16_t crc16_x25(uint8_t const *d, size_t n) {
-    uint16_t crc = crc16_fast(d, n, 0xffff, true, true);
+    uint16_t crc = crc16_fast(CRC_15693, d, n, 0xffff, true);
     crc = ~crc;
     return crc;
 }
 // CRC-A (14443-3)
 // poly=0x1021 init=0xc6c6 refin=true refout=true xorout=0x0000 name="CRC-A"
 uint16_t crc16_a(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0xC6C6, true, true);
+    return crc16_fast(CRC_14443_A, d, n, 0xC6C6, true);
 }
 
 // iClass crc
@@ -342,16 +514,16 @@ uint16_t crc16_a(uint8_t const *d, size_t n) {
 // poly       0x1021 reflected 0x8408
 // poly=0x1021  init=0x4807  refin=true  refout=true  xorout=0x0BC3  check=0xF0B8  name="CRC-16/ICLASS"
 uint16_t crc16_iclass(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x4807, true, true);
+    return crc16_fast(CRC_ICLASS, d, n, 0x4807, true);
 }
 
 // This CRC-16 is used in Legic Advant systems.
 // poly=0xB400,  init=depends  refin=true  refout=true  xorout=0x0000  check=  name="CRC-16/LEGIC"
 uint16_t crc16_legic(uint8_t const *d, size_t n, uint8_t uidcrc) {
     uint16_t initial = (uidcrc << 8 | uidcrc);
-    return crc16_fast(d, n, initial, true, false);
+    return crc16_fast(CRC_LEGIC_16, d, n, initial, false);
 }
 
 uint16_t crc16_philips(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x49A3, false, false);
+    return crc16_fast(CRC_PHILIPS, d, n, 0x49A3, false);
 }
@@ -82,10 +82,9 @@ uint16_t crc16_legic(uint8_t const *d, size_t n, uint8_t uidcrc);
 // Calculate CRC-16/ Philips.
 uint16_t crc16_philips(uint8_t const *d, size_t n);
 
-// table implementation
-void init_table(CrcType_t crctype);
-void reset_table(void);
-void generate_table(uint16_t polynomial, bool refin);
-uint16_t crc16_fast(uint8_t const *d, size_t n, uint16_t initval, bool refin, bool refout);
+// table implementation, reentrant.
+// Every crc type has its own precomputed table, which also decides if the input is reflected.
+// initval is given unreflected, like in Crc16()
+uint16_t crc16_fast(CrcType_t ct, uint8_t const *d, size_t n, uint16_t initval, bool refout);
 
 #endif
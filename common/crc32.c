@@ -15,6 +15,10 @@
 //-----------------------------------------------------------------------------
 #include "crc32.h"
 
+#ifndef ON_DEVICE
+#include <pthread.h>
+#endif
+
 #define htole32(x) (x)
 #define CRC32_PRESET 0xFFFFFFFF
 
@@ -33,18 +37,51 @@ static void crc32_byte(uint32_t *crc, const uint8_t value) {
     }
 }
 
+#ifndef ON_DEVICE
+// slice-by-8, row k holds the crc of a byte followed by k zero bytes
+static uint32_t crc32_slice[8][256];
+static pthread_once_t crc32_slice_once = PTHREAD_ONCE_INIT;
+
+static void crc32_slice_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = 0;
+        crc32_byte(&c, i);
+        crc32_slice[0][i] = c;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int i = 0; i < 256; i++) {
+            uint32_t c = crc32_slice[k - 1][i];
+            crc32_slice[k][i] = (c >> 8) ^ crc32_slice[0][c & 0xFF];
+        }
+    }
+}
+#endif
+
 void crc32_ex(const uint8_t *d, const size_t n, uint8_t *crc) {
     uint32_t c = CRC32_PRESET;
+#ifdef ON_DEVICE
     for (size_t i = 0; i < n; i++) {
         crc32_byte(&c, d[i]);
     }
+#else
+    pthread_once(&crc32_slice_once, crc32_slice_init);
+    const uint32_t (*s)[256] = crc32_slice;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        c ^= d[i] | (d[i + 1] << 8) | (d[i + 2] << 16) | ((uint32_t)d[i + 3] << 24);
+        c = s[7][c & 0xFF] ^ s[6][(c >> 8) & 0xFF] ^ s[5][(c >> 16) & 0xFF] ^ s[4][c >> 24] ^
+            s[3][d[i + 4]] ^ s[2][d[i + 5]] ^ s[1][d[i + 6]] ^ s[0][d[i + 7]];
+    }
+    for (; i < n; i++) {
+        c = (c >> 8) ^ s[0][(c ^ d[i]) & 0xFF];
+    }
+#endif
     crc[0] = (uint8_t) c;
     crc[1] = (uint8_t)(c >> 8);
     crc[2] = (uint8_t)(c >> 16);
     crc[3] = (uint8_t)(c >> 24);
 }
 
-
 void crc32_append(uint8_t *d, const size_t n) {
     crc32_ex(d, n, d + n);
 }
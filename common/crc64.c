@@ -15,6 +15,9 @@
 //-----------------------------------------------------------------------------
 #include "crc64.h"
 
+#include <string.h>
+#include <pthread.h>
+
 #define CRC64_ISO_PRESET 0xFFFFFFFFFFFFFFFF
 #define CRC64_ECMA_PRESET 0x0000000000000000
 
@@ -85,12 +88,39 @@ static const uint64_t crc64_table[] = {
     0x5DEDC41A34BBEEB2, 0x1F1D25F19D51D821, 0xD80C07CD676F8394, 0x9AFCE626CE85B507
 };
 
+// slice-by-8, row k holds the crc of a byte followed by k zero bytes. Row 0 is crc64_table
+static uint64_t crc64_slice[8][256];
+static pthread_once_t crc64_slice_once = PTHREAD_ONCE_INIT;
+
+static void crc64_slice_init(void) {
+    memcpy(crc64_slice[0], crc64_table, sizeof(crc64_slice[0]));
+    for (int k = 1; k < 8; k++) {
+        for (int i = 0; i < 256; i++) {
+            uint64_t c = crc64_slice[k - 1][i];
+            crc64_slice[k][i] = (c << 8) ^ crc64_table[c >> 56];
+        }
+    }
+}
+
 void crc64(const uint8_t *data, const size_t len, uint64_t *crc) {
 
-    for (size_t i = 0; i < len; i++) {
-        uint8_t tableIndex = (((uint8_t)(*crc >> 56)) ^ data[i]) & 0xff;
-        *crc = crc64_table[tableIndex] ^ (*crc << 8);
+    pthread_once(&crc64_slice_once, crc64_slice_init);
+    const uint64_t (*s)[256] = crc64_slice;
+
+    uint64_t c = *crc;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        // msb first, the first data byte meets the top byte of the crc
+        uint64_t x = c ^ ((uint64_t)data[i] << 56 | (uint64_t)data[i + 1] << 48 | (uint64_t)data[i + 2] << 40 | (uint64_t)data[i + 3] << 32 |
+                          (uint64_t)data[i + 4] << 24 | (uint64_t)data[i + 5] << 16 | (uint64_t)data[i + 6] << 8 | data[i + 7]);
+        c = s[7][x >> 56] ^ s[6][(x >> 48) & 0xFF] ^ s[5][(x >> 40) & 0xFF] ^ s[4][(x >> 32) & 0xFF] ^
+            s[3][(x >> 24) & 0xFF] ^ s[2][(x >> 16) & 0xFF] ^ s[1][(x >> 8) & 0xFF] ^ s[0][x & 0xFF];
+    }
+    for (; i < len; i++) {
+        uint8_t tableIndex = (((uint8_t)(c >> 56)) ^ data[i]) & 0xff;
+        c = crc64_table[tableIndex] ^ (c << 8);
     }
+    *crc = c;
 }
 
 //suint8_t x = (c & 0xFF00000000000000 ) >> 56;
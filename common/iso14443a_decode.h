@@ -0,0 +1,429 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Gerhard de Koning Gans - May 2008
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// ISO 14443 type A bit decoders, shared by the firmware and host tools.
+//
+// The state machines work on a state pointer so the same code can run in the
+// firmware sniff / sim / reader loops and in host replays (tools/hf_replay).
+// On device they are forced inline into the RAMFUNC entry points in armsrc/iso14443a.c,
+// so the generated code is the same as when they lived there.
+//-----------------------------------------------------------------------------
+#ifndef __ISO14443A_DECODE_H
+#define __ISO14443A_DECODE_H
+
+#include "common.h"
+
+#ifdef ON_DEVICE
+# include "ticks.h"
+# define HF14A_DECODE_NOW()  (GetCountSspClk() & 0xfffffff8)
+#else
+// no clock on the host, callers must provide a timestamp
+# define HF14A_DECODE_NOW()  0
+#endif
+
+#define HF14A_DECODE_INLINE  static inline __attribute__((always_inline))
+
+typedef struct {
+    enum {
+        DEMOD_14A_UNSYNCD,
+        // DEMOD_14A_HALF_SYNCD,
+        // DEMOD_14A_MOD_FIRST_HALF,
+        // DEMOD_14A_NOMOD_FIRST_HALF,
+        DEMOD_14A_MANCHESTER_DATA
+    } state;
+    uint16_t twoBits;
+    uint16_t highCnt;
+    uint16_t bitCount;
+    uint16_t collisionPos;
+    uint16_t syncBit;
+    uint8_t  parityBits;
+    uint8_t  parityLen;
+    uint16_t shiftReg;
+    uint16_t samples;
+    uint16_t len;
+    uint32_t startTime;
+    uint32_t endTime;
+    uint16_t output_len;
+    uint8_t  *output;
+    uint8_t  *parity;
+} tDemod14a;
+/*
+typedef enum {
+    MOD_NOMOD = 0,
+    MOD_SECOND_HALF,
+    MOD_FIRST_HALF,
+    MOD_BOTH_HALVES
+    } Modulation_t;
+*/
+
+typedef struct {
+    enum {
+        STATE_14A_UNSYNCD,
+        STATE_14A_START_OF_COMMUNICATION,
+        STATE_14A_MILLER_X,
+        STATE_14A_MILLER_Y,
+        STATE_14A_MILLER_Z,
+        // DROP_NONE,
+        // DROP_FIRST_HALF,
+    } state;
+    uint16_t shiftReg;
+    int16_t bitCount;
+    uint16_t len;
+    //uint16_t byteCntMax;
+    uint16_t posCnt;
+    uint16_t syncBit;
+    uint8_t  parityBits;
+    uint8_t  parityLen;
+    uint32_t fourBits;
+    uint32_t startTime;
+    uint32_t endTime;
+    uint16_t output_len;
+    uint8_t *output;
+    uint8_t *parity;
+} tUart14a;
+
+//=============================================================================
+// ISO 14443 Type A - Miller decoder
+//=============================================================================
+// Basics:
+// This decoder is used when the PM3 acts as a tag.
+// The reader will generate "pauses" by temporarily switching of the field.
+// At the PM3 antenna we will therefore measure a modulated antenna voltage.
+// The FPGA does a comparison with a threshold and would deliver e.g.:
+// ........  1 1 1 1 1 1 0 0 1 1 1 1 1 1 1 1 1 1 0 0 1 1 1 1 1 1 1 1 1 1  .......
+// The Miller decoder needs to identify the following sequences:
+// 2 (or 3) ticks pause followed by 6 (or 5) ticks unmodulated: pause at beginning - Sequence Z ("start of communication" or a "0")
+// 8 ticks without a modulation:                                no pause - Sequence Y (a "0" or "end of communication" or "no information")
+// 4 ticks unmodulated followed by 2 (or 3) ticks pause:        pause in second half - Sequence X (a "1")
+// Note 1: the bitstream may start at any time. We therefore need to sync.
+// Note 2: the interpretation of Sequence Y and Z depends on the preceding sequence.
+//-----------------------------------------------------------------------------
+// Lookup-Table to decide if 4 raw bits are a modulation.
+// We accept the following:
+// 0001  -   a 3 tick wide pause
+// 0011  -   a 2 tick wide pause, or a three tick wide pause shifted left
+// 0111  -   a 2 tick wide pause shifted left
+// 1001  -   a 2 tick wide pause shifted right
+static const bool Mod_Miller_LUT[] = {
+    false,  true, false, true,  false, false, false, true,
+    false,  true, false, false, false, false, false, false
+};
+#define IsMillerModulationNibble1(b) (Mod_Miller_LUT[(b & 0x000000F0) >> 4])
+#define IsMillerModulationNibble2(b) (Mod_Miller_LUT[(b & 0x0000000F)])
+
+HF14A_DECODE_INLINE void Uart14aResetEx(tUart14a *uart) {
+    uart->state = STATE_14A_UNSYNCD;
+    uart->bitCount = 0;
+    uart->len = 0;                       // number of decoded data bytes
+    uart->parityLen = 0;                 // number of decoded parity bytes
+    uart->shiftReg = 0;                  // shiftreg to hold decoded data bits
+    uart->parityBits = 0;                // holds 8 parity bits
+    uart->startTime = 0;
+    uart->endTime = 0;
+    uart->fourBits = 0x00000000;         // clear the buffer for 4 Bits
+    uart->posCnt = 0;
+    uart->syncBit = 9999;
+}
+
+// use parameter non_real_time to provide a timestamp. Set to 0 if the decoder should measure real time
+HF14A_DECODE_INLINE bool MillerDecodingEx(tUart14a *uart, uint8_t bit, uint32_t non_real_time) {
+
+    if (uart->len == uart->output_len) {
+        return true;
+    }
+
+    uart->fourBits = (uart->fourBits << 8) | bit;
+
+    if (uart->state == STATE_14A_UNSYNCD) {                                           // not yet synced
+        uart->syncBit = 9999;                                                 // not set
+
+        // 00x11111 2|3 ticks pause followed by 6|5 ticks unmodulated         Sequence Z (a "0" or "start of communication")
+        // 11111111 8 ticks unmodulation                                      Sequence Y (a "0" or "end of communication" or "no information")
+        // 111100x1 4 ticks unmodulated followed by 2|3 ticks pause           Sequence X (a "1")
+
+        // The start bit is one ore more Sequence Y followed by a Sequence Z (... 11111111 00x11111). We need to distinguish from
+        // Sequence X followed by Sequence Y followed by Sequence Z     (111100x1 11111111 00x11111)
+        // we therefore look for a ...xx1111 11111111 00x11111xxxxxx... pattern
+        // (12 '1's followed by 2 '0's, eventually followed by another '0', followed by 5 '1's)
+#define ISO14443A_STARTBIT_MASK       0x07FFEF80                            // mask is    00000111 11111111 11101111 10000000
+#define ISO14443A_STARTBIT_PATTERN    0x07FF8F80                            // pattern is 00000111 11111111 10001111 10000000
+        if ((uart->fourBits & (ISO14443A_STARTBIT_MASK >> 0)) == ISO14443A_STARTBIT_PATTERN >> 0) uart->syncBit = 7;
+        else if ((uart->fourBits & (ISO14443A_STARTBIT_MASK >> 1)) == ISO14443A_STARTBIT_PATTERN >> 1) uart->syncBit = 6;
+        else if ((uart->fourBits & (ISO14443A_STARTBIT_MASK >> 2)) == ISO14443A_STARTBIT_PATTERN >> 2) uart->syncBit = 5;
+        else if ((uart->fourBits & (ISO14443A_STARTBIT_MASK >> 3)) == ISO14443A_STARTBIT_PATTERN >> 3) uart->syncBit = 4;
+        else if ((uart->fourBits & (ISO14443A_STARTBIT_MASK >> 4)) == ISO14443A_STARTBIT_PATTERN >> 4) uart->syncBit = 3;
+        else if ((uart->fourBits & (ISO14443A_STARTBIT_MASK >> 5)) == ISO14443A_STARTBIT_PATTERN >> 5) uart->syncBit = 2;
+        else if ((uart->fourBits & (ISO14443A_STARTBIT_MASK >> 6)) == ISO14443A_STARTBIT_PATTERN >> 6) uart->syncBit = 1;
+        else if ((uart->fourBits & (ISO14443A_STARTBIT_MASK >> 7)) == ISO14443A_STARTBIT_PATTERN >> 7) uart->syncBit = 0;
+
+        if (uart->syncBit != 9999) {                                              // found a sync bit
+            uart->startTime = (non_real_time) ? non_real_time : HF14A_DECODE_NOW();
+            uart->startTime -= uart->syncBit;
+            uart->endTime = uart->startTime;
+            uart->state = STATE_14A_START_OF_COMMUNICATION;
+        }
+
+    } else {
+
+        if (IsMillerModulationNibble1(uart->fourBits >> uart->syncBit)) {
+
+            if (IsMillerModulationNibble2(uart->fourBits >> uart->syncBit)) {      // Modulation in both halves - error
+                Uart14aResetEx(uart);
+            } else {                                                             // Modulation in first half = Sequence Z = logic "0"
+
+                if (uart->state == STATE_14A_MILLER_X) {                              // error - must not follow after X
+                    Uart14aResetEx(uart);
+                } else {
+                    uart->bitCount++;
+                    uart->shiftReg = (uart->shiftReg >> 1);                        // add a 0 to the shiftreg
+                    uart->state = STATE_14A_MILLER_Z;
+                    uart->endTime = uart->startTime + 8 * (9 * uart->len + uart->bitCount + 1) - 6;
+
+                    if (uart->bitCount >= 9) {                                    // if we decoded a full byte (including parity)
+                        uart->output[uart->len++] = (uart->shiftReg & 0xff);
+                        uart->parityBits <<= 1;                                   // make room for the parity bit
+                        uart->parityBits |= ((uart->shiftReg >> 8) & 0x01);        // store parity bit
+                        uart->bitCount = 0;
+                        uart->shiftReg = 0;
+                        if ((uart->len & 0x0007) == 0) {                          // every 8 data bytes
+                            uart->parity[uart->parityLen++] = uart->parityBits;     // store 8 parity bits
+                            uart->parityBits = 0;
+                        }
+                    }
+                }
+            }
+        } else {
+
+            if (IsMillerModulationNibble2(uart->fourBits >> uart->syncBit)) {      // Modulation second half = Sequence X = logic "1"
+
+                uart->bitCount++;
+                uart->shiftReg = (uart->shiftReg >> 1) | 0x100;                    // add a 1 to the shiftreg
+                uart->state = STATE_14A_MILLER_X;
+                uart->endTime = uart->startTime + 8 * (9 * uart->len + uart->bitCount + 1) - 2;
+
+                if (uart->bitCount >= 9) {                                        // if we decoded a full byte (including parity)
+
+                    uart->output[uart->len++] = (uart->shiftReg & 0xff);
+                    uart->parityBits <<= 1;                                       // make room for the new parity bit
+                    uart->parityBits |= ((uart->shiftReg >> 8) & 0x01);            // store parity bit
+                    uart->bitCount = 0;
+                    uart->shiftReg = 0;
+
+                    if ((uart->len & 0x0007) == 0) {                              // every 8 data bytes
+                        uart->parity[uart->parityLen++] = uart->parityBits;         // store 8 parity bits
+                        uart->parityBits = 0;
+                    }
+                }
+
+            } else {                                                             // no modulation in both halves - Sequence Y
+
+                if (uart->state == STATE_14A_MILLER_Z || uart->state == STATE_14A_MILLER_Y) {    // Y after logic "0" - End of Communication
+
+                    uart->state = STATE_14A_UNSYNCD;
+                    uart->bitCount--;                                             // last "0" was part of EOC sequence
+                    uart->shiftReg <<= 1;                                         // drop it
+
+                    if (uart->bitCount > 0) {                                     // if we decoded some bits
+                        uart->shiftReg >>= (9 - uart->bitCount);                   // right align them
+                        uart->output[uart->len++] = (uart->shiftReg & 0xff);        // add last byte to the output
+                        uart->parityBits <<= 1;                                   // add a (void) parity bit
+                        uart->parityBits <<= (8 - (uart->len & 0x0007));           // left align parity bits
+                        uart->parity[uart->parityLen++] = uart->parityBits;         // and store it
+                        return true;
+                    }
+
+                    if (uart->len & 0x0007) {                                     // there are some parity bits to store
+                        uart->parityBits <<= (8 - (uart->len & 0x0007));           // left align remaining parity bits
+                        uart->parity[uart->parityLen++] = uart->parityBits;         // and store them
+                    }
+
+                    if (uart->len) {
+                        return true;                                             // we are finished with decoding the raw data sequence
+                    } else {
+                        Uart14aResetEx(uart);                                             // Nothing received - start over
+                        return false;
+                    }
+                }
+
+                if (uart->state == STATE_14A_START_OF_COMMUNICATION) {                // error - must not follow directly after SOC
+                    Uart14aResetEx(uart);
+                } else {                                                         // a logic "0"
+
+                    uart->bitCount++;
+                    uart->shiftReg >>= 1;                                         // add a 0 to the shiftreg
+                    uart->state = STATE_14A_MILLER_Y;
+
+                    if (uart->bitCount >= 9) {                                    // if we decoded a full byte (including parity)
+
+                        uart->output[uart->len++] = (uart->shiftReg & 0xff);
+                        uart->parityBits <<= 1;                                   // make room for the parity bit
+                        uart->parityBits |= ((uart->shiftReg >> 8) & 0x01);        // store parity bit
+                        uart->bitCount = 0;
+                        uart->shiftReg = 0;
+
+                        // Every 8 data bytes, store 8 parity bits into a parity byte
+                        if ((uart->len & 0x0007) == 0) {                          // every 8 data bytes
+                            uart->parity[uart->parityLen++] = uart->parityBits;     // store 8 parity bits
+                            uart->parityBits = 0;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return false;    // not finished yet, need more data
+}
+
+//=============================================================================
+// ISO 14443 Type A - Manchester decoder
+//=============================================================================
+// Basics:
+// This decoder is used when the PM3 acts as a reader.
+// The tag will modulate the reader field by asserting different loads to it. As a consequence, the voltage
+// at the reader antenna will be modulated as well. The FPGA detects the modulation for us and would deliver e.g. the following:
+// ........ 0 0 1 1 1 1 0 0 0 0 0 0 0 0 1 1 1 1 1 1 1 1 0 0 0 0 0 0 0 0 0 0 0 0 0 0 .......
+// The Manchester decoder needs to identify the following sequences:
+// 4 ticks modulated followed by 4 ticks unmodulated:     Sequence D = 1 (also used as "start of communication")
+// 4 ticks unmodulated followed by 4 ticks modulated:     Sequence E = 0
+// 8 ticks unmodulated:                                   Sequence F = end of communication
+// 8 ticks modulated:                                     A collision. Save the collision position and treat as Sequence D
+// Note 1: the bitstream may start at any time. We therefore need to sync.
+// Note 2: parameter offset is used to determine the position of the parity bits (required for the anticollision command only)
+// Lookup-Table to decide if 4 raw bits are a modulation.
+// We accept three or four "1" in any position
+static const bool Mod_Manchester_LUT[] = {
+    false, false, false, false, false, false, false, true,
+    false, false, false, true,  false, true,  true,  true
+};
+
+#define IsManchesterModulationNibble1(b) (Mod_Manchester_LUT[(b & 0x00F0) >> 4])
+#define IsManchesterModulationNibble2(b) (Mod_Manchester_LUT[(b & 0x000F)])
+
+HF14A_DECODE_INLINE void Demod14aResetEx(tDemod14a *demod) {
+    demod->state = DEMOD_14A_UNSYNCD;
+    demod->twoBits = 0xFFFF;              // buffer for 2 Bits
+    demod->highCnt = 0;
+    demod->bitCount = 0;
+    demod->collisionPos = 0;              // Position of collision bit
+    demod->syncBit = 0xFFFF;
+    demod->parityBits = 0;
+    demod->parityLen = 0;
+    demod->shiftReg = 0;                  // shiftreg to hold decoded data bits
+    demod->samples = 0;
+    demod->len = 0;                       // number of decoded data bytes
+    demod->startTime = 0;
+    demod->endTime = 0;
+    demod->samples = 0;
+}
+
+// use parameter non_real_time to provide a timestamp. Set to 0 if the decoder should measure real time
+HF14A_DECODE_INLINE int ManchesterDecodingEx(tDemod14a *demod, uint8_t bit, uint16_t offset, uint32_t non_real_time) {
+
+    if (demod->len == demod->output_len) {
+        return true;
+    }
+
+    demod->twoBits = (demod->twoBits << 8) | bit;
+
+    if (demod->state == DEMOD_14A_UNSYNCD) {
+
+        if (demod->highCnt < 2) {                                            // wait for a stable unmodulated signal
+            if (demod->twoBits == 0x0000) {
+                demod->highCnt++;
+            } else {
+                demod->highCnt = 0;
+            }
+        } else {
+            demod->syncBit = 0xFFFF;            // not set
+            if ((demod->twoBits & 0x7700) == 0x7000) demod->syncBit = 7;
+            else if ((demod->twoBits & 0x3B80) == 0x3800) demod->syncBit = 6;
+            else if ((demod->twoBits & 0x1DC0) == 0x1C00) demod->syncBit = 5;
+            else if ((demod->twoBits & 0x0EE0) == 0x0E00) demod->syncBit = 4;
+            else if ((demod->twoBits & 0x0770) == 0x0700) demod->syncBit = 3;
+            else if ((demod->twoBits & 0x03B8) == 0x0380) demod->syncBit = 2;
+            else if ((demod->twoBits & 0x01DC) == 0x01C0) demod->syncBit = 1;
+            else if ((demod->twoBits & 0x00EE) == 0x00E0) demod->syncBit = 0;
+            if (demod->syncBit != 0xFFFF) {
+                demod->startTime = non_real_time ? non_real_time : HF14A_DECODE_NOW();
+                demod->startTime -= demod->syncBit;
+                demod->bitCount = offset;            // number of decoded data bits
+                demod->state = DEMOD_14A_MANCHESTER_DATA;
+            }
+        }
+    } else {
+
+        if (IsManchesterModulationNibble1(demod->twoBits >> demod->syncBit)) {      // modulation in first half
+            if (IsManchesterModulationNibble2(demod->twoBits >> demod->syncBit)) {  // ... and in second half = collision
+                if (demod->collisionPos == 0) {
+                    demod->collisionPos = (demod->len << 3) + demod->bitCount;
+                }
+            }                                                           // modulation in first half only - Sequence D = 1
+            demod->bitCount++;
+            demod->shiftReg = (demod->shiftReg >> 1) | 0x100;             // in both cases, add a 1 to the shiftreg
+            if (demod->bitCount == 9) {                                  // if we decoded a full byte (including parity)
+                demod->output[demod->len++] = (demod->shiftReg & 0xff);
+                demod->parityBits <<= 1;                                 // make room for the parity bit
+                demod->parityBits |= ((demod->shiftReg >> 8) & 0x01);     // store parity bit
+                demod->bitCount = 0;
+                demod->shiftReg = 0;
+                if ((demod->len & 0x0007) == 0) {                        // every 8 data bytes
+                    demod->parity[demod->parityLen++] = demod->parityBits; // store 8 parity bits
+                    demod->parityBits = 0;
+                }
+            }
+            demod->endTime = demod->startTime + 8 * (9 * demod->len + demod->bitCount + 1) - 4;
+        } else {                                                        // no modulation in first half
+            if (IsManchesterModulationNibble2(demod->twoBits >> demod->syncBit)) {    // and modulation in second half = Sequence E = 0
+                demod->bitCount++;
+                demod->shiftReg = (demod->shiftReg >> 1);                 // add a 0 to the shiftreg
+                if (demod->bitCount >= 9) {                              // if we decoded a full byte (including parity)
+                    demod->output[demod->len++] = (demod->shiftReg & 0xff);
+                    demod->parityBits <<= 1;                             // make room for the new parity bit
+                    demod->parityBits |= ((demod->shiftReg >> 8) & 0x01); // store parity bit
+                    demod->bitCount = 0;
+                    demod->shiftReg = 0;
+                    if ((demod->len & 0x0007) == 0) {                    // every 8 data bytes
+                        demod->parity[demod->parityLen++] = demod->parityBits;    // store 8 parity bits1
+                        demod->parityBits = 0;
+                    }
+                }
+                demod->endTime = demod->startTime + 8 * (9 * demod->len + demod->bitCount + 1);
+            } else {                                                    // no modulation in both halves - End of communication
+
+                if (demod->bitCount > 0) {                               // there are some remaining data bits
+                    demod->shiftReg >>= (9 - demod->bitCount);            // right align the decoded bits
+                    demod->output[demod->len++] = demod->shiftReg & 0xff;  // and add them to the output
+                    demod->parityBits <<= 1;                             // add a (void) parity bit
+                    demod->parityBits <<= (8 - (demod->len & 0x0007));    // left align remaining parity bits
+                    demod->parity[demod->parityLen++] = demod->parityBits; // and store them
+                    return true;
+                } else if (demod->len & 0x0007) {                        // there are some parity bits to store
+                    demod->parityBits <<= (8 - (demod->len & 0x0007));    // left align remaining parity bits
+                    demod->parity[demod->parityLen++] = demod->parityBits; // and store them
+                }
+
+                if (demod->len) {
+                    return true;                                        // we are finished with decoding the raw data sequence
+                } else {                                                // nothing received. Start over
+                    Demod14aResetEx(demod);
+                }
+            }
+        }
+    }
+    return false;    // not finished yet, need more data
+}
+
+#endif
@@ -0,0 +1,425 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Jonathan Westhues, Nov 2006
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// ISO 14443 type B bit decoders, shared by the firmware and host tools.
+//
+// Same scheme as iso14443a_decode.h: the state machines take a state pointer and
+// are forced inline into the RAMFUNC entry points in armsrc/iso14443b.c.
+//-----------------------------------------------------------------------------
+#ifndef __ISO14443B_DECODE_H
+#define __ISO14443B_DECODE_H
+
+#include "common.h"
+
+#ifdef ON_DEVICE
+# include "proxmark3_arm.h"
+#else
+# define LED_A_ON()
+# define LED_A_OFF()
+# define LED_C_ON()
+# define LED_C_OFF()
+#endif
+
+#define HF14B_DECODE_INLINE  static inline __attribute__((always_inline))
+
+//-----------------------------------------------------------------------------
+// The software UART that receives commands from the reader, and its state
+// variables.
+//-----------------------------------------------------------------------------
+typedef struct {
+    enum {
+        STATE_14B_UNSYNCD,
+        STATE_14B_GOT_FALLING_EDGE_OF_SOF,
+        STATE_14B_AWAITING_START_BIT,
+        STATE_14B_RECEIVING_DATA
+    }       state;
+    uint16_t shiftReg;
+    int      bitCnt;
+    int      byteCnt;
+    int      byteCntMax;
+    int      posCnt;
+    uint8_t  *output;
+} tUart14b;
+
+//-----------------------------------------------------------------------------
+// The software Demod that receives commands from the tag, and its state variables.
+//-----------------------------------------------------------------------------
+typedef struct {
+    enum {
+        DEMOD_UNSYNCD,
+        DEMOD_PHASE_REF_TRAINING,
+        WAIT_FOR_RISING_EDGE_OF_SOF,
+        DEMOD_AWAITING_START_BIT,
+        DEMOD_RECEIVING_DATA
+    }       state;
+    uint16_t bitCount;
+    int      posCount;
+    int      thisBit;
+    uint16_t shiftReg;
+    uint16_t max_len;
+    uint8_t  *output;
+    uint16_t len;
+    int      sumI;
+    int      sumQ;
+} tDemod14b;
+
+HF14B_DECODE_INLINE void Uart14bResetEx(tUart14b *uart) {
+    uart->state = STATE_14B_UNSYNCD;
+    uart->shiftReg = 0;
+    uart->bitCnt = 0;
+    uart->byteCnt = 0;
+    uart->posCnt = 0;
+}
+
+// Clear out the state of the "UART" that receives from the tag.
+HF14B_DECODE_INLINE void Demod14bResetEx(tDemod14b *demod) {
+    demod->state = DEMOD_UNSYNCD;
+    demod->bitCount = 0;
+    demod->posCount = 0;
+    demod->thisBit = 0;
+    demod->shiftReg = 0;
+    demod->len = 0;
+    demod->sumI = 0;
+    demod->sumQ = 0;
+}
+
+/* Receive & handle a bit coming from the reader.
+ *
+ * This function is called 4 times per bit (every 2 subcarrier cycles).
+ * Subcarrier frequency fs is 848kHz, 1/fs = 1,18us, i.e. function is called every 2,36us
+ *
+ * LED handling:
+ * LED A -> ON once we have received the SOF and are expecting the rest.
+ * LED A -> OFF once we have received EOF or are in error state or unsynced
+ *
+ * Returns: true if we received a EOF
+ *          false if we are still waiting for some more
+ */
+HF14B_DECODE_INLINE int Handle14443bSampleFromReaderEx(tUart14b *uart, uint8_t bit) {
+    switch (uart->state) {
+        case STATE_14B_UNSYNCD:
+            if (bit == false) {
+                // we went low, so this could be the beginning of an SOF
+                uart->state = STATE_14B_GOT_FALLING_EDGE_OF_SOF;
+                uart->posCnt = 0;
+                uart->bitCnt = 0;
+            }
+            break;
+
+        case STATE_14B_GOT_FALLING_EDGE_OF_SOF:
+            uart->posCnt++;
+
+            if (uart->posCnt == 2) { // sample every 4 1/fs in the middle of a bit
+
+                if (bit) {
+                    if (uart->bitCnt > 9) {
+                        // we've seen enough consecutive
+                        // zeros that it's a valid SOF
+                        uart->posCnt = 0;
+                        uart->byteCnt = 0;
+                        uart->state = STATE_14B_AWAITING_START_BIT;
+                        LED_A_ON(); // Indicate we got a valid SOF
+                    } else {
+                        // didn't stay down long enough before going high, error
+                        uart->state = STATE_14B_UNSYNCD;
+                    }
+                } else {
+                    // do nothing, keep waiting
+                }
+                uart->bitCnt++;
+            }
+
+            if (uart->posCnt >= 4) {
+                uart->posCnt = 0;
+            }
+
+            if (uart->bitCnt > 12) {
+                // Give up if we see too many zeros without a one, too.
+                LED_A_OFF();
+                uart->state = STATE_14B_UNSYNCD;
+            }
+            break;
+
+        case STATE_14B_AWAITING_START_BIT:
+            uart->posCnt++;
+
+            if (bit) {
+
+                // max 57us between characters = 49 1/fs,
+                // max 3 etus after low phase of SOF = 24 1/fs
+                if (uart->posCnt > 50 / 2) {
+                    // stayed high for too long between characters, error
+                    uart->state = STATE_14B_UNSYNCD;
+                }
+
+            } else {
+                // falling edge, this starts the data byte
+                uart->posCnt = 0;
+                uart->bitCnt = 0;
+                uart->shiftReg = 0;
+                uart->state = STATE_14B_RECEIVING_DATA;
+            }
+            break;
+
+        case STATE_14B_RECEIVING_DATA:
+
+            uart->posCnt++;
+
+            if (uart->posCnt == 2) {
+                // time to sample a bit
+                uart->shiftReg >>= 1;
+                if (bit) {
+                    uart->shiftReg |= 0x200;
+                }
+                uart->bitCnt++;
+            }
+
+            if (uart->posCnt >= 4) {
+                uart->posCnt = 0;
+            }
+
+            if (uart->bitCnt == 10) {
+                if ((uart->shiftReg & 0x200) && !(uart->shiftReg & 0x001)) {
+                    // this is a data byte, with correct
+                    // start and stop bits
+                    uart->output[uart->byteCnt] = (uart->shiftReg >> 1) & 0xFF;
+                    uart->byteCnt++;
+
+                    if (uart->byteCnt >= uart->byteCntMax) {
+                        // Buffer overflowed, give up
+                        LED_A_OFF();
+                        uart->state = STATE_14B_UNSYNCD;
+                    } else {
+                        // so get the next byte now
+                        uart->posCnt = 0;
+                        uart->state = STATE_14B_AWAITING_START_BIT;
+                    }
+                } else if (uart->shiftReg == 0x000) {
+                    // this is an EOF byte
+                    LED_A_OFF(); // Finished receiving
+                    uart->state = STATE_14B_UNSYNCD;
+                    if (uart->byteCnt != 0)
+                        return true;
+
+                } else {
+                    // this is an error
+                    LED_A_OFF();
+                    uart->state = STATE_14B_UNSYNCD;
+                }
+            }
+            break;
+
+        default:
+            LED_A_OFF();
+            uart->state = STATE_14B_UNSYNCD;
+            break;
+    }
+    return false;
+}
+
+/*
+ * Handles reception of a bit from the tag
+ *
+ * This function is called 2 times per bit (every 4 subcarrier cycles).
+ * Subcarrier frequency fs is 848kHz, 1/fs = 1,18us, i.e. function is called every 4,72us
+ *
+ * LED handling:
+ * LED C -> ON once we have received the SOF and are expecting the rest.
+ * LED C -> OFF once we have received EOF or are unsynced
+ *
+ * Returns: true if we received a EOF
+ *          false if we are still waiting for some more
+ *
+ */
+HF14B_DECODE_INLINE int Handle14443bSamplesFromTagEx(tDemod14b *demod, int ci, int cq) {
+
+    int v = 0;
+
+// The soft decision on the bit uses an estimate of just the
+// quadrant of the reference angle, not the exact angle.
+#define MAKE_SOFT_DECISION() { \
+        if(demod->sumI > 0) { \
+            v = ci; \
+        } else { \
+            v = -ci; \
+        } \
+        if(demod->sumQ > 0) { \
+            v += cq; \
+        } else { \
+            v -= cq; \
+        } \
+    }
+
+#define SUBCARRIER_DETECT_THRESHOLD  8
+// Subcarrier amplitude v = sqrt(ci^2 + cq^2), approximated here by max(abs(ci),abs(cq)) + 1/2*min(abs(ci),abs(cq)))
+#define AMPLITUDE(ci,cq) (MAX(ABS(ci),ABS(cq)) + (MIN(ABS(ci),ABS(cq))/2))
+
+    switch (demod->state) {
+
+        case DEMOD_UNSYNCD: {
+            if (AMPLITUDE(ci, cq) > SUBCARRIER_DETECT_THRESHOLD) {  // subcarrier detected
+                demod->state = DEMOD_PHASE_REF_TRAINING;
+                demod->sumI = ci;
+                demod->sumQ = cq;
+                demod->posCount = 1;
+            }
+            break;
+        }
+        case DEMOD_PHASE_REF_TRAINING: {
+            // While we get a constant signal
+            if (AMPLITUDE(ci, cq) > SUBCARRIER_DETECT_THRESHOLD) {
+                if (((ABS(demod->sumI) > ABS(demod->sumQ)) && (((ci > 0) && (demod->sumI > 0)) || ((ci < 0) && (demod->sumI < 0)))) ||  // signal closer to horizontal, polarity check based on on I
+                        ((ABS(demod->sumI) <= ABS(demod->sumQ)) && (((cq > 0) && (demod->sumQ > 0)) || ((cq < 0) && (demod->sumQ < 0))))) { // signal closer to vertical, polarity check based on on Q
+
+                    if (demod->posCount < 10) {  // refine signal approximation during first 10 samples
+                        demod->sumI += ci;
+                        demod->sumQ += cq;
+                    }
+                    demod->posCount += 1;
+                } else {
+                    // transition
+                    if (demod->posCount < 10) {
+                        // subcarrier lost
+                        demod->state = DEMOD_UNSYNCD;
+                        break;
+                    } else {
+                        // at this point it can be start of 14b' data or start of 14b SOF
+                        MAKE_SOFT_DECISION();
+                        demod->posCount = 1;             // this was the first half
+                        demod->thisBit = v;
+                        demod->shiftReg = 0;
+                        demod->state = DEMOD_RECEIVING_DATA;
+                    }
+                }
+            } else {
+                // subcarrier lost
+                demod->state = DEMOD_UNSYNCD;
+            }
+            break;
+        }
+        case DEMOD_AWAITING_START_BIT: {
+            demod->posCount++;
+            MAKE_SOFT_DECISION();
+            if (v > 0) {
+                if (demod->posCount > 3 * 2) {       // max 19us between characters = 16 1/fs, max 3 etu after low phase of SOF = 24 1/fs
+                    LED_C_OFF();
+                    if (demod->bitCount == 0 && demod->len == 0) { // received SOF only, this is valid for iClass/Picopass
+                        return true;
+                    } else {
+                        demod->state = DEMOD_UNSYNCD;
+                    }
+                }
+            } else {                            // start bit detected
+                demod->posCount = 1;             // this was the first half
+                demod->thisBit = v;
+                demod->shiftReg = 0;
+                demod->state = DEMOD_RECEIVING_DATA;
+            }
+            break;
+        }
+        case WAIT_FOR_RISING_EDGE_OF_SOF: {
+
+            demod->posCount++;
+            MAKE_SOFT_DECISION();
+            if (v > 0) {
+                if (demod->posCount < 9 * 2) { // low phase of SOF too short (< 9 etu). Note: spec is >= 10, but FPGA tends to "smear" edges
+                    demod->state = DEMOD_UNSYNCD;
+                } else {
+                    LED_C_ON(); // Got SOF
+                    demod->posCount = 0;
+                    demod->bitCount = 0;
+                    demod->len = 0;
+                    demod->state = DEMOD_AWAITING_START_BIT;
+                }
+            } else {
+                if (demod->posCount > 12 * 2) { // low phase of SOF too long (> 12 etu)
+                    demod->state = DEMOD_UNSYNCD;
+                    LED_C_OFF();
+                }
+            }
+            break;
+        }
+        case DEMOD_RECEIVING_DATA: {
+
+            MAKE_SOFT_DECISION();
+
+            if (demod->posCount == 0) {          // first half of bit
+                demod->thisBit = v;
+                demod->posCount = 1;
+            } else {                            // second half of bit
+                demod->thisBit += v;
+
+                demod->shiftReg >>= 1;
+                if (demod->thisBit > 0) {    // logic '1'
+                    demod->shiftReg |= 0x200;
+                }
+
+                demod->bitCount++;
+                if (demod->bitCount == 10) {
+
+                    uint16_t s = demod->shiftReg;
+
+                    if ((s & 0x200) && !(s & 0x001)) { // stop bit == '1', start bit == '0'
+                        demod->output[demod->len] = (s >> 1);
+                        demod->len++;
+                        demod->bitCount = 0;
+                        demod->state = DEMOD_AWAITING_START_BIT;
+                    } else {
+                        if (s == 0x000) {
+                            if (demod->len > 0) {
+                                LED_C_OFF();
+                                // This is EOF (start, stop and all data bits == '0'
+                                return true;
+                            } else {
+                                // Zeroes but no data acquired yet?
+                                // => Still in SOF of 14b, wait for raising edge
+                                demod->posCount = 10 * 2;
+                                demod->bitCount = 0;
+                                demod->len = 0;
+                                demod->state = WAIT_FOR_RISING_EDGE_OF_SOF;
+                                break;
+                            }
+                        }
+                        if (AMPLITUDE(ci, cq) < SUBCARRIER_DETECT_THRESHOLD) {
+                            LED_C_OFF();
+                            // subcarrier lost
+                            demod->state = DEMOD_UNSYNCD;
+                            if (demod->len > 0) { // no EOF but no signal anymore and we got data, e.g. ASK CTx
+                                return true;
+                            }
+                        }
+                        // we have still signal but no proper byte or EOF? this shouldn't happen
+                        //demod->posCount = 10 * 2;
+                        demod->bitCount = 0;
+                        demod->len = 0;
+                        demod->state = WAIT_FOR_RISING_EDGE_OF_SOF;
+                        break;
+                    }
+                }
+                demod->posCount = 0;
+            }
+            break;
+        }
+        default: {
+            demod->state = DEMOD_UNSYNCD;
+            LED_C_OFF();
+            break;
+        }
+    }
+    return false;
+}
+
+#endif
@@ -49,6 +49,9 @@
 #include "parity.h"  // for parity test
 #include "pm3_cmd.h" // error codes
 #include "commonutil.h"  // Arraylen
+#ifndef ON_DEVICE
+#include <pthread.h>
+#endif
 
 // **********************************************************************************************
 // ---------------------------------Utilities Section--------------------------------------------
@@ -69,7 +72,12 @@ uint8_t g_debugMode = 0;
 # define prnt Dbprintf
 #endif
 
+// on the host, threads bound to different devices demod at the same time
+#ifndef ON_DEVICE
+static __thread signal_t signalprop = { 255, -255, 0, 0, true };
+#else
 static signal_t signalprop = { 255, -255, 0, 0, true };
+#endif
 signal_t *getSignalProperties(void) {
     return &signalprop;
 }
@@ -93,12 +101,190 @@ static void printSignal(void) {
 }
 
 #ifndef ON_DEVICE
+// Clock detections of one capture, shared by the threads demodulating it (lf search --dir).
+// A detection on exactly these samples, with the same arguments and signal properties,
+// is answered from here instead of being run again by every demodulator.
+#define CLOCK_CACHE_ENTRIES 32
+
+typedef enum {
+    CLOCK_ASK,
+    CLOCK_NRZ,
+    CLOCK_PSK,
+} clock_type_t;
+
+// arguments of a detection, the pointer arguments by value
+typedef struct {
+    clock_type_t type;
+    int clock;
+    int maxErr;
+    size_t start;
+    uint8_t phase;
+    uint8_t fc;
+} clock_args_t;
+
+typedef struct {
+    clock_args_t in;
+    signal_t sig;
+    clock_args_t out;
+    int ret;
+} clock_cache_entry_t;
+
+struct clock_cache {
+    uint8_t *samples;
+    size_t size;
+    pthread_mutex_t lock;
+    size_t used;
+    clock_cache_entry_t entries[CLOCK_CACHE_ENTRIES];
+};
+
+static __thread clock_cache_t *clockcache = NULL;
+
+clock_cache_t *clockCacheNew(const uint8_t *samples, size_t size) {
+    clock_cache_t *cc = calloc(1, sizeof(clock_cache_t));
+    if (cc == NULL) {
+        return NULL;
+    }
+    cc->samples = malloc(size);
+    if (cc->samples == NULL) {
+        free(cc);
+        return NULL;
+    }
+    memcpy(cc->samples, samples, size);
+    cc->size = size;
+    pthread_mutex_init(&cc->lock, NULL);
+    return cc;
+}
+
+// no thread may be bound to cc anymore
+void clockCacheFree(clock_cache_t *cc) {
+    if (cc == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&cc->lock);
+    free(cc->samples);
+    free(cc);
+}
+
+// clock detections of the calling thread use cc from now on, NULL for none
+void clockCacheBind(clock_cache_t *cc) {
+    clockcache = cc;
+}
+
+static bool same_clock_args(const clock_args_t *a, const clock_args_t *b) {
+    return a->type == b->type && a->clock == b->clock && a->maxErr == b->maxErr &&
+           a->start == b->start && a->phase == b->phase && a->fc == b->fc;
+}
+
+static bool same_signal(const signal_t *a, const signal_t *b) {
+    return a->low == b->low && a->high == b->high && a->mean == b->mean &&
+           a->amplitude == b->amplitude && a->isnoise == b->isnoise;
+}
+
+// -1 samples are not the capture of the bound cache, 0 not cached yet, 1 found
+static int clock_cache_get(const uint8_t *dest, size_t size, const clock_args_t *in, clock_args_t *out, int *ret) {
+    clock_cache_t *cc = clockcache;
+    if (cc == NULL || size != cc->size || memcmp(dest, cc->samples, size) != 0) {
+        return -1;
+    }
+
+    int res = 0;
+    pthread_mutex_lock(&cc->lock);
+    for (size_t i = 0; i < cc->used; i++) {
+        const clock_cache_entry_t *e = &cc->entries[i];
+        if (same_clock_args(&e->in, in) && same_signal(&e->sig, &signalprop)) {
+            *out = e->out;
+            *ret = e->ret;
+            res = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cc->lock);
+    return res;
+}
+
+static void clock_cache_put(const clock_args_t *in, const clock_args_t *out, int ret) {
+    clock_cache_t *cc = clockcache;
+    pthread_mutex_lock(&cc->lock);
+    if (cc->used < CLOCK_CACHE_ENTRIES) {
+        clock_cache_entry_t *e = &cc->entries[cc->used++];
+        e->in = *in;
+        e->sig = signalprop;
+        e->out = *out;
+        e->ret = ret;
+    }
+    pthread_mutex_unlock(&cc->lock);
+}
+
 static int cmp_uint8(const void *a, const void *b) {
     if (*(const uint8_t *)a < * (const uint8_t *)b)
         return -1;
     else
         return *(const uint8_t *)a > *(const uint8_t *)b;
 }
+
+// Wave tops, samples[i] > samples[i - 1] && samples[i] >= samples[i + 1], found 64 samples at a time.
+// The compares run on 16 byte vectors, SSE2 / NEON on the usual hosts, and each 64 bit word of
+// results is walked with ctz, so the clock searches only visit the tops instead of every sample.
+typedef uint8_t wave_vec_t __attribute__((vector_size(16)));
+
+typedef struct {
+    const uint8_t *samples;
+    size_t base;    // sample of bit 0 of tops
+    size_t end;
+    uint64_t tops;  // tops not returned yet
+} wave_tops_t;
+
+static void wave_tops_fill(wave_tops_t *t) {
+    const uint8_t *s = t->samples + t->base;
+    size_t n = t->end - t->base;
+
+    t->tops = 0;
+    if (n >= 64) {
+        // samples[end] is read, callers keep end below the sample count
+        for (int b = 0; b < 4; b++) {
+            wave_vec_t l, v, r;
+            memcpy(&l, s + 16 * b - 1, sizeof(l));
+            memcpy(&v, s + 16 * b, sizeof(v));
+            memcpy(&r, s + 16 * b + 1, sizeof(r));
+            wave_vec_t top = (wave_vec_t)((v > l) & (v >= r)) & 1;
+
+            // one byte per sample to one bit per sample
+            uint64_t lanes[2];
+            memcpy(lanes, &top, sizeof(lanes));
+            t->tops |= ((lanes[0] * 0x0102040810204080ULL) >> 56) << (16 * b);
+            t->tops |= ((lanes[1] * 0x0102040810204080ULL) >> 56) << (16 * b + 8);
+        }
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] > s[i - 1] && s[i] >= s[i + 1])
+            t->tops |= 1ULL << i;
+    }
+}
+
+// tops at start <= i < end, start > 0
+static void wave_tops_init(wave_tops_t *t, const uint8_t *samples, size_t start, size_t end) {
+    t->samples = samples;
+    t->base = start;
+    t->end = end;
+    if (start < end) {
+        wave_tops_fill(t);
+    } else {
+        t->tops = 0;
+    }
+}
+
+static bool wave_tops_next(wave_tops_t *t, size_t *i) {
+    while (t->tops == 0) {
+        t->base += 64;
+        if (t->base >= t->end)
+            return false;
+        wave_tops_fill(t);
+    }
+    *i = t->base + __builtin_ctzll(t->tops);
+    t->tops &= t->tops - 1;
+    return true;
+}
 #endif
 
 void computeSignalProperties(const uint8_t *samples, uint32_t size) {
@@ -748,10 +934,16 @@ int DetectStrongAskClock(uint8_t *dest, size_t size, int high, int low, int *clo
     return shortestWaveIdx;
 }
 
+// sample at or beyond the high or low peak threshold
+#define ASK_IS_PEAK(s, hi, lo) ((s) >= (hi) || (s) <= (lo))
+// 1 when neither the sample nor its neighbours at +/- tol reach the high or low peak threshold
+#define ASK_NO_PEAK(d, k, tol, hi, lo) \
+    (!(ASK_IS_PEAK((d)[(k)], hi, lo) || ASK_IS_PEAK((d)[(k) - (tol)], hi, lo) || ASK_IS_PEAK((d)[(k) + (tol)], hi, lo)))
+
 // not perfect especially with lower clocks or VERY good antennas (heavy wave clipping)
 // maybe somehow adjust peak trimming value based on samples to fix?
 // return start index of best starting position for that clock and return clock (by reference)
-int DetectASKClock(uint8_t *dest, size_t size, int *clock, int maxErr) {
+static int detect_ask_clock(uint8_t *dest, size_t size, int *clock, int maxErr) {
 
     //don't need to loop through entire array. (cotag has clock of 384)
     uint16_t loopCnt = 1000;
@@ -842,19 +1034,48 @@ int DetectASKClock(uint8_t *dest, size_t size, int *clock, int maxErr) {
         getNextHigh(dest, size, peak_hi, &j);
         getNextLow(dest, size, peak_low, &j);
 
+        if (j >= loopCnt)
+            continue;
+
+#ifdef ON_DEVICE
+        // the per phase table below costs 1 kB of stack, too much for the firmware.
         for (; j < loopCnt; j++) {
             errCnt = 0;
             // now that we have the first one lined up test rest of wave array
             loopEnd = ((size - j - tol) / clk[clkCnt]) - 1;
             for (i = 0; i < loopEnd; ++i) {
                 arrLoc = j + (i * clk[clkCnt]);
-                if (dest[arrLoc] >= peak_hi || dest[arrLoc] <= peak_low) {
-                } else if (dest[arrLoc - tol] >= peak_hi || dest[arrLoc - tol] <= peak_low) {
-                } else if (dest[arrLoc + tol] >= peak_hi || dest[arrLoc + tol] <= peak_low) {
-                } else {  //error no peak detected
-                    errCnt++;
-                }
+                errCnt += ASK_NO_PEAK(dest, arrLoc, tol, peak_hi, peak_low);
             }
+#else
+        // every start position j tests the samples j, j + clk, j + 2 * clk ... up to the last
+        // full clock before the end, which only depends on the phase j % clk.  Count the
+        // missing peaks per phase once, then drop sample j from its phase as j moves on.
+        // Same result as testing the whole array for each start position, but linear in size.
+        uint16_t c = clk[clkCnt];
+        uint32_t phaseErr[256];
+        memset(phaseErr, 0, c * sizeof(uint32_t));
+
+        // last sample tested by any start position is at or before size - tol - 2 * clk
+        loopEnd = (size >= tol + 2 * c) ? size - tol - 2 * c + 1 : 0;
+
+        size_t phase = j % c;
+        for (arrLoc = j; arrLoc < loopEnd; arrLoc++) {
+            phaseErr[phase] += ASK_NO_PEAK(dest, arrLoc, tol, peak_hi, peak_low);
+            if (++phase == c)
+                phase = 0;
+        }
+
+        phase = j % c;
+        for (; j < loopCnt; j++) {
+            // now that we have the first one lined up test rest of wave array
+            errCnt = phaseErr[phase];
+            if (j < loopEnd)
+                phaseErr[phase] -= ASK_NO_PEAK(dest, j, tol, peak_hi, peak_low);
+            if (++phase == c)
+                phase = 0;
+#endif
+
             // if we found no errors then we can stop here and a low clock (common clocks)
             //  this is correct one - return this clock
             // if (g_debugMode == 2) prnt("DEBUG ASK: clk %d, err %d, startpos %d, endpos %d", clk[clkCnt], errCnt, j, i);
@@ -906,6 +1127,27 @@ int DetectASKClock(uint8_t *dest, size_t size, int *clock, int maxErr) {
     return bestStart[best];
 }
 
+int DetectASKClock(uint8_t *dest, size_t size, int *clock, int maxErr) {
+#ifndef ON_DEVICE
+    clock_args_t in = { .type = CLOCK_ASK, .clock = *clock, .maxErr = maxErr }, out;
+    int ret;
+    int cached = clock_cache_get(dest, size, &in, &out, &ret);
+    if (cached == 1) {
+        *clock = out.clock;
+        return ret;
+    }
+    ret = detect_ask_clock(dest, size, clock, maxErr);
+    if (cached == 0) {
+        out = in;
+        out.clock = *clock;
+        clock_cache_put(&in, &out, ret);
+    }
+    return ret;
+#else
+    return detect_ask_clock(dest, size, clock, maxErr);
+#endif
+}
+
 int DetectStrongNRZClk(const uint8_t *dest, size_t size, int peak, int low, bool *strong) {
     //find shortest transition from high to low
     *strong = false;
@@ -949,8 +1191,59 @@ int DetectStrongNRZClk(const uint8_t *dest, size_t size, int peak, int low, bool
     return lowestTransition;
 }
 
+// One run of the weak NRZ clock search from start position ii, a peak, with clock bits at
+// ii, ii + clk, ii + 2 * clk ...  Counts the clock bit peaks that differ from the one before, less
+// the stray peaks in between.  lastPeakHigh carries over from run to run.  countAt, if not NULL,
+// gets the count after each clock bit peak below loopCnt.
+static int32_t nrz_clock_peaks(const uint8_t *dest, size_t ii, size_t end, uint16_t clk, int peak, int low,
+                               bool *lastPeakHigh, int32_t *countAt, size_t loopCnt) {
+    const uint8_t ignoreWindow = 4;
+    bool errBitHigh = false, bitHigh = false;
+    uint8_t ignoreCnt = 0;
+    size_t nextBit = ii;
+    int32_t peakcnt = 0;
+
+    //loop through to see if this start location works
+    for (size_t i = ii; i < end; ++i) {
+        bool isPeak = (dest[i] >= peak || dest[i] <= low);
+        //if we are at a clock bit
+        if (i == nextBit) {
+            nextBit += clk;
+            //test high/low
+            if (isPeak) {
+                //if same peak don't count it
+                if ((dest[i] >= peak && !*lastPeakHigh) || (dest[i] <= low && *lastPeakHigh)) {
+                    peakcnt++;
+                }
+                *lastPeakHigh = (dest[i] >= peak);
+                bitHigh = true;
+                errBitHigh = false;
+                ignoreCnt = ignoreWindow;
+                if (countAt != NULL && i < loopCnt) {
+                    countAt[i] = peakcnt;
+                }
+            }
+            //else if not a clock bit and no peaks
+        } else if (isPeak == false) {
+            if (ignoreCnt == 0) {
+                bitHigh = false;
+                if (errBitHigh == true)
+                    peakcnt--;
+                errBitHigh = false;
+            } else {
+                ignoreCnt--;
+            }
+            // else if not a clock bit but we have a peak
+        } else if (!bitHigh) {
+            //error bar found no clock...
+            errBitHigh = true;
+        }
+    }
+    return peakcnt;
+}
+
 // detect nrz clock by reading #peaks vs no peaks(or errors)
-int DetectNRZClock(uint8_t *dest, size_t size, int clock, size_t *clockStartIdx) {
+static int detect_nrz_clock(uint8_t *dest, size_t size, int clock, size_t *clockStartIdx) {
     size_t i = 0;
     uint16_t clk[] = {8, 16, 32, 40, 50, 64, 100, 128, 255, 272, 384};
     size_t loopCnt = 4096;  //don't need to loop through entire array...
@@ -980,7 +1273,6 @@ int DetectNRZClock(uint8_t *dest, size_t size, int clock, size_t *clockStartIdx)
     if (strong) return lowestTransition;
     size_t ii;
     uint8_t clkCnt;
-    uint8_t tol = 0;
     uint16_t smplCnt = 0;
     int16_t peakcnt = 0;
     int16_t peaksdet[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
@@ -1003,56 +1295,49 @@ int DetectNRZClock(uint8_t *dest, size_t size, int clock, size_t *clockStartIdx)
     }
     if (minPeak < 8) return 0;
 
-    bool errBitHigh = 0, bitHigh = 0, lastPeakHigh = 0;
-    uint8_t ignoreCnt = 0, ignoreWindow = 4;
-    int lastBit = 0;
+    bool lastPeakHigh = false;
     size_t bestStart[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-    peakcnt = 0;
+    size_t end = size - 20;
     //test each valid clock from smallest to greatest to see which lines up
     for (clkCnt = 0; clkCnt < ARRAYLEN(bestStart); ++clkCnt) {
         //ignore clocks smaller than smallest peak
         if (clk[clkCnt] < minPeak - (clk[clkCnt] / 4)) continue;
+
+#ifndef ON_DEVICE
+        // A start position is a peak on a clock bit, which leaves the search in the same state
+        // whatever came before, but for lastPeakHigh.  Start positions with the same phase
+        // ii % clk share their clock bits, so from there on they count the same peaks.  One search
+        // per phase, noting its count at each start position, gives the count of them all.
+        uint16_t c = clk[clkCnt];
+        int32_t countAt[4096];
+        int32_t phaseCount[384];
+        bool phaseHigh[384];
+        bool phaseDone[384];
+        memset(phaseDone, 0, c * sizeof(bool));
+        for (ii = 20; ii < loopCnt && ii < end; ++ii) {
+            if (((dest[ii] >= peak) || (dest[ii] <= low)) && phaseDone[ii % c] == false) {
+                phaseDone[ii % c] = true;
+                phaseHigh[ii % c] = false;
+                phaseCount[ii % c] = nrz_clock_peaks(dest, ii, end, c, peak, low, &phaseHigh[ii % c], countAt, loopCnt);
+            }
+        }
+#endif
+
         //try lining up the peaks by moving starting point (try first 256)
         for (ii = 20; ii < loopCnt; ++ii) {
             if ((dest[ii] >= peak) || (dest[ii] <= low)) {
-                peakcnt = 0;
-                bitHigh = false;
-                ignoreCnt = 0;
-                lastBit = ii - clk[clkCnt];
-                //loop through to see if this start location works
-                for (i = ii; i < size - 20; ++i) {
-                    //if we are at a clock bit
-                    if ((i >= lastBit + clk[clkCnt] - tol) && (i <= lastBit + clk[clkCnt] + tol)) {
-                        //test high/low
-                        if (dest[i] >= peak || dest[i] <= low) {
-                            //if same peak don't count it
-                            if ((dest[i] >= peak && !lastPeakHigh) || (dest[i] <= low && lastPeakHigh)) {
-                                peakcnt++;
-                            }
-                            lastPeakHigh = (dest[i] >= peak);
-                            bitHigh = true;
-                            errBitHigh = false;
-                            ignoreCnt = ignoreWindow;
-                            lastBit += clk[clkCnt];
-                        } else if (i == lastBit + clk[clkCnt] + tol) {
-                            lastBit += clk[clkCnt];
-                        }
-                        //else if not a clock bit and no peaks
-                    } else if (dest[i] < peak && dest[i] > low) {
-                        if (ignoreCnt == 0) {
-                            bitHigh = false;
-                            if (errBitHigh == true)
-                                peakcnt--;
-                            errBitHigh = false;
-                        } else {
-                            ignoreCnt--;
-                        }
-                        // else if not a clock bit but we have a peak
-                    } else if ((dest[i] >= peak || dest[i] <= low) && (!bitHigh)) {
-                        //error bar found no clock...
-                        errBitHigh = true;
-                    }
+#ifndef ON_DEVICE
+                if (ii < end) {
+                    // the first peak counts against the last one of the previous start position
+                    bool high = (dest[ii] >= peak);
+                    peakcnt = ((high && !lastPeakHigh) || (dest[ii] <= low && lastPeakHigh)) + phaseCount[ii % c] - countAt[ii];
+                    lastPeakHigh = phaseHigh[ii % c];
+                } else {
+                    peakcnt = 0;
                 }
+#else
+                peakcnt = nrz_clock_peaks(dest, ii, end, clk[clkCnt], peak, low, &lastPeakHigh, NULL, 0);
+#endif
                 if (peakcnt > peaksdet[clkCnt]) {
                     bestStart[clkCnt] = ii;
                     peaksdet[clkCnt] = peakcnt;
@@ -1076,6 +1361,27 @@ int DetectNRZClock(uint8_t *dest, size_t size, int clock, size_t *clockStartIdx)
     return clk[best];
 }
 
+int DetectNRZClock(uint8_t *dest, size_t size, int clock, size_t *clockStartIdx) {
+#ifndef ON_DEVICE
+    clock_args_t in = { .type = CLOCK_NRZ, .clock = clock, .start = *clockStartIdx }, out;
+    int ret;
+    int cached = clock_cache_get(dest, size, &in, &out, &ret);
+    if (cached == 1) {
+        *clockStartIdx = out.start;
+        return ret;
+    }
+    ret = detect_nrz_clock(dest, size, clock, clockStartIdx);
+    if (cached == 0) {
+        out = in;
+        out.start = *clockStartIdx;
+        clock_cache_put(&in, &out, ret);
+    }
+    return ret;
+#else
+    return detect_nrz_clock(dest, size, clock, clockStartIdx);
+#endif
+}
+
 // countFC is to detect the field clock lengths.
 // counts and returns the 2 most common wave lengths
 // mainly used for FSK field clock detection
@@ -1088,42 +1394,54 @@ uint16_t countFC(const uint8_t *bits, size_t size, bool fskAdj) {
     size_t i;
     if (size < 180) return 0;
 
+#ifndef ON_DEVICE
+    wave_tops_t tops;
+    wave_tops_init(&tops, bits, 160, size - 20);
+    bool primed = false;
+    size_t last = 0;
+    while (wave_tops_next(&tops, &i)) {
+        // samples since the last up transition, the first one counts as one
+        fcCounter = primed ? i - last : 1;
+        primed = true;
+        last = i;
+#else
     // prime i to first up transition
     for (i = 160; i < size - 20; i++)
         if (bits[i] > bits[i - 1] && bits[i] >= bits[i + 1])
             break;
 
     for (; i < size - 20; i++) {
-        if (bits[i] > bits[i - 1] && bits[i] >= bits[i + 1]) {
-            // new up transition
-            fcCounter++;
-            if (fskAdj) {
-                //if we had 5 and now have 9 then go back to 8 (for when we get a fc 9 instead of an 8)
-                if (lastFCcnt == 5 && fcCounter == 9) fcCounter--;
-
-                //if fc=9 or 4 add one (for when we get a fc 9 instead of 10 or a 4 instead of a 5)
-                if ((fcCounter == 9) || fcCounter == 4) fcCounter++;
-                // save last field clock count  (fc/xx)
-                lastFCcnt = fcCounter;
-            }
-            // find which fcLens to save it to:
-            for (int m = 0; m < 15; m++) {
-                if (fcLens[m] == fcCounter) {
-                    fcCnts[m]++;
-                    fcCounter = 0;
-                    break;
-                }
-            }
-            if (fcCounter > 0 && fcLensFnd < 15) {
-                //add new fc length
-                fcCnts[fcLensFnd]++;
-                fcLens[fcLensFnd++] = fcCounter;
-            }
-            fcCounter = 0;
-        } else {
+        if (bits[i] <= bits[i - 1] || bits[i] < bits[i + 1]) {
             // count sample
             fcCounter++;
+            continue;
+        }
+        fcCounter++;
+#endif
+        // new up transition
+        if (fskAdj) {
+            //if we had 5 and now have 9 then go back to 8 (for when we get a fc 9 instead of an 8)
+            if (lastFCcnt == 5 && fcCounter == 9) fcCounter--;
+
+            //if fc=9 or 4 add one (for when we get a fc 9 instead of 10 or a 4 instead of a 5)
+            if ((fcCounter == 9) || fcCounter == 4) fcCounter++;
+            // save last field clock count  (fc/xx)
+            lastFCcnt = fcCounter;
         }
+        // find which fcLens to save it to:
+        for (int m = 0; m < 15; m++) {
+            if (fcLens[m] == fcCounter) {
+                fcCnts[m]++;
+                fcCounter = 0;
+                break;
+            }
+        }
+        if (fcCounter > 0 && fcLensFnd < 15) {
+            //add new fc length
+            fcCnts[fcLensFnd]++;
+            fcLens[fcLensFnd++] = fcCounter;
+        }
+        fcCounter = 0;
     }
 
     uint8_t best1 = 14, best2 = 14, best3 = 14;
@@ -1170,7 +1488,7 @@ uint16_t countFC(const uint8_t *bits, size_t size, bool fskAdj) {
 
 // detect psk clock by reading each phase shift
 // a phase shift is determined by measuring the sample length of each wave
-int DetectPSKClock(uint8_t *dest, size_t size, int clock, size_t *firstPhaseShift, uint8_t *curPhase, uint8_t *fc) {
+static int detect_psk_clock(uint8_t *dest, size_t size, int clock, size_t *firstPhaseShift, uint8_t *curPhase, uint8_t *fc) {
     uint16_t clk[] = {255, 16, 32, 40, 50, 64, 100, 128, 256, 272, 384}; // 255 is not a valid clock
     uint16_t loopCnt = 4096;  // don't need to loop through entire array...
 
@@ -1224,30 +1542,39 @@ int DetectPSKClock(uint8_t *dest, size_t size, int clock, size_t *firstPhaseShif
         uint16_t peakcnt = 0;
         if (g_debugMode == 2) prnt("DEBUG PSK: clk: %d, lastClkBit: %zu", clk[clkCnt], lastClkBit);
 
+#ifndef ON_DEVICE
+        //top edge of wave = start of new wave, at i + 1
+        wave_tops_t tops;
+        size_t top;
+        wave_tops_init(&tops, dest, firstFullWave + fullWaveLen, loopCnt - 1);
+        while (wave_tops_next(&tops, &top)) {
+            i = top - 1;
+#else
         for (i = firstFullWave + fullWaveLen - 1; i < loopCnt - 2; i++) {
             //top edge of wave = start of new wave
-            if (dest[i] < dest[i + 1] && dest[i + 1] >= dest[i + 2]) {
-                if (waveStart == 0) {
-                    waveStart = i + 1;
-                } else { //waveEnd
-                    waveEnd = i + 1;
-                    waveLenCnt = waveEnd - waveStart;
-                    if (waveLenCnt > *fc) {
-                        //if this wave is a phase shift
-                        if (g_debugMode == 2) prnt("DEBUG PSK: phase shift at: %zu, len: %d, nextClk: %zu, i: %zu, fc: %d", waveStart, waveLenCnt, lastClkBit + clk[clkCnt] - tol, i + 1, *fc);
-                        if (i + 1 >= lastClkBit + clk[clkCnt] - tol) { //should be a clock bit
-                            peakcnt++;
-                            lastClkBit += clk[clkCnt];
-                        } else if (i < lastClkBit + 8) {
-                            //noise after a phase shift - ignore
-                        } else { //phase shift before supposed to based on clock
-                            errCnt++;
-                        }
-                    } else if (i + 1 > lastClkBit + clk[clkCnt] + tol + *fc) {
-                        lastClkBit += clk[clkCnt]; //no phase shift but clock bit
+            if (dest[i] >= dest[i + 1] || dest[i + 1] < dest[i + 2])
+                continue;
+#endif
+            if (waveStart == 0) {
+                waveStart = i + 1;
+            } else { //waveEnd
+                waveEnd = i + 1;
+                waveLenCnt = waveEnd - waveStart;
+                if (waveLenCnt > *fc) {
+                    //if this wave is a phase shift
+                    if (g_debugMode == 2) prnt("DEBUG PSK: phase shift at: %zu, len: %d, nextClk: %zu, i: %zu, fc: %d", waveStart, waveLenCnt, lastClkBit + clk[clkCnt] - tol, i + 1, *fc);
+                    if (i + 1 >= lastClkBit + clk[clkCnt] - tol) { //should be a clock bit
+                        peakcnt++;
+                        lastClkBit += clk[clkCnt];
+                    } else if (i < lastClkBit + 8) {
+                        //noise after a phase shift - ignore
+                    } else { //phase shift before supposed to based on clock
+                        errCnt++;
                     }
-                    waveStart = i + 1;
+                } else if (i + 1 > lastClkBit + clk[clkCnt] + tol + *fc) {
+                    lastClkBit += clk[clkCnt]; //no phase shift but clock bit
                 }
+                waveStart = i + 1;
             }
         }
         if (errCnt == 0) return clk[clkCnt];
@@ -1266,6 +1593,31 @@ int DetectPSKClock(uint8_t *dest, size_t size, int clock, size_t *firstPhaseShif
     return clk[best];
 }
 
+int DetectPSKClock(uint8_t *dest, size_t size, int clock, size_t *firstPhaseShift, uint8_t *curPhase, uint8_t *fc) {
+#ifndef ON_DEVICE
+    clock_args_t in = { .type = CLOCK_PSK, .clock = clock, .start = *firstPhaseShift, .phase = *curPhase, .fc = *fc }, out;
+    int ret;
+    int cached = clock_cache_get(dest, size, &in, &out, &ret);
+    if (cached == 1) {
+        *firstPhaseShift = out.start;
+        *curPhase = out.phase;
+        *fc = out.fc;
+        return ret;
+    }
+    ret = detect_psk_clock(dest, size, clock, firstPhaseShift, curPhase, fc);
+    if (cached == 0) {
+        out = in;
+        out.start = *firstPhaseShift;
+        out.phase = *curPhase;
+        out.fc = *fc;
+        clock_cache_put(&in, &out, ret);
+    }
+    return ret;
+#else
+    return detect_psk_clock(dest, size, clock, firstPhaseShift, curPhase, fc);
+#endif
+}
+
 // detects the bit clock for FSK given the high and low Field Clocks
 uint8_t detectFSKClk(const uint8_t *bits, size_t size, uint8_t fcHigh, uint8_t fcLow, int *firstClockEdge) {
 
@@ -1283,6 +1635,21 @@ uint8_t detectFSKClk(const uint8_t *bits, size_t size, uint8_t fcHigh, uint8_t f
     size_t i;
     uint8_t fcTol = ((fcHigh * 100 - fcLow * 100) / 2 + 50) / 100; //(uint8_t)(0.5+(float)(fcHigh-fcLow)/2);
 
+#ifndef ON_DEVICE
+    wave_tops_t tops;
+    wave_tops_init(&tops, bits, 160, (size > 20) ? size - 20 : 0);
+    bool primed = false;
+    size_t last = 0;
+    while (wave_tops_next(&tops, &i)) {
+        // both count every sample since the last peak, from the first peak on
+        if (primed == false) {
+            last = i - 1;
+            primed = true;
+        }
+        fcCounter += i - last;
+        rfCounter += i - last;
+        last = i;
+#else
     // prime i to first peak / up transition
     for (i = 160; i < size - 20; i++)
         if (bits[i] > bits[i - 1] && bits[i] >= bits[i + 1])
@@ -1294,6 +1661,7 @@ uint8_t detectFSKClk(const uint8_t *bits, size_t size, uint8_t fcHigh, uint8_t f
 
         if (bits[i] <= bits[i - 1] || bits[i] < bits[i + 1])
             continue;
+#endif
         // else new peak
         // if we got less than the small fc + tolerance then set it to the small fc
         // if it is inbetween set it to the last counter
@@ -1508,13 +1876,12 @@ bool DetectST(uint8_t *buffer, size_t *size, int *foundclock, size_t *ststart, s
             *ststart = dataloc - (clk * 4);
             firstrun = false;
         }
-        for (i = 0; i < datalen; ++i) {
-            if (i + newloc < bufsize) {
-                if (i + newloc < dataloc)
-                    buffer[i + newloc] = buffer[dataloc];
+        // the last block ends with the samples
+        for (i = 0; i < datalen && dataloc < bufsize; ++i) {
+            if (i + newloc < dataloc)
+                buffer[i + newloc] = buffer[dataloc];
 
-                dataloc++;
-            }
+            dataloc++;
         }
         newloc += i;
         //skip next ST  -  we just assume it will be there from now on...
@@ -44,6 +44,14 @@ typedef struct {
 signal_t *getSignalProperties(void);
 
 void computeSignalProperties(const uint8_t *samples, uint32_t size);
+
+#ifndef ON_DEVICE
+// clock detections of one capture, shared between the threads demodulating it
+typedef struct clock_cache clock_cache_t;
+clock_cache_t *clockCacheNew(const uint8_t *samples, size_t size);
+void clockCacheFree(clock_cache_t *cc);
+void clockCacheBind(clock_cache_t *cc);
+#endif
 void removeSignalOffset(uint8_t *samples, uint32_t size);
 void getNextLow(const uint8_t *samples, size_t size, int low, size_t *i);
 void getNextHigh(const uint8_t *samples, size_t size, int high, size_t *i);
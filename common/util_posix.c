@@ -20,6 +20,9 @@
 #if !defined(_WIN32)
 
 #define _POSIX_C_SOURCE 200112L  // need localtime_r()
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE          // need _SC_NPROCESSORS_ONLN
+#endif
 #else
 #include <windows.h>
 #endif
@@ -32,6 +35,7 @@
 // Timer functions
 #if !defined (_WIN32)
 #include <errno.h>
+#include <unistd.h>
 
 static void nsleep(uint64_t n) {
     struct timespec timeout;
@@ -169,3 +173,16 @@ uint64_t usclock(void) {
 #endif
 }
 
+// determine number of logical CPU cores (use for multithreaded functions)
+int detect_num_CPUs(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+    return sysinfo.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count <= 0)
+        count = 1;
+    return count;
+#endif
+}
@@ -31,4 +31,5 @@ void msleep(uint32_t n);    // sleep n milliseconds
 
 uint64_t msclock(void);     // a milliseconds clock
 uint64_t usclock(void);     // a microseconds clock
+int detect_num_CPUs(void);  // number of logical CPUs
 #endif
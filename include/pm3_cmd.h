@@ -276,6 +276,15 @@ typedef struct {
     uint8_t data[];
 } PACKED lf_hitag_t;
 
+// For device memory downloads with DL_FLAG_CHUNK_CRC
+#define DL_CHUNK_DATA_SIZE (PM3_CMD_DATA_SIZE - 8)
+typedef struct {
+    uint32_t offset;  // device memory index of data[0]
+    uint16_t len;
+    uint16_t crc;     // CRC-16/XMODEM of data
+    uint8_t data[DL_CHUNK_DATA_SIZE];
+} PACKED dl_chunk_t;
+
 // For CMD_LF_SNIFF_RAW_ADC and CMD_LF_ACQ_RAW_ADC
 #define LF_SAMPLES_BITS 30
 #define MAX_LF_SAMPLES ((((uint32_t)1u) << LF_SAMPLES_BITS) - 1)
@@ -998,6 +1007,11 @@ typedef struct {
 /* CMD_READ_MEM_DOWNLOAD flags */
 #define READ_MEM_DOWNLOAD_FLAG_RAW                   (1<<0)
 
+/* CMD_DOWNLOAD_BIGBUF, CMD_DOWNLOAD_EML_BIGBUF and CMD_FLASHMEM_DOWNLOAD flags, in arg2.
+   With DL_FLAG_CHUNK_CRC the device answers with NG frames holding a dl_chunk_t instead of
+   OLD frames. Older firmwares ignore the flag. */
+#define DL_FLAG_CHUNK_CRC                            (1<<0)
+
 /* CMD_START_FLASH may have three arguments: start of area to flash,
    end of area to flash, optional magic.
    The bootrom will not allow to overwrite itself unless this magic
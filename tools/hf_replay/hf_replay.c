@@ -0,0 +1,1060 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Host side replay of FPGA sniff sample streams through the firmware
+// ISO14443A / ISO14443B / ISO15693 / iCLASS decoders.
+//
+// The decoders are the very same state machines the firmware runs, shared
+// through common/iso14443a_decode.h, common/iso14443b_decode.h and
+// common/iso15693_decode.h. The replay loops mirror the gating done by
+// SniffIso14443a(), SniffIso14443b() and SniffIso15693().
+//
+// Stream files hold the DMA words exactly as the sniffers read them:
+//   14a      one byte per sample,  hi nibble 4 reader samples, lo nibble 4 tag samples
+//   14b      one int16 LE per sample, hi byte I, lo byte Q, bit 0 of each is the reader bit
+//   15       one int16 LE per sample, bits 1,0 reader, bits 3,2 FSK, bits 15..4 tag amplitude
+//   iclass   same as 15
+// On the device one sample arrives every 4.72us (64/fc) for all of them.
+//
+// With -g -r the synthesised exchange is written as raw `hf sniff` samples
+// instead, a .pm3 file for `hf decode`, see raw_write().
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC
+#endif
+
+#include "iso14443a_decode.h"
+#include "iso14443b_decode.h"
+#include "iso15693_decode.h"
+#include "iso15693tools.h"
+
+#define MAX_FRAME_LEN       256
+#define MAX_FRAMES          4096
+// device sample period, 64/fc in ns
+#define SAMPLE_PERIOD_NS    4720.0
+
+typedef enum {
+    PROTO_14A,
+    PROTO_14B,
+    PROTO_15,
+    PROTO_ICLASS,
+} proto_t;
+
+typedef struct {
+    bool reader;
+    uint32_t start;
+    uint32_t end;
+    uint16_t len;
+    uint8_t data[MAX_FRAME_LEN];
+} frame_t;
+
+typedef struct {
+    frame_t *frames;
+    uint32_t cnt;
+} framelist_t;
+
+static void frame_add(framelist_t *fl, bool reader, uint32_t start, uint32_t end, const uint8_t *d, uint16_t len) {
+    if (fl == NULL || fl->cnt >= MAX_FRAMES) {
+        return;
+    }
+    frame_t *f = &fl->frames[fl->cnt++];
+    f->reader = reader;
+    f->start = start;
+    f->end = end;
+    f->len = (len > MAX_FRAME_LEN) ? MAX_FRAME_LEN : len;
+    memcpy(f->data, d, f->len);
+}
+
+static bool proto_from_str(const char *s, proto_t *p) {
+    if (strcmp(s, "14a") == 0) {
+        *p = PROTO_14A;
+    } else if (strcmp(s, "14b") == 0) {
+        *p = PROTO_14B;
+    } else if (strcmp(s, "15") == 0) {
+        *p = PROTO_15;
+    } else if (strcmp(s, "iclass") == 0) {
+        *p = PROTO_ICLASS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static const char *proto_to_str(proto_t p) {
+    switch (p) {
+        case PROTO_14A:
+            return "14a";
+        case PROTO_14B:
+            return "14b";
+        case PROTO_15:
+            return "15";
+        case PROTO_ICLASS:
+            return "iclass";
+    }
+    return "?";
+}
+
+// bytes per DMA sample in the stream file
+static size_t sample_size(proto_t p) {
+    return (p == PROTO_14A) ? 1 : 2;
+}
+
+//-----------------------------------------------------------------------------
+// Replay, one function per sniffer. Timestamps are in carrier cycles (1/fc)
+// counted from the start of the stream, without the sniffer air2arm delays.
+//-----------------------------------------------------------------------------
+static void replay_14a(const uint8_t *s, size_t n, framelist_t *fl) {
+    static uint8_t cmd[MAX_FRAME_LEN], cmd_par[MAX_FRAME_LEN];
+    static uint8_t resp[MAX_FRAME_LEN], resp_par[MAX_FRAME_LEN];
+
+    tUart14a uart = { .output = cmd, .output_len = sizeof(cmd), .parity = cmd_par };
+    tDemod14a demod = { .output = resp, .output_len = sizeof(resp), .parity = resp_par };
+    Uart14aResetEx(&uart);
+    Demod14aResetEx(&demod);
+
+    bool reader_active = false, tag_active = false;
+    uint8_t previous = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        // Need two samples to feed Miller and Manchester-Decoder
+        if (i & 1) {
+            // timestamp 0 means "measure real time" to the decoders
+            uint32_t ts = (i - 1) * 4 + 4;
+
+            if (tag_active == false) {
+                uint8_t readerdata = (previous & 0xF0) | (s[i] >> 4);
+                if (MillerDecodingEx(&uart, readerdata, ts)) {
+                    frame_add(fl, true, uart.startTime * 16, uart.endTime * 16, uart.output, uart.len);
+                    Uart14aResetEx(&uart);
+                    Demod14aResetEx(&demod);
+                }
+                reader_active = (uart.state != STATE_14A_UNSYNCD);
+            }
+
+            if (reader_active == false) {
+                uint8_t tagdata = (previous << 4) | (s[i] & 0x0F);
+                if (ManchesterDecodingEx(&demod, tagdata, 0, ts)) {
+                    frame_add(fl, false, demod.startTime * 16, demod.endTime * 16, demod.output, demod.len);
+                    Demod14aResetEx(&demod);
+                    Uart14aResetEx(&uart);
+                }
+                tag_active = (demod.state != DEMOD_14A_UNSYNCD);
+            }
+        }
+        previous = s[i];
+    }
+}
+
+static void replay_14b(const uint8_t *s, size_t n, framelist_t *fl) {
+    static uint8_t cmd[MAX_FRAME_LEN], resp[MAX_FRAME_LEN];
+
+    tUart14b uart = { .output = cmd, .byteCntMax = sizeof(cmd) };
+    tDemod14b demod = { .output = resp, .max_len = sizeof(resp) };
+    Uart14bResetEx(&uart);
+    Demod14bResetEx(&demod);
+
+    bool reader_active = false, tag_active = false, expect_tag_answer = false;
+
+    for (size_t i = 0; i < n; i++) {
+        int8_t ci = s[i * 2 + 1];
+        int8_t cq = s[i * 2];
+        // one sample is 64/fc, one reader bit is a quarter of an ETU
+        uint32_t ts = i * 64;
+
+        if (tag_active == false) {
+            for (uint8_t k = 0; k < 2; k++) {
+                if (Handle14443bSampleFromReaderEx(&uart, (k ? cq : ci) & 0x01)) {
+                    if (uart.byteCnt > 0) {
+                        uint32_t eof = ts + (k + 1) * 32;
+                        uint32_t sof = eof - uart.byteCnt * 10 * 128 - 12 * 128 - 10 * 128;
+                        frame_add(fl, true, sof, eof, uart.output, uart.byteCnt);
+                    }
+                    Uart14bResetEx(&uart);
+                    Demod14bResetEx(&demod);
+                    expect_tag_answer = true;
+                }
+            }
+            reader_active = (uart.state > STATE_14B_GOT_FALLING_EDGE_OF_SOF);
+        }
+
+        if (reader_active == false && expect_tag_answer) {
+            if (Handle14443bSamplesFromTagEx(&demod, ci >> 1, cq >> 1)) {
+                uint32_t eof = ts + 64;
+                uint32_t sof = eof - demod.len * 10 * 128 - 12 * 128 - 10 * 128;
+                frame_add(fl, false, sof, eof, demod.output, demod.len);
+                Uart14bResetEx(&uart);
+                Demod14bResetEx(&demod);
+                expect_tag_answer = false;
+                tag_active = false;
+            } else {
+                tag_active = (demod.state > WAIT_FOR_RISING_EDGE_OF_SOF);
+            }
+        }
+    }
+}
+
+static void replay_15(const uint8_t *s, size_t n, bool iclass, framelist_t *fl) {
+    static uint8_t cmd[MAX_FRAME_LEN], resp[MAX_FRAME_LEN], resp2[MAX_FRAME_LEN];
+
+    DecodeTag_t dtag = {0};
+    DecodeTagInit(&dtag, resp, sizeof(resp));
+    DecodeTagFSK_t dtagfsk = {0};
+    DecodeTagFSKInit(&dtagfsk, resp2, sizeof(resp2));
+    DecodeReader_t dreader = {0};
+    DecodeReaderInit(&dreader, cmd, sizeof(cmd), 0, NULL);
+
+    bool tag_active = false, reader_active = false, expect_tag_answer = false;
+    bool expect_fsk_answer = false, expect_fast_answer = true;
+    uint16_t sniffdata = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        uint16_t sniffdata_prev = sniffdata;
+        sniffdata = s[i * 2] | (s[i * 2 + 1] << 8);
+        uint32_t ts = (i + 1) * 64;
+
+        if (tag_active == false) {
+            if (Handle15693SampleFromReader((sniffdata & 0x02) >> 1, &dreader) ||
+                    Handle15693SampleFromReader(sniffdata & 0x01, &dreader)) {
+
+                if (dreader.byteCount > 0) {
+                    uint32_t sof = ts - dreader.byteCount * (dreader.Coding == CODING_1_OUT_OF_4 ? 4096 : 65536) - 1024 - 512;
+                    frame_add(fl, true, sof, ts, dreader.output, dreader.byteCount);
+                    if (iclass == false) {
+                        expect_fsk_answer = dreader.output[0] & ISO15_REQ_SUBCARRIER_TWO;
+                        expect_fast_answer = dreader.output[0] & ISO15_REQ_DATARATE_HIGH;
+                    }
+                }
+                DecodeTagReset(&dtag);
+                DecodeTagFSKReset(&dtagfsk);
+                reader_active = false;
+                expect_tag_answer = true;
+            } else {
+                reader_active = (dreader.state >= STATE_READER_RECEIVE_DATA_1_OUT_OF_4);
+            }
+        }
+
+        if (reader_active == false && expect_tag_answer) {
+
+            if (expect_fsk_answer == false) {
+                if (Handle15693SamplesFromTag((sniffdata >> 4) << 2, &dtag, expect_fast_answer)) {
+                    uint32_t eof = ts;
+                    if (dtag.lastBit == SOF_PART2) {
+                        eof -= 8 * 64;
+                    }
+                    uint32_t sof = eof - dtag.len * 4096 - 2048 - (dtag.lastBit != SOF_PART2 ? 2048 : 0);
+                    frame_add(fl, false, sof, eof, dtag.output, dtag.len);
+                    DecodeTagReset(&dtag);
+                    DecodeTagFSKReset(&dtagfsk);
+                    DecodeReaderReset(&dreader);
+                    expect_tag_answer = false;
+                    tag_active = false;
+                } else {
+                    tag_active = (dtag.state >= STATE_TAG_RECEIVING_DATA);
+                }
+            } else {
+                // tolerate 1 00
+                if (FREQ_IS_0((sniffdata >> 2) & 0x3)) {
+                    sniffdata = sniffdata_prev;
+                }
+                if (Handle15693FSKSamplesFromTag((sniffdata >> 2) & 0x3, &dtagfsk, expect_fast_answer)) {
+                    if (dtagfsk.len > 0) {
+                        uint32_t eof = ts;
+                        if (dtagfsk.lastBit == SOF) {
+                            eof -= 8 * 64;
+                        }
+                        uint32_t sof = eof - dtagfsk.len * 4064 - 2048 - (dtagfsk.lastBit != SOF ? 2048 : 0);
+                        frame_add(fl, false, sof, eof, dtagfsk.output, dtagfsk.len);
+                    }
+                    DecodeTagFSKReset(&dtagfsk);
+                    DecodeReaderReset(&dreader);
+                    expect_tag_answer = false;
+                    tag_active = false;
+                    expect_fsk_answer = false;
+                } else {
+                    tag_active = (dtagfsk.state >= STATE_FSK_RECEIVING_DATA_484);
+                }
+            }
+        }
+    }
+}
+
+static void replay(proto_t p, const uint8_t *s, size_t n, framelist_t *fl) {
+    switch (p) {
+        case PROTO_14A:
+            replay_14a(s, n, fl);
+            break;
+        case PROTO_14B:
+            replay_14b(s, n, fl);
+            break;
+        case PROTO_15:
+        case PROTO_ICLASS:
+            replay_15(s, n, p == PROTO_ICLASS, fl);
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Stream synthesis. Frames alternate reader, tag, reader, tag, ...
+// The encoders produce ideal waveforms, 14b and 15 get a little noise on the
+// analog tag channel from a fixed seed so runs are reproducible.
+//-----------------------------------------------------------------------------
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t max;
+    // raw `hf sniff` samples instead of sniffer words, tag subcarrier period in samples, see raw_put()
+    int raw;
+} stream_t;
+
+static uint32_t noise_state = 0x12345678;
+
+static int noise(int amplitude) {
+    if (amplitude == 0) {
+        return 0;
+    }
+    noise_state = noise_state * 1103515245 + 12345;
+    return (int)((noise_state >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+static bool stream_grow(stream_t *st, size_t add) {
+    if (st->len + add <= st->max) {
+        return true;
+    }
+    size_t nmax = (st->max == 0) ? 0x10000 : st->max;
+    while (nmax < st->len + add) {
+        nmax *= 2;
+    }
+    uint8_t *nbuf = realloc(st->buf, nmax);
+    if (nbuf == NULL) {
+        return false;
+    }
+    st->buf = nbuf;
+    st->max = nmax;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Raw `hf sniff` samples, one HIPKD ADC value every 8/fc, see client/src/hfdecode.c
+// The encoders below hand over the reader field and the tag subcarrier per
+// sample, two bytes each, raw_write() then runs them through a model of the
+// AC coupled front end. The model is fitted to traces/hf_sniff_14b_scl3711.pm3:
+//   - idle baseline at -15, a few counts of noise
+//   - a field step clips at +-127 for ~6 samples and decays by ~0.7 per sample,
+//     with some undershoot ringing at ~28 samples per period
+//   - the tag subcarrier adds on top of the envelope, fc/16 flips the sign every
+//     sample, fc/32 every second one
+// The 14b capture is 10% ASK. 100% ASK (14a, 15, iCLASS) gets a deeper step.
+//-----------------------------------------------------------------------------
+#define RAW_BASELINE        -15
+#define RAW_NOISE           3
+#define RAW_STEP_10         1000
+#define RAW_STEP_100        2000
+#define RAW_DECAY           0.7
+#define RAW_RING            10
+#define RAW_RING_PERIOD     28
+
+// tag subcarrier amplitude, in ADC counts
+static int raw_tag_amplitude = 20;
+
+// cnt samples of field (1 = unmodulated) and subcarrier (0 = off, +-1 phase)
+static bool raw_put(stream_t *st, uint8_t field, int phase, int cnt) {
+    if (stream_grow(st, cnt * 2) == false) {
+        return false;
+    }
+    for (int i = 0; i < cnt; i++) {
+        size_t n = st->len / 2;
+        int8_t sub = 0;
+        if (phase) {
+            // fc/16: + - + -, fc/32: + + - -
+            sub = (((n * 2 / st->raw) & 1) ? -phase : phase);
+        }
+        st->buf[st->len++] = field;
+        st->buf[st->len++] = (uint8_t)sub;
+    }
+    return true;
+}
+
+static bool raw_write(const stream_t *st, bool ask100, FILE *f) {
+    size_t n = st->len / 2;
+    double step = ask100 ? RAW_STEP_100 : RAW_STEP_10;
+    double y = 0, r1 = 0, r2 = 0;
+    // damped resonator for the ringing, r[n] = 2 a cos(w) r[n-1] - a^2 r[n-2]
+    const double a = 0.95;
+    const double c = 0.9749279;     // cos(2 pi / RAW_RING_PERIOD)
+    uint8_t prev = 1, last = 1;
+
+    for (size_t i = 0; i < n; i++) {
+        uint8_t field = st->buf[i * 2];
+        int8_t sub = (int8_t)st->buf[i * 2 + 1];
+
+        // reader pulses jitter by a sample, the modulation is not on the sample grid
+        bool edge = (field != last);
+        last = field;
+        if (edge && noise(1) > 0) {
+            field = prev;
+        }
+
+        double e = step * ((int)field - (int)prev);
+        y = RAW_DECAY * (y + e);
+        double r = 2 * a * c * r1 - a * a * r2 + ((e > 0) ? -RAW_RING : (e < 0) ? RAW_RING : 0);
+        r2 = r1;
+        r1 = r;
+        prev = field;
+
+        int v = (int)(y + r) + RAW_BASELINE + sub * raw_tag_amplitude + noise(RAW_NOISE);
+        if (v > 127) {
+            v = 127;
+        } else if (v < -128) {
+            v = -128;
+        }
+        if (fprintf(f, "%d\n", v) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint8_t oddparity8(uint8_t b) {
+    b ^= b >> 4;
+    b ^= b >> 2;
+    b ^= b >> 1;
+    return (~b) & 1;
+}
+
+// ISO14443A works on ticks of 16/fc, two stream bytes per bit period (8 ticks)
+typedef struct {
+    uint8_t *reader;    // 1 = field, 0 = pause
+    uint8_t *tag;       // 1 = load modulation
+    size_t len;
+    size_t max;
+} ticks14a_t;
+
+static bool ticks14a_put(ticks14a_t *t, uint8_t pattern, bool reader) {
+    if (t->len + 8 > t->max) {
+        size_t nmax = (t->max == 0) ? 0x10000 : t->max * 2;
+        uint8_t *r = realloc(t->reader, nmax);
+        if (r == NULL) {
+            return false;
+        }
+        t->reader = r;
+        uint8_t *g = realloc(t->tag, nmax);
+        if (g == NULL) {
+            return false;
+        }
+        t->tag = g;
+        t->max = nmax;
+    }
+    for (int i = 7; i >= 0; i--) {
+        uint8_t b = (pattern >> i) & 1;
+        t->reader[t->len] = reader ? b : 1;
+        t->tag[t->len] = reader ? 0 : b;
+        t->len++;
+    }
+    return true;
+}
+
+#define MILLER_X    0xF3    // 111100x1, pause in the second half
+#define MILLER_Y    0xFF    // no pause
+#define MILLER_Z    0x3F    // 00x11111, pause in the first half
+#define MANCH_D     0xF0    // subcarrier in the first half
+#define MANCH_E     0x0F    // subcarrier in the second half
+#define MANCH_F     0x00    // no subcarrier
+
+static bool gen_14a_frame(ticks14a_t *t, const uint8_t *d, size_t len, bool reader) {
+    // REQA / WUPA go out as 7 bit short frames, without parity
+    bool short_frame = reader && len == 1 && (d[0] == 0x26 || d[0] == 0x52);
+
+    uint8_t bits[MAX_FRAME_LEN * 9];
+    size_t nbits = 0;
+    for (size_t i = 0; i < len; i++) {
+        for (int j = 0; j < (short_frame ? 7 : 8); j++) {
+            bits[nbits++] = (d[i] >> j) & 1;
+        }
+        if (short_frame == false) {
+            bits[nbits++] = oddparity8(d[i]);
+        }
+    }
+
+    if (reader) {
+        // start of communication, logic 0 coded as Z
+        if (ticks14a_put(t, MILLER_Z, true) == false) {
+            return false;
+        }
+        uint8_t last = 0;
+        for (size_t i = 0; i < nbits; i++) {
+            uint8_t seq = bits[i] ? MILLER_X : (last ? MILLER_Y : MILLER_Z);
+            if (ticks14a_put(t, seq, true) == false) {
+                return false;
+            }
+            last = bits[i];
+        }
+        // end of communication, logic 0 followed by Y
+        if (ticks14a_put(t, last ? MILLER_Y : MILLER_Z, true) == false) {
+            return false;
+        }
+        return ticks14a_put(t, MILLER_Y, true);
+    }
+
+    if (ticks14a_put(t, MANCH_D, false) == false) {
+        return false;
+    }
+    for (size_t i = 0; i < nbits; i++) {
+        if (ticks14a_put(t, bits[i] ? MANCH_D : MANCH_E, false) == false) {
+            return false;
+        }
+    }
+    return ticks14a_put(t, MANCH_F, false);
+}
+
+static bool gen_14a_idle(ticks14a_t *t, int bitperiods) {
+    for (int i = 0; i < bitperiods; i++) {
+        if (ticks14a_put(t, 0xFF, true) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool gen_14a(stream_t *st, uint8_t **frames, size_t *lens, size_t cnt) {
+    ticks14a_t t = {0};
+    bool ok = gen_14a_idle(&t, 4);
+    for (size_t i = 0; ok && i < cnt; i++) {
+        bool reader = ((i & 1) == 0);
+        ok = gen_14a_frame(&t, frames[i], lens[i], reader);
+        // frame delay time, ~9 bit periods before the tag answers
+        ok = ok && gen_14a_idle(&t, reader ? 10 : 20);
+    }
+
+    if (ok && st->raw) {
+        // two samples per tick
+        for (size_t i = 0; ok && i < t.len; i++) {
+            ok = raw_put(st, t.reader[i], t.tag[i], 2);
+        }
+    } else if (ok && stream_grow(st, t.len / 4)) {
+        // four ticks of each direction per stream byte
+        for (size_t i = 0; i + 4 <= t.len; i += 4) {
+            uint8_t b = 0;
+            for (int j = 0; j < 4; j++) {
+                b |= t.reader[i + j] << (7 - j);
+                b |= t.tag[i + j] << (3 - j);
+            }
+            st->buf[st->len++] = b;
+        }
+    } else {
+        ok = false;
+    }
+    free(t.reader);
+    free(t.tag);
+    return ok;
+}
+
+// ISO14443B, half an ETU per sample: two reader bits, one I/Q pair
+static bool put_14b(stream_t *st, uint8_t r0, uint8_t r1, int ci, int cq) {
+    if (st->raw) {
+        int phase = (ci > 0) ? 1 : (ci < 0) ? -1 : 0;
+        return raw_put(st, r0, phase, 4) && raw_put(st, r1, phase, 4);
+    }
+    if (stream_grow(st, 2) == false) {
+        return false;
+    }
+    st->buf[st->len++] = (uint8_t)(((cq + noise(2)) << 1) | r1);
+    st->buf[st->len++] = (uint8_t)(((ci + noise(2)) << 1) | r0);
+    return true;
+}
+
+// subcarrier phase vector, logic 1 is the phase reference
+#define BPSK_I  35
+#define BPSK_Q  20
+
+static bool gen_14b_etu_reader(stream_t *st, uint8_t bit, int etus) {
+    for (int i = 0; i < etus * 2; i++) {
+        if (put_14b(st, bit, bit, 0, 0) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool gen_14b_etu_tag(stream_t *st, int bit, int etus) {
+    // bit < 0: subcarrier off
+    int ci = (bit < 0) ? 0 : (bit ? BPSK_I : -BPSK_I);
+    int cq = (bit < 0) ? 0 : (bit ? BPSK_Q : -BPSK_Q);
+    for (int i = 0; i < etus * 2; i++) {
+        if (put_14b(st, 1, 1, ci, cq) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool gen_14b(stream_t *st, uint8_t **frames, size_t *lens, size_t cnt) {
+    bool ok = gen_14b_etu_reader(st, 1, 10);
+    for (size_t i = 0; ok && i < cnt; i++) {
+        if ((i & 1) == 0) {
+            // SOF, 10 ETU low, 2 ETU high
+            ok = gen_14b_etu_reader(st, 0, 10) && gen_14b_etu_reader(st, 1, 2);
+            for (size_t j = 0; ok && j < lens[i]; j++) {
+                ok = gen_14b_etu_reader(st, 0, 1);
+                for (int k = 0; ok && k < 8; k++) {
+                    ok = gen_14b_etu_reader(st, (frames[i][j] >> k) & 1, 1);
+                }
+                ok = ok && gen_14b_etu_reader(st, 1, 1);
+            }
+            // EOF, 10 ETU low, then guard time until the tag answers
+            ok = ok && gen_14b_etu_reader(st, 0, 10) && gen_14b_etu_reader(st, 1, 8);
+        } else {
+            // TR1 phase reference, then SOF
+            ok = gen_14b_etu_tag(st, 1, 12) && gen_14b_etu_tag(st, 0, 10) && gen_14b_etu_tag(st, 1, 2);
+            for (size_t j = 0; ok && j < lens[i]; j++) {
+                ok = gen_14b_etu_tag(st, 0, 1);
+                for (int k = 0; ok && k < 8; k++) {
+                    ok = gen_14b_etu_tag(st, (frames[i][j] >> k) & 1, 1);
+                }
+                ok = ok && gen_14b_etu_tag(st, 1, 1);
+            }
+            ok = ok && gen_14b_etu_tag(st, 0, 10) && gen_14b_etu_tag(st, -1, 20);
+        }
+    }
+    return ok;
+}
+
+// ISO15693, one sample is two reader bits (2.36us each) and one tag amplitude
+#define ASK_HIGH    1000
+#define ASK_LOW     20
+
+static bool put_15(stream_t *st, uint8_t r1, uint8_t r0, int amplitude) {
+    if (st->raw) {
+        int phase = (amplitude == ASK_HIGH) ? 1 : 0;
+        return raw_put(st, r1, phase, 4) && raw_put(st, r0, phase, 4);
+    }
+    if (stream_grow(st, 2) == false) {
+        return false;
+    }
+    amplitude += noise(amplitude / 20);
+    if (amplitude < 0) {
+        amplitude = 0;
+    }
+    uint16_t w = ((amplitude >> 2) << 4) | (r1 << 1) | r0;
+    st->buf[st->len++] = w & 0xFF;
+    st->buf[st->len++] = w >> 8;
+    return true;
+}
+
+// reader half samples, collected and then paired into stream words
+typedef struct {
+    uint8_t *bits;
+    size_t len;
+    size_t max;
+} halfs_t;
+
+static bool halfs_put(halfs_t *h, uint8_t bit, int cnt) {
+    if (h->len + cnt > h->max) {
+        size_t nmax = (h->max == 0) ? 0x1000 : h->max;
+        while (nmax < h->len + cnt) {
+            nmax *= 2;
+        }
+        uint8_t *nb = realloc(h->bits, nmax);
+        if (nb == NULL) {
+            return false;
+        }
+        h->bits = nb;
+        h->max = nmax;
+    }
+    memset(h->bits + h->len, bit, cnt);
+    h->len += cnt;
+    return true;
+}
+
+static bool gen_15_reader(stream_t *st, const uint8_t *d, size_t len) {
+    halfs_t h = {0};
+    // SOF, 1 out of 4
+    bool ok = halfs_put(&h, 0, 4) && halfs_put(&h, 1, 16) && halfs_put(&h, 0, 4) && halfs_put(&h, 1, 8);
+    for (size_t i = 0; ok && i < len; i++) {
+        for (int k = 0; ok && k < 4; k++) {
+            int v = (d[i] >> (k * 2)) & 3;
+            ok = halfs_put(&h, 1, v * 8 + 4) && halfs_put(&h, 0, 4) && halfs_put(&h, 1, 24 - v * 8);
+        }
+    }
+    // EOF, pulse in the second slot
+    ok = ok && halfs_put(&h, 1, 8) && halfs_put(&h, 0, 4) && halfs_put(&h, 1, 20);
+    if (ok && (h.len & 1)) {
+        ok = halfs_put(&h, 1, 1);
+    }
+    for (size_t i = 0; ok && i < h.len; i += 2) {
+        ok = put_15(st, h.bits[i], h.bits[i + 1], ASK_LOW);
+    }
+    free(h.bits);
+    return ok;
+}
+
+static bool gen_15_tag_level(stream_t *st, int amplitude, int cnt) {
+    for (int i = 0; i < cnt; i++) {
+        if (put_15(st, 1, 1, amplitude) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool gen_15_tag(stream_t *st, const uint8_t *d, size_t len) {
+    // high data rate, single subcarrier, 8 samples per bit
+    // SOF: unmodulated, 24 pulses, logic 1
+    bool ok = gen_15_tag_level(st, ASK_LOW, 12) && gen_15_tag_level(st, ASK_HIGH, 12);
+    ok = ok && gen_15_tag_level(st, ASK_LOW, 4) && gen_15_tag_level(st, ASK_HIGH, 4);
+    for (size_t i = 0; ok && i < len; i++) {
+        for (int k = 0; ok && k < 8; k++) {
+            if ((d[i] >> k) & 1) {
+                ok = gen_15_tag_level(st, ASK_LOW, 4) && gen_15_tag_level(st, ASK_HIGH, 4);
+            } else {
+                ok = gen_15_tag_level(st, ASK_HIGH, 4) && gen_15_tag_level(st, ASK_LOW, 4);
+            }
+        }
+    }
+    // EOF: logic 0, 24 pulses, unmodulated
+    if (len) {
+        ok = ok && gen_15_tag_level(st, ASK_HIGH, 4) && gen_15_tag_level(st, ASK_LOW, 4);
+        ok = ok && gen_15_tag_level(st, ASK_HIGH, 12) && gen_15_tag_level(st, ASK_LOW, 12);
+    }
+    return ok;
+}
+
+static bool gen_15(stream_t *st, uint8_t **frames, size_t *lens, size_t cnt) {
+    bool ok = gen_15_tag_level(st, ASK_LOW, 32);
+    for (size_t i = 0; ok && i < cnt; i++) {
+        if ((i & 1) == 0) {
+            // ~300us until the tag answers
+            ok = gen_15_reader(st, frames[i], lens[i]) && gen_15_tag_level(st, ASK_LOW, 64);
+        } else {
+            ok = gen_15_tag(st, frames[i], lens[i]) && gen_15_tag_level(st, ASK_LOW, 128);
+        }
+    }
+    return ok;
+}
+
+static bool generate(proto_t p, stream_t *st, uint8_t **frames, size_t *lens, size_t cnt) {
+    switch (p) {
+        case PROTO_14A:
+            return gen_14a(st, frames, lens, cnt);
+        case PROTO_14B:
+            return gen_14b(st, frames, lens, cnt);
+        case PROTO_15:
+        case PROTO_ICLASS:
+            return gen_15(st, frames, lens, cnt);
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Helpers
+//-----------------------------------------------------------------------------
+static int hex_to_frame(const char *s, uint8_t *d, size_t max) {
+    size_t n = 0;
+    while (*s) {
+        if (isspace((unsigned char)*s)) {
+            s++;
+            continue;
+        }
+        if (isxdigit((unsigned char)s[0]) == 0 || isxdigit((unsigned char)s[1]) == 0 || n >= max) {
+            return -1;
+        }
+        unsigned int v;
+        sscanf(s, "%2x", &v);
+        d[n++] = v;
+        s += 2;
+    }
+    return n;
+}
+
+static void print_frames(const framelist_t *fl) {
+    printf("      Start |        End | Src | Data\n");
+    printf("------------+------------+-----+----------------------------------------\n");
+    for (uint32_t i = 0; i < fl->cnt; i++) {
+        const frame_t *f = &fl->frames[i];
+        printf(" %10u | %10u | %s |", f->start, f->end, f->reader ? "Rdr" : "Tag");
+        for (uint16_t j = 0; j < f->len; j++) {
+            printf(" %02x", f->data[j]);
+        }
+        printf("\n");
+    }
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// replays the stream `iter` times, the frames of the first run are kept
+static void bench(proto_t p, const uint8_t *s, size_t n, uint32_t iter, framelist_t *fl) {
+    replay(p, s, n, fl);
+
+    uint64_t t0 = now_ns();
+#ifdef HAVE_RDTSC
+    uint64_t c0 = __rdtsc();
+#endif
+    for (uint32_t i = 0; i < iter; i++) {
+        replay(p, s, n, NULL);
+    }
+#ifdef HAVE_RDTSC
+    uint64_t c1 = __rdtsc();
+#endif
+    uint64_t t1 = now_ns();
+
+    printf("%-6s | %9zu samples | %4u frames", proto_to_str(p), n, fl->cnt);
+    // nothing timed without -b, no rate for an empty stream
+    if (iter == 0 || n == 0) {
+        printf("\n");
+        return;
+    }
+
+    double samples = (double)n * iter;
+    double ns = (double)(t1 - t0) / samples;
+    printf(" | %7.2f ns/sample", ns);
+#ifdef HAVE_RDTSC
+    printf(" | %7.2f cycles/sample", (double)(c1 - c0) / samples);
+#endif
+    printf(" | %6.0fx realtime\n", SAMPLE_PERIOD_NS / ns);
+}
+
+//-----------------------------------------------------------------------------
+// Self test, encode known exchanges, decode them and compare
+//-----------------------------------------------------------------------------
+typedef struct {
+    proto_t proto;
+    const char *frames[8];
+} selftest_t;
+
+static const selftest_t selftests[] = {
+    { PROTO_14A, {
+            "26", "4400",
+            "9320", "88041122bf",
+            "9370880411 22bf2a8e", "04da17",
+            "3000 02a8", "0411223344556677 8899aabbccddeeff 0000",
+        }
+    },
+    { PROTO_14B, {
+            "050008 3973", "50 82 0d e1 74 20 38 19 22 00 21 85 5e d7",
+            "1d 820de174 0008 0100 b4 29", "10 f9e0",
+            "0200 a0 07", "12 34 56 78 eb 2c",
+            NULL,
+        }
+    },
+    { PROTO_15, {
+            "260100 f60a", "0000 6b9f8a0b000104e0 d7c6",
+            "22206b9f8a0b000104e0 00 f6c6", "00 11223344 d0c3",
+            "022b 9e34", "000f e0040100000b8a9f6b 0003 1b03 8b 01 c839",
+            NULL,
+        }
+    },
+    { PROTO_ICLASS, {
+            "0a", "0f",
+            "0c", "56d5e5e4e7ff12e0 0b3f",
+            "810201", "feffffffffffffff 9b60",
+            NULL,
+        }
+    },
+};
+
+static int selftest(uint32_t iter) {
+    static uint8_t data[8][MAX_FRAME_LEN];
+    framelist_t fl = { .frames = calloc(MAX_FRAMES, sizeof(frame_t)) };
+    if (fl.frames == NULL) {
+        return 1;
+    }
+
+    int fails = 0;
+    for (size_t t = 0; t < sizeof(selftests) / sizeof(selftests[0]); t++) {
+        const selftest_t *st = &selftests[t];
+        uint8_t *frames[8];
+        size_t lens[8];
+        size_t cnt = 0;
+        for (; cnt < 8 && st->frames[cnt]; cnt++) {
+            frames[cnt] = data[cnt];
+            lens[cnt] = hex_to_frame(st->frames[cnt], data[cnt], MAX_FRAME_LEN);
+        }
+
+        stream_t s = {0};
+        noise_state = 0x12345678;
+        if (generate(st->proto, &s, frames, lens, cnt) == false) {
+            free(s.buf);
+            free(fl.frames);
+            return 1;
+        }
+
+        // repeat the exchange a few times, to catch decoders not resetting properly
+        size_t one = s.len;
+        for (int r = 0; r < 7 && stream_grow(&s, one); r++) {
+            memcpy(s.buf + s.len, s.buf, one);
+            s.len += one;
+        }
+
+        fl.cnt = 0;
+        bench(st->proto, s.buf, s.len / sample_size(st->proto), iter, &fl);
+
+        bool ok = (fl.cnt == cnt * 8);
+        for (uint32_t i = 0; ok && i < fl.cnt; i++) {
+            size_t k = i % cnt;
+            ok = (fl.frames[i].reader == ((k & 1) == 0)) && fl.frames[i].len == lens[k] && memcmp(fl.frames[i].data, frames[k], lens[k]) == 0;
+        }
+        if (ok == false) {
+            printf("%-6s | decoded frames do not match\n", proto_to_str(st->proto));
+            print_frames(&fl);
+            fails++;
+        }
+        free(s.buf);
+    }
+    free(fl.frames);
+
+    printf("\nself test: %s\n", fails ? "failed" : "ok");
+    return fails ? 1 : 0;
+}
+
+static void usage(const char *name) {
+    printf("Replays FPGA sniff sample streams through the firmware HF decoders.\n\n");
+    printf("syntax:  %s [-b <n>] <14a|14b|15|iclass> <stream file>\n", name);
+    printf("         %s -g <14a|14b|15|iclass> <stream file> <hex frame> [<hex frame> ...]\n", name);
+    printf("         %s -g -r [-a <n>] <14a|14b|15|iclass> <pm3 file> <hex frame> [<hex frame> ...]\n", name);
+    printf("         %s -t [-b <n>]\n\n", name);
+    printf("  -b <n>    replay the stream n more times and report the decoder speed\n");
+    printf("  -g        synthesise a stream, frames alternate reader / tag\n");
+    printf("  -r        with -g, write raw `hf sniff` samples for `hf decode` instead, one per line\n");
+    printf("  -a <n>    tag subcarrier amplitude of the raw samples, default %d\n", raw_tag_amplitude);
+    printf("  -t        self test, synthesise, decode and compare all protocols\n\n");
+    printf("example: %s -g 14a 14a.bin 26 4400 9320 88041122bf\n", name);
+    printf("         %s -g -r 14a 14a.pm3 26 4400 9320 88041122bf\n", name);
+    printf("         %s -b 100 14a 14a.bin\n\n", name);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t iter = 0;
+    bool gen = false, test = false, raw = false;
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            iter = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-g") == 0) {
+            gen = true;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            raw = true;
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            raw_tag_amplitude = strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            test = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (test) {
+        return selftest(iter);
+    }
+
+    proto_t p;
+    if (argc - i < 2 || proto_from_str(argv[i], &p) == false || (gen && argc - i < 3)) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *fn = argv[i + 1];
+
+    if (gen) {
+        size_t cnt = argc - i - 2;
+        uint8_t **frames = calloc(cnt, sizeof(uint8_t *));
+        size_t *lens = calloc(cnt, sizeof(size_t));
+        uint8_t *data = calloc(cnt, MAX_FRAME_LEN);
+        stream_t s = {0};
+        if (raw) {
+            s.raw = (p == PROTO_15 || p == PROTO_ICLASS) ? 4 : 2;
+        }
+        int res = 1;
+        if (frames && lens && data) {
+            res = 0;
+            for (size_t j = 0; j < cnt; j++) {
+                frames[j] = data + j * MAX_FRAME_LEN;
+                int n = hex_to_frame(argv[i + 2 + j], frames[j], MAX_FRAME_LEN);
+                if (n <= 0) {
+                    printf("invalid frame: %s\n", argv[i + 2 + j]);
+                    res = 1;
+                    break;
+                }
+                lens[j] = n;
+            }
+        }
+        if (res == 0 && generate(p, &s, frames, lens, cnt)) {
+            FILE *f = fopen(fn, raw ? "w" : "wb");
+            if (f && raw && raw_write(&s, p != PROTO_14B, f)) {
+                printf("wrote %zu raw samples to %s\n", s.len / 2, fn);
+            } else if (f && raw == false && fwrite(s.buf, 1, s.len, f) == s.len) {
+                printf("wrote %zu samples to %s\n", s.len / sample_size(p), fn);
+            } else {
+                printf("could not write %s\n", fn);
+                res = 1;
+            }
+            if (f) {
+                fclose(f);
+            }
+        }
+        free(s.buf);
+        free(data);
+        free(lens);
+        free(frames);
+        return res;
+    }
+
+    FILE *f = fopen(fn, "rb");
+    if (f == NULL) {
+        printf("could not open %s\n", fn);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long fsize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *s = malloc(fsize > 0 ? fsize : 1);
+    if (s == NULL || fread(s, 1, fsize, f) != (size_t)fsize) {
+        printf("could not read %s\n", fn);
+        fclose(f);
+        free(s);
+        return 1;
+    }
+    fclose(f);
+
+    framelist_t fl = { .frames = calloc(MAX_FRAMES, sizeof(frame_t)) };
+    if (fl.frames == NULL) {
+        free(s);
+        return 1;
+    }
+    size_t n = fsize / sample_size(p);
+    if (iter) {
+        bench(p, s, n, iter, &fl);
+        printf("\n");
+    } else {
+        replay(p, s, n, &fl);
+    }
+    print_frames(&fl);
+    printf("\n%u frames decoded from %zu samples\n", fl.cnt, n);
+    free(fl.frames);
+    free(s);
+    return 0;
+}
@@ -269,3 +269,99 @@ uint8_t valid_nonce(uint32_t Nt, uint32_t NtEnc, uint32_t Ks1, uint8_t *parity)
                (oddparity8((Nt >> 8) & 0xFF) == ((parity[2]) ^ oddparity8((NtEnc >> 8) & 0xFF) ^ BIT(Ks1, 0)))
            ) ? 1 : 0;
 }
+
+// Parses one dictionary line, only lines of exactly 12 hex digits are keys.
+// Surrounding blanks are ignored, comments and anything else are skipped.
+static bool parse_key_line(const char *line, const char *end, uint64_t *key) {
+    while (line < end && isspace((unsigned char)*line)) {
+        line++;
+    }
+    while (end > line && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+    if (end - line != 12) {
+        return false;
+    }
+
+    uint64_t k = 0;
+    for (; line < end; line++) {
+        if (isxdigit((unsigned char)*line) == 0) {
+            return false;
+        }
+        k <<= 4;
+        k |= (*line <= '9') ? (uint8_t)(*line - '0') : (uint8_t)((*line | 0x20) - 'a' + 10);
+    }
+    *key = k;
+    return true;
+}
+
+// Load a keys_*.dic candidate file as written by staticnested_1nt, one 12 hex digit key per line.
+// The file is read in one go and parsed in place, fscanf is way too slow for big dictionaries.
+uint64_t *load_keys_dic(const char *filename, uint32_t *keyCount) {
+    *keyCount = 0;
+
+    FILE *fptr = fopen(filename, "rb");
+    if (fptr == NULL) {
+        fprintf(stderr, "Warning: Cannot open %s\n", filename);
+        return NULL;
+    }
+
+    fseek(fptr, 0, SEEK_END);
+    long fsize = ftell(fptr);
+    fseek(fptr, 0, SEEK_SET);
+    if (fsize < 0) {
+        fclose(fptr);
+        return NULL;
+    }
+
+    char *buf = calloc(fsize + 1, sizeof(char));
+    if (buf == NULL) {
+        perror("Failed to allocate memory");
+        fclose(fptr);
+        return NULL;
+    }
+
+    if (fread(buf, 1, fsize, fptr) != (size_t)fsize) {
+        perror("Failed to read keys");
+        fclose(fptr);
+        free(buf);
+        return NULL;
+    }
+    fclose(fptr);
+
+    // first pass counts the keys, the second one stores them
+    uint64_t *keys = NULL;
+    uint32_t count = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            keys = calloc(count + 1, sizeof(uint64_t));
+            if (keys == NULL) {
+                perror("Failed to allocate memory");
+                free(buf);
+                return NULL;
+            }
+            count = 0;
+        }
+
+        const char *line = buf;
+        const char *bufend = buf + fsize;
+        while (line < bufend) {
+            const char *end = memchr(line, '\n', bufend - line);
+            if (end == NULL) {
+                end = bufend;
+            }
+            uint64_t key;
+            if (parse_key_line(line, end, &key)) {
+                if (keys != NULL) {
+                    keys[count] = key;
+                }
+                count++;
+            }
+            line = end + 1;
+        }
+    }
+    free(buf);
+
+    *keyCount = count;
+    return keys;
+}
@@ -12,4 +12,7 @@ typedef struct {
 uint8_t valid_nonce(uint32_t Nt, uint32_t NtEnc, uint32_t Ks1, uint8_t *parity);
 uint64_t *nested(NtpKs1 *pNK, uint32_t sizePNK, uint32_t authuid, uint32_t *keyCount);
 
+// FM11RF08S static nested helpers
+uint64_t *load_keys_dic(const char *filename, uint32_t *keyCount);
+
 #endif
@@ -16,6 +16,7 @@
 #include <pthread.h>
 #include "common.h"
 #include "crapto1/crapto1.h"
+#include "crapto1/crypto1_bs.h"
 #include "parity.h"
 
 // max number of concurrent threads
@@ -91,57 +92,59 @@ static uint8_t valid_nonce(uint32_t Nt, uint32_t ks1, uint8_t nt_par_enc) {
            (oddparity8((Nt >>  8) & 0xFF) == (((nt_par_enc >> 1) & 1) ^ BIT(ks1,  0)));
 }
 
-static bool search_match(const NtData *pND, const NtData *pND0, uint64_t key) {
+// ks[0] / ks[1] are the keystream words of {nt} of pND and of the word after it under key,
+// computed in batches by crypto1_bs_keystream()
+static bool search_match(const NtData *pND, const NtData *pND0, uint64_t key, const uint32_t *ks) {
     bool ret = 0;
     struct Crypto1State *s;
+    uint32_t authuid;
+    uint32_t nt_enc = pND->nt_enc;
+    uint8_t nt_par_enc = pND->nt_par_enc;
+    uint32_t nt = ks[0] ^ nt_enc;
+    // filter: we know nt should be valid, no need to spend time on other ones
+    if (validate_prng_nonce(nt) == false) {
+        return 0;
+    }
     s = crypto1_create(0);
     if (s == NULL) {
         fprintf(stderr, "\nCalloc error in search_match!\n");
         return 0;
     }
-    crypto1_init(s, key);
-    uint32_t authuid = pND->authuid;
-    uint32_t nt_enc = pND->nt_enc;
-    uint8_t nt_par_enc = pND->nt_par_enc;
-    uint32_t nt = crypto1_word(s, nt_enc ^ authuid, 1) ^ nt_enc;
-    // filter: we know nt should be valid, no need to spend time on other ones
-    if (validate_prng_nonce(nt)) {
-        // look for same nt
-        for (uint32_t k = 0; k < pND->sizeNK; k++) {
-            if (nt == pND->pNK[k].ntp) {
-                // Possible match
-                // filter: check the full 4 bits of parity (actually only the last one might be wrong)
-                uint32_t ks1, ks2;
-                uint8_t par1, par2, ksp;
-                par1 = (oddparity8((nt >> 24) & 0xFF) << 3) | (oddparity8((nt >> 16) & 0xFF) << 2) | (oddparity8((nt >> 8) & 0xFF) << 1) | (oddparity8(nt & 0xFF));
-                ks1 = nt ^ nt_enc;
-                ks2 = crypto1_word(s, 0, 0);
-                ksp = (((ks1 >> 16) & 1) << 3) | (((ks1 >> 8) & 1) << 2) | (((ks1 >> 0) & 1) << 1) | ((ks2 >> 24) & 1);
-                par2 = nt_par_enc ^ ksp;
-
-                if (par1 != par2) {
-                    continue;
-                }
-
-                // filter: same check on the full 4 bits of parity of initial nonce
-                // check is slow so we do it only now
-                crypto1_init(s, key);
-                authuid = pND0->authuid;
-                nt_enc = pND0->nt_enc;
-                nt_par_enc = pND0->nt_par_enc;
-                nt = crypto1_word(s, nt_enc ^ authuid, 1) ^ nt_enc;
-                par1 = (oddparity8((nt >> 24) & 0xFF) << 3) | (oddparity8((nt >> 16) & 0xFF) << 2) | (oddparity8((nt >> 8) & 0xFF) << 1) | (oddparity8(nt & 0xFF));
-                ks1 = nt ^ nt_enc;
-                ks2 = crypto1_word(s, 0, 0);
-                ksp = (((ks1 >> 16) & 1) << 3) | (((ks1 >> 8) & 1) << 2) | (((ks1 >> 0) & 1) << 1) | ((ks2 >> 24) & 1);
-                par2 = nt_par_enc ^ ksp;
-                if (par1 != par2) {
-                    continue;
-                }
+    // look for same nt
+    for (uint32_t k = 0; k < pND->sizeNK; k++) {
+        if (nt == pND->pNK[k].ntp) {
+            // Possible match
+            // filter: check the full 4 bits of parity (actually only the last one might be wrong)
+            uint32_t ks1, ks2;
+            uint8_t par1, par2, ksp;
+            par1 = (oddparity8((nt >> 24) & 0xFF) << 3) | (oddparity8((nt >> 16) & 0xFF) << 2) | (oddparity8((nt >> 8) & 0xFF) << 1) | (oddparity8(nt & 0xFF));
+            ks1 = nt ^ nt_enc;
+            ks2 = ks[1];
+            ksp = (((ks1 >> 16) & 1) << 3) | (((ks1 >> 8) & 1) << 2) | (((ks1 >> 0) & 1) << 1) | ((ks2 >> 24) & 1);
+            par2 = nt_par_enc ^ ksp;
+
+            if (par1 != par2) {
+                continue;
+            }
 
-                k = pND->sizeNK;
-                ret = 1;
+            // filter: same check on the full 4 bits of parity of initial nonce
+            // check is slow so we do it only now
+            crypto1_init(s, key);
+            authuid = pND0->authuid;
+            nt_enc = pND0->nt_enc;
+            nt_par_enc = pND0->nt_par_enc;
+            nt = crypto1_word(s, nt_enc ^ authuid, 1) ^ nt_enc;
+            par1 = (oddparity8((nt >> 24) & 0xFF) << 3) | (oddparity8((nt >> 16) & 0xFF) << 2) | (oddparity8((nt >> 8) & 0xFF) << 1) | (oddparity8(nt & 0xFF));
+            ks1 = nt ^ nt_enc;
+            ks2 = crypto1_word(s, 0, 0);
+            ksp = (((ks1 >> 16) & 1) << 3) | (((ks1 >> 8) & 1) << 2) | (((ks1 >> 0) & 1) << 1) | ((ks2 >> 24) & 1);
+            par2 = nt_par_enc ^ ksp;
+            if (par1 != par2) {
+                continue;
             }
+
+            k = pND->sizeNK;
+            ret = 1;
         }
     }
     crypto1_destroy(s);
@@ -157,7 +160,10 @@ static void *generate_and_intersect_keys(void *threadarg) {
     uint32_t num_nonces = data->num_nonces;
 
     struct Crypto1State *revstate, *revstate_start = NULL;
-    uint64_t lfsr = 0;
+    // candidate keys are checked in batches against the other nonces
+    uint64_t lfsrs[CRYPTO1_BS_LANES];
+    uint32_t ks[CRYPTO1_BS_LANES * 2];
+    bool full = false;
 
     uint32_t authuid = pNKL->NtDataList[0].authuid;
     for (uint32_t i = startPos; i < endPos; i++) {
@@ -177,23 +183,41 @@ static void *generate_and_intersect_keys(void *threadarg) {
 
         uint32_t keyCount0 = 0;
         while ((revstate->odd != 0x0) || (revstate->even != 0x0)) {
-            lfsr_rollback_word(revstate, nt_probe, 0);
-            crypto1_get_lfsr(revstate, &lfsr);
-            keyCount0++;
+            uint32_t n = 0;
+            for (; ((revstate->odd != 0x0) || (revstate->even != 0x0)) && n < CRYPTO1_BS_LANES; revstate++) {
+                lfsr_rollback_word(revstate, nt_probe, 0);
+                crypto1_get_lfsr(revstate, &lfsrs[n++]);
+            }
+            keyCount0 += n;
             for (uint32_t nonce_index = 1; nonce_index < num_nonces; nonce_index++) {
-                if (search_match(&pNKL->NtDataList[nonce_index], &pNKL->NtDataList[0], lfsr)) {
+                const NtData *pND = &pNKL->NtDataList[nonce_index];
+                const crypto1_bs_word_t words[2] = {
+                    {pND->nt_enc ^ pND->authuid, true},
+                    {0, false},
+                };
+                crypto1_bs_keystream(lfsrs, n, words, 2, ks);
+                for (uint32_t k = 0; k < n; k++) {
+                    if (search_match(pND, &pNKL->NtDataList[0], lfsrs[k], &ks[k * 2]) == false) {
+                        continue;
+                    }
                     pthread_mutex_lock(data->keyCount_mutex[nonce_index]);
-                    data->result_keys[nonce_index][*data->keyCount[nonce_index]] = lfsr;
+                    data->result_keys[nonce_index][*data->keyCount[nonce_index]] = lfsrs[k];
                     (*data->keyCount[nonce_index])++;
                     pthread_mutex_unlock(data->keyCount_mutex[nonce_index]);
                     if (*data->keyCount[nonce_index] == KEY_SPACE_SIZE_STEP2) {
                         fprintf(stderr, "No space left on result_keys[%u], abort!\n", nonce_index);
                         i = endPos;
+                        full = true;
                         break;
                     }
                 }
+                if (full) {
+                    break;
+                }
+            }
+            if (full) {
+                break;
             }
-            revstate++;
         }
 
         free(revstate_start);
@@ -58,11 +58,11 @@ static uint64_t *generate_keys(uint64_t authuid, uint32_t nt, uint32_t nt_enc, u
         return NULL;
     }
 
-    struct Crypto1State *revstate, *revstate_start = NULL, *s = NULL;
+    struct Crypto1State *revstate, *revstate_start = NULL;
     uint64_t lfsr = 0;
     uint32_t ks1 = nt ^ nt_enc;
 
-    revstate = lfsr_recovery32(ks1, nt ^ authuid);
+    revstate = lfsr_recovery32_mt(ks1, nt ^ authuid, 0);
     if (revstate == NULL) {
         fprintf(stderr, "\nCalloc error in generate_keys!\n");
         free(result_keys);
@@ -71,28 +71,16 @@ static uint64_t *generate_keys(uint64_t authuid, uint32_t nt, uint32_t nt_enc, u
 
     revstate_start = revstate;
 
-    s = crypto1_create(0);
-    if (s == NULL) {
-        fprintf(stderr, "\nCalloc error in generate_keys!\n");
-        free(result_keys);
-        crypto1_destroy(revstate_start);
-        return 0;
-    }
-
+    // only filtering possibility: last parity bit ks in ks2.
+    // The recovered states are the ones right after nt ^ authuid was shifted in, so that bit is
+    // their filter output and no need to clock a cipher for it.
+    uint8_t lastpar1 = oddparity8(nt & 0xFF);
     while ((revstate->odd != 0x0) || (revstate->even != 0x0)) {
-        lfsr_rollback_word(revstate, nt ^ authuid, 0);
-        crypto1_get_lfsr(revstate, &lfsr);
-
-        // only filtering possibility: last parity bit ks in ks2
-        uint32_t ks2;
-        uint8_t lastpar1, lastpar2, kslastp;
-        crypto1_init(s, lfsr);
-        crypto1_word(s, nt ^ authuid, 0);
-        ks2 = crypto1_word(s, 0, 0);
-        lastpar1 = oddparity8(nt & 0xFF);
-        kslastp = (ks2 >> 24) & 1;
-        lastpar2 = (nt_par_enc & 1) ^ kslastp;
+        uint8_t kslastp = filter(revstate->odd);
+        uint8_t lastpar2 = (nt_par_enc & 1) ^ kslastp;
         if (lastpar1 == lastpar2) {
+            lfsr_rollback_word(revstate, nt ^ authuid, 0);
+            crypto1_get_lfsr(revstate, &lfsr);
             result_keys[(*keyCount)++] = lfsr;
             if (*keyCount == KEY_SPACE_SIZE) {
                 fprintf(stderr, "No space left on result_keys, abort! Increase KEY_SPACE_SIZE\n");
@@ -102,7 +90,6 @@ static uint64_t *generate_keys(uint64_t authuid, uint32_t nt, uint32_t nt_enc, u
         revstate++;
     }
 
-    crypto1_destroy(s);
     crypto1_destroy(revstate_start);
     revstate_start = NULL;
     return result_keys;
@@ -17,54 +17,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <inttypes.h>
-
-uint16_t i_lfsr16[1 << 16] = {0};
-uint16_t s_lfsr16[1 << 16] = {0};
-
-static void init_lfsr16_table(void) {
-    uint16_t x = 1;
-    for (uint16_t i = 1; i; ++i) {
-        i_lfsr16[(x & 0xff) << 8 | x >> 8] = i;
-        s_lfsr16[i] = (x & 0xff) << 8 | x >> 8;
-        x = x >> 1 | (x ^ x >> 2 ^ x >> 3 ^ x >> 5) << 15;
-    }
-}
-
-// static uint16_t next_lfsr16(uint16_t nonce) {
-//     return s_lfsr16[(i_lfsr16[nonce]+1) % 65535];
-// }
-
-static uint16_t prev_lfsr16(uint16_t nonce) {
-    return s_lfsr16[(i_lfsr16[nonce] - 1) % 65535];
-}
-
-static uint16_t compute_seednt16_nt32(uint32_t nt32, uint64_t key) {
-    uint8_t a[] = {0, 8, 9, 4, 6, 11, 1, 15, 12, 5, 2, 13, 10, 14, 3, 7};
-    uint8_t b[] = {0, 13, 1, 14, 4, 10, 15, 7, 5, 3, 8, 6, 9, 2, 12, 11};
-    uint16_t nt = nt32 >> 16;
-    uint8_t prev = 14;
-    for (uint8_t i = 0; i < prev; i++) {
-        nt = prev_lfsr16(nt);
-    }
-    uint8_t prevoff = 8;
-    bool odd = 1;
-
-    for (uint8_t i = 0; i < 6 * 8; i += 8) {
-        if (odd) {
-            nt ^= (a[(key >> i) & 0xF]);
-            nt ^= (b[(key >> i >> 4) & 0xF]) << 4;
-        } else {
-            nt ^= (b[(key >> i) & 0xF]);
-            nt ^= (a[(key >> i >> 4) & 0xF]) << 4;
-        }
-        odd ^= 1;
-        prev += prevoff;
-        for (uint8_t j = 0; j < prevoff; j++) {
-            nt = prev_lfsr16(nt);
-        }
-    }
-    return nt;
-}
+#include "nested_util.h"
 
 int main(int argc, char *const argv[]) {
 
@@ -114,92 +67,52 @@ int main(int argc, char *const argv[]) {
     uint32_t keycount2 = 0;
     uint64_t *keys2 = NULL;
     uint8_t *filter_keys2 = NULL;
+    uint16_t *seednt2 = NULL;
+    uint8_t *seen1 = NULL;
+    uint8_t *seen2 = NULL;
     FILE *fptr;
 
-    fptr = fopen(filename1, "r");
-    if (fptr != NULL) {
-
-        uint64_t buffer;
-        while (fscanf(fptr, "%012" PRIx64, &buffer) == 1) {
-            keycount1++;
-        }
-
-        keys1 = (uint64_t *)calloc(1, keycount1 * sizeof(uint64_t));
-        filter_keys1 = (uint8_t *)calloc(keycount1, sizeof(uint8_t));
-        if ((keys1 == NULL) || (filter_keys1 == NULL)) {
-            perror("Failed to allocate memory");
-            fclose(fptr);
-            goto end;
-        }
-
-        rewind(fptr);
-
-        for (uint32_t i = 0; i < keycount1; i++) {
-            if (fscanf(fptr, "%012" PRIx64, &keys1[i]) != 1) {
-                perror("Failed to read key");
-                fclose(fptr);
-                goto end;
-            }
-        }
-        fclose(fptr);
-    } else {
-        fprintf(stderr, "Warning: Cannot open %s\n", filename1);
+    keys1 = load_keys_dic(filename1, &keycount1);
+    if (keys1 == NULL) {
         goto end;
     }
 
-    fptr = fopen(filename2, "r");
-    if (fptr != NULL) {
-
-        uint64_t buffer;
-        while (fscanf(fptr, "%012" PRIx64, &buffer) == 1) {
-            keycount2++;
-        }
-
-        keys2 = (uint64_t *)calloc(1, keycount2 * sizeof(uint64_t));
-        filter_keys2 = (uint8_t *)calloc(keycount2, sizeof(uint8_t));
-        if ((keys2 == NULL) || (filter_keys2 == NULL)) {
-            perror("Failed to allocate memory");
-            fclose(fptr);
-            goto end;
-        }
-
-        rewind(fptr);
-
-        for (uint32_t i = 0; i < keycount2; i++) {
-            if (fscanf(fptr, "%012" PRIx64, &keys2[i]) != 1) {
-                perror("Failed to read key");
-                fclose(fptr);
-                goto end;
-            }
-        }
-        fclose(fptr);
-    } else {
-        fprintf(stderr, "Warning: Cannot open %s\n", filename2);
+    keys2 = load_keys_dic(filename2, &keycount2);
+    if (keys2 == NULL) {
         goto end;
     }
 
     printf("%s: %u keys loaded\n", filename1, keycount1);
     printf("%s: %u keys loaded\n", filename2, keycount2);
 
-    seednt1 = (uint16_t *)calloc(1, keycount1 * sizeof(uint16_t));
-    if (seednt1 == NULL) {
+    filter_keys1 = (uint8_t *)calloc(keycount1 + 1, sizeof(uint8_t));
+    filter_keys2 = (uint8_t *)calloc(keycount2 + 1, sizeof(uint8_t));
+    seednt1 = (uint16_t *)calloc(keycount1 + 1, sizeof(uint16_t));
+    seednt2 = (uint16_t *)calloc(keycount2 + 1, sizeof(uint16_t));
+    seen1 = (uint8_t *)calloc(1 << 16, sizeof(uint8_t));
+    seen2 = (uint8_t *)calloc(1 << 16, sizeof(uint8_t));
+    if ((filter_keys1 == NULL) || (filter_keys2 == NULL) || (seednt1 == NULL) || (seednt2 == NULL) || (seen1 == NULL) || (seen2 == NULL)) {
         perror("Failed to allocate memory");
         goto end;
     }
 
+    // seeds are only 16 bits, so the join of both lists is a lookup in a 64k table
     for (uint32_t i = 0; i < keycount1; i++) {
         seednt1[i] = compute_seednt16_nt32(nt1, keys1[i]);
+        seen1[seednt1[i]] = 1;
     }
 
     for (uint32_t j = 0; j < keycount2; j++) {
-        uint16_t seednt2 = compute_seednt16_nt32(nt2, keys2[j]);
-        for (uint32_t i = 0; i < keycount1; i++) {
-            if (seednt2 == seednt1[i]) {
-//                printf("MATCH: key1=%012" PRIx64 " key2=%012" PRIx64 "\n", keys1[i], keys2[j]);
-                filter_keys1[i] = 1;
-                filter_keys2[j] = 1;
-            }
-        }
+        seednt2[j] = compute_seednt16_nt32(nt2, keys2[j]);
+        seen2[seednt2[j]] = 1;
+    }
+
+    for (uint32_t i = 0; i < keycount1; i++) {
+        filter_keys1[i] = seen2[seednt1[i]];
+    }
+
+    for (uint32_t j = 0; j < keycount2; j++) {
+        filter_keys2[j] = seen1[seednt2[j]];
     }
 
     char filter_filename1[40];
@@ -263,5 +176,12 @@ end:
         free(seednt1);
     }
 
+    if (seednt2 != NULL) {
+        free(seednt2);
+    }
+
+    free(seen1);
+    free(seen2);
+
     return 0;
 }
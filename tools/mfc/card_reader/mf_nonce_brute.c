@@ -9,6 +9,7 @@
 #include <unistd.h>
 #include <ctype.h>
 #include "crapto1/crapto1.h"
+#include "crapto1/crypto1_bs.h"
 #include "protocol.h"
 #include "iso14443crc.h"
 #include "util_posix.h"
@@ -441,30 +442,73 @@ static bool checkCRC(uint32_t decrypted) {
     return CheckCrc14443(CRC_14443_A, data, sizeof(data));
 }
 
+// Keys are pre-filtered in batches with the bitsliced crypto1: the keystream of the nested auth words
+// {nt} {nr} {ar} {at} and of the first 8 encrypted bytes is computed for all lanes at once.
+// Only keys decrypting to a known command byte are decrypted in full.
+#define BS_AUTH_WORDS   4
+#define BS_WORDS        (BS_AUTH_WORDS + 2)
+
+static void init_bs_words(const struct thread_key_args *args, crypto1_bs_word_t *words) {
+    memset(words, 0, BS_WORDS * sizeof(crypto1_bs_word_t));
+    words[0].in = args->nt_enc ^ args->uid;
+    words[0].is_encrypted = args->is_nt_encrypted;
+    words[1].in = args->nr_enc;
+    words[1].is_encrypted = true;
+}
+
+static bool is_cmd_byte(uint8_t b) {
+    for (int i = 0; i < 8; ++i) {
+        if (b == cmds[i][0]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// decrypted byte j (< 8) of lane i
+static uint8_t bs_dec_byte(const uint32_t *ks, uint32_t i, const uint8_t *enc, int j) {
+    return ((ks[i * BS_WORDS + BS_AUTH_WORDS + j / 4] >> (24 - 8 * (j % 4))) & 0xFF) ^ enc[j];
+}
+
+static void decrypt_enc(const struct thread_key_args *args, uint64_t key, const uint8_t *enc, uint8_t *dec) {
+    // Init cipher with key
+    struct Crypto1State pcs;
+    crypto1_init(&pcs, key);
+
+    // NESTED decrypt nt with help of new key
+    crypto1_word(&pcs, args->nt_enc ^ args->uid, args->is_nt_encrypted);
+    crypto1_word(&pcs, args->nr_enc, 1);
+    crypto1_word(&pcs, 0, 0);
+    crypto1_word(&pcs, 0, 0);
+
+    // decrypt bytes
+    for (int j = 0; j < args->enc_len; j++) {
+        dec[j] = crypto1_byte(&pcs, 0x00, 0) ^ enc[j];
+    }
+}
+
 static void *check_default_keys(void *arguments) {
     struct thread_key_args *args = (struct thread_key_args *) arguments;
     uint8_t local_enc[args->enc_len];
     memcpy(local_enc, args->enc, args->enc_len);
 
-    for (uint8_t i = 0; i < ARRAYLEN(g_mifare_default_keys); i++) {
+    crypto1_bs_word_t words[BS_WORDS];
+    init_bs_words(args, words);
 
-        uint64_t key = g_mifare_default_keys[i];
+    uint32_t ks[ARRAYLEN(g_mifare_default_keys) * BS_WORDS];
+    crypto1_bs_keystream(g_mifare_default_keys, ARRAYLEN(g_mifare_default_keys), words, BS_WORDS, ks);
 
-        // Init cipher with key
-        struct Crypto1State *pcs = crypto1_create(key);
+    for (uint8_t i = 0; i < ARRAYLEN(g_mifare_default_keys); i++) {
+
+        if ((is_cmd_byte(bs_dec_byte(ks, i, local_enc, 0)) == false) &&
+                ((args->enc_len <= 4) || (is_cmd_byte(bs_dec_byte(ks, i, local_enc, 4)) == false))) {
+            continue;
+        }
 
-        // NESTED decrypt nt with help of new key
-        crypto1_word(pcs, args->nt_enc ^ args->uid, args->is_nt_encrypted);
-        crypto1_word(pcs, args->nr_enc, 1);
-        crypto1_word(pcs, 0, 0);
-        crypto1_word(pcs, 0, 0);
+        uint64_t key = g_mifare_default_keys[i];
 
-        // decrypt bytes
         uint8_t dec[args->enc_len];
-        for (int j = 0; j < args->enc_len; j++) {
-            dec[j] = crypto1_byte(pcs, 0x00, 0) ^ local_enc[j];
-        }
-        crypto1_destroy(pcs);
+        decrypt_enc(args, key, local_enc, dec);
 
         // check if cmd exists
         bool res = checkValidCmdByte(dec, args->enc_len);
@@ -600,47 +644,58 @@ static void *brute_key_thread(void *arguments) {
     uint8_t local_enc[args->enc_len];
     memcpy(local_enc, args->enc, args->enc_len);
 
-    for (uint64_t count = args->idx; count <= 0xFFFF; count += thread_count) {
+    crypto1_bs_word_t words[BS_WORDS];
+    init_bs_words(args, words);
 
-        uint64_t key = args->part_key | (count << 32);
-
-        // Init cipher with key
-        struct Crypto1State *pcs = crypto1_create(key);
+    uint64_t keys[CRYPTO1_BS_LANES];
+    uint32_t *ks = calloc(CRYPTO1_BS_LANES * BS_WORDS, sizeof(uint32_t));
+    if (ks == NULL) {
+        free(args);
+        return NULL;
+    }
 
-        // NESTED decrypt nt with help of new key
-        crypto1_word(pcs, args->nt_enc ^ args->uid, args->is_nt_encrypted);
-        crypto1_word(pcs, args->nr_enc, 1);
-        crypto1_word(pcs, 0, 0);
-        crypto1_word(pcs, 0, 0);
+    for (uint64_t count = args->idx; count <= 0xFFFF;) {
 
-        // decrypt 22 bytes
-        uint8_t dec[args->enc_len];
-        for (int i = 0; i < args->enc_len; i++) {
-            dec[i] = crypto1_byte(pcs, 0x00, 0) ^ local_enc[i];
+        uint32_t n = 0;
+        for (; count <= 0xFFFF && n < CRYPTO1_BS_LANES; count += thread_count) {
+            keys[n++] = args->part_key | (count << 32);
         }
+        crypto1_bs_keystream(keys, n, words, BS_WORDS, ks);
 
-        crypto1_destroy(pcs);
+        for (uint32_t i = 0; i < n; i++) {
 
-        // check if cmd exists
-        if (checkValidCmdByte(dec, args->enc_len) == false) {
-            continue;
-        }
+            if (is_cmd_byte(bs_dec_byte(ks, i, local_enc, 0)) == false) {
+                continue;
+            }
 
-        __sync_fetch_and_add(&global_found_candidate, 1);
+            uint64_t key = keys[i];
 
-        // lock this section to avoid interlacing prints from different threats
-        pthread_mutex_lock(&print_lock);
-        printf("\nenc:  %s\n", sprint_hex_inrow_ex(local_enc, args->enc_len, 0));
-        printf("dec:  %s\n", sprint_hex_inrow_ex(dec, args->enc_len, 0));
+            // decrypt 22 bytes
+            uint8_t dec[args->enc_len];
+            decrypt_enc(args, key, local_enc, dec);
 
-        if (key == global_candidate_key) {
-            printf("\nValid Key found [ " _GREEN_("%012" PRIx64) " ] - " _YELLOW_("matches candidate")  "\n\n", key);
-        } else {
-            printf("\nValid Key found [ " _GREEN_("%012" PRIx64) " ]\n\n", key);
-        }
+            // check if cmd exists
+            if (checkValidCmdByte(dec, args->enc_len) == false) {
+                continue;
+            }
 
-        pthread_mutex_unlock(&print_lock);
+            __sync_fetch_and_add(&global_found_candidate, 1);
+
+            // lock this section to avoid interlacing prints from different threats
+            pthread_mutex_lock(&print_lock);
+            printf("\nenc:  %s\n", sprint_hex_inrow_ex(local_enc, args->enc_len, 0));
+            printf("dec:  %s\n", sprint_hex_inrow_ex(dec, args->enc_len, 0));
+
+            if (key == global_candidate_key) {
+                printf("\nValid Key found [ " _GREEN_("%012" PRIx64) " ] - " _YELLOW_("matches candidate")  "\n\n", key);
+            } else {
+                printf("\nValid Key found [ " _GREEN_("%012" PRIx64) " ]\n\n", key);
+            }
+
+            pthread_mutex_unlock(&print_lock);
+        }
     }
+    free(ks);
     free(args);
     return NULL;
 }
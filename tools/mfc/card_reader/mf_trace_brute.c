@@ -18,6 +18,7 @@
 #include <unistd.h>
 #include "ctype.h"
 #include "crapto1/crapto1.h"
+#include "crapto1/crypto1_bs.h"
 #include "protocol.h"
 #include "iso14443crc.h"
 #include <util_posix.h>
@@ -193,51 +194,83 @@ static bool checkValidCmdByte(uint8_t *cmd, uint16_t n) {
     return false;
 }
 
+// Keys are pre-filtered in batches with the bitsliced crypto1, the first byte after the nested auth
+// words {nt} {nr} {ar} {at} has to decrypt to a known command. Survivors are decrypted in full.
+#define BS_WORDS    (4 + 1)
+
 static void *brute_thread(void *arguments) {
 
     struct thread_args *args = (struct thread_args *) arguments;
-    uint64_t key = args->part_key;
     uint8_t local_enc[args->enc_len];
     memcpy(local_enc, args->enc, args->enc_len);
 
-    for (uint64_t count = args->idx; count < 0xFFFF; count += thread_count) {
+    const crypto1_bs_word_t words[BS_WORDS] = {
+        {args->nt_enc ^ args->uid, true},
+        {args->nr_enc, true},
+    };
+    uint64_t keys[CRYPTO1_BS_LANES];
+    uint32_t *ks = calloc(CRYPTO1_BS_LANES * BS_WORDS, sizeof(uint32_t));
+    if (ks == NULL) {
+        free(args);
+        return NULL;
+    }
+
+    for (uint64_t count = args->idx; count < 0xFFFF;) {
 
         if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 1) {
             break;
         }
 
-        key |= count << 32;
+        uint32_t n = 0;
+        for (; count < 0xFFFF && n < CRYPTO1_BS_LANES; count += thread_count) {
+            keys[n++] = args->part_key | (count << 32);
+        }
+        crypto1_bs_keystream(keys, n, words, BS_WORDS, ks);
 
-        // Init cipher with key
-        struct Crypto1State *pcs = crypto1_create(key);
+        for (uint32_t k = 0; k < n; k++) {
 
-        // NESTED decrypt nt with help of new key
-        crypto1_word(pcs, args->nt_enc ^ args->uid, 1);
-        crypto1_word(pcs, args->nr_enc, 1);
-        crypto1_word(pcs, 0, 0);
-        crypto1_word(pcs, 0, 0);
+            uint8_t cmd = (ks[k * BS_WORDS + 4] >> 24) ^ args->enc[0];
+            bool is_cmd = false;
+            for (int i = 0; i < 8; ++i) {
+                is_cmd |= (cmd == cmds[i][0]);
+            }
+            if (is_cmd == false) {
+                continue;
+            }
 
-        // decrypt 22 bytes
-        uint8_t dec[args->enc_len];
-        for (int i = 0; i < args->enc_len; i++)
-            dec[i] = crypto1_byte(pcs, 0x00, 0) ^ local_enc[i];
+            uint64_t key = keys[k];
 
-        crypto1_destroy(pcs);
+            // Init cipher with key
+            struct Crypto1State pcs;
+            crypto1_init(&pcs, key);
 
-        if (checkValidCmdByte(dec, args->enc_len) == false) {
-            continue;
+            // NESTED decrypt nt with help of new key
+            crypto1_word(&pcs, args->nt_enc ^ args->uid, 1);
+            crypto1_word(&pcs, args->nr_enc, 1);
+            crypto1_word(&pcs, 0, 0);
+            crypto1_word(&pcs, 0, 0);
+
+            // decrypt 22 bytes
+            uint8_t dec[args->enc_len];
+            for (int i = 0; i < args->enc_len; i++)
+                dec[i] = crypto1_byte(&pcs, 0x00, 0) ^ local_enc[i];
+
+            if (checkValidCmdByte(dec, args->enc_len) == false) {
+                continue;
+            }
+            __sync_fetch_and_add(&global_found, 1);
+
+            // lock this section to avoid interlacing prints from different threats
+            pthread_mutex_lock(&print_lock);
+            printf("\nenc:  %s\n", sprint_hex_inrow_ex(local_enc, args->enc_len, 0));
+            printf("dec:  %s\n", sprint_hex_inrow_ex(dec, args->enc_len, 0));
+            printf("\nValid Key found [ " _GREEN_("%012" PRIx64) " ]\n\n", key);
+            pthread_mutex_unlock(&print_lock);
+            break;
         }
-        __sync_fetch_and_add(&global_found, 1);
-
-        // lock this section to avoid interlacing prints from different threats
-        pthread_mutex_lock(&print_lock);
-        printf("\nenc:  %s\n", sprint_hex_inrow_ex(local_enc, args->enc_len, 0));
-        printf("dec:  %s\n", sprint_hex_inrow_ex(dec, args->enc_len, 0));
-        printf("\nValid Key found [ " _GREEN_("%012" PRIx64) " ]\n\n", key);
-        pthread_mutex_unlock(&print_lock);
-        break;
     }
 
+    free(ks);
     free(args);
     return NULL;
 }
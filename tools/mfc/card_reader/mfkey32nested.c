@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "crapto1/crapto1.h"
+#include "crapto1/crypto1_bs.h"
 #include "util_posix.h"
 
 int main(int argc, char *argv[]) {
@@ -51,17 +52,32 @@ int main(int argc, char *argv[]) {
     ks2 = ar_enc ^ ar;
     printf("    ks2: %08x\n", ks2);
 
-    s = lfsr_recovery32(ks0, uid ^ nt);
+    s = lfsr_recovery32_mt(ks0, uid ^ nt, 0);
 
-    for (t = s; t->odd | t->even; ++t) {
-        crypto1_word(t, nr_enc, 1);
-        if (ks2 == crypto1_word(t, 0, 0)) {
-            lfsr_rollback_word(t, 0, 0);
-            lfsr_rollback_word(t, nr_enc, 1);
-            lfsr_rollback_word(t, uid ^ nt, 0);
-            crypto1_get_lfsr(t, &key);
-            printf("\nFound Key: [%012" PRIx64 "]\n\n", key);
-            break;
+    // candidates are states after uid ^ nt, checked in batches against {ar}
+    uint64_t lfsrs[CRYPTO1_BS_LANES];
+    uint32_t ks[CRYPTO1_BS_LANES * 2];
+    const crypto1_bs_word_t words[] = {
+        {nr_enc, true},
+        {0, false},
+    };
+    bool found = false;
+
+    for (t = s; (t->odd | t->even) && (found == false);) {
+        struct Crypto1State *first = t;
+        uint32_t n = 0;
+        for (; (t->odd | t->even) && n < CRYPTO1_BS_LANES; ++t) {
+            crypto1_get_lfsr(t, &lfsrs[n++]);
+        }
+        crypto1_bs_keystream(lfsrs, n, words, 2, ks);
+        for (uint32_t i = 0; i < n; i++) {
+            if (ks2 == ks[i * 2 + 1]) {
+                lfsr_rollback_word(first + i, uid ^ nt, 0);
+                crypto1_get_lfsr(first + i, &key);
+                printf("\nFound Key: [%012" PRIx64 "]\n\n", key);
+                found = true;
+                break;
+            }
         }
     }
     free(s);
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "crapto1/crapto1.h"
+#include "crapto1/crypto1_bs.h"
 #include "util_posix.h"
 
 int main(int argc, char *argv[]) {
@@ -60,19 +61,34 @@ int main(int argc, char *argv[]) {
     ks2_1 = ar1_enc ^ ar1;
     printf("  ks2_1: %08x\n", ks2_1);
 
-    s = lfsr_recovery32(ks2_0, 0);
+    s = lfsr_recovery32_mt(ks2_0, 0, 0);
 
-    for (t = s; t->odd | t->even; ++t) {
-        lfsr_rollback_word(t, 0, 0);
-        lfsr_rollback_word(t, nr0_enc, 1);
-        lfsr_rollback_word(t, uid ^ nt0, 0);
-        crypto1_get_lfsr(t, &key);
+    // candidates are checked against the second authentication in batches
+    uint64_t keys[CRYPTO1_BS_LANES];
+    uint32_t ks[CRYPTO1_BS_LANES * 3];
+    const crypto1_bs_word_t words[] = {
+        {uid ^ nt1, false},
+        {nr1_enc, true},
+        {0, false},
+    };
+    bool found = false;
 
-        crypto1_word(t, uid ^ nt1, 0);
-        crypto1_word(t, nr1_enc, 1);
-        if (ks2_1 == crypto1_word(t, 0, 0)) {
-            printf("\nFound Key: [%012" PRIx64 "]\n\n", key);
-            break;
+    for (t = s; (t->odd | t->even) && (found == false);) {
+        uint32_t n = 0;
+        for (; (t->odd | t->even) && n < CRYPTO1_BS_LANES; ++t) {
+            lfsr_rollback_word(t, 0, 0);
+            lfsr_rollback_word(t, nr0_enc, 1);
+            lfsr_rollback_word(t, uid ^ nt0, 0);
+            crypto1_get_lfsr(t, &keys[n++]);
+        }
+        crypto1_bs_keystream(keys, n, words, 3, ks);
+        for (uint32_t i = 0; i < n; i++) {
+            if (ks2_1 == ks[i * 3 + 2]) {
+                key = keys[i];
+                printf("\nFound Key: [%012" PRIx64 "]\n\n", key);
+                found = true;
+                break;
+            }
         }
     }
     free(s);
@@ -72,7 +72,7 @@ int main(int argc, char *argv[]) {
     printf("  ks2: %08x\n", ks2);
     printf("  ks3: %08x\n", ks3);
 
-    revstate = lfsr_recovery64(ks2, ks3);
+    revstate = lfsr_recovery64_mt(ks2, ks3, 0);
     if ((revstate->odd == 0) && (revstate->even == 0)) {
         printf("\nKey not found :(\n\n");
         crypto1_destroy(revstate);
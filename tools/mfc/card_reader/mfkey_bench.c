@@ -0,0 +1,153 @@
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "crapto1/crapto1.h"
+#include "util_posix.h"
+
+// simple xorshift, the bench has to run the same authentications every time
+static uint32_t rnd_state = 0x1234abcd;
+static uint32_t rnd32(void) {
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static size_t count_states(struct Crypto1State *s) {
+    size_t n = 0;
+    while (s[n].odd | s[n].even)
+        n++;
+    return n;
+}
+
+static bool same_states(struct Crypto1State *a, struct Crypto1State *b) {
+    size_t n = count_states(a);
+    return (n == count_states(b)) && (memcmp(a, b, n * sizeof(struct Crypto1State)) == 0);
+}
+
+// one authentication, returns false when the key was not among the candidates
+// or the threaded recovery disagrees with the single threaded one
+static bool bench32(uint32_t threads, bool verify) {
+    uint64_t key = ((uint64_t)rnd32() << 16 | (rnd32() & 0xffff)) & 0xffffffffffff;
+    uint32_t uid = rnd32(), nt = rnd32(), nr = rnd32();
+
+    struct Crypto1State *pcs = crypto1_create(key);
+    crypto1_word(pcs, uid ^ nt, 0);
+    crypto1_word(pcs, nr, 0);
+    uint32_t ks2 = crypto1_word(pcs, 0, 0);
+    crypto1_destroy(pcs);
+
+    struct Crypto1State *s = lfsr_recovery32_mt(ks2, 0, threads);
+    if (s == NULL)
+        return false;
+
+    bool ok = true;
+    if (verify) {
+        struct Crypto1State *ref = lfsr_recovery32(ks2, 0);
+        ok = (ref != NULL) && same_states(s, ref);
+        free(ref);
+    }
+
+    bool found = false;
+    for (struct Crypto1State *t = s; t->odd | t->even; ++t) {
+        uint64_t k = 0;
+        lfsr_rollback_word(t, 0, 0);
+        lfsr_rollback_word(t, nr, 0);
+        lfsr_rollback_word(t, uid ^ nt, 0);
+        crypto1_get_lfsr(t, &k);
+        if (k == key) {
+            found = true;
+            break;
+        }
+    }
+    free(s);
+    return ok && found;
+}
+
+static bool bench64(uint32_t threads, bool verify) {
+    uint64_t key = ((uint64_t)rnd32() << 16 | (rnd32() & 0xffff)) & 0xffffffffffff;
+    uint32_t uid = rnd32(), nt = rnd32(), nr = rnd32();
+
+    struct Crypto1State *pcs = crypto1_create(key);
+    crypto1_word(pcs, uid ^ nt, 0);
+    crypto1_word(pcs, nr, 0);
+    uint32_t ks2 = crypto1_word(pcs, 0, 0);
+    uint32_t ks3 = crypto1_word(pcs, 0, 0);
+    crypto1_destroy(pcs);
+
+    struct Crypto1State *s = lfsr_recovery64_mt(ks2, ks3, threads);
+    if (s == NULL)
+        return false;
+
+    bool ok = true;
+    if (verify) {
+        struct Crypto1State *ref = lfsr_recovery64(ks2, ks3);
+        ok = (ref != NULL) && same_states(s, ref);
+        free(ref);
+    }
+
+    uint64_t k = 0;
+    lfsr_rollback_word(s, 0, 0);
+    lfsr_rollback_word(s, 0, 0);
+    lfsr_rollback_word(s, nr, 0);
+    lfsr_rollback_word(s, uid ^ nt, 0);
+    crypto1_get_lfsr(s, &k);
+    free(s);
+    return ok && (k == key);
+}
+
+static double run(const char *name, bool (*fn)(uint32_t, bool), uint32_t threads, int rounds, bool verify) {
+    uint64_t t1 = msclock();
+    for (int i = 0; i < rounds; i++) {
+        if (fn(threads, verify) == false) {
+            printf("%s: key not recovered in round %d\n", name, i);
+            return -1;
+        }
+    }
+    double secs = (msclock() - t1 + 1) / 1000.0;
+    return rounds / secs;
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = 4;
+    uint32_t threads = 0;
+
+    printf("MIFARE Classic key recovery benchmark\n\n");
+
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        printf(" syntax: %s [rounds] [threads]\n\n", argv[0]);
+        printf(" threads 0 uses one thread per logical CPU\n\n");
+        return 1;
+    }
+    if (argc > 1)
+        rounds = atoi(argv[1]);
+    if (argc > 2)
+        threads = atoi(argv[2]);
+    if (rounds <= 0)
+        rounds = 1;
+
+    // first pass checks the threaded statelists against the single threaded ones
+    printf("Verifying threaded recovery...\n");
+    if (run("lfsr_recovery32", bench32, threads, 1, true) < 0)
+        return 1;
+    if (run("lfsr_recovery64", bench64, threads, 1, true) < 0)
+        return 1;
+
+    printf("\n%-16s %8s %16s\n", "function", "threads", "recoveries/s");
+    uint32_t cfg[] = { 1, threads };
+    for (int c = 0; c < 2; c++) {
+        double r32 = run("lfsr_recovery32", bench32, cfg[c], rounds, false);
+        double r64 = run("lfsr_recovery64", bench64, cfg[c], rounds, false);
+        if (r32 < 0 || r64 < 0)
+            return 1;
+        char label[12] = "auto";
+        if (cfg[c])
+            snprintf(label, sizeof(label), "%u", cfg[c]);
+        printf("%-16s %8s %16.2f\n", "lfsr_recovery32", label, r32);
+        printf("%-16s %8s %16.2f\n", "lfsr_recovery64", label, r64);
+    }
+    return 0;
+}
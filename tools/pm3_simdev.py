@@ -0,0 +1,289 @@
+#!/usr/bin/env python3
+# -----------------------------------------------------------------------------
+# Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# See LICENSE.txt for the text of the license.
+# -----------------------------------------------------------------------------
+"""
+Simulated Proxmark3 for client communication tests, no hardware needed.
+
+It speaks the NG / OLD / MIX frame format of include/pm3_cmd.h over TCP and
+answers the few commands the tests use. Faults can be injected on the data
+frames of device memory downloads, to exercise the client recovery paths.
+LF realtime sampling (`lf read --stream`, `lf sniff --stream`) streams the
+samples of a .pm3 trace in a loop, packed to the bits per sample set with
+`lf config -b`, at the device's sample rate.
+
+  pm3_simdev.py [--port 18888] [--drop N] [--corrupt N] [--old] [--lf-signal <file.pm3>]
+      client: proxmark3 tcp:localhost:18888
+
+  pm3_simdev.py --verify-hexsamples <bytes>
+      reads the output of `data hexsamples` on stdin and checks it against
+      the BigBuf content of the simulated device
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+# include/pm3_cmd.h
+CMD_ACK = 0x00ff
+CMD_PING = 0x0109
+CMD_CAPABILITIES = 0x0112
+CMD_BREAK_LOOP = 0x0118
+CMD_LF_ACQ_RAW_ADC = 0x0205
+CMD_LF_SAMPLING_SET_CONFIG = 0x021D
+CMD_LF_SAMPLING_GET_CONFIG = 0x0228
+CMD_LF_SNIFF_RAW_ADC = 0x0360
+CMD_DOWNLOAD_BIGBUF = 0x0207
+CMD_DOWNLOADED_BIGBUF = 0x0208
+CMD_DOWNLOAD_EML_BIGBUF = 0x0110
+CMD_DOWNLOADED_EML_BIGBUF = 0x0111
+COMMANDNG_PREAMBLE_MAGIC = 0x61334d50
+RESPONSENG_PREAMBLE_MAGIC = 0x62334d50
+RESPONSENG_POSTAMBLE_MAGIC = 0x3362
+PM3_CMD_DATA_SIZE = 512
+CAPABILITIES_VERSION = 6
+DL_FLAG_CHUNK_CRC = 1
+DL_CHUNK_DATA_SIZE = PM3_CMD_DATA_SIZE - 8
+
+BIGBUF_SIZE = 40000
+EML_SIZE = 4096
+LF_SAMPLE_RATE = 125000
+LF_STREAM_CHUNK = 4096
+
+
+def bigbuf(start, n):
+    return bytes(((start + i) * 7 + ((start + i) >> 8)) & 0xff for i in range(n))
+
+
+def eml(start, n):
+    return bytes(((start + i) * 3) & 0xff for i in range(n))
+
+
+def crc16_xmodem(data):
+    crc = 0
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xffff
+    return crc
+
+
+def reply_ng(cmd, data=b'', status=0):
+    return struct.pack('<IHbbH', RESPONSENG_PREAMBLE_MAGIC, len(data) | 0x8000, status, 0, cmd) + data \
+        + struct.pack('<H', RESPONSENG_POSTAMBLE_MAGIC)
+
+
+def reply_mix(cmd, arg0=0, arg1=0, arg2=0, data=b''):
+    data = struct.pack('<QQQ', arg0, arg1, arg2) + data
+    return struct.pack('<IHbbH', RESPONSENG_PREAMBLE_MAGIC, len(data), 0, 0, cmd) + data \
+        + struct.pack('<H', RESPONSENG_POSTAMBLE_MAGIC)
+
+
+def reply_old(cmd, arg0, arg1, arg2, data):
+    return struct.pack('<QQQQ', cmd, arg0, arg1, arg2) + data + bytes(PM3_CMD_DATA_SIZE - len(data))
+
+
+def capabilities():
+    # via_usb, lf, hfsniff, 14a, 14b, 15, legic, iclass
+    flags = sum(1 << b for b in (1, 7, 12, 14, 15, 16, 18, 19))
+    return struct.pack('<BIII', CAPABILITIES_VERSION, 460800, BIGBUF_SIZE, flags)[:13]
+
+
+def lf_pack(samples, bps):
+    # MSB first across bytes, the device keeps the upper bits of each sample
+    if bps == 8:
+        return bytes(samples)
+    acc = 0
+    nbits = 0
+    out = bytearray()
+    for x in samples:
+        acc = (acc << bps) | (x >> (8 - bps))
+        nbits += bps
+        while nbits >= 8:
+            nbits -= 8
+            out.append((acc >> nbits) & 0xff)
+    return bytes(out)
+
+
+class Device:
+    def __init__(self, args):
+        self.args = args
+        self.frames = 0
+        self.lock = threading.Lock()
+        # sample_config: decimation, bits_per_sample, averaging, divisor, trigger_threshold, samples_to_skip, verbose
+        self.lf_config = [1, 8, 1, 95, 0, 0, False]
+        self.lf_signal = b''
+        if args.lf_signal:
+            with open(args.lf_signal) as f:
+                self.lf_signal = bytes(int(v) + 128 for v in f.read().split())
+        self.stream_stop = None
+
+    # fault injection, counted over all data frames of all downloads
+    def fault(self, frame):
+        with self.lock:
+            self.frames += 1
+            n = self.frames
+        if self.args.drop and n % self.args.drop == 0:
+            return b''
+        if self.args.corrupt and n % self.args.corrupt == 0:
+            frame = bytearray(frame)
+            frame[len(frame) // 2] ^= 0x55
+            frame = bytes(frame)
+        return frame
+
+    def download(self, reply_cmd, mem, start, n, flags):
+        out = b''
+        with_crc = (flags & DL_FLAG_CHUNK_CRC) and not self.args.old
+        step = DL_CHUNK_DATA_SIZE if with_crc else PM3_CMD_DATA_SIZE
+        for off in range(0, n, step):
+            data = mem(start + off, min(step, n - off))
+            if with_crc:
+                chunk = struct.pack('<IHH', start + off, len(data), crc16_xmodem(data)) + data
+                out += self.fault(reply_ng(reply_cmd, chunk))
+            else:
+                out += self.fault(reply_old(reply_cmd, off, len(data), 0, data))
+        return out + reply_mix(CMD_ACK, 1, 0, 0)
+
+    # realtime sampling, raw bytes without framing until CMD_BREAK_LOOP
+    def lf_stream(self, c, send_lock, stop):
+        bps = self.lf_config[1]
+        # whole bytes per chunk for any bits per sample
+        step = LF_STREAM_CHUNK * 8 // bps // 8 * 8
+        sent = 0
+        pos = 0
+        t0 = time.time()
+        try:
+            while not stop.is_set():
+                chunk = bytearray()
+                while len(chunk) < step:
+                    take = min(step - len(chunk), len(self.lf_signal) - pos)
+                    chunk += self.lf_signal[pos:pos + take]
+                    pos = (pos + take) % len(self.lf_signal)
+                with send_lock:
+                    c.sendall(lf_pack(chunk, bps))
+                sent += step
+                ahead = sent / LF_SAMPLE_RATE - (time.time() - t0)
+                if ahead > 0:
+                    time.sleep(ahead)
+        except OSError:
+            pass
+
+    def handle(self, cmd, data, c, send_lock):
+        if cmd == CMD_PING:
+            return reply_ng(cmd, data)
+        if cmd == CMD_CAPABILITIES:
+            return reply_ng(cmd, capabilities())
+        if cmd == CMD_DOWNLOAD_BIGBUF:
+            start, n, flags = struct.unpack('<QQQ', data[:24])
+            return self.download(CMD_DOWNLOADED_BIGBUF, bigbuf, start, n, flags)
+        if cmd == CMD_DOWNLOAD_EML_BIGBUF:
+            start, n, flags = struct.unpack('<QQQ', data[:24])
+            return self.download(CMD_DOWNLOADED_EML_BIGBUF, eml, start, n, flags)
+        if cmd == CMD_LF_SAMPLING_GET_CONFIG:
+            return reply_ng(cmd, struct.pack('<bbbhhi?', *self.lf_config))
+        if cmd == CMD_LF_SAMPLING_SET_CONFIG:
+            # -1 keeps the current value
+            cfg = struct.unpack('<bbbhhi?', data[:struct.calcsize('<bbbhhi?')])
+            self.lf_config = [old if new == -1 else new for old, new in zip(self.lf_config, cfg)]
+            return b''
+        if cmd in (CMD_LF_ACQ_RAW_ADC, CMD_LF_SNIFF_RAW_ADC) and self.lf_signal:
+            realtime = (struct.unpack('<I', data[:4])[0] >> 30) & 1
+            if realtime:
+                self.stream_stop = threading.Event()
+                threading.Thread(target=self.lf_stream, args=(c, send_lock, self.stream_stop), daemon=True).start()
+                return b''
+        if cmd == CMD_BREAK_LOOP:
+            if self.stream_stop:
+                self.stream_stop.set()
+                self.stream_stop = None
+            return b''
+        return reply_ng(cmd)
+
+    def serve(self, c):
+        c.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        send_lock = threading.Lock()
+        try:
+            while True:
+                pre = recvn(c, 8)
+                magic, length, cmd = struct.unpack('<IHH', pre)
+                if magic == COMMANDNG_PREAMBLE_MAGIC:
+                    length &= 0x7fff
+                    data = recvn(c, length) if length else b''
+                    recvn(c, 2)
+                else:
+                    # OLD frame: 64 bit cmd, 3 x 64 bit args, data
+                    cmd = struct.unpack('<Q', pre)[0] & 0xffff
+                    data = recvn(c, 24 + PM3_CMD_DATA_SIZE)
+                reply = self.handle(cmd, data, c, send_lock)
+                with send_lock:
+                    c.sendall(reply)
+        except (EOFError, ConnectionError):
+            pass
+        c.close()
+
+
+def recvn(c, n):
+    b = b''
+    while len(b) < n:
+        x = c.recv(n - len(b))
+        if not x:
+            raise EOFError
+        b += x
+    return b
+
+
+def verify_hexsamples(n):
+    got = b''
+    for line in sys.stdin:
+        parts = line.split('|', 2)
+        if len(parts) == 3 and parts[0].startswith('[=]'):
+            got += bytes.fromhex(parts[1])
+    if got == bigbuf(0, n):
+        print('hexsamples: ok')
+        return 0
+    bad = next((i for i in range(min(len(got), n)) if got[i] != bigbuf(i, 1)[0]), min(len(got), n))
+    print('hexsamples: %u of %u bytes, first difference at %u' % (len(got), n, bad))
+    return 1
+
+
+def main():
+    p = argparse.ArgumentParser(description='Simulated Proxmark3 over TCP for client tests')
+    p.add_argument('--port', type=int, default=18888)
+    p.add_argument('--drop', type=int, default=0, metavar='N', help='drop every Nth download data frame')
+    p.add_argument('--corrupt', type=int, default=0, metavar='N', help='flip a byte in every Nth download data frame')
+    p.add_argument('--old', action='store_true', help='answer downloads with OLD frames without CRC, like older firmwares')
+    p.add_argument('--lf-signal', metavar='FILE', help='.pm3 trace streamed by LF realtime sampling')
+    p.add_argument('--verify-hexsamples', type=int, metavar='BYTES', help='check `data hexsamples` output read from stdin')
+    args = p.parse_args()
+
+    if args.verify_hexsamples is not None:
+        return verify_hexsamples(args.verify_hexsamples)
+
+    dev = Device(args)
+    s = socket.socket()
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    s.bind(('127.0.0.1', args.port))
+    s.listen(4)
+    while True:
+        c, _ = s.accept()
+        threading.Thread(target=dev.serve, args=(c,), daemon=True).start()
+
+
+if __name__ == '__main__':
+    sys.exit(main())
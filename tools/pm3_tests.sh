@@ -14,12 +14,14 @@ TESTSTATICNESTED=false
 TESTNONCE2KEY=false
 TESTMFNONCEBRUTE=false
 TESTMFDAESBRUTE=false
+TESTHFREPLAY=false
 TESTHITAG2CRACK=false
 TESTCRYPTORF=false
 TESTFPGACOMPRESS=false
 TESTBOOTROM=false
 TESTARMSRC=false
 TESTCLIENT=false
+TESTSIMDEV=false
 TESTRECOVERY=false
 TESTCOMMON=false
 
@@ -29,7 +31,7 @@ while (( "$#" )); do
   case "$1" in
     -h|--help)
       echo """
-Usage: $0 [--long] [--opencl] [--clientbin /path/to/proxmark3] [mfkey|nonce2key|mf_nonce_brute|staticnested|mfd_aes_brute|cryptorf|fpga_compress|bootrom|armsrc|client|recovery|common]
+Usage: $0 [--long] [--opencl] [--clientbin /path/to/proxmark3] [mfkey|nonce2key|mf_nonce_brute|staticnested|mfd_aes_brute|hf_replay|cryptorf|fpga_compress|bootrom|armsrc|client|simdev|recovery|common]
     --long:          Enable slow tests
     --opencl:        Enable tests requiring OpenCL (preferably a Nvidia GPU)
     --clientbin ...: Specify path to proxmark3 binary to test
@@ -84,6 +86,11 @@ Usage: $0 [--long] [--opencl] [--clientbin /path/to/proxmark3] [mfkey|nonce2key|
       TESTMFDAESBRUTE=true
       shift
       ;;
+    hf_replay)
+      TESTALL=false
+      TESTHFREPLAY=true
+      shift
+      ;;
     fpga_compress)
       TESTALL=false
       TESTFPGACOMPRESS=true
@@ -109,6 +116,11 @@ Usage: $0 [--long] [--opencl] [--clientbin /path/to/proxmark3] [mfkey|nonce2key|
       TESTCLIENT=true
       shift
       ;;
+    simdev)
+      TESTALL=false
+      TESTSIMDEV=true
+      shift
+      ;;
     recovery)
       TESTALL=false
       TESTRECOVERY=true
@@ -241,6 +253,28 @@ function CheckExecute() {
   return $RESULT
 }
 
+# <simdev options> <bytes>: dumps BigBuf of a simulated device with the client and checks the content
+function SimDevHexsamples() {
+  local PORT=$((18800 + RANDOM % 100))
+  python3 tools/pm3_simdev.py --port $PORT $1 >/dev/null 2>&1 &
+  local PID=$!
+  sleep 0.5
+  $CLIENTBIN --incognito tcp:localhost:$PORT -c "data hexsamples -n $2" 2>&1 | python3 tools/pm3_simdev.py --verify-hexsamples $2
+  kill $PID 2>/dev/null
+  wait $PID 2>/dev/null
+}
+
+# <simdev options> <client commands>: runs client commands against a simulated device
+function SimDevClient() {
+  local PORT=$((18800 + RANDOM % 100))
+  python3 tools/pm3_simdev.py --port $PORT $1 >/dev/null 2>&1 &
+  local PID=$!
+  sleep 0.5
+  $CLIENTBIN --incognito tcp:localhost:$PORT -c "$2" 2>&1
+  kill $PID 2>/dev/null
+  wait $PID 2>/dev/null
+}
+
 echo -e "\n${C_BLUE}Iceman Proxmark3 test tool ${C_NC}\n"
 
 echo -n "work directory: "
@@ -301,15 +335,17 @@ while true; do
       if ! CheckFileExist "fpgacompress exists"            "$FPGACPMPRESSBIN"; then break; fi
     fi
     if $TESTALL || $TESTMFKEY; then
-      echo -e "\n${C_BLUE}Testing mfkey:${C_NC} ${MFKEY32V2BIN:=./tools/mfc/card_reader/mfkey32v2} ${MFKEY32NESTEDBIN:=./tools/mfc/card_reader/mfkey32nested} ${MFKEY64BIN:=./tools/mfc/card_reader/mfkey64}"
+      echo -e "\n${C_BLUE}Testing mfkey:${C_NC} ${MFKEY32V2BIN:=./tools/mfc/card_reader/mfkey32v2} ${MFKEY32NESTEDBIN:=./tools/mfc/card_reader/mfkey32nested} ${MFKEY64BIN:=./tools/mfc/card_reader/mfkey64} ${MFKEYBENCHBIN:=./tools/mfc/card_reader/mfkey_bench}"
       if ! CheckFileExist "mfkey32v2 exists"               "$MFKEY32V2BIN"; then break; fi
       if ! CheckFileExist "mfkey32nested exists"           "$MFKEY32NESTEDBIN"; then break; fi
       if ! CheckFileExist "mfkey64 exists"                 "$MFKEY64BIN"; then break; fi
+      if ! CheckFileExist "mfkey_bench exists"             "$MFKEYBENCHBIN"; then break; fi
       # Need a decent example for mfkey32...
       if ! CheckExecute "mfkey32v2 test"                   "$MFKEY32V2BIN 12345678 1AD8DF2B 1D316024 620EF048 30D6CB07 C52077E2 837AC61A" "Found Key: \[a0a1a2a3a4a5\]"; then break; fi
       if ! CheckExecute "mfkey32nested test"               "$MFKEY32NESTEDBIN 5C467F63 4bbf8a12 abb30bd1 46033966 adc18162" "Found Key: \[059e2905bfcc\]"; then break; fi
       if ! CheckExecute "mfkey64 test"                     "$MFKEY64BIN 9c599b32 82a4166c a1e458ce 6eea41e0 5cadf439" "Found Key: \[ffffffffffff\]"; then break; fi
       if ! CheckExecute "mfkey64 long trace test"          "$MFKEY64BIN 14579f69 ce844261 f8049ccb 0525c84f 9431cc40 7093df99 9972428ce2e8523f456b99c831e769dced09 8ca6827b ab797fd369e8b93a86776b40dae3ef686efd c3c381ba 49e2c9def4868d1777670e584c27230286f4 fbdcd7c1 4abd964b07d3563aa066ed0a2eac7f6312bf 9f9149ea" "Found Key: \[091e639cb715\]"; then break; fi
+      if ! CheckExecute "mfkey recovery benchmark"         "$MFKEYBENCHBIN 2" "recoveries/s"; then break; fi
     fi
     if $TESTALL || $TESTSTATICNESTED; then
       echo -e "\n${C_BLUE}Testing staticnested:${C_NC} ${STATICNESTED0NTBIN:=./tools/mfc/card_only/staticnested_0nt} ${STATICNESTED1NTBIN:=./tools/mfc/card_only/staticnested_1nt} ${STATICNESTED2NTBIN:=./tools/mfc/card_only/staticnested_2nt} ${STATICNESTED2X1NTBIN:=./tools/mfc/card_only/staticnested_2x1nt_rf08s} ${STATICNESTED2X11KNTBIN:=./tools/mfc/card_only/staticnested_2x1nt_rf08s_1key}"
@@ -324,6 +360,7 @@ while true; do
       if ! CheckExecute "staticnested_2nt test"                "$STATICNESTED2NTBIN 461dce03 7eef3586 7fa28c7e 322bc14d 7f62b3d6" "\[ 2 \].*ffffffffff40.*"; then break; fi
       if ! CheckExecute "staticnested_2x1nt_rf08s test"        "$STATICNESTED2X1NTBIN keys_5c467f63_00_456ace4e.dic keys_5c467f63_00_e56f9fa2.dic; rm keys_5c467f63_00_456ace4e.dic keys_5c467f63_00_e56f9fa2.dic; grep ffffffffff keys_5c467f63_00_456ace4e_filtered.dic" "fffffffffff1"; then break; fi
       if ! CheckExecute "staticnested_2x1nt_rf08s_1key test"        "$STATICNESTED2X11KNTBIN 456ace4e fffffffffff1 keys_5c467f63_00_e56f9fa2_filtered.dic; rm keys_5c467f63_00_456ace4e_filtered.dic keys_5c467f63_00_e56f9fa2_filtered.dic" "MATCH: key2=fffffffffff2"; then break; fi
+      if ! CheckExecute "staticnested short line dic test"     "(echo '# cafe beef dead'; for i in \$(seq 2000); do echo 1; done; echo fffffffffff2; echo abc) > keys_5c467f63_00_e56f9fa2.dic; $STATICNESTED2X11KNTBIN 456ace4e fffffffffff1 keys_5c467f63_00_e56f9fa2.dic | tr '\\n' ' '; rm keys_5c467f63_00_e56f9fa2.dic" ": 1 keys loaded MATCH: key2=fffffffffff2"; then break; fi
     fi
     if $TESTALL || $TESTNONCE2KEY; then
       echo -e "\n${C_BLUE}Testing nonce2key:${C_NC} ${NONCE2KEYBIN:=./tools/mfc/card_only/nonce2key}"
@@ -333,8 +370,9 @@ while true; do
     if $TESTALL || $TESTMFNONCEBRUTE; then
       echo -e "\n${C_BLUE}Testing mf_nonce_brute:${C_NC} ${MFNONCEBRUTEBIN:=./tools/mfc/card_reader/mf_nonce_brute}"
       if ! CheckFileExist "mf_nonce_brute exists"          "$MFNONCEBRUTEBIN"; then break; fi
-      if ! CheckExecute slow "mf_nonce_brute test 1/2"         "$MFNONCEBRUTEBIN 9c599b32 5a920d85 1011 98d76b77 d6c6e870 0000 ca7e0b63 0111 3e709c8a" "Key found \[.*ffffffffffff.*\]"; then break; fi
-      if ! CheckExecute slow "mf_nonce_brute test 2/2"         "$MFNONCEBRUTEBIN 96519578 d7e3c6ac 0011 cd311951 9da49e49 0010 2bb22e00 0100 a4f7f398" "Key found \[.*3b7e4fd575ad.*\]"; then break; fi
+      if ! CheckExecute slow "mf_nonce_brute test 1/3"         "$MFNONCEBRUTEBIN 9c599b32 5a920d85 1011 98d76b77 d6c6e870 0000 ca7e0b63 0111 3e709c8a" "Key found \[.*ffffffffffff.*\]"; then break; fi
+      if ! CheckExecute slow "mf_nonce_brute test 2/3"         "$MFNONCEBRUTEBIN 96519578 d7e3c6ac 0011 cd311951 9da49e49 0010 2bb22e00 0100 a4f7f398" "Key found \[.*3b7e4fd575ad.*\]"; then break; fi
+      if ! CheckExecute slow "mf_nonce_brute test 3/3"         "$MFNONCEBRUTEBIN 11223344 3bca7641 1111 29e70748 88e9bef1 0111 076a1435 0100 429c419467b46f490aa64125399cc721f63f0ec3cac6" "Key found \[.*a1b2c3d4e5f6.*\] - .*matches candidate"; then break; fi
     fi
     if $TESTALL || $TESTMFDAESBRUTE; then
       echo -e "\n${C_BLUE}Testing mfd_aes_brute:${C_NC} ${MFDASEBRUTEBIN:=./tools/mfd_aes_brute/mfd_aes_brute}"
@@ -342,6 +380,11 @@ while true; do
       if ! CheckExecute      "mfd_aes_brute test 1/2"         "$MFDASEBRUTEBIN 1629394800 bb6aea729414a5b1eff7b16328ce37fd 82f5f498dbc29f7570102397a2e5ef2b6dc14a864f665b3c54d11765af81e95c" "key.................... .*261C07A23F2BC8262F69F10A5BDF3764"; then break; fi
       if ! CheckExecute slow "mfd_aes_brute test 2/2"         "$MFDASEBRUTEBIN 1546300800 3fda933e2953ca5e6cfbbf95d1b51ddf 97fe4b5de24188458d102959b888938c988e96fb98469ce7426f50f108eaa583" "key.................... .*E757178E13516A4F3171BC6EA85E165A"; then break; fi
     fi
+    if $TESTALL || $TESTHFREPLAY; then
+      echo -e "\n${C_BLUE}Testing hf_replay:${C_NC} ${HFREPLAYBIN:=./tools/hf_replay/hf_replay}"
+      if ! CheckFileExist "hf_replay exists"              "$HFREPLAYBIN"; then break; fi
+      if ! CheckExecute      "hf_replay self test"             "$HFREPLAYBIN -t" "self test: ok"; then break; fi
+    fi
 
     if $TESTALL || $TESTCRYPTORF; then
       echo -e "\n${C_BLUE}Testing CryptoRF sma:${C_NC} ${CRYPTRFBRUTEBIN:=./tools/cryptorf/sma} ${CRYPTRF_MULTI_BRUTEBIN:=./tools/cryptorf/sma_multi}"
@@ -405,6 +448,18 @@ while true; do
       # Order of magnitude to crack it: ~15s -> tagged as "slow"
       if ! CheckExecute slow opencl "ht2crack5opencl test"     "cd $HT2CRACK5OPENCLPATH; ./ht2crack5opencl $HT2CRACK5OPENCLUID $HT2CRACK5OPENCLNRAR" "Key found.*$HT2CRACK5OPENCLKEY"; then break; fi
     fi
+    if $TESTALL || $TESTSIMDEV; then
+      echo -e "\n${C_BLUE}Testing client against simulated device:${C_NC} ${CLIENTBIN:=./client/proxmark3}"
+      if ! CheckFileExist "proxmark3 exists"               "$CLIENTBIN"; then break; fi
+      if ! CheckExecute "simdev download test"             "SimDevHexsamples '' 40000" "hexsamples: ok"; then break; fi
+      if ! CheckExecute "simdev download drop/corrupt test" "SimDevHexsamples '--drop 7 --corrupt 5' 40000" "hexsamples: ok"; then break; fi
+      if ! CheckExecute "simdev download old fw drop test" "SimDevHexsamples '--old --drop 6' 40000" "hexsamples: ok"; then break; fi
+      if ! CheckExecute "simdev download incomplete test"  "SimDevHexsamples '--drop 2 --corrupt 3' 40000" "hexsamples: 0 of 40000"; then break; fi
+      if ! CheckExecute "simdev lf stream em410x 8 bps"    "SimDevClient '--lf-signal traces/lf_EM4102-1.pm3' 'lf read --stream -s 100000'" "EM 410x ID 010872E77C"; then break; fi
+      if ! CheckExecute "simdev lf stream em410x 1 bps"    "SimDevClient '--lf-signal traces/lf_ATA5577_em410x.pm3' 'lf config -b 1; lf read --stream -s 100000'" "EM 410x ID 0F0368568B"; then break; fi
+      if ! CheckExecute "simdev lf stream hid 8 bps"       "SimDevClient '--lf-signal traces/lf_HID-proxCardII-05512-11432784-1.pm3' 'lf sniff --stream -s 100000'" "HID Prox raw: 000000000000002006e22b11"; then break; fi
+      if ! CheckExecute "simdev lf stream hid 1 bps"       "SimDevClient '--lf-signal traces/lf_HID-proxCardII-05512-11432784-1.pm3' 'lf config -b 1; lf read --stream -s 100000'" "HID Prox raw: 000000000000002006e22b11"; then break; fi
+    fi
     if $TESTALL || $TESTCLIENT; then
       echo -e "\n${C_BLUE}Testing client:${C_NC} ${CLIENTBIN:=./client/proxmark3}"
       if ! CheckFileExist "proxmark3 exists"               "$CLIENTBIN"; then break; fi
@@ -435,11 +490,24 @@ while true; do
       if ! CheckExecute "reveng readline test"    "$CLIENTBIN -c 'reveng -h;reveng -D'" "CRC-64/GO-ISO"; then break; fi
       if ! CheckExecute "reveng -g test"          "$CLIENTBIN -c 'reveng -g abda202c'" "CRC-16/ISO-IEC-14443-3-A"; then break; fi
       if ! CheckExecute "reveng -w test"          "$CLIENTBIN -c 'reveng -w 8 -s 01020304e3 010204039d'" "CRC-8/SMBUS"; then break; fi
+      if ! CheckExecute "reveng -g frames test"   "$CLIENTBIN -c 'reveng -g 0102e3 500057cd 3003999a 300002a8 300426ee'" "CRC-16/ISO-IEC-14443-3-A.*4 / 5"; then break; fi
+      if ! CheckExecute "reveng -g trace test"    "$CLIENTBIN -c 'reveng -g -f traces/hf_14a_mfu.trace'" "CRC-16/ISO-IEC-14443-3-A.*12 / 14"; then break; fi
+      if ! CheckExecute "reveng -g trace repeats test" "$CLIENTBIN -c 'reveng -g -f traces/hf_14a_mfu-sim.trace'" "253 repeated frames skipped"; then break; fi
+      if ! CheckExecute "analyse crc bench test"  "$CLIENTBIN -c 'analyse crc --bench --iter 1'" "self test.*ok"; then break; fi
       if ! CheckExecute "mfu pwdgen test"         "$CLIENTBIN -c 'hf mfu pwdgen --test'" "Selftest ok"; then break; fi
       if ! CheckExecute "mfu keygen test"         "$CLIENTBIN -c 'hf mfu keygen --uid 11223344556677'" "80 B1 C2 71 D8 A0"; then break; fi
       if ! CheckExecute "jooki encode test"       "$CLIENTBIN -c 'hf jooki encode --test'" "04 28 F4 DA F0 4A 81  \( ok \)"; then break; fi
+      if ! CheckExecute "mf hardnested bench test" "$CLIENTBIN -c 'hf mf hardnested --bench'" "Fastest SIMD core"; then break; fi
       if ! CheckExecute "trace load/list 14a"     "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -1 -t 14a;'" "READBLOCK\(8\)"; then break; fi
       if ! CheckExecute "trace load/list x"       "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -x1 -t 14a;'" "0.0101840425"; then break; fi
+      if ! CheckExecute "trace list mf nested dict" "$CLIENTBIN -c 'trace list -t mf --tf traces/hf_mf_nested_dict.trace -f mfc_default_keys'" "key 0000013B0ED0"; then break; fi
+      if ! CheckExecute "trace list stream"       "$CLIENTBIN -c 'trace list -t 14a --tf traces/hf_14a_mfu.trace;'" "READBLOCK\(8\)"; then break; fi
+      if ! CheckExecute "hf decode 14b sniff"     "$CLIENTBIN -c 'hf decode -t 14b -f traces/hf_sniff_14b_scl3711.pm3; trace list -1 -t 14b;'" "50  C1  2C  8B  1B  00  00  00  00  91  71  71"; then break; fi
+      if ! CheckExecute "hf decode 14a sniff"     "$CLIENTBIN -c 'hf decode -t 14a -f traces/hf_sniff_14a_synth.pm3; trace list -1 -t 14a;'" "88  99  AA  BB  CC  DD  EE  FF  AE  41"; then break; fi
+      if ! CheckExecute "hf decode 15 sniff"      "$CLIENTBIN -c 'hf decode -t 15 -f traces/hf_sniff_15_synth.pm3; trace list -1 -t 15;'" "00  11  22  33  44  04  3E"; then break; fi
+      if ! CheckExecute "hf decode iclass sniff"  "$CLIENTBIN -c 'hf decode -t iclass -f traces/hf_sniff_iclass_synth.pm3; trace list -1 -t iclass;'" "12  FF  FF  FF  7F  1F  FF  3C  8C  87"; then break; fi
+      if ! CheckExecute "hf decode stitched"      "$CLIENTBIN -c 'hf decode -t 14b -f traces/hf_sniff_14b_scl3711.pm3 -f traces/hf_sniff_14b_scl3711.pm3 --threads 3'" "decoded 10 frames"; then break; fi
+      if ! CheckExecute "data atr lookup test"    "$CLIENTBIN -c 'data atr -d 3B6B00000031C064BE1B0100079000'" "MTS Bank MasterCard"; then break; fi
       if ! CheckExecute "nfc decode test - oob"          "$CLIENTBIN -c 'nfc decode -d DA2010016170706C69636174696F6E2F766E642E626C7565746F6F74682E65702E6F6F62301000649201B96DFB0709466C65782032'" "Flex 2"; then break; fi
       if ! CheckExecute "nfc decode test - device info"  "$CLIENTBIN -c 'nfc decode -d d1025744690004536f6e79010752432d533338300220426c61636b204e46432052656164657220636f6e6e656374656420746f2050430310123e4567e89b12d3a45642665544000004124e464320506f72742d3130302076312e3032'" "NFC Port-100 v1.02"; then break; fi
       if ! CheckExecute "nfc decode test - vcard"        "$CLIENTBIN -c 'nfc decode -d d20ca3746578742f782d7643617264424547494e3a56434152440a56455253494f4e3a332e300a4e3a43687269733b4963656d616e3b3b3b0a464e3a476f7468656e627572670a5245563a323032312d30362d32345432303a31353a30385a0a6974656d322e582d4142444154453b747970653d707265663a323032302d30362d32340a4954454d322e582d41424c4142454c3a5f24213c416e6e69766572736172793e21245f0a454e443a56434152440a'" "END:VCARD"; then break; fi
@@ -561,14 +629,27 @@ while true; do
       if ! CheckExecute slow "lf T55 visa2000 test"              "$CLIENTBIN -c 'data load -f traces/lf_ATA5577_visa2000.pm3; lf search -1'" "Visa2000 ID found"; then break; fi
       if ! CheckExecute slow "lf T55 visa2000 test2"             "$CLIENTBIN -c 'data load -f traces/lf_ATA5577_visa2000.pm3; lf visa2000 demod'" \
                                                                      "Visa2000 - Card 112233, Raw: 564953320001B66900000183"; then break; fi
+      if ! CheckExecute "lf search folder EM410x test"          "$CLIENTBIN -c 'lf search --dir traces' | grep -A8 '\"file\": \"lf_EM4102-1.pm3\"'" "EM 410x ID 010872E77C"; then break; fi
+      if ! CheckExecute "lf search folder HID Prox test"        "$CLIENTBIN -c 'lf search --dir traces' | grep -A8 '\"file\": \"lf_HID-proxCardII-05512-11432784-1.pm3\"'" \
+                                                                 "raw: 000000000000002006e22b11"; then break; fi
+      if ! CheckExecute "lf search folder PARADOX test"         "$CLIENTBIN -c 'lf search --dir traces' | grep -A8 '\"file\": \"lf_Paradox-96_40426-APJN08.pm3\"'" \
+                                                                 "Paradox - ID: 004209dea FC: 96 Card: 40426"; then break; fi
+      if ! CheckExecute "lf search folder T55 visa2000 test"    "$CLIENTBIN -c 'lf search -c --dir traces' | grep -A8 '\"file\": \"lf_ATA5577_visa2000.pm3\"'" \
+                                                                 "Visa2000 - Card 112233, Raw: 564953320001B66900000183"; then break; fi
+      if ! CheckExecute "data detectclock bench test"           "$CLIENTBIN -c 'data load -f traces/lf_EM4x50.pm3; data detectclock --bench --iter 2'" "PSK Clock...   16"; then break; fi
+      if ! CheckExecute "data detectclock bench dir test"       "$CLIENTBIN -c 'data detectclock --bench --iter 1 --dir traces'" "32 +16 +[0-9.]+ +48000  lf_EM4x50.pm3"; then break; fi
 
       echo -e "\n${C_BLUE}Testing HF:${C_NC}"
       if ! CheckExecute "hf mf offline text"               "$CLIENTBIN -c 'hf mf'" "content from tag dump file"; then break; fi
+      if ! CheckExecute "hf mf rf08s test"                 "$CLIENTBIN -c 'hf mf rf08s --test'" "Self test \( ok \)"; then break; fi
       if ! CheckExecute slow retry ignore "hf mf hardnested long test"  "$CLIENTBIN -c 'hf mf hardnested -t --tk 000000000000'" "found:"; then break; fi
       if ! CheckExecute slow "hf iclass loclass long test" "$CLIENTBIN -c 'hf iclass loclass --long'" "verified \( ok \)"; then break; fi
       if ! CheckExecute slow "emv long test"               "$CLIENTBIN -c 'emv test -l'" "Tests \( ok"; then break; fi
       if ! CheckExecute "hf iclass lookup test"            "$CLIENTBIN -c 'hf iclass lookup --csn 9655a400f8ff12e0 --epurse f0ffffffffffffff --macs 0000000089cb984b -f $DICPATH/iclass_default_keys.dic'" \
                                                                 "valid key AE A6 84 A6 DA B2 32 78"; then break; fi
+      if ! CheckExecute "hf iclass lookup cache test"      "${CLIENTBIN% --incognito} -c 'hf iclass lookup --csn 9655a400f8ff12e0 --epurse f0ffffffffffffff --macs 0000000089cb984b -f $DICPATH/iclass_default_keys.dic; hf iclass lookup --csn 9655a400f8ff12e0 --epurse f0ffffffffffffff --macs 0000000089cb984b -f $DICPATH/iclass_default_keys.dic'" \
+                                                                "cached diversified keys"; then break; fi
+      if ! CheckExecute "hf iclass lookup incognito test"  "$CLIENTBIN -c 'hf iclass lookup --csn 9655a400f8ff12e0 --epurse f0ffffffffffffff --macs 0000000089cb984b -f $DICPATH/iclass_default_keys.dic' | grep -c 'cached diversified keys'" "^0$"; then break; fi
       if ! CheckExecute "hf iclass loclass test"         "$CLIENTBIN -c 'hf iclass loclass --test'" "key diversification \( ok \)"; then break; fi
       if ! CheckExecute "emv test"                       "$CLIENTBIN -c 'emv test'" "Tests \( ok"; then break; fi
       if ! CheckExecute "hf cipurse test"                "$CLIENTBIN -c 'hf cipurse test'" "Tests \( ok"; then break; fi